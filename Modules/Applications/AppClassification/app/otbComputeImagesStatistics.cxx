@@ -23,6 +23,8 @@
 
 #include "otbStatisticsXMLFileWriter.h"
 #include "otbStreamingStatisticsVectorImageFilter.h"
+#include "otbStreamingSampledStatisticsVectorImageFilter.h"
+#include "itkGaussianDistribution.h"
 #include <sstream>
 
 namespace otb
@@ -50,7 +52,9 @@ private:
     SetName("ComputeImagesStatistics");
     SetDescription("Computes global mean and standard deviation for each band from a set of images and optionally saves the results in an XML file.");
     SetDocName("Compute Images second order statistics");
-    SetDocLongDescription("This application computes a global mean and standard deviation for each band of a set of images and optionally saves the results in an XML file. The output XML is intended to be used an input for the TrainImagesClassifier application to normalize samples before learning.");
+    SetDocLongDescription("This application computes a global mean and standard deviation for each band of a set of images and optionally saves the results in an XML file. The output XML is intended to be used an input for the TrainImagesClassifier application to normalize samples before learning. "
+      "By default every pixel is read. With the random blocks sampling strategy, only a spatially stratified random subset of square blocks is read, "
+      "and confidence intervals of the mean and standard deviation are reported.");
     SetDocLimitations("Each image of the set must contain the same bands as the others (i.e. same types, in the same order).");
     SetDocAuthors("OTB-Team");
     SetDocSeeAlso("Documentation of the TrainImagesClassifier application.");
@@ -69,6 +73,43 @@ private:
     SetParameterDescription( "out", "XML filename where the statistics are saved for future reuse." );
     MandatoryOff("out");
 
+    AddParameter(ParameterType_Choice, "sampling", "Sampling strategy");
+    SetParameterDescription("sampling", "Pixels used to compute the statistics.");
+
+    AddChoice("sampling.full", "Full images");
+    SetParameterDescription("sampling.full", "All the pixels of the images are used.");
+
+    AddChoice("sampling.blocks", "Random blocks");
+    SetParameterDescription("sampling.blocks", "Only a spatially stratified random subset of square blocks is read in each image. "
+                            "The confidence intervals are estimated from the dispersion between blocks.");
+
+    AddParameter(ParameterType_Float, "sampling.blocks.rate", "Sampling rate");
+    SetParameterDescription("sampling.blocks.rate", "Fraction of the blocks read in each image.");
+    SetDefaultParameterFloat("sampling.blocks.rate", 0.05);
+    SetMinimumParameterFloatValue("sampling.blocks.rate", 0.0);
+    SetMaximumParameterFloatValue("sampling.blocks.rate", 1.0);
+
+    AddParameter(ParameterType_Float, "sampling.blocks.error", "Target error");
+    SetParameterDescription("sampling.blocks.error", "If strictly positive, more blocks are read until the half width of the confidence "
+                            "interval of each band mean is lower than this fraction of the band standard deviation.");
+    SetDefaultParameterFloat("sampling.blocks.error", 0.0);
+    SetMinimumParameterFloatValue("sampling.blocks.error", 0.0);
+
+    AddParameter(ParameterType_Int, "sampling.blocks.size", "Block size");
+    SetParameterDescription("sampling.blocks.size", "Size of the square blocks, in pixels.");
+    SetDefaultParameterInt("sampling.blocks.size", 256);
+    SetMinimumParameterIntValue("sampling.blocks.size", 16);
+
+    AddParameter(ParameterType_Float, "sampling.blocks.confidence", "Confidence level");
+    SetParameterDescription("sampling.blocks.confidence", "Confidence level of the reported intervals.");
+    SetDefaultParameterFloat("sampling.blocks.confidence", 0.95);
+    SetMinimumParameterFloatValue("sampling.blocks.confidence", 0.5);
+    SetMaximumParameterFloatValue("sampling.blocks.confidence", 0.999);
+
+    AddParameter(ParameterType_Int, "sampling.blocks.seed", "Random seed");
+    SetParameterDescription("sampling.blocks.seed", "Seed of the block sampling.");
+    SetDefaultParameterInt("sampling.blocks.seed", 0);
+
     AddRAMParameter();
 
    // Doc example parameter settings
@@ -85,6 +126,7 @@ private:
   {
     //Statistics estimator
     typedef otb::StreamingStatisticsVectorImageFilter<FloatVectorImageType> StreamingStatisticsVImageFilterType;
+    typedef otb::StreamingSampledStatisticsVectorImageFilter<FloatVectorImageType> SampledStatisticsVImageFilterType;
 
     // Samples
     typedef double ValueType;
@@ -112,6 +154,13 @@ private:
     MatrixValueType nbSamples(nbBands, static_cast<unsigned int>(nbImages));
     nbSamples.Fill(itk::NumericTraits<MatrixValueType::ValueType>::Zero);
 
+    // Standard errors of the mean and variance (sampled mode)
+    const bool sampled = (GetParameterString("sampling") == "blocks");
+    MatrixValueType meanError(nbBands, static_cast<unsigned int>(nbImages));
+    meanError.Fill(itk::NumericTraits<MatrixValueType::ValueType>::Zero);
+    MatrixValueType varianceError(nbBands, static_cast<unsigned int>(nbImages));
+    varianceError.Fill(itk::NumericTraits<MatrixValueType::ValueType>::Zero);
+
     //Iterate over all input images
     for (unsigned int imageId = 0; imageId < nbImages; ++imageId)
       {
@@ -122,29 +171,64 @@ private:
             << " bands, while the image #1 has " << nbBands );
         }
 
-      // Compute Statistics of each VectorImage
-      StreamingStatisticsVImageFilterType::Pointer statsEstimator = StreamingStatisticsVImageFilterType::New();
       std::ostringstream processName;
       processName << "Processing Image (" << imageId+1 << "/" << imageList->Size() << ")";
-      AddProcess(statsEstimator->GetStreamer(), processName.str().c_str());
-      statsEstimator->SetInput(image);
-      statsEstimator->GetStreamer()->SetAutomaticAdaptativeStreaming(GetParameterInt("ram"));
 
-      if( HasValue( "bv" ) )
+      if (sampled)
         {
-        statsEstimator->SetIgnoreUserDefinedValue(true);
-        statsEstimator->SetUserIgnoredValue(GetParameterFloat("bv"));
+        // Estimate the statistics of each VectorImage from a sample of blocks
+        SampledStatisticsVImageFilterType::Pointer sampledEstimator = SampledStatisticsVImageFilterType::New();
+        AddProcess(sampledEstimator->GetStreamer(), processName.str().c_str());
+        sampledEstimator->SetInput(image);
+        sampledEstimator->SetTileDimension(GetParameterInt("sampling.blocks.size"));
+        sampledEstimator->SetSamplingRate(GetParameterFloat("sampling.blocks.rate"));
+        sampledEstimator->SetTargetError(GetParameterFloat("sampling.blocks.error"));
+        sampledEstimator->SetSeed(GetParameterInt("sampling.blocks.seed"));
+        sampledEstimator->GetFilter()->SetConfidenceLevel(GetParameterFloat("sampling.blocks.confidence"));
+
+        if( HasValue( "bv" ) )
+          {
+          sampledEstimator->GetFilter()->SetIgnoreUserDefinedValue(true);
+          sampledEstimator->GetFilter()->SetUserIgnoredValue(GetParameterFloat("bv"));
+          }
+        sampledEstimator->Update();
+
+        otbAppLogINFO("Image #" << imageId + 1 << ": " << sampledEstimator->GetNumberOfSampledTiles()
+                      << " blocks read out of " << sampledEstimator->GetNumberOfTiles());
+
+        for(unsigned int itBand = 0; itBand < nbBands; itBand++)
+          {
+          mean(itBand, imageId) = sampledEstimator->GetMean()[itBand];
+          variance(itBand, imageId) = sampledEstimator->GetVariance()[itBand];
+          nbSamples(itBand, imageId) = sampledEstimator->GetFilter()->GetEstimatedNbRelevantPixels();
+          meanError(itBand, imageId) = sampledEstimator->GetFilter()->GetMeanStandardError()[itBand];
+          varianceError(itBand, imageId) = sampledEstimator->GetFilter()->GetVarianceStandardError()[itBand];
+          }
         }
-      statsEstimator->Update();
-
-      MeasurementType nbRelevantPixels = statsEstimator->GetNbRelevantPixels();
-      MeasurementType meanPerBand = statsEstimator->GetMean();
-
-      for(unsigned int itBand = 0; itBand < nbBands; itBand++)
+      else
         {
-        mean(itBand, imageId) = meanPerBand[itBand];
-        variance(itBand, imageId) = (statsEstimator->GetCovariance())( itBand, itBand );
-        nbSamples(itBand, imageId) = nbRelevantPixels[itBand];
+        // Compute Statistics of each VectorImage
+        StreamingStatisticsVImageFilterType::Pointer statsEstimator = StreamingStatisticsVImageFilterType::New();
+        AddProcess(statsEstimator->GetStreamer(), processName.str().c_str());
+        statsEstimator->SetInput(image);
+        statsEstimator->GetStreamer()->SetAutomaticAdaptativeStreaming(GetParameterInt("ram"));
+
+        if( HasValue( "bv" ) )
+          {
+          statsEstimator->SetIgnoreUserDefinedValue(true);
+          statsEstimator->SetUserIgnoredValue(GetParameterFloat("bv"));
+          }
+        statsEstimator->Update();
+
+        MeasurementType nbRelevantPixels = statsEstimator->GetNbRelevantPixels();
+        MeasurementType meanPerBand = statsEstimator->GetMean();
+
+        for(unsigned int itBand = 0; itBand < nbBands; itBand++)
+          {
+          mean(itBand, imageId) = meanPerBand[itBand];
+          variance(itBand, imageId) = (statsEstimator->GetCovariance())( itBand, itBand );
+          nbSamples(itBand, imageId) = nbRelevantPixels[itBand];
+          }
         }
       }
 
@@ -204,6 +288,44 @@ private:
       stddev[i] = vcl_sqrt(totalVariancePerBand[i]);
       }
 
+    // Confidence intervals of the sampled estimates: images are independent
+    // strata, weighted as in the pooled estimates
+    MeasurementType meanHalfWidth;
+    meanHalfWidth.SetSize(nbBands);
+    meanHalfWidth.Fill(itk::NumericTraits<MeasurementType::ValueType>::Zero);
+    MeasurementType stddevHalfWidth;
+    stddevHalfWidth.SetSize(nbBands);
+    stddevHalfWidth.Fill(itk::NumericTraits<MeasurementType::ValueType>::Zero);
+    if (sampled)
+      {
+      const double confidence = GetParameterFloat("sampling.blocks.confidence");
+      const double z = itk::Statistics::GaussianDistribution::InverseCDF(0.5 + 0.5 * confidence);
+      for(unsigned int itBand = 0; itBand < nbBands; itBand++)
+        {
+        const ValueType nbSample = totalSamplesPerBand[itBand];
+        ValueType meanVariance = itk::NumericTraits<ValueType>::Zero;
+        ValueType varianceVariance = itk::NumericTraits<ValueType>::Zero;
+        for (unsigned int imageId = 0; imageId < nbImages; ++imageId)
+          {
+          if (nbSample > nbImages)
+            {
+            const ValueType meanWeight = nbSamples(itBand, imageId) / nbSample;
+            const ValueType varianceWeight = (nbSamples(itBand, imageId) - 1) / (nbSample - nbImages);
+            meanVariance += meanWeight * meanWeight * meanError(itBand, imageId) * meanError(itBand, imageId);
+            varianceVariance += varianceWeight * varianceWeight * varianceError(itBand, imageId) * varianceError(itBand, imageId);
+            }
+          }
+        meanHalfWidth[itBand] = z * vcl_sqrt(meanVariance);
+        if (stddev[itBand] > 0)
+          {
+          stddevHalfWidth[itBand] = z * vcl_sqrt(varianceVariance) / (2 * stddev[itBand]);
+          }
+        otbAppLogINFO("Band " << itBand + 1 << ": mean = " << totalMeanPerBand[itBand] << " +/- " << meanHalfWidth[itBand]
+                      << ", standard deviation = " << stddev[itBand] << " +/- " << stddevHalfWidth[itBand]
+                      << " (confidence level " << confidence << ")");
+        }
+      }
+
     if( HasValue( "out" ) )
       {
       // Write the Statistics via the statistic writer
@@ -212,6 +334,11 @@ private:
       writer->SetFileName(GetParameterString("out"));
       writer->AddInput("mean", totalMeanPerBand);
       writer->AddInput("stddev", stddev);
+      if (sampled)
+        {
+        writer->AddInput("meanhalfwidth", meanHalfWidth);
+        writer->AddInput("stddevhalfwidth", stddevHalfWidth);
+        }
       writer->Update();
       }
     else
@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "otbWrapperApplication.h"
+#include "otbWrapperApplicationFactory.h"
+
+#include "otbConfigure.h"
+#include "otbMachineLearningModelFactory.h"
+#include "otbFlatRandomForestMachineLearningModel.h"
+
+#ifdef OTB_USE_OPENCV
+#include "otbRandomForestsMachineLearningModel.h"
+#endif
+#ifdef OTB_USE_SHARK
+#include "otbSharkRandomForestsMachineLearningModel.h"
+#endif
+
+namespace otb
+{
+namespace Wrapper
+{
+
+class ConvertClassifierModel : public Application
+{
+public:
+  /** Standard class typedefs. */
+  typedef ConvertClassifierModel        Self;
+  typedef Application                   Superclass;
+  typedef itk::SmartPointer<Self>       Pointer;
+  typedef itk::SmartPointer<const Self> ConstPointer;
+
+  /** Standard macro */
+  itkNewMacro(Self);
+
+  itkTypeMacro(ConvertClassifierModel, otb::Application);
+
+  /** Model typedefs, same as in ImageClassifier */
+  typedef FloatVectorImageType::InternalPixelType                      ValueType;
+  typedef UInt16ImageType::PixelType                                   LabelType;
+  typedef otb::MachineLearningModel<ValueType, LabelType>              ModelType;
+  typedef otb::MachineLearningModelFactory<ValueType, LabelType>       MachineLearningModelFactoryType;
+  typedef otb::FlatRandomForestMachineLearningModel<ValueType, LabelType> FlatModelType;
+#ifdef OTB_USE_OPENCV
+  typedef otb::RandomForestsMachineLearningModel<ValueType, LabelType> OpenCVRFModelType;
+#endif
+#ifdef OTB_USE_SHARK
+  typedef otb::SharkRandomForestsMachineLearningModel<ValueType, LabelType> SharkRFModelType;
+#endif
+
+protected:
+
+  ~ConvertClassifierModel() ITK_OVERRIDE
+    {
+    MachineLearningModelFactoryType::CleanFactories();
+    }
+
+private:
+  void DoInit() ITK_OVERRIDE
+  {
+    SetName("ConvertClassifierModel");
+    SetDescription("Converts a random forest model to the binary flat forest format, which loads instantly.");
+
+    // Documentation
+    SetDocName("Classifier Model Conversion");
+    SetDocLongDescription("This application converts a random forest model file produced by the TrainImagesClassifier or TrainVectorClassifier applications (OpenCV or Shark random forest) to the binary flat forest format. "
+      "A flat forest file holds the trees as raw arrays: it is memory mapped instead of being parsed when it is loaded, so that loading takes almost no time whatever the size of the forest, and processes classifying with the same model share its memory. "
+      "The converted model can be used by the ImageClassifier and VectorClassifier applications like any other model file: it is recognized by its content. Labels and confidence values are the same as the ones of the original model.");
+    SetDocLimitations("Only classification random forests can be converted (OpenCV random forests with categorical splits and regression forests are not supported). "
+      "The binary file uses the byte order of the machine which produced it and can't be loaded on a machine with a different byte order.");
+    SetDocAuthors("OTB-Team");
+    SetDocSeeAlso("TrainImagesClassifier, ImageClassifier");
+
+    AddDocTag(Tags::Learning);
+
+    AddParameter(ParameterType_InputFilename, "in", "Input model file");
+    SetParameterDescription("in", "A random forest model file (produced by TrainImagesClassifier application).");
+
+    AddParameter(ParameterType_OutputFilename, "out", "Output model file");
+    SetParameterDescription("out", "Output flat forest model file.");
+
+    // Doc example parameter settings
+    SetDocExampleParameterValue("in", "clRFModelQB1.rf");
+    SetDocExampleParameterValue("out", "clRFModelQB1.frf");
+  }
+
+  void DoUpdateParameters() ITK_OVERRIDE
+  {
+    // Nothing to do here : all parameters are independent
+  }
+
+  void DoExecute() ITK_OVERRIDE
+  {
+    otbAppLogINFO("Loading model");
+    ModelType::Pointer model = MachineLearningModelFactoryType::CreateMachineLearningModel(GetParameterString("in"),
+                                                                                           MachineLearningModelFactoryType::ReadMode);
+    if (model.IsNull())
+      {
+      otbAppLogFATAL(<< "Error when loading model " << GetParameterString("in") << " : unsupported model type");
+      }
+    model->Load(GetParameterString("in"));
+
+    FlatModelType::Pointer flatModel = FlatModelType::New();
+    bool converted = false;
+#ifdef OTB_USE_OPENCV
+    if (OpenCVRFModelType * rf = dynamic_cast<OpenCVRFModelType *>(model.GetPointer()))
+      {
+      flatModel->SetFlatForest(rf->GetFlatForest());
+      converted = true;
+      }
+#endif
+#ifdef OTB_USE_SHARK
+    if (SharkRFModelType * sharkRF = dynamic_cast<SharkRFModelType *>(model.GetPointer()))
+      {
+      flatModel->SetFlatForest(sharkRF->GetFlatForest());
+      converted = true;
+      }
+#endif
+    if (FlatModelType * flat = dynamic_cast<FlatModelType *>(model.GetPointer()))
+      {
+      flatModel->SetFlatForest(flat->GetFlatForest());
+      converted = true;
+      }
+
+    if (!converted)
+      {
+      otbAppLogFATAL(<< "Model " << GetParameterString("in") << " (" << model->GetNameOfClass() << ") can't be converted: only random forests are supported");
+      }
+    if (flatModel->GetFlatForest().IsEmpty())
+      {
+      otbAppLogFATAL(<< "Model " << GetParameterString("in") << " can't be converted: regression forests and categorical splits are not supported");
+      }
+
+    otbAppLogINFO(<< "Writing a forest of " << flatModel->GetFlatForest().GetNumberOfTrees() << " trees and "
+                  << flatModel->GetFlatForest().GetNumberOfNodes() << " nodes");
+    flatModel->Save(GetParameterString("out"));
+  }
+};
+
+}
+}
+
+OTB_APPLICATION_EXPORT(otb::Wrapper::ConvertClassifierModel)
@@ -30,6 +30,10 @@
 #include "otbImageToVectorImageCastFilter.h"
 #include "otbMachineLearningModelFactory.h"
 
+#ifdef OTB_USE_LIBSVM
+#include "otbLibSVMMachineLearningModel.h"
+#endif
+
 namespace otb
 {
 namespace Wrapper
@@ -63,6 +67,9 @@ public:
   typedef ClassificationFilterType::LabelType                                                  LabelType;
   typedef otb::MachineLearningModelFactory<ValueType, LabelType>                               MachineLearningModelFactoryType;
   typedef ClassificationFilterType::ConfidenceImageType                                        ConfidenceImageType;
+#ifdef OTB_USE_LIBSVM
+  typedef otb::LibSVMMachineLearningModel<ValueType, LabelType>                                LibSVMType;
+#endif
 
 protected:
 
@@ -120,6 +127,10 @@ private:
     SetDefaultOutputPixelType( "confmap", ImagePixelType_double);
     MandatoryOff("confmap");
 
+    AddParameter(ParameterType_Empty, "fastsvm", "Fast LibSVM prediction");
+    SetParameterDescription("fastsvm", "Evaluate LibSVM models with a linear kernel with precomputed primal weights instead of the support vectors, by blocks of pixels. Much faster with many support vectors, but labels may differ from the exact prediction when rounding errors break ties between classes. Other models ignore this parameter.");
+    MandatoryOff("fastsvm");
+
     AddRAMParameter();
 
    // Doc example parameter settings
@@ -153,6 +164,17 @@ private:
     m_Model->Load(GetParameterString("model"));
     otbAppLogINFO("Model loaded");
 
+#ifdef OTB_USE_LIBSVM
+    if (IsParameterEnabled("fastsvm"))
+      {
+      if (LibSVMType * svm = dynamic_cast<LibSVMType *>(m_Model.GetPointer()))
+        {
+        otbAppLogINFO("Fast LibSVM prediction activated.");
+        svm->FastPredictionOn();
+        }
+      }
+#endif
+
     // Normalize input image (optional)
     StatisticsReader::Pointer  statisticsReader = StatisticsReader::New();
     MeasurementType  meanMeasurementVector;
@@ -31,6 +31,10 @@
 #include "otbStreamingShrinkImageFilter.h"
 #include "otbChangeLabelImageFilter.h"
 #include "otbRAMDrivenStrippedStreamingManager.h"
+#include "otbStreamingMiniBatchKMeansImageFilter.h"
+#ifdef OTB_USE_SHARK
+#include "otbSharkKMeansMachineLearningModel.h"
+#endif
 
 #include "otbChangeLabelImageFilter.h"
 #include "itkLabelToRGBImageFilter.h"
@@ -123,6 +127,10 @@ typedef itk::Statistics::WeightedCentroidKdTreeGenerator<ListSampleType> TreeGen
 typedef TreeGeneratorType::KdTreeType TreeType;
 typedef itk::Statistics::KdTreeBasedKmeansEstimator<TreeType> EstimatorType;
 typedef RAMDrivenStrippedStreamingManager<FloatVectorImageType> RAMDrivenStrippedStreamingManagerType;
+typedef otb::StreamingMiniBatchKMeansImageFilter<FloatVectorImageType, UInt8ImageType> MiniBatchKMeansFilterType;
+#ifdef OTB_USE_SHARK
+typedef otb::SharkKMeansMachineLearningModel<float, unsigned int> SharkKMeansModelType;
+#endif
 
 
 typedef itk::ImageRegionConstIterator<FloatVectorImageType> IteratorType;
@@ -193,14 +201,29 @@ private:
     SetParameterDescription("vm", "Validity mask. Only non-zero pixels will be used to estimate KMeans modes.");
     MandatoryOff("vm");
     AddParameter(ParameterType_Int, "ts", "Training set size");
-    SetParameterDescription("ts", "Size of the training set (in pixels).");
+    SetParameterDescription("ts", "Size of the training set (in pixels). With the mini-batch method, "
+                            "number of pixels drawn at each epoch and size of the sample used to seed the centroids.");
     SetDefaultParameterInt("ts", 100);
     MandatoryOff("ts");
     AddParameter(ParameterType_Int, "nc", "Number of classes");
     SetParameterDescription("nc", "Number of modes, which will be used to generate class membership.");
     SetDefaultParameterInt("nc", 5);
+    AddParameter(ParameterType_Choice, "method", "Learning method");
+    SetParameterDescription("method", "KMeans algorithm used to estimate the centroids.");
+    AddChoice("method.lloyd", "Lloyd");
+    SetParameterDescription("method.lloyd", "Lloyd iterations on a subsampled copy of the image held in memory. "
+                            "The training set size is limited by the available RAM.");
+    AddChoice("method.minibatch", "Mini-batch");
+    SetParameterDescription("method.minibatch", "Mini-batch KMeans streaming the whole image at each epoch, "
+                            "with a k-means++ seeding. Each streamed region provides a mini-batch. "
+                            "The memory footprint does not depend on the image size.");
+    AddParameter(ParameterType_Int, "method.minibatch.epochs", "Maximum number of epochs");
+    SetParameterDescription("method.minibatch.epochs", "Maximum number of passes over the image.");
+    SetDefaultParameterInt("method.minibatch.epochs", 10);
+    SetMinimumParameterIntValue("method.minibatch.epochs", 1);
+    MandatoryOff("method.minibatch.epochs");
     AddParameter(ParameterType_Int, "maxit", "Maximum number of iterations");
-    SetParameterDescription("maxit", "Maximum number of iterations for the learning step.");
+    SetParameterDescription("maxit", "Maximum number of iterations for the learning step (Lloyd method).");
     SetDefaultParameterInt("maxit", 1000);
     MandatoryOff("maxit");
     AddParameter(ParameterType_Float, "ct", "Convergence threshold");
@@ -210,6 +233,11 @@ private:
     AddParameter(ParameterType_OutputFilename, "outmeans", "Centroid filename");
     SetParameterDescription("outmeans", "Output text file containing centroid positions");
     MandatoryOff("outmeans");
+#ifdef OTB_USE_SHARK
+    AddParameter(ParameterType_OutputFilename, "outmodel", "Output model");
+    SetParameterDescription("outmodel", "Output Shark KMeans model file, which can be used by the ImageClassifier application.");
+    MandatoryOff("outmodel");
+#endif
 
     AddRANDParameter();
 
@@ -225,7 +253,7 @@ private:
   void DoUpdateParameters() ITK_OVERRIDE
   {
     // test of input image //
-    if (HasValue("in"))
+    if (HasValue("in") && GetParameterString("method") == "lloyd")
       {
       // input image
       FloatVectorImageType::Pointer inImage = GetParameterImage("in");
@@ -265,7 +293,6 @@ private:
 
     std::ostringstream message("");
 
-    int nbsamples = GetParameterInt("ts");
     const unsigned int nbClasses = GetParameterInt("nc");
 
     /*******************************************/
@@ -290,6 +317,112 @@ private:
         }
       }
 
+    // Sample dimension
+    const unsigned int nbComp = m_InImage->GetNumberOfComponentsPerPixel();
+    const unsigned int sampleSize = nbComp;
+
+    EstimatorType::ParametersType estimatedMeans(nbComp * nbClasses);
+    if (GetParameterString("method") == "minibatch")
+      {
+      EstimateMeansMiniBatch(maskImage, estimatedMeans);
+      }
+    else if (!EstimateMeansLloyd(maskImage, estimatedMeans))
+      {
+      return;
+      }
+
+    message.str("");
+    message << "Estimated centroids are: " << std::endl;
+    message << std::endl;
+    for (unsigned int i = 0; i < nbClasses; i++)
+      {
+      message << "Class " << i << ": ";
+      for (unsigned int j = 0; j < sampleSize; j++)
+        {
+        message << std::setw(8) << estimatedMeans[i * sampleSize + j] << "   ";
+        }
+      message << std::endl;
+      }
+
+    message << std::endl;
+    message << "Learning completed." << std::endl;
+    message << std::endl;
+    GetLogger()->Info(message.str());
+
+    /*******************************************/
+    /*           Classification                */
+    /*******************************************/
+    otbAppLogINFO("-- CLASSIFICATION --" << std::endl);
+
+    // Finally, update the KMeans filter
+    KMeansFunctorType functor;
+
+    for (unsigned int classIndex = 0; classIndex < nbClasses; ++classIndex)
+      {
+      SampleType centroid(sampleSize);
+
+      for (unsigned int compIndex = 0; compIndex < sampleSize; ++compIndex)
+        {
+        centroid[compIndex] = estimatedMeans[compIndex + classIndex * sampleSize];
+        }
+      functor.AddCentroid(classIndex, centroid);
+      }
+
+    m_KMeansFilter = KMeansFilterType::New();
+    m_KMeansFilter->SetFunctor(functor);
+    m_KMeansFilter->SetInput(m_InImage);
+
+    // optional saving option -> lut
+
+    if (IsParameterEnabled("outmeans"))
+      {
+      std::ofstream file;
+      file.open(GetParameterString("outmeans").c_str());
+      for (unsigned int i = 0; i < nbClasses; i++)
+        {
+
+        for (unsigned int j = 0; j < sampleSize; j++)
+          {
+          file << std::setw(8) << estimatedMeans[i * sampleSize + j] << " ";
+          }
+        file << std::endl;
+        }
+
+      file.close();
+      }
+
+#ifdef OTB_USE_SHARK
+    if (IsParameterEnabled("outmodel"))
+      {
+      std::vector<SharkKMeansModelType::InputSampleType> centroids(nbClasses);
+      for (unsigned int i = 0; i < nbClasses; i++)
+        {
+        centroids[i].SetSize(sampleSize);
+        for (unsigned int j = 0; j < sampleSize; j++)
+          {
+          centroids[i][j] = estimatedMeans[i * sampleSize + j];
+          }
+        }
+      SharkKMeansModelType::Pointer model = SharkKMeansModelType::New();
+      model->SetCentroids(centroids);
+      model->Save(GetParameterString("outmodel"));
+      }
+#endif
+
+    SetParameterOutputImage("out", m_KMeansFilter->GetOutput());
+
+  }
+
+  /** Estimate the centroids with the Lloyd algorithm on a subsampled
+   *  copy of the image held in memory */
+  bool EstimateMeansLloyd(UInt8ImageType * maskImage, EstimatorType::ParametersType & estimatedMeans)
+  {
+    std::ostringstream message("");
+
+    int nbsamples = GetParameterInt("ts");
+    const unsigned int nbClasses = GetParameterInt("nc");
+    const bool maskFlag = (maskImage != ITK_NULLPTR);
+
     // Training sample lists
     ListSampleType::Pointer sampleList = ListSampleType::New();
     sampleList->SetMeasurementVectorSize(m_InImage->GetNumberOfComponentsPerPixel());
@@ -363,7 +496,7 @@ private:
       if (m_MaskIt.IsAtEnd())
         {
         GetLogger()->Error("The mask image is empty after subsampling. Please increase the training set size.");
-        return;
+        return false;
         }
       }
 
@@ -465,75 +598,63 @@ private:
     estimator->SetCentroidPositionChangesThreshold(GetParameterFloat("ct"));
     estimator->StartOptimization();
 
-    EstimatorType::ParametersType estimatedMeans = estimator->GetParameters();
+    estimatedMeans = estimator->GetParameters();
 
     otbAppLogINFO("Optimization completed." );
     if (estimator->GetCurrentIteration() == maxIt)
       {
       otbAppLogWARNING("The estimator reached the maximum iteration number." << std::endl);
       }
-    message.str("");
-    message << "Estimated centroids are: " << std::endl;
-    message << std::endl;
-    for (unsigned int i = 0; i < nbClasses; i++)
-      {
-      message << "Class " << i << ": ";
-      for (unsigned int j = 0; j < sampleSize; j++)
-        {
-        message << std::setw(8) << estimatedMeans[i * sampleSize + j] << "   ";
-        }
-      message << std::endl;
-      }
-
-    message << std::endl;
-    message << "Learning completed." << std::endl;
-    message << std::endl;
-    GetLogger()->Info(message.str());
-
-    /*******************************************/
-    /*           Classification                */
-    /*******************************************/
-    otbAppLogINFO("-- CLASSIFICATION --" << std::endl);
+    return true;
+  }
 
-    // Finally, update the KMeans filter
-    KMeansFunctorType functor;
+  /** Estimate the centroids with a streaming mini-batch KMeans */
+  void EstimateMeansMiniBatch(UInt8ImageType * maskImage, EstimatorType::ParametersType & estimatedMeans)
+  {
+    const unsigned int nbClasses = GetParameterInt("nc");
+    const unsigned int nbComp = m_InImage->GetNumberOfComponentsPerPixel();
+    const double nbPixels = static_cast<double>(m_InImage->GetLargestPossibleRegion().GetNumberOfPixels());
+    const double nbSamples = static_cast<double>(GetParameterInt("ts"));
 
-    for (unsigned int classIndex = 0; classIndex < nbClasses; ++classIndex)
+    MiniBatchKMeansFilterType::Pointer kmeans = MiniBatchKMeansFilterType::New();
+    kmeans->SetInput(m_InImage);
+    if (maskImage)
       {
-      SampleType centroid(sampleSize);
-
-      for (unsigned int compIndex = 0; compIndex < sampleSize; ++compIndex)
-        {
-        centroid[compIndex] = estimatedMeans[compIndex + classIndex * sampleSize];
-        }
-      functor.AddCentroid(classIndex, centroid);
+      kmeans->SetMaskImage(maskImage);
+      }
+    kmeans->GetFilter()->SetNumberOfClusters(nbClasses);
+    kmeans->GetFilter()->SetSamplingRate(std::min(1.0, nbSamples / nbPixels));
+    kmeans->GetFilter()->SetSeedingSampleSize(GetParameterInt("ts"));
+    if (HasValue("rand"))
+      {
+      kmeans->GetFilter()->SetSeed(GetParameterInt("rand"));
+      }
+    const unsigned int maxEpochs = GetParameterInt("method.minibatch.epochs");
+    kmeans->SetMaximumNumberOfEpochs(maxEpochs);
+    kmeans->SetConvergenceThreshold(GetParameterFloat("ct"));
+    kmeans->GetStreamer()->SetAutomaticStrippedStreaming(GetParameterInt("ram"));
+
+    otbAppLogINFO("Starting mini-batch optimization, drawing about "
+                  << static_cast<unsigned long>(std::min(nbSamples, nbPixels)) << " pixels per epoch." << std::endl);
+    AddProcess(kmeans->GetStreamer(), "Mini-batch KMeans");
+    kmeans->Update();
+
+    otbAppLogINFO("Optimization completed after " << kmeans->GetFilter()->GetNumberOfEpochs()
+                  << " epochs, mean squared distance to the centroids: " << kmeans->GetFilter()->GetInertia());
+    if (kmeans->GetFilter()->GetNumberOfEpochs() == maxEpochs
+        && kmeans->GetFilter()->GetCentroidShift() > GetParameterFloat("ct"))
+      {
+      otbAppLogWARNING("The estimator reached the maximum number of epochs." << std::endl);
       }
 
-    m_KMeansFilter = KMeansFilterType::New();
-    m_KMeansFilter->SetFunctor(functor);
-    m_KMeansFilter->SetInput(m_InImage);
-
-    // optional saving option -> lut
-
-    if (IsParameterEnabled("outmeans"))
+    std::vector<MiniBatchKMeansFilterType::CentroidType> centroids = kmeans->GetCentroids();
+    for (unsigned int i = 0; i < nbClasses; ++i)
       {
-      std::ofstream file;
-      file.open(GetParameterString("outmeans").c_str());
-      for (unsigned int i = 0; i < nbClasses; i++)
+      for (unsigned int j = 0; j < nbComp; ++j)
         {
-
-        for (unsigned int j = 0; j < sampleSize; j++)
-          {
-          file << std::setw(8) << estimatedMeans[i * sampleSize + j] << " ";
-          }
-        file << std::endl;
+        estimatedMeans[i * nbComp + j] = centroids[i][j];
         }
-
-      file.close();
       }
-
-    SetParameterOutputImage("out", m_KMeansFilter->GetOutput());
-
   }
 
   // KMeans filter
@@ -146,6 +146,10 @@ private:
     SetParameterDescription("iv", "Maximum initial neuron weight");
     MandatoryOff("iv");
 
+    AddParameter(ParameterType_Empty, "batch", "BatchTraining");
+    SetParameterDescription("batch", "Use the batch training : at each iteration, the winners of all the samples are searched in parallel, then the neurons are updated at once. Faster on large training sets, but the resulting map differs from the sequential training.");
+    MandatoryOff("batch");
+
     AddRAMParameter();
     // TODO : replace StreamingLines by RAM param ?
 
@@ -360,6 +364,7 @@ private:
       estimator->SetBetaInit(GetParameterFloat("bi"));
       estimator->SetBetaEnd(GetParameterFloat("bf"));
       estimator->SetMaxWeight(GetParameterFloat("iv"));
+      estimator->SetBatchMode(IsParameterEnabled("batch"));
 
     AddProcess(estimator,"Learning");
     estimator->Update();
@@ -42,6 +42,14 @@ namespace Wrapper
     SetParameterInt("classifier.knn.k",32, false);
     SetParameterDescription("classifier.knn.k","The number of neighbors to use.");
 
+    //Recall target of the k-d tree search
+    AddParameter(ParameterType_Float, "classifier.knn.recall", "Recall target of the neighbors search");
+    SetParameterFloat("classifier.knn.recall",1.0, false);
+    SetParameterDescription("classifier.knn.recall","Neighbors are searched with a k-d tree. With a value of 1, "
+        "the search is exact. Below 1, the search is approximate and faster: the number of tree leaves "
+        "visited per sample is bounded so that the average fraction of true neighbors found, estimated on "
+        "training samples, reaches this value.");
+
     if (this->m_RegressionFlag)
       {
       // Decision rule : mean / median
@@ -69,6 +77,7 @@ namespace Wrapper
     knnClassifier->SetInputListSample(trainingListSample);
     knnClassifier->SetTargetListSample(trainingLabeledListSample);
     knnClassifier->SetK(GetParameterInt("classifier.knn.k"));
+    knnClassifier->SetRecallTarget(GetParameterFloat("classifier.knn.recall"));
     if (this->m_RegressionFlag)
       {
       std::string decision = this->GetParameterString("classifier.knn.rule");
@@ -65,6 +65,17 @@ namespace Wrapper
     AddParameter(ParameterType_Empty, "classifier.libsvm.opt", "Parameters optimization");
     MandatoryOff("classifier.libsvm.opt");
     SetParameterDescription("classifier.libsvm.opt", "SVM parameters optimization flag.");
+    AddParameter(ParameterType_Empty, "classifier.libsvm.optpar", "Parallel parameters optimization");
+    MandatoryOff("classifier.libsvm.optpar");
+    SetParameterDescription("classifier.libsvm.optpar",
+        "Evaluate the parameters of the optimization concurrently, on cross-validation folds drawn once "
+        "with a fixed seed. Parameters which can not beat the best accuracy already found are abandoned early.");
+    AddParameter(ParameterType_Int, "classifier.libsvm.optram", "Parallel optimization memory budget");
+    SetParameterInt("classifier.libsvm.optram", 0, false);
+    MandatoryOff("classifier.libsvm.optram");
+    SetParameterDescription("classifier.libsvm.optram",
+        "Memory (in MB) available for the concurrent trainings of the parallel parameters optimization "
+        "(0 means no limit other than the number of threads).");
     AddParameter(ParameterType_Empty, "classifier.libsvm.prob", "Probability estimation");
     MandatoryOff("classifier.libsvm.prob");
     SetParameterDescription("classifier.libsvm.prob", "Probability estimation flag.");
@@ -96,6 +107,12 @@ namespace Wrapper
       {
       libSVMClassifier->SetParameterOptimization(true);
       }
+    if (IsParameterEnabled("classifier.libsvm.optpar"))
+      {
+      libSVMClassifier->SetParallelOptimization(true);
+      libSVMClassifier->SetOptimizationMaximumMemory(
+        static_cast<unsigned int>(std::max(0, GetParameterInt("classifier.libsvm.optram"))));
+      }
     if (IsParameterEnabled("classifier.libsvm.prob"))
       {
       libSVMClassifier->SetDoProbabilityEstimates(true);
@@ -618,46 +618,33 @@ private:
       AddProcess(m_StatisticsMapFromLabelImageFilter->GetStreamer(), "Computing statistics on labels...");
       m_StatisticsMapFromLabelImageFilter->Update();
 
-      StreamingStatisticsMapFromLabelImageFilterType::MeanValueMapType
-          labelToMeanIntensityMap = m_StatisticsMapFromLabelImageFilter->GetMeanValueMap();
+      const StreamingStatisticsMapFromLabelImageFilterType::LabelVectorType &
+          labels = m_StatisticsMapFromLabelImageFilter->GetLabels();
 
       m_RBGFromImageMapper = ChangeLabelFilterType::New();
       m_RBGFromImageMapper->SetInput(m_CasterToLabelImage->GetOutput());
       m_RBGFromImageMapper->SetNumberOfComponentsPerPixel(3);
 
-      StreamingStatisticsMapFromLabelImageFilterType::MeanValueMapType::const_iterator
-          mapIt = labelToMeanIntensityMap.begin();
-      FloatVectorImageType::PixelType meanValue;
-
-      otbAppLogINFO("The map contains :"<<labelToMeanIntensityMap.size()<<" labels."<<std::endl);
+      otbAppLogINFO("The map contains :"<<labels.size()<<" labels."<<std::endl);
       VectorPixelType color(3);
 
-      for (mapIt = labelToMeanIntensityMap.begin();
-           mapIt != labelToMeanIntensityMap.end();
-           ++mapIt)
+      for (size_t labelIndex = 0; labelIndex < labels.size(); ++labelIndex)
         {
-        LabelType clabel = mapIt->first;
-        meanValue = mapIt->second; //meanValue.Size() is null if label is not present in label image
-        if (meanValue.Size() != supportImage->GetNumberOfComponentsPerPixel())
-          {
-          color.Fill(0.0);
-          }
-        else
+        LabelType clabel = labels[labelIndex];
+        for (int RGB = 0; RGB < 3; RGB++)
           {
-          for (int RGB = 0; RGB < 3; RGB++)
-            {
-            unsigned int dispIndex = RGBIndex[RGB];
+          unsigned int dispIndex = RGBIndex[RGB];
+          const double meanValue = m_StatisticsMapFromLabelImageFilter->GetMeanColumn(dispIndex)[labelIndex];
 
-            // Convert the radiometric value to [0, 255]
-            // using the clamping from histogram cut
-            // Since an UInt8 output value is expected, the rounding instruction is used (floor(x+0.5) as rounding method)
-            double val = vcl_floor((255 * (meanValue[dispIndex] - minVal[dispIndex])
-                                   / (maxVal[dispIndex] - minVal[dispIndex])) + 0.5);
+          // Convert the radiometric value to [0, 255]
+          // using the clamping from histogram cut
+          // Since an UInt8 output value is expected, the rounding instruction is used (floor(x+0.5) as rounding method)
+          double val = vcl_floor((255 * (meanValue - minVal[dispIndex])
+                                 / (maxVal[dispIndex] - minVal[dispIndex])) + 0.5);
 
-            val = val < 0.0 ? 0.0 : ( val > 255.0 ? 255.0 : val );
+          val = val < 0.0 ? 0.0 : ( val > 255.0 ? 255.0 : val );
 
-            color[RGB] = static_cast<VectorPixelType::ValueType>(val);
-            }
+          color[RGB] = static_cast<VectorPixelType::ValueType>(val);
           }
         otbMsgDevMacro(<<"Adding color mapping " << clabel << " -> [" << (int) color[0] << " " << (int) color[1] << " "<< (int) color[2] << " ]");
         m_RBGFromImageMapper->SetChange(clabel, color);
@@ -23,6 +23,7 @@
 
 #include "otbMultiToMonoChannelExtractROI.h"
 #include "otbStreamingCompareImageFilter.h"
+#include <fstream>
 
 namespace otb
 {
@@ -56,7 +57,9 @@ private:
 
     // Documentation
     SetDocName("Images comparison");
-    SetDocLongDescription("This application computes MSE (Mean Squared Error), MAE (Mean Absolute Error) and PSNR (Peak Signal to Noise Ratio) between the channel of two images (reference and measurement). The user has to set the used channel and can specify a ROI.");
+    SetDocLongDescription("This application computes MSE (Mean Squared Error), MAE (Mean Absolute Error) and PSNR (Peak Signal to Noise Ratio) between the channel of two images (reference and measurement). The user has to set the used channel and can specify a ROI. "
+      "Lines with identical raw values in both images are skipped by the detailed metrics computation. "
+      "The images can be compared by square tiles, and the list of tiles where they differ can be written to a text file.");
     SetDocLimitations("None");
     SetDocAuthors("OTB-Team");
     SetDocSeeAlso("BandMath application, ImageStatistics");
@@ -103,6 +106,17 @@ private:
     SetMinimumParameterIntValue("roi.sizey",  1);
     SetParameterDescription("roi.sizey","Size along y in pixels.");
 
+    AddParameter(ParameterType_Int, "tilesize", "Tile size");
+    SetParameterDescription("tilesize", "Compare the images by square tiles of this size (in pixels). "
+                            "If not set, the images are streamed according to the available RAM.");
+    SetMinimumParameterIntValue("tilesize", 16);
+    MandatoryOff("tilesize");
+
+    AddParameter(ParameterType_OutputFilename, "difftiles", "Differing tiles");
+    SetParameterDescription("difftiles", "Text file listing the streamed tiles where the images differ: "
+                            "start x, start y, size x, size y (in reference image coordinates) and number of different pixels.");
+    MandatoryOff("difftiles");
+
     AddParameter(ParameterType_Float, "mse",  "MSE");
     SetParameterDescription("mse", "Mean Squared Error value");
     SetParameterRole("mse", Role_Output );
@@ -213,7 +227,14 @@ private:
     m_CompareFilter->SetInput1(m_ExtractRefFilter->GetOutput());
     m_CompareFilter->SetInput2(m_ExtractMeasFilter->GetOutput());
     m_CompareFilter->SetPhysicalSpaceCheck(false);
-    m_CompareFilter->GetStreamer()->SetAutomaticAdaptativeStreaming(GetParameterInt("ram"));
+    if (HasValue("tilesize"))
+      {
+      m_CompareFilter->GetStreamer()->SetTileDimensionTiledStreaming(GetParameterInt("tilesize"));
+      }
+    else
+      {
+      m_CompareFilter->GetStreamer()->SetAutomaticAdaptativeStreaming(GetParameterInt("ram"));
+      }
     AddProcess(m_CompareFilter->GetStreamer(), "Comparing...");
     m_CompareFilter->Update();
 
@@ -223,6 +244,28 @@ private:
     otbAppLogINFO( << "PSNR: " << m_CompareFilter->GetPSNR() );
     otbAppLogINFO( << "Number of Pixel different: " << m_CompareFilter->GetDiffCount() );
 
+    const StreamingCompareImageFilterType::RegionListType & diffRegions = m_CompareFilter->GetDifferingRegions();
+    const StreamingCompareImageFilterType::CountListType & diffCounts = m_CompareFilter->GetDifferingRegionsDiffCount();
+    otbAppLogINFO( << "Number of tiles different: " << diffRegions.size() << " / " << m_CompareFilter->GetNumberOfProcessedRegions() );
+
+    if (HasValue("difftiles"))
+      {
+      std::ofstream file(GetParameterString("difftiles").c_str());
+      if (!file)
+        {
+        otbAppLogFATAL( << "Unable to open " << GetParameterString("difftiles") );
+        }
+      // regions are relative to the ROI
+      for (unsigned int i = 0; i < diffRegions.size(); ++i)
+        {
+        file << diffRegions[i].GetIndex(0) + region.GetIndex(0) << " "
+             << diffRegions[i].GetIndex(1) + region.GetIndex(1) << " "
+             << diffRegions[i].GetSize(0) << " "
+             << diffRegions[i].GetSize(1) << " "
+             << diffCounts[i] << std::endl;
+        }
+      }
+
     SetParameterFloat( "mse",m_CompareFilter->GetMSE() , false);
     SetParameterFloat( "mae",m_CompareFilter->GetMAE() , false);
     SetParameterFloat( "psnr",m_CompareFilter->GetPSNR() , false);
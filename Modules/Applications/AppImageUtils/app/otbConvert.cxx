@@ -27,10 +27,7 @@
 #include "otbVectorRescaleIntensityImageFilter.h"
 #include "itkCastImageFilter.h"
 #include "otbUnaryImageFunctorWithVectorImageFilter.h"
-#include "otbStreamingShrinkImageFilter.h"
-#include "itkListSample.h"
-#include "otbListSampleToHistogramListGenerator.h"
-#include "itkImageRegionConstIterator.h"
+#include "otbStreamingQuantilesVectorImageFilter.h"
 
 
 namespace otb
@@ -69,10 +66,7 @@ public:
   itkTypeMacro(Convert, otb::Application);
 
   /** Filters typedef */
-  typedef itk::Statistics::ListSample<FloatVectorImageType::PixelType> ListSampleType;
-  typedef itk::Statistics::DenseFrequencyContainer2 DFContainerType;
-  typedef ListSampleToHistogramListGenerator<ListSampleType, FloatVectorImageType::InternalPixelType, DFContainerType> HistogramsGeneratorType;
-  typedef StreamingShrinkImageFilter<FloatVectorImageType, FloatVectorImageType> ShrinkFilterType;
+  typedef StreamingQuantilesVectorImageFilter<FloatVectorImageType, FloatVectorImageType> QuantilesFilterType;
   typedef Functor::LogFunctor<FloatVectorImageType::InternalPixelType> TransferLogFunctor;
   typedef UnaryImageFunctorWithVectorImageFilter<FloatVectorImageType, FloatVectorImageType, TransferLogFunctor> TransferLogType;
 
@@ -188,23 +182,19 @@ private:
       rescaler->SetOutputMinimum(minimum);
       rescaler->SetOutputMaximum(maximum);
 
-      // We need to subsample the input image in order to estimate its
-      // histogram
-
-      typename ShrinkFilterType::Pointer shrinkFilter = ShrinkFilterType::New();
-
-      // Shrink factor is computed so as to load a quicklook of 1000
-      // pixels square at most
+      // The quantiles are estimated in a single streaming pass, on a
+      // subsampled grid of 1000 pixels square at most
       typename FloatVectorImageType::SizeType imageSize = input->GetLargestPossibleRegion().GetSize();
-      unsigned int shrinkFactor = std::max(imageSize[0], imageSize[1]) < 1000 ? 1 : std::max(imageSize[0], imageSize[1])/1000;
-
-      otbAppLogDEBUG( << "Shrink factor used to compute Min/Max: "<<shrinkFactor );
+      unsigned int subsamplingRate = std::max(imageSize[0], imageSize[1]) < 1000 ? 1 : std::max(imageSize[0], imageSize[1])/1000;
 
-      otbAppLogDEBUG( << "Shrink starts..." );
+      otbAppLogDEBUG( << "Subsampling rate used to compute Min/Max: "<<subsamplingRate );
 
-      shrinkFilter->SetShrinkFactor(shrinkFactor);
-      shrinkFilter->GetStreamer()->SetAutomaticAdaptativeStreaming(GetParameterInt("ram"));
-      AddProcess(shrinkFilter->GetStreamer(), "Computing shrink Image for min/max estimation...");
+      m_QuantilesFilter = QuantilesFilterType::New();
+      m_QuantilesFilter->GetFilter()->SetSubSamplingRate(subsamplingRate);
+      m_QuantilesFilter->GetFilter()->SetAccuracyParameter(1000);
+      m_QuantilesFilter->GetFilter()->NoDataFlagOn();
+      m_QuantilesFilter->GetStreamer()->SetAutomaticAdaptativeStreaming(GetParameterInt("ram"));
+      AddProcess(m_QuantilesFilter->GetStreamer(), "Computing quantiles for min/max estimation...");
 
       if ( rescaleType == "log2")
         {
@@ -213,90 +203,42 @@ private:
         m_TransferLog->SetInput(input);
         m_TransferLog->UpdateOutputInformation();
 
-        shrinkFilter->SetInput(m_TransferLog->GetOutput());
+        m_QuantilesFilter->SetInput(m_TransferLog->GetOutput());
         rescaler->SetInput(m_TransferLog->GetOutput());
-        shrinkFilter->Update();
         }
       else
         {
-        shrinkFilter->SetInput(input);
+        m_QuantilesFilter->SetInput(input);
         rescaler->SetInput(input);
-        shrinkFilter->Update();
         }
 
-      ShrinkFilterType::Pointer maskShrinkFilter = ShrinkFilterType::New();
       if (useMask)
         {
-        maskShrinkFilter->SetShrinkFactor(shrinkFactor);
-        maskShrinkFilter->SetInput(mask);
-        maskShrinkFilter->GetStreamer()->SetAutomaticAdaptativeStreaming(GetParameterInt("ram"));
-        maskShrinkFilter->Update();
+        // float values, so the threshold is set to 0.5
+        m_QuantilesFilter->GetFilter()->SetMaskThreshold(0.5);
+        m_QuantilesFilter->SetMaskImage(mask);
         }
 
-      otbAppLogDEBUG( << "Shrink done" );
-
-
       otbAppLogDEBUG( << "Evaluating input Min/Max..." );
-      itk::ImageRegionConstIterator<FloatVectorImageType> it(shrinkFilter->GetOutput(), shrinkFilter->GetOutput()->GetLargestPossibleRegion());
-      itk::ImageRegionConstIterator<FloatVectorImageType> itMask;
-      if (useMask)
-        {
-        itMask = itk::ImageRegionConstIterator<FloatVectorImageType>(maskShrinkFilter->GetOutput(),maskShrinkFilter->GetOutput()->GetLargestPossibleRegion());
-        }
-
-      typename ListSampleType::Pointer listSample = ListSampleType::New();
-      listSample->SetMeasurementVectorSize(input->GetNumberOfComponentsPerPixel());
+      m_QuantilesFilter->Update();
 
-      // Now we generate the list of samples
-      if (useMask)
-        {
-        // Remove masked pixels
-        it.GoToBegin();
-        itMask.GoToBegin();
-        while (!it.IsAtEnd())
-          {
-          // float values, so the threshold is set to 0.5
-          if (itMask.Get()[0] < 0.5)
-            {
-            listSample->PushBack(it.Get());
-            }
-          ++it;
-          ++itMask;
-          }
-        }
-      else
+      // if all pixels were masked, we assume a wrong mask and then include all image
+      unsigned long nbValidValues = 0;
+      for(unsigned int i = 0; i < nbComp; ++i)
         {
-        for(it.GoToBegin(); !it.IsAtEnd(); ++it)
-          {
-          listSample->PushBack(it.Get());
-          }
+        nbValidValues += m_QuantilesFilter->GetSketch(i).GetCount();
         }
-
-      // if all pixels were masked, we assume a wrong mask and then include all image
-      if (listSample->Size() == 0)
+      if (useMask && nbValidValues == 0)
         {
         otbAppLogINFO( << "All pixels were masked, the application assume a wrong mask and include all the image");
-        for(it.GoToBegin(); !it.IsAtEnd(); ++it)
-          {
-          listSample->PushBack(it.Get());
-          }
+        m_QuantilesFilter->SetMaskImage(ITK_NULLPTR);
+        m_QuantilesFilter->Update();
         }
 
-      // And then the histogram
-      typename HistogramsGeneratorType::Pointer histogramsGenerator = HistogramsGeneratorType::New();
-      histogramsGenerator->SetListSample(listSample);
-      histogramsGenerator->SetNumberOfBins(255);
-      histogramsGenerator->NoDataFlagOn();
-      histogramsGenerator->Update();
-
       // And extract the lower and upper quantile
       typename FloatVectorImageType::PixelType inputMin(nbComp), inputMax(nbComp);
-
-      for(unsigned int i = 0; i < nbComp; ++i)
-        {
-        inputMin[i] = histogramsGenerator->GetOutput()->GetNthElement(i)->Quantile(0, 0.01 * GetParameterFloat("hcp.low"));
-        inputMax[i] = histogramsGenerator->GetOutput()->GetNthElement(i)->Quantile(0, 1.0 - 0.01 * GetParameterFloat("hcp.high"));
-        }
+      inputMin = m_QuantilesFilter->GetQuantile(0.01 * GetParameterFloat("hcp.low"));
+      inputMax = m_QuantilesFilter->GetQuantile(1.0 - 0.01 * GetParameterFloat("hcp.high"));
 
       otbAppLogDEBUG( << std::setprecision(5) << "Min/Max computation done : min=" << inputMin
                       << " max=" << inputMax );
@@ -352,6 +294,7 @@ private:
 
   itk::ProcessObject::Pointer m_TmpFilter;
   TransferLogType::Pointer m_TransferLog;
+  QuantilesFilterType::Pointer m_QuantilesFilter;
 };
 
 }
@@ -22,6 +22,7 @@
 #include "otbWrapperApplicationFactory.h"
 
 #include "otbStreamingMinMaxVectorImageFilter.h"
+#include "otbStreamingQuantilesVectorImageFilter.h"
 #include "otbVectorRescaleIntensityImageFilter.h"
 
 namespace otb
@@ -46,6 +47,7 @@ public:
 
   /** Filters typedef */
   typedef otb::StreamingMinMaxVectorImageFilter<FloatVectorImageType>  MinMaxFilterType;
+  typedef otb::StreamingQuantilesVectorImageFilter<FloatVectorImageType> QuantilesFilterType;
   typedef otb::VectorRescaleIntensityImageFilter<FloatVectorImageType> RescaleImageFilterType;
 
 private:
@@ -57,7 +59,9 @@ private:
     SetDocName("Rescale Image");
     SetDocLongDescription("This application scales the given image pixel intensity between two given values.\n"
                                   "By default min (resp. max) value is set to 0 (resp. 255).\n"
-                                  "Input minimum and maximum values is automatically computed for all image bands.");
+                                  "Input minimum and maximum values is automatically computed for all image bands.\n"
+                                  "Optionally, low and high quantiles can be cut before computing the input minimum and maximum. "
+                                  "They are then estimated in the same single pass over the image.");
     SetDocLimitations("None");
     SetDocAuthors("OTB-Team");
     SetDocSeeAlso(" ");
@@ -81,6 +85,19 @@ private:
     MandatoryOff("outmin");
     MandatoryOff("outmax");
 
+    AddParameter(ParameterType_Group,"hcp","Histogram Cutting Parameters");
+    SetParameterDescription("hcp","Parameters to cut the histogram edges before rescaling");
+
+    AddParameter(ParameterType_Float, "hcp.high", "High Cut Quantile");
+    SetParameterDescription("hcp.high", "Quantiles to cut from histogram high values before computing min/max rescaling (in percent, 0 by default)");
+    MandatoryOff("hcp.high");
+    SetDefaultParameterFloat("hcp.high", 0.0);
+
+    AddParameter(ParameterType_Float, "hcp.low", "Low Cut Quantile");
+    SetParameterDescription("hcp.low", "Quantiles to cut from histogram low values before computing min/max rescaling (in percent, 0 by default)");
+    MandatoryOff("hcp.low");
+    SetDefaultParameterFloat("hcp.low", 0.0);
+
     // Doc example parameter settings
     SetDocExampleParameterValue("in", "QB_Toulouse_Ortho_PAN.tif");
     SetDocExampleParameterValue("out", "rescaledImage.png uchar");
@@ -97,25 +114,49 @@ private:
   {
     FloatVectorImageType::Pointer inImage = GetParameterImage("in");
 
-    otbAppLogDEBUG( << "Starting Min/Max computation" )
+    FloatVectorImageType::PixelType inMin, inMax;
 
-    m_MinMaxFilter = MinMaxFilterType::New();
-    m_MinMaxFilter->SetInput( inImage );
-    m_MinMaxFilter->GetStreamer()->SetAutomaticAdaptativeStreaming(GetParameterInt("ram"));
+    const double lowCut = 0.01 * GetParameterFloat("hcp.low");
+    const double highCut = 0.01 * GetParameterFloat("hcp.high");
 
-    AddProcess(m_MinMaxFilter->GetStreamer(), "Min/Max computing");
-    m_MinMaxFilter->Update();
+    if (lowCut > 0.0 || highCut > 0.0)
+      {
+      otbAppLogDEBUG( << "Starting quantiles computation" )
 
-    otbAppLogDEBUG( << "Min/Max computation done : min=" << m_MinMaxFilter->GetMinimum()
-                    << " max=" << m_MinMaxFilter->GetMaximum() )
+      m_QuantilesFilter = QuantilesFilterType::New();
+      m_QuantilesFilter->SetInput( inImage );
+      m_QuantilesFilter->GetFilter()->SetAccuracyParameter(1000);
+      m_QuantilesFilter->GetStreamer()->SetAutomaticAdaptativeStreaming(GetParameterInt("ram"));
 
-    FloatVectorImageType::PixelType inMin, inMax;
+      AddProcess(m_QuantilesFilter->GetStreamer(), "Quantiles computing");
+      m_QuantilesFilter->Update();
+
+      inMin = m_QuantilesFilter->GetQuantile( lowCut );
+      inMax = m_QuantilesFilter->GetQuantile( 1.0 - highCut );
+      }
+    else
+      {
+      otbAppLogDEBUG( << "Starting Min/Max computation" )
+
+      m_MinMaxFilter = MinMaxFilterType::New();
+      m_MinMaxFilter->SetInput( inImage );
+      m_MinMaxFilter->GetStreamer()->SetAutomaticAdaptativeStreaming(GetParameterInt("ram"));
+
+      AddProcess(m_MinMaxFilter->GetStreamer(), "Min/Max computing");
+      m_MinMaxFilter->Update();
+
+      inMin = m_MinMaxFilter->GetMinimum();
+      inMax = m_MinMaxFilter->GetMaximum();
+      }
+
+    otbAppLogDEBUG( << "Min/Max computation done : min=" << inMin
+                    << " max=" << inMax )
 
     m_RescaleFilter = RescaleImageFilterType::New();
     m_RescaleFilter->SetInput( inImage );
     m_RescaleFilter->SetAutomaticInputMinMaxComputation(false);
-    m_RescaleFilter->SetInputMinimum( m_MinMaxFilter->GetMinimum() );
-    m_RescaleFilter->SetInputMaximum( m_MinMaxFilter->GetMaximum() );
+    m_RescaleFilter->SetInputMinimum( inMin );
+    m_RescaleFilter->SetInputMaximum( inMax );
 
     FloatVectorImageType::PixelType outMin, outMax;
     outMin.SetSize( inImage->GetNumberOfComponentsPerPixel() );
@@ -132,6 +173,7 @@ private:
 
   RescaleImageFilterType::Pointer m_RescaleFilter;
   MinMaxFilterType::Pointer       m_MinMaxFilter;
+  QuantilesFilterType::Pointer    m_QuantilesFilter;
 };
 
 }
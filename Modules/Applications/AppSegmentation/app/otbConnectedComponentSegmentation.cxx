@@ -24,6 +24,9 @@
 #include "otbVectorImage.h"
 #include "otbVectorData.h"
 #include "otbStreamingConnectedComponentSegmentationOBIAToVectorDataFilter.h"
+#include "otbStreamingConnectedComponentImageFilter.h"
+#include "otbConnectedComponentLabelImageFilter.h"
+#include "otbMaskMuParserFilter.h"
 
 #include "otbVectorDataProjectionFilter.h"
 
@@ -68,6 +71,12 @@ public:
   typedef otb::VectorDataProjectionFilter
         <VectorDataType, VectorDataType>                     VectorDataProjectionFilterType;
 
+  typedef otb::MaskMuParserFilter<InputVectorImageType, MaskImageType> MaskFilterType;
+  typedef otb::StreamingConnectedComponentImageFilter
+    <InputVectorImageType, MaskImageType>                    ExactLabellingFilterType;
+  typedef otb::ConnectedComponentLabelImageFilter
+    <InputVectorImageType, LabelImageType, MaskImageType>    ExactLabelImageFilterType;
+
 private:
   void DoInit() ITK_OVERRIDE
   {
@@ -75,7 +84,7 @@ private:
     SetDescription("Connected component segmentation and object based image filtering of the input image according to user-defined criterions.");
     SetDocName("Connected Component Segmentation");
     SetDocLongDescription("This application allows one to perform a masking, connected components segmentation and object based image filtering. First and optionally, a mask can be built based on user-defined criterions to select pixels of the image which will be segmented. Then a connected component segmentation is performed with a user defined criterion to decide whether two neighbouring pixels belong to the same segment or not. After this segmentation step, an object based image filtering is applied using another user-defined criterion reasoning on segment properties, like shape or radiometric attributes. " "Criterions are mathematical expressions analysed by the MuParser library (http://muparser.sourceforge.net/). For instance, expression \"((b1>80) and intensity>95)\" will merge two neighbouring pixel in a single segment if their intensity is more than 95 and their value in the first image band is more than 80. See parameters documentation for a list of available attributes. The output of the object based image filtering is vectorized and can be written in shapefile or KML format. If the input image is in raw geometry, resulting polygons will be transformed to WGS84 using sensor modelling before writing, to ensure consistency with GIS software. For this purpose, a Digital Elevation Model can be provided to the application. The whole processing is done on a per-tile basis for large images, so this application can handle images of arbitrary size.");
-    SetDocLimitations("Due to the tiling scheme in case of large images, some segments can be arbitrarily split across multiple tiles.");
+    SetDocLimitations("Due to the tiling scheme in case of large images, some segments can be arbitrarily split across multiple tiles, unless the exact mode is enabled. In exact mode, the pieces of a segment crossing several tiles are still written as separate polygons, sharing the same label, and their attributes used by the OBIA expression are computed per piece.");
     SetDocAuthors("OTB-Team");
     SetDocSeeAlso(" ");
 
@@ -103,6 +112,10 @@ private:
     SetMinimumParameterIntValue("minsize", 1);
     MandatoryOff("minsize");
 
+    AddParameter(ParameterType_Empty, "exact", "Exact segmentation");
+    SetParameterDescription("exact", "Segment the whole image before the OBIA filtering, with an additional pass over the image. Segments crossing tiles are no longer split, and the minimum object size applies to whole segments. The pieces of a segment in different tiles share the same label.");
+    MandatoryOff("exact");
+
     AddParameter(ParameterType_String, "obia", "OBIA Expression");
     SetParameterDescription("obia", "OBIA mathematical expression");
     MandatoryOff("obia");
@@ -144,6 +157,34 @@ private:
     if (IsParameterEnabled("obia") && HasValue("obia"))
       m_Connected->GetFilter()->SetOBIAExpression(GetParameterString("obia"));
 
+    if (IsParameterEnabled("exact"))
+      {
+      // Label the whole image first, the labels are then given to each tile
+      m_ExactLabelling = ExactLabellingFilterType::New();
+      m_ExactLabelling->SetInput(inputImage);
+      m_LabelImage = ExactLabelImageFilterType::New();
+      m_LabelImage->SetInput(inputImage);
+
+      if (IsParameterEnabled("mask") && HasValue("mask"))
+        {
+        m_Mask = MaskFilterType::New();
+        m_Mask->SetInput(inputImage);
+        m_Mask->SetExpression(GetParameterString("mask"));
+        m_ExactLabelling->SetMaskImage(m_Mask->GetOutput());
+        m_LabelImage->SetMaskImage(m_Mask->GetOutput());
+        }
+
+      m_ExactLabelling->GetFilter()->SetConnectedComponentExpression(GetParameterString("expr"));
+      m_ExactLabelling->GetFilter()->SetMinimumObjectSize(GetParameterInt("minsize"));
+      m_ExactLabelling->GetStreamer()->SetAutomaticAdaptativeStreaming(GetParameterInt("ram"));
+      AddProcess(m_ExactLabelling->GetStreamer(),"Labelling connected components");
+      m_ExactLabelling->Update();
+      otbAppLogINFO(<< m_ExactLabelling->GetNumberOfObjects() << " segments found");
+
+      m_LabelImage->SetLabelling(m_ExactLabelling->GetFilter());
+      m_Connected->GetFilter()->SetInputLabelImage(m_LabelImage->GetOutput());
+      }
+
     m_Connected->GetStreamer()->SetAutomaticAdaptativeStreaming(GetParameterInt("ram"));
     AddProcess(m_Connected->GetStreamer(),"Computing segmentation");
     m_Connected->Update();
@@ -186,6 +227,9 @@ private:
   /** Members */
   SegmentationFilterType::FilterType::Pointer m_Connected;
   VectorDataProjectionFilterType::Pointer m_Vproj;
+  MaskFilterType::Pointer m_Mask;
+  ExactLabellingFilterType::Pointer m_ExactLabelling;
+  ExactLabelImageFilterType::Pointer m_LabelImage;
 
 };
 
@@ -21,7 +21,7 @@
 #include "otbWrapperApplication.h"
 #include "otbWrapperApplicationFactory.h"
 
-#include "otbHooverMatrixFilter.h"
+#include "otbStreamingHooverMatrixFilter.h"
 #include "otbHooverInstanceFilter.h"
 #include "otbLabelMapToAttributeImageFilter.h"
 
@@ -110,15 +110,15 @@ public:
 
   typedef otb::AttributesMapLabelObject<unsigned int, 2, float> LabelObjectType;
   typedef itk::LabelMap<LabelObjectType>            LabelMapType;
-  typedef otb::HooverMatrixFilter<LabelMapType>     HooverMatrixFilterType;
   typedef UInt32ImageType                           ImageType;
+  typedef otb::StreamingHooverMatrixFilter
+    <ImageType>                                     HooverMatrixFilterType;
   typedef FloatVectorImageType::PixelType           FloatPixelType;
   typedef Int16VectorImageType::PixelType           Int16PixelType;
   //typedef otb::VectorImage<float, 2>                VectorImageType;
   typedef itk::LabelImageToLabelMapFilter
     <ImageType, LabelMapType>                       ImageToLabelMapFilterType;
   typedef otb::ImageFileReader<ImageType>           ImageReaderType;
-  typedef HooverMatrixFilterType::MatrixType        MatrixType;
 
   typedef otb::HooverInstanceFilter<LabelMapType>   InstanceFilterType;
   typedef otb::LabelMapToAttributeImageFilter
@@ -148,7 +148,7 @@ private:
                           " comparison of range image segmentation algorithms\", IEEE PAMI vol. 18, no. 7, July 1996.");
     SetDocLimitations("None");
     SetDocAuthors("OTB-Team");
-    SetDocSeeAlso("otbHooverMatrixFilter, otbHooverInstanceFilter, otbLabelMapToAttributeImageFilter");
+    SetDocSeeAlso("otbStreamingHooverMatrixFilter, otbHooverInstanceFilter, otbLabelMapToAttributeImageFilter");
 
     AddDocTag(Tags::Segmentation);
 
@@ -218,17 +218,21 @@ private:
     m_MSFilter->SetInput(inputMS);
     m_MSFilter->SetBackgroundValue( GetParameterInt("bg") );
 
+    // Sparse confusion matrix, streamed over the label images
     m_HooverFilter = HooverMatrixFilterType::New();
-    m_HooverFilter->SetGroundTruthLabelMap(m_GTFilter->GetOutput());
-    m_HooverFilter->SetMachineSegmentationLabelMap(m_MSFilter->GetOutput());
-
+    m_HooverFilter->SetGroundTruthImage(inputGT);
+    m_HooverFilter->SetMachineSegmentationImage(inputMS);
+    m_HooverFilter->SetBackgroundValue( GetParameterInt("bg") );
+    m_HooverFilter->GetStreamer()->SetAutomaticAdaptativeStreaming();
+    AddProcess(m_HooverFilter->GetStreamer(), "Computing the Hoover confusion matrix");
     m_HooverFilter->Update();
+    otbAppLogINFO(<< m_HooverFilter->GetOverlapMatrix().GetNumberOfCells() << " overlapping couples of regions");
 
     m_InstanceFilter = InstanceFilterType::New();
     m_InstanceFilter->SetGroundTruthLabelMap(m_GTFilter->GetOutput());
     m_InstanceFilter->SetMachineSegmentationLabelMap(m_MSFilter->GetOutput());
     m_InstanceFilter->SetThreshold( GetParameterFloat("th") );
-    m_InstanceFilter->SetHooverMatrix( m_HooverFilter->GetHooverConfusionMatrix() );
+    m_InstanceFilter->SetHooverOverlapMatrix( m_HooverFilter->GetOverlapMatrix() );
     m_InstanceFilter->SetUseExtendedAttributes(false);
 
     m_AttributeImageGT = AttributeImageFilterType::New();
@@ -30,6 +30,8 @@
 #include "itkScalarConnectedComponentImageFilter.h"
 #include "otbConcatenateVectorImageFilter.h"
 #include "otbAffineFunctor.h"
+#include "otbTileImageFilter.h"
+#include "itkMultiThreader.h"
 
 #include "otbMultiToMonoChannelExtractROI.h"
 #include "otbImportGeoInformationImageFilter.h"
@@ -87,17 +89,114 @@ public:
     LabelImageType,
     LabelImageType,
     AffineFunctorType>                        LabelShiftFilterType;
+  typedef otb::TileImageFilter<LabelImageType> TileImageFilterType;
 
-  LSMSSegmentation(): m_FinalReader(),m_ImportGeoInformationFilter(),m_FilesToRemoveAfterExecute(),m_TmpDirCleanup(false){}
+  LSMSSegmentation(): m_FinalReader(),m_TileFilter(),m_ImportGeoInformationFilter(),m_FilesToRemoveAfterExecute(),m_TmpDirCleanup(false){}
 
   ~LSMSSegmentation() ITK_OVERRIDE{}
 
 private:
   LabelImageReaderType::Pointer m_FinalReader;
+  TileImageFilterType::Pointer m_TileFilter;
   ImportGeoInformationImageFilterType::Pointer m_ImportGeoInformationFilter;
   std::vector<std::string> m_FilesToRemoveAfterExecute;
   bool m_TmpDirCleanup;
 
+  /** Tile processed in memory */
+  struct InMemoryTile
+  {
+    CCFilterType::Pointer         Segmentation;
+    LabelImageType::Pointer       Labels;
+    LabelImageType::Pointer       FinalLabels;
+    LabelImageType::SizeType      CoreSize;
+    LabelImagePixelType           MaximumLabel;
+    LabelImagePixelType           Offset;
+    std::vector<unsigned long>    CoreCounts;
+    std::string                   Error;
+  };
+
+  /** Structure passed to the tile threads */
+  struct InMemoryTileThreadStruct
+  {
+    std::vector<InMemoryTile> *              Tiles;
+    unsigned int                             First;
+    unsigned int                             Last;
+    const std::vector<LabelImagePixelType> * FinalLUT;
+  };
+
+  /** Segment the tiles [First, Last[ on the thread pool. Each tile records
+   *  its maximum label and the population of its labels in its core region
+   *  (the tile without its margin). */
+  static ITK_THREAD_RETURN_TYPE SegmentTilesCallback(void *arg)
+  {
+    itk::MultiThreader::ThreadInfoStruct * info = (itk::MultiThreader::ThreadInfoStruct *) arg;
+    InMemoryTileThreadStruct * str = (InMemoryTileThreadStruct *) info->UserData;
+
+    for(unsigned int t = str->First + info->ThreadID; t < str->Last; t += info->NumberOfThreads)
+      {
+      InMemoryTile & tile = (*str->Tiles)[t];
+      try
+        {
+        tile.Segmentation->Update();
+        tile.Labels = tile.Segmentation->GetOutput();
+        tile.Labels->DisconnectPipeline();
+        tile.Segmentation = ITK_NULLPTR;
+
+        tile.MaximumLabel = 0;
+        LabelImageIterator it(tile.Labels, tile.Labels->GetLargestPossibleRegion());
+        for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+          {
+          tile.MaximumLabel = std::max(tile.MaximumLabel, it.Get());
+          }
+
+        LabelImageType::RegionType coreRegion;
+        coreRegion.SetSize(tile.CoreSize);
+        tile.CoreCounts.assign(tile.MaximumLabel + 1, 0);
+        LabelImageIterator coreIt(tile.Labels, coreRegion);
+        for (coreIt.GoToBegin(); !coreIt.IsAtEnd(); ++coreIt)
+          {
+          tile.CoreCounts[coreIt.Get()] += 1;
+          }
+        }
+      catch(itk::ExceptionObject & err)
+        {
+        tile.Error = err.GetDescription();
+        }
+      }
+    return ITK_THREAD_RETURN_VALUE;
+  }
+
+  /** Relabel the core region of the tiles [First, Last[ with the final
+   *  look-up table, and release their margins */
+  static ITK_THREAD_RETURN_TYPE RelabelTilesCallback(void *arg)
+  {
+    itk::MultiThreader::ThreadInfoStruct * info = (itk::MultiThreader::ThreadInfoStruct *) arg;
+    InMemoryTileThreadStruct * str = (InMemoryTileThreadStruct *) info->UserData;
+    const std::vector<LabelImagePixelType> & finalLUT = *(str->FinalLUT);
+
+    for(unsigned int t = str->First + info->ThreadID; t < str->Last; t += info->NumberOfThreads)
+      {
+      InMemoryTile & tile = (*str->Tiles)[t];
+
+      LabelImageType::RegionType coreRegion;
+      coreRegion.SetSize(tile.CoreSize);
+      tile.FinalLabels = LabelImageType::New();
+      tile.FinalLabels->SetRegions(coreRegion);
+      tile.FinalLabels->Allocate();
+
+      LabelImageIterator inIt(tile.Labels, coreRegion);
+      itk::ImageRegionIterator<LabelImageType> outIt(tile.FinalLabels, coreRegion);
+      for (inIt.GoToBegin(), outIt.GoToBegin(); !outIt.IsAtEnd(); ++inIt, ++outIt)
+        {
+        outIt.Set(finalLUT[inIt.Get() + tile.Offset]);
+        }
+
+      tile.Labels = ITK_NULLPTR;
+      tile.CoreCounts.clear();
+      }
+    return ITK_THREAD_RETURN_VALUE;
+  }
+
   std::string CreateFileName(unsigned int row, unsigned int column, std::string label)
   {
     std::string outfname = GetParameterString("out");
@@ -214,13 +313,302 @@ private:
     return vrtfname;
   }
 
+  std::string CreateExpression(unsigned int nbComp, float ranger, float spatialr)
+  {
+    //Expression 1 : radiometric distance < ranger
+    std::stringstream expr;
+    expr<<"sqrt((p1b1-p2b1)*(p1b1-p2b1)";
+    for(unsigned int i=1; i<nbComp; i++)
+      expr<<"+(p1b"<<i+1<<"-p2b"<<i+1<<")*(p1b"<<i+1<<"-p2b"<<i+1<<")";
+    expr<<")"<<"<"<<ranger;
+
+    if(HasValue("inpos"))
+      {
+      //Expression 2 : final positions < spatialr
+      expr<<" and sqrt((p1b"<<nbComp+1<<"-p2b"<<nbComp+1<<")*(p1b"<<nbComp+1<<"-p2b"<<nbComp+1<<")+";
+      expr<<"(p1b"<<nbComp+2<<"-p2b"<<nbComp+2<<")*(p1b"<<nbComp+2<<"-p2b"<<nbComp+2<<"))"<<"<"<<spatialr;
+      }
+
+    return expr.str();
+  }
+
+  // Merge the classes of two labels in the look-up table, the canonical
+  // label of a class being its smallest label
+  void MergeLabels(std::vector<LabelImagePixelType> & LUT, LabelImagePixelType curLabel, LabelImagePixelType adjLabel)
+  {
+    LabelImagePixelType curCanLabel = curLabel;
+    while(LUT[curCanLabel] != curCanLabel)
+      {
+      curCanLabel = LUT[curCanLabel];
+      }
+    LabelImagePixelType adjCanLabel = adjLabel;
+    while(LUT[adjCanLabel] != adjCanLabel)
+      {
+      adjCanLabel = LUT[adjCanLabel];
+      }
+    if(curCanLabel < adjCanLabel)
+      {
+      LUT[adjCanLabel] = curCanLabel;
+      }
+    else
+      {
+      LUT[LUT[curCanLabel]] = adjCanLabel; LUT[curCanLabel] = adjCanLabel;
+      }
+  }
+
+  // Create the LUT to filter small regions and assign min labels. Returns
+  // the number of removed regions.
+  unsigned int PruneSmallRegions(const std::vector<unsigned long> & sizePerRegion, unsigned int minRegionSize,
+                                 std::vector<LabelImagePixelType> & newLabels)
+  {
+    const unsigned long regionCount = sizePerRegion.size() - 1;
+    unsigned int smallCount = 0;
+    LabelImagePixelType newLab=1;
+    newLabels.assign(regionCount+1,0);
+    for(LabelImagePixelType curLabel = 1; curLabel <= regionCount; ++curLabel)
+      {
+      if(sizePerRegion[curLabel]<minRegionSize)
+        {
+        newLabels[curLabel]=0;
+        ++smallCount;
+        }
+      else
+        {
+        newLabels[curLabel]=newLab;
+        newLab+=1;
+        }
+      }
+    return smallCount;
+  }
+
+  ImageType::Pointer ExtractTile(ImageType * image, unsigned long startX, unsigned long startY,
+                                 unsigned long sizeX, unsigned long sizeY)
+  {
+    MultiChannelExtractROIFilterType::Pointer extractROIFilter = MultiChannelExtractROIFilterType::New();
+    extractROIFilter->SetInput(image);
+    extractROIFilter->SetStartX(startX);
+    extractROIFilter->SetStartY(startY);
+    extractROIFilter->SetSizeX(sizeX);
+    extractROIFilter->SetSizeY(sizeY);
+    extractROIFilter->Update();
+
+    ImageType::Pointer tile = extractROIFilter->GetOutput();
+    tile->DisconnectPipeline();
+    return tile;
+  }
+
+  // In-memory processing: the tiles are segmented and relabelled on a
+  // thread pool, their seams are analysed in memory, and the output is
+  // mosaiced from the relabelled tiles. The labels are the same as with
+  // the temporary files.
+  void ExecuteInMemory(ImageType * imageIn, ImageType * spatialIn, const std::string & expression,
+                       unsigned int minRegionSize,
+                       unsigned long sizeTilesX, unsigned long sizeTilesY,
+                       unsigned long sizeImageX, unsigned long sizeImageY,
+                       unsigned int nbTilesX, unsigned int nbTilesY)
+  {
+    const unsigned int nbTiles = nbTilesX * nbTilesY;
+    const unsigned int nbThreads = std::max<unsigned int>(1, itk::MultiThreader::GetGlobalDefaultNumberOfThreads());
+
+    std::vector<InMemoryTile> tiles(nbTiles);
+
+    InMemoryTileThreadStruct str;
+    str.Tiles = &tiles;
+    str.FinalLUT = ITK_NULLPTR;
+
+    itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+
+    // Step 1: segment the tiles, by batches of one tile per thread
+    otbAppLogINFO(<<"Tiles segmentation on "<<nbThreads<<" threads ...");
+    for(unsigned int first = 0; first < nbTiles; first += nbThreads)
+      {
+      const unsigned int last = std::min(nbTiles, first + nbThreads);
+
+      // The input tiles are extracted one after the other, since they
+      // share the input pipeline
+      for(unsigned int t = first; t < last; ++t)
+        {
+        const unsigned int row = t / nbTilesX;
+        const unsigned int column = t % nbTilesX;
+
+        unsigned long startX = column*sizeTilesX;
+        unsigned long startY = row*sizeTilesY;
+        unsigned long sizeX = vcl_min(sizeTilesX+1,sizeImageX-startX+1);
+        unsigned long sizeY = vcl_min(sizeTilesY+1,sizeImageY-startY+1);
+
+        tiles[t].CoreSize[0] = vcl_min(sizeTilesX,sizeImageX-startX);
+        tiles[t].CoreSize[1] = vcl_min(sizeTilesY,sizeImageY-startY);
+
+        CCFilterType::Pointer ccFilter = CCFilterType::New();
+        ccFilter->SetNumberOfThreads(1);
+
+        ImageType::Pointer tileIn = ExtractTile(imageIn,startX,startY,sizeX,sizeY);
+        if(spatialIn)
+          {
+          ConcatenateType::Pointer concat = ConcatenateType::New();
+          concat->SetInput1(tileIn);
+          concat->SetInput2(ExtractTile(spatialIn,startX,startY,sizeX,sizeY));
+          concat->Update();
+
+          ImageType::Pointer concatenated = concat->GetOutput();
+          concatenated->DisconnectPipeline();
+          ccFilter->SetInput(concatenated);
+          }
+        else
+          {
+          ccFilter->SetInput(tileIn);
+          }
+
+        ccFilter->GetFunctor().SetExpression(expression);
+        tiles[t].Segmentation = ccFilter;
+        }
+
+      str.First = first;
+      str.Last = last;
+      threader->SetNumberOfThreads(last - first);
+      threader->SetSingleMethod(SegmentTilesCallback, &str);
+      threader->SingleMethodExecute();
+
+      for(unsigned int t = first; t < last; ++t)
+        {
+        if(!tiles[t].Error.empty())
+          {
+          otbAppLogFATAL(<<"Segmentation of tile "<<t<<" failed: "<<tiles[t].Error);
+          }
+        }
+      }
+
+    // Shift the labels of each tile after the labels of the previous tiles
+    unsigned long regionCount = 0;
+    for(unsigned int t = 0; t < nbTiles; ++t)
+      {
+      tiles[t].Offset = static_cast<LabelImagePixelType>(regionCount);
+      regionCount += tiles[t].MaximumLabel;
+      }
+
+    // Step 2: create the look-up table for all overlaps
+    otbAppLogINFO(<<"LUT creation ...");
+    std::vector<LabelImagePixelType> LUT(regionCount+1);
+    for(LabelImagePixelType curLabel = 1; curLabel <= regionCount; ++curLabel)
+      LUT[curLabel] = curLabel;
+
+    for(unsigned int t = 0; t < nbTiles; ++t)
+      {
+      const unsigned int row = t / nbTilesX;
+      const unsigned int column = t % nbTilesX;
+      unsigned long startX = column*sizeTilesX;
+      unsigned long startY = row*sizeTilesY;
+      unsigned long sizeX = vcl_min(sizeTilesX+1,sizeImageX-startX+1);
+      unsigned long sizeY = vcl_min(sizeTilesY+1,sizeImageY-startY+1);
+
+      const LabelImageType * tileIn = tiles[t].Labels;
+
+      // Analyse intersection between in and up tiles
+      if(row>0)
+        {
+        const InMemoryTile & tileUp = tiles[t-nbTilesX];
+
+        LabelImageType::IndexType pixelIndexIn;
+        LabelImageType::IndexType pixelIndexUp;
+
+        pixelIndexIn[1] = 0;
+        pixelIndexUp[1] = sizeTilesY;
+
+        for(pixelIndexIn[0]=0; pixelIndexIn[0]<static_cast<long>(sizeX-1); ++pixelIndexIn[0])
+          {
+          pixelIndexUp[0] = pixelIndexIn[0];
+          MergeLabels(LUT,
+                      tileIn->GetPixel(pixelIndexIn) + tiles[t].Offset,
+                      tileUp.Labels->GetPixel(pixelIndexUp) + tileUp.Offset);
+          }
+        }
+
+      // Analyse intersection between in and left tiles
+      if(column>0)
+        {
+        const InMemoryTile & tileLeft = tiles[t-1];
+
+        LabelImageType::IndexType pixelIndexIn;
+        LabelImageType::IndexType pixelIndexUp;
+
+        pixelIndexIn[0] = 0;
+        pixelIndexUp[0] = sizeTilesX;
+
+        for(pixelIndexIn[1]=0; pixelIndexIn[1]<static_cast<long>(sizeY-1); ++pixelIndexIn[1])
+          {
+          pixelIndexUp[1] = pixelIndexIn[1];
+          MergeLabels(LUT,
+                      tileIn->GetPixel(pixelIndexIn) + tiles[t].Offset,
+                      tileLeft.Labels->GetPixel(pixelIndexUp) + tileLeft.Offset);
+          }
+        }
+      }
+
+    // Reduce LUT to canonical labels
+    for(LabelImagePixelType label = 1; label < regionCount+1; ++label)
+      {
+      LabelImagePixelType can = label;
+      while(LUT[can] != can)
+        {
+        can = LUT[can];
+        }
+      LUT[label] = can;
+      }
+    otbAppLogINFO(<<"LUT size: "<<LUT.size()<<" segments");
+
+    // Size of each region, from the populations of the tile labels
+    std::vector<unsigned long> sizePerRegion(regionCount+1,0);
+    for(unsigned int t = 0; t < nbTiles; ++t)
+      {
+      for(LabelImagePixelType label = 0; label < tiles[t].CoreCounts.size(); ++label)
+        {
+        sizePerRegion[LUT[label + tiles[t].Offset]] += tiles[t].CoreCounts[label];
+        }
+      }
+
+    otbAppLogINFO(<<"Small regions pruning ...");
+    std::vector<LabelImagePixelType> newLabels;
+    unsigned int smallCount = PruneSmallRegions(sizePerRegion,minRegionSize,newLabels);
+    otbAppLogINFO(<<smallCount<<" small regions will be removed");
+    sizePerRegion.clear();
+
+    // Compose both look-up tables
+    std::vector<LabelImagePixelType> finalLUT(regionCount+1,0);
+    for(LabelImagePixelType label = 1; label < regionCount+1; ++label)
+      {
+      finalLUT[label] = newLabels[LUT[label]];
+      }
+    LUT.clear();
+    newLabels.clear();
+
+    // Step 3: relabel the tiles
+    otbAppLogINFO(<<"Tiles relabelisation ...");
+    str.First = 0;
+    str.Last = nbTiles;
+    str.FinalLUT = &finalLUT;
+    threader->SetNumberOfThreads(std::min(nbThreads, nbTiles));
+    threader->SetSingleMethod(RelabelTilesCallback, &str);
+    threader->SingleMethodExecute();
+
+    // Mosaic of the relabelled tiles, written in a single streaming pass
+    m_TileFilter = TileImageFilterType::New();
+    TileImageFilterType::SizeType layout;
+    layout[0] = nbTilesX;
+    layout[1] = nbTilesY;
+    m_TileFilter->SetLayout(layout);
+    for(unsigned int t = 0; t < nbTiles; ++t)
+      {
+      m_TileFilter->SetInput(t, tiles[t].FinalLabels);
+      }
+  }
+
   void DoInit() ITK_OVERRIDE
   {
     SetName("LSMSSegmentation");
     SetDescription("Second step of the exact Large-Scale Mean-Shift segmentation workflow.");
 
     SetDocName("Exact Large-Scale Mean-Shift segmentation, step 2");
-    SetDocLongDescription("This application performs the second step of the exact Large-Scale Mean-Shift segmentation workflow (LSMS). Filtered range image and spatial image should be created with the MeanShiftSmoothing application, with modesearch parameter disabled. If spatial image is not set, the application will only process the range image and spatial radius parameter will not be taken into account. This application will produce a labeled image where neighbor pixels whose range distance is below range radius (and optionally spatial distance below spatial radius) will be grouped together into the same cluster. For large images one can use the nbtilesx and nbtilesy parameters for tile-wise processing, with the guarantees of identical results. Please note that this application will generate a lot of temporary files (as many as the number of tiles), and will therefore require twice the size of the final result in term of disk space. The cleanup option (activated by default) allows removing all temporary file as soon as they are not needed anymore (if cleanup is activated, tmpdir set and tmpdir does not exists before running the application, it will be removed as well during cleanup). The tmpdir option allows defining a directory where to write the temporary files. Please also note that the output image type should be set to uint32 to ensure that there are enough labels available.");
+    SetDocLongDescription("This application performs the second step of the exact Large-Scale Mean-Shift segmentation workflow (LSMS). Filtered range image and spatial image should be created with the MeanShiftSmoothing application, with modesearch parameter disabled. If spatial image is not set, the application will only process the range image and spatial radius parameter will not be taken into account. This application will produce a labeled image where neighbor pixels whose range distance is below range radius (and optionally spatial distance below spatial radius) will be grouped together into the same cluster. For large images one can use the nbtilesx and nbtilesy parameters for tile-wise processing, with the guarantees of identical results. Please note that this application will generate a lot of temporary files (as many as the number of tiles), and will therefore require twice the size of the final result in term of disk space, unless the inmemory option is activated: tiles are then processed in parallel and kept in memory, which requires enough memory to hold the final result. The cleanup option (activated by default) allows removing all temporary file as soon as they are not needed anymore (if cleanup is activated, tmpdir set and tmpdir does not exists before running the application, it will be removed as well during cleanup). The tmpdir option allows defining a directory where to write the temporary files. Please also note that the output image type should be set to uint32 to ensure that there are enough labels available.");
     SetDocLimitations("This application is part of the Large-Scale Mean-Shift segmentation workflow (LSMS) and may not be suited for any other purpose.");
     SetDocAuthors("David Youssefi");
     SetDocSeeAlso("MeanShiftSmoothing, LSMSSmallRegionsMerging, LSMSVectorization");
@@ -270,6 +658,10 @@ private:
     MandatoryOff("tmpdir");
     DisableParameter("tmpdir");
 
+    AddParameter(ParameterType_Empty,"inmemory","Process tiles in memory");
+    SetParameterDescription("inmemory","If activated, tiles are segmented and relabelled in parallel, and kept in memory instead of being written to temporary files. Results are identical, but enough memory is needed to hold the output image. The tmpdir and cleanup parameters are then ignored.");
+    MandatoryOff("inmemory");
+
     AddParameter(ParameterType_Empty,"cleanup","Temporary files cleaning");
     EnableParameter("cleanup");
     SetParameterDescription("cleanup","If activated, the application will try to clean all temporary files it created");
@@ -306,8 +698,10 @@ private:
     unsigned long sizeTilesY   = GetParameterInt("tilesizey");
 
 
+    const bool inMemory = IsParameterEnabled("inmemory");
+
     // Ensure that temporary directory exists if activated:
-    if(IsParameterEnabled("tmpdir"))
+    if(!inMemory && IsParameterEnabled("tmpdir"))
       {
       if(!itksys::SystemTools::FileExists(GetParameterString("tmpdir").c_str()))
         {
@@ -342,6 +736,24 @@ private:
 
     otbAppLogINFO(<<"Number of tiles: "<<nbTilesX<<" x "<<nbTilesY);
 
+    const std::string expression = CreateExpression(nbComp,ranger,spatialr);
+
+    if(inMemory)
+      {
+      ExecuteInMemory(imageIn,spatialIn,expression,minRegionSize,sizeTilesX,sizeTilesY,
+                      sizeImageX,sizeImageY,nbTilesX,nbTilesY);
+
+      clock_t toc = clock();
+      otbAppLogINFO(<<"Elapsed time: "<<(double)(toc - tic) / CLOCKS_PER_SEC<<" seconds");
+
+      m_ImportGeoInformationFilter = ImportGeoInformationImageFilterType::New();
+      m_ImportGeoInformationFilter->SetInput(m_TileFilter->GetOutput());
+      m_ImportGeoInformationFilter->SetSource(imageIn);
+
+      SetParameterOutputImage("out",m_ImportGeoInformationFilter->GetOutput());
+      return;
+      }
+
     unsigned long regionCount = 0;
 
     //Segmentation by the connected component per tile and label
@@ -393,22 +805,8 @@ private:
          ccFilter->SetInput(extractROIFilter->GetOutput());
           }
 
-        //Expression 1 : radiometric distance < ranger
-        std::stringstream expr;
-        expr<<"sqrt((p1b1-p2b1)*(p1b1-p2b1)";
-        for(unsigned int i=1; i<nbComp; i++)
-          expr<<"+(p1b"<<i+1<<"-p2b"<<i+1<<")*(p1b"<<i+1<<"-p2b"<<i+1<<")";
-        expr<<")"<<"<"<<ranger;
-
-        if(HasValue("inpos"))
-          {
-          //Expression 2 : final positions < spatialr
-          expr<<" and sqrt((p1b"<<nbComp+1<<"-p2b"<<nbComp+1<<")*(p1b"<<nbComp+1<<"-p2b"<<nbComp+1<<")+";
-          expr<<"(p1b"<<nbComp+2<<"-p2b"<<nbComp+2<<")*(p1b"<<nbComp+2<<"-p2b"<<nbComp+2<<"))"<<"<"<<spatialr;
-          }
-
         //Segmentation
-        ccFilter->GetFunctor().SetExpression(expr.str());
+        ccFilter->GetFunctor().SetExpression(expression);
         ccFilter->Update();
 
         //Shifting
@@ -470,25 +868,9 @@ private:
             {
             pixelIndexUp[0] = pixelIndexIn[0];
 
-            LabelImagePixelType curCanLabel = tileInReader->GetOutput()->GetPixel(pixelIndexIn);
-           while(LUT[curCanLabel] != curCanLabel)
-              {
-              curCanLabel = LUT[curCanLabel];
-              }
-           LabelImagePixelType adjCanLabel = tileUpReader->GetOutput()->GetPixel(pixelIndexUp);
-
-           while(LUT[adjCanLabel] != adjCanLabel)
-              {
-              adjCanLabel = LUT[adjCanLabel];
-              }
-           if(curCanLabel < adjCanLabel)
-              {
-              LUT[adjCanLabel] = curCanLabel;
-              }
-           else
-              {
-              LUT[LUT[curCanLabel]] = adjCanLabel; LUT[curCanLabel] = adjCanLabel;
-              }
+            MergeLabels(LUT,
+                        tileInReader->GetOutput()->GetPixel(pixelIndexIn),
+                        tileUpReader->GetOutput()->GetPixel(pixelIndexUp));
             }
           }
 
@@ -510,24 +892,9 @@ private:
             {
             pixelIndexUp[1] = pixelIndexIn[1];
 
-            LabelImagePixelType curCanLabel = tileInReader->GetOutput()->GetPixel(pixelIndexIn);
-           while(LUT[curCanLabel] != curCanLabel)
-              {
-              curCanLabel = LUT[curCanLabel];
-              }
-           LabelImagePixelType adjCanLabel = tileLeftReader->GetOutput()->GetPixel(pixelIndexUp);
-           while(LUT[adjCanLabel] != adjCanLabel)
-              {
-              adjCanLabel = LUT[adjCanLabel];
-              }
-           if(curCanLabel < adjCanLabel)
-              {
-              LUT[adjCanLabel] = curCanLabel;
-              }
-           else
-              {
-              LUT[LUT[curCanLabel]] = adjCanLabel; LUT[curCanLabel] = adjCanLabel;
-              }
+            MergeLabels(LUT,
+                        tileInReader->GetOutput()->GetPixel(pixelIndexIn),
+                        tileLeftReader->GetOutput()->GetPixel(pixelIndexUp));
             }
           }
         }
@@ -608,25 +975,10 @@ private:
     // Clear lut, we do not need it anymore
     LUT.clear();
 
-    unsigned int smallCount = 0;
-
       // Create the LUT to filter small regions and assign min labels
       otbAppLogINFO(<<"Small regions pruning ...");
-      LabelImagePixelType newLab=1;
-      std::vector<LabelImagePixelType> newLabels(regionCount+1,0);
-      for(LabelImagePixelType curLabel = 1; curLabel <= regionCount; ++curLabel)
-        {
-        if(sizePerRegion[curLabel]<minRegionSize)
-          {
-          newLabels[curLabel]=0;
-          ++smallCount;
-          }
-        else
-          {
-          newLabels[curLabel]=newLab;
-          newLab+=1;
-          }
-        }
+      std::vector<LabelImagePixelType> newLabels;
+      unsigned int smallCount = PruneSmallRegions(sizePerRegion,minRegionSize,newLabels);
 
       otbAppLogINFO(<<smallCount<<" small regions will be removed");
 
@@ -691,7 +1043,10 @@ private:
     // Release input files
     m_FinalReader = ITK_NULLPTR;
 
-    if(IsParameterEnabled("cleanup"))
+    // Release the in-memory tiles
+    m_TileFilter = ITK_NULLPTR;
+
+    if(IsParameterEnabled("cleanup") && !IsParameterEnabled("inmemory"))
       {
       otbAppLogINFO(<<"Final clean-up ...");
 
@@ -28,9 +28,12 @@
 #include "itkChangeLabelImageFilter.h"
 
 #include "otbTileImageFilter.h"
+#include "otbLabelRegionAdjacencyGraph.h"
+#include "itkMultiThreader.h"
 
 #include <time.h>
 #include <vcl_algorithm.h>
+#include <algorithm>
 #include <climits>
 
 #include "otbWrapperApplication.h"
@@ -67,6 +70,8 @@ public:
   typedef itk::ChangeLabelImageFilter<LabelImageType,LabelImageType> ChangeLabelImageFilterType;
   typedef otb::TileImageFilter<LabelImageType> TileImageFilterType;
 
+  typedef otb::LabelRegionAdjacencyGraph<LabelImagePixelType> RegionAdjacencyGraphType;
+
   itkNewMacro(Self);
   itkTypeMacro(Merging, otb::Application);
 
@@ -168,8 +173,12 @@ private:
 
     otbAppLogINFO(<<"Number of tiles: "<<nbTilesX<<" x "<<nbTilesY);
 
-    //Sums calculation per label
-    otbAppLogINFO(<<"Sums calculation ...");
+    //Sums calculation per label and region adjacency graph creation
+    otbAppLogINFO(<<"Sums calculation and region adjacency graph creation ...");
+
+    const unsigned int nbThreads = std::max<unsigned int>(1, itk::MultiThreader::GetGlobalDefaultNumberOfThreads());
+    RegionAdjacencyGraphType graph;
+    RegionAdjacencyGraphType::EdgeListType edges;
 
     for(unsigned int row = 0; row < nbTilesY; row++)
       for(unsigned int column = 0; column < nbTilesX; column++)
@@ -188,17 +197,23 @@ private:
         imageROI->SetSizeY(sizeY);
         imageROI->Update();
 
-        //Tiles extraction of the segmented image
+        //Tiles extraction of the segmented image, with one more column and
+        //row to get the adjacencies with the next tiles
         ExtractROIFilterType::Pointer labelImageROI = ExtractROIFilterType::New();
         labelImageROI->SetInput(labelIn);
         labelImageROI->SetStartX(startX);
         labelImageROI->SetStartY(startY);
-        labelImageROI->SetSizeX(sizeX);
-        labelImageROI->SetSizeY(sizeY);
+        labelImageROI->SetSizeX(vcl_min(sizeTilesX+1,sizeImageX-startX));
+        labelImageROI->SetSizeY(vcl_min(sizeTilesY+1,sizeImageY-startY));
         labelImageROI->Update();
 
+        LabelImageType::SizeType tileSize;
+        tileSize[0] = sizeX;
+        tileSize[1] = sizeY;
+        LabelImageType::RegionType tileRegion(labelImageROI->GetOutput()->GetLargestPossibleRegion().GetIndex(), tileSize);
+
         //Sums calculation for the mean calculation per label
-        LabelImageIterator itLabel( labelImageROI->GetOutput(), labelImageROI->GetOutput()->GetLargestPossibleRegion());
+        LabelImageIterator itLabel( labelImageROI->GetOutput(), tileRegion);
         ImageIterator itImage( imageROI->GetOutput(), imageROI->GetOutput()->GetLargestPossibleRegion());
 
         for (itLabel.GoToBegin(), itImage.GoToBegin(); !itLabel.IsAtEnd(); ++itLabel, ++itImage)
@@ -209,209 +224,127 @@ private:
             sum[itLabel.Value()][comp]+=itImage.Get()[comp];
             }
           }
+
+        //Adjacencies of the tile
+        RegionAdjacencyGraphType::EdgeListType tileEdges;
+        RegionAdjacencyGraphType::CollectEdges(labelImageROI->GetOutput(), tileRegion, tileEdges, nbThreads);
+        RegionAdjacencyGraphType::SortEdges(tileEdges);
+        edges.insert(edges.end(), tileEdges.begin(), tileEdges.end());
         }
 
-    //LUT creation for the final relabelling
-    std::vector<LabelImagePixelType> LUT;
-    LUT.clear();
-    LUT.resize(regionCount+1);
-    for(LabelImagePixelType curLabel = 1; curLabel <= regionCount; ++curLabel)
+    graph.Build(regionCount, edges);
+    RegionAdjacencyGraphType::EdgeListType().swap(edges);
+
+    //Minimal size region suppression
+    otbAppLogINFO(<<"Small regions merging ...");
+
+    // Regions are processed by increasing size: first all regions of 1
+    // pixel, then all regions of 2 pixels, until minsize. The nearest
+    // neighbors of the regions of a given size are searched with the
+    // statistics of the regions before merging any of them.
+    std::vector<std::vector<LabelImagePixelType> > regionsBySize(std::max(minSize,1U));
+    for(LabelImagePixelType label = 0; label <= regionCount; ++label)
       {
-      LUT[curLabel] = curLabel;
+      if((nbPixels[label]>0)&&(nbPixels[label]<minSize))
+        {
+        regionsBySize[nbPixels[label]].push_back(label);
+        }
       }
 
-    //Minimal size region suppression
-    otbAppLogINFO(<<"Building LUT for small regions merging ...");
+    std::vector<LabelImagePixelType> neighbors;
+    std::vector<std::pair<LabelImagePixelType,LabelImagePixelType> > merges;
+    std::vector<LabelImagePixelType> mergedLabels;
 
     for (unsigned int size=1; size<minSize; size++)
       {
-      // LUTtmp creation in order to modify the LUT only at the end of the pass
-      std::vector<LabelImagePixelType> LUTtmp;
-      LUTtmp.clear();
-      LUTtmp.resize(regionCount+1);
-      for(LabelImagePixelType curLabel = 1; curLabel <= regionCount; ++curLabel)
-        {
-        LUTtmp[curLabel] = LUT[curLabel];
-        }
+      std::vector<LabelImagePixelType> & candidates = regionsBySize[size];
+      std::sort(candidates.begin(), candidates.end());
 
-      for(unsigned int row = 0; row < nbTilesY; row++)
+      //Searching the "nearest" region
+      merges.clear();
+      for(std::vector<LabelImagePixelType>::const_iterator itCandidate = candidates.begin();
+          itCandidate != candidates.end(); ++itCandidate)
         {
-        for(unsigned int column = 0; column < nbTilesX; column++)
+        LabelImagePixelType curLabel = *itCandidate, adjLabel(0);
+        if((graph.GetRoot(curLabel)!=curLabel)||(nbPixels[curLabel]!=size))
+          {
+          continue;
+          }
+        graph.GetRegionNeighbors(curLabel, neighbors);
+        if(neighbors.empty())
           {
-          std::set<int> minLabel, edgeLabel, labelMerged;
-          std::map<int,std::set<int> > adjMap;
-
-          unsigned long startX = column*sizeTilesX, startY = row*sizeTilesY;
-          unsigned long sizeX = vcl_min(sizeTilesX+size+1,sizeImageX-startX),
-            sizeY = vcl_min(sizeTilesY+size+1,sizeImageY-startY);
-
-          ExtractROIFilterType::Pointer labelImageROI = ExtractROIFilterType::New();
-          labelImageROI->SetInput(labelIn);
-          labelImageROI->SetStartX(startX);
-          labelImageROI->SetStartY(startY);
-          labelImageROI->SetSizeX(sizeX);
-          labelImageROI->SetSizeY(sizeY);
-          labelImageROI->Update();
-
-          LabelImageType::IndexType pixelIndex;
-
-          //"Adjacency map" creation for the region with nbPixels=="size"
-          for(pixelIndex[0]=0; pixelIndex[0]<static_cast<long>(sizeX); ++pixelIndex[0])
-            for(pixelIndex[1]=0; pixelIndex[1]<static_cast<long>(sizeY); ++pixelIndex[1])
-              {
-              LabelImagePixelType curLabel = labelImageROI->GetOutput()->GetPixel(pixelIndex);
-
-              if(labelMerged.count(LUT[curLabel]))
-                {
-                edgeLabel.insert(LUT[curLabel]);
-                }
-              if((pixelIndex[0]==0)&&(startX!=0))
-                {
-                edgeLabel.insert(LUT[curLabel]);
-                }
-              if((pixelIndex[1]==0)&&(startY!=0))
-                {
-                edgeLabel.insert(LUT[curLabel]);
-                }
-
-              if(pixelIndex[0]==static_cast<long>(sizeX)-1)
-                {
-                if(startX!=(nbTilesX-1)*sizeTilesX) edgeLabel.insert(LUT[curLabel]);
-                }
-              else
-                {
-                ++pixelIndex[0];
-                LabelImagePixelType adjLabelX = labelImageROI->GetOutput()->GetPixel(pixelIndex);
-                --pixelIndex[0];
-
-                if(LUT[adjLabelX]!=LUT[curLabel])
-                  {
-                  if((nbPixels[LUT[curLabel]]>0)&&(nbPixels[LUT[curLabel]]==size))
-                    {
-                    adjMap[LUT[curLabel]].insert(LUT[adjLabelX]);
-                    minLabel.insert(LUT[curLabel]);
-                    }
-                  if((nbPixels[LUT[adjLabelX]]>0)&&(nbPixels[LUT[adjLabelX]]==size))
-                    {
-                    adjMap[LUT[adjLabelX]].insert(LUT[curLabel]);
-                    minLabel.insert(LUT[adjLabelX]);
-                    }
-                  }
-                }
-              if(pixelIndex[1]==static_cast<long>(sizeY)-1)
-                {
-                if(startY!=(nbTilesY-1)*sizeTilesY) edgeLabel.insert(LUT[curLabel]);
-                }
-              else
-                {
-                ++pixelIndex[1];
-                LabelImagePixelType adjLabelY = labelImageROI->GetOutput()->GetPixel(pixelIndex);
-                --pixelIndex[1];
-                if(LUT[adjLabelY]!=LUT[curLabel])
-                  {
-                  if((nbPixels[LUT[curLabel]]>0)&&(nbPixels[LUT[curLabel]]==size))
-                    {
-                    adjMap[LUT[curLabel]].insert(LUT[adjLabelY]);
-                    minLabel.insert(LUT[curLabel]);
-                    }
-                  if((nbPixels[LUT[adjLabelY]]>0)&&(nbPixels[LUT[adjLabelY]]==size))
-                    {
-                    adjMap[LUT[adjLabelY]].insert(LUT[curLabel]);
-                    minLabel.insert(LUT[adjLabelY]); }
-                  }
-                }
-              }
-
-          //Searching the "nearest" region
-          for(std::set<int>::iterator itMinLabel=minLabel.begin(); itMinLabel!=minLabel.end(); ++itMinLabel)
+          continue;
+          }
+
+        double err = itk::NumericTraits<double>::max();
+        for(std::vector<LabelImagePixelType>::const_iterator itAdjLabel = neighbors.begin();
+            itAdjLabel != neighbors.end(); ++itAdjLabel)
+          {
+          double tmpError = 0;
+          LabelImagePixelType tmpLabel = *itAdjLabel;
+          for(unsigned int comp = 0; comp<numberOfComponentsPerPixel; ++comp)
             {
-            LabelImagePixelType curLabel = *itMinLabel, adjLabel(0);
-            double err = itk::NumericTraits<double>::max();
-            if(edgeLabel.count(curLabel)==0)
-              {
-              if(nbPixels[curLabel]==size)
-                {
-                edgeLabel.insert(curLabel);
-                for(std::set<int>::iterator itAdjLabel=(adjMap[curLabel]).begin();
-                    itAdjLabel!=(adjMap[curLabel]).end(); ++itAdjLabel)
-                  {
-                  double tmpError = 0;
-                  LabelImagePixelType tmpLabel = *itAdjLabel;
-                  if(tmpLabel!=curLabel)
-                    {
-                    for(unsigned int comp = 0; comp<numberOfComponentsPerPixel; ++comp)
-                      {
-                      double curComp = static_cast<double>(sum[curLabel][comp])/nbPixels[curLabel];
-                      int tmpComp = static_cast<double>(sum[tmpLabel][comp])/nbPixels[tmpLabel];
-                      tmpError += (curComp-tmpComp)*(curComp-tmpComp);
-                      }
-                    if(tmpError<err)
-                      {
-                      err = tmpError;
-                      adjLabel = tmpLabel;
-                      }
-                    }
-                  }
-
-                //Fusion of the two regions
-                if(adjLabel!=curLabel)
-                  {
-                  unsigned int curLabelLUT = curLabel, adjLabelLUT = adjLabel;
-                  while(LUTtmp[curLabelLUT] != curLabelLUT)
-                    {
-                    curLabelLUT = LUTtmp[curLabelLUT];
-                    }
-                  while(LUTtmp[adjLabelLUT] != adjLabelLUT)
-                    {
-                    adjLabelLUT = LUTtmp[adjLabelLUT];
-                    }
-                  if(curLabelLUT < adjLabelLUT)
-                    {
-                    LUTtmp[adjLabelLUT] = curLabelLUT;
-                    }
-                  else
-                    {
-                    LUTtmp[LUTtmp[curLabelLUT]] = adjLabelLUT; LUTtmp[curLabelLUT] = adjLabelLUT;
-                    }
-                  }
-                }
-              }
+            double curComp = static_cast<double>(sum[curLabel][comp])/nbPixels[curLabel];
+            int tmpComp = static_cast<double>(sum[tmpLabel][comp])/nbPixels[tmpLabel];
+            tmpError += (curComp-tmpComp)*(curComp-tmpComp);
             }
-
-          for(LabelImagePixelType label = 1; label < regionCount+1; ++label)
+          if(tmpError<err)
             {
-            LabelImagePixelType can = label;
-            while(LUTtmp[can] != can)
-              {
-              can = LUTtmp[can];
-              }
-            LUTtmp[label] = can;
+            err = tmpError;
+            adjLabel = tmpLabel;
             }
           }
+        merges.push_back(std::make_pair(curLabel, adjLabel));
+        }
+      std::vector<LabelImagePixelType>().swap(candidates);
+
+      //Fusion of the regions
+      mergedLabels.clear();
+      for(unsigned int i = 0; i < merges.size(); ++i)
+        {
+        graph.MergeRegions(merges[i].first, merges[i].second);
+        mergedLabels.push_back(merges[i].first);
+        mergedLabels.push_back(merges[i].second);
         }
+      std::sort(mergedLabels.begin(), mergedLabels.end());
+      mergedLabels.erase(std::unique(mergedLabels.begin(), mergedLabels.end()), mergedLabels.end());
 
-      for(LabelImagePixelType label = 1; label < regionCount+1; ++label)
+      //Statistics of the merged regions are moved to their new root
+      for(unsigned int i = 0; i < mergedLabels.size(); ++i)
         {
-        LUT[label]=LUTtmp[label];
-        if((nbPixels[label]!=0)&&(LUT[label]!=label))
+        LabelImagePixelType label = mergedLabels[i];
+        LabelImagePixelType root = graph.GetRoot(label);
+        if(root!=label)
           {
-          nbPixels[LUT[label]]+=nbPixels[label];
+          nbPixels[root]+=nbPixels[label];
           nbPixels[label]=0;
           for(unsigned int comp = 0; comp<numberOfComponentsPerPixel; ++comp)
             {
-            sum[LUT[label]][comp]+=sum[label][comp];
+            sum[root][comp]+=sum[label][comp];
             }
           }
         }
+
+      //New regions still smaller than minsize will be processed later
+      for(unsigned int i = 0; i < mergedLabels.size(); ++i)
+        {
+        LabelImagePixelType label = mergedLabels[i];
+        if((graph.GetRoot(label)==label)&&(nbPixels[label]<minSize))
+          {
+          regionsBySize[nbPixels[label]].push_back(label);
+          }
+        }
       }
+
     //Relabelling
     m_ChangeLabelFilter = ChangeLabelImageFilterType::New();
     m_ChangeLabelFilter->SetInput(labelIn);
     for(LabelImagePixelType label = 1; label<regionCount+1; ++label)
       {
-      if(label!=LUT[label])
+      LabelImagePixelType root = graph.GetRoot(label);
+      if(label!=root)
         {
-        m_ChangeLabelFilter->SetChange(label,LUT[label]);
+        m_ChangeLabelFilter->SetChange(label,root);
         }
       }
 
@@ -27,9 +27,11 @@
 #include "otbStreamingStatisticsImageFilter.h"
 #include "otbLabelImageToOGRDataSourceFilter.h"
 #include "otbOGRFeatureWrapper.h"
+#include "itkMultiThreader.h"
 
 #include <time.h>
 #include <vcl_algorithm.h>
+#include <map>
 
 namespace otb
 {
@@ -66,13 +68,54 @@ public:
   itkTypeMacro(Vectorization, otb::Application);
 
 private:
+  /** Tile vectorized on the thread pool */
+  struct VectorizationTile
+  {
+    ImageType::Pointer                  Image;
+    LabelImageType::Pointer             Labels;
+    LabelImageType::SizeType            CoreSize;
+    LabelImageToOGRDataSourceFilterType::Pointer Vectorizer;
+    otb::ogr::DataSource::ConstPointer  Polygons;
+    std::string                         Error;
+  };
+
+  /** Structure passed to the tile threads */
+  struct VectorizationThreadStruct
+  {
+    std::vector<VectorizationTile> * Tiles;
+  };
+
+  /** Polygonize the tiles. The tile images are kept for the statistics,
+   *  which are accumulated afterwards in tile order by the calling thread. */
+  static ITK_THREAD_RETURN_TYPE VectorizeTilesCallback(void *arg)
+  {
+    itk::MultiThreader::ThreadInfoStruct * info = (itk::MultiThreader::ThreadInfoStruct *) arg;
+    VectorizationThreadStruct * str = (VectorizationThreadStruct *) info->UserData;
+
+    for(unsigned int t = info->ThreadID; t < str->Tiles->size(); t += info->NumberOfThreads)
+      {
+      VectorizationTile & tile = (*str->Tiles)[t];
+      try
+        {
+        tile.Vectorizer->Update();
+        tile.Polygons = tile.Vectorizer->GetOutput();
+        }
+      catch(itk::ExceptionObject & err)
+        {
+        tile.Error = err.GetDescription();
+        }
+      tile.Vectorizer = ITK_NULLPTR;
+      }
+    return ITK_THREAD_RETURN_VALUE;
+  }
+
   void DoInit() ITK_OVERRIDE
   {
     SetName("LSMSVectorization");
     SetDescription("Fourth step of the exact Large-Scale Mean-Shift segmentation workflow.");
 
     SetDocName("Exact Large-Scale Mean-Shift segmentation, step 4");
-    SetDocLongDescription("This application performs the fourth step of the exact Large-Scale Mean-Shift segmentation workflow (LSMS). Given a segmentation result (label image), that may have been processed for small regions merging or not, it will convert it to a GIS vector file containing one polygon per segment. Each polygon contains additional fields: mean and variance of each channels from input image (in parameter), segmentation image label, number of pixels in the polygon. For large images one can use the nbtilesx and nbtilesy parameters for tile-wise processing, with the guarantees of identical results.");
+    SetDocLongDescription("This application performs the fourth step of the exact Large-Scale Mean-Shift segmentation workflow (LSMS). Given a segmentation result (label image), that may have been processed for small regions merging or not, it will convert it to a GIS vector file containing one polygon per segment. Each polygon contains additional fields: mean and variance of each channels from input image (in parameter), segmentation image label, number of pixels in the polygon. For large images one can use the nbtilesx and nbtilesy parameters for tile-wise processing, with the guarantees of identical results. Tiles are vectorized concurrently on the available threads.");
     SetDocLimitations("This application is part of the Large-Scale Mean-Shift segmentation workflow (LSMS) and may not be suited for any other purpose.");
     SetDocAuthors("David Youssefi");
     SetDocSeeAlso("MeanShiftSmoothing, LSMSSegmentation, LSMSSmallRegionsMerging");
@@ -145,20 +188,14 @@ private:
     unsigned long numberOfComponentsPerPixel = imageIn->GetNumberOfComponentsPerPixel();
     std::string projRef = imageIn->GetProjectionRef();
 
-    std::vector<int>nbPixels;
-    nbPixels.clear();
-    nbPixels.resize(regionCount+1);
+    std::vector<int>nbPixels(regionCount+1,0);
+    std::vector<float>sum((regionCount+1)*numberOfComponentsPerPixel,0.);
+    std::vector<float>sum2((regionCount+1)*numberOfComponentsPerPixel,0.);
 
-    for(LabelImagePixelType curLabel = 1; curLabel <= regionCount; ++curLabel)
-      {
-      nbPixels[curLabel] = 0;
-      }
-
-    ImageType::PixelType defaultValue(numberOfComponentsPerPixel);
-    defaultValue.Fill(0);
-
-    std::vector<ImageType::PixelType>sum(regionCount+1,defaultValue);
-    std::vector<ImageType::PixelType>sum2(regionCount+1,defaultValue);
+    // FID of the first polygon of each label, and of the other polygons of
+    // the labels split by tiles
+    std::vector<long> firstFIDs(regionCount+1,OGRNullFID);
+    std::map<LabelImagePixelType, std::vector<long> > otherFIDs;
 
     otb::ogr::DataSource::Pointer ogrDS;
     otb::ogr::Layer layer(ITK_NULLPTR, false);
@@ -191,16 +228,34 @@ private:
     layer.CreateField(field, true);
     }
 
-    //Vectorization per tile
-    otbAppLogINFO(<<"Vectorization ...");
-    for(unsigned int row = 0; row < nbTilesY; row++)
+    //Vectorization per tile, by batches of one tile per thread. The tiles
+    //of a batch are polygonized concurrently, then their polygons are
+    //written in tile order by this thread only.
+    const unsigned int nbTiles = nbTilesX * nbTilesY;
+    const unsigned int nbThreads = std::max<unsigned int>(1, itk::MultiThreader::GetGlobalDefaultNumberOfThreads());
+    itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+
+    otbAppLogINFO(<<"Vectorization on "<<nbThreads<<" threads ...");
+    for(unsigned int first = 0; first < nbTiles; first += nbThreads)
       {
-      for(unsigned int column = 0; column < nbTilesX; column++)
-       {
+      const unsigned int last = std::min(nbTiles, first + nbThreads);
+      std::vector<VectorizationTile> tiles(last - first);
+
+      // The tiles are extracted one after the other, since they share the
+      // input pipelines
+      for(unsigned int t = first; t < last; ++t)
+        {
+        const unsigned int row = t / nbTilesX;
+        const unsigned int column = t % nbTilesX;
+
         unsigned long startX = column*sizeTilesX;
         unsigned long startY = row*sizeTilesY;
         unsigned long sizeX = vcl_min(sizeTilesX,sizeImageX-startX);
-          unsigned long sizeY = vcl_min(sizeTilesY,sizeImageY-startY);
+        unsigned long sizeY = vcl_min(sizeTilesY,sizeImageY-startY);
+
+        VectorizationTile & tile = tiles[t - first];
+        tile.CoreSize[0] = sizeX;
+        tile.CoreSize[1] = sizeY;
 
         //Tiles extraction of the input image
         MultiChannelExtractROIFilterType::Pointer imageROI = MultiChannelExtractROIFilterType::New();
@@ -210,105 +265,109 @@ private:
         imageROI->SetSizeX(sizeX);
         imageROI->SetSizeY(sizeY);
         imageROI->Update();
+        tile.Image = imageROI->GetOutput();
+        tile.Image->DisconnectPipeline();
 
-        //Tiles extraction of the segmented image
+        //Tiles extraction of the segmented image, with a one pixel margin
+        //so that the polygons of adjacent tiles overlap
         ExtractROIFilterType::Pointer labelImageROI = ExtractROIFilterType::New();
         labelImageROI->SetInput(labelIn);
         labelImageROI->SetStartX(startX);
         labelImageROI->SetStartY(startY);
-        labelImageROI->SetSizeX(sizeX);
-        labelImageROI->SetSizeY(sizeY);
+        labelImageROI->SetSizeX(sizeX+1);
+        labelImageROI->SetSizeY(sizeY+1);
         labelImageROI->Update();
+        tile.Labels = labelImageROI->GetOutput();
+        tile.Labels->DisconnectPipeline();
+
+        //Raster->Vecteur conversion, run on the thread pool
+        tile.Vectorizer = LabelImageToOGRDataSourceFilterType::New();
+        tile.Vectorizer->SetInput(tile.Labels);
+        tile.Vectorizer->SetInputMask(tile.Labels);
+        tile.Vectorizer->SetFieldName("label");
+        }
+
+      VectorizationThreadStruct str;
+      str.Tiles = &tiles;
+      threader->SetNumberOfThreads(last - first);
+      threader->SetSingleMethod(VectorizeTilesCallback, &str);
+      threader->SingleMethodExecute();
+
+      for(unsigned int t = first; t < last; ++t)
+        {
+        VectorizationTile & tile = tiles[t - first];
+        if(!tile.Error.empty())
+          {
+          otbAppLogFATAL(<<"Vectorization of tile "<<t<<" failed: "<<tile.Error);
+          }
 
-        //Sums calculation for the mean and the variance calculation per label
-        LabelImageIterator itLabel( labelImageROI->GetOutput(), labelImageROI->GetOutput()->GetLargestPossibleRegion());
-        ImageIterator itImage( imageROI->GetOutput(), imageROI->GetOutput()->GetLargestPossibleRegion());
+        //Sums calculation for the mean and the variance calculation per label,
+        //on the tile without its margin. They are accumulated in tile order and
+        //in single precision, so that the statistics do not depend on threading.
+        LabelImageType::RegionType coreRegion;
+        coreRegion.SetSize(tile.CoreSize);
+        LabelImageIterator itLabel(tile.Labels, coreRegion);
+        ImageIterator itImage(tile.Image, tile.Image->GetLargestPossibleRegion());
         for (itLabel.GoToBegin(), itImage.GoToBegin(); !itImage.IsAtEnd(); ++itLabel, ++itImage)
           {
-          nbPixels[itLabel.Value()]++;
+          const LabelImagePixelType label = itLabel.Get();
+          nbPixels[label]++;
           for(unsigned int comp = 0; comp<numberOfComponentsPerPixel; ++comp)
             {
-            sum[itLabel.Value()][comp]+=itImage.Get()[comp];
-            sum2[itLabel.Value()][comp]+=itImage.Get()[comp]*itImage.Get()[comp];
+            const float value = itImage.Get()[comp];
+            sum[label*numberOfComponentsPerPixel+comp]+=value;
+            sum2[label*numberOfComponentsPerPixel+comp]+=value*value;
             }
           }
+        tile.Image = ITK_NULLPTR;
+        tile.Labels = ITK_NULLPTR;
 
-        labelImageROI = ExtractROIFilterType::New();
-        labelImageROI->SetInput(labelIn);
-        labelImageROI->SetStartX(startX);
-        labelImageROI->SetStartY(startY);
-        labelImageROI->SetSizeX(sizeX+1);
-        labelImageROI->SetSizeY(sizeY+1);
-        labelImageROI->Update();
-
-        //Raster->Vecteur conversion
-        LabelImageToOGRDataSourceFilterType::Pointer labelToOGR = LabelImageToOGRDataSourceFilterType::New();
-        labelToOGR->SetInput(labelImageROI->GetOutput());
-        labelToOGR->SetInputMask(labelImageROI->GetOutput());
-        labelToOGR->SetFieldName("label");
-        labelToOGR->Update();
-
-        otb::ogr::DataSource::ConstPointer ogrDSTmp = labelToOGR->GetOutput();
-        otb::ogr::Layer layerTmp = ogrDSTmp->GetLayerChecked(0);
-
+        //Polygons of the tile
+        otb::ogr::Layer layerTmp = tile.Polygons->GetLayerChecked(0);
         otb::ogr::Layer::const_iterator featIt = layerTmp.begin();
         for(; featIt!=layerTmp.end(); ++featIt)
           {
+          LabelImagePixelType curLabel = (*featIt).ogr().GetFieldAsInteger("label");
           otb::ogr::Feature dstFeature(layer.GetLayerDefn());
           dstFeature.SetFrom( *featIt, TRUE );
           layer.CreateFeature( dstFeature );
+          if(firstFIDs[curLabel] == OGRNullFID)
+            {
+            firstFIDs[curLabel] = dstFeature.GetFID();
+            }
+          else
+            {
+            otherFIDs[curLabel].push_back(dstFeature.GetFID());
+            }
           }
-       }
+        tile.Polygons = ITK_NULLPTR;
+        }
       }
 
-    //Sorting by increasing label of the features
-    std::ostringstream sqloss;
-    sqloss.str("");
-    sqloss<<"SELECT * FROM \""<<layername<<"\" ORDER BY label";
-    otb::ogr::Layer layerTmp=ogrDS->ExecuteSQL(sqloss.str().c_str(), ITK_NULLPTR, ITK_NULLPTR);
-    otb::ogr::Feature firstFeature = layerTmp.ogr().GetNextFeature();
-
-    //Geometry fusion
+    //Geometry fusion, only for the labels split by tiles
     otbAppLogINFO("Merging polygons across tiles ...");
-    while(firstFeature.addr())
+    for(LabelImagePixelType curLabel = 1; curLabel <= regionCount; ++curLabel)
       {
-      LabelImagePixelType curLabel = firstFeature.ogr().GetFieldAsInteger("label");
-
-      //Creation of a multipolygon where are stored the geometries to be merged
-      OGRMultiPolygon geomToMerge;
-      geomToMerge.addGeometry(firstFeature.GetGeometry());
-      bool merging = true;
-      otb::ogr::Feature nextFeature(ITK_NULLPTR);
-      bool haveMerged=false;
-
-      while(merging)
+      if(firstFIDs[curLabel] == OGRNullFID)
         {
-        nextFeature = layerTmp.ogr().GetNextFeature();
-
-        if(nextFeature.addr())
-          {
-          LabelImagePixelType newLabel = nextFeature.ogr().GetFieldAsInteger("label");
-          merging=(newLabel==curLabel);
+        continue;
+        }
+      otb::ogr::Feature firstFeature = layer.GetFeature(firstFIDs[curLabel]);
 
-          //Storing of the new geometry if labels are identical
-          if(merging)
-            {
-            geomToMerge.addGeometry(nextFeature.GetGeometry());
-            layer.DeleteFeature(nextFeature.GetFID());
-            haveMerged=true;
-            }
-          //If storing made and new label -> polygons fusion
-          else if(haveMerged)
-            {
-            otb::ogr::UniqueGeometryPtr fusionPolygon = otb::ogr::UnionCascaded(geomToMerge);
-            firstFeature.SetGeometry(fusionPolygon.get());
-            }
-          }
-        //If end of list : end of loop
-        else
+      std::map<LabelImagePixelType, std::vector<long> >::const_iterator otherIt = otherFIDs.find(curLabel);
+      if(otherIt != otherFIDs.end())
+        {
+        //Creation of a multipolygon where are stored the geometries to be merged
+        OGRMultiPolygon geomToMerge;
+        geomToMerge.addGeometry(firstFeature.GetGeometry());
+        for(std::vector<long>::const_iterator fidIt = otherIt->second.begin(); fidIt != otherIt->second.end(); ++fidIt)
           {
-          merging=false;
+          otb::ogr::Feature nextFeature = layer.GetFeature(*fidIt);
+          geomToMerge.addGeometry(nextFeature.GetGeometry());
+          layer.DeleteFeature(*fidIt);
           }
+        otb::ogr::UniqueGeometryPtr fusionPolygon = otb::ogr::UnionCascaded(geomToMerge);
+        firstFeature.SetGeometry(fusionPolygon.get());
         }
 
       //Features calculation
@@ -319,7 +378,7 @@ private:
       for(unsigned int comp = 0; comp<numberOfComponentsPerPixel; ++comp){
       std::ostringstream fieldoss;
       fieldoss<<"meanB"<<comp;
-      firstFeature.ogr().SetField(fieldoss.str().c_str(),sum[curLabel][comp]/nbPixels[curLabel]);
+      firstFeature.ogr().SetField(fieldoss.str().c_str(),sum[curLabel*numberOfComponentsPerPixel+comp]/nbPixels[curLabel]);
       }
 
       //Variances per label
@@ -327,8 +386,9 @@ private:
       std::ostringstream fieldoss;
       fieldoss<<"varB"<<comp;
       float var = 0;
+      const float curSum = sum[curLabel*numberOfComponentsPerPixel+comp];
       if (nbPixels[curLabel]!=1)
-        var = (sum2[curLabel][comp]-sum[curLabel][comp]*sum[curLabel][comp]/nbPixels[curLabel])/(nbPixels[curLabel]-1);
+        var = (sum2[curLabel*numberOfComponentsPerPixel+comp]-curSum*curSum/nbPixels[curLabel])/(nbPixels[curLabel]-1);
       firstFeature.ogr().SetField(fieldoss.str().c_str(),var);
       }
 
@@ -337,9 +397,6 @@ private:
       firstFeature.SetGeometryDirectly(otb::ogr::Simplify(*geom,0));
 
       layer.SetFeature(firstFeature);
-
-      //Next geometry
-      firstFeature=nextFeature;
       }
 
     const OGRErr err = layer.ogr().CommitTransaction();
@@ -350,7 +407,7 @@ private:
     }
 
     if(extension==".shp"){
-    sqloss.str("");
+    std::ostringstream sqloss;
     sqloss<<"REPACK "<<layername;
     ogrDS->ogr().ExecuteSQL(sqloss.str().c_str(), ITK_NULLPTR, ITK_NULLPTR);
     }
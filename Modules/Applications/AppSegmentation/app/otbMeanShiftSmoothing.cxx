@@ -23,6 +23,8 @@
 
 #include "otbMeanShiftSmoothingImageFilter.h"
 
+#include <sstream>
+
 namespace otb
 {
 namespace Wrapper
@@ -159,6 +161,44 @@ private:
       }
    }
 
+  void AfterExecuteAndWriteOutputs() ITK_OVERRIDE
+  {
+    // Report the distribution of the number of iterations
+    const std::vector<unsigned long> & histogram = m_Filter->GetIterationHistogram();
+    unsigned long nbPixels = 0;
+    double sumIterations = 0.;
+    for (unsigned int i = 0; i < histogram.size(); ++i)
+      {
+      nbPixels += histogram[i];
+      sumIterations += static_cast<double>(i) * histogram[i];
+      }
+    if (nbPixels == 0)
+      {
+      return;
+      }
+
+    otbAppLogINFO(<<"Mean shift iterations computed for " << nbPixels << " pixels, "
+                  << sumIterations / nbPixels << " iterations per pixel on average.");
+    // Print the quartiles of the distribution and the number of pixels which
+    // did not converge
+    const double quantiles[3] = {0.25, 0.5, 0.75};
+    unsigned int q = 0;
+    unsigned long cumulated = 0;
+    std::ostringstream oss;
+    for (unsigned int i = 0; i < histogram.size() && q < 3; ++i)
+      {
+      cumulated += histogram[i];
+      while (q < 3 && cumulated >= quantiles[q] * nbPixels)
+        {
+        oss << " " << quantiles[q] * 100 << "%: " << i;
+        ++q;
+        }
+      }
+    otbAppLogINFO(<<"Iterations quartiles:" << oss.str());
+    otbAppLogINFO(<<histogram.back() << " pixels ("
+                  << 100. * histogram.back() / nbPixels << "%) used the maximum number of iterations.");
+  }
+
   MSFilterType::Pointer m_Filter;
 
 };
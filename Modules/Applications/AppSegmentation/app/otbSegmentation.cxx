@@ -30,6 +30,8 @@
 #include "otbVectorImageToAmplitudeImageFilter.h"
 #include "itkGradientMagnitudeImageFilter.h"
 #include "otbWatershedSegmentationFilter.h"
+#include "otbStreamingWatershedImageFilter.h"
+#include "otbWatershedLabelImageFilter.h"
 #include "otbMorphologicalProfilesSegmentationFilter.h"
 
 // Large scale vectorization framework
@@ -94,6 +96,12 @@ public:
   typedef otb::WatershedSegmentationFilter
   <FloatImageType,LabelImageType>         WatershedSegmentationFilterType;
 
+  typedef otb::StreamingWatershedImageFilter
+  <FloatImageType>                        StreamingWatershedFilterType;
+
+  typedef otb::WatershedLabelImageFilter
+  <FloatImageType,LabelImageType>         WatershedLabelFilterType;
+
   // Geodesic morphology multiscale segmentation
   typedef otb::MorphologicalProfilesSegmentationFilter<FloatImageType,LabelImageType> MorphologicalProfilesSegmentationFilterType;
 
@@ -154,7 +162,7 @@ private:
                           " (i.e. remove nodes in polygons) according to a user-defined tolerance. The stitch option tries to stitch together the polygons corresponding"
                           " to segmented region that may have been split by the tiling scheme. ");
 
-    SetDocLimitations("In raster mode, the application can not handle large input images. Stitching step of vector mode might become slow with very large input images."
+    SetDocLimitations("In raster mode, the application can not handle large input images, except for the watershed with the streaming option. Stitching step of vector mode might become slow with very large input images."
                      " \nMeanShift filter results depends on the number of threads used. \nWatershed and multiscale geodesic morphology segmentation will be performed on the amplitude "
                      " of the input image.");
 
@@ -222,6 +230,10 @@ private:
     SetMinimumParameterFloatValue("filter.watershed.level",0);
     SetMaximumParameterFloatValue("filter.watershed.level",1);
 
+    AddParameter(ParameterType_Empty,"filter.watershed.streaming","Streamed flooding");
+    SetParameterDescription("filter.watershed.streaming","In raster mode, flood the image by blocks and merge the basins across block borders, instead of loading the whole image into memory. Watershed lines near block borders may slightly differ from the ones of the standard flooding.");
+    MandatoryOff("filter.watershed.streaming");
+
     AddParameter(ParameterType_Choice, "mode", "Processing mode");
     SetParameterDescription("mode", "Choice of processing mode, either raster or large-scale.");
 
@@ -610,6 +622,32 @@ private:
             GradientMagnitudeFilterType::Pointer gradientMagnitudeFilter = GradientMagnitudeFilterType::New();
             gradientMagnitudeFilter->SetInput(amplitudeFilter->GetOutput());
 
+            if (segModeType == "raster" && IsParameterEnabled("filter.watershed.streaming"))
+              {
+              // The label image is streamed by the writer of the output
+              m_AmplitudeFilter = amplitudeFilter;
+              m_GradientMagnitudeFilter = gradientMagnitudeFilter;
+
+              m_WatershedFlooding = StreamingWatershedFilterType::New();
+              m_WatershedFlooding->SetInput(gradientMagnitudeFilter->GetOutput());
+              m_WatershedFlooding->SetThreshold(GetParameterFloat("filter.watershed.threshold"));
+              m_WatershedFlooding->GetStreamer()->SetAutomaticAdaptativeStreaming();
+              AddProcess(m_WatershedFlooding->GetStreamer(), "Flooding the gradient");
+              m_WatershedFlooding->Update();
+
+              m_WatershedLabels = WatershedLabelFilterType::New();
+              m_WatershedLabels->SetInput(gradientMagnitudeFilter->GetOutput());
+              m_WatershedLabels->SetFlooding(m_WatershedFlooding->GetFilter());
+              m_WatershedLabels->SetLevel(GetParameterFloat("filter.watershed.level"));
+              otbAppLogINFO(<< m_WatershedFlooding->GetNumberOfBasins() << " basins merged into "
+                            << m_WatershedLabels->GetNumberOfObjects() << " segments");
+
+              DisableParameter("mode.vector.out");
+              EnableParameter("mode.raster.out");
+              SetParameterOutputImage<UInt32ImageType>("mode.raster.out", m_WatershedLabels->GetOutput());
+              return;
+              }
+
             StreamingVectorizedWatershedFilterType::Pointer
                 watershedVectorizedFilter = StreamingVectorizedWatershedFilterType::New();
 
@@ -694,6 +732,11 @@ private:
        }
       }
   }
+
+  AmplitudeFilterType::Pointer          m_AmplitudeFilter;
+  GradientMagnitudeFilterType::Pointer  m_GradientMagnitudeFilter;
+  StreamingWatershedFilterType::Pointer m_WatershedFlooding;
+  WatershedLabelFilterType::Pointer     m_WatershedLabels;
 };
 }
 }
@@ -97,6 +97,10 @@ SetDefaultParameterInt("step", 1);
 SetMinimumParameterIntValue("step", 1);
 MandatoryOff("step");
 
+AddParameter(ParameterType_Empty, "slidingwindow", "Sliding window");
+SetParameterDescription("slidingwindow", "If activated, the co-occurrences of each pixel are updated from the ones of the previous pixel on the same line instead of being computed again over the whole window. This is faster for large radii, but texture values may differ in the last digits. Only used by the simple and advanced texture sets.");
+MandatoryOff("slidingwindow");
+
 AddRAMParameter();
 
 AddParameter(ParameterType_Group, "parameters", "Texture feature parameters");
@@ -232,6 +236,7 @@ void DoExecute() ITK_OVERRIDE
     m_HarTexFilter->SetNumberOfBinsPerAxis(GetParameterInt("parameters.nbbin"));
     m_HarTexFilter->SetSubsampleFactor(stepping);
     m_HarTexFilter->SetSubsampleOffset(stepOffset);
+    m_HarTexFilter->SetSlidingWindow(IsParameterEnabled("slidingwindow"));
     m_HarTexFilter->UpdateOutputInformation();
     m_HarImageList->PushBack(m_HarTexFilter->GetEnergyOutput());
     m_HarImageList->PushBack(m_HarTexFilter->GetEntropyOutput());
@@ -255,6 +260,7 @@ void DoExecute() ITK_OVERRIDE
     m_AdvTexFilter->SetNumberOfBinsPerAxis(GetParameterInt("parameters.nbbin"));
     m_AdvTexFilter->SetSubsampleFactor(stepping);
     m_AdvTexFilter->SetSubsampleOffset(stepOffset);
+    m_AdvTexFilter->SetSlidingWindow(IsParameterEnabled("slidingwindow"));
     m_AdvImageList->PushBack(m_AdvTexFilter->GetMeanOutput());
     m_AdvImageList->PushBack(m_AdvTexFilter->GetVarianceOutput());
     m_AdvImageList->PushBack(m_AdvTexFilter->GetDissimilarityOutput());
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef otbMemoryMappedFile_h
+#define otbMemoryMappedFile_h
+
+#include "itkLightObject.h"
+#include "itkObjectFactory.h"
+
+#include "OTBCommonExport.h"
+
+#include <string>
+#include <cstddef>
+
+namespace otb
+{
+
+/** \class MemoryMappedFile
+ * \brief Read-only memory mapping of a whole file
+ *
+ * The file content is mapped in the address space of the process
+ * (mmap on POSIX systems, MapViewOfFile on Windows) instead of being
+ * read. Pages are loaded on demand, and processes mapping the same file
+ * share the same physical pages.
+ *
+ * The object is reference counted, so that several owners can keep
+ * pointers in the mapped data. The file is unmapped when the last
+ * reference is released.
+ *
+ * \ingroup OTBCommon
+ */
+class OTBCommon_EXPORT MemoryMappedFile : public itk::LightObject
+{
+public:
+  /** Standard class typedefs. */
+  typedef MemoryMappedFile              Self;
+  typedef itk::LightObject              Superclass;
+  typedef itk::SmartPointer<Self>       Pointer;
+  typedef itk::SmartPointer<const Self> ConstPointer;
+
+  itkNewMacro(Self);
+  itkTypeMacro(MemoryMappedFile, itk::LightObject);
+
+  /** Map the whole file. Throws an itk::ExceptionObject on failure. */
+  void Open(const std::string & filename);
+
+  /** Unmap the file */
+  void Close();
+
+  bool IsOpen() const
+  {
+    return m_Data != ITK_NULLPTR;
+  }
+
+  /** Start of the mapped data */
+  const char * GetData() const
+  {
+    return m_Data;
+  }
+
+  /** Size of the mapped data, in bytes */
+  size_t GetSize() const
+  {
+    return m_Size;
+  }
+
+  const std::string & GetFileName() const
+  {
+    return m_FileName;
+  }
+
+protected:
+  MemoryMappedFile();
+  ~MemoryMappedFile() ITK_OVERRIDE;
+
+private:
+  MemoryMappedFile(const Self &); //purposely not implemented
+  void operator =(const Self&); //purposely not implemented
+
+  const char * m_Data;
+  size_t       m_Size;
+  std::string  m_FileName;
+  /** Platform handles (file and mapping object on Windows) */
+  void *       m_FileHandle;
+  void *       m_MappingHandle;
+};
+
+} // end namespace otb
+
+#endif
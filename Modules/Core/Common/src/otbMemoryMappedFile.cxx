@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "otbMemoryMappedFile.h"
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+#  include <windows.h>
+#else
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <sys/mman.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+namespace otb
+{
+
+MemoryMappedFile::MemoryMappedFile()
+  : m_Data(ITK_NULLPTR),
+    m_Size(0),
+    m_FileName(),
+    m_FileHandle(ITK_NULLPTR),
+    m_MappingHandle(ITK_NULLPTR)
+{
+}
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+  this->Close();
+}
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+
+void
+MemoryMappedFile::Open(const std::string & filename)
+{
+  this->Close();
+
+  HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE)
+    {
+    itkGenericExceptionMacro(<< "Can't open file " << filename);
+    }
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+    CloseHandle(file);
+    itkGenericExceptionMacro(<< "Can't map empty file " << filename);
+    }
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (mapping == NULL)
+    {
+    CloseHandle(file);
+    itkGenericExceptionMacro(<< "Can't create a mapping of file " << filename);
+    }
+  const void * data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (data == NULL)
+    {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    itkGenericExceptionMacro(<< "Can't map file " << filename);
+    }
+
+  m_Data = static_cast<const char *>(data);
+  m_Size = static_cast<size_t>(size.QuadPart);
+  m_FileName = filename;
+  m_FileHandle = file;
+  m_MappingHandle = mapping;
+}
+
+void
+MemoryMappedFile::Close()
+{
+  if (m_Data != ITK_NULLPTR)
+    {
+    UnmapViewOfFile(m_Data);
+    CloseHandle(static_cast<HANDLE>(m_MappingHandle));
+    CloseHandle(static_cast<HANDLE>(m_FileHandle));
+    }
+  m_Data = ITK_NULLPTR;
+  m_Size = 0;
+  m_FileName.clear();
+  m_FileHandle = ITK_NULLPTR;
+  m_MappingHandle = ITK_NULLPTR;
+}
+
+#else
+
+void
+MemoryMappedFile::Open(const std::string & filename)
+{
+  this->Close();
+
+  const int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    {
+    itkGenericExceptionMacro(<< "Can't open file " << filename);
+    }
+  struct stat status;
+  if (fstat(fd, &status) != 0 || status.st_size == 0)
+    {
+    close(fd);
+    itkGenericExceptionMacro(<< "Can't map empty file " << filename);
+    }
+  const size_t size = static_cast<size_t>(status.st_size);
+  void * data = mmap(ITK_NULLPTR, size, PROT_READ, MAP_SHARED, fd, 0);
+  // the mapping stays valid once the descriptor is closed
+  close(fd);
+  if (data == MAP_FAILED)
+    {
+    itkGenericExceptionMacro(<< "Can't map file " << filename);
+    }
+
+  m_Data = static_cast<const char *>(data);
+  m_Size = size;
+  m_FileName = filename;
+}
+
+void
+MemoryMappedFile::Close()
+{
+  if (m_Data != ITK_NULLPTR)
+    {
+    munmap(const_cast<char *>(m_Data), m_Size);
+    }
+  m_Data = ITK_NULLPTR;
+  m_Size = 0;
+  m_FileName.clear();
+}
+
+#endif
+
+} // end namespace otb
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef otbSampledTiledStreamingManager_h
+#define otbSampledTiledStreamingManager_h
+
+#include "otbStreamingManager.h"
+#include <vector>
+
+namespace otb
+{
+
+/** \class SampledTiledStreamingManager
+ *  \brief This class streams a spatially stratified random subset of the
+ *  square tiles of an image
+ *
+ * The region is divided in square tiles of dimension TileDimension (as in
+ * TileDimensionTiledStreamingManager). The tiles are then ordered in a
+ * random but stratified way: for any n, the first n tiles of the order are
+ * spread regularly over the image (bit-reversal ordering of the tile
+ * indices, shifted by a random offset drawn from Seed).
+ *
+ * Only the tiles of positions [FirstSampledTile, FirstSampledTile +
+ * NumberOfSampledTiles) in this order are streamed. Since the order only
+ * depends on the region, the tile dimension and the seed, successive calls
+ * with contiguous ranges stream disjoint tiles, which allows a persistent
+ * filter to extend a sample without reading the same tile twice.
+ *
+ * If NumberOfSampledTiles is 0, all the tiles from FirstSampledTile are
+ * streamed.
+ *
+ * \sa TileDimensionTiledStreamingManager
+ * \sa StreamingImageVirtualWriter
+ *
+ * \ingroup OTBStreaming
+ */
+template<class TImage>
+class ITK_EXPORT SampledTiledStreamingManager : public StreamingManager<TImage>
+{
+public:
+  /** Standard class typedefs. */
+  typedef SampledTiledStreamingManager  Self;
+  typedef StreamingManager<TImage>      Superclass;
+  typedef itk::SmartPointer<Self>       Pointer;
+  typedef itk::SmartPointer<const Self> ConstPointer;
+
+  typedef TImage                          ImageType;
+  typedef typename Superclass::RegionType RegionType;
+
+  /** Creation through object factory macro */
+  itkNewMacro(Self);
+
+  /** Type macro */
+  itkTypeMacro(SampledTiledStreamingManager, StreamingManager);
+
+  /** Dimension of input image. */
+  itkStaticConstMacro(ImageDimension, unsigned int, ImageType::ImageDimension);
+
+  /** The desired tile dimension */
+  itkSetMacro(TileDimension, unsigned int);
+  itkGetMacro(TileDimension, unsigned int);
+
+  /** Seed of the random offset of the tile order */
+  itkSetMacro(Seed, unsigned int);
+  itkGetMacro(Seed, unsigned int);
+
+  /** Position of the first streamed tile in the sampling order */
+  itkSetMacro(FirstSampledTile, unsigned int);
+  itkGetMacro(FirstSampledTile, unsigned int);
+
+  /** Number of streamed tiles (0 means all the remaining tiles) */
+  itkSetMacro(NumberOfSampledTiles, unsigned int);
+  itkGetMacro(NumberOfSampledTiles, unsigned int);
+
+  /** Actually computes the stream divisions */
+  void PrepareStreaming(itk::DataObject * input, const RegionType &region) ITK_OVERRIDE;
+
+  /** Number of tiles streamed */
+  unsigned int GetNumberOfSplits() ITK_OVERRIDE;
+
+  /** Region of the ith streamed tile */
+  RegionType GetSplit(unsigned int i) ITK_OVERRIDE;
+
+  /** Total number of tiles in the region. PrepareStreaming() must have been
+   * called before. */
+  unsigned int GetNumberOfTiles() const
+  {
+    return this->m_ComputedNumberOfSplits;
+  }
+
+protected:
+  SampledTiledStreamingManager();
+  ~SampledTiledStreamingManager() ITK_OVERRIDE;
+
+  unsigned int m_TileDimension;
+  unsigned int m_Seed;
+  unsigned int m_FirstSampledTile;
+  unsigned int m_NumberOfSampledTiles;
+
+  /** Tile indices in sampling order */
+  std::vector<unsigned int> m_TileOrder;
+
+private:
+  SampledTiledStreamingManager(const SampledTiledStreamingManager &); //purposely not implemented
+  void operator =(const SampledTiledStreamingManager&); //purposely not implemented
+};
+
+} // End namespace otb
+
+#ifndef OTB_MANUAL_INSTANTIATION
+#include "otbSampledTiledStreamingManager.txx"
+#endif
+
+#endif
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef otbSampledTiledStreamingManager_txx
+#define otbSampledTiledStreamingManager_txx
+
+#include "otbSampledTiledStreamingManager.h"
+#include "otbMacro.h"
+#include "otbImageRegionSquareTileSplitter.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+
+namespace otb
+{
+
+template <class TImage>
+SampledTiledStreamingManager<TImage>::SampledTiledStreamingManager()
+  : m_TileDimension(256),
+    m_Seed(0),
+    m_FirstSampledTile(0),
+    m_NumberOfSampledTiles(0)
+{
+}
+
+template <class TImage>
+SampledTiledStreamingManager<TImage>::~SampledTiledStreamingManager()
+{
+}
+
+template <class TImage>
+void
+SampledTiledStreamingManager<TImage>::PrepareStreaming( itk::DataObject * /*input*/, const RegionType &region )
+{
+  if (m_TileDimension < 16)
+    {
+    itkWarningMacro(<< "TileDimension inferior to 16 : using 16 as tile dimension")
+    m_TileDimension = 16;
+    }
+
+  this->m_Splitter = otb::ImageRegionSquareTileSplitter<itkGetStaticConstMacro(ImageDimension)>::New();
+  unsigned int nbDesiredTiles =
+    itk::Math::Ceil<unsigned int>( double(region.GetNumberOfPixels() ) / (m_TileDimension * m_TileDimension) );
+  this->m_ComputedNumberOfSplits = this->m_Splitter->GetNumberOfSplits(region, nbDesiredTiles);
+  this->m_Region = region;
+
+  // Bit-reversal order over the next power of two, shifted by a random
+  // offset: any prefix of the order is a systematic sample of the tiles
+  const unsigned int nbTiles = this->m_ComputedNumberOfSplits;
+  unsigned int nbBits = 0;
+  while ((1UL << nbBits) < nbTiles)
+    {
+    ++nbBits;
+    }
+  const unsigned long period = 1UL << nbBits;
+
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator GeneratorType;
+  GeneratorType::Pointer generator = GeneratorType::New();
+  generator->Initialize(m_Seed);
+  const unsigned long offset = generator->GetIntegerVariate(static_cast<GeneratorType::IntegerType>(period - 1));
+
+  m_TileOrder.clear();
+  m_TileOrder.reserve(nbTiles);
+  for (unsigned long k = 0; k < period; ++k)
+    {
+    unsigned long reversed = 0;
+    for (unsigned int b = 0; b < nbBits; ++b)
+      {
+      reversed |= ((k >> b) & 1UL) << (nbBits - 1 - b);
+      }
+    const unsigned long tile = (reversed + offset) % period;
+    if (tile < nbTiles)
+      {
+      m_TileOrder.push_back(static_cast<unsigned int>(tile));
+      }
+    }
+}
+
+template <class TImage>
+unsigned int
+SampledTiledStreamingManager<TImage>::GetNumberOfSplits()
+{
+  const unsigned int nbTiles = static_cast<unsigned int>(m_TileOrder.size());
+  if (m_FirstSampledTile >= nbTiles)
+    {
+    return 0;
+    }
+  const unsigned int remaining = nbTiles - m_FirstSampledTile;
+  if (m_NumberOfSampledTiles == 0 || m_NumberOfSampledTiles > remaining)
+    {
+    return remaining;
+    }
+  return m_NumberOfSampledTiles;
+}
+
+template <class TImage>
+typename SampledTiledStreamingManager<TImage>::RegionType
+SampledTiledStreamingManager<TImage>::GetSplit(unsigned int i)
+{
+  RegionType region( this->m_Region );
+  this->m_Splitter->GetSplit(m_TileOrder[m_FirstSampledTile + i], this->m_ComputedNumberOfSplits, region);
+  return region;
+}
+
+} // End namespace otb
+
+#endif
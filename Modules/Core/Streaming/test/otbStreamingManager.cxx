@@ -25,8 +25,10 @@
 #include "otbTileDimensionTiledStreamingManager.h"
 #include "otbRAMDrivenTiledStreamingManager.h"
 #include "otbRAMDrivenAdaptativeStreamingManager.h"
+#include "otbSampledTiledStreamingManager.h"
 
 #include <fstream>
+#include <vector>
 
 const int Dimension = 2;
 typedef otb::VectorImage<unsigned short, Dimension>           ImageType;
@@ -35,6 +37,7 @@ typedef otb::RAMDrivenStrippedStreamingManager<ImageType>     RAMDrivenStrippedS
 typedef otb::TileDimensionTiledStreamingManager<ImageType>    TileDimensionTiledStreamingManagerType;
 typedef otb::RAMDrivenTiledStreamingManager<ImageType>        RAMDrivenTiledStreamingManagerType;
 typedef otb::RAMDrivenAdaptativeStreamingManager<ImageType>        RAMDrivenAdaptativeStreamingManagerType;
+typedef otb::SampledTiledStreamingManager<ImageType>          SampledTiledStreamingManagerType;
 
 
 ImageType::Pointer makeImage(ImageType::RegionType region)
@@ -69,6 +72,9 @@ int otbStreamingManagerNew(int itkNotUsed(argc), char * itkNotUsed(argv) [])
   RAMDrivenAdaptativeStreamingManagerType::Pointer streamingManager5 = RAMDrivenAdaptativeStreamingManagerType::New();
   std::cout<<streamingManager5<<std::endl;
 
+  SampledTiledStreamingManagerType::Pointer streamingManager6 = SampledTiledStreamingManagerType::New();
+  std::cout<<streamingManager6<<std::endl;
+
   return EXIT_SUCCESS;
 }
 
@@ -230,3 +236,81 @@ int otbRAMDrivenAdaptativeStreamingManager(int itkNotUsed(argc), char * argv[])
 
   return EXIT_SUCCESS;
 }
+
+int otbSampledTiledStreamingManager(int itkNotUsed(argc), char * itkNotUsed(argv) [])
+{
+  SampledTiledStreamingManagerType::Pointer streamingManager = SampledTiledStreamingManagerType::New();
+
+  ImageType::RegionType region;
+  region.SetIndex(0, 0);
+  region.SetIndex(1, 0);
+  region.SetSize(0, 10013);
+  region.SetSize(1, 5727);
+
+  streamingManager->SetTileDimension(256);
+  streamingManager->SetSeed(12);
+  streamingManager->PrepareStreaming( makeImage(region), region );
+
+  const unsigned int nbTiles = streamingManager->GetNumberOfTiles();
+  if (nbTiles == 0 || streamingManager->GetNumberOfSplits() != nbTiles)
+    {
+    std::cout << "All tiles should be streamed by default" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Two successive ranges must cover each pixel of the region exactly once
+  const unsigned int nbFirstTiles = nbTiles / 10;
+  itk::SizeValueType nbPixels = 0;
+  unsigned int nbSplits[2];
+
+  streamingManager->SetFirstSampledTile(0);
+  streamingManager->SetNumberOfSampledTiles(nbFirstTiles);
+  nbSplits[0] = streamingManager->GetNumberOfSplits();
+  std::vector<ImageType::RegionType> splits;
+  for (unsigned int i = 0; i < nbSplits[0]; ++i)
+    {
+    splits.push_back(streamingManager->GetSplit(i));
+    }
+
+  streamingManager->SetFirstSampledTile(nbFirstTiles);
+  streamingManager->SetNumberOfSampledTiles(0);
+  nbSplits[1] = streamingManager->GetNumberOfSplits();
+  for (unsigned int i = 0; i < nbSplits[1]; ++i)
+    {
+    splits.push_back(streamingManager->GetSplit(i));
+    }
+
+  if (nbSplits[0] != nbFirstTiles || nbSplits[0] + nbSplits[1] != nbTiles)
+    {
+    std::cout << "Wrong number of splits: " << nbSplits[0] << " + " << nbSplits[1]
+              << " for " << nbTiles << " tiles" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  for (unsigned int i = 0; i < splits.size(); ++i)
+    {
+    if (!region.IsInside(splits[i]))
+      {
+      std::cout << "Split " << splits[i] << " is outside the region" << std::endl;
+      return EXIT_FAILURE;
+      }
+    nbPixels += splits[i].GetNumberOfPixels();
+    for (unsigned int j = 0; j < i; ++j)
+      {
+      ImageType::RegionType intersection = splits[i];
+      if (intersection.Crop(splits[j]))
+        {
+        std::cout << "Splits " << i << " and " << j << " overlap" << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  if (nbPixels != region.GetNumberOfPixels())
+    {
+    std::cout << "The splits cover " << nbPixels << " pixels instead of " << region.GetNumberOfPixels() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
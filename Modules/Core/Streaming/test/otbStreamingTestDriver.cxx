@@ -28,6 +28,7 @@ void RegisterTests()
   REGISTER_TEST(otbTileDimensionTiledStreamingManager);
   REGISTER_TEST(otbRAMDrivenTiledStreamingManager);
   REGISTER_TEST(otbRAMDrivenAdaptativeStreamingManager);
+  REGISTER_TEST(otbSampledTiledStreamingManager);
   REGISTER_TEST(otbPipelineMemoryPrintCalculatorTest);
   REGISTER_TEST(otbPipelineMemoryPrintCalculatorNew);
 }
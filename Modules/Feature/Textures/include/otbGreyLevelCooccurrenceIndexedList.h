@@ -129,6 +129,14 @@ public:
   //m_InputImageMaximum. If so add to m_Vector via AddPairToVector method */
   void AddPixelPair(const PixelValueType& pixelvalue1, const PixelValueType& pixelvalue2);
 
+  /** Remove a pixel pair previously added with AddPixelPair. Pairs whose
+    * frequency drops to zero are removed from m_Vector, so that the list can
+    * be updated incrementally when a window slides over the image. */
+  void RemovePixelPair(const PixelValueType& pixelvalue1, const PixelValueType& pixelvalue2);
+
+  /** Remove all co-occurrence pairs, keeping the bins set by Initialize */
+  void Clear();
+
   /* Get the frequency value from Vector with index =[j,i] */
   RelativeFrequencyType GetFrequency(IndexValueType i, IndexValueType j);
 
@@ -146,6 +154,11 @@ protected:
     * co-occurrence pair is added again with index values swapped */
   void AddPairToVector(IndexType index);
 
+  /** decrement the frequency of the co-occurrence pair with given index. When
+    * it reaches zero, the pair is replaced by the last element of the vector
+    * and m_LookupArray is updated accordingly. */
+  void RemovePairFromVector(IndexType index);
+
   void SetBinMin(const unsigned int dimension, const InstanceIdentifier nbin,
                  PixelValueType min);
 
@@ -246,6 +246,55 @@ AddPixelPair(const PixelValueType& pixelvalue1, const PixelValueType& pixelvalue
     }
 }
 
+template <class TPixel >
+void
+GreyLevelCooccurrenceIndexedList<TPixel>::
+RemovePixelPair(const PixelValueType& pixelvalue1, const PixelValueType& pixelvalue2)
+{
+  // same bounds checks as AddPixelPair: rejected pairs were never added
+  if ( pixelvalue1 < m_InputImageMinimum
+       || pixelvalue1 > m_InputImageMaximum )
+    {
+    return;
+    }
+
+  if ( pixelvalue2 < m_InputImageMinimum
+       || pixelvalue2 > m_InputImageMaximum )
+    {
+    return;
+    }
+
+  IndexType index;
+  PixelPairType ppair( PixelPairSize);
+  ppair[0] = pixelvalue1;
+  ppair[1] = pixelvalue2;
+
+  this->GetIndex(ppair, index);
+  this->RemovePairFromVector(index);
+  if(m_Symmetry)
+    {
+    IndexValueType temp;
+    temp = index[0];
+    index[0] = index[1];
+    index[1] = temp;
+    this->RemovePairFromVector(index);
+    }
+}
+
+template <class TPixel >
+void
+GreyLevelCooccurrenceIndexedList<TPixel>::
+Clear()
+{
+  typename VectorType::const_iterator it;
+  for (it = m_Vector.begin(); it != m_Vector.end(); ++it)
+    {
+    m_LookupArray[(*it).first[1] * m_Size[0] + (*it).first[0]] = -1;
+    }
+  m_Vector.clear();
+  m_TotalFrequency = 0;
+}
+
 template <class TPixel>
 typename GreyLevelCooccurrenceIndexedList<TPixel>::RelativeFrequencyType
 GreyLevelCooccurrenceIndexedList<TPixel>::
@@ -309,6 +358,30 @@ GreyLevelCooccurrenceIndexedList<TPixel>
   m_TotalFrequency = m_TotalFrequency + 1;
 }
 
+template <class TPixel>
+void
+GreyLevelCooccurrenceIndexedList<TPixel>
+::RemovePairFromVector(IndexType index)
+{
+  InstanceIdentifier instanceId = index[1] * m_Size[0] + index[0];
+  int vindex = m_LookupArray[instanceId];
+  if( vindex < 0 )
+    {
+    return; // pair was never added
+    }
+
+  if( --m_Vector[vindex].second == 0 )
+    {
+    // move the last pair in the freed position
+    const CooccurrencePairType & last = m_Vector.back();
+    m_LookupArray[last.first[1] * m_Size[0] + last.first[0]] = vindex;
+    m_Vector[vindex] = last;
+    m_Vector.pop_back();
+    m_LookupArray[instanceId] = -1;
+    }
+  m_TotalFrequency = m_TotalFrequency - 1;
+}
+
 template <class TPixel>
 void
 GreyLevelCooccurrenceIndexedList<TPixel>
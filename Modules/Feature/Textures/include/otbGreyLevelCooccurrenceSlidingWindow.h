@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef otbGreyLevelCooccurrenceSlidingWindow_h
+#define otbGreyLevelCooccurrenceSlidingWindow_h
+
+#include "otbGreyLevelCooccurrenceIndexedList.h"
+
+namespace otb
+{
+/** \class GreyLevelCooccurrenceSlidingWindow
+ * \brief Maintain a GreyLevelCooccurrenceIndexedList over a window moving
+ * along the first image axis.
+ *
+ * The co-occurrence pairs of a window are the pairs (p, p + offset) for all
+ * pixels p of the window, provided p + offset lies in the buffered region of
+ * the image. This is the set of pairs built by the textures filters with an
+ * itk::ConstNeighborhoodIterator.
+ *
+ * When MoveTo() is called with a window covering the same lines as the
+ * current one and overlapping it, only the pairs of the columns leaving the
+ * window are removed and the pairs of the columns entering it are added. The
+ * update cost is then proportional to the window height instead of its area.
+ * In all other cases, the list is rebuilt from scratch.
+ *
+ * \sa otb::GreyLevelCooccurrenceIndexedList
+ * \sa otb::ScalarImageToTexturesFilter
+ * \sa otb::ScalarImageToAdvancedTexturesFilter
+ *
+ * \ingroup OTBTextures
+ */
+template <class TInputImage>
+class GreyLevelCooccurrenceSlidingWindow
+{
+public:
+  typedef GreyLevelCooccurrenceSlidingWindow   Self;
+
+  typedef TInputImage                          InputImageType;
+  typedef typename InputImageType::PixelType   InputPixelType;
+  typedef typename InputImageType::RegionType  RegionType;
+  typedef typename InputImageType::IndexType   IndexType;
+  typedef typename InputImageType::OffsetType  OffsetType;
+  typedef typename IndexType::IndexValueType   IndexValueType;
+
+  typedef GreyLevelCooccurrenceIndexedList< InputPixelType >     CooccurrenceIndexedListType;
+  typedef typename CooccurrenceIndexedListType::Pointer         CooccurrenceIndexedListPointerType;
+  typedef typename CooccurrenceIndexedListType::PixelValueType  PixelValueType;
+
+  GreyLevelCooccurrenceSlidingWindow();
+
+  /** Set the image, the co-occurrence offset and the bins of the list. The
+   *  window is empty after this call. */
+  void Initialize(const InputImageType * image, const OffsetType & offset,
+                  unsigned int nbBins, PixelValueType min, PixelValueType max);
+
+  /** Move the window to the given region, which must be inside the buffered
+   *  region of the image */
+  void MoveTo(const RegionType & window);
+
+  /** Co-occurrence list of the current window */
+  CooccurrenceIndexedListType * GetCooccurrenceIndexedList() const
+  {
+    return m_CooccurrenceIndexedList.GetPointer();
+  }
+
+private:
+  /** Add (or remove) the pairs of a single column of the current window */
+  void UpdateColumn(IndexValueType x, bool add);
+
+  /** Add (or remove) the pairs of the columns in [first, last] */
+  void UpdateColumns(IndexValueType first, IndexValueType last, bool add);
+
+  const InputImageType *             m_Image;
+  RegionType                         m_BufferedRegion;
+  OffsetType                         m_Offset;
+  RegionType                         m_Window;
+  bool                               m_IsEmpty;
+  CooccurrenceIndexedListPointerType m_CooccurrenceIndexedList;
+};
+
+} // End namespace otb
+
+#ifndef OTB_MANUAL_INSTANTIATION
+#include "otbGreyLevelCooccurrenceSlidingWindow.txx"
+#endif
+
+#endif
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef otbGreyLevelCooccurrenceSlidingWindow_txx
+#define otbGreyLevelCooccurrenceSlidingWindow_txx
+
+#include "otbGreyLevelCooccurrenceSlidingWindow.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include <algorithm>
+
+namespace otb
+{
+template <class TInputImage>
+GreyLevelCooccurrenceSlidingWindow<TInputImage>
+::GreyLevelCooccurrenceSlidingWindow()
+  : m_Image(ITK_NULLPTR),
+    m_BufferedRegion(),
+    m_Offset(),
+    m_Window(),
+    m_IsEmpty(true),
+    m_CooccurrenceIndexedList(CooccurrenceIndexedListType::New())
+{
+  m_Offset.Fill(0);
+}
+
+template <class TInputImage>
+void
+GreyLevelCooccurrenceSlidingWindow<TInputImage>
+::Initialize(const InputImageType * image, const OffsetType & offset,
+             unsigned int nbBins, PixelValueType min, PixelValueType max)
+{
+  m_Image = image;
+  m_BufferedRegion = image->GetBufferedRegion();
+  m_Offset = offset;
+  m_IsEmpty = true;
+  m_CooccurrenceIndexedList = CooccurrenceIndexedListType::New();
+  m_CooccurrenceIndexedList->Initialize(nbBins, min, max);
+}
+
+template <class TInputImage>
+void
+GreyLevelCooccurrenceSlidingWindow<TInputImage>
+::MoveTo(const RegionType & window)
+{
+  // The window can slide only if it covers the same lines as the current one
+  bool canSlide = !m_IsEmpty;
+  for (unsigned int dim = 1; canSlide && dim < InputImageType::ImageDimension; ++dim)
+    {
+    canSlide = (window.GetIndex(dim) == m_Window.GetIndex(dim)
+                && window.GetSize(dim) == m_Window.GetSize(dim));
+    }
+
+  const IndexValueType oldFirst = m_Window.GetIndex(0);
+  const IndexValueType oldLast  = oldFirst + static_cast<IndexValueType>(m_Window.GetSize(0)) - 1;
+  const IndexValueType newFirst = window.GetIndex(0);
+  const IndexValueType newLast  = newFirst + static_cast<IndexValueType>(window.GetSize(0)) - 1;
+
+  // ... and overlaps it
+  canSlide = canSlide && newFirst <= oldLast && oldFirst <= newLast;
+
+  if (!canSlide)
+    {
+    m_CooccurrenceIndexedList->Clear();
+    m_Window = window;
+    m_IsEmpty = (window.GetNumberOfPixels() == 0);
+    this->UpdateColumns(newFirst, newLast, true);
+    return;
+    }
+
+  // Remove the columns leaving the window
+  this->UpdateColumns(oldFirst, std::min(oldLast, newFirst - 1), false);
+  this->UpdateColumns(std::max(oldFirst, newLast + 1), oldLast, false);
+
+  // Add the columns entering the window
+  m_Window = window;
+  this->UpdateColumns(newFirst, std::min(newLast, oldFirst - 1), true);
+  this->UpdateColumns(std::max(newFirst, oldLast + 1), newLast, true);
+}
+
+template <class TInputImage>
+void
+GreyLevelCooccurrenceSlidingWindow<TInputImage>
+::UpdateColumns(IndexValueType first, IndexValueType last, bool add)
+{
+  for (IndexValueType x = first; x <= last; ++x)
+    {
+    this->UpdateColumn(x, add);
+    }
+}
+
+template <class TInputImage>
+void
+GreyLevelCooccurrenceSlidingWindow<TInputImage>
+::UpdateColumn(IndexValueType x, bool add)
+{
+  RegionType column = m_Window;
+  column.SetIndex(0, x);
+  column.SetSize(0, 1);
+
+  itk::ImageRegionConstIteratorWithIndex<InputImageType> it(m_Image, column);
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+    {
+    const IndexType neighborIndex = it.GetIndex() + m_Offset;
+    if (!m_BufferedRegion.IsInside(neighborIndex))
+      {
+      continue; // same rule as the neighborhood iterator: out of bounds pairs are ignored
+      }
+    if (add)
+      {
+      m_CooccurrenceIndexedList->AddPixelPair(it.Get(), m_Image->GetPixel(neighborIndex));
+      }
+    else
+      {
+      m_CooccurrenceIndexedList->RemovePixelPair(it.Get(), m_Image->GetPixel(neighborIndex));
+      }
+    }
+}
+
+} // End namespace otb
+
+#endif
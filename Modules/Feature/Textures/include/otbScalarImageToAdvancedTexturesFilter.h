@@ -21,7 +21,7 @@
 #ifndef otbScalarImageToAdvancedTexturesFilter_h
 #define otbScalarImageToAdvancedTexturesFilter_h
 
-#include "otbGreyLevelCooccurrenceIndexedList.h"
+#include "otbGreyLevelCooccurrenceSlidingWindow.h"
 #include "itkImageToImageFilter.h"
 
 namespace otb
@@ -135,6 +135,8 @@ public:
   typedef typename CooccurrenceIndexedListType::RelativeFrequencyType  RelativeFrequencyType;
   typedef typename CooccurrenceIndexedListType::VectorType             VectorType;
 
+  typedef GreyLevelCooccurrenceSlidingWindow< InputImageType > CooccurrenceSlidingWindowType;
+
   typedef typename VectorType::iterator                    VectorIteratorType;
   typedef typename VectorType::const_iterator              VectorConstIteratorType;
 
@@ -179,6 +181,15 @@ public:
   /** Get the sub-sampling offset */
   itkGetMacro(SubsampleOffset, OffsetType);
 
+  /** Set/Get the sliding window mode. When enabled, the co-occurrence list of
+   * each output pixel is obtained by updating the one of the previous pixel
+   * on the same line (pairs of the leaving columns are removed, pairs of the
+   * entering columns are added), which costs O(radius) instead of
+   * O(radius^2) per pixel. Off by default. */
+  itkSetMacro(SlidingWindow, bool);
+  itkGetConstMacro(SlidingWindow, bool);
+  itkBooleanMacro(SlidingWindow);
+
   /** Get the mean output image */
   OutputImageType * GetMeanOutput();
 
@@ -253,6 +264,9 @@ private:
 
   /** Sub-sampling offset */
   OffsetType m_SubsampleOffset;
+
+  /** Update co-occurrences incrementally along lines */
+  bool m_SlidingWindow;
 };
 } // End namespace otb
 
@@ -42,6 +42,7 @@ ScalarImageToAdvancedTexturesFilter<TInputImage, TOutputImage>
 , m_InputImageMaximum(255)
 , m_SubsampleFactor()
 , m_SubsampleOffset()
+, m_SlidingWindow(false)
 {
   // There are 10 outputs corresponding to the 9 textures indices
   this->SetNumberOfRequiredOutputs(10);
@@ -363,6 +364,13 @@ ScalarImageToAdvancedTexturesFilter<TInputImage, TOutputImage>
   // Set-up progress reporting
   itk::ProgressReporter progress(this, threadId, outputRegionForThread.GetNumberOfPixels());
 
+  // Co-occurrences updated along lines in sliding window mode
+  CooccurrenceSlidingWindowType slidingWindow;
+  if (m_SlidingWindow)
+    {
+    slidingWindow.Initialize(inputPtr, m_Offset, m_NumberOfBinsPerAxis, m_InputImageMinimum, m_InputImageMaximum);
+    }
+
   // Iterate on outputs to compute textures
   while (!varianceIt.IsAtEnd()
          && !meanIt.IsAtEnd()
@@ -398,24 +406,33 @@ ScalarImageToAdvancedTexturesFilter<TInputImage, TOutputImage>
     inputRegion.SetSize(inputSize);
     inputRegion.Crop(inputPtr->GetRequestedRegion());
 
-    CooccurrenceIndexedListPointerType GLCIList = CooccurrenceIndexedListType::New();
-    GLCIList->Initialize(m_NumberOfBinsPerAxis, m_InputImageMinimum, m_InputImageMaximum);
+    CooccurrenceIndexedListPointerType GLCIList;
+    if (m_SlidingWindow)
+      {
+      slidingWindow.MoveTo(inputRegion);
+      GLCIList = slidingWindow.GetCooccurrenceIndexedList();
+      }
+    else
+      {
+      GLCIList = CooccurrenceIndexedListType::New();
+      GLCIList->Initialize(m_NumberOfBinsPerAxis, m_InputImageMinimum, m_InputImageMaximum);
 
-    typedef itk::ConstNeighborhoodIterator< InputImageType > NeighborhoodIteratorType;
-    NeighborhoodIteratorType neighborIt;
-    neighborIt = NeighborhoodIteratorType(m_NeighborhoodRadius, inputPtr, inputRegion);
-    for ( neighborIt.GoToBegin(); !neighborIt.IsAtEnd(); ++neighborIt )
-    {
-    const InputPixelType centerPixelIntensity = neighborIt.GetCenterPixel();
-    bool pixelInBounds;
-    const InputPixelType pixelIntensity =  neighborIt.GetPixel(m_Offset, pixelInBounds);
-    if ( !pixelInBounds )
+      typedef itk::ConstNeighborhoodIterator< InputImageType > NeighborhoodIteratorType;
+      NeighborhoodIteratorType neighborIt;
+      neighborIt = NeighborhoodIteratorType(m_NeighborhoodRadius, inputPtr, inputRegion);
+      for ( neighborIt.GoToBegin(); !neighborIt.IsAtEnd(); ++neighborIt )
       {
-      continue; // don't put a pixel in the co-occurrence list if the value is
-               // out of bounds
+      const InputPixelType centerPixelIntensity = neighborIt.GetCenterPixel();
+      bool pixelInBounds;
+      const InputPixelType pixelIntensity =  neighborIt.GetPixel(m_Offset, pixelInBounds);
+      if ( !pixelInBounds )
+        {
+        continue; // don't put a pixel in the co-occurrence list if the value is
+                 // out of bounds
+        }
+      GLCIList->AddPixelPair(centerPixelIntensity, pixelIntensity);
+      }
       }
-    GLCIList->AddPixelPair(centerPixelIntensity, pixelIntensity);
-    }
 
     PixelValueType m_Mean                    = itk::NumericTraits< PixelValueType >::Zero;
     PixelValueType m_Variance                = itk::NumericTraits< PixelValueType >::Zero;
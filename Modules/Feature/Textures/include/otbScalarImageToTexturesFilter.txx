@@ -44,6 +44,7 @@ ScalarImageToTexturesFilter<TInputImage, TOutputImage>
 , m_InputImageMaximum(255)
 , m_SubsampleFactor()
 , m_SubsampleOffset()
+, m_SlidingWindow(false)
 {
   // There are 8 outputs corresponding to the 8 textures indices
   this->SetNumberOfRequiredOutputs(8);
@@ -330,6 +331,13 @@ ScalarImageToTexturesFilter<TInputImage, TOutputImage>
   // Set-up progress reporting
   itk::ProgressReporter progress(this, threadId, outputRegionForThread.GetNumberOfPixels());
 
+  // Co-occurrences updated along lines in sliding window mode
+  CooccurrenceSlidingWindowType slidingWindow;
+  if (m_SlidingWindow)
+    {
+    slidingWindow.Initialize(inputPtr, m_Offset, m_NumberOfBinsPerAxis, m_InputImageMinimum, m_InputImageMaximum);
+    }
+
   // Iterate on outputs to compute textures
   while (!energyIt.IsAtEnd()
          && !entropyIt.IsAtEnd()
@@ -362,23 +370,32 @@ ScalarImageToTexturesFilter<TInputImage, TOutputImage>
     inputRegion.SetSize(inputSize);
     inputRegion.Crop(inputPtr->GetRequestedRegion());
 
-    CooccurrenceIndexedListPointerType GLCIList = CooccurrenceIndexedListType::New();
-    GLCIList->Initialize(m_NumberOfBinsPerAxis, m_InputImageMinimum, m_InputImageMaximum);
-
-    typedef itk::ConstNeighborhoodIterator< InputImageType > NeighborhoodIteratorType;
-    NeighborhoodIteratorType neighborIt;
-    neighborIt = NeighborhoodIteratorType(m_NeighborhoodRadius, inputPtr, inputRegion);
-    for ( neighborIt.GoToBegin(); !neighborIt.IsAtEnd(); ++neighborIt )
+    CooccurrenceIndexedListPointerType GLCIList;
+    if (m_SlidingWindow)
       {
-      const InputPixelType centerPixelIntensity = neighborIt.GetCenterPixel();
-      bool pixelInBounds;
-      const InputPixelType pixelIntensity =  neighborIt.GetPixel(m_Offset, pixelInBounds);
-      if ( !pixelInBounds )
+      slidingWindow.MoveTo(inputRegion);
+      GLCIList = slidingWindow.GetCooccurrenceIndexedList();
+      }
+    else
+      {
+      GLCIList = CooccurrenceIndexedListType::New();
+      GLCIList->Initialize(m_NumberOfBinsPerAxis, m_InputImageMinimum, m_InputImageMaximum);
+
+      typedef itk::ConstNeighborhoodIterator< InputImageType > NeighborhoodIteratorType;
+      NeighborhoodIteratorType neighborIt;
+      neighborIt = NeighborhoodIteratorType(m_NeighborhoodRadius, inputPtr, inputRegion);
+      for ( neighborIt.GoToBegin(); !neighborIt.IsAtEnd(); ++neighborIt )
         {
-        continue; // don't put a pixel in the co-occurrence list if the value is
-                  // out of bounds
+        const InputPixelType centerPixelIntensity = neighborIt.GetCenterPixel();
+        bool pixelInBounds;
+        const InputPixelType pixelIntensity =  neighborIt.GetPixel(m_Offset, pixelInBounds);
+        if ( !pixelInBounds )
+          {
+          continue; // don't put a pixel in the co-occurrence list if the value is
+                    // out of bounds
+          }
+        GLCIList->AddPixelPair(centerPixelIntensity, pixelIntensity);
         }
-      GLCIList->AddPixelPair(centerPixelIntensity, pixelIntensity);
       }
 
     double pixelMean = 0.;
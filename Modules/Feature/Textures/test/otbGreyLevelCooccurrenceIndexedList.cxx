@@ -19,6 +19,7 @@
  */
 
 #include "otbGreyLevelCooccurrenceIndexedList.h"
+#include "otbGreyLevelCooccurrenceSlidingWindow.h"
 #include "itkImageRegionIteratorWithIndex.h"
 #include "itkConstNeighborhoodIterator.h"
 #include "itkImageRegionIterator.h"
@@ -135,6 +136,8 @@ int otbGreyLevelCooccurrenceIndexedList(int, char* [] )
 
     InputImageType::SizeType radius = {{ 2, 2 }};
 
+    std::vector<CooccurrenceIndexedListType::VectorType> lists;
+
     // Iterate over input image and create co-occurrence list
     itk::ImageRegionIteratorWithIndex<InputImageType> imageItWithIndex(image, region);
     imageItWithIndex.GoToBegin();
@@ -176,6 +179,8 @@ int otbGreyLevelCooccurrenceIndexedList(int, char* [] )
       VectorType vector;
       //get indexed list and total frequency
       vector = cooccurrenceObj2->GetVector();
+      //save the list for the sliding window check
+      lists.push_back(vector);
       //save total frequency
       tfvector.push_back(cooccurrenceObj2->GetTotalFrequency());
       //save each vector to fvector so as to compare results later
@@ -239,6 +244,49 @@ int otbGreyLevelCooccurrenceIndexedList(int, char* [] )
       std::cerr << "Co-occurrence list total frequencies are correct" << std::endl;
       }
 
+    // The sliding window must give the same lists as the ones built from scratch
+    typedef otb::GreyLevelCooccurrenceSlidingWindow<InputImageType> SlidingWindowType;
+    SlidingWindowType slidingWindow;
+    slidingWindow.Initialize(image, offset, 8, 0, 3);
+    unsigned int pixelId = 0;
+    for (imageItWithIndex.GoToBegin(); !imageItWithIndex.IsAtEnd(); ++imageItWithIndex, ++pixelId)
+      {
+      InputRegionType::IndexType inputIndex;
+      InputRegionType::SizeType inputSize;
+      for (unsigned int dim = 0; dim < InputImageType::ImageDimension; ++dim)
+        {
+        inputIndex[dim] = imageItWithIndex.GetIndex()[dim] - radius[dim];
+        inputSize[dim] = 2 * radius[dim] + 1;
+        }
+      InputRegionType inputRegion;
+      inputRegion.SetIndex(inputIndex);
+      inputRegion.SetSize(inputSize);
+      inputRegion.Crop(image->GetRequestedRegion());
+
+      slidingWindow.MoveTo(inputRegion);
+      CooccurrenceIndexedListType * slidingList = slidingWindow.GetCooccurrenceIndexedList();
+      CooccurrenceIndexedListType::VectorType slidingVector = slidingList->GetVector();
+
+      if (slidingList->GetTotalFrequency() != tavector[pixelId] || slidingVector.size() != lists[pixelId].size())
+        {
+        std::cerr << "Sliding window at pixel " << imageItWithIndex.GetIndex() << ": got " << slidingVector.size()
+                  << " pairs, total frequency " << slidingList->GetTotalFrequency() << ", expected "
+                  << lists[pixelId].size() << " pairs, total frequency " << tavector[pixelId] << std::endl;
+        passed = false;
+        continue;
+        }
+      CooccurrenceIndexedListType::VectorType::const_iterator it;
+      for (it = lists[pixelId].begin(); it != lists[pixelId].end(); ++it)
+        {
+        if (slidingList->GetFrequency((*it).first[1], (*it).first[0], slidingVector) != (*it).second)
+          {
+          std::cerr << "Sliding window at pixel " << imageItWithIndex.GetIndex() << ": wrong frequency for pair "
+                    << (*it).first << std::endl;
+          passed = false;
+          }
+        }
+      }
+
     if (!passed)
       {
       std::cerr << "Test failed" << std::endl;
@@ -28,9 +28,9 @@
 
 int otbScalarImageToTexturesFilter(int argc, char * argv[])
 {
-  if (argc != 7)
+  if (argc != 7 && argc != 8)
     {
-    std::cerr << "Usage: " << argv[0] << " infname outprefix nbBins radius offsetx offsety" << std::endl;
+    std::cerr << "Usage: " << argv[0] << " infname outprefix nbBins radius offsetx offsety [slidingWindow]" << std::endl;
     return EXIT_FAILURE;
     }
   const char *       infname      = argv[1];
@@ -73,6 +73,10 @@ int otbScalarImageToTexturesFilter(int argc, char * argv[])
   filter->SetNumberOfBinsPerAxis(nbBins);
   filter->SetInputImageMinimum(0);
   filter->SetInputImageMaximum(255);
+  if (argc == 8)
+    {
+    filter->SetSlidingWindow(atoi(argv[7]) != 0);
+    }
 
   // Write outputs
   std::ostringstream oss;
@@ -26,7 +26,10 @@
 #include "itkImageToImageFilter.h"
 #include "itkImageRegionConstIterator.h"
 #include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkSimpleFastMutexLock.h"
 #include <vcl_algorithm.h>
+#include <vector>
+#include <deque>
 
 
 namespace otb
@@ -435,10 +438,40 @@ private:
  * spatial bandwidth parameter to the spatial radius defining how many pixels
  * are in the processing window local to a pixel.
  *
+ * By default, the input data is converted to a double precision joint
+ * spatial-range image. With SinglePrecision on, only the range components are
+ * kept, in single precision and interleaved by line (all the values of a band
+ * along a line are contiguous), the spatial components being computed from the
+ * pixel indices. This divides the memory used by the internal buffer by 3 for a
+ * 4 bands image, and the kernel is evaluated on whole lines of the neighborhood,
+ * in loops the compiler can vectorize. Results are equal to the double
+ * precision ones up to the rounding of the range values.
+ *
  * MeanShifVector squared norm is compared with Threshold (set using Get/Set accessor) to define pixel convergence (1e-3 by default).
  * MaxIterationNumber defines maximum iteration number for each pixel convergence (set using Get/Set accessor). Set to 4 by default.
  * ModeSearch is a boolean value, to choose between optimized and non optimized algorithm. If set to true (by default), assign mode value to each pixel on a path covered in convergence steps.
  *
+ * Without mode search, the output requested region is cut into chunks of
+ * ChunkSize lines, which are given to the threads one after the other as they
+ * become idle: threads processing pixels that converge quickly do not wait for
+ * the others. With mode search, a pixel may be assigned the mode of any pixel
+ * of the same thread region, so the chunks are the regions of the usual split
+ * of the requested region between the threads, each processed as a whole by
+ * one thread. The result then slightly depends on the number of threads, as
+ * without dynamic scheduling.
+ *
+ * Converged modes of the previous requested regions can be kept in a cache
+ * of ModeCacheSize pixels (disabled by default). When streaming with
+ * overlapping requested regions (for instance the tiles of LSMS
+ * segmentation, which are enlarged by a margin), the pixels of the overlap
+ * are copied from the cache instead of being computed again. With mode
+ * search, cached pixels are also used as already assigned mode candidates.
+ * The cache is cleared when the filter or its input is modified.
+ *
+ * The number of pixels computed for each number of iterations is
+ * accumulated across requests and can be retrieved with
+ * GetIterationHistogram().
+ *
  * For more information on mean shift techniques, one might consider reading the following article:
  *
  * D. Comaniciu, P. Meer, "Mean Shift: A Robust Approach Toward Feature Space Analysis," IEEE Transactions on
@@ -506,6 +539,9 @@ public:
   typedef otb::VectorImage<RealType, InputImageType::ImageDimension> RealVectorImageType;
   typedef otb::Image<unsigned short, InputImageType::ImageDimension> ModeTableImageType;
 
+  /** Type of the range values in single precision mode */
+  typedef float SinglePrecisionType;
+
   /** Sets the spatial bandwidth (or radius in the case of a uniform kernel)
    * of the neighborhood for each pixel
    */
@@ -541,6 +577,39 @@ public:
   itkSetMacro(ModeSearch, bool);
   itkGetConstReferenceMacro(ModeSearch, bool);
 
+  /** Toggle single precision mode, which is disabled by default.
+   * When on, the range values are stored in single precision, interleaved by
+   * line, instead of the double precision joint spatial-range image.
+   */
+  itkSetMacro(SinglePrecision, bool);
+  itkGetConstReferenceMacro(SinglePrecision, bool);
+  itkBooleanMacro(SinglePrecision);
+
+  /** Sets the number of lines of the chunks dynamically assigned to the
+   * threads (16 by default). Not used with mode search. */
+  itkSetMacro(ChunkSize, unsigned int);
+  itkGetConstReferenceMacro(ChunkSize, unsigned int);
+
+  /** Sets the maximum number of pixels kept in the cache of converged modes
+   * across requested regions. 0 (default) disables the cache. Each cached
+   * pixel uses (ImageDimension + NumberOfComponents + 1) values. */
+  itkSetMacro(ModeCacheSize, unsigned long);
+  itkGetConstReferenceMacro(ModeCacheSize, unsigned long);
+
+  /** Histogram of the number of iterations: element i is the number of
+   * pixels computed with i iterations since the last reset. Pixels copied
+   * from the cache or assigned by mode search are not counted. */
+  const std::vector<unsigned long> & GetIterationHistogram() const
+  {
+    return m_IterationHistogram;
+  }
+
+  /** Number of pixels copied from the cache since the last reset */
+  itkGetConstReferenceMacro(NumberOfCachedPixels, unsigned long);
+
+  /** Reset the iteration histogram and the number of cached pixels */
+  void ResetIterationHistogram();
+
 #if 0
   /** Toggle bucket optimization, which is disabled by default.
    */
@@ -586,9 +655,9 @@ protected:
    * Therefore, this implementation provides a ThreadedGenerateData()
    * routine which is called for each processing thread. The output
    * image data is allocated automatically by the superclass prior to
-   * calling ThreadedGenerateData().  ThreadedGenerateData can only
-   * write to the portion of the output image specified by the
-   * parameter "outputRegionForThread"
+   * calling ThreadedGenerateData(). The parameter "outputRegionForThread"
+   * is ignored: each thread processes the chunks of the requested region
+   * given by GetNextChunk() until there is none left.
    *
    * \sa ImageToImageFilter::ThreadedGenerateData(),
    *     ImageToImageFilter::GenerateData() */
@@ -596,6 +665,10 @@ protected:
 
   void AfterThreadedGenerateData() ITK_OVERRIDE;
 
+  /** Processes a chunk of the output requested region. chunkId is the
+   * position of the chunk in the list of chunks of the requested region. */
+  virtual void ProcessChunk(const OutputRegionType& chunk, unsigned int chunkId, itk::ThreadIdType threadId);
+
   /** Allocates the outputs (need to be reimplemented since outputs have different type) */
   void AllocateOutputs() ITK_OVERRIDE;
 
@@ -612,6 +685,15 @@ protected:
                                         const RealVector& jointPixel, const OutputRegionType& outputRegion,
                                         const RealVector& bandwidth,
                                         RealVector& meanShiftVector);
+
+  /** Calculates the mean shift vector from the single precision range
+   * buffer, line by line. invBandwidth holds the inverse of the bandwidths,
+   * and weights is a working buffer. */
+  virtual void CalculateMeanShiftVectorSinglePrecision(const RealVector& jointPixel,
+                                                       const OutputRegionType& outputRegion,
+                                                       const RealVector& invBandwidth,
+                                                       RealVector& meanShiftVector,
+                                                       std::vector<RealType>& weights);
 #if 0
   virtual void CalculateMeanShiftVectorBucket(const RealVector& jointPixel, RealVector& meanShiftVector);
 #endif
@@ -648,6 +730,34 @@ private:
   /** Input data in the joint spatial-range domain, scaled by the bandwidths */
   typename RealVectorImageType::Pointer m_JointImage;
 
+  /** Range values in single precision mode, interleaved by line: the values
+   * of a band along a line of m_RangeBufferRegion are contiguous */
+  std::vector<SinglePrecisionType> m_RangeBuffer;
+
+  /** Region covered by m_RangeBuffer */
+  RegionType m_RangeBufferRegion;
+
+  /** Offset of the first range value of a pixel in m_RangeBuffer. The
+   * values of the next bands are found with a stride of the line width. */
+  inline size_t GetRangeBufferOffset(const InputIndexType & index) const
+  {
+    size_t line = 0;
+    for (int dim = ImageDimension - 1; dim > 0; --dim)
+      {
+      line = line * m_RangeBufferRegion.GetSize()[dim] + (index[dim] - m_RangeBufferRegion.GetIndex()[dim]);
+      }
+    return line * m_NumberOfComponentsPerPixel * m_RangeBufferRegion.GetSize()[0]
+      + (index[0] - m_RangeBufferRegion.GetIndex()[0]);
+  }
+
+  /** Squared distance between the range values of a candidate pixel and
+   * the joint pixel, normalized by the bandwidths */
+  RealType GetCandidateRangeDistance(const InputIndexType& candidate, const RealVector& jointPixel,
+                                     const RealVector& bandwidth) const;
+
+  /** Boolean to enable single precision mode */
+  bool m_SinglePrecision;
+
   /** Image to store the status at each pixel:
    * 0 : no mode has been found yet
    * 1 : a mode has been assigned to this pixel
@@ -664,11 +774,58 @@ private:
   bool m_BucketOptimization;
 #endif
 
-  /** Mode counters (local to each thread) */
+  /** Mode counters (local to each chunk) */
   itk::VariableLengthVector<LabelType> m_NumLabels;
-  /** Number of bits used to represent the threadId in the most significant bits
-   of labels */
-  unsigned int m_ThreadIdNumberOfBits;
+
+  /** Number of lines of the chunks */
+  unsigned int m_ChunkSize;
+
+  /** Chunk scheduling: chunks of the requested region, next chunk to process
+   * and number of processed chunks, protected by m_ChunkMutex */
+  std::vector<OutputRegionType> m_Chunks;
+  unsigned int m_NextChunk;
+  unsigned int m_NumberOfProcessedChunks;
+  itk::SimpleFastMutexLock m_ChunkMutex;
+
+  /** Gets the next chunk to process. Returns false when all the chunks have
+   * been given. */
+  bool GetNextChunk(OutputRegionType& chunk, unsigned int& chunkId);
+
+  /** Block of converged pixels kept in the mode cache */
+  struct ModeCacheBlock
+  {
+    RegionType Region;
+    std::vector<RealType> Range;
+    std::vector<RealType> Spatial;
+    std::vector<unsigned int> Iterations;
+  };
+
+  /** Maximum number of cached pixels */
+  unsigned long m_ModeCacheSize;
+
+  /** Cached blocks, from the oldest to the newest */
+  std::deque<ModeCacheBlock> m_ModeCache;
+
+  /** Number of pixels currently cached */
+  unsigned long m_NumberOfModeCachePixels;
+
+  /** Modification time of the filter and its input when the cache was filled */
+  itk::ModifiedTimeType m_ModeCacheTime;
+
+  /** Finds the newest cached block containing index. offset is set to the
+   * position of the pixel in the block. */
+  const ModeCacheBlock * FindCachedMode(const InputIndexType& index, size_t& offset) const;
+
+  /** Copies the outputs of the requested region to the mode cache */
+  void UpdateModeCache();
+
+  /** Iteration histograms and number of cached pixels of each thread */
+  std::vector<std::vector<unsigned long> > m_ThreadIterationHistograms;
+  std::vector<unsigned long> m_ThreadNumberOfCachedPixels;
+
+  /** Accumulated iteration histogram */
+  std::vector<unsigned long> m_IterationHistogram;
+  unsigned long m_NumberOfCachedPixels;
 
 #if 0
   typedef Meanshift::BucketImage<RealVectorImageType> BucketImageType;
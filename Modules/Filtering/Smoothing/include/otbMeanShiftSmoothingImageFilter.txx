@@ -27,7 +27,6 @@
 #include "otbUnaryFunctorWithIndexWithOutputSizeImageFilter.h"
 #include "otbMacro.h"
 
-#include "itkProgressReporter.h"
 
 
 namespace otb
@@ -40,9 +39,16 @@ MeanShiftSmoothingImageFilter<TInputImage, TOutputImage, TKernel, TOutputIterati
       // , m_Kernel(...)
       , m_NumberOfComponentsPerPixel(0)
       // , m_JointImage(0)
+      , m_SinglePrecision(false)
       // , m_ModeTable(0)
       , m_ModeSearch(false)
-      , m_ThreadIdNumberOfBits(0)
+      , m_ChunkSize(16)
+      , m_NextChunk(0)
+      , m_NumberOfProcessedChunks(0)
+      , m_ModeCacheSize(0)
+      , m_NumberOfModeCachePixels(0)
+      , m_ModeCacheTime(0)
+      , m_NumberOfCachedPixels(0)
 #if 0
       , m_BucketOptimization(false)
 #endif
@@ -245,17 +251,48 @@ void MeanShiftSmoothingImageFilter<TInputImage, TOutputImage, TKernel, TOutputIt
   // domain, i.e. spatial coordinates are concatenated to the range values.
   // Moreover, pixel components in this image are normalized by their respective
   // (spatial or range) bandwidth.
-  typedef Meanshift::SpatialRangeJointDomainTransform<InputImageType, RealVectorImageType> FunctionType;
-  typedef otb::UnaryFunctorWithIndexWithOutputSizeImageFilter<InputImageType, RealVectorImageType, FunctionType>
-      JointImageFunctorType;
+  if (m_SinglePrecision)
+    {
+    // Only the range values are stored, in single precision, interleaved by
+    // line. Spatial components are computed from the pixel indices.
+    m_JointImage = ITK_NULLPTR;
+    m_RangeBufferRegion = inputPtr->GetBufferedRegion();
+    m_RangeBuffer.resize(m_RangeBufferRegion.GetNumberOfPixels() * m_NumberOfComponentsPerPixel);
+
+    const size_t width = m_RangeBufferRegion.GetSize()[0];
+    itk::ImageRegionConstIterator<InputImageType> inputIt(inputPtr, m_RangeBufferRegion);
+    SinglePrecisionType * line = &(m_RangeBuffer[0]);
+    size_t x = 0;
+    for (inputIt.GoToBegin(); !inputIt.IsAtEnd(); ++inputIt)
+      {
+      const InputPixelType & inputPixel = inputIt.Get();
+      for (unsigned int comp = 0; comp < m_NumberOfComponentsPerPixel; comp++)
+        {
+        line[comp * width + x] = static_cast<SinglePrecisionType>(inputPixel[comp]);
+        }
+      if (++x == width)
+        {
+        x = 0;
+        line += width * m_NumberOfComponentsPerPixel;
+        }
+      }
+    }
+  else
+    {
+    m_RangeBuffer.clear();
 
-  typename JointImageFunctorType::Pointer jointImageFunctor = JointImageFunctorType::New();
+    typedef Meanshift::SpatialRangeJointDomainTransform<InputImageType, RealVectorImageType> FunctionType;
+    typedef otb::UnaryFunctorWithIndexWithOutputSizeImageFilter<InputImageType, RealVectorImageType, FunctionType>
+        JointImageFunctorType;
 
-  jointImageFunctor->SetInput(inputPtr);
-  jointImageFunctor->GetFunctor().Initialize(ImageDimension, m_NumberOfComponentsPerPixel, m_GlobalShift);
-  jointImageFunctor->GetOutput()->SetRequestedRegion(this->GetInput()->GetBufferedRegion());
-  jointImageFunctor->Update();
-  m_JointImage = jointImageFunctor->GetOutput();
+    typename JointImageFunctorType::Pointer jointImageFunctor = JointImageFunctorType::New();
+
+    jointImageFunctor->SetInput(inputPtr);
+    jointImageFunctor->GetFunctor().Initialize(ImageDimension, m_NumberOfComponentsPerPixel, m_GlobalShift);
+    jointImageFunctor->GetOutput()->SetRequestedRegion(this->GetInput()->GetBufferedRegion());
+    jointImageFunctor->Update();
+    m_JointImage = jointImageFunctor->GetOutput();
+    }
 
 #if 0
   if (m_BucketOptimization)
@@ -309,6 +346,42 @@ void MeanShiftSmoothingImageFilter<TInputImage, TOutputImage, TKernel, TOutputIt
   m_ModeTable->Allocate();
   m_ModeTable->FillBuffer(0);
 
+  // Cut the output requested region into chunks
+  const OutputRegionType& outputRequestedRegion = outRangePtr->GetRequestedRegion();
+  m_Chunks.clear();
+  if (m_ModeSearch)
+    {
+    // Mode search may assign to a pixel the mode of any pixel of its region,
+    // so the chunks are the regions of the static split between threads
+    const unsigned int numThreads = this->GetNumberOfThreads();
+    OutputRegionType threadRegion;
+    const unsigned int numPieces = this->SplitRequestedRegion(0, numThreads, threadRegion);
+    for (unsigned int i = 0; i < numPieces; i++)
+      {
+      this->SplitRequestedRegion(i, numThreads, threadRegion);
+      m_Chunks.push_back(threadRegion);
+      }
+    }
+  else
+    {
+    // Chunks of lines
+    if (m_ChunkSize == 0)
+      {
+      itkExceptionMacro(<< "Chunk size must be strictly positive");
+      }
+    const unsigned long nbLines = outputRequestedRegion.GetSize()[ImageDimension - 1];
+    for (unsigned long firstLine = 0; firstLine < nbLines; firstLine += m_ChunkSize)
+      {
+      OutputRegionType chunk = outputRequestedRegion;
+      chunk.GetModifiableIndex()[ImageDimension - 1] += static_cast<InputIndexValueType>(firstLine);
+      chunk.GetModifiableSize()[ImageDimension - 1] = vcl_min(static_cast<unsigned long>(m_ChunkSize),
+                                                              nbLines - firstLine);
+      m_Chunks.push_back(chunk);
+      }
+    }
+  m_NextChunk = 0;
+  m_NumberOfProcessedChunks = 0;
+
   if (m_ModeSearch)
     {
     // Image to store the status at each pixel:
@@ -316,29 +389,126 @@ void MeanShiftSmoothingImageFilter<TInputImage, TOutputImage, TKernel, TOutputIt
     // 1 : a mode has been assigned to this pixel
     // 2 : a mode will be assigned to this pixel
 
+    // Initialize counters for mode (also used for mode labeling). Labels are
+    // local to each chunk, and are made consecutive after the threaded part.
+    m_NumLabels.SetSize(vcl_max(static_cast<unsigned int>(m_Chunks.size()), 1u));
+    m_NumLabels.Fill(0);
+    }
+
+  // The cached modes are only valid if neither the filter nor its input have
+  // been modified since they were computed
+  const itk::ModifiedTimeType time = vcl_max(this->GetMTime(), inputPtr->GetPipelineMTime());
+  if (m_ModeCacheSize == 0 || time != m_ModeCacheTime)
+    {
+    m_ModeCache.clear();
+    m_NumberOfModeCachePixels = 0;
+    }
+  m_ModeCacheTime = time;
+
+  const unsigned int numThreads = this->GetNumberOfThreads();
+  m_ThreadIterationHistograms.assign(numThreads, std::vector<unsigned long>(m_MaxIterationNumber + 1, 0));
+  m_ThreadNumberOfCachedPixels.assign(numThreads, 0);
+}
+
+template<class TInputImage, class TOutputImage, class TKernel, class TOutputIterationImage>
+bool MeanShiftSmoothingImageFilter<TInputImage, TOutputImage, TKernel, TOutputIterationImage>
+::GetNextChunk(OutputRegionType& chunk, unsigned int& chunkId)
+{
+  const unsigned int numberOfChunks = static_cast<unsigned int>(m_Chunks.size());
+
+  m_ChunkMutex.Lock();
+  chunkId = m_NextChunk;
+  if (m_NextChunk < numberOfChunks)
+    {
+    ++m_NextChunk;
+    }
+  m_ChunkMutex.Unlock();
+
+  if (chunkId >= numberOfChunks)
+    {
+    return false;
+    }
+
+  chunk = m_Chunks[chunkId];
+  return true;
+}
+
+template<class TInputImage, class TOutputImage, class TKernel, class TOutputIterationImage>
+const typename MeanShiftSmoothingImageFilter<TInputImage, TOutputImage, TKernel, TOutputIterationImage>::ModeCacheBlock *
+MeanShiftSmoothingImageFilter<TInputImage, TOutputImage, TKernel, TOutputIterationImage>
+::FindCachedMode(const InputIndexType& index, size_t& offset) const
+{
+  // Search the newest blocks first
+  for (typename std::deque<ModeCacheBlock>::const_reverse_iterator blockIt = m_ModeCache.rbegin();
+       blockIt != m_ModeCache.rend(); ++blockIt)
+    {
+    const RegionType& region = blockIt->Region;
+    if (region.IsInside(index))
+      {
+      offset = 0;
+      for (int dim = ImageDimension - 1; dim >= 0; --dim)
+        {
+        offset = offset * region.GetSize()[dim] + (index[dim] - region.GetIndex()[dim]);
+        }
+      return &(*blockIt);
+      }
+    }
+  return ITK_NULLPTR;
+}
+
+template<class TInputImage, class TOutputImage, class TKernel, class TOutputIterationImage>
+void MeanShiftSmoothingImageFilter<TInputImage, TOutputImage, TKernel, TOutputIterationImage>
+::UpdateModeCache()
+{
+  const OutputRegionType& region = this->GetRangeOutput()->GetRequestedRegion();
+  const unsigned long nbPixels = region.GetNumberOfPixels();
+  if (nbPixels == 0 || nbPixels > m_ModeCacheSize)
+    {
+    return;
+    }
 
-    // Initialize counters for mode (also used for mode labeling)
-    // Most significant bits of label counters are used to identify the thread
-    // Id.
-    unsigned int numThreads;
+  // Evict the oldest blocks to make room for the new one
+  while (!m_ModeCache.empty() && m_NumberOfModeCachePixels + nbPixels > m_ModeCacheSize)
+    {
+    m_NumberOfModeCachePixels -= m_ModeCache.front().Region.GetNumberOfPixels();
+    m_ModeCache.pop_front();
+    }
 
-    numThreads = this->GetNumberOfThreads();
-    m_ThreadIdNumberOfBits = -1;
-    unsigned int n = numThreads;
-    while (n != 0)
+  m_ModeCache.push_back(ModeCacheBlock());
+  ModeCacheBlock& block = m_ModeCache.back();
+  block.Region = region;
+  block.Range.resize(nbPixels * m_NumberOfComponentsPerPixel);
+  block.Spatial.resize(nbPixels * ImageDimension);
+  block.Iterations.resize(nbPixels);
+  m_NumberOfModeCachePixels += nbPixels;
+
+  itk::ImageRegionConstIterator<OutputImageType> rangeIt(this->GetRangeOutput(), region);
+  itk::ImageRegionConstIterator<OutputSpatialImageType> spatialIt(this->GetSpatialOutput(), region);
+  itk::ImageRegionConstIterator<OutputIterationImageType> iterationIt(this->GetIterationOutput(), region);
+  size_t offset = 0;
+  for (rangeIt.GoToBegin(), spatialIt.GoToBegin(), iterationIt.GoToBegin(); !rangeIt.IsAtEnd();
+       ++rangeIt, ++spatialIt, ++iterationIt, ++offset)
+    {
+    const OutputPixelType& rangePixel = rangeIt.Get();
+    for (unsigned int comp = 0; comp < m_NumberOfComponentsPerPixel; comp++)
       {
-      n >>= 1;
-      m_ThreadIdNumberOfBits++;
+      block.Range[offset * m_NumberOfComponentsPerPixel + comp] = rangePixel[comp];
       }
-    if (m_ThreadIdNumberOfBits == 0) m_ThreadIdNumberOfBits = 1; // minimum 1 bit
-    m_NumLabels.SetSize(numThreads);
-    for (unsigned int i = 0; i < numThreads; i++)
+    const OutputSpatialPixelType& spatialPixel = spatialIt.Get();
+    for (unsigned int comp = 0; comp < ImageDimension; comp++)
       {
-      m_NumLabels[i] = static_cast<LabelType> (i) << (sizeof(LabelType) * 8 - m_ThreadIdNumberOfBits);
+      block.Spatial[offset * ImageDimension + comp] = spatialPixel[comp];
       }
-
+    block.Iterations[offset] = static_cast<unsigned int>(iterationIt.Get());
     }
+}
 
+template<class TInputImage, class TOutputImage, class TKernel, class TOutputIterationImage>
+void MeanShiftSmoothingImageFilter<TInputImage, TOutputImage, TKernel, TOutputIterationImage>
+::ResetIterationHistogram()
+{
+  m_IterationHistogram.clear();
+  m_NumberOfCachedPixels = 0;
 }
 
 // Calculates the mean shift vector at the position given by jointPixel
@@ -455,6 +625,145 @@ void MeanShiftSmoothingImageFilter<TInputImage, TOutputImage, TKernel, TOutputIt
     }
 }
 
+// Calculates the mean shift vector at the position given by jointPixel, from
+// the single precision range buffer
+template<class TInputImage, class TOutputImage, class TKernel, class TOutputIterationImage>
+void MeanShiftSmoothingImageFilter<TInputImage, TOutputImage, TKernel, TOutputIterationImage>::CalculateMeanShiftVectorSinglePrecision(
+                                                                                                                                       const RealVector& jointPixel,
+                                                                                                                                       const OutputRegionType& outputRegion,
+                                                                                                                                       const RealVector & invBandwidth,
+                                                                                                                                       RealVector& meanShiftVector,
+                                                                                                                                       std::vector<RealType>& weights)
+{
+  const unsigned int jointDimension = ImageDimension + m_NumberOfComponentsPerPixel;
+
+  InputIndexType inputIndex;
+  InputIndexType regionIndex;
+  InputSizeType regionSize;
+
+  assert(meanShiftVector.GetSize() == jointDimension);
+  meanShiftVector.Fill(0);
+
+  // Calculates current pixel neighborhood region, restricted to the output image region
+  unsigned long numberOfLines = 1;
+  for (unsigned int comp = 0; comp < ImageDimension; ++comp)
+    {
+    inputIndex[comp] = vcl_floor(jointPixel[comp] + 0.5) - m_GlobalShift[comp];
+
+    regionIndex[comp] = vcl_max(static_cast<long int> (outputRegion.GetIndex().GetElement(comp)),
+                                static_cast<long int> (inputIndex[comp] - m_SpatialRadius[comp] - 1));
+    const long int indexRight = vcl_min(
+                                        static_cast<long int> (outputRegion.GetIndex().GetElement(comp)
+                                            + outputRegion.GetSize().GetElement(comp) - 1),
+                                        static_cast<long int> (inputIndex[comp] + m_SpatialRadius[comp] + 1));
+
+    regionSize[comp] = vcl_max(0l, indexRight - static_cast<long int> (regionIndex[comp]) + 1);
+    if (comp > 0)
+      {
+      numberOfLines *= regionSize[comp];
+      }
+    }
+
+  const unsigned long width = regionSize[0];
+  if (width == 0 || numberOfLines == 0)
+    {
+    return;
+    }
+  if (weights.size() < width)
+    {
+    weights.resize(width);
+    }
+  RealType * w = &(weights[0]);
+
+  // Stride between two bands of a line in the buffer
+  const size_t bandStride = m_RangeBufferRegion.GetSize()[0];
+
+  // Spatial shift of the first pixel of the lines
+  const RealType shift0 = regionIndex[0] + m_GlobalShift[0] - jointPixel[0];
+
+  RealType weightSum = 0;
+  InputIndexType lineIndex = regionIndex;
+  for (unsigned long line = 0; line < numberOfLines; ++line)
+    {
+    // Squared norm of the spatial shift along the other dimensions, constant
+    // along the line
+    RealType lineNorm2 = 0;
+    for (unsigned int comp = 1; comp < ImageDimension; ++comp)
+      {
+      const RealType d = (lineIndex[comp] + m_GlobalShift[comp] - jointPixel[comp]) * invBandwidth[comp];
+      lineNorm2 += d * d;
+      }
+
+    for (unsigned long x = 0; x < width; ++x)
+      {
+      const RealType d = (shift0 + x) * invBandwidth[0];
+      w[x] = lineNorm2 + d * d;
+      }
+
+    const SinglePrecisionType * lineBuffer = &(m_RangeBuffer[this->GetRangeBufferOffset(lineIndex)]);
+    for (unsigned int comp = 0; comp < m_NumberOfComponentsPerPixel; ++comp)
+      {
+      const SinglePrecisionType * band = lineBuffer + comp * bandStride;
+      const RealType center = jointPixel[ImageDimension + comp];
+      const RealType invBw = invBandwidth[ImageDimension + comp];
+      for (unsigned long x = 0; x < width; ++x)
+        {
+        const RealType d = (band[x] - center) * invBw;
+        w[x] += d * d;
+        }
+      }
+
+    // Compute pixel weights from kernel
+    RealType lineWeight = 0;
+    RealType lineShift0 = 0;
+    for (unsigned long x = 0; x < width; ++x)
+      {
+      w[x] = m_Kernel(w[x]);
+      lineWeight += w[x];
+      lineShift0 += w[x] * x;
+      }
+
+    if (lineWeight > 0)
+      {
+      // Update mean shift vector
+      meanShiftVector[0] += lineWeight * shift0 + lineShift0;
+      for (unsigned int comp = 1; comp < ImageDimension; ++comp)
+        {
+        meanShiftVector[comp] += lineWeight * (lineIndex[comp] + m_GlobalShift[comp] - jointPixel[comp]);
+        }
+      for (unsigned int comp = 0; comp < m_NumberOfComponentsPerPixel; ++comp)
+        {
+        const SinglePrecisionType * band = lineBuffer + comp * bandStride;
+        RealType sum = 0;
+        for (unsigned long x = 0; x < width; ++x)
+          {
+          sum += w[x] * band[x];
+          }
+        meanShiftVector[ImageDimension + comp] += sum - lineWeight * jointPixel[ImageDimension + comp];
+        }
+      weightSum += lineWeight;
+      }
+
+    // Move to the next line
+    for (unsigned int comp = 1; comp < ImageDimension; ++comp)
+      {
+      if (++lineIndex[comp] < regionIndex[comp] + static_cast<long int>(regionSize[comp]))
+        {
+        break;
+        }
+      lineIndex[comp] = regionIndex[comp];
+      }
+    }
+
+  if (weightSum > 0)
+    {
+    for (unsigned int comp = 0; comp < jointDimension; comp++)
+      {
+      meanShiftVector[comp] = meanShiftVector[comp] / weightSum;
+      }
+    }
+}
+
 #if 0
 // Calculates the mean shift vector at the position given by jointPixel
 template<class TInputImage, class TOutputImage, class TKernel, class TOutputIterationImage>
@@ -531,13 +840,64 @@ void MeanShiftSmoothingImageFilter<TInputImage, TOutputImage, TKernel, TOutputIt
 }
 #endif
 
+template<class TInputImage, class TOutputImage, class TKernel, class TOutputIterationImage>
+typename MeanShiftSmoothingImageFilter<TInputImage, TOutputImage, TKernel, TOutputIterationImage>::RealType
+MeanShiftSmoothingImageFilter<TInputImage, TOutputImage, TKernel, TOutputIterationImage>
+::GetCandidateRangeDistance(const InputIndexType& candidate, const RealVector& jointPixel,
+                            const RealVector& bandwidth) const
+{
+  RealType diff = 0;
+  if (m_SinglePrecision)
+    {
+    const SinglePrecisionType * candidatePixel = &(m_RangeBuffer[this->GetRangeBufferOffset(candidate)]);
+    const size_t bandStride = m_RangeBufferRegion.GetSize()[0];
+    for (unsigned int comp = 0; comp < m_NumberOfComponentsPerPixel; comp++)
+      {
+      const RealType d = (candidatePixel[comp * bandStride] - jointPixel[ImageDimension + comp])
+          / bandwidth[ImageDimension + comp];
+      diff += d * d;
+      }
+    }
+  else
+    {
+    RealVector const& candidatePixel = m_JointImage->GetPixel(candidate);
+    for (unsigned int comp = ImageDimension; comp < ImageDimension + m_NumberOfComponentsPerPixel; comp++)
+      {
+      const RealType d = (candidatePixel[comp] - jointPixel[comp]) / bandwidth[comp];
+      diff += d * d;
+      }
+    }
+  return diff;
+}
+
 template<class TInputImage, class TOutputImage, class TKernel, class TOutputIterationImage>
 void MeanShiftSmoothingImageFilter<TInputImage, TOutputImage, TKernel, TOutputIterationImage>
-::ThreadedGenerateData(const OutputRegionType& outputRegionForThread, itk::ThreadIdType threadId)
+::ThreadedGenerateData(const OutputRegionType& itkNotUsed(outputRegionForThread), itk::ThreadIdType threadId)
 {
-  // at the first iteration
+  // The region of the thread is not used: the number of iterations varies a
+  // lot from one pixel to another, so chunks are given to the threads as
+  // they become idle
+  OutputRegionType chunk;
+  unsigned int chunkId;
+  while (this->GetNextChunk(chunk, chunkId))
+    {
+    this->ProcessChunk(chunk, chunkId, threadId);
 
+    m_ChunkMutex.Lock();
+    const unsigned int processedChunks = ++m_NumberOfProcessedChunks;
+    m_ChunkMutex.Unlock();
 
+    if (threadId == 0)
+      {
+      this->UpdateProgress(static_cast<float>(processedChunks) / m_Chunks.size());
+      }
+    }
+}
+
+template<class TInputImage, class TOutputImage, class TKernel, class TOutputIterationImage>
+void MeanShiftSmoothingImageFilter<TInputImage, TOutputImage, TKernel, TOutputIterationImage>
+::ProcessChunk(const OutputRegionType& chunk, unsigned int chunkId, itk::ThreadIdType threadId)
+{
   // Retrieve output images pointers
   typename OutputSpatialImageType::Pointer spatialOutput = this->GetSpatialOutput();
   typename OutputImageType::Pointer rangeOutput = this->GetRangeOutput();
@@ -564,20 +924,20 @@ void MeanShiftSmoothingImageFilter<TInputImage, TOutputImage, TKernel, TOutputIt
   for (unsigned int comp = 0; comp < ImageDimension; comp++)
     bandwidth[comp] = m_SpatialBandwidth;
 
-  itk::ProgressReporter progress(this, threadId, outputRegionForThread.GetNumberOfPixels());
-
   RegionType const& requestedRegion = input->GetRequestedRegion();
 
-  typedef itk::ImageRegionConstIteratorWithIndex<RealVectorImageType> JointImageIteratorType;
-  JointImageIteratorType jointIt(m_JointImage, outputRegionForThread);
+  // Pixels are read from the input: their values in the joint domain are the
+  // pixel indices and values
+  typedef itk::ImageRegionConstIteratorWithIndex<InputImageType> InputIteratorType;
+  InputIteratorType jointIt(input, chunk);
 
-  OutputIteratorType rangeIt(rangeOutput, outputRegionForThread);
-  OutputSpatialIteratorType spatialIt(spatialOutput, outputRegionForThread);
-  OutputIterationIteratorType iterationIt(iterationOutput, outputRegionForThread);
-  OutputLabelIteratorType labelIt(labelOutput, outputRegionForThread);
+  OutputIteratorType rangeIt(rangeOutput, chunk);
+  OutputSpatialIteratorType spatialIt(spatialOutput, chunk);
+  OutputIterationIteratorType iterationIt(iterationOutput, chunk);
+  OutputLabelIteratorType labelIt(labelOutput, chunk);
 
   typedef itk::ImageRegionIterator<ModeTableImageType> ModeTableImageIteratorType;
-  ModeTableImageIteratorType modeTableIt(m_ModeTable, outputRegionForThread);
+  ModeTableImageIteratorType modeTableIt(m_ModeTable, chunk);
 
   jointIt.GoToBegin();
   rangeIt.GoToBegin();
@@ -591,6 +951,11 @@ void MeanShiftSmoothingImageFilter<TInputImage, TOutputImage, TKernel, TOutputIt
   // Mean shift vector, updating the joint pixel at each iteration
   RealVector meanShiftVector(jointDimension);
 
+  // Inverse of the bandwidths and kernel weights of a line, used in single
+  // precision mode
+  RealVector invBandwidth(jointDimension);
+  std::vector<RealType> weights;
+
   // Variables used by mode search optimization
   // List of indices where the current pixel passes through
   std::vector<InputIndexType> pointList;
@@ -601,7 +966,15 @@ void MeanShiftSmoothingImageFilter<TInputImage, TOutputImage, TKernel, TOutputIt
   // index of the current pixel updated during the mean shift loop
   InputIndexType modeCandidate;
 
-  for (; !jointIt.IsAtEnd(); ++jointIt, ++rangeIt, ++spatialIt, ++iterationIt, ++modeTableIt, ++labelIt, progress.CompletedPixel())
+  // Statistics of the chunk
+  std::vector<unsigned long>& iterationHistogram = m_ThreadIterationHistograms[threadId];
+  unsigned long& numberOfCachedPixels = m_ThreadNumberOfCachedPixels[threadId];
+
+  // Cached block and offset of a pixel in the block
+  const ModeCacheBlock * cachedBlock = ITK_NULLPTR;
+  size_t cachedOffset = 0;
+
+  for (; !jointIt.IsAtEnd(); ++jointIt, ++rangeIt, ++spatialIt, ++iterationIt, ++modeTableIt, ++labelIt)
     {
 
     // if pixel has been already processed (by mode search optimization), skip
@@ -612,22 +985,60 @@ void MeanShiftSmoothingImageFilter<TInputImage, TOutputImage, TKernel, TOutputIt
       continue;
       }
 
+    // index of the currently processed output pixel
+    InputIndexType currentIndex = jointIt.GetIndex();
+
+    // if pixel has been computed by a previous request, copy it from the cache
+    if (!m_ModeCache.empty() && (cachedBlock = this->FindCachedMode(currentIndex, cachedOffset)) != ITK_NULLPTR)
+      {
+      for (unsigned int comp = 0; comp < m_NumberOfComponentsPerPixel; comp++)
+        {
+        rangePixel[comp] = cachedBlock->Range[cachedOffset * m_NumberOfComponentsPerPixel + comp];
+        }
+      for (unsigned int comp = 0; comp < ImageDimension; comp++)
+        {
+        spatialPixel[comp] = cachedBlock->Spatial[cachedOffset * ImageDimension + comp];
+        }
+      rangeIt.Set(rangePixel);
+      spatialIt.Set(spatialPixel);
+      iterationIt.Set(static_cast<typename OutputIterationImageType::PixelType>(cachedBlock->Iterations[cachedOffset]));
+      if (m_ModeSearch)
+        {
+        // Mode labels are not cached: the cached pixel gets a new mode
+        modeTableIt.Set(1);
+        labelIt.Set(++m_NumLabels[chunkId]);
+        }
+      else
+        {
+        labelIt.Set(0);
+        }
+      ++numberOfCachedPixels;
+      continue;
+      }
+
     bool hasConverged = false;
 
     // get input pixel in the joint spatial-range domain (with components
     // normalized by bandwidth)
-    const RealVector &jointPixelVal = jointIt.Get(); // Pixel in the joint spatial-range domain
-    for (unsigned int comp = 0; comp < jointDimension; comp++)
-      jointPixel[comp] = jointPixelVal[comp];
+    const InputPixelType &inputPixel = jointIt.Get();
+    for (unsigned int comp = 0; comp < ImageDimension; comp++)
+      jointPixel[comp] = currentIndex[comp] + m_GlobalShift[comp];
+    for (unsigned int comp = 0; comp < m_NumberOfComponentsPerPixel; comp++)
+      jointPixel[ImageDimension + comp] = static_cast<RealType>(inputPixel[comp]);
 
     for (unsigned int comp = ImageDimension; comp < jointDimension; comp++)
       bandwidth[comp] = m_RangeBandwidthRamp*jointPixel[comp]+m_RangeBandwidth;
 
-    // index of the currently processed output pixel
-    InputIndexType currentIndex = jointIt.GetIndex();
+    if (m_SinglePrecision)
+      {
+      for (unsigned int comp = 0; comp < jointDimension; comp++)
+        invBandwidth[comp] = 1.0 / bandwidth[comp];
+      }
 
     // Number of points currently in the pointList
     unsigned int pointCount = 0; // Note: used only in mode search optimization
+    // True if the loop exited on a mode found in the cache
+    bool reusedCachedMode = false;
     iteration = 0;
     while ((iteration < m_MaxIterationNumber) && (!hasConverged))
       {
@@ -643,19 +1054,13 @@ void MeanShiftSmoothingImageFilter<TInputImage, TOutputImage, TKernel, TOutputIt
 
         // If pixel candidate has status 0 (no mode assigned) or 1 (mode assigned)
         // but not 2 (pixel in current search path), and pixel has actually moved
-        // from its initial position, and pixel candidate is inside the output
-        // region, then perform optimization tasks
-        if (modeCandidate != currentIndex && m_ModeTable->GetPixel(modeCandidate) != 2
-            && outputRegionForThread.IsInside(modeCandidate))
+        // from its initial position, and pixel candidate is inside the chunk,
+        // then perform optimization tasks
+        if (modeCandidate != currentIndex && chunk.IsInside(modeCandidate)
+            && m_ModeTable->GetPixel(modeCandidate) != 2)
           {
           // Obtain the data point to see if it close to jointPixel
-          RealType diff = 0;
-          RealVector const& candidatePixel = m_JointImage->GetPixel(modeCandidate);
-          for (unsigned int comp = ImageDimension; comp < jointDimension; comp++)
-            {
-            const RealType d = (candidatePixel[comp] - jointPixel[comp])/bandwidth[comp];
-            diff += d * d;
-            }
+          const RealType diff = this->GetCandidateRangeDistance(modeCandidate, jointPixel, bandwidth);
 
           if (diff < 0.5) // Spectral value is close enough
             {
@@ -686,6 +1091,22 @@ void MeanShiftSmoothingImageFilter<TInputImage, TOutputImage, TKernel, TOutputIt
             }
 
           }
+        else if (!m_ModeCache.empty() && modeCandidate != currentIndex && !chunk.IsInside(modeCandidate)
+                 && requestedRegion.IsInside(modeCandidate)
+                 && (cachedBlock = this->FindCachedMode(modeCandidate, cachedOffset)) != ITK_NULLPTR
+                 && this->GetCandidateRangeDistance(modeCandidate, jointPixel, bandwidth) < 0.5)
+          {
+          // The candidate pixel is outside the chunk, but its mode has been
+          // computed by a previous request: use the cached value
+          for (unsigned int comp = 0; comp < m_NumberOfComponentsPerPixel; comp++)
+            {
+            jointPixel[ImageDimension + comp] = cachedBlock->Range[cachedOffset * m_NumberOfComponentsPerPixel + comp];
+            }
+          modeTableIt.Set(2);
+          numBreaks++;
+          reusedCachedMode = true;
+          break;
+          }
         } // end if (m_ModeSearch)
 
       //Calculate meanShiftVector
@@ -697,7 +1118,14 @@ void MeanShiftSmoothingImageFilter<TInputImage, TOutputImage, TKernel, TOutputIt
       else
         {
 #endif
-        this->CalculateMeanShiftVector(m_JointImage, jointPixel, requestedRegion, bandwidth, meanShiftVector);
+        if (m_SinglePrecision)
+          {
+          this->CalculateMeanShiftVectorSinglePrecision(jointPixel, requestedRegion, invBandwidth, meanShiftVector, weights);
+          }
+        else
+          {
+          this->CalculateMeanShiftVector(m_JointImage, jointPixel, requestedRegion, bandwidth, meanShiftVector);
+          }
 
 #if 0
         }
@@ -733,6 +1161,7 @@ void MeanShiftSmoothingImageFilter<TInputImage, TOutputImage, TKernel, TOutputIt
 
     const typename OutputIterationImageType::PixelType iterationPixel = iteration;
     iterationIt.Set(iterationPixel);
+    ++iterationHistogram[iteration];
 
     if (m_ModeSearch)
       {
@@ -741,10 +1170,10 @@ void MeanShiftSmoothingImageFilter<TInputImage, TOutputImage, TKernel, TOutputIt
 
       // If the loop exited with hasConverged or too many iterations, then we have a new mode
       LabelType label;
-      if (hasConverged || iteration == m_MaxIterationNumber)
+      if (hasConverged || iteration == m_MaxIterationNumber || reusedCachedMode)
         {
-        m_NumLabels[threadId]++;
-        label = m_NumLabels[threadId];
+        m_NumLabels[chunkId]++;
+        label = m_NumLabels[chunkId];
         }
       else // the loop exited through a break. Use the already assigned mode label
         {
@@ -767,56 +1196,58 @@ void MeanShiftSmoothingImageFilter<TInputImage, TOutputImage, TKernel, TOutputIt
       }
 
     }
-  // std::cout << "numBreaks: " << numBreaks << " Break ratio: " << numBreaks / (RealType)outputRegionForThread.GetNumberOfPixels() << std::endl;
+  // std::cout << "numBreaks: " << numBreaks << " Break ratio: " << numBreaks / (RealType)chunk.GetNumberOfPixels() << std::endl;
 }
 
 /* after threaded convergence test */
 template<class TInputImage, class TOutputImage, class TKernel, class TOutputIterationImage>
 void MeanShiftSmoothingImageFilter<TInputImage, TOutputImage, TKernel, TOutputIterationImage>::AfterThreadedGenerateData()
 {
+  // Release the single precision buffer
+  std::vector<SinglePrecisionType>().swap(m_RangeBuffer);
+
   typename OutputLabelImageType::Pointer labelOutput = this->GetLabelOutput();
   typedef itk::ImageRegionIterator<OutputLabelImageType> OutputLabelIteratorType;
-  OutputLabelIteratorType labelIt(labelOutput, labelOutput->GetRequestedRegion());
 
   // Reassign mode labels
   // Note: Labels are only computed when mode search optimization is enabled
   if (m_ModeSearch)
     {
-    // New labels will be consecutive. The following vector contains the new
-    // start label for each thread.
-    itk::VariableLengthVector<LabelType> newLabelOffset;
-    newLabelOffset.SetSize(this->GetNumberOfThreads());
-    newLabelOffset[0] = 0;
-    for (itk::ThreadIdType i = 1; i < this->GetNumberOfThreads(); i++)
+    // New labels will be consecutive: the labels of each chunk are shifted
+    // by the number of labels of the previous chunks.
+    LabelType newLabelOffset = 0;
+    for (unsigned int i = 0; i < m_Chunks.size(); i++)
       {
-      // Retrieve the number of labels in the thread by removing the threadId
-      // from the most significant bits
-      LabelType localNumLabel = m_NumLabels[i - 1] & ((static_cast<LabelType> (1) << (sizeof(LabelType) * 8
-          - m_ThreadIdNumberOfBits)) - static_cast<LabelType> (1));
-      newLabelOffset[i] = localNumLabel + newLabelOffset[i - 1];
+      if (newLabelOffset > 0)
+        {
+        OutputLabelIteratorType labelIt(labelOutput, m_Chunks[i]);
+        for (labelIt.GoToBegin(); !labelIt.IsAtEnd(); ++labelIt)
+          {
+          labelIt.Set(labelIt.Get() + newLabelOffset);
+          }
+        }
+      newLabelOffset += m_NumLabels[i];
       }
+    }
 
-    labelIt.GoToBegin();
-
-    while (!labelIt.IsAtEnd())
+  // Accumulate the statistics of the threads
+  if (m_IterationHistogram.size() < m_MaxIterationNumber + 1)
+    {
+    m_IterationHistogram.resize(m_MaxIterationNumber + 1, 0);
+    }
+  for (unsigned int i = 0; i < m_ThreadIterationHistograms.size(); i++)
+    {
+    for (unsigned int j = 0; j < m_ThreadIterationHistograms[i].size(); j++)
       {
-      LabelType const label = labelIt.Get();
-
-      // Get threadId from most significant bits
-      const itk::ThreadIdType threadId = label >> (sizeof(LabelType) * 8 - m_ThreadIdNumberOfBits);
-
-      // Relabeling
-      // First get the label number by removing the threadId bits
-      // Then add the label offset specific to the threadId
-      LabelType newLabel = label & ((static_cast<LabelType> (1) << (sizeof(LabelType) * 8 - m_ThreadIdNumberOfBits))
-          - static_cast<LabelType> (1));
-      newLabel += newLabelOffset[threadId];
-
-      labelIt.Set(newLabel);
-      ++labelIt;
+      m_IterationHistogram[j] += m_ThreadIterationHistograms[i][j];
       }
+    m_NumberOfCachedPixels += m_ThreadNumberOfCachedPixels[i];
     }
 
+  if (m_ModeCacheSize > 0)
+    {
+    this->UpdateModeCache();
+    }
 }
 
 template<class TInputImage, class TOutputImage, class TKernel, class TOutputIterationImage>
@@ -827,6 +1258,10 @@ void MeanShiftSmoothingImageFilter<TInputImage, TOutputImage, TKernel, TOutputIt
   Superclass::PrintSelf(os, indent);
   os << indent << "Spatial bandwidth: " << m_SpatialBandwidth << std::endl;
   os << indent << "Range bandwidth: " << m_RangeBandwidth << std::endl;
+  os << indent << "Single precision: " << m_SinglePrecision << std::endl;
+  os << indent << "Chunk size: " << m_ChunkSize << std::endl;
+  os << indent << "Mode cache size: " << m_ModeCacheSize << std::endl;
+  os << indent << "Number of cached pixels: " << m_NumberOfModeCachePixels << std::endl;
 }
 
 } // end namespace otb
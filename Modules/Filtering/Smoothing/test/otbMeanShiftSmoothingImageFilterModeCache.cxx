@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "itkMacro.h"
+#include "otbImageFileReader.h"
+#include "otbMeanShiftSmoothingImageFilter.h"
+#include "itkImageRegionConstIterator.h"
+
+int otbMeanShiftSmoothingImageFilterModeCache(int argc, char * argv[])
+{
+  if (argc != 5)
+    {
+    std::cerr << "Usage: " << argv[0] <<
+    " inputFileName spatialBandwidth rangeBandwidth overlap"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const char *       inputFileName              = argv[1];
+  const double       spatialBandwidth           = atof(argv[2]);
+  const double       rangeBandwidth             = atof(argv[3]);
+  const unsigned int overlap                    = atoi(argv[4]);
+
+  const unsigned int Dimension = 2;
+  typedef float                                            PixelType;
+  typedef otb::VectorImage<PixelType, Dimension>           ImageType;
+  typedef otb::ImageFileReader<ImageType>                  ReaderType;
+  typedef otb::MeanShiftSmoothingImageFilter<ImageType, ImageType> FilterType;
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName(inputFileName);
+  reader->Update();
+
+  // Reference: whole image, without cache
+  FilterType::Pointer filterRef = FilterType::New();
+  filterRef->SetSpatialBandwidth(spatialBandwidth);
+  filterRef->SetRangeBandwidth(rangeBandwidth);
+  filterRef->SetInput(reader->GetOutput());
+  filterRef->Update();
+
+  // Two overlapping requests, the second one reusing the overlap
+  FilterType::Pointer filterCache = FilterType::New();
+  filterCache->SetSpatialBandwidth(spatialBandwidth);
+  filterCache->SetRangeBandwidth(rangeBandwidth);
+  filterCache->SetInput(reader->GetOutput());
+  filterCache->SetModeCacheSize(reader->GetOutput()->GetLargestPossibleRegion().GetNumberOfPixels());
+
+  const ImageType::RegionType largest = reader->GetOutput()->GetLargestPossibleRegion();
+  ImageType::RegionType upper = largest;
+  ImageType::SizeType size = largest.GetSize();
+  size[1] = size[1] / 2 + overlap;
+  upper.SetSize(size);
+  ImageType::RegionType lower = largest;
+  ImageType::IndexType index = largest.GetIndex();
+  index[1] += largest.GetSize()[1] / 2 - overlap;
+  size[1] = largest.GetSize()[1] - largest.GetSize()[1] / 2 + overlap;
+  lower.SetIndex(index);
+  lower.SetSize(size);
+
+  filterCache->GetRangeOutput()->SetRequestedRegion(upper);
+  filterCache->GetRangeOutput()->Update();
+  filterCache->GetRangeOutput()->SetRequestedRegion(lower);
+  filterCache->GetRangeOutput()->Update();
+
+  // Without mode search, cached pixels are exactly the recomputed ones
+  typedef itk::ImageRegionConstIterator<ImageType> IteratorType;
+  IteratorType itRef(filterRef->GetRangeOutput(), lower);
+  IteratorType itCache(filterCache->GetRangeOutput(), lower);
+
+  unsigned long nbDifferent = 0;
+  for (itRef.GoToBegin(), itCache.GoToBegin(); !itRef.IsAtEnd(); ++itRef, ++itCache)
+    {
+    const ImageType::PixelType & valueRef = itRef.Get();
+    const ImageType::PixelType & valueCache = itCache.Get();
+    for (unsigned int comp = 0; comp < valueRef.GetSize(); ++comp)
+      {
+      if (valueRef[comp] != valueCache[comp])
+        {
+        ++nbDifferent;
+        break;
+        }
+      }
+    }
+  if (nbDifferent > 0)
+    {
+    std::cerr << nbDifferent << " pixels differ from the reference" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Each pixel is either computed or copied from the cache once
+  ImageType::RegionType overlapRegion = upper;
+  overlapRegion.Crop(lower);
+  const std::vector<unsigned long> & histogram = filterCache->GetIterationHistogram();
+  unsigned long nbComputed = 0;
+  for (unsigned int i = 0; i < histogram.size(); ++i)
+    {
+    nbComputed += histogram[i];
+    }
+  std::cout << "Computed pixels: " << nbComputed << ", cached pixels: "
+            << filterCache->GetNumberOfCachedPixels() << std::endl;
+  if (filterCache->GetNumberOfCachedPixels() != overlapRegion.GetNumberOfPixels()
+      || nbComputed != largest.GetNumberOfPixels())
+    {
+    std::cerr << "Unexpected number of computed or cached pixels (overlap of "
+              << overlapRegion.GetNumberOfPixels() << " pixels)" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "itkMacro.h"
+#include "otbImageFileReader.h"
+#include "otbMeanShiftSmoothingImageFilter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkTimeProbe.h"
+
+int otbMeanShiftSmoothingImageFilterSinglePrecision(int argc, char * argv[])
+{
+  if (argc != 7)
+    {
+    std::cerr << "Usage: " << argv[0] <<
+    " inputFileName spatialBandwidth rangeBandwidth useModeSearch tolerance maxRatio"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const char *       inputFileName              = argv[1];
+  const double       spatialBandwidth           = atof(argv[2]);
+  const double       rangeBandwidth             = atof(argv[3]);
+  bool               useModeSearch              = (atoi(argv[4])!=0);
+  const double       tolerance                  = atof(argv[5]);
+  const double       maxRatio                   = atof(argv[6]);
+
+  const unsigned int Dimension = 2;
+  typedef float                                            PixelType;
+  typedef otb::VectorImage<PixelType, Dimension>           ImageType;
+  typedef otb::ImageFileReader<ImageType>                  ReaderType;
+  typedef otb::MeanShiftSmoothingImageFilter<ImageType, ImageType> FilterType;
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName(inputFileName);
+  reader->Update();
+
+  // Instantiating object
+  FilterType::Pointer filterDouble = FilterType::New();
+  FilterType::Pointer filterSingle = FilterType::New();
+
+  // Set filter parameters
+  filterDouble->SetSpatialBandwidth(spatialBandwidth);
+  filterDouble->SetRangeBandwidth(rangeBandwidth);
+  filterDouble->SetInput(reader->GetOutput());
+  filterDouble->SetModeSearch(useModeSearch);
+
+  filterSingle->SetSpatialBandwidth(spatialBandwidth);
+  filterSingle->SetRangeBandwidth(rangeBandwidth);
+  filterSingle->SetInput(reader->GetOutput());
+  filterSingle->SetModeSearch(useModeSearch);
+  filterSingle->SinglePrecisionOn();
+
+  itk::TimeProbe chrono;
+  chrono.Start();
+  filterDouble->Update();
+  chrono.Stop();
+  std::cout << "Double precision: " << chrono.GetTotal() << " s" << std::endl;
+
+  chrono.Reset();
+  chrono.Start();
+  filterSingle->Update();
+  chrono.Stop();
+  std::cout << "Single precision: " << chrono.GetTotal() << " s" << std::endl;
+
+  // A few pixels may converge to another mode because of the rounding of the
+  // range values: only their proportion is checked
+  typedef itk::ImageRegionConstIterator<ImageType> IteratorType;
+  IteratorType itDouble(filterDouble->GetRangeOutput(), filterDouble->GetRangeOutput()->GetLargestPossibleRegion());
+  IteratorType itSingle(filterSingle->GetRangeOutput(), filterSingle->GetRangeOutput()->GetLargestPossibleRegion());
+
+  unsigned long nbPixels = 0;
+  unsigned long nbDifferent = 0;
+  for (itDouble.GoToBegin(), itSingle.GoToBegin(); !itDouble.IsAtEnd(); ++itDouble, ++itSingle)
+    {
+    const ImageType::PixelType & valueDouble = itDouble.Get();
+    const ImageType::PixelType & valueSingle = itSingle.Get();
+    for (unsigned int comp = 0; comp < valueDouble.GetSize(); ++comp)
+      {
+      if (vcl_abs(valueDouble[comp] - valueSingle[comp]) > tolerance)
+        {
+        ++nbDifferent;
+        break;
+        }
+      }
+    ++nbPixels;
+    }
+
+  const double ratio = static_cast<double>(nbDifferent) / static_cast<double>(nbPixels);
+  std::cout << nbDifferent << " pixels out of " << nbPixels << " differ by more than " << tolerance << std::endl;
+  if (ratio > maxRatio)
+    {
+    std::cerr << "Too many different pixels: " << ratio << " > " << maxRatio << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
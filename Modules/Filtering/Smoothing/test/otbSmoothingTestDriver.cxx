@@ -26,4 +26,6 @@ void RegisterTests()
   REGISTER_TEST(otbMeanShiftSmoothingImageFilterSpatialStability);
   REGISTER_TEST(otbMeanShiftSmoothingImageFilterNew);
   REGISTER_TEST(otbMeanShiftSmoothingImageFilterThreading);
+  REGISTER_TEST(otbMeanShiftSmoothingImageFilterSinglePrecision);
+  REGISTER_TEST(otbMeanShiftSmoothingImageFilterModeCache);
 }
@@ -0,0 +1,268 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef otbLabelStatisticsAccumulator_h
+#define otbLabelStatisticsAccumulator_h
+
+#include "itkIntTypes.h"
+#include "itkNumericTraits.h"
+#include <vector>
+#include <cstddef>
+#include <cstring>
+
+namespace otb
+{
+
+/** \class LabelStatisticsAccumulator
+ * \brief Flat per-label accumulator of populations and per-band sums
+ *
+ * Statistics are stored in contiguous arrays indexed by slot: the label,
+ * its population and its per-band sums (NumberOfComponents doubles per
+ * slot). There is no allocation per label.
+ *
+ * Two storage areas can coexist:
+ * - a dense area, if a label range is given with InitializeDense(), where
+ *   the slot of a label is directly its offset in the range;
+ * - an open-addressing hash area (linear probing, power of two capacity)
+ *   for all other labels.
+ *
+ * Labels are hashed through their bit pattern, so that non integer labels
+ * do not collide. The smallest and largest labels seen are tracked, which
+ * allows one to choose a dense layout afterwards when the observed range is
+ * small.
+ *
+ * Labels are assigned to partitions with GetPartition(), which only
+ * depends on the label and on the dense range. Accumulators sharing the
+ * same configuration can thus be merged partition by partition, in
+ * parallel.
+ *
+ * \ingroup OTBStatistics
+ */
+template <class TLabel>
+class LabelStatisticsAccumulator
+{
+public:
+  typedef LabelStatisticsAccumulator Self;
+  typedef TLabel                     LabelType;
+
+  LabelStatisticsAccumulator();
+
+  /** Initialize in hash mode only */
+  void Initialize(unsigned int nbComponents, size_t expectedLabels = 1024);
+
+  /** Initialize with a dense area for labels in [minLabel, maxLabel]. Other
+   *  labels are stored in the hash area. */
+  void InitializeDense(unsigned int nbComponents, LabelType minLabel, LabelType maxLabel,
+                       size_t expectedOutliers = 64);
+
+  /** Remove all statistics, keeping the configuration */
+  void Clear();
+
+  /** Increment the population of a label and return its sums array, so
+   *  that the caller can add the pixel components */
+  inline double * Accumulate(LabelType label)
+  {
+    const size_t slot = this->GetOrCreateSlot(label);
+    m_Counts[slot] += 1.0;
+    return &(m_Sums[slot * m_NumberOfComponents]);
+  }
+
+  /** Add a population and sums to a label */
+  void Accumulate(LabelType label, double count, const double * sums);
+
+  /** Merge all the statistics of another accumulator */
+  void Merge(const Self & other);
+
+  /** Merge the statistics of a given slot of another accumulator */
+  void MergeSlot(const Self & other, size_t slot)
+  {
+    this->Accumulate(other.m_Keys[slot], other.m_Counts[slot], &(other.m_Sums[slot * other.m_NumberOfComponents]));
+  }
+
+  /** Partition of a label among nbPartitions */
+  unsigned int GetPartition(LabelType label, unsigned int nbPartitions) const;
+
+  /** Dense sub-range owned by a partition. Returns false if the partition
+   *  does not own any dense label. */
+  bool GetPartitionDenseRange(unsigned int partition, unsigned int nbPartitions,
+                              size_t & firstSlot, size_t & endSlot) const;
+
+  /** Number of labels stored */
+  size_t GetNumberOfLabels() const
+  {
+    return m_NumberOfLabels;
+  }
+
+  unsigned int GetNumberOfComponents() const
+  {
+    return m_NumberOfComponents;
+  }
+
+  bool IsDense() const
+  {
+    return m_DenseSize > 0;
+  }
+
+  LabelType GetMinimumDenseLabel() const
+  {
+    return m_MinLabel;
+  }
+
+  size_t GetDenseSize() const
+  {
+    return m_DenseSize;
+  }
+
+  /** Smallest label seen. Only valid if GetNumberOfLabels() is not 0. */
+  LabelType GetMinimumLabel() const
+  {
+    return m_MinimumLabel;
+  }
+
+  /** Largest label seen. Only valid if GetNumberOfLabels() is not 0. */
+  LabelType GetMaximumLabel() const
+  {
+    return m_MaximumLabel;
+  }
+
+  /** Slot access */
+  size_t GetNumberOfSlots() const
+  {
+    return m_Counts.size();
+  }
+
+  bool IsSlotUsed(size_t slot) const
+  {
+    return m_Counts[slot] != 0.0;
+  }
+
+  bool IsDenseSlot(size_t slot) const
+  {
+    return slot < m_DenseSize;
+  }
+
+  LabelType GetSlotLabel(size_t slot) const
+  {
+    return m_Keys[slot];
+  }
+
+  double GetSlotCount(size_t slot) const
+  {
+    return m_Counts[slot];
+  }
+
+  const double * GetSlotSums(size_t slot) const
+  {
+    return &(m_Sums[slot * m_NumberOfComponents]);
+  }
+
+private:
+  /** Hash of a label (Fibonacci hashing of its bit pattern) */
+  inline itk::uint64_t Hash(LabelType label) const
+  {
+    return LabelBits(label) * 0x9E3779B97F4A7C15ULL;
+  }
+
+  /** Bit pattern of a label: the value itself for integer labels, the
+   *  bits of its double representation otherwise (-0 and +0 being equal
+   *  labels, they share the same pattern) */
+  static inline itk::uint64_t LabelBits(LabelType label)
+  {
+    if (itk::NumericTraits<LabelType>::is_integer)
+      {
+      return static_cast<itk::uint64_t>(static_cast<itk::int64_t>(label));
+      }
+    double value = static_cast<double>(label);
+    if (value == 0.0)
+      {
+      value = 0.0;
+      }
+    itk::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+  }
+
+  /** Update the observed label range with a new label */
+  inline void ObserveLabel(LabelType label)
+  {
+    if (m_NumberOfLabels == 0 || label < m_MinimumLabel)
+      {
+      m_MinimumLabel = label;
+      }
+    if (m_NumberOfLabels == 0 || m_MaximumLabel < label)
+      {
+      m_MaximumLabel = label;
+      }
+  }
+
+  /** Is the label in the dense range */
+  inline bool IsInDenseRange(LabelType label) const
+  {
+    return m_DenseSize > 0 && !(label < m_MinLabel)
+      && static_cast<itk::uint64_t>(static_cast<itk::int64_t>(label) - static_cast<itk::int64_t>(m_MinLabel)) < m_DenseSize;
+  }
+
+  /** Find the slot of a label, create it if needed */
+  inline size_t GetOrCreateSlot(LabelType label)
+  {
+    if (this->IsInDenseRange(label))
+      {
+      const size_t slot = static_cast<size_t>(static_cast<itk::int64_t>(label) - static_cast<itk::int64_t>(m_MinLabel));
+      if (m_Counts[slot] == 0.0)
+        {
+        m_Keys[slot] = label;
+        this->ObserveLabel(label);
+        ++m_NumberOfLabels;
+        }
+      return slot;
+      }
+    return this->GetOrCreateHashSlot(label);
+  }
+
+  /** Find or create a slot in the hash area */
+  size_t GetOrCreateHashSlot(LabelType label);
+
+  /** Resize the hash area and re-insert its content */
+  void RehashArea(size_t newCapacity);
+
+  /** Allocate storage for the dense and hash areas */
+  void Allocate(size_t hashCapacity);
+
+  std::vector<LabelType> m_Keys;
+  std::vector<double>    m_Counts;
+  std::vector<double>    m_Sums;
+  unsigned int           m_NumberOfComponents;
+  LabelType              m_MinLabel;
+  size_t                 m_DenseSize;
+  size_t                 m_HashCapacity;
+  unsigned int           m_HashBits;
+  size_t                 m_NumberOfHashLabels;
+  size_t                 m_NumberOfLabels;
+  LabelType              m_MinimumLabel;
+  LabelType              m_MaximumLabel;
+};
+
+} // end namespace otb
+
+#ifndef OTB_MANUAL_INSTANTIATION
+#include "otbLabelStatisticsAccumulator.txx"
+#endif
+
+#endif
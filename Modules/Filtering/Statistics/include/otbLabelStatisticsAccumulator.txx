@@ -0,0 +1,250 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef otbLabelStatisticsAccumulator_txx
+#define otbLabelStatisticsAccumulator_txx
+
+#include "otbLabelStatisticsAccumulator.h"
+#include <algorithm>
+
+namespace otb
+{
+
+template <class TLabel>
+LabelStatisticsAccumulator<TLabel>
+::LabelStatisticsAccumulator()
+  : m_Keys(),
+    m_Counts(),
+    m_Sums(),
+    m_NumberOfComponents(1),
+    m_MinLabel(),
+    m_DenseSize(0),
+    m_HashCapacity(0),
+    m_HashBits(0),
+    m_NumberOfHashLabels(0),
+    m_NumberOfLabels(0),
+    m_MinimumLabel(),
+    m_MaximumLabel()
+{
+}
+
+template <class TLabel>
+void
+LabelStatisticsAccumulator<TLabel>
+::Initialize(unsigned int nbComponents, size_t expectedLabels)
+{
+  m_NumberOfComponents = nbComponents;
+  m_DenseSize = 0;
+  // keep the load factor under 0.5 for the expected number of labels
+  size_t capacity = 16;
+  while (capacity < 2 * expectedLabels)
+    {
+    capacity *= 2;
+    }
+  this->Allocate(capacity);
+}
+
+template <class TLabel>
+void
+LabelStatisticsAccumulator<TLabel>
+::InitializeDense(unsigned int nbComponents, LabelType minLabel, LabelType maxLabel, size_t expectedOutliers)
+{
+  m_NumberOfComponents = nbComponents;
+  m_MinLabel = minLabel;
+  m_DenseSize = 0;
+  if (!(maxLabel < minLabel))
+    {
+    m_DenseSize = static_cast<size_t>(static_cast<itk::int64_t>(maxLabel) - static_cast<itk::int64_t>(minLabel)) + 1;
+    }
+  size_t capacity = 16;
+  while (capacity < 2 * expectedOutliers)
+    {
+    capacity *= 2;
+    }
+  this->Allocate(capacity);
+}
+
+template <class TLabel>
+void
+LabelStatisticsAccumulator<TLabel>
+::Allocate(size_t hashCapacity)
+{
+  m_HashCapacity = hashCapacity;
+  m_HashBits = 0;
+  while ((static_cast<size_t>(1) << m_HashBits) < m_HashCapacity)
+    {
+    ++m_HashBits;
+    }
+  const size_t nbSlots = m_DenseSize + m_HashCapacity;
+  m_Keys.assign(nbSlots, LabelType());
+  m_Counts.assign(nbSlots, 0.0);
+  m_Sums.assign(nbSlots * m_NumberOfComponents, 0.0);
+  m_NumberOfHashLabels = 0;
+  m_NumberOfLabels = 0;
+}
+
+template <class TLabel>
+void
+LabelStatisticsAccumulator<TLabel>
+::Clear()
+{
+  std::fill(m_Counts.begin(), m_Counts.end(), 0.0);
+  std::fill(m_Sums.begin(), m_Sums.end(), 0.0);
+  m_NumberOfHashLabels = 0;
+  m_NumberOfLabels = 0;
+}
+
+template <class TLabel>
+size_t
+LabelStatisticsAccumulator<TLabel>
+::GetOrCreateHashSlot(LabelType label)
+{
+  const size_t mask = m_HashCapacity - 1;
+  size_t pos = static_cast<size_t>(this->Hash(label) >> (64 - m_HashBits)) & mask;
+  while (true)
+    {
+    const size_t slot = m_DenseSize + pos;
+    if (m_Counts[slot] == 0.0)
+      {
+      // grow the table if the load factor would exceed 0.7
+      if (10 * (m_NumberOfHashLabels + 1) > 7 * m_HashCapacity)
+        {
+        this->RehashArea(2 * m_HashCapacity);
+        return this->GetOrCreateHashSlot(label);
+        }
+      m_Keys[slot] = label;
+      this->ObserveLabel(label);
+      ++m_NumberOfHashLabels;
+      ++m_NumberOfLabels;
+      return slot;
+      }
+    if (m_Keys[slot] == label)
+      {
+      return slot;
+      }
+    pos = (pos + 1) & mask;
+    }
+}
+
+template <class TLabel>
+void
+LabelStatisticsAccumulator<TLabel>
+::RehashArea(size_t newCapacity)
+{
+  // save the hash area
+  std::vector<LabelType> keys(m_Keys.begin() + m_DenseSize, m_Keys.end());
+  std::vector<double>    counts(m_Counts.begin() + m_DenseSize, m_Counts.end());
+  std::vector<double>    sums(m_Sums.begin() + m_DenseSize * m_NumberOfComponents, m_Sums.end());
+
+  m_HashCapacity = newCapacity;
+  m_HashBits = 0;
+  while ((static_cast<size_t>(1) << m_HashBits) < m_HashCapacity)
+    {
+    ++m_HashBits;
+    }
+
+  const size_t nbSlots = m_DenseSize + m_HashCapacity;
+  m_Keys.resize(m_DenseSize);
+  m_Keys.resize(nbSlots, LabelType());
+  m_Counts.resize(m_DenseSize);
+  m_Counts.resize(nbSlots, 0.0);
+  m_Sums.resize(m_DenseSize * m_NumberOfComponents);
+  m_Sums.resize(nbSlots * m_NumberOfComponents, 0.0);
+
+  m_NumberOfLabels -= m_NumberOfHashLabels;
+  m_NumberOfHashLabels = 0;
+
+  for (size_t i = 0; i < counts.size(); ++i)
+    {
+    if (counts[i] != 0.0)
+      {
+      const size_t slot = this->GetOrCreateHashSlot(keys[i]);
+      m_Counts[slot] = counts[i];
+      std::copy(sums.begin() + i * m_NumberOfComponents,
+                sums.begin() + (i + 1) * m_NumberOfComponents,
+                m_Sums.begin() + slot * m_NumberOfComponents);
+      }
+    }
+}
+
+template <class TLabel>
+void
+LabelStatisticsAccumulator<TLabel>
+::Accumulate(LabelType label, double count, const double * sums)
+{
+  if (count == 0.0)
+    {
+    return;
+    }
+  const size_t slot = this->GetOrCreateSlot(label);
+  m_Counts[slot] += count;
+  double * dest = &(m_Sums[slot * m_NumberOfComponents]);
+  for (unsigned int k = 0; k < m_NumberOfComponents; ++k)
+    {
+    dest[k] += sums[k];
+    }
+}
+
+template <class TLabel>
+void
+LabelStatisticsAccumulator<TLabel>
+::Merge(const Self & other)
+{
+  for (size_t slot = 0; slot < other.GetNumberOfSlots(); ++slot)
+    {
+    if (other.IsSlotUsed(slot))
+      {
+      this->MergeSlot(other, slot);
+      }
+    }
+}
+
+template <class TLabel>
+unsigned int
+LabelStatisticsAccumulator<TLabel>
+::GetPartition(LabelType label, unsigned int nbPartitions) const
+{
+  if (this->IsInDenseRange(label))
+    {
+    const size_t chunk = (m_DenseSize + nbPartitions - 1) / nbPartitions;
+    return static_cast<unsigned int>(static_cast<size_t>(static_cast<itk::int64_t>(label) - static_cast<itk::int64_t>(m_MinLabel)) / chunk);
+    }
+  return static_cast<unsigned int>(((this->Hash(label) >> 32) * nbPartitions) >> 32);
+}
+
+template <class TLabel>
+bool
+LabelStatisticsAccumulator<TLabel>
+::GetPartitionDenseRange(unsigned int partition, unsigned int nbPartitions,
+                         size_t & firstSlot, size_t & endSlot) const
+{
+  if (m_DenseSize == 0)
+    {
+    return false;
+    }
+  const size_t chunk = (m_DenseSize + nbPartitions - 1) / nbPartitions;
+  firstSlot = std::min(m_DenseSize, partition * chunk);
+  endSlot = std::min(m_DenseSize, (partition + 1) * chunk);
+  return firstSlot < endSlot;
+}
+
+} // end namespace otb
+
+#endif
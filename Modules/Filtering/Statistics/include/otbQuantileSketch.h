@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef otbQuantileSketch_h
+#define otbQuantileSketch_h
+
+#include "itkMacro.h"
+#include <vector>
+#include <ostream>
+
+namespace otb
+{
+
+/** \class QuantileSketch
+ * \brief Mergeable streaming summary of a scalar distribution
+ *
+ * This class implements a compactor based quantile sketch (KLL). Values
+ * are inserted one at a time in the lowest level of a stack of
+ * compactors. When a level is full, it is sorted and every other value is
+ * promoted to the next level with a doubled weight. The capacity of each
+ * level decreases geometrically from the top level, so that the memory
+ * footprint is bounded by roughly 3*K values whatever the number of
+ * inserted samples.
+ *
+ * Two sketches built with the same accuracy parameter can be merged, which
+ * allows to build one sketch per thread (or per streaming division) and to
+ * combine them afterwards. The minimum and maximum values are tracked
+ * exactly, so that the quantiles 0 and 1 are always exact.
+ *
+ * The normalized rank error is approximately 2.446/K^0.943 (around 1.7% for
+ * the default K=200, 0.3% for K=1000), see GetNormalizedRankError().
+ *
+ * Each compaction promotes either the even or the odd ranked values,
+ * chosen by a random coin. The coin is drawn from a small pseudo-random
+ * generator reset to a fixed seed by Clear(), so that the randomized error
+ * bound above applies while the result is reproducible: it only depends on
+ * the sequence of insertions and merges.
+ *
+ * \ingroup OTBStatistics
+ */
+class ITK_EXPORT QuantileSketch
+{
+public:
+  typedef QuantileSketch        Self;
+  typedef double                ValueType;
+  typedef std::vector<ValueType> LevelType;
+
+  /** Constructor, with the accuracy parameter K */
+  explicit QuantileSketch(unsigned int k = 200);
+
+  /** Set the accuracy parameter. This clears the sketch content. */
+  void SetAccuracyParameter(unsigned int k);
+
+  /** Get the accuracy parameter */
+  unsigned int GetAccuracyParameter() const
+  {
+    return m_K;
+  }
+
+  /** Remove all values from the sketch */
+  void Clear();
+
+  /** Insert a new value */
+  void Insert(ValueType value);
+
+  /** Merge another sketch into this one. Both sketches must share the
+   *  same accuracy parameter. */
+  void Merge(const Self & other);
+
+  /** Get the approximate quantile of order p (p in [0,1]). If the sketch
+   *  is empty, 0 is returned. */
+  ValueType GetQuantile(double p) const;
+
+  /** Get several quantiles at once (single sort of the retained values) */
+  std::vector<ValueType> GetQuantiles(const std::vector<double> & p) const;
+
+  /** Number of inserted values */
+  unsigned long GetCount() const
+  {
+    return m_Count;
+  }
+
+  /** Number of values currently retained by the sketch */
+  unsigned long GetNumberOfRetainedValues() const;
+
+  /** Exact minimum of the inserted values */
+  ValueType GetMinimum() const
+  {
+    return m_Minimum;
+  }
+
+  /** Exact maximum of the inserted values */
+  ValueType GetMaximum() const
+  {
+    return m_Maximum;
+  }
+
+  /** Approximate normalized rank error bound for the current K */
+  double GetNormalizedRankError() const;
+
+  /** Print the sketch state */
+  void Print(std::ostream & os) const;
+
+private:
+  /** Capacity of a given level, depends on the current number of levels */
+  unsigned long GetLevelCapacity(unsigned int level) const;
+
+  /** Compact levels until the sketch fits in its capacity */
+  void Compress();
+
+  /** Compact a single level into the next one */
+  void CompactLevel(unsigned int level);
+
+  /** Draw the next random coin (0 or 1) */
+  unsigned int FlipCoin();
+
+  /** Collect retained values sorted, with cumulated weights */
+  void GetSortedValues(std::vector<ValueType> & values,
+                       std::vector<double> & cumWeights) const;
+
+  std::vector<LevelType> m_Levels;
+  unsigned int           m_K;
+  unsigned long          m_Count;
+  unsigned long          m_RetainedValues;
+  unsigned long          m_Capacity;
+  ValueType              m_Minimum;
+  ValueType              m_Maximum;
+  unsigned int           m_RandomState;
+};
+
+} // end namespace otb
+
+#endif
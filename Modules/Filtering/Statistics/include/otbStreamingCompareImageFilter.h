@@ -27,6 +27,7 @@
 #include "itkArray.h"
 #include "itkSimpleDataObjectDecorator.h"
 #include "otbPersistentFilterStreamingDecorator.h"
+#include <vector>
 
 namespace otb
 {
@@ -34,6 +35,18 @@ namespace otb
 /** \class PersistentCompareImageFilter
  * \brief Compute mean squared error,  mean absolute error and PSNR of two imagee using the output requested region.
  *
+ * The two inputs are first compared line by line on their raw pixel
+ * buffers. Identical lines without NaN values only contribute to the pixel
+ * count and to the range of the reference image: the detailed metrics are
+ * computed on the other lines, so that NaN values still propagate to the
+ * metrics.
+ *
+ * Each requested region processed by the filter (i.e. each streaming
+ * block) containing at least one different pixel (values compared as in
+ * GetDiffCount(), so that +0 and -0 are equal) is recorded, with its
+ * number of different pixels, so that the location of the differences can
+ * be reported (see GetDifferingRegions()).
+ *
  *  This filter persists its temporary data. It means that if you Update it n times on n different
  * requested regions, the output estimators will be the estimators of the whole set of n regions.
  *
@@ -91,6 +104,10 @@ public:
   typedef itk::SimpleDataObjectDecorator<RealType>  RealObjectType;
   typedef itk::SimpleDataObjectDecorator<PixelType> PixelObjectType;
 
+  /** Type of the list of differing regions */
+  typedef std::vector<RegionType>    RegionListType;
+  typedef std::vector<unsigned long> CountListType;
+
   /** Get the inputs */
   const TInputImage * GetInput1();
   const TInputImage * GetInput2();
@@ -136,6 +153,21 @@ public:
   itkGetMacro(PhysicalSpaceCheck,bool);
   itkSetMacro(PhysicalSpaceCheck,bool);
 
+  /** Return the processed regions where the inputs differ */
+  const RegionListType & GetDifferingRegions() const
+  {
+    return m_DifferingRegions;
+  }
+
+  /** Return the number of different pixels of each differing region */
+  const CountListType & GetDifferingRegionsDiffCount() const
+  {
+    return m_DifferingRegionsDiffCount;
+  }
+
+  /** Return the number of regions processed since the last Reset() */
+  itkGetConstMacro(NumberOfProcessedRegions, unsigned long);
+
   /** Make a DataObject of the correct type to be used as the specified
    * output. */
   DataObjectPointer MakeOutput(DataObjectPointerArraySizeType idx) ITK_OVERRIDE;
@@ -159,6 +191,12 @@ protected:
                              outputRegionForThread,
                              itk::ThreadIdType threadId) ITK_OVERRIDE;
 
+  /** Clear the per-region counters */
+  void BeforeThreadedGenerateData() ITK_OVERRIDE;
+
+  /** Record the processed region if the inputs differ */
+  void AfterThreadedGenerateData() ITK_OVERRIDE;
+
   /** Allows skipping the verification of physical space between
    *  the two input images (see flag m_PhysicalSpaceCheck)
    */
@@ -175,6 +213,15 @@ private:
   itk::Array<long>      m_Count;
   itk::Array<long>      m_DiffCount;
   bool                  m_PhysicalSpaceCheck;
+
+  /** Per-thread number of differing lines and of different pixels in the
+   *  region being processed */
+  itk::Array<long>      m_RegionDiffLines;
+  itk::Array<long>      m_RegionDiffCount;
+
+  RegionListType        m_DifferingRegions;
+  CountListType         m_DifferingRegionsDiffCount;
+  unsigned long         m_NumberOfProcessedRegions;
 }; // end of class PersistentCompareImageFilter
 
 /*===========================================================================*/
@@ -229,6 +276,8 @@ public:
   typedef typename Superclass::FilterType       CompareFilterType;
   typedef typename CompareFilterType::PixelType PixelType;
   typedef typename CompareFilterType::RealType  RealType;
+  typedef typename CompareFilterType::RegionListType RegionListType;
+  typedef typename CompareFilterType::CountListType  CountListType;
   typedef TInputImage                           InputImageType;
 
   /** Type of DataObjects used for scalar outputs */
@@ -315,6 +364,24 @@ public:
     return this->GetFilter()->GetPhysicalSpaceCheck();
   }
 
+  /** Return the streamed regions where the inputs differ */
+  const RegionListType & GetDifferingRegions() const
+  {
+    return this->GetFilter()->GetDifferingRegions();
+  }
+
+  /** Return the number of different pixels of each differing region */
+  const CountListType & GetDifferingRegionsDiffCount() const
+  {
+    return this->GetFilter()->GetDifferingRegionsDiffCount();
+  }
+
+  /** Return the number of streamed regions */
+  unsigned long GetNumberOfProcessedRegions() const
+  {
+    return this->GetFilter()->GetNumberOfProcessedRegions();
+  }
+
 protected:
   /** Constructor */
   StreamingCompareImageFilter() {};
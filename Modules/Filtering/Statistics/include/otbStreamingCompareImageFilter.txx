@@ -22,10 +22,12 @@
 #define otbStreamingCompareImageFilter_txx
 #include "otbStreamingCompareImageFilter.h"
 
-#include "itkImageRegionIterator.h"
+#include "itkImageScanlineConstIterator.h"
 #include "itkProgressReporter.h"
 #include "itkMath.h"
+#include "vnl/vnl_math.h"
 #include "otbMacro.h"
+#include <cstring>
 
 namespace otb
 {
@@ -33,7 +35,8 @@ namespace otb
 template<class TInputImage>
 PersistentCompareImageFilter<TInputImage>
 ::PersistentCompareImageFilter() : m_SquareOfDifferences(1), m_AbsoluteValueOfDifferences(1),
- m_ThreadMinRef(1), m_ThreadMaxRef(1), m_Count(1), m_DiffCount(1), m_PhysicalSpaceCheck(true)
+ m_ThreadMinRef(1), m_ThreadMaxRef(1), m_Count(1), m_DiffCount(1), m_PhysicalSpaceCheck(true),
+ m_RegionDiffLines(1), m_RegionDiffCount(1), m_NumberOfProcessedRegions(0)
 {
   this->SetNumberOfRequiredInputs( 2 );
   // first output is a copy of the image, DataObject created by
@@ -299,6 +302,44 @@ PersistentCompareImageFilter<TInputImage>
   m_AbsoluteValueOfDifferences.Fill(itk::NumericTraits<RealType>::Zero);
   m_ThreadMinRef.Fill(itk::NumericTraits<PixelType>::max());
   m_ThreadMaxRef.Fill(itk::NumericTraits<PixelType>::NonpositiveMin());
+
+  m_RegionDiffLines.SetSize(numberOfThreads);
+  m_RegionDiffCount.SetSize(numberOfThreads);
+  m_RegionDiffLines.Fill(itk::NumericTraits<long>::Zero);
+  m_RegionDiffCount.Fill(itk::NumericTraits<long>::Zero);
+  m_DifferingRegions.clear();
+  m_DifferingRegionsDiffCount.clear();
+  m_NumberOfProcessedRegions = 0;
+}
+
+template<class TInputImage>
+void
+PersistentCompareImageFilter<TInputImage>
+::BeforeThreadedGenerateData()
+{
+  m_RegionDiffLines.Fill(itk::NumericTraits<long>::Zero);
+  m_RegionDiffCount.Fill(itk::NumericTraits<long>::Zero);
+}
+
+template<class TInputImage>
+void
+PersistentCompareImageFilter<TInputImage>
+::AfterThreadedGenerateData()
+{
+  long diffLines = 0;
+  long diffCount = 0;
+  for (unsigned int i = 0; i < m_RegionDiffLines.Size(); ++i)
+    {
+    diffLines += m_RegionDiffLines[i];
+    diffCount += m_RegionDiffCount[i];
+    }
+
+  ++m_NumberOfProcessedRegions;
+  if (diffLines > 0)
+    {
+    m_DifferingRegions.push_back(this->GetOutput()->GetRequestedRegion());
+    m_DifferingRegionsDiffCount.push_back(static_cast<unsigned long>(diffCount));
+    }
 }
 
 template<class TInputImage>
@@ -322,45 +363,96 @@ PersistentCompareImageFilter<TInputImage>
   InputImagePointer inputPtr1 =  const_cast<TInputImage *>(this->GetInput(0));
   InputImagePointer inputPtr2 =  const_cast<TInputImage *>(this->GetInput(1));
 
-  // support progress methods/callbacks
-  itk::ProgressReporter progress(this, threadId, outputRegionForThread.GetNumberOfPixels());
+  // support progress methods/callbacks (one step per line)
+  itk::ProgressReporter progress(this, threadId, outputRegionForThread.GetNumberOfPixels() / outputRegionForThread.GetSize()[0]);
 
   RealType  realValue1, realValue2;
   PixelType value1, value2;
 
-  itk::ImageRegionConstIterator<TInputImage> it1(inputPtr1, outputRegionForThread);
-  itk::ImageRegionConstIterator<TInputImage> it2(inputPtr2, outputRegionForThread);
+  itk::ImageScanlineConstIterator<TInputImage> it1(inputPtr1, outputRegionForThread);
+  itk::ImageScanlineConstIterator<TInputImage> it2(inputPtr2, outputRegionForThread);
+
+  const size_t lineLength = outputRegionForThread.GetSize()[0];
 
   it1.GoToBegin();
   it2.GoToBegin();
   // do the work
   while (!it1.IsAtEnd() && !it2.IsAtEnd())
     {
-    value1 = it1.Get();
-    realValue1 = static_cast<RealType>(value1);
-
-    value2 = it2.Get();
-    realValue2 = static_cast<RealType>(value2);
-
-    if (value1 < m_ThreadMinRef[threadId])
+    // Fast path: compare the raw buffers of the line. Lines holding NaN
+    // values are not skipped, so that NaN propagates to the metrics.
+    const PixelType * line1 = inputPtr1->GetBufferPointer() + inputPtr1->ComputeOffset(it1.GetIndex());
+    const PixelType * line2 = inputPtr2->GetBufferPointer() + inputPtr2->ComputeOffset(it2.GetIndex());
+    bool identical = (std::memcmp(line1, line2, lineLength * sizeof(PixelType)) == 0);
+    if (identical && !itk::NumericTraits<PixelType>::is_integer)
       {
-      m_ThreadMinRef[threadId] = value1;
+      for (size_t i = 0; i < lineLength; ++i)
+        {
+        if (vnl_math_isnan(static_cast<RealType>(line1[i])))
+          {
+          identical = false;
+          break;
+          }
+        }
       }
-    if (value1 > m_ThreadMaxRef[threadId])
+    if (identical)
+      {
+      // identical values: only the range of the reference is needed
+      for (size_t i = 0; i < lineLength; ++i)
+        {
+        if (line1[i] < m_ThreadMinRef[threadId])
+          {
+          m_ThreadMinRef[threadId] = line1[i];
+          }
+        if (line1[i] > m_ThreadMaxRef[threadId])
+          {
+          m_ThreadMaxRef[threadId] = line1[i];
+          }
+        }
+      m_Count[threadId] += lineLength;
+      it1.NextLine();
+      it2.NextLine();
+      progress.CompletedPixel();
+      continue;
+      }
+
+    const long lineDiffCount = m_RegionDiffCount[threadId];
+    while (!it1.IsAtEndOfLine())
       {
-      m_ThreadMaxRef[threadId] = value1;
+      value1 = it1.Get();
+      realValue1 = static_cast<RealType>(value1);
+
+      value2 = it2.Get();
+      realValue2 = static_cast<RealType>(value2);
+
+      if (value1 < m_ThreadMinRef[threadId])
+        {
+        m_ThreadMinRef[threadId] = value1;
+        }
+      if (value1 > m_ThreadMaxRef[threadId])
+        {
+        m_ThreadMaxRef[threadId] = value1;
+        }
+
+      RealType diffVal = realValue1 - realValue2;
+      m_SquareOfDifferences[threadId] +=  diffVal * diffVal;
+      m_AbsoluteValueOfDifferences[threadId] += vcl_abs( diffVal );
+      if (! itk::Math::FloatAlmostEqual(realValue1, realValue2))
+        {
+        m_DiffCount[threadId]++;
+        m_RegionDiffCount[threadId]++;
+        }
+      m_Count[threadId]++;
+      ++it1;
+      ++it2;
       }
-    
-    RealType diffVal = realValue1 - realValue2;
-    m_SquareOfDifferences[threadId] +=  diffVal * diffVal;
-    m_AbsoluteValueOfDifferences[threadId] += vcl_abs( diffVal );
-    if (! itk::Math::FloatAlmostEqual(realValue1, realValue2))
+    // the line differs only if some values differ (not only their bytes)
+    if (m_RegionDiffCount[threadId] > lineDiffCount)
       {
-      m_DiffCount[threadId]++;
+      m_RegionDiffLines[threadId]++;
       }
-    m_Count[threadId]++;
-    ++it1;
-    ++it2;
+    it1.NextLine();
+    it2.NextLine();
     progress.CompletedPixel();
     }
 }
@@ -375,6 +467,8 @@ PersistentCompareImageFilter<TImage>
   os << indent << "MSE: "    << this->GetMSE() << std::endl;
   os << indent << "MAE: " << this->GetMAE() << std::endl; 
   os << indent << "Count: " << this->GetDiffCount() << std::endl;
+  os << indent << "Differing regions: " << m_DifferingRegions.size()
+     << " / " << m_NumberOfProcessedRegions << std::endl;
 }
 } // end namespace otb
 #endif
@@ -0,0 +1,319 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef otbStreamingQuantilesVectorImageFilter_h
+#define otbStreamingQuantilesVectorImageFilter_h
+
+#include "otbPersistentImageFilter.h"
+#include "otbPersistentFilterStreamingDecorator.h"
+#include "otbQuantileSketch.h"
+#include "otbImage.h"
+#include "itkNumericTraits.h"
+#include "itkVariableLengthVector.h"
+#include "itkSimpleFastMutexLock.h"
+#include <map>
+
+namespace otb
+{
+
+/** \class PersistentQuantilesVectorImageFilter
+ * \brief Compute approximate per-band quantiles of a large image using streaming
+ *
+ * Each band is summarized by a QuantileSketch, whose memory footprint is
+ * bounded by the accuracy parameter whatever the image size. Any quantile
+ * can be queried once the image has been streamed, in a single pass over
+ * the data.
+ *
+ * The statistics can be computed on a regular subsampled grid (see
+ * SetSubSamplingRate()). The grid is anchored on the image origin index.
+ *
+ * The sketch result depends on the order of insertions. To get the same
+ * quantiles whatever the number of threads and the streaming layout, the
+ * sampled values are gathered line by line on the grid. Once all the
+ * samples of a line have been visited, its values are sorted and inserted
+ * in the sketches, lines being inserted in increasing index order. A
+ * complete line waiting for a previous one is kept in memory: with a top
+ * to bottom streaming, this is at most one stripe (or one row of tiles) of
+ * the grid. Lines still pending when the filter is updated on a part of
+ * the image only are inserted in Synthetize(), in the same order.
+ *
+ * Values equal to the no-data value are ignored band by band if NoDataFlag
+ * is On. NaN values are always ignored. An optional mask can be set: pixels
+ * for which the first mask component is greater than or equal to the mask
+ * threshold (0.5 by default) are ignored.
+ *
+ *  This filter persists its temporary data. It means that if you Update it n times on n different
+ * requested regions, the output quantiles will be the quantiles of the whole set of n regions.
+ *
+ * To reset the temporary data, one should call the Reset() function.
+ *
+ * To get the quantiles once the regions have been processed via the pipeline, use the Synthetize() method.
+ *
+ * \sa QuantileSketch
+ * \sa PersistentImageFilter
+ * \ingroup Streamed
+ * \ingroup Multithreaded
+ * \ingroup MathematicalStatisticsImageFilters
+ *
+ * \ingroup OTBStatistics
+ */
+template<class TInputImage, class TMaskImage = otb::Image<unsigned char, TInputImage::ImageDimension> >
+class ITK_EXPORT PersistentQuantilesVectorImageFilter :
+  public PersistentImageFilter<TInputImage, TInputImage>
+{
+public:
+  /** Standard Self typedef */
+  typedef PersistentQuantilesVectorImageFilter            Self;
+  typedef PersistentImageFilter<TInputImage, TInputImage> Superclass;
+  typedef itk::SmartPointer<Self>                         Pointer;
+  typedef itk::SmartPointer<const Self>                   ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Runtime information support. */
+  itkTypeMacro(PersistentQuantilesVectorImageFilter, PersistentImageFilter);
+
+  /** Image related typedefs. */
+  typedef TInputImage                             ImageType;
+  typedef typename TInputImage::Pointer           InputImagePointer;
+  typedef typename TInputImage::RegionType        RegionType;
+  typedef typename TInputImage::SizeType          SizeType;
+  typedef typename TInputImage::IndexType         IndexType;
+  typedef typename TInputImage::PixelType         PixelType;
+  typedef typename TInputImage::InternalPixelType InternalPixelType;
+
+  typedef TMaskImage                              MaskImageType;
+  typedef typename TMaskImage::PixelType          MaskPixelType;
+
+  itkStaticConstMacro(InputImageDimension, unsigned int, TInputImage::ImageDimension);
+
+  /** Type to use for computations. */
+  typedef typename itk::NumericTraits<InternalPixelType>::RealType RealType;
+  typedef itk::VariableLengthVector<RealType>                      RealPixelType;
+
+  /** Sketch typedefs */
+  typedef QuantileSketch                          SketchType;
+  typedef std::vector<SketchType>                 SketchListType;
+
+  /** Smart Pointer type to a DataObject. */
+  typedef typename itk::DataObject::Pointer       DataObjectPointer;
+  typedef itk::ProcessObject::DataObjectPointerArraySizeType DataObjectPointerArraySizeType;
+
+  /** Set the no data value. These value are ignored in quantiles
+   *  computation if NoDataFlag is On
+   */
+  itkSetMacro(NoDataValue, InternalPixelType);
+
+  /** Get the no data value. */
+  itkGetConstReferenceMacro(NoDataValue, InternalPixelType);
+
+  /** Set the NoDataFlag. If set to true, band values equal to
+   *  m_NoDataValue are ignored.
+   */
+  itkSetMacro(NoDataFlag, bool);
+  itkGetMacro(NoDataFlag, bool);
+  itkBooleanMacro(NoDataFlag);
+
+  /** Set the accuracy parameter of the sketches (default is 200). The
+   *  memory used per band is about 3 times this value. */
+  itkSetMacro(AccuracyParameter, unsigned int);
+  itkGetMacro(AccuracyParameter, unsigned int);
+
+  /** Set the subsampling rate along each direction */
+  itkSetMacro(SubSamplingRate, unsigned int);
+  itkGetMacro(SubSamplingRate, unsigned int);
+
+  /** Set the mask threshold (default is 0.5). Pixels whose first mask
+   *  component is greater than or equal to this value are ignored. */
+  itkSetMacro(MaskThreshold, double);
+  itkGetMacro(MaskThreshold, double);
+
+  /** Set the optional mask image */
+  void SetMaskImage(const MaskImageType * mask);
+
+  /** Get the optional mask image */
+  const MaskImageType * GetMaskImage() const;
+
+  /** Return the approximate quantile of order p (in [0,1]) of each band.
+   *  Valid after Synthetize(). */
+  RealPixelType GetQuantile(double p) const;
+
+  /** Return the merged sketch of a given band. Valid after Synthetize(). */
+  const SketchType & GetSketch(unsigned int band) const;
+
+  /** Return the number of bands summarized in the output sketches */
+  unsigned int GetNumberOfSketches() const
+  {
+    return static_cast<unsigned int>(m_Sketches.size());
+  }
+
+  /** Make a DataObject of the correct type to be used as the specified
+   * output.
+   */
+  DataObjectPointer MakeOutput(DataObjectPointerArraySizeType idx) ITK_OVERRIDE;
+  using Superclass::MakeOutput;
+
+  /** Pass the input through unmodified. Do this by Grafting in the
+   *  AllocateOutputs method.
+   */
+  void AllocateOutputs() ITK_OVERRIDE;
+  void GenerateOutputInformation() ITK_OVERRIDE;
+  void Synthetize(void) ITK_OVERRIDE;
+  void Reset(void) ITK_OVERRIDE;
+
+protected:
+  PersistentQuantilesVectorImageFilter();
+  ~PersistentQuantilesVectorImageFilter() ITK_OVERRIDE {}
+  void PrintSelf(std::ostream& os, itk::Indent indent) const ITK_OVERRIDE;
+  /** Multi-thread version GenerateData. */
+  void  ThreadedGenerateData(const RegionType& outputRegionForThread, itk::ThreadIdType threadId) ITK_OVERRIDE;
+
+private:
+  PersistentQuantilesVectorImageFilter(const Self &); //purposely not implemented
+  void operator =(const Self&); //purposely not implemented
+
+  /** Samples of a grid line not inserted in the sketches yet */
+  struct LineType
+  {
+    LineType() : NumberOfVisitedSamples(0UL), Values() {}
+    unsigned long                      NumberOfVisitedSamples;
+    std::vector<std::vector<double> >  Values;
+  };
+  typedef std::map<unsigned long, LineType> LineMapType;
+
+  /** Restrict a region to its bounding box on the subsampling grid.
+   *  Returns false if the region contains no grid point. */
+  bool SnapRegionToGrid(RegionType & region) const;
+
+  /** Index of the grid line holding a grid point */
+  unsigned long ComputeLineIndex(const IndexType & index) const;
+
+  /** Insert the complete lines following the last inserted one. The
+   *  caller must hold m_Mutex. */
+  void InsertCompleteLines();
+
+  /** Insert the values of a line in the sketches */
+  void InsertLine(LineType & line);
+
+  SketchListType           m_Sketches;
+  LineMapType              m_PendingLines;
+  unsigned long            m_NextLine;
+  unsigned long            m_SamplesPerLine;
+  RegionType               m_GridRegion;
+  itk::SimpleFastMutexLock m_Mutex;
+  unsigned int             m_AccuracyParameter;
+  unsigned int             m_SubSamplingRate;
+  bool                     m_NoDataFlag;
+  InternalPixelType        m_NoDataValue;
+  double                   m_MaskThreshold;
+
+}; // end of class PersistentQuantilesVectorImageFilter
+
+/**===========================================================================*/
+
+/** \class StreamingQuantilesVectorImageFilter
+ * \brief This class streams the whole input image through the PersistentQuantilesVectorImageFilter.
+ *
+ * It calls the Reset() method of the PersistentQuantilesVectorImageFilter
+ * before streaming the image and the Synthetize() method after having
+ * streamed the image. Any per-band quantile can then be retrieved with
+ * GetQuantile(), without streaming the image again.
+ *
+ * \sa PersistentQuantilesVectorImageFilter
+ * \sa PersistentImageFilter
+ * \sa PersistentFilterStreamingDecorator
+ * \sa StreamingImageVirtualWriter
+ * \ingroup Streamed
+ * \ingroup Multithreaded
+ * \ingroup MathematicalStatisticsImageFilters
+ *
+ * \ingroup OTBStatistics
+ */
+template<class TInputImage, class TMaskImage = otb::Image<unsigned char, TInputImage::ImageDimension> >
+class ITK_EXPORT StreamingQuantilesVectorImageFilter :
+  public PersistentFilterStreamingDecorator<PersistentQuantilesVectorImageFilter<TInputImage, TMaskImage> >
+{
+public:
+  /** Standard Self typedef */
+  typedef StreamingQuantilesVectorImageFilter Self;
+  typedef PersistentFilterStreamingDecorator
+  <PersistentQuantilesVectorImageFilter<TInputImage, TMaskImage> > Superclass;
+  typedef itk::SmartPointer<Self>       Pointer;
+  typedef itk::SmartPointer<const Self> ConstPointer;
+
+  /** Type macro */
+  itkNewMacro(Self);
+
+  /** Creation through object factory macro */
+  itkTypeMacro(StreamingQuantilesVectorImageFilter, PersistentFilterStreamingDecorator);
+
+  typedef TInputImage                                 InputImageType;
+  typedef TMaskImage                                  MaskImageType;
+  typedef typename Superclass::FilterType             InternalFilterType;
+  typedef typename InternalFilterType::RealPixelType  RealPixelType;
+  typedef typename InternalFilterType::SketchType     SketchType;
+
+  using Superclass::SetInput;
+  void SetInput(InputImageType * input)
+  {
+    this->GetFilter()->SetInput(input);
+  }
+  const InputImageType * GetInput()
+  {
+    return this->GetFilter()->GetInput();
+  }
+
+  /** Set the optional mask image */
+  void SetMaskImage(const MaskImageType * mask)
+  {
+    this->GetFilter()->SetMaskImage(mask);
+  }
+
+  /** Return the approximate quantile of order p of each band */
+  RealPixelType GetQuantile(double p) const
+  {
+    return this->GetFilter()->GetQuantile(p);
+  }
+
+  /** Return the merged sketch of a given band */
+  const SketchType & GetSketch(unsigned int band) const
+  {
+    return this->GetFilter()->GetSketch(band);
+  }
+
+protected:
+  /** Constructor */
+  StreamingQuantilesVectorImageFilter() {};
+  /** Destructor */
+  ~StreamingQuantilesVectorImageFilter() ITK_OVERRIDE {}
+
+private:
+  StreamingQuantilesVectorImageFilter(const Self &); //purposely not implemented
+  void operator =(const Self&); //purposely not implemented
+};
+
+} // end namespace otb
+
+#ifndef OTB_MANUAL_INSTANTIATION
+#include "otbStreamingQuantilesVectorImageFilter.txx"
+#endif
+
+#endif
@@ -0,0 +1,389 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef otbStreamingQuantilesVectorImageFilter_txx
+#define otbStreamingQuantilesVectorImageFilter_txx
+#include "otbStreamingQuantilesVectorImageFilter.h"
+
+#include "otbSubsampledImageRegionConstIterator.h"
+#include "itkDefaultConvertPixelTraits.h"
+#include "itkProgressReporter.h"
+#include "vnl/vnl_math.h"
+#include <algorithm>
+
+namespace otb
+{
+
+template<class TInputImage, class TMaskImage>
+PersistentQuantilesVectorImageFilter<TInputImage, TMaskImage>
+::PersistentQuantilesVectorImageFilter() :
+  m_Sketches(),
+  m_PendingLines(),
+  m_NextLine(0UL),
+  m_SamplesPerLine(0UL),
+  m_AccuracyParameter(200),
+  m_SubSamplingRate(1),
+  m_NoDataFlag(false),
+  m_NoDataValue(itk::NumericTraits<InternalPixelType>::Zero),
+  m_MaskThreshold(0.5)
+{
+  // first output is a copy of the image, DataObject created by
+  // superclass
+  this->SetNumberOfRequiredInputs(1);
+}
+
+template<class TInputImage, class TMaskImage>
+itk::DataObject::Pointer
+PersistentQuantilesVectorImageFilter<TInputImage, TMaskImage>
+::MakeOutput(DataObjectPointerArraySizeType itkNotUsed(output))
+{
+  return static_cast<itk::DataObject*>(TInputImage::New().GetPointer());
+}
+
+template<class TInputImage, class TMaskImage>
+void
+PersistentQuantilesVectorImageFilter<TInputImage, TMaskImage>
+::SetMaskImage(const MaskImageType * mask)
+{
+  this->itk::ProcessObject::SetNthInput(1, const_cast<MaskImageType *>(mask));
+}
+
+template<class TInputImage, class TMaskImage>
+const typename PersistentQuantilesVectorImageFilter<TInputImage, TMaskImage>::MaskImageType *
+PersistentQuantilesVectorImageFilter<TInputImage, TMaskImage>
+::GetMaskImage() const
+{
+  if (this->GetNumberOfInputs() < 2)
+    {
+    return ITK_NULLPTR;
+    }
+  return static_cast<const MaskImageType *>(this->itk::ProcessObject::GetInput(1));
+}
+
+template<class TInputImage, class TMaskImage>
+typename PersistentQuantilesVectorImageFilter<TInputImage, TMaskImage>::RealPixelType
+PersistentQuantilesVectorImageFilter<TInputImage, TMaskImage>
+::GetQuantile(double p) const
+{
+  RealPixelType quantile(static_cast<unsigned int>(m_Sketches.size()));
+  for (unsigned int k = 0; k < m_Sketches.size(); ++k)
+    {
+    quantile[k] = static_cast<RealType>(m_Sketches[k].GetQuantile(p));
+    }
+  return quantile;
+}
+
+template<class TInputImage, class TMaskImage>
+const typename PersistentQuantilesVectorImageFilter<TInputImage, TMaskImage>::SketchType &
+PersistentQuantilesVectorImageFilter<TInputImage, TMaskImage>
+::GetSketch(unsigned int band) const
+{
+  if (band >= m_Sketches.size())
+    {
+    itkExceptionMacro(<< "No sketch available for band " << band
+                      << " (" << m_Sketches.size() << " sketches computed)");
+    }
+  return m_Sketches[band];
+}
+
+template<class TInputImage, class TMaskImage>
+void
+PersistentQuantilesVectorImageFilter<TInputImage, TMaskImage>
+::GenerateOutputInformation()
+{
+  Superclass::GenerateOutputInformation();
+  if (this->GetInput())
+    {
+    this->GetOutput()->CopyInformation(this->GetInput());
+    this->GetOutput()->SetLargestPossibleRegion(this->GetInput()->GetLargestPossibleRegion());
+
+    if (this->GetOutput()->GetRequestedRegion().GetNumberOfPixels() == 0)
+      {
+      this->GetOutput()->SetRequestedRegion(this->GetOutput()->GetLargestPossibleRegion());
+      }
+    }
+}
+
+template<class TInputImage, class TMaskImage>
+void
+PersistentQuantilesVectorImageFilter<TInputImage, TMaskImage>
+::AllocateOutputs()
+{
+  // This is commented to prevent the streaming of the whole image for the first stream strip
+  // It shall not cause any problem because the output image of this filter is not intended to be used.
+  //InputImagePointer image = const_cast< TInputImage * >( this->GetInput() );
+  //this->GraftOutput( image );
+  // Nothing that needs to be allocated for the remaining outputs
+}
+
+template<class TInputImage, class TMaskImage>
+void
+PersistentQuantilesVectorImageFilter<TInputImage, TMaskImage>
+::Reset()
+{
+  TInputImage * inputPtr = const_cast<TInputImage *>(this->GetInput());
+  inputPtr->UpdateOutputInformation();
+
+  const unsigned int numberOfComponent = inputPtr->GetNumberOfComponentsPerPixel();
+
+  if (m_SubSamplingRate == 0)
+    {
+    itkExceptionMacro(<< "Subsampling rate must be strictly positive");
+    }
+
+  m_Sketches.assign(numberOfComponent, SketchType(m_AccuracyParameter));
+  m_PendingLines.clear();
+  m_NextLine = 0UL;
+
+  m_GridRegion = inputPtr->GetLargestPossibleRegion();
+  if (this->SnapRegionToGrid(m_GridRegion))
+    {
+    m_SamplesPerLine = (m_GridRegion.GetSize()[0] - 1) / m_SubSamplingRate + 1;
+    }
+  else
+    {
+    m_SamplesPerLine = 0UL;
+    }
+}
+
+template<class TInputImage, class TMaskImage>
+void
+PersistentQuantilesVectorImageFilter<TInputImage, TMaskImage>
+::Synthetize()
+{
+  // Lines left incomplete (the filter was updated on a part of the image)
+  // are inserted in increasing index order
+  for (typename LineMapType::iterator lineIt = m_PendingLines.begin();
+       lineIt != m_PendingLines.end(); ++lineIt)
+    {
+    this->InsertLine(lineIt->second);
+    }
+  m_PendingLines.clear();
+}
+
+template<class TInputImage, class TMaskImage>
+unsigned long
+PersistentQuantilesVectorImageFilter<TInputImage, TMaskImage>
+::ComputeLineIndex(const IndexType & index) const
+{
+  unsigned long line = 0UL;
+  unsigned long stride = 1UL;
+  for (unsigned int i = 1; i < InputImageDimension; ++i)
+    {
+    line += stride * static_cast<unsigned long>((index[i] - m_GridRegion.GetIndex()[i]) / m_SubSamplingRate);
+    stride *= (m_GridRegion.GetSize()[i] - 1) / m_SubSamplingRate + 1;
+    }
+  return line;
+}
+
+template<class TInputImage, class TMaskImage>
+void
+PersistentQuantilesVectorImageFilter<TInputImage, TMaskImage>
+::InsertLine(LineType & line)
+{
+  for (unsigned int j = 0; j < line.Values.size() && j < m_Sketches.size(); ++j)
+    {
+    // sort the values so that the insertion order does not depend on the
+    // regions the line was split into
+    std::vector<double> & values = line.Values[j];
+    std::sort(values.begin(), values.end());
+    for (std::vector<double>::const_iterator it = values.begin(); it != values.end(); ++it)
+      {
+      m_Sketches[j].Insert(*it);
+      }
+    }
+}
+
+template<class TInputImage, class TMaskImage>
+void
+PersistentQuantilesVectorImageFilter<TInputImage, TMaskImage>
+::InsertCompleteLines()
+{
+  typename LineMapType::iterator lineIt = m_PendingLines.find(m_NextLine);
+  while (lineIt != m_PendingLines.end()
+         && lineIt->second.NumberOfVisitedSamples >= m_SamplesPerLine)
+    {
+    this->InsertLine(lineIt->second);
+    m_PendingLines.erase(lineIt);
+    ++m_NextLine;
+    lineIt = m_PendingLines.find(m_NextLine);
+    }
+}
+
+template<class TInputImage, class TMaskImage>
+bool
+PersistentQuantilesVectorImageFilter<TInputImage, TMaskImage>
+::SnapRegionToGrid(RegionType & region) const
+{
+  const typename IndexType::IndexValueType rate = m_SubSamplingRate;
+  IndexType start = region.GetIndex();
+  SizeType  size = region.GetSize();
+
+  for (unsigned int i = 0; i < InputImageDimension; ++i)
+    {
+    const typename IndexType::IndexValueType end = start[i] + static_cast<typename IndexType::IndexValueType>(size[i]);
+    const typename IndexType::IndexValueType shift = ((rate - start[i] % rate) % rate);
+    if (start[i] + shift >= end)
+      {
+      return false;
+      }
+    start[i] += shift;
+    size[i] = static_cast<typename SizeType::SizeValueType>(end - start[i]);
+    }
+
+  region.SetIndex(start);
+  region.SetSize(size);
+  return true;
+}
+
+template<class TInputImage, class TMaskImage>
+void
+PersistentQuantilesVectorImageFilter<TInputImage, TMaskImage>
+::ThreadedGenerateData(const RegionType& outputRegionForThread, itk::ThreadIdType threadId)
+{
+  typedef itk::DefaultConvertPixelTraits<MaskPixelType> MaskTraitsType;
+
+  const TInputImage * inputPtr = this->GetInput();
+  const MaskImageType * maskPtr = this->GetMaskImage();
+
+  // Restrict the region to the subsampling grid
+  RegionType region = outputRegionForThread;
+  if (!this->SnapRegionToGrid(region))
+    {
+    return;
+    }
+
+  unsigned long nbSamples = 1;
+  for (unsigned int i = 0; i < InputImageDimension; ++i)
+    {
+    nbSamples *= (region.GetSize()[i] - 1) / m_SubSamplingRate + 1;
+    }
+
+  // support progress methods/callbacks
+  itk::ProgressReporter progress(this, threadId, nbSamples);
+
+  const unsigned int numberOfComponent = static_cast<unsigned int>(m_Sketches.size());
+  const unsigned long samplesPerRegionLine = (region.GetSize()[0] - 1) / m_SubSamplingRate + 1;
+
+  // Values are first gathered per grid line for this region only
+  LineMapType lines;
+  LineType * currentLine = ITK_NULLPTR;
+  unsigned long sampleInLine = 0UL;
+
+  SubsampledImageRegionConstIterator<TInputImage> it(inputPtr, region);
+  it.SetSubsampleFactor(m_SubSamplingRate);
+  it.GoToBegin();
+
+  SubsampledImageRegionConstIterator<MaskImageType> itMask;
+  if (maskPtr)
+    {
+    itMask = SubsampledImageRegionConstIterator<MaskImageType>(maskPtr, region);
+    itMask.SetSubsampleFactor(m_SubSamplingRate);
+    itMask.GoToBegin();
+    }
+
+  // do the work
+  while (!it.IsAtEnd())
+    {
+    if (sampleInLine == 0UL)
+      {
+      currentLine = &lines[this->ComputeLineIndex(it.GetIndex())];
+      currentLine->Values.resize(numberOfComponent);
+      }
+    ++currentLine->NumberOfVisitedSamples;
+    sampleInLine = (sampleInLine + 1) % samplesPerRegionLine;
+
+    bool masked = false;
+    if (maskPtr)
+      {
+      masked = (static_cast<double>(MaskTraitsType::GetNthComponent(0, itMask.Get())) >= m_MaskThreshold);
+      ++itMask;
+      }
+
+    if (!masked)
+      {
+      const PixelType& vectorValue = it.Get();
+      for (unsigned int j = 0; j < numberOfComponent; ++j)
+        {
+        const InternalPixelType value = vectorValue[j];
+        if (m_NoDataFlag && value == m_NoDataValue)
+          {
+          continue;
+          }
+        const double realValue = static_cast<double>(value);
+        if (vnl_math_isnan(realValue))
+          {
+          continue;
+          }
+        currentLine->Values[j].push_back(realValue);
+        }
+      }
+
+    ++it;
+    progress.CompletedPixel();
+    }
+
+  // Add the region lines to the pending ones, and insert the lines that
+  // are now complete
+  m_Mutex.Lock();
+  for (typename LineMapType::iterator lineIt = lines.begin(); lineIt != lines.end(); ++lineIt)
+    {
+    LineType & pending = m_PendingLines[lineIt->first];
+    pending.NumberOfVisitedSamples += lineIt->second.NumberOfVisitedSamples;
+    pending.Values.resize(numberOfComponent);
+    for (unsigned int j = 0; j < numberOfComponent; ++j)
+      {
+      pending.Values[j].insert(pending.Values[j].end(),
+                               lineIt->second.Values[j].begin(), lineIt->second.Values[j].end());
+      }
+    }
+  this->InsertCompleteLines();
+  m_Mutex.Unlock();
+}
+
+template<class TInputImage, class TMaskImage>
+void
+PersistentQuantilesVectorImageFilter<TInputImage, TMaskImage>
+::PrintSelf(std::ostream& os, itk::Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "Accuracy parameter: " << m_AccuracyParameter << std::endl;
+  os << indent << "Subsampling rate: " << m_SubSamplingRate << std::endl;
+  if (m_NoDataFlag)
+    {
+    os << indent << "Use NoData: true" << std::endl;
+    }
+  else
+    {
+    os << indent << "Use NoData: false" << std::endl;
+    }
+  os << indent << "NoData value: " << this->GetNoDataValue() << std::endl;
+  os << indent << "Mask threshold: " << m_MaskThreshold << std::endl;
+  for (unsigned int k = 0; k < m_Sketches.size(); ++k)
+    {
+    os << indent << "Sketch of band " << k << ": ";
+    m_Sketches[k].Print(os);
+    os << std::endl;
+    }
+}
+
+} // end namespace otb
+#endif
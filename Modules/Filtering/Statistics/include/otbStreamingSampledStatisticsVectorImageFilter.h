@@ -0,0 +1,359 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef otbStreamingSampledStatisticsVectorImageFilter_h
+#define otbStreamingSampledStatisticsVectorImageFilter_h
+
+#include "otbPersistentImageFilter.h"
+#include "otbPersistentFilterStreamingDecorator.h"
+#include "otbSampledTiledStreamingManager.h"
+#include "itkVariableLengthVector.h"
+#include "itkNumericTraits.h"
+#include <vector>
+
+namespace otb
+{
+
+/** \class PersistentSampledStatisticsVectorImageFilter
+ * \brief Estimate per-band mean and variance of an image from a sample of
+ * streamed blocks, with confidence intervals
+ *
+ * Each requested region processed by the filter is considered as one block
+ * of a cluster sample: the population, sum and sum of squares of each block
+ * are recorded separately. Synthetize() computes the ratio estimators of the
+ * mean and of the variance over all the processed blocks, along with their
+ * standard errors, estimated from the dispersion between blocks. Pixels of a
+ * same block are usually correlated, so the block is the right sampling unit
+ * to evaluate the precision of the estimates.
+ *
+ * If NumberOfTilesInPopulation is set to the total number of blocks of the
+ * image, the finite population correction is applied: the standard errors
+ * are zero when all the blocks have been processed. Otherwise, blocks are
+ * assumed to be drawn from an infinite population.
+ *
+ * As in PersistentStreamingStatisticsVectorImageFilter, pixels with a
+ * non-finite component are ignored if IgnoreInfiniteValues is On, and pixels
+ * whose components all equal UserIgnoredValue are ignored if
+ * IgnoreUserDefinedValue is On.
+ *
+ *  This filter persists its temporary data. It means that if you Update it n times on n different
+ * requested regions, the output statistics will be the statistics of the whole set of n regions.
+ *
+ * To reset the temporary data, one should call the Reset() function.
+ *
+ * To get the statistics once the regions have been processed via the pipeline, use the Synthetize() method.
+ *
+ * \sa PersistentStreamingStatisticsVectorImageFilter
+ * \sa SampledTiledStreamingManager
+ * \ingroup Streamed
+ * \ingroup Multithreaded
+ * \ingroup MathematicalStatisticsImageFilters
+ *
+ * \ingroup OTBStatistics
+ */
+template<class TInputImage>
+class ITK_EXPORT PersistentSampledStatisticsVectorImageFilter :
+  public PersistentImageFilter<TInputImage, TInputImage>
+{
+public:
+  /** Standard Self typedef */
+  typedef PersistentSampledStatisticsVectorImageFilter    Self;
+  typedef PersistentImageFilter<TInputImage, TInputImage> Superclass;
+  typedef itk::SmartPointer<Self>                         Pointer;
+  typedef itk::SmartPointer<const Self>                   ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Runtime information support. */
+  itkTypeMacro(PersistentSampledStatisticsVectorImageFilter, PersistentImageFilter);
+
+  /** Image related typedefs. */
+  typedef TInputImage                           ImageType;
+  typedef typename ImageType::Pointer           InputImagePointer;
+  typedef typename ImageType::RegionType        RegionType;
+  typedef typename ImageType::PixelType         PixelType;
+  typedef typename ImageType::InternalPixelType InternalPixelType;
+
+  itkStaticConstMacro(ImageDimension, unsigned int, TInputImage::ImageDimension);
+
+  /** Type to use for computations. */
+  typedef double                              RealType;
+  typedef itk::VariableLengthVector<RealType> RealPixelType;
+
+  /** Smart Pointer type to a DataObject. */
+  typedef typename itk::DataObject::Pointer DataObjectPointer;
+  typedef itk::ProcessObject::DataObjectPointerArraySizeType DataObjectPointerArraySizeType;
+
+  itkSetMacro(IgnoreInfiniteValues, bool);
+  itkGetMacro(IgnoreInfiniteValues, bool);
+
+  itkSetMacro(IgnoreUserDefinedValue, bool);
+  itkGetMacro(IgnoreUserDefinedValue, bool);
+
+  itkSetMacro(UserIgnoredValue, InternalPixelType);
+  itkGetMacro(UserIgnoredValue, InternalPixelType);
+
+  /** Total number of blocks the processed blocks are drawn from (0 if
+   * unknown). Used for the finite population correction. */
+  itkSetMacro(NumberOfTilesInPopulation, unsigned long);
+  itkGetMacro(NumberOfTilesInPopulation, unsigned long);
+
+  /** Confidence level of the intervals (default is 0.95) */
+  itkSetClampMacro(ConfidenceLevel, double, 0.0, 0.9999);
+  itkGetMacro(ConfidenceLevel, double);
+
+  /** Estimated mean of each band */
+  itkGetConstReferenceMacro(Mean, RealPixelType);
+
+  /** Estimated (unbiased) variance of each band */
+  itkGetConstReferenceMacro(Variance, RealPixelType);
+
+  /** Standard error of the mean of each band */
+  itkGetConstReferenceMacro(MeanStandardError, RealPixelType);
+
+  /** Standard error of the variance of each band */
+  itkGetConstReferenceMacro(VarianceStandardError, RealPixelType);
+
+  /** Half width of the confidence interval of the mean of each band */
+  itkGetConstReferenceMacro(MeanHalfWidth, RealPixelType);
+
+  /** Half width of the confidence interval of the standard deviation of
+   * each band */
+  itkGetConstReferenceMacro(StandardDeviationHalfWidth, RealPixelType);
+
+  /** Number of relevant pixels in the processed blocks */
+  itkGetMacro(NbRelevantPixels, RealType);
+
+  /** Estimated number of relevant pixels in the whole population of
+   * blocks (equal to NbRelevantPixels if NumberOfTilesInPopulation is 0) */
+  itkGetMacro(EstimatedNbRelevantPixels, RealType);
+
+  /** Number of blocks processed since the last Reset() */
+  unsigned long GetNumberOfSampledTiles() const
+  {
+    return static_cast<unsigned long>(m_TileCounts.size());
+  }
+
+  /** Make a DataObject of the correct type to be used as the specified
+   * output.
+   */
+  DataObjectPointer MakeOutput(DataObjectPointerArraySizeType idx) ITK_OVERRIDE;
+  using Superclass::MakeOutput;
+
+  /** Pass the input through unmodified. Do this by Grafting in the
+   *  AllocateOutputs method.
+   */
+  void AllocateOutputs() ITK_OVERRIDE;
+  void GenerateOutputInformation() ITK_OVERRIDE;
+  void Synthetize(void) ITK_OVERRIDE;
+  void Reset(void) ITK_OVERRIDE;
+
+protected:
+  PersistentSampledStatisticsVectorImageFilter();
+  ~PersistentSampledStatisticsVectorImageFilter() ITK_OVERRIDE {}
+  void PrintSelf(std::ostream& os, itk::Indent indent) const ITK_OVERRIDE;
+
+  /** Clear the thread accumulators before processing a block */
+  void BeforeThreadedGenerateData() ITK_OVERRIDE;
+
+  /** Multi-thread version GenerateData. */
+  void ThreadedGenerateData(const RegionType& outputRegionForThread, itk::ThreadIdType threadId) ITK_OVERRIDE;
+
+  /** Record the statistics of the processed block */
+  void AfterThreadedGenerateData() ITK_OVERRIDE;
+
+private:
+  PersistentSampledStatisticsVectorImageFilter(const Self &); //purposely not implemented
+  void operator =(const Self&); //purposely not implemented
+
+  bool              m_IgnoreInfiniteValues;
+  bool              m_IgnoreUserDefinedValue;
+  InternalPixelType m_UserIgnoredValue;
+  unsigned long     m_NumberOfTilesInPopulation;
+  double            m_ConfidenceLevel;
+
+  /** Thread accumulators of the block being processed */
+  std::vector<RealType>      m_ThreadCounts;
+  std::vector<RealPixelType> m_ThreadSums;
+  std::vector<RealPixelType> m_ThreadSquaredSums;
+
+  /** Statistics of each processed block */
+  std::vector<RealType>      m_TileCounts;
+  std::vector<RealPixelType> m_TileSums;
+  std::vector<RealPixelType> m_TileSquaredSums;
+
+  /** Results */
+  RealPixelType m_Mean;
+  RealPixelType m_Variance;
+  RealPixelType m_MeanStandardError;
+  RealPixelType m_VarianceStandardError;
+  RealPixelType m_MeanHalfWidth;
+  RealPixelType m_StandardDeviationHalfWidth;
+  RealType      m_NbRelevantPixels;
+  RealType      m_EstimatedNbRelevantPixels;
+
+}; // end of class PersistentSampledStatisticsVectorImageFilter
+
+/**===========================================================================*/
+
+/** \class StreamingSampledStatisticsVectorImageFilter
+ * \brief This class streams a sample of blocks of the input image through
+ * the PersistentSampledStatisticsVectorImageFilter.
+ *
+ * The image is divided in square tiles of dimension TileDimension and only
+ * a spatially stratified random fraction SamplingRate of these tiles is read
+ * (see SampledTiledStreamingManager).
+ *
+ * If TargetError is strictly positive, the sample is then extended until,
+ * for every band, the half width of the confidence interval of the mean is
+ * lower than TargetError times the standard deviation of the band, or
+ * until all tiles have been read. The size of each extension is predicted
+ * from the current standard errors, and the tiles already read are never
+ * read again.
+ *
+ * \sa PersistentSampledStatisticsVectorImageFilter
+ * \sa SampledTiledStreamingManager
+ * \sa PersistentFilterStreamingDecorator
+ * \ingroup Streamed
+ * \ingroup Multithreaded
+ * \ingroup MathematicalStatisticsImageFilters
+ *
+ * \ingroup OTBStatistics
+ */
+template<class TInputImage>
+class ITK_EXPORT StreamingSampledStatisticsVectorImageFilter :
+  public PersistentFilterStreamingDecorator<PersistentSampledStatisticsVectorImageFilter<TInputImage> >
+{
+public:
+  /** Standard Self typedef */
+  typedef StreamingSampledStatisticsVectorImageFilter Self;
+  typedef PersistentFilterStreamingDecorator
+  <PersistentSampledStatisticsVectorImageFilter<TInputImage> > Superclass;
+  typedef itk::SmartPointer<Self>       Pointer;
+  typedef itk::SmartPointer<const Self> ConstPointer;
+
+  /** Type macro */
+  itkNewMacro(Self);
+
+  /** Creation through object factory macro */
+  itkTypeMacro(StreamingSampledStatisticsVectorImageFilter, PersistentFilterStreamingDecorator);
+
+  typedef TInputImage                                  InputImageType;
+  typedef typename Superclass::FilterType              StatFilterType;
+  typedef typename StatFilterType::RealType            RealType;
+  typedef typename StatFilterType::RealPixelType       RealPixelType;
+  typedef typename StatFilterType::InternalPixelType   InternalPixelType;
+  typedef SampledTiledStreamingManager<TInputImage>    StreamingManagerType;
+
+  using Superclass::SetInput;
+  void SetInput(InputImageType * input)
+  {
+    this->GetFilter()->SetInput(input);
+  }
+  const InputImageType * GetInput()
+  {
+    return this->GetFilter()->GetInput();
+  }
+
+  /** Dimension of the sampled tiles */
+  itkSetMacro(TileDimension, unsigned int);
+  itkGetMacro(TileDimension, unsigned int);
+
+  /** Seed of the tile sampling */
+  itkSetMacro(Seed, unsigned int);
+  itkGetMacro(Seed, unsigned int);
+
+  /** Fraction of the tiles read in the first pass (default is 0.05) */
+  itkSetClampMacro(SamplingRate, double, 0.0, 1.0);
+  itkGetMacro(SamplingRate, double);
+
+  /** Target half width of the confidence interval of the means, relative to
+   * the standard deviations (0 to disable) */
+  itkSetMacro(TargetError, double);
+  itkGetMacro(TargetError, double);
+
+  /** Return the estimated means */
+  const RealPixelType & GetMean() const
+  {
+    return this->GetFilter()->GetMean();
+  }
+
+  /** Return the estimated variances */
+  const RealPixelType & GetVariance() const
+  {
+    return this->GetFilter()->GetVariance();
+  }
+
+  /** Return the half widths of the confidence intervals of the means */
+  const RealPixelType & GetMeanHalfWidth() const
+  {
+    return this->GetFilter()->GetMeanHalfWidth();
+  }
+
+  /** Return the half widths of the confidence intervals of the standard
+   * deviations */
+  const RealPixelType & GetStandardDeviationHalfWidth() const
+  {
+    return this->GetFilter()->GetStandardDeviationHalfWidth();
+  }
+
+  /** Return the number of tiles in the image */
+  unsigned long GetNumberOfTiles() const
+  {
+    return this->GetFilter()->GetNumberOfTilesInPopulation();
+  }
+
+  /** Return the number of tiles read */
+  unsigned long GetNumberOfSampledTiles() const
+  {
+    return this->GetFilter()->GetNumberOfSampledTiles();
+  }
+
+protected:
+  /** Constructor */
+  StreamingSampledStatisticsVectorImageFilter();
+  /** Destructor */
+  ~StreamingSampledStatisticsVectorImageFilter() ITK_OVERRIDE {}
+
+  void GenerateData(void) ITK_OVERRIDE;
+
+private:
+  StreamingSampledStatisticsVectorImageFilter(const Self &); //purposely not implemented
+  void operator =(const Self&); //purposely not implemented
+
+  /** Largest ratio between the half width of the confidence interval of
+   * the mean and the standard deviation, over all bands */
+  double ComputeRelativeError() const;
+
+  typename StreamingManagerType::Pointer m_StreamingManager;
+  unsigned int m_TileDimension;
+  unsigned int m_Seed;
+  double       m_SamplingRate;
+  double       m_TargetError;
+};
+
+} // end namespace otb
+
+#ifndef OTB_MANUAL_INSTANTIATION
+#include "otbStreamingSampledStatisticsVectorImageFilter.txx"
+#endif
+
+#endif
@@ -0,0 +1,403 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef otbStreamingSampledStatisticsVectorImageFilter_txx
+#define otbStreamingSampledStatisticsVectorImageFilter_txx
+#include "otbStreamingSampledStatisticsVectorImageFilter.h"
+
+#include "itkImageRegionConstIterator.h"
+#include "itkProgressReporter.h"
+#include "itkGaussianDistribution.h"
+#include "vnl/vnl_math.h"
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+namespace otb
+{
+
+template<class TInputImage>
+PersistentSampledStatisticsVectorImageFilter<TInputImage>
+::PersistentSampledStatisticsVectorImageFilter()
+ : m_IgnoreInfiniteValues(true),
+   m_IgnoreUserDefinedValue(false),
+   m_UserIgnoredValue(itk::NumericTraits<InternalPixelType>::Zero),
+   m_NumberOfTilesInPopulation(0),
+   m_ConfidenceLevel(0.95),
+   m_NbRelevantPixels(0.0),
+   m_EstimatedNbRelevantPixels(0.0)
+{
+  // first output is a copy of the image, DataObject created by
+  // superclass
+  this->SetNumberOfRequiredInputs(1);
+}
+
+template<class TInputImage>
+itk::DataObject::Pointer
+PersistentSampledStatisticsVectorImageFilter<TInputImage>
+::MakeOutput(DataObjectPointerArraySizeType itkNotUsed(output))
+{
+  return static_cast<itk::DataObject*>(TInputImage::New().GetPointer());
+}
+
+template<class TInputImage>
+void
+PersistentSampledStatisticsVectorImageFilter<TInputImage>
+::GenerateOutputInformation()
+{
+  Superclass::GenerateOutputInformation();
+  if (this->GetInput())
+    {
+    this->GetOutput()->CopyInformation(this->GetInput());
+    this->GetOutput()->SetLargestPossibleRegion(this->GetInput()->GetLargestPossibleRegion());
+
+    if (this->GetOutput()->GetRequestedRegion().GetNumberOfPixels() == 0)
+      {
+      this->GetOutput()->SetRequestedRegion(this->GetOutput()->GetLargestPossibleRegion());
+      }
+    }
+}
+
+template<class TInputImage>
+void
+PersistentSampledStatisticsVectorImageFilter<TInputImage>
+::AllocateOutputs()
+{
+  // This is commented to prevent the streaming of the whole image for the first stream strip
+  // It shall not cause any problem because the output image of this filter is not intended to be used.
+  //InputImagePointer image = const_cast< TInputImage * >( this->GetInput() );
+  //this->GraftOutput( image );
+  // Nothing that needs to be allocated for the remaining outputs
+}
+
+template<class TInputImage>
+void
+PersistentSampledStatisticsVectorImageFilter<TInputImage>
+::Reset()
+{
+  TInputImage * inputPtr = const_cast<TInputImage *>(this->GetInput());
+  inputPtr->UpdateOutputInformation();
+
+  const unsigned int numberOfThreads = this->GetNumberOfThreads();
+  const unsigned int numberOfComponent = inputPtr->GetNumberOfComponentsPerPixel();
+
+  RealPixelType zeroRealPixel(numberOfComponent);
+  zeroRealPixel.Fill(itk::NumericTraits<RealType>::ZeroValue());
+
+  m_ThreadCounts.assign(numberOfThreads, 0.0);
+  m_ThreadSums.assign(numberOfThreads, zeroRealPixel);
+  m_ThreadSquaredSums.assign(numberOfThreads, zeroRealPixel);
+
+  m_TileCounts.clear();
+  m_TileSums.clear();
+  m_TileSquaredSums.clear();
+
+  m_Mean = zeroRealPixel;
+  m_Variance = zeroRealPixel;
+  m_MeanStandardError = zeroRealPixel;
+  m_VarianceStandardError = zeroRealPixel;
+  m_MeanHalfWidth = zeroRealPixel;
+  m_StandardDeviationHalfWidth = zeroRealPixel;
+  m_NbRelevantPixels = 0.0;
+  m_EstimatedNbRelevantPixels = 0.0;
+}
+
+template<class TInputImage>
+void
+PersistentSampledStatisticsVectorImageFilter<TInputImage>
+::BeforeThreadedGenerateData()
+{
+  for (unsigned int i = 0; i < m_ThreadCounts.size(); ++i)
+    {
+    m_ThreadCounts[i] = 0.0;
+    m_ThreadSums[i].Fill(itk::NumericTraits<RealType>::ZeroValue());
+    m_ThreadSquaredSums[i].Fill(itk::NumericTraits<RealType>::ZeroValue());
+    }
+}
+
+template<class TInputImage>
+void
+PersistentSampledStatisticsVectorImageFilter<TInputImage>
+::AfterThreadedGenerateData()
+{
+  if (m_ThreadCounts.empty())
+    {
+    return;
+    }
+
+  RealType      count = m_ThreadCounts[0];
+  RealPixelType sums = m_ThreadSums[0];
+  RealPixelType squaredSums = m_ThreadSquaredSums[0];
+  for (unsigned int i = 1; i < m_ThreadCounts.size(); ++i)
+    {
+    count += m_ThreadCounts[i];
+    sums += m_ThreadSums[i];
+    squaredSums += m_ThreadSquaredSums[i];
+    }
+
+  // blocks without relevant pixels are kept: they are part of the sample
+  m_TileCounts.push_back(count);
+  m_TileSums.push_back(sums);
+  m_TileSquaredSums.push_back(squaredSums);
+}
+
+template<class TInputImage>
+void
+PersistentSampledStatisticsVectorImageFilter<TInputImage>
+::ThreadedGenerateData(const RegionType& outputRegionForThread, itk::ThreadIdType threadId)
+{
+  // Support progress methods/callbacks
+  itk::ProgressReporter progress(this, threadId, outputRegionForThread.GetNumberOfPixels());
+
+  const TInputImage * inputPtr = this->GetInput();
+
+  RealType&      count = m_ThreadCounts[threadId];
+  RealPixelType& sums = m_ThreadSums[threadId];
+  RealPixelType& squaredSums = m_ThreadSquaredSums[threadId];
+  const unsigned int numberOfComponent = sums.GetSize();
+
+  itk::ImageRegionConstIterator<TInputImage> it(inputPtr, outputRegionForThread);
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it, progress.CompletedPixel())
+    {
+    const PixelType& vectorValue = it.Get();
+
+    float finiteProbe = 0.;
+    bool userProbe = m_IgnoreUserDefinedValue;
+    for (unsigned int j = 0; j < numberOfComponent; ++j)
+      {
+      finiteProbe += (float)(vectorValue[j]);
+      userProbe = userProbe && (vectorValue[j] == m_UserIgnoredValue);
+      }
+
+    if ((m_IgnoreInfiniteValues && !(vnl_math_isfinite(finiteProbe))) || userProbe)
+      {
+      continue;
+      }
+
+    count += 1.0;
+    for (unsigned int j = 0; j < numberOfComponent; ++j)
+      {
+      const RealType value = static_cast<RealType>(vectorValue[j]);
+      sums[j] += value;
+      squaredSums[j] += value * value;
+      }
+    }
+}
+
+template<class TInputImage>
+void
+PersistentSampledStatisticsVectorImageFilter<TInputImage>
+::Synthetize()
+{
+  const unsigned int numberOfComponent = m_Mean.GetSize();
+  const unsigned long nbTiles = static_cast<unsigned long>(m_TileCounts.size());
+
+  RealType      count = 0.0;
+  RealPixelType sums(numberOfComponent);
+  RealPixelType squaredSums(numberOfComponent);
+  sums.Fill(itk::NumericTraits<RealType>::ZeroValue());
+  squaredSums.Fill(itk::NumericTraits<RealType>::ZeroValue());
+  for (unsigned long i = 0; i < nbTiles; ++i)
+    {
+    count += m_TileCounts[i];
+    sums += m_TileSums[i];
+    squaredSums += m_TileSquaredSums[i];
+    }
+
+  m_NbRelevantPixels = count;
+  if (count == 0.0)
+    {
+    itkExceptionMacro(<< "Statistics cannot be calculated with zero relevant pixels.");
+    }
+
+  // Sampling fraction of the blocks, for the finite population correction
+  double samplingFraction = 0.0;
+  m_EstimatedNbRelevantPixels = count;
+  if (m_NumberOfTilesInPopulation > 0)
+    {
+    samplingFraction = std::min(1.0, static_cast<double>(nbTiles) / static_cast<double>(m_NumberOfTilesInPopulation));
+    m_EstimatedNbRelevantPixels = count / samplingFraction;
+    }
+
+  const double meanTileCount = count / static_cast<double>(nbTiles);
+  const double z = itk::Statistics::GaussianDistribution::InverseCDF(0.5 + 0.5 * m_ConfidenceLevel);
+
+  for (unsigned int j = 0; j < numberOfComponent; ++j)
+    {
+    const RealType mean = sums[j] / count;
+    const RealType secondMoment = squaredSums[j] / count;
+    RealType variance = std::max(0.0, secondMoment - mean * mean);
+    if (count > 1.0)
+      {
+      variance *= count / (count - 1.0);
+      }
+    m_Mean[j] = mean;
+    m_Variance[j] = variance;
+
+    // Linearized residuals of the ratio estimators of the mean and of the
+    // variance, block by block
+    RealType meanResidualSum = 0.0;
+    RealType varianceResidualSum = 0.0;
+    for (unsigned long i = 0; i < nbTiles; ++i)
+      {
+      const RealType meanResidual = m_TileSums[i][j] - mean * m_TileCounts[i];
+      const RealType varianceResidual = (m_TileSquaredSums[i][j] - secondMoment * m_TileCounts[i])
+        - 2.0 * mean * meanResidual;
+      meanResidualSum += meanResidual * meanResidual;
+      varianceResidualSum += varianceResidual * varianceResidual;
+      }
+
+    if (samplingFraction >= 1.0)
+      {
+      m_MeanStandardError[j] = 0.0;
+      m_VarianceStandardError[j] = 0.0;
+      }
+    else if (nbTiles < 2)
+      {
+      // the dispersion between blocks can't be estimated
+      m_MeanStandardError[j] = std::numeric_limits<RealType>::infinity();
+      m_VarianceStandardError[j] = std::numeric_limits<RealType>::infinity();
+      }
+    else
+      {
+      const double factor = (1.0 - samplingFraction)
+        / (static_cast<double>(nbTiles) * (static_cast<double>(nbTiles) - 1.0) * meanTileCount * meanTileCount);
+      m_MeanStandardError[j] = std::sqrt(factor * meanResidualSum);
+      m_VarianceStandardError[j] = std::sqrt(factor * varianceResidualSum);
+      }
+
+    m_MeanHalfWidth[j] = z * m_MeanStandardError[j];
+    // delta method: the standard error of the standard deviation is the
+    // standard error of the variance divided by twice the standard deviation
+    m_StandardDeviationHalfWidth[j] = 0.0;
+    if (variance > 0.0)
+      {
+      m_StandardDeviationHalfWidth[j] = z * m_VarianceStandardError[j] / (2.0 * std::sqrt(variance));
+      }
+    }
+}
+
+template<class TInputImage>
+void
+PersistentSampledStatisticsVectorImageFilter<TInputImage>
+::PrintSelf(std::ostream& os, itk::Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "Number of sampled tiles: " << this->GetNumberOfSampledTiles()
+     << " / " << m_NumberOfTilesInPopulation << std::endl;
+  os << indent << "Confidence level: " << m_ConfidenceLevel << std::endl;
+  os << indent << "Relevant pixels: " << m_NbRelevantPixels
+     << " (estimated population: " << m_EstimatedNbRelevantPixels << ")" << std::endl;
+  os << indent << "Mean: " << m_Mean << std::endl;
+  os << indent << "Mean half width: " << m_MeanHalfWidth << std::endl;
+  os << indent << "Variance: " << m_Variance << std::endl;
+  os << indent << "Standard deviation half width: " << m_StandardDeviationHalfWidth << std::endl;
+}
+
+/**===========================================================================*/
+
+template<class TInputImage>
+StreamingSampledStatisticsVectorImageFilter<TInputImage>
+::StreamingSampledStatisticsVectorImageFilter()
+ : m_TileDimension(256),
+   m_Seed(0),
+   m_SamplingRate(0.05),
+   m_TargetError(0.0)
+{
+  m_StreamingManager = StreamingManagerType::New();
+}
+
+template<class TInputImage>
+double
+StreamingSampledStatisticsVectorImageFilter<TInputImage>
+::ComputeRelativeError() const
+{
+  const RealPixelType & halfWidth = this->GetFilter()->GetMeanHalfWidth();
+  const RealPixelType & variance = this->GetFilter()->GetVariance();
+  double error = 0.0;
+  for (unsigned int j = 0; j < halfWidth.GetSize(); ++j)
+    {
+    if (variance[j] > 0.0)
+      {
+      error = std::max(error, halfWidth[j] / std::sqrt(variance[j]));
+      }
+    }
+  return error;
+}
+
+template<class TInputImage>
+void
+StreamingSampledStatisticsVectorImageFilter<TInputImage>
+::GenerateData(void)
+{
+  StatFilterType * filter = this->GetFilter();
+  filter->Reset();
+
+  // Compute the tiling to know the size of the population
+  filter->UpdateOutputInformation();
+  m_StreamingManager->SetTileDimension(m_TileDimension);
+  m_StreamingManager->SetSeed(m_Seed);
+  m_StreamingManager->PrepareStreaming(filter->GetOutput(), filter->GetOutput()->GetLargestPossibleRegion());
+  const unsigned int nbTiles = m_StreamingManager->GetNumberOfTiles();
+  filter->SetNumberOfTilesInPopulation(nbTiles);
+
+  // At least two tiles are needed to estimate the precision
+  unsigned int nbSampledTiles = static_cast<unsigned int>(std::ceil(m_SamplingRate * nbTiles));
+  nbSampledTiles = std::min(nbTiles, std::max(2U, nbSampledTiles));
+
+  this->GetStreamer()->SetInput(filter->GetOutput());
+  this->GetStreamer()->SetStreamingManager(m_StreamingManager);
+
+  unsigned int firstTile = 0;
+  while (nbSampledTiles > 0)
+    {
+    m_StreamingManager->SetFirstSampledTile(firstTile);
+    m_StreamingManager->SetNumberOfSampledTiles(nbSampledTiles);
+    this->GetStreamer()->Update();
+    filter->Synthetize();
+    firstTile += nbSampledTiles;
+
+    if (m_TargetError <= 0.0 || firstTile >= nbTiles)
+      {
+      break;
+      }
+
+    const double error = this->ComputeRelativeError();
+    if (error <= m_TargetError)
+      {
+      break;
+      }
+
+    // The standard errors decrease as the square root of the number of
+    // tiles: predict the sample size needed, with a 10% margin
+    unsigned int needed = 2 * firstTile;
+    if (error < std::numeric_limits<double>::max())
+      {
+      const double ratio = error / m_TargetError;
+      needed = static_cast<unsigned int>(std::min(static_cast<double>(nbTiles),
+                                                  std::ceil(1.1 * firstTile * ratio * ratio)));
+      }
+    nbSampledTiles = std::min(nbTiles - firstTile, std::max(1U, needed - std::min(needed, firstTile)));
+    }
+}
+
+} // end namespace otb
+#endif
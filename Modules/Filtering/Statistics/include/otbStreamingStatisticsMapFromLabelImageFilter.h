@@ -27,6 +27,7 @@
 #include "itkArray.h"
 #include "itkSimpleDataObjectDecorator.h"
 #include "otbPersistentFilterStreamingDecorator.h"
+#include "otbLabelStatisticsAccumulator.h"
 
 
 namespace otb
@@ -42,6 +43,19 @@ namespace otb
  *
  * To get the statistics once the regions have been processed via the pipeline, use the Synthetize() method.
  *
+ * Each thread accumulates its statistics in a flat LabelStatisticsAccumulator
+ * (open-addressing hash table, plus a dense area if a label range is
+ * known). Synthetize() merges the thread accumulators in parallel, each
+ * thread owning a partition of the labels, and gathers the result as a
+ * columnar table: see GetLabels(), GetLabelPopulations() and
+ * GetMeanColumn(). The label order in this table is not sorted.
+ *
+ * A dense range can be set with SetDenseLabelRange() when labels are known
+ * to be compact (for instance labels 1 to N of a segmentation). Keep in
+ * mind that each thread allocates its own dense area. Otherwise, threads
+ * only use hash tables, and the merge uses a dense layout if the observed
+ * range of integer labels is small.
+ *
  * \todo Implement other statistics (min, max, stddev...)
  *
  * \sa StreamingStatisticsMapFromLabelImageFilter
@@ -79,6 +93,13 @@ public:
   typedef std::map<LabelPixelType, itk::VariableLengthVector<double> >  MeanValueMapType;
   typedef std::map<LabelPixelType, double>                              LabelPopulationMapType;
 
+  /** Columnar output typedefs */
+  typedef std::vector<LabelPixelType>                                   LabelVectorType;
+  typedef std::vector<double>                                           StatisticColumnType;
+
+  /** Per-thread accumulator typedef */
+  typedef LabelStatisticsAccumulator<LabelPixelType>                    AccumulatorType;
+
   itkStaticConstMacro(InputImageDimension, unsigned int,
                       TInputVectorImage::ImageDimension);
 
@@ -108,6 +129,41 @@ public:
   /** Return the computed number of labeled pixels for each label in the input label image */
   LabelPopulationMapType GetLabelPopulationMap() const;
 
+  /** Return the number of labels found in the label image */
+  size_t GetNumberOfLabels() const
+  {
+    return m_Labels.size();
+  }
+
+  /** Return the label column of the statistics table */
+  const LabelVectorType & GetLabels() const
+  {
+    return m_Labels;
+  }
+
+  /** Return the population column of the statistics table */
+  const StatisticColumnType & GetLabelPopulations() const
+  {
+    return m_LabelPopulations;
+  }
+
+  /** Return the mean column of a given band in the statistics table */
+  const StatisticColumnType & GetMeanColumn(unsigned int band) const;
+
+  /** Set a range of labels stored in dense arrays */
+  void SetDenseLabelRange(LabelPixelType minLabel, LabelPixelType maxLabel)
+  {
+    m_MinimumDenseLabel = minLabel;
+    m_MaximumDenseLabel = maxLabel;
+    m_UseDenseLabelRange = true;
+    this->Modified();
+  }
+
+  /** Enable/disable the use of the dense label range */
+  itkSetMacro(UseDenseLabelRange, bool);
+  itkGetMacro(UseDenseLabelRange, bool);
+  itkBooleanMacro(UseDenseLabelRange);
+
   /** Make a DataObject of the correct type to be used as the specified
    * output. */
   DataObjectPointer MakeOutput(DataObjectPointerArraySizeType idx) ITK_OVERRIDE;
@@ -133,15 +189,47 @@ protected:
   ~PersistentStreamingStatisticsMapFromLabelImageFilter() ITK_OVERRIDE {}
   void PrintSelf(std::ostream& os, itk::Indent indent) const ITK_OVERRIDE;
 
-  /** GenerateData. */
-  void  GenerateData() ITK_OVERRIDE;
+  /** Multi-thread version GenerateData. */
+  void  ThreadedGenerateData(const InputImageRegionType& outputRegionForThread, itk::ThreadIdType threadId) ITK_OVERRIDE;
+
+  /** Sort the hash slots of a thread accumulator by partition */
+  void DispatchThreadAccumulator(unsigned int threadIndex);
+
+  /** Choose the layout of the merged accumulators (dense range or hash) */
+  void InitializeMergeLayout();
+
+  /** Merge one partition of labels from all thread accumulators */
+  void MergePartition(unsigned int partition);
+
+  /** Static functions used as "callbacks" for the MultiThreader */
+  static ITK_THREAD_RETURN_TYPE DispatchThreaderCallback(void *arg);
+  static ITK_THREAD_RETURN_TYPE MergeThreaderCallback(void *arg);
+
+  /** Internal structure used for passing image data into the threading library */
+  struct SynthetizeThreadStruct
+  {
+    Pointer Filter;
+  };
 
 private:
   PersistentStreamingStatisticsMapFromLabelImageFilter(const Self &); //purposely not implemented
   void operator =(const Self&); //purposely not implemented
 
-  MeanValueMapType                       m_RadiometricValueAccumulator;
-  LabelPopulationMapType                 m_LabelPopulation;
+  typedef std::vector<size_t>                   SlotListType;
+  typedef std::vector<SlotListType>             SlotListArrayType;
+
+  std::vector<AccumulatorType>           m_ThreadAccumulators;
+  std::vector<AccumulatorType>           m_PartitionAccumulators;
+  std::vector<SlotListArrayType>         m_PartitionSlots;
+  AccumulatorType                        m_MergeLayout;
+
+  LabelVectorType                        m_Labels;
+  StatisticColumnType                    m_LabelPopulations;
+  std::vector<StatisticColumnType>       m_MeanColumns;
+
+  bool                                   m_UseDenseLabelRange;
+  LabelPixelType                         m_MinimumDenseLabel;
+  LabelPixelType                         m_MaximumDenseLabel;
 }; // end of class PersistentStreamingStatisticsMapFromLabelImageFilter
 
 
@@ -177,7 +265,6 @@ private:
  * \endcode
  *
  * \todo Implement other statistics (min, max, stddev...)
- * \todo Reimplement as a multi-threaded filter
  *
  * \sa PersistentStatisticsImageFilter
  * \sa PersistentImageFilter
@@ -216,6 +303,9 @@ public:
   typedef typename Superclass::FilterType::MeanValueMapObjectType    MeanValueMapObjectType;
 
   typedef typename Superclass::FilterType::LabelPopulationMapType    LabelPopulationMapType;
+  typedef typename Superclass::FilterType::LabelVectorType           LabelVectorType;
+  typedef typename Superclass::FilterType::StatisticColumnType       StatisticColumnType;
+  typedef typename LabelImageType::PixelType                         LabelPixelType;
 
   /** Set input multispectral image */
   using Superclass::SetInput;
@@ -254,6 +344,36 @@ public:
     return this->GetFilter()->GetLabelPopulationMap();
   }
 
+  /** Return the number of labels */
+  size_t GetNumberOfLabels() const
+  {
+    return this->GetFilter()->GetNumberOfLabels();
+  }
+
+  /** Return the label column of the statistics table */
+  const LabelVectorType & GetLabels() const
+  {
+    return this->GetFilter()->GetLabels();
+  }
+
+  /** Return the population column of the statistics table */
+  const StatisticColumnType & GetLabelPopulations() const
+  {
+    return this->GetFilter()->GetLabelPopulations();
+  }
+
+  /** Return the mean column of a given band */
+  const StatisticColumnType & GetMeanColumn(unsigned int band) const
+  {
+    return this->GetFilter()->GetMeanColumn(band);
+  }
+
+  /** Set a range of labels stored in dense arrays */
+  void SetDenseLabelRange(LabelPixelType minLabel, LabelPixelType maxLabel)
+  {
+    this->GetFilter()->SetDenseLabelRange(minLabel, maxLabel);
+  }
+
 protected:
   /** Constructor */
   StreamingStatisticsMapFromLabelImageFilter() {}
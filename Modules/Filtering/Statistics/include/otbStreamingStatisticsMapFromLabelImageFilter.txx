@@ -26,7 +26,10 @@
 #include "itkInputDataObjectIterator.h"
 #include "itkImageRegionIterator.h"
 #include "itkProgressReporter.h"
+#include "itkDefaultConvertPixelTraits.h"
+#include "itkNumericTraits.h"
 #include "otbMacro.h"
+#include <algorithm>
 
 
 namespace otb
@@ -35,6 +38,9 @@ namespace otb
 template<class TInputVectorImage, class TLabelImage>
 PersistentStreamingStatisticsMapFromLabelImageFilter<TInputVectorImage, TLabelImage>
 ::PersistentStreamingStatisticsMapFromLabelImageFilter()
+  : m_UseDenseLabelRange(false),
+    m_MinimumDenseLabel(itk::NumericTraits<LabelPixelType>::Zero),
+    m_MaximumDenseLabel(itk::NumericTraits<LabelPixelType>::Zero)
 {
   // first output is a copy of the image, DataObject created by
   // superclass
@@ -94,7 +100,18 @@ typename PersistentStreamingStatisticsMapFromLabelImageFilter<TInputVectorImage,
 PersistentStreamingStatisticsMapFromLabelImageFilter<TInputVectorImage, TLabelImage>
 ::GetMeanValueMap() const
 {
-  return m_RadiometricValueAccumulator;
+  MeanValueMapType meanValueMap;
+  const unsigned int nbComp = static_cast<unsigned int>(m_MeanColumns.size());
+  itk::VariableLengthVector<double> mean(nbComp);
+  for (size_t i = 0; i < m_Labels.size(); ++i)
+    {
+    for (unsigned int k = 0; k < nbComp; ++k)
+      {
+      mean[k] = m_MeanColumns[k][i];
+      }
+    meanValueMap[m_Labels[i]] = mean;
+    }
+  return meanValueMap;
 }
 
 template<class TInputVectorImage, class TLabelImage>
@@ -102,7 +119,24 @@ typename PersistentStreamingStatisticsMapFromLabelImageFilter<TInputVectorImage,
 PersistentStreamingStatisticsMapFromLabelImageFilter<TInputVectorImage, TLabelImage>
 ::GetLabelPopulationMap() const
 {
-  return m_LabelPopulation;
+  LabelPopulationMapType labelPopulationMap;
+  for (size_t i = 0; i < m_Labels.size(); ++i)
+    {
+    labelPopulationMap[m_Labels[i]] = m_LabelPopulations[i];
+    }
+  return labelPopulationMap;
+}
+
+template<class TInputVectorImage, class TLabelImage>
+const typename PersistentStreamingStatisticsMapFromLabelImageFilter<TInputVectorImage, TLabelImage>::StatisticColumnType &
+PersistentStreamingStatisticsMapFromLabelImageFilter<TInputVectorImage, TLabelImage>
+::GetMeanColumn(unsigned int band) const
+{
+  if (band >= m_MeanColumns.size())
+    {
+    itkExceptionMacro(<< "No mean available for band " << band);
+    }
+  return m_MeanColumns[band];
 }
 
 template<class TInputVectorImage, class TLabelImage>
@@ -141,11 +175,235 @@ void
 PersistentStreamingStatisticsMapFromLabelImageFilter<TInputVectorImage, TLabelImage>
 ::Synthetize()
 {
-   typename MeanValueMapType::iterator it;
-   for(it = m_RadiometricValueAccumulator.begin(); it != m_RadiometricValueAccumulator.end(); it++)
-   {
-      it->second = it->second / m_LabelPopulation[it->first];
-   }
+  const unsigned int numberOfPartitions = std::max(1, static_cast<int>(this->GetNumberOfThreads()));
+
+  this->InitializeMergeLayout();
+
+  m_PartitionSlots.assign(m_ThreadAccumulators.size(), SlotListArrayType(numberOfPartitions));
+  m_PartitionAccumulators.assign(numberOfPartitions, AccumulatorType());
+
+  SynthetizeThreadStruct str;
+  str.Filter = this;
+
+  // Sort the hash slots of each thread accumulator by partition, then merge
+  // each partition independently. A local threader is used so that the
+  // number of threads of the filter is left untouched.
+  itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+  threader->SetNumberOfThreads(numberOfPartitions);
+  threader->SetSingleMethod(this->DispatchThreaderCallback, &str);
+  threader->SingleMethodExecute();
+
+  threader->SetSingleMethod(this->MergeThreaderCallback, &str);
+  threader->SingleMethodExecute();
+
+  m_PartitionSlots.clear();
+  m_MergeLayout = AccumulatorType();
+
+  // Gather the partitions in the output table
+  size_t numberOfLabels = 0;
+  for (unsigned int p = 0; p < numberOfPartitions; ++p)
+    {
+    numberOfLabels += m_PartitionAccumulators[p].GetNumberOfLabels();
+    }
+
+  const unsigned int nbComp = m_ThreadAccumulators.empty() ? 0 : m_ThreadAccumulators[0].GetNumberOfComponents();
+  m_Labels.clear();
+  m_Labels.reserve(numberOfLabels);
+  m_LabelPopulations.clear();
+  m_LabelPopulations.reserve(numberOfLabels);
+  m_MeanColumns.assign(nbComp, StatisticColumnType());
+  for (unsigned int k = 0; k < nbComp; ++k)
+    {
+    m_MeanColumns[k].reserve(numberOfLabels);
+    }
+
+  for (unsigned int p = 0; p < numberOfPartitions; ++p)
+    {
+    const AccumulatorType & accumulator = m_PartitionAccumulators[p];
+    for (size_t slot = 0; slot < accumulator.GetNumberOfSlots(); ++slot)
+      {
+      if (!accumulator.IsSlotUsed(slot))
+        {
+        continue;
+        }
+      const double count = accumulator.GetSlotCount(slot);
+      const double * sums = accumulator.GetSlotSums(slot);
+      m_Labels.push_back(accumulator.GetSlotLabel(slot));
+      m_LabelPopulations.push_back(count);
+      for (unsigned int k = 0; k < nbComp; ++k)
+        {
+        m_MeanColumns[k].push_back(sums[k] / count);
+        }
+      }
+    }
+
+  m_PartitionAccumulators.clear();
+}
+
+template<class TInputVectorImage, class TLabelImage>
+void
+PersistentStreamingStatisticsMapFromLabelImageFilter<TInputVectorImage, TLabelImage>
+::InitializeMergeLayout()
+{
+  const unsigned int nbComp = m_ThreadAccumulators.empty() ? 0 : m_ThreadAccumulators[0].GetNumberOfComponents();
+
+  if (!m_ThreadAccumulators.empty() && m_ThreadAccumulators[0].IsDense())
+    {
+    // user defined dense range, shared by all the thread accumulators
+    const AccumulatorType & reference = m_ThreadAccumulators[0];
+    m_MergeLayout.InitializeDense(nbComp, reference.GetMinimumDenseLabel(),
+                                  static_cast<LabelPixelType>(static_cast<itk::int64_t>(reference.GetMinimumDenseLabel())
+                                                              + static_cast<itk::int64_t>(reference.GetDenseSize()) - 1),
+                                  0);
+    return;
+    }
+
+  // Integer labels : use a dense layout for the merge if the observed label
+  // range is small compared to the number of labels
+  size_t numberOfLabels = 0;
+  bool hasLabels = false;
+  LabelPixelType minLabel = LabelPixelType();
+  LabelPixelType maxLabel = LabelPixelType();
+  for (unsigned int t = 0; t < m_ThreadAccumulators.size(); ++t)
+    {
+    const AccumulatorType & accumulator = m_ThreadAccumulators[t];
+    if (accumulator.GetNumberOfLabels() == 0)
+      {
+      continue;
+      }
+    if (!hasLabels || accumulator.GetMinimumLabel() < minLabel)
+      {
+      minLabel = accumulator.GetMinimumLabel();
+      }
+    if (!hasLabels || maxLabel < accumulator.GetMaximumLabel())
+      {
+      maxLabel = accumulator.GetMaximumLabel();
+      }
+    hasLabels = true;
+    numberOfLabels += accumulator.GetNumberOfLabels();
+    }
+
+  if (itk::NumericTraits<LabelPixelType>::is_integer && hasLabels)
+    {
+    const itk::uint64_t range = static_cast<itk::uint64_t>(static_cast<itk::int64_t>(maxLabel) - static_cast<itk::int64_t>(minLabel)) + 1;
+    if (range <= 2 * static_cast<itk::uint64_t>(numberOfLabels))
+      {
+      m_MergeLayout.InitializeDense(nbComp, minLabel, maxLabel, 0);
+      return;
+      }
+    }
+  m_MergeLayout.Initialize(nbComp, 0);
+}
+
+template<class TInputVectorImage, class TLabelImage>
+void
+PersistentStreamingStatisticsMapFromLabelImageFilter<TInputVectorImage, TLabelImage>
+::DispatchThreadAccumulator(unsigned int threadIndex)
+{
+  const AccumulatorType & accumulator = m_ThreadAccumulators[threadIndex];
+  SlotListArrayType & partitionSlots = m_PartitionSlots[threadIndex];
+  const unsigned int numberOfPartitions = static_cast<unsigned int>(partitionSlots.size());
+
+  // dense slots are merged by label range, only hash slots are dispatched
+  for (size_t slot = accumulator.GetDenseSize(); slot < accumulator.GetNumberOfSlots(); ++slot)
+    {
+    if (accumulator.IsSlotUsed(slot))
+      {
+      partitionSlots[m_MergeLayout.GetPartition(accumulator.GetSlotLabel(slot), numberOfPartitions)].push_back(slot);
+      }
+    }
+}
+
+template<class TInputVectorImage, class TLabelImage>
+void
+PersistentStreamingStatisticsMapFromLabelImageFilter<TInputVectorImage, TLabelImage>
+::MergePartition(unsigned int partition)
+{
+  if (m_ThreadAccumulators.empty())
+    {
+    return;
+    }
+
+  const unsigned int numberOfPartitions = static_cast<unsigned int>(m_PartitionAccumulators.size());
+  const AccumulatorType & reference = m_MergeLayout;
+  AccumulatorType & output = m_PartitionAccumulators[partition];
+
+  size_t numberOfHashSlots = 0;
+  for (unsigned int t = 0; t < m_PartitionSlots.size(); ++t)
+    {
+    numberOfHashSlots += m_PartitionSlots[t][partition].size();
+    }
+
+  size_t firstSlot = 0, endSlot = 0;
+  const bool hasDenseRange = reference.GetPartitionDenseRange(partition, numberOfPartitions, firstSlot, endSlot);
+  if (hasDenseRange)
+    {
+    const itk::int64_t minLabel = static_cast<itk::int64_t>(reference.GetMinimumDenseLabel());
+    output.InitializeDense(reference.GetNumberOfComponents(),
+                           static_cast<LabelPixelType>(minLabel + static_cast<itk::int64_t>(firstSlot)),
+                           static_cast<LabelPixelType>(minLabel + static_cast<itk::int64_t>(endSlot) - 1),
+                           numberOfHashSlots);
+    }
+  else
+    {
+    output.Initialize(reference.GetNumberOfComponents(), numberOfHashSlots);
+    }
+
+  for (unsigned int t = 0; t < m_ThreadAccumulators.size(); ++t)
+    {
+    const AccumulatorType & accumulator = m_ThreadAccumulators[t];
+    if (hasDenseRange && accumulator.IsDense())
+      {
+      for (size_t slot = firstSlot; slot < endSlot; ++slot)
+        {
+        if (accumulator.IsSlotUsed(slot))
+          {
+          output.MergeSlot(accumulator, slot);
+          }
+        }
+      }
+    const SlotListType & slots = m_PartitionSlots[t][partition];
+    for (typename SlotListType::const_iterator it = slots.begin(); it != slots.end(); ++it)
+      {
+      output.MergeSlot(accumulator, *it);
+      }
+    }
+}
+
+template<class TInputVectorImage, class TLabelImage>
+ITK_THREAD_RETURN_TYPE
+PersistentStreamingStatisticsMapFromLabelImageFilter<TInputVectorImage, TLabelImage>
+::DispatchThreaderCallback(void *arg)
+{
+  SynthetizeThreadStruct *str = (SynthetizeThreadStruct*)(((itk::MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+  const unsigned int threadId = ((itk::MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+  const unsigned int threadCount = ((itk::MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+
+  for (unsigned int t = threadId; t < str->Filter->m_ThreadAccumulators.size(); t += threadCount)
+    {
+    str->Filter->DispatchThreadAccumulator(t);
+    }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template<class TInputVectorImage, class TLabelImage>
+ITK_THREAD_RETURN_TYPE
+PersistentStreamingStatisticsMapFromLabelImageFilter<TInputVectorImage, TLabelImage>
+::MergeThreaderCallback(void *arg)
+{
+  SynthetizeThreadStruct *str = (SynthetizeThreadStruct*)(((itk::MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+  const unsigned int threadId = ((itk::MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+  const unsigned int threadCount = ((itk::MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+
+  for (unsigned int p = threadId; p < str->Filter->m_PartitionAccumulators.size(); p += threadCount)
+    {
+    str->Filter->MergePartition(p);
+    }
+
+  return ITK_THREAD_RETURN_VALUE;
 }
 
 template<class TInputVectorImage, class TLabelImage>
@@ -153,7 +411,31 @@ void
 PersistentStreamingStatisticsMapFromLabelImageFilter<TInputVectorImage, TLabelImage>
 ::Reset()
 {
-  m_RadiometricValueAccumulator.clear();
+  m_ThreadAccumulators.clear();
+  m_PartitionAccumulators.clear();
+  m_PartitionSlots.clear();
+  m_Labels.clear();
+  m_LabelPopulations.clear();
+  m_MeanColumns.clear();
+
+  TInputVectorImage * inputPtr = const_cast<TInputVectorImage *>(this->GetInput());
+  if (!inputPtr)
+    {
+    return;
+    }
+  inputPtr->UpdateOutputInformation();
+  const unsigned int nbComp = inputPtr->GetNumberOfComponentsPerPixel();
+
+  AccumulatorType accumulator;
+  if (m_UseDenseLabelRange)
+    {
+    accumulator.InitializeDense(nbComp, m_MinimumDenseLabel, m_MaximumDenseLabel);
+    }
+  else
+    {
+    accumulator.Initialize(nbComp);
+    }
+  m_ThreadAccumulators.assign(this->GetNumberOfThreads(), accumulator);
 }
 
 template<class TInputVectorImage, class TLabelImage>
@@ -189,41 +471,37 @@ PersistentStreamingStatisticsMapFromLabelImageFilter<TInputVectorImage, TLabelIm
 template<class TInputVectorImage, class TLabelImage>
 void
 PersistentStreamingStatisticsMapFromLabelImageFilter<TInputVectorImage, TLabelImage>
-::GenerateData()
+::ThreadedGenerateData(const InputImageRegionType& outputRegionForThread, itk::ThreadIdType threadId)
 {
+  typedef itk::DefaultConvertPixelTraits<VectorPixelType> PixelTraitsType;
+
   /**
    * Grab the input
    */
-  InputVectorImagePointer inputPtr =  const_cast<TInputVectorImage *>(this->GetInput());
-  LabelImagePointer labelInputPtr =  const_cast<TLabelImage *>(this->GetInputLabelImage());
+  const TInputVectorImage * inputPtr = this->GetInput();
+  const TLabelImage * labelInputPtr = static_cast<const TLabelImage *>(this->itk::ProcessObject::GetInput(1));
 
-  itk::ImageRegionConstIterator<TInputVectorImage> inIt(inputPtr, inputPtr->GetRequestedRegion());
-  itk::ImageRegionConstIterator<TLabelImage> labelIt(labelInputPtr, labelInputPtr->GetRequestedRegion());
+  // support progress methods/callbacks
+  itk::ProgressReporter progress(this, threadId, outputRegionForThread.GetNumberOfPixels());
 
-  itk::VariableLengthVector<double> zeroValue(inputPtr->GetNumberOfComponentsPerPixel());
-  zeroValue.Fill(0.0);
+  itk::ImageRegionConstIterator<TInputVectorImage> inIt(inputPtr, outputRegionForThread);
+  itk::ImageRegionConstIterator<TLabelImage> labelIt(labelInputPtr, outputRegionForThread);
+
+  AccumulatorType & accumulator = m_ThreadAccumulators[threadId];
+  const unsigned int nbComp = accumulator.GetNumberOfComponents();
 
-  typename VectorImageType::PixelType value;
-  typename LabelImageType::PixelType label;
   // do the work
   for (inIt.GoToBegin(), labelIt.GoToBegin();
        !inIt.IsAtEnd() && !labelIt.IsAtEnd();
        ++inIt, ++labelIt)
     {
-      value = inIt.Get();
-      label = labelIt.Get();
-      if (m_RadiometricValueAccumulator.count(label)<=0) //add new element to the map
-      {
-        // use a zero pixel with the right number of components to support scalar images
-        m_RadiometricValueAccumulator[label] = (zeroValue + value);
-        m_LabelPopulation[label] = 1;
-      }
-      else
+    const VectorPixelType & value = inIt.Get();
+    double * sums = accumulator.Accumulate(labelIt.Get());
+    for (unsigned int k = 0; k < nbComp; ++k)
       {
-        m_RadiometricValueAccumulator[label] += value;
-        m_LabelPopulation[label] ++;
+      sums[k] += static_cast<double>(PixelTraitsType::GetNthComponent(k, value));
       }
-
+    progress.CompletedPixel();
     }
 }
 
@@ -233,6 +511,12 @@ PersistentStreamingStatisticsMapFromLabelImageFilter<TInputVectorImage, TLabelIm
 ::PrintSelf(std::ostream& os, itk::Indent indent) const
 {
   Superclass::PrintSelf(os, indent);
+
+  os << indent << "Number of labels: " << m_Labels.size() << std::endl;
+  if (m_UseDenseLabelRange)
+    {
+    os << indent << "Dense label range: [" << m_MinimumDenseLabel << ", " << m_MaximumDenseLabel << "]" << std::endl;
+    }
 }
 
 } // end namespace otb
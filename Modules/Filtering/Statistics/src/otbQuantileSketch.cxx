@@ -0,0 +1,311 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "otbQuantileSketch.h"
+#include <algorithm>
+#include <utility>
+#include <cmath>
+
+namespace otb
+{
+
+namespace
+{
+// Seed of the coin generator, restored by Clear()
+const unsigned int QuantileSketchSeed = 12345U;
+}
+
+QuantileSketch::QuantileSketch(unsigned int k)
+  : m_Levels(),
+    m_K(k < 8 ? 8 : k),
+    m_Count(0UL),
+    m_RetainedValues(0UL),
+    m_Capacity(0UL),
+    m_Minimum(0.0),
+    m_Maximum(0.0),
+    m_RandomState(QuantileSketchSeed)
+{
+  this->Clear();
+}
+
+void
+QuantileSketch::SetAccuracyParameter(unsigned int k)
+{
+  m_K = (k < 8 ? 8 : k);
+  this->Clear();
+}
+
+void
+QuantileSketch::Clear()
+{
+  m_Levels.clear();
+  m_Levels.push_back(LevelType());
+  m_Count = 0UL;
+  m_RetainedValues = 0UL;
+  m_Capacity = this->GetLevelCapacity(0);
+  m_Minimum = 0.0;
+  m_Maximum = 0.0;
+  m_RandomState = QuantileSketchSeed;
+}
+
+unsigned long
+QuantileSketch::GetLevelCapacity(unsigned int level) const
+{
+  // top level has a capacity of K, lower levels shrink with a 2/3 ratio
+  const unsigned int depth = static_cast<unsigned int>(m_Levels.size()) - 1 - level;
+  const double capacity = std::ceil(static_cast<double>(m_K) * std::pow(2.0/3.0, static_cast<double>(depth)));
+  return std::max(2UL, static_cast<unsigned long>(capacity));
+}
+
+void
+QuantileSketch::Insert(ValueType value)
+{
+  if (m_Count == 0UL)
+    {
+    m_Minimum = value;
+    m_Maximum = value;
+    }
+  else
+    {
+    if (value < m_Minimum) m_Minimum = value;
+    if (value > m_Maximum) m_Maximum = value;
+    }
+  ++m_Count;
+
+  m_Levels[0].push_back(value);
+  ++m_RetainedValues;
+
+  if (m_RetainedValues >= m_Capacity)
+    {
+    this->Compress();
+    }
+}
+
+unsigned int
+QuantileSketch::FlipCoin()
+{
+  // 32 bits linear congruential generator (Numerical Recipes constants),
+  // the most significant bit is the one with the longest period
+  m_RandomState = 1664525U * m_RandomState + 1013904223U;
+  return (m_RandomState >> 31) & 1U;
+}
+
+void
+QuantileSketch::Compress()
+{
+  while (m_RetainedValues >= m_Capacity)
+    {
+    unsigned int level = 0;
+    const unsigned int nbLevels = static_cast<unsigned int>(m_Levels.size());
+    while (level < nbLevels && m_Levels[level].size() < this->GetLevelCapacity(level))
+      {
+      ++level;
+      }
+    if (level == nbLevels)
+      {
+      // should not happen: the total capacity is the sum of level capacities
+      break;
+      }
+    this->CompactLevel(level);
+    }
+}
+
+void
+QuantileSketch::CompactLevel(unsigned int level)
+{
+  if (level + 1 == m_Levels.size())
+    {
+    m_Levels.push_back(LevelType());
+    m_Capacity = 0UL;
+    for (unsigned int h = 0; h < m_Levels.size(); ++h)
+      {
+      m_Capacity += this->GetLevelCapacity(h);
+      }
+    }
+
+  LevelType & current = m_Levels[level];
+  LevelType & next = m_Levels[level + 1];
+
+  std::sort(current.begin(), current.end());
+
+  // an odd element is kept at the current level (the largest one)
+  const size_t evenSize = current.size() - (current.size() % 2);
+  for (size_t i = this->FlipCoin(); i < evenSize; i += 2)
+    {
+    next.push_back(current[i]);
+    }
+
+  if (evenSize < current.size())
+    {
+    current[0] = current.back();
+    current.resize(1);
+    }
+  else
+    {
+    current.clear();
+    }
+  m_RetainedValues -= evenSize / 2;
+}
+
+void
+QuantileSketch::Merge(const Self & other)
+{
+  if (other.m_Count == 0UL)
+    {
+    return;
+    }
+  if (&other == this)
+    {
+    Self copy(*this);
+    this->Merge(copy);
+    return;
+    }
+  if (other.m_K != m_K)
+    {
+    itkGenericExceptionMacro(<< "Can't merge quantile sketches with different accuracy parameters ("
+                             << m_K << " and " << other.m_K << ")");
+    }
+
+  if (m_Count == 0UL)
+    {
+    m_Minimum = other.m_Minimum;
+    m_Maximum = other.m_Maximum;
+    }
+  else
+    {
+    m_Minimum = std::min(m_Minimum, other.m_Minimum);
+    m_Maximum = std::max(m_Maximum, other.m_Maximum);
+    }
+  m_Count += other.m_Count;
+
+  if (m_Levels.size() < other.m_Levels.size())
+    {
+    m_Levels.resize(other.m_Levels.size());
+    }
+  for (unsigned int h = 0; h < other.m_Levels.size(); ++h)
+    {
+    m_Levels[h].insert(m_Levels[h].end(), other.m_Levels[h].begin(), other.m_Levels[h].end());
+    m_RetainedValues += other.m_Levels[h].size();
+    }
+
+  m_Capacity = 0UL;
+  for (unsigned int h = 0; h < m_Levels.size(); ++h)
+    {
+    m_Capacity += this->GetLevelCapacity(h);
+    }
+
+  this->Compress();
+}
+
+unsigned long
+QuantileSketch::GetNumberOfRetainedValues() const
+{
+  return m_RetainedValues;
+}
+
+void
+QuantileSketch::GetSortedValues(std::vector<ValueType> & values,
+                                std::vector<double> & cumWeights) const
+{
+  std::vector<std::pair<ValueType, double> > weighted;
+  weighted.reserve(m_RetainedValues);
+  double weight = 1.0;
+  for (unsigned int h = 0; h < m_Levels.size(); ++h)
+    {
+    for (LevelType::const_iterator it = m_Levels[h].begin(); it != m_Levels[h].end(); ++it)
+      {
+      weighted.push_back(std::make_pair(*it, weight));
+      }
+    weight *= 2.0;
+    }
+  std::sort(weighted.begin(), weighted.end());
+
+  values.resize(weighted.size());
+  cumWeights.resize(weighted.size());
+  double cumulated = 0.0;
+  for (size_t i = 0; i < weighted.size(); ++i)
+    {
+    cumulated += weighted[i].second;
+    values[i] = weighted[i].first;
+    cumWeights[i] = cumulated;
+    }
+}
+
+QuantileSketch::ValueType
+QuantileSketch::GetQuantile(double p) const
+{
+  std::vector<double> orders(1, p);
+  return this->GetQuantiles(orders)[0];
+}
+
+std::vector<QuantileSketch::ValueType>
+QuantileSketch::GetQuantiles(const std::vector<double> & p) const
+{
+  std::vector<ValueType> result(p.size(), 0.0);
+  if (m_Count == 0UL)
+    {
+    return result;
+    }
+
+  std::vector<ValueType> values;
+  std::vector<double>    cumWeights;
+  this->GetSortedValues(values, cumWeights);
+  const double totalWeight = cumWeights.back();
+
+  for (size_t i = 0; i < p.size(); ++i)
+    {
+    if (p[i] <= 0.0)
+      {
+      result[i] = m_Minimum;
+      }
+    else if (p[i] >= 1.0)
+      {
+      result[i] = m_Maximum;
+      }
+    else
+      {
+      const double target = p[i] * totalWeight;
+      size_t pos = std::lower_bound(cumWeights.begin(), cumWeights.end(), target) - cumWeights.begin();
+      if (pos >= values.size())
+        {
+        pos = values.size() - 1;
+        }
+      result[i] = std::min(m_Maximum, std::max(m_Minimum, values[pos]));
+      }
+    }
+  return result;
+}
+
+double
+QuantileSketch::GetNormalizedRankError() const
+{
+  return 2.446 / std::pow(static_cast<double>(m_K), 0.9433);
+}
+
+void
+QuantileSketch::Print(std::ostream & os) const
+{
+  os << "K: " << m_K << ", count: " << m_Count
+     << ", retained values: " << m_RetainedValues
+     << ", levels: " << m_Levels.size()
+     << ", min: " << m_Minimum << ", max: " << m_Maximum;
+}
+
+} // end namespace otb
@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "otbLabelStatisticsAccumulator.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include <map>
+#include <vector>
+
+typedef otb::LabelStatisticsAccumulator<unsigned int> AccumulatorType;
+
+int RunLabelStatisticsAccumulatorTest(bool dense)
+{
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator GeneratorType;
+  GeneratorType::Pointer generator = GeneratorType::New();
+  generator->Initialize(42);
+
+  const unsigned int nbThreads = 3;
+  const unsigned int nbPartitions = 4;
+  const unsigned int nbComp = 2;
+
+  // per-"thread" accumulators, with labels partly outside of the dense range
+  std::vector<AccumulatorType> accumulators(nbThreads);
+  for (unsigned int t = 0; t < nbThreads; ++t)
+    {
+    if (dense)
+      {
+      accumulators[t].InitializeDense(nbComp, 100, 5000);
+      }
+    else
+      {
+      accumulators[t].Initialize(nbComp);
+      }
+    }
+
+  std::map<unsigned int, std::pair<double, double> > reference;
+  for (unsigned int i = 0; i < 100000; ++i)
+    {
+    const unsigned int label = generator->GetIntegerVariate(20000);
+    const double value = generator->GetIntegerVariate(10);
+    double * sums = accumulators[i % nbThreads].Accumulate(label);
+    sums[0] += value;
+    sums[1] += 2 * value;
+    reference[label].first += 1.0;
+    reference[label].second += value;
+    }
+
+  // merge partition by partition
+  size_t nbLabels = 0;
+  for (unsigned int p = 0; p < nbPartitions; ++p)
+    {
+    AccumulatorType merged;
+    merged.Initialize(nbComp);
+    for (unsigned int t = 0; t < nbThreads; ++t)
+      {
+      for (size_t slot = 0; slot < accumulators[t].GetNumberOfSlots(); ++slot)
+        {
+        if (accumulators[t].IsSlotUsed(slot)
+            && accumulators[t].GetPartition(accumulators[t].GetSlotLabel(slot), nbPartitions) == p)
+          {
+          merged.MergeSlot(accumulators[t], slot);
+          }
+        }
+      }
+    nbLabels += merged.GetNumberOfLabels();
+
+    for (size_t slot = 0; slot < merged.GetNumberOfSlots(); ++slot)
+      {
+      if (!merged.IsSlotUsed(slot))
+        {
+        continue;
+        }
+      const unsigned int label = merged.GetSlotLabel(slot);
+      if (reference[label].first != merged.GetSlotCount(slot)
+          || reference[label].second != merged.GetSlotSums(slot)[0]
+          || 2 * reference[label].second != merged.GetSlotSums(slot)[1])
+        {
+        std::cout << "Wrong statistics for label " << label << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  if (nbLabels != reference.size())
+    {
+    std::cout << "Wrong number of labels : expected " << reference.size() << ", got " << nbLabels << std::endl;
+    return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
+
+int RunFloatLabelStatisticsAccumulatorTest()
+{
+  // fractional labels sharing the same integer part must not collide
+  typedef otb::LabelStatisticsAccumulator<float> FloatAccumulatorType;
+  FloatAccumulatorType accumulator;
+  accumulator.Initialize(1, 16);
+
+  const unsigned int nbLabels = 4000;
+  for (unsigned int i = 0; i < nbLabels; ++i)
+    {
+    accumulator.Accumulate(0.001f * i)[0] += i;
+    }
+  // -0 and +0 are the same label
+  accumulator.Accumulate(-0.0f)[0] += 1.0;
+
+  if (accumulator.GetNumberOfLabels() != nbLabels)
+    {
+    std::cout << "Wrong number of float labels : expected " << nbLabels << ", got "
+              << accumulator.GetNumberOfLabels() << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (accumulator.GetMinimumLabel() != 0.0f || accumulator.GetMaximumLabel() != 0.001f * (nbLabels - 1))
+    {
+    std::cout << "Wrong observed label range [" << accumulator.GetMinimumLabel() << ","
+              << accumulator.GetMaximumLabel() << "]" << std::endl;
+    return EXIT_FAILURE;
+    }
+  for (size_t slot = 0; slot < accumulator.GetNumberOfSlots(); ++slot)
+    {
+    if (accumulator.IsSlotUsed(slot) && accumulator.GetSlotLabel(slot) == 0.0f && accumulator.GetSlotCount(slot) != 2.0)
+      {
+      std::cout << "Label 0 and -0 were not merged" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  return EXIT_SUCCESS;
+}
+
+int otbLabelStatisticsAccumulatorTest(int, char *[])
+{
+  if (RunLabelStatisticsAccumulatorTest(false) == EXIT_FAILURE)
+    {
+    std::cout << "Hash mode failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (RunLabelStatisticsAccumulatorTest(true) == EXIT_FAILURE)
+    {
+    std::cout << "Dense mode failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (RunFloatLabelStatisticsAccumulatorTest() == EXIT_FAILURE)
+    {
+    std::cout << "Float labels failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "otbQuantileSketch.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include <algorithm>
+#include <vector>
+#include <cmath>
+
+int otbQuantileSketchTest(int, char *[])
+{
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator GeneratorType;
+  GeneratorType::Pointer generator = GeneratorType::New();
+  generator->Initialize(12345);
+
+  const unsigned int nbParts = 4;
+  const unsigned long nbValues = 200000UL;
+
+  std::vector<otb::QuantileSketch> sketches(nbParts, otb::QuantileSketch(200));
+  std::vector<double> values;
+  values.reserve(nbValues);
+
+  for (unsigned long i = 0UL; i < nbValues; ++i)
+    {
+    double v = generator->GetNormalVariate(100.0, 400.0);
+    values.push_back(v);
+    sketches[i % nbParts].Insert(v);
+    }
+
+  // merge partial sketches, as done between threads
+  for (unsigned int i = 1; i < nbParts; ++i)
+    {
+    sketches[0].Merge(sketches[i]);
+    }
+  const otb::QuantileSketch & sketch = sketches[0];
+  sketch.Print(std::cout);
+  std::cout << std::endl;
+
+  std::sort(values.begin(), values.end());
+
+  if (sketch.GetCount() != nbValues)
+    {
+    std::cout << "Wrong count : expected " << nbValues << ", got " << sketch.GetCount() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if (sketch.GetNumberOfRetainedValues() > 3 * sketch.GetAccuracyParameter())
+    {
+    std::cout << "Too many retained values : " << sketch.GetNumberOfRetainedValues() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if (sketch.GetQuantile(0.0) != values.front() || sketch.GetQuantile(1.0) != values.back())
+    {
+    std::cout << "Wrong extrema : expected [" << values.front() << "," << values.back()
+              << "], got [" << sketch.GetQuantile(0.0) << "," << sketch.GetQuantile(1.0) << "]" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The sketch coin generator and the input use fixed seeds, so the test
+  // is deterministic
+  const double tolerance = sketch.GetNormalizedRankError();
+  for (unsigned int k = 1; k < 100; ++k)
+    {
+    const double p = 0.01 * k;
+    const double q = sketch.GetQuantile(p);
+    const double rank = static_cast<double>(std::lower_bound(values.begin(), values.end(), q) - values.begin())
+                        / static_cast<double>(nbValues);
+    if (std::fabs(rank - p) > tolerance)
+      {
+      std::cout << "Quantile " << p << " out of tolerance : value " << q << " has rank " << rank
+                << " (tolerance " << tolerance << ")" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -55,6 +55,7 @@ void RegisterTests()
   REGISTER_TEST(otbContinuousMinimumMaximumImageCalculatorNew);
   REGISTER_TEST(otbStreamingCompareImageFilterNew);
   REGISTER_TEST(otbStreamingCompareImageFilter);
+  REGISTER_TEST(otbStreamingCompareImageFilterDifferingRegions);
   REGISTER_TEST(otbStreamingStatisticsMapFromLabelImageFilterTest);
   REGISTER_TEST(otbLocalHistogramImageFunctionNew);
   REGISTER_TEST(otbRealAndImaginaryImageToComplexImageFilterTest);
@@ -71,4 +72,11 @@ void RegisterTests()
   REGISTER_TEST(otbPeriodicSamplerTest);
   REGISTER_TEST(otbPatternSamplerTest);
   REGISTER_TEST(otbRandomSamplerTest);
+  REGISTER_TEST(otbQuantileSketchTest);
+  REGISTER_TEST(otbStreamingQuantilesVectorImageFilterNew);
+  REGISTER_TEST(otbStreamingQuantilesVectorImageFilterTest);
+  REGISTER_TEST(otbStreamingQuantilesVectorImageFilterThreadsTest);
+  REGISTER_TEST(otbLabelStatisticsAccumulatorTest);
+  REGISTER_TEST(otbStreamingSampledStatisticsVectorImageFilterNew);
+  REGISTER_TEST(otbStreamingSampledStatisticsVectorImageFilterTest);
 }
@@ -25,7 +25,11 @@
 #include "otbImageFileReader.h"
 #include "otbImage.h"
 #include <fstream>
+#include <cmath>
+#include <limits>
+#include "vnl/vnl_math.h"
 #include "otbStreamingTraits.h"
+#include "itkImageRegionIteratorWithIndex.h"
 
 int otbStreamingCompareImageFilterNew(int itkNotUsed(argc), char * itkNotUsed(argv) [])
 {
@@ -82,3 +86,91 @@ int otbStreamingCompareImageFilter(int itkNotUsed(argc), char * argv[])
 
   return EXIT_SUCCESS;
 }
+
+int otbStreamingCompareImageFilterDifferingRegions(int itkNotUsed(argc), char * itkNotUsed(argv) [])
+{
+  typedef otb::Image<float, 2>                        ImageType;
+  typedef otb::StreamingCompareImageFilter<ImageType> StreamingCompareImageFilterType;
+
+  ImageType::SizeType size;
+  size.Fill(256);
+  ImageType::IndexType idx;
+  idx.Fill(0);
+  ImageType::RegionType region(idx, size);
+
+  ImageType::Pointer image1 = ImageType::New();
+  image1->SetRegions(region);
+  image1->Allocate();
+  ImageType::Pointer image2 = ImageType::New();
+  image2->SetRegions(region);
+  image2->Allocate();
+
+  // the images only differ by 3 pixels, in the tile starting at (64,128)
+  itk::ImageRegionIteratorWithIndex<ImageType> it1(image1, region);
+  itk::ImageRegionIteratorWithIndex<ImageType> it2(image2, region);
+  for (it1.GoToBegin(), it2.GoToBegin(); !it1.IsAtEnd(); ++it1, ++it2)
+    {
+    const float value = static_cast<float>((it1.GetIndex()[0] + 3 * it1.GetIndex()[1]) % 255);
+    it1.Set(value);
+    it2.Set(value);
+    }
+  ImageType::IndexType diffIndex;
+  diffIndex[0] = 70;
+  diffIndex[1] = 130;
+  for (unsigned int i = 0; i < 3; ++i, ++diffIndex[0])
+    {
+    image2->SetPixel(diffIndex, image1->GetPixel(diffIndex) + 2.f);
+    }
+
+  // +0 and -0 differ by their bytes, not by their values: the tile
+  // starting at (0,0) must not be reported
+  ImageType::IndexType zeroIndex;
+  zeroIndex.Fill(0);
+  image2->SetPixel(zeroIndex, -0.f);
+
+  StreamingCompareImageFilterType::Pointer filter = StreamingCompareImageFilterType::New();
+  filter->SetInput1(image1);
+  filter->SetInput2(image2);
+  filter->GetStreamer()->SetTileDimensionTiledStreaming(64);
+  filter->Update();
+
+  std::cout << "MSE: " << filter->GetMSE() << ", count: " << filter->GetDiffCount()
+            << ", differing tiles: " << filter->GetDifferingRegions().size()
+            << " / " << filter->GetNumberOfProcessedRegions() << std::endl;
+
+  const double expectedMSE = 3. * 4. / region.GetNumberOfPixels();
+  if (filter->GetDiffCount() != 3. || std::abs(filter->GetMSE() - expectedMSE) > 1e-9
+      || std::abs(filter->GetMAE() - 2. * expectedMSE / 4.) > 1e-9)
+    {
+    std::cerr << "Wrong metrics" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if (filter->GetDifferingRegions().size() != 1
+      || !filter->GetDifferingRegions()[0].IsInside(diffIndex)
+      || filter->GetDifferingRegionsDiffCount()[0] != 3)
+    {
+    std::cerr << "Wrong differing regions" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Identical lines holding NaN values are not skipped: NaN propagates to
+  // the metrics
+  ImageType::IndexType nanIndex;
+  nanIndex[0] = 200;
+  nanIndex[1] = 10;
+  image1->SetPixel(nanIndex, std::numeric_limits<float>::quiet_NaN());
+  image2->SetPixel(nanIndex, std::numeric_limits<float>::quiet_NaN());
+  image1->Modified();
+  image2->Modified();
+  filter->Update();
+
+  std::cout << "MSE with NaN: " << filter->GetMSE() << std::endl;
+  if (!vnl_math_isnan(filter->GetMSE()))
+    {
+    std::cerr << "NaN values were skipped" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "otbStreamingQuantilesVectorImageFilter.h"
+#include "otbVectorImage.h"
+#include "otbImage.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include <cmath>
+
+typedef otb::VectorImage<float>                                  VectorImageType;
+typedef otb::Image<unsigned char>                                MaskImageType;
+typedef otb::StreamingQuantilesVectorImageFilter<VectorImageType> SQVIFType;
+
+int otbStreamingQuantilesVectorImageFilterNew(int itkNotUsed(argc), char * itkNotUsed(argv) [])
+{
+  SQVIFType::Pointer filter = SQVIFType::New();
+
+  std::cout << filter << std::endl;
+
+  return EXIT_SUCCESS;
+}
+
+int otbStreamingQuantilesVectorImageFilterTest(int itkNotUsed(argc), char * itkNotUsed(argv) [])
+{
+  // Allocate input image : band 0 is the column index, band 1 the line index
+  const unsigned int nbComp = 2;
+  VectorImageType::SizeType size;
+  size.Fill(100);
+  VectorImageType::IndexType idx;
+  idx.Fill(0);
+  VectorImageType::RegionType region;
+  region.SetSize(size);
+  region.SetIndex(idx);
+
+  VectorImageType::Pointer image = VectorImageType::New();
+  image->SetRegions(region);
+  image->SetNumberOfComponentsPerPixel(nbComp);
+  image->Allocate();
+
+  MaskImageType::Pointer mask = MaskImageType::New();
+  mask->SetRegions(region);
+  mask->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<VectorImageType> it(image, region);
+  itk::ImageRegionIteratorWithIndex<MaskImageType> itMask(mask, region);
+  VectorImageType::PixelType pixel(nbComp);
+  for (it.GoToBegin(), itMask.GoToBegin(); !it.IsAtEnd(); ++it, ++itMask)
+    {
+    pixel[0] = it.GetIndex()[0];
+    pixel[1] = it.GetIndex()[1];
+    it.Set(pixel);
+    // mask the right half of the image
+    itMask.Set(it.GetIndex()[0] >= 50 ? 1 : 0);
+    }
+
+  SQVIFType::Pointer filter = SQVIFType::New();
+  filter->SetInput(image);
+  filter->GetStreamer()->SetNumberOfDivisionsStrippedStreaming(7);
+  filter->Update();
+
+  SQVIFType::RealPixelType minimum = filter->GetQuantile(0.0);
+  SQVIFType::RealPixelType median = filter->GetQuantile(0.5);
+  SQVIFType::RealPixelType maximum = filter->GetQuantile(1.0);
+  std::cout << "Min " << minimum << " median " << median << " max " << maximum << std::endl;
+
+  for (unsigned int k = 0; k < nbComp; ++k)
+    {
+    if (minimum[k] != 0. || maximum[k] != 99.)
+      {
+      std::cerr << "Wrong extrema for band " << k << std::endl;
+      return EXIT_FAILURE;
+      }
+    if (std::abs(median[k] - 49.5) > 2.)
+      {
+      std::cerr << "Wrong median for band " << k << " : " << median[k] << std::endl;
+      return EXIT_FAILURE;
+      }
+    if (filter->GetSketch(k).GetCount() != 10000UL)
+      {
+      std::cerr << "Wrong number of samples for band " << k << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Subsampled grid and mask
+  filter->SetMaskImage(mask);
+  filter->GetFilter()->SetSubSamplingRate(3);
+  filter->Update();
+
+  maximum = filter->GetQuantile(1.0);
+  std::cout << "Subsampled and masked max " << maximum << std::endl;
+
+  // grid columns 0, 3, ..., 48 are kept (17 values), lines 0, 3, ..., 99 (34 values)
+  if (filter->GetSketch(0).GetCount() != 17UL * 34UL)
+    {
+    std::cerr << "Wrong number of samples on the masked grid : " << filter->GetSketch(0).GetCount() << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (maximum[0] != 48. || maximum[1] != 99.)
+    {
+    std::cerr << "Wrong maximum on the masked grid" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
+
+int otbStreamingQuantilesVectorImageFilterThreadsTest(int itkNotUsed(argc), char * itkNotUsed(argv) [])
+{
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator GeneratorType;
+  GeneratorType::Pointer generator = GeneratorType::New();
+  generator->Initialize(12345);
+
+  // Random input image, large enough for the sketches to be compacted
+  const unsigned int nbComp = 2;
+  VectorImageType::SizeType size;
+  size[0] = 401;
+  size[1] = 257;
+  VectorImageType::IndexType idx;
+  idx.Fill(0);
+  VectorImageType::RegionType region;
+  region.SetSize(size);
+  region.SetIndex(idx);
+
+  VectorImageType::Pointer image = VectorImageType::New();
+  image->SetRegions(region);
+  image->SetNumberOfComponentsPerPixel(nbComp);
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<VectorImageType> it(image, region);
+  VectorImageType::PixelType pixel(nbComp);
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+    {
+    pixel[0] = generator->GetNormalVariate(100.0, 400.0);
+    pixel[1] = generator->GetUniformVariate(0.0, 1000.0);
+    it.Set(pixel);
+    }
+
+  // Reference : one thread, no streaming
+  SQVIFType::Pointer filter = SQVIFType::New();
+  filter->SetInput(image);
+  filter->GetFilter()->SetNumberOfThreads(1);
+  filter->GetStreamer()->SetNumberOfDivisionsStrippedStreaming(1);
+  filter->Update();
+
+  std::vector<SQVIFType::RealPixelType> reference;
+  for (unsigned int k = 0; k <= 100; ++k)
+    {
+    reference.push_back(filter->GetQuantile(0.01 * k));
+    }
+  std::cout << "Reference median " << reference[50] << std::endl;
+
+  // Same quantiles are expected with several threads, and with stripped
+  // or tiled streaming
+  const unsigned int nbThreads[3] = {4, 3, 7};
+  for (unsigned int c = 0; c < 3; ++c)
+    {
+    filter->GetFilter()->SetNumberOfThreads(nbThreads[c]);
+    if (c == 0)
+      {
+      filter->GetStreamer()->SetNumberOfDivisionsStrippedStreaming(9);
+      }
+    else
+      {
+      filter->GetStreamer()->SetTileDimensionTiledStreaming(64 + 32 * c);
+      }
+    filter->Update();
+
+    for (unsigned int k = 0; k <= 100; ++k)
+      {
+      const SQVIFType::RealPixelType quantile = filter->GetQuantile(0.01 * k);
+      for (unsigned int b = 0; b < nbComp; ++b)
+        {
+        if (quantile[b] != reference[k][b])
+          {
+          std::cerr << "Quantile " << 0.01 * k << " of band " << b << " differs with "
+                    << nbThreads[c] << " threads : " << quantile[b] << " instead of "
+                    << reference[k][b] << std::endl;
+          return EXIT_FAILURE;
+          }
+        }
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "otbStreamingSampledStatisticsVectorImageFilter.h"
+#include "otbVectorImage.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include <cmath>
+
+typedef otb::VectorImage<float>                                           VectorImageType;
+typedef otb::StreamingSampledStatisticsVectorImageFilter<VectorImageType> SSSVIFType;
+
+int otbStreamingSampledStatisticsVectorImageFilterNew(int itkNotUsed(argc), char * itkNotUsed(argv) [])
+{
+  SSSVIFType::Pointer filter = SSSVIFType::New();
+
+  std::cout << filter << std::endl;
+
+  return EXIT_SUCCESS;
+}
+
+int otbStreamingSampledStatisticsVectorImageFilterTest(int itkNotUsed(argc), char * itkNotUsed(argv) [])
+{
+  const unsigned int nbComp = 2;
+  VectorImageType::SizeType size;
+  size.Fill(512);
+  VectorImageType::IndexType idx;
+  idx.Fill(0);
+  VectorImageType::RegionType region;
+  region.SetSize(size);
+  region.SetIndex(idx);
+
+  VectorImageType::Pointer image = VectorImageType::New();
+  image->SetRegions(region);
+  image->SetNumberOfComponentsPerPixel(nbComp);
+  image->Allocate();
+
+  // band 0 is a periodic texture, band 1 a ramp along columns
+  double exactMean[nbComp] = {0., 0.};
+  double exactSquares[nbComp] = {0., 0.};
+  itk::ImageRegionIteratorWithIndex<VectorImageType> it(image, region);
+  VectorImageType::PixelType pixel(nbComp);
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+    {
+    pixel[0] = (it.GetIndex()[0] * 7 + it.GetIndex()[1] * 13) % 100;
+    pixel[1] = it.GetIndex()[0];
+    it.Set(pixel);
+    for (unsigned int k = 0; k < nbComp; ++k)
+      {
+      exactMean[k] += pixel[k];
+      exactSquares[k] += pixel[k] * pixel[k];
+      }
+    }
+  const double nbPixels = region.GetNumberOfPixels();
+  double exactVariance[nbComp];
+  for (unsigned int k = 0; k < nbComp; ++k)
+    {
+    exactMean[k] /= nbPixels;
+    exactVariance[k] = (exactSquares[k] / nbPixels - exactMean[k] * exactMean[k]) * nbPixels / (nbPixels - 1.);
+    }
+
+  // Reading all tiles gives the exact statistics
+  SSSVIFType::Pointer filter = SSSVIFType::New();
+  filter->SetInput(image);
+  filter->SetTileDimension(64);
+  filter->SetSamplingRate(1.0);
+  filter->Update();
+
+  std::cout << "Full: mean " << filter->GetMean() << " +/- " << filter->GetMeanHalfWidth()
+            << ", variance " << filter->GetVariance() << std::endl;
+
+  if (filter->GetNumberOfSampledTiles() != filter->GetNumberOfTiles())
+    {
+    std::cerr << "All tiles should have been read" << std::endl;
+    return EXIT_FAILURE;
+    }
+  for (unsigned int k = 0; k < nbComp; ++k)
+    {
+    if (std::abs(filter->GetMean()[k] - exactMean[k]) > 1e-6
+        || std::abs(filter->GetVariance()[k] - exactVariance[k]) > 1e-6 * exactVariance[k]
+        || filter->GetMeanHalfWidth()[k] != 0.
+        || filter->GetStandardDeviationHalfWidth()[k] != 0.)
+      {
+      std::cerr << "Wrong exhaustive statistics for band " << k << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // A quarter of the tiles, extended until the target error is reached
+  filter->SetSamplingRate(0.25);
+  filter->SetTargetError(0.05);
+  filter->SetSeed(3);
+  filter->Update();
+
+  std::cout << "Sampled (" << filter->GetNumberOfSampledTiles() << "/" << filter->GetNumberOfTiles()
+            << " tiles): mean " << filter->GetMean() << " +/- " << filter->GetMeanHalfWidth()
+            << ", variance " << filter->GetVariance()
+            << ", stddev +/- " << filter->GetStandardDeviationHalfWidth() << std::endl;
+
+  if (4 * filter->GetNumberOfSampledTiles() < filter->GetNumberOfTiles())
+    {
+    std::cerr << "At least the first quarter of the tiles should have been read" << std::endl;
+    return EXIT_FAILURE;
+    }
+  for (unsigned int k = 0; k < nbComp; ++k)
+    {
+    const double stddev = std::sqrt(exactVariance[k]);
+    if (filter->GetNumberOfSampledTiles() < filter->GetNumberOfTiles()
+        && filter->GetMeanHalfWidth()[k] > 0.05 * std::sqrt(filter->GetVariance()[k]))
+      {
+      std::cerr << "Target error not reached for band " << k << std::endl;
+      return EXIT_FAILURE;
+      }
+    // stratified tiles: the estimate is much closer than a few half widths
+    if (std::abs(filter->GetMean()[k] - exactMean[k]) > 3. * filter->GetMeanHalfWidth()[k] + 0.01 * stddev)
+      {
+      std::cerr << "Sampled mean out of its confidence interval for band " << k << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
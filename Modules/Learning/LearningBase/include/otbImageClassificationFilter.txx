@@ -24,6 +24,7 @@
 #include "otbImageClassificationFilter.h"
 #include "itkImageRegionIterator.h"
 #include "itkProgressReporter.h"
+#include <vector>
 
 namespace otb
 {
@@ -200,60 +201,81 @@ ImageClassificationFilter<TInputImage, TOutputImage, TMaskImage>
   typedef itk::ImageRegionIterator<OutputImageType>     OutputIteratorType;
   typedef itk::ImageRegionIterator<ConfidenceImageType> ConfidenceMapIteratorType;
 
-  InputIteratorType inIt(inputPtr, outputRegionForThread);
-  OutputIteratorType outIt(outputPtr, outputRegionForThread);
+  typedef typename ModelType::InputSampleMatrixType    InputSampleMatrixType;
+  typedef typename ModelType::TargetValueType          TargetValueType;
+  typedef typename ModelType::ConfidenceValueType      ConfidenceValueType;
 
-  MaskIteratorType maskIt;
-  if (inputMaskPtr)
+  const unsigned int num_features = inputPtr->GetNumberOfComponentsPerPixel();
+  const unsigned long nbPixels = outputRegionForThread.GetNumberOfPixels();
+  if (nbPixels == 0)
     {
-    maskIt = MaskIteratorType(inputMaskPtr, outputRegionForThread);
-    maskIt.GoToBegin();
+    return;
     }
 
-  // typedef typename ModelType::InputValueType       InputValueType;
-  typedef typename ModelType::InputSampleType      InputSampleType;
-  typedef typename ModelType::InputListSampleType  InputListSampleType;
-  typedef typename ModelType::TargetValueType      TargetValueType;
-  // typedef typename ModelType::TargetSampleType     TargetSampleType;
-  typedef typename ModelType::TargetListSampleType TargetListSampleType;
-  // typedef typename ModelType::ConfidenceValueType      ConfidenceValueType;
-  // typedef typename ModelType::ConfidenceSampleType     ConfidenceSampleType;
-  typedef typename ModelType::ConfidenceListSampleType ConfidenceListSampleType;
+  // The samples are read in place from the input buffer: pixel
+  // components are contiguous, and each line of the region starts at a
+  // fixed offset from the previous one
+  InputSampleMatrixType matrix;
+  matrix.NumberOfFeatures = num_features;
+  matrix.NumberOfSamplesPerLine = outputRegionForThread.GetSize()[0];
+  matrix.NumberOfLines = nbPixels / matrix.NumberOfSamplesPerLine;
 
-  typename InputListSampleType::Pointer samples = InputListSampleType::New();
-  unsigned int num_features = inputPtr->GetNumberOfComponentsPerPixel();
-  samples->SetMeasurementVectorSize(num_features);
-  InputSampleType sample(num_features);
-  // Fill the samples
-  bool validPoint = true;
-  for (inIt.GoToBegin(); !inIt.IsAtEnd(); ++inIt)
+  std::vector<ValueType> copiedSamples;
+  const typename InputImageType::RegionType & bufferedRegion = inputPtr->GetBufferedRegion();
+  bool regularLines = true;
+  for (unsigned int dim = 2; dim < InputImageType::ImageDimension; ++dim)
     {
-    // Check pixel validity
-    if (inputMaskPtr)
-      {
-      validPoint = maskIt.Get() > 0;
-      ++maskIt;
-      }
-    if(validPoint)
+    regularLines = regularLines && (outputRegionForThread.GetSize()[dim] == 1);
+    }
+  if (regularLines)
+    {
+    matrix.Data = inputPtr->GetBufferPointer()
+      + inputPtr->ComputeOffset(outputRegionForThread.GetIndex()) * num_features;
+    matrix.LineStride = bufferedRegion.GetSize()[0] * num_features;
+    }
+  else
+    {
+    // Lines are not evenly spaced in the buffer: copy the region once
+    copiedSamples.resize(nbPixels * num_features);
+    InputIteratorType inIt(inputPtr, outputRegionForThread);
+    typename std::vector<ValueType>::iterator sampleIt = copiedSamples.begin();
+    for (inIt.GoToBegin(); !inIt.IsAtEnd(); ++inIt)
       {
       typename InputImageType::PixelType pix = inIt.Get();
-      for(size_t feat=0; feat<num_features; ++feat)
+      for(unsigned int feat=0; feat<num_features; ++feat, ++sampleIt)
         {
-        sample[feat]=pix[feat];
+        *sampleIt = pix[feat];
         }
-      samples->PushBack(sample);
       }
+    matrix.Data = &(copiedSamples[0]);
+    matrix.LineStride = matrix.NumberOfSamplesPerLine * num_features;
     }
-  //Make the batch prediction
-  typename TargetListSampleType::Pointer labels;
-  typename ConfidenceListSampleType::Pointer confidences;
+
+  // One mask value per sample
+  std::vector<unsigned char> maskValues;
+  if (inputMaskPtr)
+    {
+    maskValues.resize(nbPixels);
+    MaskIteratorType maskIt(inputMaskPtr, outputRegionForThread);
+    unsigned long id = 0;
+    for (maskIt.GoToBegin(); !maskIt.IsAtEnd(); ++maskIt, ++id)
+      {
+      maskValues[id] = (maskIt.Get() > 0);
+      }
+    matrix.Mask = &(maskValues[0]);
+    }
+
+  //Make the batch prediction. Masked samples keep the default values
+  std::vector<TargetValueType> labels(nbPixels, m_DefaultLabel);
+  std::vector<ConfidenceValueType> confidences;
   if(computeConfidenceMap)
-    confidences = ConfidenceListSampleType::New();
+    confidences.assign(nbPixels, 0.0);
 
   // This call is threadsafe
-  labels = m_Model->PredictBatch(samples,confidences);
+  m_Model->PredictMatrix(matrix, &(labels[0]), computeConfidenceMap ? &(confidences[0]) : ITK_NULLPTR);
 
   // Set the output values
+  OutputIteratorType outIt(outputPtr, outputRegionForThread);
   ConfidenceMapIteratorType confidenceIt;
   if (computeConfidenceMap)
     {
@@ -261,38 +283,14 @@ ImageClassificationFilter<TInputImage, TOutputImage, TMaskImage>
     confidenceIt.GoToBegin();
     }
 
-  typename TargetListSampleType::ConstIterator labIt = labels->Begin();
-  maskIt.GoToBegin();
-  for (outIt.GoToBegin(); !outIt.IsAtEnd(); ++outIt)
+  unsigned long id = 0;
+  for (outIt.GoToBegin(); !outIt.IsAtEnd(); ++outIt, ++id)
     {
-    double confidenceIndex = 0.0;
-    TargetValueType labelValue(m_DefaultLabel);
-    if (inputMaskPtr)
-      {
-      validPoint = maskIt.Get() > 0;
-      ++maskIt;
-      }
-    if (validPoint && labIt!=labels->End())
-      {
-      labelValue = labIt.GetMeasurementVector()[0];
-
-       if(computeConfidenceMap)
-        {
-        confidenceIndex = confidences->GetMeasurementVector(labIt.GetInstanceIdentifier())[0];
-        }
-       
-      ++labIt;    
-      }
-    else
-      {
-      labelValue = m_DefaultLabel;
-      }
-    
-    outIt.Set(labelValue);
+    outIt.Set(labels[id]);
 
     if(computeConfidenceMap)
       {
-      confidenceIt.Set(confidenceIndex);
+      confidenceIt.Set(confidences[id]);
       ++confidenceIt;
       }
     
@@ -98,6 +98,57 @@ public:
   typedef itk::FixedArray<ConfidenceValueType,1>            ConfidenceSampleType;
   typedef itk::Statistics::ListSample<ConfidenceSampleType> ConfidenceListSampleType;
 
+  /** \struct InputSampleMatrix
+   * \brief Non-owning view of samples stored in a contiguous buffer
+   *
+   * The features of a sample are contiguous. Samples are grouped in
+   * lines of NumberOfSamplesPerLine consecutive samples, and two
+   * successive lines are LineStride values apart. This layout matches
+   * the buffer of a region of a VectorImage. Samples are indexed line
+   * by line.
+   *
+   * If Mask is not null, it holds one value per sample and samples with
+   * a zero mask value are skipped.
+   */
+  struct InputSampleMatrix
+  {
+    InputSampleMatrix()
+      : Data(ITK_NULLPTR),
+        NumberOfSamplesPerLine(0),
+        NumberOfLines(0),
+        NumberOfFeatures(0),
+        LineStride(0),
+        Mask(ITK_NULLPTR)
+    {}
+
+    /** Number of samples in the view */
+    unsigned long GetNumberOfSamples() const
+    {
+      return NumberOfSamplesPerLine * NumberOfLines;
+    }
+
+    /** Pointer to the features of a sample */
+    const InputValueType * GetSample(unsigned long id) const
+    {
+      return Data + (id / NumberOfSamplesPerLine) * LineStride
+        + (id % NumberOfSamplesPerLine) * NumberOfFeatures;
+    }
+
+    /** Is the sample not masked */
+    bool IsValid(unsigned long id) const
+    {
+      return Mask == ITK_NULLPTR || Mask[id] != 0;
+    }
+
+    const InputValueType * Data;
+    unsigned long          NumberOfSamplesPerLine;
+    unsigned long          NumberOfLines;
+    unsigned int           NumberOfFeatures;
+    unsigned long          LineStride;
+    const unsigned char *  Mask;
+  };
+  typedef InputSampleMatrix InputSampleMatrixType;
+
   /**\name Standard macros */
   //@{
   /** Run-time type information (and related methods). */
@@ -126,6 +177,18 @@ public:
     * with OpenMP.
      */
   typename TargetListSampleType::Pointer PredictBatch(const InputListSampleType * input, ConfidenceListSampleType * quality = ITK_NULLPTR) const;
+
+  /** Predict a batch of samples stored in a contiguous buffer
+    * \param input View on the samples to predict
+    * \param targets Array of input.GetNumberOfSamples() labels to fill
+    * \param quality Array of input.GetNumberOfSamples() confidence
+    * values to fill, or NULL
+    * Entries of masked samples are left untouched. No copy of the
+    * samples is made unless the model needs its own input format.
+    * Note that this method will be multi-threaded if OTB is built
+    * with OpenMP.
+     */
+  void PredictMatrix(const InputSampleMatrixType & input, TargetValueType * targets, ConfidenceValueType * quality = ITK_NULLPTR) const;
   
   /**\name Classification model file manipulation */
   //@{
@@ -221,6 +284,21 @@ private:
     */
   virtual void DoPredictBatch(const InputListSampleType * input, const unsigned int & startIndex, const unsigned int & size, TargetListSampleType * target, ConfidenceListSampleType * quality = ITK_NULLPTR) const;
 
+  /**  Actual implementation of PredictMatrix
+    *  Default implementation wraps each sample of the view, without
+    *  copy, and calls DoPredict.
+    *  \param input View on the samples
+    *  \param startIndex Index of the first sample to predict
+    *  \param size Number of samples to predict
+    *  \param targets Array of labels, indexed like the samples
+    *  \param quality Array of confidence values, or NULL
+    *
+    * Override me if the internal model can predict directly from a
+    * buffer. Like DoPredictBatch, it is called from several threads
+    * unless m_IsDoPredictBatchMultiThreaded is true.
+    */
+  virtual void DoPredictMatrix(const InputSampleMatrixType & input, const unsigned long & startIndex, const unsigned long & size, TargetValueType * targets, ConfidenceValueType * quality = ITK_NULLPTR) const;
+
   /** Actual implementation of single sample prediction
    *  \param input sample to predict
    *  \param quality Pointer to a variable to store confidence value,
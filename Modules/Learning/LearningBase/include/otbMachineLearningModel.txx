@@ -167,6 +167,87 @@ MachineLearningModel<TInputValue,TOutputValue,TConfidenceValue>
     }
 }
 
+template <class TInputValue, class TOutputValue, class TConfidenceValue>
+void
+MachineLearningModel<TInputValue,TOutputValue,TConfidenceValue>
+::PredictMatrix(const InputSampleMatrixType & input, TargetValueType * targets, ConfidenceValueType * quality) const
+{
+  assert(targets != ITK_NULLPTR);
+
+  const unsigned long nbSamples = input.GetNumberOfSamples();
+  if (nbSamples == 0)
+    {
+    return;
+    }
+  if (input.Data == ITK_NULLPTR)
+    {
+    itkExceptionMacro(<<"Null data pointer in sample matrix");
+    }
+
+  if(m_IsDoPredictBatchMultiThreaded)
+    {
+    this->DoPredictMatrix(input,0,nbSamples,targets,quality);
+    return;
+    }
+
+  #ifdef _OPENMP
+  unsigned int nb_threads(0), threadId(0);
+  unsigned long nb_batches(0);
+
+  #pragma omp parallel shared(nb_threads,nb_batches) private(threadId)
+  {
+  omp_set_num_threads(itk::MultiThreader::GetGlobalDefaultNumberOfThreads());
+  nb_threads = omp_get_num_threads();
+  threadId = omp_get_thread_num();
+  nb_batches = std::min(static_cast<unsigned long>(nb_threads),nbSamples);
+  if(threadId<nb_batches)
+    {
+    unsigned long batch_size = nbSamples/nb_batches;
+    unsigned long batch_start = threadId*batch_size;
+    if(threadId == nb_batches-1)
+      {
+      batch_size+=nbSamples%nb_batches;
+      }
+    this->DoPredictMatrix(input,batch_start,batch_size,targets,quality);
+    }
+  }
+  #else
+  this->DoPredictMatrix(input,0,nbSamples,targets,quality);
+  #endif
+}
+
+template <class TInputValue, class TOutputValue, class TConfidenceValue>
+void
+MachineLearningModel<TInputValue,TOutputValue,TConfidenceValue>
+::DoPredictMatrix(const InputSampleMatrixType & input, const unsigned long & startIndex, const unsigned long & size, TargetValueType * targets, ConfidenceValueType * quality) const
+{
+  if(startIndex+size>input.GetNumberOfSamples())
+    {
+    itkExceptionMacro(<<"requested range ["<<startIndex<<", "<<startIndex+size<<"[ partially outside sample matrix range.[0,"<<input.GetNumberOfSamples()<<"[");
+    }
+
+  // The sample does not own its data: it points to the matrix buffer
+  InputSampleType sample;
+  for(unsigned long id = startIndex;id<startIndex+size;++id)
+    {
+    if(!input.IsValid(id))
+      {
+      continue;
+      }
+    sample.SetData(const_cast<InputValueType *>(input.GetSample(id)),input.NumberOfFeatures,false);
+    if(quality != ITK_NULLPTR)
+      {
+      ConfidenceValueType confidence = 0;
+      targets[id] = this->DoPredict(sample,&confidence)[0];
+      quality[id] = confidence;
+      }
+    else
+      {
+      targets[id] = this->DoPredict(sample)[0];
+      }
+    }
+}
+
 template <class TInputValue, class TOutputValue, class TConfidenceValue>
 void
 MachineLearningModel<TInputValue,TOutputValue,TConfidenceValue>
@@ -72,6 +72,15 @@ public:
 
   virtual bool Compute(double deltaEnergy) = 0;
 
+  /** Create a new optimizer with the same parameters, which can be used
+   * concurrently with this one. Random optimizers use their own generator,
+   * initialized with the given seed. Returns a null pointer if the
+   * optimizer does not support it. */
+  virtual Pointer CreateCopy(unsigned int itkNotUsed(seed)) const
+  {
+    return ITK_NULLPTR;
+  }
+
 protected:
   MRFOptimizer() :
     m_NumberOfParameters(1),
@@ -64,6 +64,14 @@ public:
       }
   }
 
+  Superclass::Pointer CreateCopy(unsigned int itkNotUsed(seed)) const ITK_OVERRIDE
+  {
+    Pointer copy = Self::New();
+    copy->m_NumberOfParameters = this->m_NumberOfParameters;
+    copy->m_Parameters = this->m_Parameters;
+    return copy.GetPointer();
+  }
+
 protected:
   MRFOptimizerICM() {}
   ~MRFOptimizerICM() ITK_OVERRIDE {}
@@ -93,6 +93,15 @@ public:
     return false;
   }
 
+  Superclass::Pointer CreateCopy(unsigned int seed) const ITK_OVERRIDE
+  {
+    Pointer copy = Self::New();
+    copy->m_Parameters = this->m_Parameters;
+    copy->m_Generator = RandomGeneratorType::New();
+    copy->m_Generator->SetSeed(seed);
+    return copy.GetPointer();
+  }
+
   /** Methods to cancel random effects.*/
   void InitializeSeed(int seed)
   {
@@ -85,6 +85,15 @@ public:
   virtual int Compute(const InputImageNeighborhoodIterator& itData,
                       const LabelledImageNeighborhoodIterator& itRegul) = 0;
 
+  /** Create a new sampler with the same settings and energies, which can
+   * be used concurrently with this one. Random samplers use their own
+   * generator, initialized with the given seed. Returns a null pointer if
+   * the sampler does not support it. */
+  virtual Pointer CreateCopy(unsigned int itkNotUsed(seed)) const
+  {
+    return ITK_NULLPTR;
+  }
+
 protected:
   unsigned int m_NumberOfClasses;
   double       m_EnergyBefore;
@@ -99,6 +108,15 @@ protected:
   LabelledImagePixelType      m_ValueCurrent;
 
 protected:
+  /** Copy the settings and the energies of another sampler */
+  void CopySettings(const Self * other)
+  {
+    this->SetNumberOfClasses(other->m_NumberOfClasses);
+    m_Lambda = other->m_Lambda;
+    m_EnergyRegularization = other->m_EnergyRegularization;
+    m_EnergyFidelity = other->m_EnergyFidelity;
+  }
+
   // The constructor and destructor.
   MRFSampler() :
     m_NumberOfClasses(1),
@@ -100,6 +100,13 @@ public:
     return 0;
   }
 
+  typename Superclass::Pointer CreateCopy(unsigned int itkNotUsed(seed)) const ITK_OVERRIDE
+  {
+    Pointer copy = Self::New();
+    copy->CopySettings(this);
+    return copy.GetPointer();
+  }
+
 protected:
   // The constructor and destructor.
   MRFSamplerMAP() {};
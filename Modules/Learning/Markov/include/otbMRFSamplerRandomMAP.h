@@ -146,6 +146,15 @@ public:
     return 0;
   }
 
+  typename Superclass::Pointer CreateCopy(unsigned int seed) const ITK_OVERRIDE
+  {
+    Pointer copy = Self::New();
+    copy->CopySettings(this);
+    copy->m_Generator = RandomGeneratorType::New();
+    copy->m_Generator->SetSeed(seed);
+    return copy.GetPointer();
+  }
+
   /** Methods to cancel random effects.*/
   void InitializeSeed(int seed)
   {
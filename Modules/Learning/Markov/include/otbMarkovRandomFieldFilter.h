@@ -33,6 +33,7 @@
 #include "itkNeighborhoodAlgorithm.h"
 #include "itkNeighborhood.h"
 #include "itkSize.h"
+#include "itkMultiThreader.h"
 #include "otbMRFOptimizer.h"
 #include "otbMRFSampler.h"
 
@@ -69,6 +70,30 @@ namespace otb
  *   markovFilter->SetSampler(sampler);
  * \endcode
  *
+ * By default, the pixels are visited in raster order at each iteration. If
+ * ParallelSweep is On, the image grid is coloured so that two pixels of the
+ * same colour never lie in the neighborhood of each other: the colour of a
+ * pixel is given by its index modulo (radius+1) along each dimension (this
+ * is the red-black checkerboard generalized to the neighborhood radius, 4
+ * colours for a radius of 1 in 2D). The colours are processed one after the
+ * other, and the pixels of a colour are updated concurrently by the threads
+ * of the filter, each thread using its own copy of the sampler and of the
+ * optimizer (see MRFSampler::CreateCopy() and MRFOptimizer::CreateCopy()).
+ * With deterministic samplers and optimizers (MAP, ICM), the result does
+ * not depend on the number of threads.
+ *
+ * By default, the whole image is processed at once. If StreamingMode is On,
+ * the filter only processes the requested region, enlarged by a halo of
+ * HaloSize pixels. The halo is taken into account during the iterations and
+ * dropped in the output. With the parallel sweep, the default halo is
+ * large enough for the streamed output to be the same as the whole image
+ * output, provided that the sampler and the optimizer are deterministic
+ * (MAP and ICM), that the initial labels come from the training input and
+ * that the error tolerance is 0 (so that every tile runs the same number of
+ * iterations). Otherwise, the regularization is an approximation of the
+ * global one near the borders of the streaming tiles, which gets better as
+ * the halo grows.
+ *
  *
  * \ingroup Markov
  *
@@ -292,6 +317,27 @@ public:
   /** Get macro for number of iterations */
   itkGetConstReferenceMacro(NumberOfIterations, unsigned int);
 
+  /** Set/Get the parallel sweep mode: pixels are updated colour by colour,
+   * each colour being processed by several threads. Default is false. */
+  itkSetMacro(ParallelSweep, bool);
+  itkGetMacro(ParallelSweep, bool);
+  itkBooleanMacro(ParallelSweep);
+
+  /** Set/Get the streaming mode: only the requested region, enlarged by
+   * the halo, is processed. Default is false (whole image). */
+  itkSetMacro(StreamingMode, bool);
+  itkGetMacro(StreamingMode, bool);
+  itkBooleanMacro(StreamingMode);
+
+  /** Set/Get the size of the halo used in streaming mode, in pixels. If 0
+   * (default), the halo along each dimension is the input neighborhood
+   * radius plus the labelled neighborhood radius times the number of
+   * colours of the parallel sweep times the maximum number of iterations:
+   * labels further from the border of the processed region can not be
+   * influenced by it. */
+  itkSetMacro(HaloSize, unsigned int);
+  itkGetMacro(HaloSize, unsigned int);
+
 #ifdef ITK_USE_CONCEPT_CHECKING
   /** Begin concept checking */
   itkConceptMacro(UnsignedIntConvertibleToClassifiedCheck,
@@ -383,6 +429,42 @@ protected:
 
   virtual void MinimizeOnce();
 
+  /** Apply the MRF once on the whole image, colour by colour, with
+   * several threads */
+  virtual void MinimizeOnceParallel();
+
+  /** Update the pixels of a colour in a region, with the sampler and the
+   * optimizer of a thread */
+  void MinimizeColour(unsigned int colour, const LabelledImageRegionType& region, itk::ThreadIdType threadId);
+
+  /** Compute the region processed by the filter: the output requested
+   * region, enlarged by the halo in streaming mode */
+  LabelledImageRegionType ComputeProcessedRegion() const;
+
+  /** Static function used as a "callback" by the MultiThreader */
+  static ITK_THREAD_RETURN_TYPE ColourThreaderCallback(void *arg);
+
+  /** Internal structure used for passing the filter to the threading library */
+  struct ColourThreadStruct
+  {
+    Self *       Filter;
+    unsigned int Colour;
+  };
+
+  bool         m_ParallelSweep;
+  bool         m_StreamingMode;
+  unsigned int m_HaloSize;
+
+  /** Image on which the MRF is applied: the output itself, or the
+   * requested region and its halo in streaming mode */
+  LabelledImagePointer m_LabelledImage;
+
+  /** Per-thread samplers, optimizers and counters of the parallel sweep */
+  std::vector<SamplerPointer>   m_ThreadSamplers;
+  std::vector<OptimizerPointer> m_ThreadOptimizers;
+  std::vector<int>              m_ThreadErrorCounter;
+  std::vector<double>           m_ThreadDeltaEnergy;
+
 private:
 
 }; // class MarkovRandomFieldFilter
@@ -40,7 +40,10 @@ MarkovRandomFieldFilter<TInputImage, TClassifiedImage>
   m_NumberOfIterations(0),
   m_Lambda(1.0),
   m_ExternalClassificationSet(false),
-  m_StopCondition(MaximumNumberOfIterations)
+  m_StopCondition(MaximumNumberOfIterations),
+  m_ParallelSweep(false),
+  m_StreamingMode(false),
+  m_HaloSize(0)
 {
   m_Generator = RandomGeneratorType::GetInstance();
   m_Generator->SetSeed();
@@ -116,6 +119,15 @@ MarkovRandomFieldFilter<TInputImage, TClassifiedImage>
 
   os << indent << " Lambda: " <<
   m_Lambda << std::endl;
+
+  os << indent << " Parallel sweep: " <<
+  m_ParallelSweep << std::endl;
+
+  os << indent << " Streaming mode: " <<
+  m_StreamingMode << std::endl;
+
+  os << indent << " Halo size: " <<
+  m_HaloSize << std::endl;
 } // end PrintSelf
 
 /**
@@ -127,11 +139,51 @@ MarkovRandomFieldFilter<TInputImage, TClassifiedImage>
 ::GenerateInputRequestedRegion()
 {
   // this filter requires the all of the input images
-  // to be at the size of the output requested region
+  // to be at the size of the output requested region (enlarged by
+  // the halo in streaming mode)
   InputImagePointer inputPtr =
     const_cast<InputImageType *>(this->GetInput());
-  OutputImagePointer outputPtr = this->GetOutput();
-  inputPtr->SetRequestedRegion(outputPtr->GetRequestedRegion());
+  const LabelledImageRegionType region = this->ComputeProcessedRegion();
+  inputPtr->SetRequestedRegion(region);
+
+  if (m_StreamingMode && m_ExternalClassificationSet)
+    {
+    TrainingImageType * trainingPtr =
+      const_cast<TrainingImageType *>(this->GetTrainingInput());
+    trainingPtr->SetRequestedRegion(region);
+    }
+}
+
+/**
+ * Compute the region processed by the filter.
+ */
+template <class TInputImage, class TClassifiedImage>
+typename MarkovRandomFieldFilter<TInputImage, TClassifiedImage>::LabelledImageRegionType
+MarkovRandomFieldFilter<TInputImage, TClassifiedImage>
+::ComputeProcessedRegion() const
+{
+  LabelledImageRegionType region = this->GetOutput()->GetRequestedRegion();
+  if (m_StreamingMode)
+    {
+    // Pixels whose input neighborhood crosses the border of the processed
+    // region get a wrong fidelity energy, and each colour of the parallel
+    // sweep moves the wrong labels inwards by at most the labelled radius
+    unsigned long numberOfColours = 1;
+    for (unsigned int i = 0; i < InputImageDimension; ++i)
+      {
+      numberOfColours *= m_LabelledImageNeighborhoodRadius[i] + 1;
+      }
+    NeighborhoodRadiusType halo;
+    for (unsigned int i = 0; i < InputImageDimension; ++i)
+      {
+      halo[i] = (m_HaloSize > 0 ? m_HaloSize
+                 : m_InputImageNeighborhoodRadius[i]
+                 + numberOfColours * m_LabelledImageNeighborhoodRadius[i] * m_MaximumNumberOfIterations);
+      }
+    region.PadByRadius(halo);
+    region.Crop(this->GetOutput()->GetLargestPossibleRegion());
+    }
+  return region;
 }
 
 /**
@@ -143,10 +195,13 @@ MarkovRandomFieldFilter<TInputImage, TClassifiedImage>
 ::EnlargeOutputRequestedRegion(itk::DataObject *output)
 {
   // this filter requires the all of the output image to be in
-  // the buffer
-  TClassifiedImage *imgData;
-  imgData = dynamic_cast<TClassifiedImage*>(output);
-  imgData->SetRequestedRegionToLargestPossibleRegion();
+  // the buffer, unless it works in streaming mode
+  if (!m_StreamingMode)
+    {
+    TClassifiedImage *imgData;
+    imgData = dynamic_cast<TClassifiedImage*>(output);
+    imgData->SetRequestedRegionToLargestPossibleRegion();
+    }
 }
 
 /**
@@ -179,6 +234,26 @@ MarkovRandomFieldFilter<TInputImage, TClassifiedImage>
   //Run the Markov random field
   this->ApplyMarkovRandomFieldFilter();
 
+  //Drop the halo
+  if (m_StreamingMode)
+    {
+    LabelledImagePointer outputPtr = this->GetOutput();
+    LabelledImageRegionConstIterator
+    labelledImageIt(m_LabelledImage, outputPtr->GetRequestedRegion());
+    LabelledImageRegionIterator
+    outImageIt(outputPtr, outputPtr->GetRequestedRegion());
+    for (labelledImageIt.GoToBegin(), outImageIt.GoToBegin();
+         !outImageIt.IsAtEnd();
+         ++labelledImageIt, ++outImageIt)
+      {
+      outImageIt.Set(labelledImageIt.Get());
+      }
+    }
+
+  m_LabelledImage = ITK_NULLPTR;
+  m_ThreadSamplers.clear();
+  m_ThreadOptimizers.clear();
+
 } // end GenerateData
 
 /**
@@ -255,16 +330,32 @@ MarkovRandomFieldFilter<TInputImage, TClassifiedImage>
   outputPtr->SetBufferedRegion(outputPtr->GetRequestedRegion());
   outputPtr->Allocate();
 
+  //In streaming mode, the MRF is applied on a separate image holding
+  //the requested region and its halo
+  if (m_StreamingMode)
+    {
+    const LabelledImageRegionType region = this->ComputeProcessedRegion();
+    m_LabelledImage = TClassifiedImage::New();
+    m_LabelledImage->CopyInformation(outputPtr);
+    m_LabelledImage->SetBufferedRegion(region);
+    m_LabelledImage->SetRequestedRegion(region);
+    m_LabelledImage->Allocate();
+    }
+  else
+    {
+    m_LabelledImage = outputPtr;
+    }
+
   //Copy input data in the output buffer memory or
   //initialize to random values if not set
   LabelledImageRegionIterator
-  outImageIt(outputPtr, outputPtr->GetRequestedRegion());
+  outImageIt(m_LabelledImage, m_LabelledImage->GetBufferedRegion());
 
   if (m_ExternalClassificationSet)
     {
     typename TrainingImageType::ConstPointer trainingImage = this->GetTrainingInput();
     LabelledImageRegionConstIterator
-    trainingImageIt(trainingImage, outputPtr->GetRequestedRegion());
+    trainingImageIt(trainingImage, m_LabelledImage->GetBufferedRegion());
 
     while (!outImageIt.IsAtEnd())
       {
@@ -365,12 +456,48 @@ MarkovRandomFieldFilter<TInputImage, TClassifiedImage>
   m_NumberOfIterations = 0;
   m_ErrorCounter = m_TotalNumberOfValidPixelsInOutputImage;
 
+  if (m_ParallelSweep)
+    {
+    // Draw all the seeds before creating the copies, whose constructors
+    // may reset the global random generator
+    const unsigned int numberOfThreads = this->GetNumberOfThreads();
+    std::vector<unsigned int> seeds(2 * numberOfThreads);
+    for (unsigned int i = 0; i < seeds.size(); ++i)
+      {
+      seeds[i] = m_Generator->GetIntegerVariate();
+      }
+
+    m_ThreadSamplers.resize(numberOfThreads);
+    m_ThreadOptimizers.resize(numberOfThreads);
+    bool copiesAvailable = true;
+    for (unsigned int i = 0; i < numberOfThreads && copiesAvailable; ++i)
+      {
+      m_ThreadSamplers[i] = m_Sampler->CreateCopy(seeds[2 * i]);
+      m_ThreadOptimizers[i] = m_Optimizer->CreateCopy(seeds[2 * i + 1]);
+      copiesAvailable = m_ThreadSamplers[i].IsNotNull() && m_ThreadOptimizers[i].IsNotNull();
+      }
+
+    if (!copiesAvailable)
+      {
+      itkWarningMacro(<< "The sampler or the optimizer can not be copied, the parallel sweep uses a single thread.");
+      m_ThreadSamplers.assign(1, m_Sampler);
+      m_ThreadOptimizers.assign(1, m_Optimizer);
+      }
+    }
+
   while ((m_NumberOfIterations < m_MaximumNumberOfIterations) &&
          (m_ErrorCounter >= maxNumPixelError))
     {
     otbMsgDevMacro(<< "Iteration No." << m_NumberOfIterations);
 
-    this->MinimizeOnce();
+    if (m_ParallelSweep)
+      {
+      this->MinimizeOnceParallel();
+      }
+    else
+      {
+      this->MinimizeOnce();
+      }
 
     otbMsgDevMacro(<< "m_ErrorCounter/m_TotalNumberOfPixelsInInputImage: "
                    << m_ErrorCounter / ((double) (m_TotalNumberOfPixelsInInputImage)));
@@ -406,11 +533,11 @@ MarkovRandomFieldFilter<TInputImage, TClassifiedImage>
 ::MinimizeOnce()
 {
   LabelledImageNeighborhoodIterator
-  labelledIterator(m_LabelledImageNeighborhoodRadius, this->GetOutput(),
-                   this->GetOutput()->GetLargestPossibleRegion());
+  labelledIterator(m_LabelledImageNeighborhoodRadius, m_LabelledImage,
+                   m_LabelledImage->GetBufferedRegion());
   InputImageNeighborhoodIterator
   dataIterator(m_InputImageNeighborhoodRadius, this->GetInput(),
-               this->GetInput()->GetLargestPossibleRegion());
+               m_LabelledImage->GetBufferedRegion());
   m_ErrorCounter = 0;
 
   for (labelledIterator.GoToBegin(), dataIterator.GoToBegin();
@@ -433,6 +560,150 @@ MarkovRandomFieldFilter<TInputImage, TClassifiedImage>
 
 }
 
+/**
+*Apply the MRF image filter on the whole image once, colour by colour
+*/
+template<class TInputImage, class TClassifiedImage>
+void
+MarkovRandomFieldFilter<TInputImage, TClassifiedImage>
+::MinimizeOnceParallel()
+{
+  // Two pixels whose indexes are equal modulo (radius+1) along each
+  // dimension are never in the neighborhood of each other
+  unsigned int numberOfColours = 1;
+  for (unsigned int i = 0; i < InputImageDimension; ++i)
+    {
+    numberOfColours *= m_LabelledImageNeighborhoodRadius[i] + 1;
+    }
+
+  const unsigned int numberOfThreads = static_cast<unsigned int>(m_ThreadSamplers.size());
+  m_ThreadErrorCounter.assign(numberOfThreads, 0);
+  m_ThreadDeltaEnergy.assign(numberOfThreads, 0.0);
+
+  ColourThreadStruct str;
+  str.Filter = this;
+
+  this->GetMultiThreader()->SetNumberOfThreads(numberOfThreads);
+  this->GetMultiThreader()->SetSingleMethod(this->ColourThreaderCallback, &str);
+
+  for (unsigned int colour = 0; colour < numberOfColours; ++colour)
+    {
+    str.Colour = colour;
+    this->GetMultiThreader()->SingleMethodExecute();
+    }
+
+  m_ErrorCounter = 0;
+  for (unsigned int i = 0; i < numberOfThreads; ++i)
+    {
+    m_ErrorCounter += m_ThreadErrorCounter[i];
+    m_ImageDeltaEnergy += m_ThreadDeltaEnergy[i];
+    }
+}
+
+template<class TInputImage, class TClassifiedImage>
+ITK_THREAD_RETURN_TYPE
+MarkovRandomFieldFilter<TInputImage, TClassifiedImage>
+::ColourThreaderCallback(void *arg)
+{
+  itk::MultiThreader::ThreadInfoStruct * info = (itk::MultiThreader::ThreadInfoStruct *) arg;
+  ColourThreadStruct * str = (ColourThreadStruct *) info->UserData;
+  const itk::ThreadIdType threadId = info->ThreadID;
+  const itk::ThreadIdType threadCount = info->NumberOfThreads;
+
+  // Split the processed region along its last dimension
+  const LabelledImageRegionType bufferedRegion = str->Filter->m_LabelledImage->GetBufferedRegion();
+  const unsigned int splitAxis = ClassifiedImageDimension - 1;
+  const itk::SizeValueType splitSize = bufferedRegion.GetSize()[splitAxis];
+  const itk::SizeValueType begin = splitSize * threadId / threadCount;
+  const itk::SizeValueType end = splitSize * (threadId + 1) / threadCount;
+
+  if (begin < end)
+    {
+    LabelledImageIndexType index = bufferedRegion.GetIndex();
+    SizeType               size = bufferedRegion.GetSize();
+    index[splitAxis] += static_cast<IndexValueType>(begin);
+    size[splitAxis] = end - begin;
+    LabelledImageRegionType region(index, size);
+
+    str->Filter->MinimizeColour(str->Colour, region, threadId);
+    }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template<class TInputImage, class TClassifiedImage>
+void
+MarkovRandomFieldFilter<TInputImage, TClassifiedImage>
+::MinimizeColour(unsigned int colour, const LabelledImageRegionType& region, itk::ThreadIdType threadId)
+{
+  SamplerType *   sampler = m_ThreadSamplers[threadId];
+  OptimizerType * optimizer = m_ThreadOptimizers[threadId];
+
+  // First pixel of the colour in the region, and step between two pixels
+  // of the colour
+  LabelledImageIndexType first;
+  LabelledImageIndexType last;
+  LabelledImageIndexType step;
+  unsigned int remainder = colour;
+  for (unsigned int i = 0; i < InputImageDimension; ++i)
+    {
+    step[i] = static_cast<IndexValueType>(m_LabelledImageNeighborhoodRadius[i]) + 1;
+    const IndexValueType residue = static_cast<IndexValueType>(remainder) % step[i];
+    remainder /= static_cast<unsigned int>(step[i]);
+
+    const IndexValueType start = region.GetIndex()[i];
+    first[i] = start + ((residue - start) % step[i] + step[i]) % step[i];
+    last[i] = start + static_cast<IndexValueType>(region.GetSize()[i]) - 1;
+    if (first[i] > last[i])
+      {
+      return;
+      }
+    }
+
+  LabelledImageNeighborhoodIterator
+  labelledIterator(m_LabelledImageNeighborhoodRadius, m_LabelledImage, region);
+  InputImageNeighborhoodIterator
+  dataIterator(m_InputImageNeighborhoodRadius, this->GetInput(), region);
+
+  int    errorCounter = 0;
+  double deltaEnergy = 0.0;
+
+  LabelledImageIndexType index = first;
+  bool                   done = false;
+  while (!done)
+    {
+    labelledIterator.SetLocation(index);
+    dataIterator.SetLocation(index);
+
+    sampler->Compute(dataIterator, labelledIterator);
+    LabelledImagePixelType value = sampler->GetValue();
+    if (optimizer->Compute(sampler->GetDeltaEnergy()))
+      {
+      labelledIterator.SetCenterPixel(value);
+      ++errorCounter;
+      deltaEnergy += sampler->GetDeltaEnergy();
+      }
+
+    // Next pixel of the colour
+    done = true;
+    for (unsigned int i = 0; i < InputImageDimension && done; ++i)
+      {
+      index[i] += step[i];
+      if (index[i] <= last[i])
+        {
+        done = false;
+        }
+      else
+        {
+        index[i] = first[i];
+        }
+      }
+    }
+
+  m_ThreadErrorCounter[threadId] += errorCounter;
+  m_ThreadDeltaEnergy[threadId] += deltaEnergy;
+}
+
 } // namespace otb
 
 #endif
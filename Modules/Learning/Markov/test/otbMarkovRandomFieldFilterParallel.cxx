@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "otbImageFileReader.h"
+#include "otbImageFileWriter.h"
+#include "otbImage.h"
+#include "otbMarkovRandomFieldFilter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+#include "itkMath.h"
+#include <algorithm>
+
+#include "otbMRFEnergyPotts.h"
+#include "otbMRFEnergyGaussianClassification.h"
+#include "otbMRFOptimizerICM.h"
+#include "otbMRFSamplerMAP.h"
+
+typedef otb::Image<double, 2>        MarkovInputImageType;
+typedef otb::Image<unsigned char, 2> MarkovLabelledImageType;
+
+typedef otb::MarkovRandomFieldFilter<MarkovInputImageType, MarkovLabelledImageType> MarkovFilterType;
+
+static MarkovFilterType::Pointer CreateMarkovFilter(MarkovInputImageType * input, double lambda, unsigned int nbIterations)
+{
+  typedef otb::MRFSamplerMAP<MarkovInputImageType, MarkovLabelledImageType>                   SamplerType;
+  typedef otb::MRFOptimizerICM                                                                OptimizerType;
+  typedef otb::MRFEnergyPotts<MarkovLabelledImageType, MarkovLabelledImageType>               EnergyRegularizationType;
+  typedef otb::MRFEnergyGaussianClassification<MarkovInputImageType, MarkovLabelledImageType> EnergyFidelityType;
+
+  MarkovFilterType::Pointer         markovFilter         = MarkovFilterType::New();
+  EnergyRegularizationType::Pointer energyRegularization = EnergyRegularizationType::New();
+  EnergyFidelityType::Pointer       energyFidelity       = EnergyFidelityType::New();
+  OptimizerType::Pointer            optimizer            = OptimizerType::New();
+  SamplerType::Pointer              sampler              = SamplerType::New();
+
+  unsigned int nClass = 4;
+  energyFidelity->SetNumberOfParameters(2 * nClass);
+  EnergyFidelityType::ParametersType parameters;
+  parameters.SetSize(energyFidelity->GetNumberOfParameters());
+  parameters[0] = 10.0; //Class 0 mean
+  parameters[1] = 10.0; //Class 0 stdev
+  parameters[2] = 80.0; //Class 1 mean
+  parameters[3] = 10.0; //Class 1 stdev
+  parameters[4] = 150.0; //Class 2 mean
+  parameters[5] = 10.0; //Class 2 stdev
+  parameters[6] = 220.0; //Class 3 mean
+  parameters[7] = 10.0; //Class 3 stde
+  energyFidelity->SetParameters(parameters);
+
+  markovFilter->InitializeSeed(2);
+  markovFilter->SetNumberOfClasses(nClass);
+  markovFilter->SetMaximumNumberOfIterations(nbIterations);
+  markovFilter->SetErrorTolerance(0.0);
+  markovFilter->SetLambda(lambda);
+  markovFilter->SetNeighborhoodRadius(1);
+
+  markovFilter->SetEnergyRegularization(energyRegularization);
+  markovFilter->SetEnergyFidelity(energyFidelity);
+  markovFilter->SetOptimizer(optimizer);
+  markovFilter->SetSampler(sampler);
+  markovFilter->SetInput(input);
+  markovFilter->ParallelSweepOn();
+
+  return markovFilter;
+}
+
+int otbMarkovRandomFieldFilterParallel(int itkNotUsed(argc), char* argv[])
+{
+  typedef otb::ImageFileReader<MarkovInputImageType>    ReaderType;
+  typedef otb::ImageFileWriter<MarkovLabelledImageType> WriterType;
+
+  const char * inputFilename  = argv[1];
+  const char * outputFilename = argv[2];
+  const double lambda = atof(argv[3]);
+  const unsigned int nbIterations = atoi(argv[4]);
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName(inputFilename);
+  reader->Update();
+
+  // With MAP and ICM, the parallel sweep does not depend on the number of threads
+  MarkovFilterType::Pointer singleThreadFilter = CreateMarkovFilter(reader->GetOutput(), lambda, nbIterations);
+  singleThreadFilter->SetNumberOfThreads(1);
+  singleThreadFilter->Update();
+
+  MarkovFilterType::Pointer multiThreadFilter = CreateMarkovFilter(reader->GetOutput(), lambda, nbIterations);
+  multiThreadFilter->SetNumberOfThreads(4);
+  multiThreadFilter->Update();
+
+  typedef itk::ImageRegionConstIterator<MarkovLabelledImageType> IteratorType;
+  IteratorType singleIt(singleThreadFilter->GetOutput(), singleThreadFilter->GetOutput()->GetLargestPossibleRegion());
+  IteratorType multiIt(multiThreadFilter->GetOutput(), multiThreadFilter->GetOutput()->GetLargestPossibleRegion());
+  unsigned long nbDifferences = 0;
+  for (singleIt.GoToBegin(), multiIt.GoToBegin(); !singleIt.IsAtEnd(); ++singleIt, ++multiIt)
+    {
+    if (singleIt.Get() != multiIt.Get())
+      {
+      ++nbDifferences;
+      }
+    }
+  if (nbDifferences > 0)
+    {
+    std::cerr << nbDifferences << " pixels differ between the single and multi-threaded parallel sweeps" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Streamed regularization with the default halo: with deterministic
+  // initial labels, it must give the whole image regularization
+  MarkovLabelledImageType::Pointer initialLabels = MarkovLabelledImageType::New();
+  initialLabels->CopyInformation(reader->GetOutput());
+  initialLabels->SetRegions(reader->GetOutput()->GetLargestPossibleRegion());
+  initialLabels->Allocate();
+  itk::ImageRegionConstIterator<MarkovInputImageType> inputIt(reader->GetOutput(), reader->GetOutput()->GetLargestPossibleRegion());
+  itk::ImageRegionIterator<MarkovLabelledImageType> initialIt(initialLabels, initialLabels->GetLargestPossibleRegion());
+  for (inputIt.GoToBegin(), initialIt.GoToBegin(); !inputIt.IsAtEnd(); ++inputIt, ++initialIt)
+    {
+    // nearest class mean (10, 80, 150, 220)
+    const double value = std::min(std::max(inputIt.Get(), 10.0), 220.0);
+    initialIt.Set(static_cast<unsigned char>(itk::Math::Round<int, double>((value - 10.0) / 70.0)));
+    }
+
+  MarkovFilterType::Pointer wholeFilter = CreateMarkovFilter(reader->GetOutput(), lambda, nbIterations);
+  wholeFilter->SetTrainingInput(initialLabels);
+  wholeFilter->Update();
+
+  MarkovFilterType::Pointer streamingFilter = CreateMarkovFilter(reader->GetOutput(), lambda, nbIterations);
+  streamingFilter->SetTrainingInput(initialLabels);
+  streamingFilter->StreamingModeOn();
+
+  WriterType::Pointer writer = WriterType::New();
+  writer->SetFileName(outputFilename);
+  writer->SetInput(streamingFilter->GetOutput());
+  writer->SetNumberOfDivisionsStrippedStreaming(4);
+  writer->Update();
+
+  ReaderType::Pointer streamedReader = ReaderType::New();
+  streamedReader->SetFileName(outputFilename);
+  streamedReader->Update();
+
+  IteratorType wholeIt(wholeFilter->GetOutput(), wholeFilter->GetOutput()->GetLargestPossibleRegion());
+  itk::ImageRegionConstIterator<MarkovInputImageType> streamedIt(streamedReader->GetOutput(),
+                                                                 streamedReader->GetOutput()->GetLargestPossibleRegion());
+  nbDifferences = 0;
+  for (wholeIt.GoToBegin(), streamedIt.GoToBegin(); !wholeIt.IsAtEnd(); ++wholeIt, ++streamedIt)
+    {
+    if (static_cast<double>(wholeIt.Get()) != streamedIt.Get())
+      {
+      ++nbDifferences;
+      }
+    }
+  if (nbDifferences > 0)
+    {
+    std::cerr << nbDifferences << " pixels differ between the streamed and the whole image regularizations" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
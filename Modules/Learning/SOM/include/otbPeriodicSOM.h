@@ -115,6 +115,12 @@ protected:
   */
   void UpdateMap(const NeuronType& sample, double beta, SizeType& radius) ITK_OVERRIDE;
   /**
+  * Get the neurons to update around a winner, in an elliptic neighborhood
+  * wrapped around the map borders.
+  */
+  void GetNeighborhood(const IndexType& position, const SizeType& radius,
+                       std::vector<IndexType>& neighbors, std::vector<double>& weights) ITK_OVERRIDE;
+  /**
   * Step one iteration.
   */
   void Step(unsigned int currentIteration) ITK_OVERRIDE
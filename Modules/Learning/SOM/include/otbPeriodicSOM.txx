@@ -105,6 +105,64 @@ PeriodicSOM<TListSample, TMap, TSOMLearningBehaviorFunctor, TSOMNeighborhoodBeha
 
 }
 
+/**
+ * Get the neurons to update around a winner, with their weight.
+ */
+template <class TListSample, class TMap,
+    class TSOMLearningBehaviorFunctor,
+    class TSOMNeighborhoodBehaviorFunctor>
+void
+PeriodicSOM<TListSample, TMap, TSOMLearningBehaviorFunctor, TSOMNeighborhoodBehaviorFunctor>
+::GetNeighborhood(const IndexType& position, const SizeType& radius,
+                  std::vector<IndexType>& neighbors, std::vector<double>& weights)
+{
+  unsigned int j;
+
+  neighbors.clear();
+  weights.clear();
+
+  SizeType mapSize = this->GetOutput(0)->GetLargestPossibleRegion().GetSize();
+  IndexType positionToUpdate;
+
+  // Walk through the offsets of the neighborhood, first dimension first
+  unsigned long nbOffsets = 1;
+  for (j = 0; j < MapType::ImageDimension; ++j)
+    {
+    nbOffsets *= 2 * radius[j] + 1;
+    }
+
+  for (unsigned long n = 0; n < nbOffsets; ++n)
+    {
+    long offset[MapType::ImageDimension];
+    unsigned long rest = n;
+    for (j = 0; j < MapType::ImageDimension; ++j)
+      {
+      const unsigned long width = 2 * radius[j] + 1;
+      offset[j] = static_cast<long>(rest % width) - static_cast<long>(radius[j]);
+      rest /= width;
+      }
+
+    // The neighborhood is of elliptic shape
+    double theDistance = itk::NumericTraits<double>::Zero;
+    for (j = 0; j < MapType::ImageDimension; ++j)
+      theDistance += pow(static_cast<double>(offset[j]), 2.0)
+                     / pow(static_cast<double>(radius[j]), 2.0);
+
+    if (theDistance <= 1.0)
+      {
+      for (j = 0; j < MapType::ImageDimension; ++j)
+        {
+        int pos = offset[j] + position[j];
+        positionToUpdate[j] = (pos >= 0) ?
+                              pos % mapSize[j] :
+                              (mapSize[j] - ((-pos) % mapSize[j])) % mapSize[j];
+        }
+      neighbors.push_back(positionToUpdate);
+      weights.push_back(1.0 / (1.0 + theDistance));
+      }
+    }
+}
+
 } // end of namespace otb
 
 #endif
@@ -24,6 +24,7 @@
 
 #include "itkImageToImageFilter.h"
 #include "itkEuclideanDistanceMetric.h"
+#include <vector>
 
 #include "otbCzihoSOMLearningBehaviorFunctor.h"
 #include "otbCzihoSOMNeighborhoodBehaviorFunctor.h"
@@ -48,6 +49,11 @@ namespace otb
  * The SOMMap produced as output can be either initialized with a constant custom value or randomly
  * generated following a normal law. The seed for the random initialization can be modified.
  *
+ * In batch mode (see SetBatchMode()), the samples are processed by blocks of BatchSize samples
+ * (the whole list sample by default). The winners of a block are searched in parallel against
+ * the frozen map, then each neuron moves towards the mean of the samples won in its neighborhood,
+ * weighted like in the sequential update, with the learning coefficient as step.
+ *
  * \sa SOMMap
  * \sa SOMActivationBuilder
  * \sa CzihoSOMLearningBehaviorFunctor
@@ -110,6 +116,12 @@ public:
   itkGetMacro(Seed, unsigned int);
   itkGetObjectMacro(ListSample, ListSampleType);
   itkSetObjectMacro(ListSample, ListSampleType);
+  itkSetMacro(BatchMode, bool);
+  itkGetMacro(BatchMode, bool);
+  itkBooleanMacro(BatchMode);
+  /** Number of samples per block in batch mode (0 means the whole list sample) */
+  itkSetMacro(BatchSize, unsigned long);
+  itkGetMacro(BatchSize, unsigned long);
 
   void SetBetaFunctor(const SOMLearningBehaviorFunctorType& functor)
   {
@@ -139,6 +151,26 @@ protected:
    * \param radius The radius of the nieghbourhood.
    */
   virtual void UpdateMap(const NeuronType& sample, double beta, SizeType& radius);
+  /**
+   * Update the output map with a block of samples (batch mode).
+   * \param samples The samples, stored contiguously,
+   * \param nbSamples The number of samples,
+   * \param beta The learning coefficient,
+   * \param radius The radius of the neighbourhood.
+   */
+  virtual void BatchUpdateMap(const std::vector<double>& samples, unsigned long nbSamples,
+                              double beta, SizeType& radius);
+  /**
+   * Get the neurons to update around a winner, with their weight (the
+   * learning coefficient is not included). Used by the batch mode.
+   */
+  virtual void GetNeighborhood(const IndexType& position, const SizeType& radius,
+                               std::vector<IndexType>& neighbors, std::vector<double>& weights);
+  /** Should missing (NaN) components be ignored in the batch mode */
+  virtual bool GetHandleMissingValues() const
+  {
+    return false;
+  }
   /**
    * Step one iteration.
    */
@@ -146,6 +178,25 @@ protected:
   /** PrintSelf method */
   void PrintSelf(std::ostream& os, itk::Indent indent) const ITK_OVERRIDE;
 
+  /** Search the winners of samples against the neurons (batch mode) */
+  static void FindWinners(const ValueType* neurons, unsigned long nbNeurons, unsigned int dimension,
+                          const double* samples, unsigned long nbSamples,
+                          unsigned long* winners, bool skipMissing);
+
+  /** Callback to search the winners in each thread */
+  static ITK_THREAD_RETURN_TYPE BatchThreaderCallback(void *arg);
+
+  struct BatchThreadStruct
+    {
+    const ValueType* Neurons;
+    unsigned long    NumberOfNeurons;
+    unsigned int     Dimension;
+    const double*    Samples;
+    unsigned long    NumberOfSamples;
+    unsigned long*   Winners;
+    bool             SkipMissing;
+    };
+
 private:
   SOM(const Self &); // purposely not implemented
   void operator =(const Self&); // purposely not implemented
@@ -173,6 +224,10 @@ private:
   SOMLearningBehaviorFunctorType m_BetaFunctor;
   /** Behavior of the Neighborhood extent */
   SOMNeighborhoodBehaviorFunctorType m_NeighborhoodSizeFunctor;
+  /** Batch training mode */
+  bool m_BatchMode;
+  /** Number of samples per block in batch mode */
+  unsigned long m_BatchSize;
 
 };
 } // end namespace otb
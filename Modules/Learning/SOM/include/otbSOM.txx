@@ -28,6 +28,9 @@
 #include "otbMacro.h"
 #include "itkImageRegionIterator.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkImageRegionConstIteratorWithOnlyIndex.h"
+#include "vnl/vnl_math.h"
+#include <algorithm>
 
 namespace otb
 {
@@ -52,6 +55,8 @@ SOM<TListSample, TMap, TSOMLearningBehaviorFunctor, TSOMNeighborhoodBehaviorFunc
   m_MaxWeight = static_cast<ValueType>(128.0);
   m_RandomInit = false;
   m_Seed = 123574651;
+  m_BatchMode = false;
+  m_BatchSize = 0;
 }
 /**
  * Destructor
@@ -130,6 +135,212 @@ SOM<TListSample, TMap, TSOMLearningBehaviorFunctor, TSOMNeighborhoodBehaviorFunc
     it.Set(newNeuron);
     }
 }
+/**
+ * Search the winners of samples against the neurons. Squared euclidean
+ * distances give the same winners as the map distance, and ties are solved
+ * like in SOMMap::GetWinner().
+ */
+template <class TListSample, class TMap,
+    class TSOMLearningBehaviorFunctor,
+    class TSOMNeighborhoodBehaviorFunctor>
+void
+SOM<TListSample, TMap, TSOMLearningBehaviorFunctor, TSOMNeighborhoodBehaviorFunctor>
+::FindWinners(const ValueType* neurons, unsigned long nbNeurons, unsigned int dimension,
+              const double* samples, unsigned long nbSamples,
+              unsigned long* winners, bool skipMissing)
+{
+  for (unsigned long s = 0; s < nbSamples; ++s)
+    {
+    const double* sample = samples + s * dimension;
+    double minDistance = itk::NumericTraits<double>::max();
+    unsigned long minPos = 0;
+    for (unsigned long k = 0; k < nbNeurons; ++k)
+      {
+      const ValueType* neuron = neurons + k * dimension;
+      double distance = 0.0;
+      if (skipMissing)
+        {
+        for (unsigned int j = 0; j < dimension; ++j)
+          {
+          // the difference is NaN if one of the components is missing
+          const double diff = sample[j] - static_cast<double>(neuron[j]);
+          if (!vnl_math_isnan(diff))
+            {
+            distance += diff * diff;
+            }
+          }
+        }
+      else
+        {
+        for (unsigned int j = 0; j < dimension; ++j)
+          {
+          const double diff = sample[j] - static_cast<double>(neuron[j]);
+          distance += diff * diff;
+          }
+        }
+      if (distance <= minDistance)
+        {
+        minDistance = distance;
+        minPos = k;
+        }
+      }
+    winners[s] = minPos;
+    }
+}
+
+template <class TListSample, class TMap,
+    class TSOMLearningBehaviorFunctor,
+    class TSOMNeighborhoodBehaviorFunctor>
+ITK_THREAD_RETURN_TYPE
+SOM<TListSample, TMap, TSOMLearningBehaviorFunctor, TSOMNeighborhoodBehaviorFunctor>
+::BatchThreaderCallback(void *arg)
+{
+  itk::MultiThreader::ThreadInfoStruct * info = static_cast<itk::MultiThreader::ThreadInfoStruct *>(arg);
+  BatchThreadStruct * str = static_cast<BatchThreadStruct *>(info->UserData);
+
+  const unsigned long threadId = info->ThreadID;
+  const unsigned long threadCount = info->NumberOfThreads;
+  const unsigned long chunk = (str->NumberOfSamples + threadCount - 1) / threadCount;
+  const unsigned long first = threadId * chunk;
+  if (first < str->NumberOfSamples)
+    {
+    const unsigned long count = std::min(chunk, str->NumberOfSamples - first);
+    FindWinners(str->Neurons, str->NumberOfNeurons, str->Dimension,
+                str->Samples + first * str->Dimension, count,
+                str->Winners + first, str->SkipMissing);
+    }
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+/**
+ * Get the neurons to update around a winner, with their weight.
+ */
+template <class TListSample, class TMap,
+    class TSOMLearningBehaviorFunctor,
+    class TSOMNeighborhoodBehaviorFunctor>
+void
+SOM<TListSample, TMap, TSOMLearningBehaviorFunctor, TSOMNeighborhoodBehaviorFunctor>
+::GetNeighborhood(const IndexType& position, const SizeType& radius,
+                  std::vector<IndexType>& neighbors, std::vector<double>& weights)
+{
+  MapPointerType map = this->GetOutput(0);
+
+  neighbors.clear();
+  weights.clear();
+
+  // Local neighborhood definition
+  RegionType localRegion;
+  IndexType  localIndex = position - radius;
+  SizeType   localSize;
+  for (unsigned int i = 0; i < MapType::ImageDimension; ++i)
+    {
+    localSize[i] = 2 * radius[i] + 1;
+    }
+  localRegion.SetIndex(localIndex);
+  localRegion.SetSize(localSize);
+  localRegion.Crop(map->GetLargestPossibleRegion());
+
+  itk::ImageRegionConstIteratorWithOnlyIndex<MapType> it(map, localRegion);
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+    {
+    double distance = 0.0;
+    for (unsigned int i = 0; i < MapType::ImageDimension; ++i)
+      {
+      const double diff = static_cast<double>(it.GetIndex()[i] - position[i]);
+      distance += diff * diff;
+      }
+    neighbors.push_back(it.GetIndex());
+    weights.push_back(1.0 / (1.0 + vcl_sqrt(distance)));
+    }
+}
+
+/**
+ * Update the output map with a block of samples.
+ */
+template <class TListSample, class TMap,
+    class TSOMLearningBehaviorFunctor,
+    class TSOMNeighborhoodBehaviorFunctor>
+void
+SOM<TListSample, TMap, TSOMLearningBehaviorFunctor, TSOMNeighborhoodBehaviorFunctor>
+::BatchUpdateMap(const std::vector<double>& samples, unsigned long nbSamples,
+                 double beta, SizeType& radius)
+{
+  MapPointerType map = this->GetOutput(0);
+  const unsigned int dimension = map->GetNumberOfComponentsPerPixel();
+  const unsigned long nbNeurons = map->GetLargestPossibleRegion().GetNumberOfPixels();
+  const bool skipMissing = this->GetHandleMissingValues();
+  ValueType* neurons = map->GetBufferPointer();
+
+  // Search the winners in parallel, the map being frozen
+  std::vector<unsigned long> winners(nbSamples);
+  BatchThreadStruct str;
+  str.Neurons = neurons;
+  str.NumberOfNeurons = nbNeurons;
+  str.Dimension = dimension;
+  str.Samples = &(samples[0]);
+  str.NumberOfSamples = nbSamples;
+  str.Winners = &(winners[0]);
+  str.SkipMissing = skipMissing;
+
+  this->GetMultiThreader()->SetNumberOfThreads(this->GetNumberOfThreads());
+  this->GetMultiThreader()->SetSingleMethod(this->BatchThreaderCallback, &str);
+  this->GetMultiThreader()->SingleMethodExecute();
+
+  // Sum of the samples won by each neuron, and number of available
+  // components
+  std::vector<double> sums(nbNeurons * dimension, 0.0);
+  std::vector<double> counts(nbNeurons * dimension, 0.0);
+  std::vector<bool>   isWinner(nbNeurons, false);
+  for (unsigned long s = 0; s < nbSamples; ++s)
+    {
+    const unsigned long winner = winners[s];
+    isWinner[winner] = true;
+    for (unsigned int j = 0; j < dimension; ++j)
+      {
+      const double value = samples[s * dimension + j];
+      if (skipMissing && vnl_math_isnan(value))
+        {
+        continue;
+        }
+      sums[winner * dimension + j] += value;
+      counts[winner * dimension + j] += 1.0;
+      }
+    }
+
+  // Spread the sums over the neighborhood of each winner
+  std::vector<double> numerators(nbNeurons * dimension, 0.0);
+  std::vector<double> denominators(nbNeurons * dimension, 0.0);
+  std::vector<IndexType> neighbors;
+  std::vector<double>    weights;
+  for (unsigned long winner = 0; winner < nbNeurons; ++winner)
+    {
+    if (!isWinner[winner])
+      {
+      continue;
+      }
+    this->GetNeighborhood(map->ComputeIndex(winner), radius, neighbors, weights);
+    for (unsigned int n = 0; n < neighbors.size(); ++n)
+      {
+      const unsigned long k = map->ComputeOffset(neighbors[n]);
+      for (unsigned int j = 0; j < dimension; ++j)
+        {
+        numerators[k * dimension + j] += weights[n] * sums[winner * dimension + j];
+        denominators[k * dimension + j] += weights[n] * counts[winner * dimension + j];
+        }
+      }
+    }
+
+  // Move each neuron towards the weighted mean of its samples
+  for (unsigned long i = 0; i < nbNeurons * dimension; ++i)
+    {
+    if (denominators[i] > 0.0)
+      {
+      const double value = static_cast<double>(neurons[i]);
+      neurons[i] = static_cast<ValueType>(value + beta * (numerators[i] / denominators[i] - value));
+      }
+    }
+}
+
 /**
  * Step one iteration.
  */
@@ -150,6 +361,37 @@ SOM<TListSample, TMap, TSOMLearningBehaviorFunctor, TSOMNeighborhoodBehaviorFunc
 
   // update the neurons map with each example of the training set.
   otbMsgDebugMacro(<< "Beta: " << newBeta << ", radius: " << newSize);
+  if (m_BatchMode)
+    {
+    // copy the samples by blocks in a contiguous buffer
+    const unsigned int dimension = m_ListSample->GetMeasurementVectorSize();
+    const unsigned long blockSize = (m_BatchSize > 0 ? m_BatchSize : m_ListSample->Size());
+    std::vector<double> samples;
+    samples.reserve(blockSize * dimension);
+    unsigned long nbSamples = 0;
+    for (typename ListSampleType::Iterator it = m_ListSample->Begin();
+         it != m_ListSample->End();
+         ++it)
+      {
+      const typename ListSampleType::MeasurementVectorType& measurement = it.GetMeasurementVector();
+      for (unsigned int j = 0; j < dimension; ++j)
+        {
+        samples.push_back(static_cast<double>(measurement[j]));
+        }
+      if (++nbSamples == blockSize)
+        {
+        this->BatchUpdateMap(samples, nbSamples, newBeta, newSize);
+        samples.clear();
+        nbSamples = 0;
+        }
+      }
+    if (nbSamples > 0)
+      {
+      this->BatchUpdateMap(samples, nbSamples, newBeta, newSize);
+      }
+    return;
+    }
+
   for (typename ListSampleType::Iterator it = m_ListSample->Begin();
        it != m_ListSample->End();
        ++it)
@@ -261,6 +503,8 @@ SOM<TListSample, TMap, TSOMLearningBehaviorFunctor, TSOMNeighborhoodBehaviorFunc
 ::PrintSelf(std::ostream& os, itk::Indent indent) const
 {
   Superclass::PrintSelf(os, indent);
+  os << indent << "Batch mode: " << m_BatchMode << std::endl;
+  os << indent << "Batch size: " << m_BatchSize << std::endl;
 }
 
 } // end namespace otb
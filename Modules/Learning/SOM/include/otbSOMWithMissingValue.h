@@ -102,6 +102,12 @@ protected:
    */
   void UpdateMap(const NeuronType& sample, double beta, SizeType& radius) ITK_OVERRIDE;
 
+  /** Missing components are ignored in the batch mode */
+  bool GetHandleMissingValues() const ITK_OVERRIDE
+  {
+    return true;
+  }
+
   /** Step one iteration. */
   void Step(unsigned int currentIteration) ITK_OVERRIDE
   {
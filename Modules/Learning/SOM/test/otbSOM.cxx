@@ -26,6 +26,8 @@
 #include "otbImageFileWriter.h"
 #include "itkListSample.h"
 #include "itkImageRegionIterator.h"
+#include <cmath>
+#include <algorithm>
 
 int otbSOM(int itkNotUsed(argc), char* argv[])
 {
@@ -95,3 +97,122 @@ int otbSOM(int itkNotUsed(argc), char* argv[])
 
   return EXIT_SUCCESS;
 }
+
+namespace
+{
+typedef itk::VariableLengthVector<double>                                    SOMBatchPixelType;
+typedef itk::Statistics::EuclideanDistanceMetric<SOMBatchPixelType>          SOMBatchDistanceType;
+typedef otb::SOMMap<SOMBatchPixelType, SOMBatchDistanceType, 2>              SOMBatchMapType;
+typedef itk::Statistics::ListSample<SOMBatchPixelType>                       SOMBatchListSampleType;
+typedef otb::SOM<SOMBatchListSampleType, SOMBatchMapType>                    SOMBatchType;
+
+SOMBatchMapType::Pointer TrainSOMBatch(SOMBatchListSampleType * listSample, char * argv[],
+                                       bool batchMode, unsigned int nbThreads)
+{
+  SOMBatchType::Pointer som = SOMBatchType::New();
+  som->SetListSample(listSample);
+  SOMBatchType::SizeType size;
+  size[0] = atoi(argv[3]);
+  size[1] = atoi(argv[4]);
+  som->SetMapSize(size);
+  SOMBatchType::SizeType radius;
+  radius[0] = atoi(argv[5]);
+  radius[1] = atoi(argv[6]);
+  som->SetNeighborhoodSizeInit(radius);
+  som->SetNumberOfIterations(atoi(argv[7]));
+  som->SetBetaInit(atof(argv[8]));
+  som->SetBetaEnd(atof(argv[9]));
+  som->SetMaxWeight(atof(argv[10]));
+  som->SetRandomInit(false);
+  som->SetBatchMode(batchMode);
+  if (nbThreads > 0)
+    {
+    som->SetNumberOfThreads(nbThreads);
+    }
+  som->Update();
+  return som->GetOutput();
+}
+
+/** Mean distance between the samples and their winning neuron */
+double SOMQuantizationError(SOMBatchMapType * map, SOMBatchListSampleType * listSample)
+{
+  SOMBatchDistanceType::Pointer distance = SOMBatchDistanceType::New();
+  double error = 0.0;
+  for (unsigned int i = 0; i < listSample->Size(); ++i)
+    {
+    const SOMBatchPixelType & sample = listSample->GetMeasurementVector(i);
+    error += distance->Evaluate(sample, map->GetPixel(map->GetWinner(sample)));
+    }
+  return error / listSample->Size();
+}
+}
+
+/** Batch training: the map must not depend on the number of threads, and
+ *  must quantize the samples about as well as the sequential training */
+int otbSOMBatch(int itkNotUsed(argc), char* argv[])
+{
+  typedef otb::VectorImage<double, 2>               ImageType;
+  typedef otb::ImageFileReader<ImageType>           ReaderType;
+  typedef otb::ImageFileWriter<SOMBatchMapType>     WriterType;
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName(argv[1]);
+  reader->Update();
+
+  SOMBatchListSampleType::Pointer listSample = SOMBatchListSampleType::New();
+  listSample->SetMeasurementVectorSize(reader->GetOutput()->GetNumberOfComponentsPerPixel());
+  itk::ImageRegionIterator<ImageType> it(reader->GetOutput(), reader->GetOutput()->GetLargestPossibleRegion());
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+    {
+    listSample->PushBack(it.Get());
+    }
+
+  SOMBatchMapType::Pointer sequential = TrainSOMBatch(listSample, argv, false, 0);
+  SOMBatchMapType::Pointer batch = TrainSOMBatch(listSample, argv, true, 0);
+  SOMBatchMapType::Pointer batchSingleThread = TrainSOMBatch(listSample, argv, true, 1);
+
+  // Per-thread sums are merged in a fixed order: only rounding may differ
+  itk::ImageRegionIterator<SOMBatchMapType> itBatch(batch, batch->GetLargestPossibleRegion());
+  itk::ImageRegionIterator<SOMBatchMapType> itSingle(batchSingleThread, batchSingleThread->GetLargestPossibleRegion());
+  for (itBatch.GoToBegin(), itSingle.GoToBegin(); !itBatch.IsAtEnd(); ++itBatch, ++itSingle)
+    {
+    for (unsigned int c = 0; c < itBatch.Get().Size(); ++c)
+      {
+      if (std::abs(itBatch.Get()[c] - itSingle.Get()[c]) > 1e-9 * std::max(1.0, std::abs(itSingle.Get()[c])))
+        {
+        std::cerr << "Batch map depends on the number of threads at " << itBatch.GetIndex()
+                  << ": " << itBatch.Get() << " vs " << itSingle.Get() << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  // Both maps are initialized with a constant value: training must at
+  // least bring the neurons closer to the samples than this value
+  SOMBatchDistanceType::Pointer distance = SOMBatchDistanceType::New();
+  SOMBatchPixelType initValue(listSample->GetMeasurementVectorSize());
+  initValue.Fill(atof(argv[10]));
+  double initialError = 0.0;
+  for (unsigned int i = 0; i < listSample->Size(); ++i)
+    {
+    initialError += distance->Evaluate(listSample->GetMeasurementVector(i), initValue);
+    }
+  initialError /= listSample->Size();
+
+  const double sequentialError = SOMQuantizationError(sequential, listSample);
+  const double batchError = SOMQuantizationError(batch, listSample);
+  std::cout << "Quantization error: initial " << initialError << ", sequential " << sequentialError
+            << ", batch " << batchError << std::endl;
+  if (batchError >= initialError || batchError > 1.5 * sequentialError)
+    {
+    std::cerr << "Batch training quantizes the samples much worse than the sequential training" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  WriterType::Pointer writer = WriterType::New();
+  writer->SetFileName(argv[2]);
+  writer->SetInput(batch);
+  writer->Update();
+
+  return EXIT_SUCCESS;
+}
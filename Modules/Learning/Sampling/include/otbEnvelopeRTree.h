@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef otbEnvelopeRTree_h
+#define otbEnvelopeRTree_h
+
+#include "itkMacro.h"
+#include <vector>
+#include <cstddef>
+
+namespace otb
+{
+
+/** \class EnvelopeRTree
+ * \brief Static R-tree over axis-aligned bounding boxes
+ *
+ * Boxes are first inserted with Insert(), then the tree is packed once with
+ * Build() using the Sort-Tile-Recursive algorithm. Each node holds up to
+ * NodeCapacity children, and the tree can then be queried with Search() for
+ * all the identifiers whose box intersects a given box (boxes touching on a
+ * border intersect). Inserting after Build() requires a new Build().
+ *
+ * \ingroup OTBSampling
+ */
+class ITK_EXPORT EnvelopeRTree
+{
+public:
+  typedef EnvelopeRTree Self;
+  typedef long          IdType;
+
+  /** Axis-aligned bounding box */
+  struct BoxType
+    {
+    double MinX;
+    double MinY;
+    double MaxX;
+    double MaxY;
+    };
+
+  EnvelopeRTree(unsigned int nodeCapacity = 16);
+
+  /** Remove all the boxes */
+  void Clear();
+
+  /** Add a box with its identifier */
+  void Insert(const BoxType & box, IdType id);
+
+  /** Pack the tree */
+  void Build();
+
+  /** Append to ids the identifiers of the boxes intersecting the given box.
+   *  Identifiers are returned in no particular order. */
+  void Search(const BoxType & box, std::vector<IdType> & ids) const;
+
+  /** Number of boxes inserted */
+  size_t GetNumberOfBoxes() const
+  {
+    return m_Entries.size();
+  }
+
+  /** Is the tree packed and ready for queries */
+  bool IsBuilt() const
+  {
+    return m_Built;
+  }
+
+private:
+  struct EntryType
+    {
+    BoxType Box;
+    IdType  Id;
+    };
+
+  struct NodeType
+    {
+    BoxType Box;
+    size_t  FirstChild;
+    size_t  EndChild;
+    };
+
+  static inline bool Intersects(const BoxType & a, const BoxType & b)
+  {
+    return !(a.MaxX < b.MinX || b.MaxX < a.MinX || a.MaxY < b.MinY || b.MaxY < a.MinY);
+  }
+
+  static void ExpandBox(BoxType & box, const BoxType & other);
+
+  /** Sort the boxes in [first, last) in Sort-Tile-Recursive order */
+  template <class TIterator>
+  void SortTileRecursive(TIterator first, TIterator last) const;
+
+  unsigned int           m_NodeCapacity;
+  std::vector<EntryType> m_Entries;
+  /** Nodes of all levels, from the leaves to the root. Children of a leaf
+   *  node are entries, children of other nodes are nodes. */
+  std::vector<NodeType>  m_Nodes;
+  size_t                 m_NumberOfLeaves;
+  bool                   m_Built;
+};
+
+} // end namespace otb
+
+#endif
@@ -33,6 +33,12 @@ namespace otb
  * \class PersistentImageSampleExtractorFilter
  * 
  * \brief Persistent filter to extract sample values from an image
+ *
+ * Only point samples are processed. For each streaming region, the points
+ * are first located in the input buffer, then their values are read in
+ * buffer order and the output features are filled with the field indexes
+ * resolved once. A point is extracted by the streaming region containing
+ * its pixel, so that points lying on a region border are not duplicated.
  * 
  * \ingroup OTBSampling
  */
@@ -73,7 +79,11 @@ public:
   /** Get the output samples OGR container */
   ogr::DataSource* GetOutputSamples();
 
-  void Synthetize(void) ITK_OVERRIDE{}
+  /** Commit the last output transactions */
+  void Synthetize(void) ITK_OVERRIDE
+  {
+    this->CommitOutputTransactions();
+  }
 
   /** Reset method called before starting the streaming*/
   void Reset(void) ITK_OVERRIDE;
@@ -97,7 +107,8 @@ protected:
 
   void GenerateInputRequestedRegion() ITK_OVERRIDE;
 
-  /** process only points */
+  /** process only points : locate the samples, read their values in
+   *  buffer order and fill the output features */
   void ThreadedGenerateVectorData(const ogr::Layer& layerForThread, itk::ThreadIdType threadid) ITK_OVERRIDE;
 
 private:
@@ -24,6 +24,7 @@
 #include "otbImageSampleExtractorFilter.h"
 #include "itkDefaultConvertPixelTraits.h"
 #include "itkProgressReporter.h"
+#include <algorithm>
 
 namespace otb
 {
@@ -163,20 +164,25 @@ PersistentImageSampleExtractorFilter<TInputImage>
 {
   // Retrieve inputs
   TInputImage* inputImage = const_cast<TInputImage*>(this->GetInput());
+  const RegionType& requestedRegion = this->GetOutput()->GetRequestedRegion();
   unsigned int nbBand = inputImage->GetNumberOfComponentsPerPixel();
 
   ogr::Layer outputLayer = this->GetInMemoryOutput(threadid);
 
   itk::ProgressReporter progress( this, threadid, layerForThread.GetFeatureCount(true) );
 
-  // Loop across the features in the layer (filtered by requested region in BeforeTGD already)
+  // First pass : locate the point samples in the input buffer. Each position
+  // is stored with its rank in the thread layer.
+  typedef std::pair<itk::OffsetValueType, unsigned long> SamplePositionType;
+  std::vector<SamplePositionType> positions;
+  positions.reserve(layerForThread.GetFeatureCount(true));
+
   OGRGeometry *geom;
   PointType imgPoint;
   IndexType imgIndex;
-  PixelType imgPixel;
-  double imgComp;
+  unsigned long rank = 0;
   ogr::Layer::const_iterator featIt = layerForThread.begin();
-  for(; featIt!=layerForThread.end(); ++featIt)
+  for(; featIt!=layerForThread.end(); ++featIt, ++rank)
     {
     geom = featIt->ogr().GetGeometryRef();
     switch (geom->getGeometryType())
@@ -185,7 +191,7 @@ PersistentImageSampleExtractorFilter<TInputImage>
       case wkbPoint25D:
         {
         OGRPoint* castPoint = dynamic_cast<OGRPoint*>(geom);
-        if (castPoint == NULL)
+        if (castPoint == ITK_NULLPTR)
           {
           // Wrong Type !
           break;
@@ -193,18 +199,12 @@ PersistentImageSampleExtractorFilter<TInputImage>
         imgPoint[0] = castPoint->getX();
         imgPoint[1] = castPoint->getY();
         inputImage->TransformPhysicalPointToIndex(imgPoint,imgIndex);
-        imgPixel = inputImage->GetPixel(imgIndex);
-
-        ogr::Feature dstFeature(outputLayer.GetLayerDefn());
-        dstFeature.SetFrom( *featIt, TRUE );
-        dstFeature.SetFID(featIt->GetFID());
-        for (unsigned int i=0 ; i<nbBand ; ++i)
+        // A point lying on the border of two streaming regions is kept by
+        // only one of them
+        if (requestedRegion.IsInside(imgIndex))
           {
-          imgComp = static_cast<double>(itk::DefaultConvertPixelTraits<PixelType>::GetNthComponent(i,imgPixel));
-          // Fill the output OGRDataSource
-          dstFeature[m_SampleFieldNames[i]].SetValue(imgComp);
+          positions.push_back(std::make_pair(inputImage->ComputeOffset(imgIndex),rank));
           }
-        outputLayer.CreateFeature( dstFeature );
         break;
         }
       default:
@@ -213,6 +213,53 @@ PersistentImageSampleExtractorFilter<TInputImage>
         break;
         }
       }
+    }
+
+  // Second pass : read the pixel values in buffer order, so that the buffer
+  // is traversed only once, and store them contiguously for each sample
+  std::sort(positions.begin(), positions.end());
+  const unsigned long nbSamples = positions.size();
+  std::vector<double> values(nbSamples * nbBand);
+  std::vector<unsigned long> sampleOfRank(rank, nbSamples);
+  for (unsigned long s=0 ; s<nbSamples ; ++s)
+    {
+    imgIndex = inputImage->ComputeIndex(positions[s].first);
+    const PixelType& imgPixel = inputImage->GetPixel(imgIndex);
+    double* dest = &(values[s * nbBand]);
+    for (unsigned int i=0 ; i<nbBand ; ++i)
+      {
+      dest[i] = static_cast<double>(itk::DefaultConvertPixelTraits<PixelType>::GetNthComponent(i,imgPixel));
+      }
+    sampleOfRank[positions[s].second] = s;
+    }
+
+  // Resolve the output field indexes once
+  std::vector<int> fieldIndexes(nbBand);
+  OGRFeatureDefn &outputDefn = outputLayer.GetLayerDefn();
+  for (unsigned int i=0 ; i<nbBand ; ++i)
+    {
+    fieldIndexes[i] = outputDefn.GetFieldIndex(m_SampleFieldNames[i].c_str());
+    }
+
+  // Third pass : fill the output features, in the input order
+  rank = 0;
+  featIt = layerForThread.begin();
+  for(; featIt!=layerForThread.end(); ++featIt, ++rank)
+    {
+    const unsigned long s = sampleOfRank[rank];
+    if (s < nbSamples)
+      {
+      ogr::Feature dstFeature(outputDefn);
+      dstFeature.SetFrom( *featIt, TRUE );
+      dstFeature.SetFID(featIt->GetFID());
+      const double* src = &(values[s * nbBand]);
+      for (unsigned int i=0 ; i<nbBand ; ++i)
+        {
+        // Fill the output OGRDataSource
+        dstFeature.ogr().SetField(fieldIndexes[i], src[i]);
+        }
+      outputLayer.CreateFeature( dstFeature );
+      }
     progress.CompletedPixel();
     }
 }
@@ -88,7 +88,11 @@ public:
   /** Runtime information support. */
   itkTypeMacro(PersistentOGRDataToSamplePositionFilter, PersistentSamplingFilterBase);
 
-  void Synthetize(void) ITK_OVERRIDE{}
+  /** Commit the last output transactions */
+  void Synthetize(void) ITK_OVERRIDE
+  {
+    this->CommitOutputTransactions();
+  }
 
   /** Reset method called before starting the streaming*/
   void Reset(void) ITK_OVERRIDE;
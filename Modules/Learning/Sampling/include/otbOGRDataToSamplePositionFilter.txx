@@ -203,33 +203,11 @@ void
 PersistentOGRDataToSamplePositionFilter<TInputImage,TMaskImage,TSampler>
 ::DispatchInputVectors()
 {
-  TInputImage* outputImage = this->GetOutput();
   ogr::DataSource* vectors = const_cast<ogr::DataSource*>(this->GetOGRData());
   ogr::Layer inLayer = vectors->GetLayer(this->GetLayerIndex());
 
-  const RegionType& requestedRegion = outputImage->GetRequestedRegion();
-  itk::ContinuousIndex<double> startIndex(requestedRegion.GetIndex());
-  itk::ContinuousIndex<double> endIndex(requestedRegion.GetUpperIndex());
-  startIndex[0] += -0.5;
-  startIndex[1] += -0.5;
-  endIndex[0] += 0.5;
-  endIndex[1] += 0.5;
-  itk::Point<double, 2> startPoint;
-  itk::Point<double, 2> endPoint;
-  outputImage->TransformContinuousIndexToPhysicalPoint(startIndex, startPoint);
-  outputImage->TransformContinuousIndexToPhysicalPoint(endIndex, endPoint);
-
-  // create geometric extent
-  OGRPolygon tmpPolygon;
-  OGRLinearRing ring;
-  ring.addPoint(startPoint[0],startPoint[1],0.0);
-  ring.addPoint(startPoint[0],endPoint[1]  ,0.0);
-  ring.addPoint(endPoint[0]  ,endPoint[1]  ,0.0);
-  ring.addPoint(endPoint[0]  ,startPoint[1],0.0);
-  ring.addPoint(startPoint[0],startPoint[1],0.0);
-  tmpPolygon.addRing(&ring);
-
-  inLayer.SetSpatialFilter(&tmpPolygon);
+  std::vector<ogr::Feature> features;
+  this->GetFeaturesInRequestedRegion(features);
 
   unsigned int numberOfThreads = this->GetNumberOfThreads();
   std::vector<ogr::Layer> tmpLayers;
@@ -239,18 +217,15 @@ PersistentOGRDataToSamplePositionFilter<TInputImage,TMaskImage,TSampler>
     }
 
   OGRFeatureDefn &layerDefn = inLayer.GetLayerDefn();
-  ogr::Layer::const_iterator featIt = inLayer.begin();
   std::string className;
-  for(; featIt!=inLayer.end(); ++featIt)
+  for (unsigned long k=0 ; k<features.size() ; ++k)
     {
     ogr::Feature dstFeature(layerDefn);
-    dstFeature.SetFrom( *featIt, TRUE );
-    dstFeature.SetFID(featIt->GetFID());
-    className = featIt->ogr().GetFieldAsString(this->GetFieldIndex());
+    dstFeature.SetFrom( features[k], TRUE );
+    dstFeature.SetFID(features[k].GetFID());
+    className = features[k].ogr().GetFieldAsString(this->GetFieldIndex());
     tmpLayers[m_ClassPartition[className]].CreateFeature( dstFeature );
     }
-
-  inLayer.SetSpatialFilter(ITK_NULLPTR);
 }
 
 template<class TInputImage, class TMaskImage, class TSampler>
@@ -23,6 +23,7 @@
 
 #include "otbPersistentImageFilter.h"
 #include "otbOGRDataSourceWrapper.h"
+#include "otbEnvelopeRTree.h"
 #include "otbImage.h"
 
 namespace otb
@@ -93,6 +94,13 @@ public:
   itkSetMacro(OutLayerName, std::string);
   itkGetMacro(OutLayerName, std::string);
 
+  /** Set/Get macro for the number of features written to an output layer
+   *  in a single OGR transaction (default 100000). A transaction spans
+   *  several streaming regions, and the last one is committed by
+   *  CommitOutputTransactions() at the end of the streaming. */
+  itkSetMacro(TransactionSize, unsigned long);
+  itkGetMacro(TransactionSize, unsigned long);
+
 protected:
   /** Constructor */
   PersistentSamplingFilterBase();
@@ -128,7 +136,10 @@ protected:
                            RegionType& region,
                            itk::ThreadIdType& threadid);
 
-  /** Process a polygon : use pixels inside the polygon */
+  /** Process a polygon : use pixels inside the polygon. The rows of the
+   *  considered region are rasterised with a scanline : the crossings of
+   *  each row with the polygon edges are computed once per row, so that
+   *  the cost of the inclusion test doesn't grow with the polygon size. */
   virtual void ProcessPolygon(const ogr::Feature& feature,
                               OGRPolygon* polygon,
                               RegionType& region,
@@ -157,6 +168,13 @@ protected:
   /** Get the region bounding a set of features */
   RegionType FeatureBoundingRegion(const TInputImage* image, otb::ogr::Layer::const_iterator& featIt) const;
 
+  /** Collect the features of the input layer that intersect the requested
+   *  region, ordered by FID. Feature envelopes are indexed in an in-memory
+   *  R-tree on first call, so that the following streaming regions don't
+   *  scan the whole layer. Layers without random read access fall back to
+   *  the OGR spatial filter. */
+  void GetFeaturesInRequestedRegion(std::vector<ogr::Feature>& features);
+
   /** Method to split the input OGRDataSource between several containers
    *  for each thread. Default is to put the same number of features for
    *  each thread.*/
@@ -165,6 +183,10 @@ protected:
   /** Gather the content of in-memory output layer into the filter outputs */
   virtual void GatherOutputVectors(void);
 
+  /** Commit the transactions still open on the output layers. To be called
+   *  by Synthetize() in subclasses writing output vectors. */
+  void CommitOutputTransactions(void);
+
   /** Utility method to add new fields on an output layer */
   virtual void InitializeOutputDataSource(ogr::DataSource* inputDS, ogr::DataSource* outputDS);
 
@@ -230,6 +252,28 @@ private:
   /** In-memory containers storing position during iteration loop*/
   std::vector<std::vector<OGRDataPointer> > m_InMemoryOutputs;
 
+  /** Maximum number of features per output transaction */
+  unsigned long m_TransactionSize;
+
+  /** Features written in the open transaction of each output layer, and
+   *  output layers with an open transaction */
+  std::vector<unsigned long> m_TransactionFeatureCounts;
+  std::vector<ogr::Layer> m_TransactionLayers;
+
+  /** Build the feature envelope index if the input layer has changed */
+  void UpdateFeatureIndex(ogr::Layer& layer);
+
+  /** Index over the envelopes of the input features (by FID) */
+  EnvelopeRTree m_FeatureIndex;
+
+  /** True if the features can be retrieved through the index */
+  bool m_UseFeatureIndex;
+
+  /** Input layer described by the index */
+  const ogr::DataSource* m_IndexedData;
+  int m_IndexedLayerIndex;
+  itk::ModifiedTimeType m_IndexedDataTime;
+
 };
 } // End namespace otb
 
@@ -28,6 +28,8 @@
 #include "otbMacro.h"
 #include "itkTimeProbe.h"
 #include "itkProgressReporter.h"
+#include <algorithm>
+#include <cmath>
 
 namespace otb
 {
@@ -41,6 +43,11 @@ PersistentSamplingFilterBase<TInputImage,TMaskImage>
   , m_OutLayerName(std::string("output"))
   , m_OGRLayerCreationOptions()
   , m_AdditionalFields()
+  , m_TransactionSize(100000)
+  , m_UseFeatureIndex(false)
+  , m_IndexedData(ITK_NULLPTR)
+  , m_IndexedLayerIndex(-1)
+  , m_IndexedDataTime(0)
 {
   this->SetNthOutput(0,TInputImage::New());
 }
@@ -290,12 +297,26 @@ PersistentSamplingFilterBase<TInputImage,TMaskImage>
                             ? realOutput->GetLayer(0)
                             : realOutput->GetLayer(m_OutLayerName);
 
-      OGRErr err = outLayer.ogr().StartTransaction();
-      if (err != OGRERR_NONE)
+      // Transactions are kept open across streaming regions, and
+      // committed every TransactionSize features
+      if (m_TransactionLayers.size() <= count)
         {
-        itkExceptionMacro(<< "Unable to start transaction for OGR layer " << outLayer.ogr().GetName() << ".");
+        m_TransactionLayers.resize(count + 1, ogr::Layer(ITK_NULLPTR, false));
+        m_TransactionFeatureCounts.resize(count + 1, 0);
         }
-  
+      if (!m_TransactionLayers[count])
+        {
+        const OGRErr err = outLayer.ogr().StartTransaction();
+        if (err != OGRERR_NONE)
+          {
+          itkExceptionMacro(<< "Unable to start transaction for OGR layer " << outLayer.ogr().GetName() << ".");
+          }
+        m_TransactionLayers[count] = outLayer;
+        m_TransactionFeatureCounts[count] = 0;
+        }
+
+      // One destination feature is reused for all the copies
+      ogr::Feature dstFeature(outLayer.GetLayerDefn());
       for (unsigned int thread=0 ; thread < numberOfThreads ; thread++)
         {
         ogr::Layer inLayer = this->m_InMemoryOutputs[thread][count]->GetLayerChecked(0);
@@ -312,6 +333,7 @@ PersistentSamplingFilterBase<TInputImage,TMaskImage>
           for(; tmpIt!=inLayer.end(); ++tmpIt)
             {
             outLayer.SetFeature( *tmpIt );
+            ++m_TransactionFeatureCounts[count];
             }
           }
         else
@@ -319,17 +341,22 @@ PersistentSamplingFilterBase<TInputImage,TMaskImage>
           // Copy mode
           for(; tmpIt!=inLayer.end(); ++tmpIt)
             {
-            ogr::Feature dstFeature(outLayer.GetLayerDefn());
             dstFeature.SetFrom( *tmpIt, TRUE );
+            dstFeature.SetFID(OGRNullFID);
             outLayer.CreateFeature( dstFeature );
+            ++m_TransactionFeatureCounts[count];
             }
           }
         }
   
-      err = outLayer.ogr().CommitTransaction();
-      if (err != OGRERR_NONE)
+      if (m_TransactionFeatureCounts[count] >= m_TransactionSize)
         {
-        itkExceptionMacro(<< "Unable to commit transaction for OGR layer " << outLayer.ogr().GetName() << ".");
+        const OGRErr err = outLayer.ogr().CommitTransaction();
+        if (err != OGRERR_NONE)
+          {
+          itkExceptionMacro(<< "Unable to commit transaction for OGR layer " << outLayer.ogr().GetName() << ".");
+          }
+        m_TransactionLayers[count] = ogr::Layer(ITK_NULLPTR, false);
         }
       count++;
       }
@@ -339,6 +366,26 @@ PersistentSamplingFilterBase<TInputImage,TMaskImage>
   this->m_InMemoryOutputs.clear();
 }
 
+template <class TInputImage, class TMaskImage>
+void
+PersistentSamplingFilterBase<TInputImage,TMaskImage>
+::CommitOutputTransactions(void)
+{
+  for (unsigned int k=0 ; k < m_TransactionLayers.size() ; k++)
+    {
+    if (m_TransactionLayers[k])
+      {
+      const OGRErr err = m_TransactionLayers[k].ogr().CommitTransaction();
+      if (err != OGRERR_NONE)
+        {
+        itkExceptionMacro(<< "Unable to commit transaction for OGR layer " << m_TransactionLayers[k].ogr().GetName() << ".");
+        }
+      }
+    }
+  m_TransactionLayers.clear();
+  m_TransactionFeatureCounts.clear();
+}
+
 template <class TInputImage, class TMaskImage>
 void
 PersistentSamplingFilterBase<TInputImage,TMaskImage>
@@ -527,47 +574,145 @@ PersistentSamplingFilterBase<TInputImage,TMaskImage>
   typename TInputImage::PointType imgPoint;
   OGRPoint tmpPoint;
 
-  if (mask)
+  const long startX = region.GetIndex(0);
+  const long startY = region.GetIndex(1);
+  const long sizeX = static_cast<long>(region.GetSize(0));
+  const long nbRows = static_cast<long>(region.GetSize(1));
+  if (sizeX == 0 || nbRows == 0)
     {
-    // For pixels in consideredRegion and not masked
-    typedef MaskedIteratorDecorator<
-      itk::ImageRegionConstIterator<TMaskImage>,
-      itk::ImageRegionConstIterator<TMaskImage> > MaskedIteratorType;
-    MaskedIteratorType it(mask, mask, region);
-    it.GoToBegin();
-    while (!it.IsAtEnd())
+    return;
+    }
+
+  // The scanline needs image rows aligned with the X axis
+  const typename TInputImage::DirectionType& direction = img->GetDirection();
+  const bool useScanline = (direction[0][1] == 0.0 && direction[1][0] == 0.0);
+
+  // Ordinate of each row, and crossings of each row with the polygon edges,
+  // stored contiguously row after row (crossings of row r are in
+  // [rowOffsets[r], rowOffsets[r+1]) )
+  std::vector<double> rowY(nbRows);
+  std::vector<unsigned long> rowOffsets(nbRows + 1, 0UL);
+  std::vector<double> crossings;
+  if (useScanline)
+    {
+    imgIndex[0] = startX;
+    for (long r = 0 ; r < nbRows ; ++r)
       {
-      imgIndex = it.GetIndex();
+      imgIndex[1] = startY + r;
       img->TransformIndexToPhysicalPoint(imgIndex,imgPoint);
-      tmpPoint.setX(imgPoint[0]);
-      tmpPoint.setY(imgPoint[1]);
-      bool isInside = this->IsSampleInsidePolygon(polygon,&tmpPoint);
-      if (isInside)
+      rowY[r] = imgPoint[1];
+      }
+    const double rowStep = (nbRows > 1 ? rowY[1] - rowY[0] : 1.0);
+
+    // edges of all the rings (the even-odd rule handles the holes)
+    std::vector<OGRLinearRing*> rings;
+    rings.push_back(polygon->getExteriorRing());
+    for (int k=0 ; k<polygon->getNumInteriorRings() ; k++)
+      {
+      rings.push_back(polygon->getInteriorRing(k));
+      }
+
+    // Two passes over the edges : count the crossings of each row, then
+    // store them. An edge crosses a row if the row ordinate lies in
+    // [min(y1,y2), max(y1,y2)), like in OGRLinearRing::isPointInRing().
+    for (unsigned int pass = 0 ; pass < 2 ; ++pass)
+      {
+      std::vector<unsigned long> fill;
+      if (pass == 1)
         {
-        this->ProcessSample(feature,imgIndex, imgPoint, threadid);
+        for (long r = 0 ; r < nbRows ; ++r)
+          {
+          rowOffsets[r+1] += rowOffsets[r];
+          }
+        crossings.resize(rowOffsets[nbRows]);
+        fill.assign(rowOffsets.begin(), rowOffsets.end() - 1);
+        }
+      for (unsigned int k=0 ; k<rings.size() ; ++k)
+        {
+        OGRLinearRing* ring = rings[k];
+        if (ring == ITK_NULLPTR)
+          {
+          continue;
+          }
+        const int nbPoints = ring->getNumPoints();
+        for (int p = 0 ; p < nbPoints ; ++p)
+          {
+          const int prev = (p + nbPoints - 1) % nbPoints;
+          const double x1 = ring->getX(p);
+          const double y1 = ring->getY(p);
+          const double x2 = ring->getX(prev);
+          const double y2 = ring->getY(prev);
+          if (y1 == y2)
+            {
+            continue;
+            }
+          // candidate rows, widened by one row to be safe with rounding
+          const double r1 = (y1 - rowY[0]) / rowStep;
+          const double r2 = (y2 - rowY[0]) / rowStep;
+          const long rMin = static_cast<long>(std::max(std::floor(std::min(r1,r2)) - 1.0, 0.0));
+          const long rMax = static_cast<long>(std::min(std::ceil(std::max(r1,r2)) + 1.0,
+                                                       static_cast<double>(nbRows - 1)));
+          for (long r = rMin ; r <= rMax ; ++r)
+            {
+            const double y = rowY[r];
+            if ((y1 > y) != (y2 > y))
+              {
+              if (pass == 0)
+                {
+                ++rowOffsets[r+1];
+                }
+              else
+                {
+                crossings[fill[r]++] = x1 + (y - y1) * (x2 - x1) / (y2 - y1);
+                }
+              }
+            }
+          }
         }
-      ++it;
+      }
+    for (long r = 0 ; r < nbRows ; ++r)
+      {
+      std::sort(crossings.begin() + rowOffsets[r], crossings.begin() + rowOffsets[r+1]);
       }
     }
-  else
+
+  // For pixels in consideredRegion and not masked
+  for (long r = 0 ; r < nbRows ; ++r)
     {
-    typedef itk::ImageRegionConstIteratorWithOnlyIndex<TInputImage> NoValueIteratorType;
-    NoValueIteratorType it(img,region);
-    it.GoToBegin();
-    while (!it.IsAtEnd())
+    std::vector<double>::const_iterator rowBegin = crossings.begin() + rowOffsets[r];
+    std::vector<double>::const_iterator rowEnd = crossings.begin() + rowOffsets[r+1];
+    if (useScanline && rowBegin == rowEnd)
       {
-      imgIndex = it.GetIndex();
+      // the row doesn't cross the polygon
+      continue;
+      }
+    imgIndex[1] = startY + r;
+    for (long c = 0 ; c < sizeX ; ++c)
+      {
+      imgIndex[0] = startX + c;
+      if (mask && mask->GetPixel(imgIndex) == 0)
+        {
+        continue;
+        }
       img->TransformIndexToPhysicalPoint(imgIndex,imgPoint);
-      tmpPoint.setX(imgPoint[0]);
-      tmpPoint.setY(imgPoint[1]);
-      bool isInside = this->IsSampleInsidePolygon(polygon,&tmpPoint);
+      bool isInside;
+      if (useScanline)
+        {
+        // inside if an odd number of crossings lie on the right of the pixel
+        isInside = ((rowEnd - std::upper_bound(rowBegin, rowEnd, imgPoint[0])) % 2) == 1;
+        }
+      else
+        {
+        tmpPoint.setX(imgPoint[0]);
+        tmpPoint.setY(imgPoint[1]);
+        isInside = this->IsSampleInsidePolygon(polygon,&tmpPoint);
+        }
       if (isInside)
         {
         this->ProcessSample(feature,imgIndex, imgPoint, threadid);
         }
-      ++it;
       }
-    }  
+    }
 }
 
 template <class TInputImage, class TMaskImage>
@@ -686,7 +831,69 @@ PersistentSamplingFilterBase<TInputImage,TMaskImage>
 template<class TInputImage, class TMaskImage>
 void
 PersistentSamplingFilterBase<TInputImage,TMaskImage>
-::DispatchInputVectors()
+::UpdateFeatureIndex(ogr::Layer& layer)
+{
+  const ogr::DataSource* vectors = this->GetOGRData();
+  if (m_FeatureIndex.IsBuilt() &&
+      m_IndexedData == vectors &&
+      m_IndexedLayerIndex == m_LayerIndex &&
+      m_IndexedDataTime == vectors->GetMTime())
+    {
+    return;
+    }
+
+  itk::TimeProbe chrono;
+  chrono.Start();
+
+  m_FeatureIndex.Clear();
+  m_UseFeatureIndex = layer.ogr().TestCapability(OLCRandomRead);
+  if (m_UseFeatureIndex)
+    {
+    layer.SetSpatialFilter(ITK_NULLPTR);
+    EnvelopeRTree::BoxType box;
+    OGREnvelope envelope;
+    ogr::Layer::const_iterator featIt = layer.begin();
+    for(; featIt!=layer.end(); ++featIt)
+      {
+      const long fid = featIt->GetFID();
+      if (fid == OGRNullFID)
+        {
+        // features can't be retrieved by FID
+        m_UseFeatureIndex = false;
+        break;
+        }
+      OGRGeometry* geom = featIt->ogr().GetGeometryRef();
+      if (geom == ITK_NULLPTR)
+        {
+        continue;
+        }
+      geom->getEnvelope(&envelope);
+      box.MinX = envelope.MinX;
+      box.MinY = envelope.MinY;
+      box.MaxX = envelope.MaxX;
+      box.MaxY = envelope.MaxY;
+      m_FeatureIndex.Insert(box,fid);
+      }
+    }
+  if (!m_UseFeatureIndex)
+    {
+    m_FeatureIndex.Clear();
+    }
+  m_FeatureIndex.Build();
+
+  m_IndexedData = vectors;
+  m_IndexedLayerIndex = m_LayerIndex;
+  m_IndexedDataTime = vectors->GetMTime();
+
+  chrono.Stop();
+  otbMsgDebugMacro(<< "feature index on " << m_FeatureIndex.GetNumberOfBoxes()
+                   << " features took " << chrono.GetTotal() << " sec");
+}
+
+template<class TInputImage, class TMaskImage>
+void
+PersistentSamplingFilterBase<TInputImage,TMaskImage>
+::GetFeaturesInRequestedRegion(std::vector<ogr::Feature>& features)
 {
   TInputImage* outputImage = this->GetOutput();
   ogr::DataSource* vectors = const_cast<ogr::DataSource*>(this->GetOGRData());
@@ -714,7 +921,66 @@ PersistentSamplingFilterBase<TInputImage,TMaskImage>
   ring.addPoint(startPoint[0],startPoint[1],0.0);
   tmpPolygon.addRing(&ring);
 
-  inLayer.SetSpatialFilter(&tmpPolygon);
+  features.clear();
+  this->UpdateFeatureIndex(inLayer);
+
+  if (!m_UseFeatureIndex)
+    {
+    inLayer.SetSpatialFilter(&tmpPolygon);
+    ogr::Layer::const_iterator featIt = inLayer.begin();
+    for(; featIt!=inLayer.end(); ++featIt)
+      {
+      features.push_back(*featIt);
+      }
+    inLayer.SetSpatialFilter(ITK_NULLPTR);
+    return;
+    }
+
+  OGREnvelope extent;
+  tmpPolygon.getEnvelope(&extent);
+  EnvelopeRTree::BoxType box;
+  box.MinX = extent.MinX;
+  box.MinY = extent.MinY;
+  box.MaxX = extent.MaxX;
+  box.MaxY = extent.MaxY;
+  std::vector<EnvelopeRTree::IdType> candidates;
+  m_FeatureIndex.Search(box,candidates);
+  std::sort(candidates.begin(), candidates.end());
+
+  // Same selection as the OGR spatial filter : features with an envelope
+  // inside the extent are kept, others are tested for intersection
+  OGREnvelope envelope;
+  for (unsigned long k=0 ; k<candidates.size() ; ++k)
+    {
+    ogr::Feature feature = inLayer.GetFeature(candidates[k]);
+    if (feature.addr() == ITK_NULLPTR)
+      {
+      continue;
+      }
+    OGRGeometry* geom = feature.ogr().GetGeometryRef();
+    if (geom == ITK_NULLPTR)
+      {
+      continue;
+      }
+    geom->getEnvelope(&envelope);
+    if (!extent.Contains(envelope) && !geom->Intersects(&tmpPolygon))
+      {
+      continue;
+      }
+    features.push_back(feature);
+    }
+}
+
+template<class TInputImage, class TMaskImage>
+void
+PersistentSamplingFilterBase<TInputImage,TMaskImage>
+::DispatchInputVectors()
+{
+  ogr::DataSource* vectors = const_cast<ogr::DataSource*>(this->GetOGRData());
+  ogr::Layer inLayer = vectors->GetLayer(m_LayerIndex);
+
+  std::vector<ogr::Feature> features;
+  this->GetFeaturesInRequestedRegion(features);
 
   unsigned int numberOfThreads = this->GetNumberOfThreads();
   std::vector<ogr::Layer> tmpLayers;
@@ -725,20 +991,17 @@ PersistentSamplingFilterBase<TInputImage,TMaskImage>
     }
   
   OGRFeatureDefn &layerDefn = inLayer.GetLayerDefn();
-  ogr::Layer::const_iterator featIt = inLayer.begin();
   unsigned int counter=0;
-  for(; featIt!=inLayer.end(); ++featIt)
+  for (unsigned long k=0 ; k<features.size() ; ++k)
     {
     ogr::Feature dstFeature(layerDefn);
-    dstFeature.SetFrom( *featIt, TRUE );
-    dstFeature.SetFID(featIt->GetFID());
+    dstFeature.SetFrom( features[k], TRUE );
+    dstFeature.SetFID(features[k].GetFID());
     tmpLayers[counter].CreateFeature( dstFeature );
     counter++;
     if (counter >= tmpLayers.size())
       counter = 0;
     }
-
-  inLayer.SetSpatialFilter(ITK_NULLPTR);
 }
 
 template<class TInputImage, class TMaskImage>
@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "otbEnvelopeRTree.h"
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+namespace otb
+{
+
+namespace
+{
+/** Order on the box center along X */
+template <class T>
+struct BoxCenterXLess
+{
+  bool operator()(const T & a, const T & b) const
+  {
+    return (a.Box.MinX + a.Box.MaxX) < (b.Box.MinX + b.Box.MaxX);
+  }
+};
+
+/** Order on the box center along Y */
+template <class T>
+struct BoxCenterYLess
+{
+  bool operator()(const T & a, const T & b) const
+  {
+    return (a.Box.MinY + a.Box.MaxY) < (b.Box.MinY + b.Box.MaxY);
+  }
+};
+}
+
+EnvelopeRTree::EnvelopeRTree(unsigned int nodeCapacity)
+  : m_NodeCapacity(nodeCapacity < 2 ? 2 : nodeCapacity),
+    m_Entries(),
+    m_Nodes(),
+    m_NumberOfLeaves(0),
+    m_Built(false)
+{
+}
+
+void
+EnvelopeRTree::Clear()
+{
+  m_Entries.clear();
+  m_Nodes.clear();
+  m_NumberOfLeaves = 0;
+  m_Built = false;
+}
+
+void
+EnvelopeRTree::Insert(const BoxType & box, IdType id)
+{
+  EntryType entry;
+  entry.Box = box;
+  entry.Id = id;
+  m_Entries.push_back(entry);
+  m_Built = false;
+}
+
+void
+EnvelopeRTree::ExpandBox(BoxType & box, const BoxType & other)
+{
+  box.MinX = std::min(box.MinX, other.MinX);
+  box.MinY = std::min(box.MinY, other.MinY);
+  box.MaxX = std::max(box.MaxX, other.MaxX);
+  box.MaxY = std::max(box.MaxY, other.MaxY);
+}
+
+template <class TIterator>
+void
+EnvelopeRTree::SortTileRecursive(TIterator first, TIterator last) const
+{
+  typedef typename std::iterator_traits<TIterator>::value_type ValueType;
+
+  const size_t count = static_cast<size_t>(last - first);
+  const size_t nbNodes = (count + m_NodeCapacity - 1) / m_NodeCapacity;
+  const size_t nbSlices = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(nbNodes))));
+  const size_t sliceSize = nbSlices * m_NodeCapacity;
+
+  // vertical slices of about sqrt(nbNodes) nodes, each one sorted along Y
+  std::sort(first, last, BoxCenterXLess<ValueType>());
+  for (size_t start = 0; start < count; start += sliceSize)
+    {
+    const size_t end = std::min(count, start + sliceSize);
+    std::sort(first + start, first + end, BoxCenterYLess<ValueType>());
+    }
+}
+
+void
+EnvelopeRTree::Build()
+{
+  m_Nodes.clear();
+  m_NumberOfLeaves = 0;
+  m_Built = true;
+  if (m_Entries.empty())
+    {
+    return;
+    }
+
+  // leaves
+  this->SortTileRecursive(m_Entries.begin(), m_Entries.end());
+  const size_t nbEntries = m_Entries.size();
+  for (size_t i = 0; i < nbEntries; i += m_NodeCapacity)
+    {
+    NodeType node;
+    node.FirstChild = i;
+    node.EndChild = std::min(nbEntries, i + m_NodeCapacity);
+    node.Box = m_Entries[i].Box;
+    for (size_t k = i + 1; k < node.EndChild; ++k)
+      {
+      ExpandBox(node.Box, m_Entries[k].Box);
+      }
+    m_Nodes.push_back(node);
+    }
+  m_NumberOfLeaves = m_Nodes.size();
+
+  // upper levels, until a single root remains
+  size_t levelBegin = 0;
+  size_t levelEnd = m_Nodes.size();
+  while (levelEnd - levelBegin > 1)
+    {
+    this->SortTileRecursive(m_Nodes.begin() + levelBegin, m_Nodes.begin() + levelEnd);
+    for (size_t i = levelBegin; i < levelEnd; i += m_NodeCapacity)
+      {
+      NodeType node;
+      node.FirstChild = i;
+      node.EndChild = std::min(levelEnd, i + m_NodeCapacity);
+      node.Box = m_Nodes[i].Box;
+      for (size_t k = i + 1; k < node.EndChild; ++k)
+        {
+        ExpandBox(node.Box, m_Nodes[k].Box);
+        }
+      m_Nodes.push_back(node);
+      }
+    levelBegin = levelEnd;
+    levelEnd = m_Nodes.size();
+    }
+}
+
+void
+EnvelopeRTree::Search(const BoxType & box, std::vector<IdType> & ids) const
+{
+  if (!m_Built)
+    {
+    itkGenericExceptionMacro(<< "EnvelopeRTree must be built before being searched");
+    }
+  if (m_Nodes.empty())
+    {
+    return;
+    }
+
+  std::vector<size_t> stack;
+  stack.push_back(m_Nodes.size() - 1);
+  while (!stack.empty())
+    {
+    const NodeType & node = m_Nodes[stack.back()];
+    const bool isLeaf = stack.back() < m_NumberOfLeaves;
+    stack.pop_back();
+    if (!Intersects(node.Box, box))
+      {
+      continue;
+      }
+    if (isLeaf)
+      {
+      for (size_t k = node.FirstChild; k < node.EndChild; ++k)
+        {
+        if (Intersects(m_Entries[k].Box, box))
+          {
+          ids.push_back(m_Entries[k].Id);
+          }
+        }
+      }
+    else
+      {
+      for (size_t k = node.FirstChild; k < node.EndChild; ++k)
+        {
+        stack.push_back(k);
+        }
+      }
+    }
+}
+
+} // end namespace otb
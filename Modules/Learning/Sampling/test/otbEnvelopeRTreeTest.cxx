@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "otbEnvelopeRTree.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include <algorithm>
+#include <iostream>
+
+int otbEnvelopeRTree(int itkNotUsed(argc), char* itkNotUsed(argv) [])
+{
+  typedef otb::EnvelopeRTree      TreeType;
+  typedef TreeType::BoxType       BoxType;
+  typedef TreeType::IdType        IdType;
+
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator GeneratorType;
+  GeneratorType::Pointer generator = GeneratorType::New();
+  generator->Initialize(12345);
+
+  const unsigned int sizes[] = {0, 1, 7, 16, 17, 300, 5000};
+  for (unsigned int s = 0; s < 7; ++s)
+    {
+    TreeType tree(8);
+    std::vector<BoxType> boxes;
+    for (unsigned int i = 0; i < sizes[s]; ++i)
+      {
+      BoxType box;
+      box.MinX = generator->GetUniformVariate(0., 1000.);
+      box.MinY = generator->GetUniformVariate(0., 1000.);
+      box.MaxX = box.MinX + generator->GetUniformVariate(0., 30.);
+      box.MaxY = box.MinY + generator->GetUniformVariate(0., 30.);
+      boxes.push_back(box);
+      tree.Insert(box, static_cast<IdType>(i));
+      }
+    tree.Build();
+
+    // compare each query with a brute force search
+    for (unsigned int q = 0; q < 200; ++q)
+      {
+      BoxType query;
+      query.MinX = generator->GetUniformVariate(-50., 1000.);
+      query.MinY = generator->GetUniformVariate(-50., 1000.);
+      query.MaxX = query.MinX + generator->GetUniformVariate(0., 100.);
+      query.MaxY = query.MinY + generator->GetUniformVariate(0., 100.);
+
+      std::vector<IdType> found;
+      tree.Search(query, found);
+      std::sort(found.begin(), found.end());
+
+      std::vector<IdType> expected;
+      for (unsigned int i = 0; i < boxes.size(); ++i)
+        {
+        if (!(boxes[i].MaxX < query.MinX || query.MaxX < boxes[i].MinX ||
+              boxes[i].MaxY < query.MinY || query.MaxY < boxes[i].MinY))
+          {
+          expected.push_back(static_cast<IdType>(i));
+          }
+        }
+
+      if (found != expected)
+        {
+        std::cout << "Wrong search result with " << sizes[s] << " boxes: found "
+                  << found.size() << " boxes, expected " << expected.size() << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
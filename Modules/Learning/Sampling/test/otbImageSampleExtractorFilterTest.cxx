@@ -25,6 +25,7 @@
 #include "itkPhysicalPointImageSource.h"
 #include "itkTimeProbe.h"
 #include <fstream>
+#include <cstdlib>
 
 int otbImageSampleExtractorFilterNew(int itkNotUsed(argc), char* itkNotUsed(argv) [])
 {
@@ -43,7 +44,7 @@ int otbImageSampleExtractorFilter(int argc, char* argv[])
 
   if (argc < 3)
     {
-    std::cout << "Usage : "<<argv[0]<< "  input_vector  output" << std::endl;
+    std::cout << "Usage : "<<argv[0]<< "  input_vector  output  [transaction_size]" << std::endl;
     }
 
   std::string vectorPath(argv[1]);
@@ -80,6 +81,12 @@ int otbImageSampleExtractorFilter(int argc, char* argv[])
   filter->SetOutputSamples(output);
   filter->SetClassFieldName(classFieldName);
   filter->SetOutputFieldPrefix(outputPrefix);
+  if (argc > 3)
+    {
+    // transactions committed while gathering the outputs, instead of by
+    // Synthetize()
+    filter->GetFilter()->SetTransactionSize(atoi(argv[3]));
+    }
 
   itk::TimeProbe chrono;
   chrono.Start();
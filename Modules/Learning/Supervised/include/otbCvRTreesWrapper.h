@@ -22,6 +22,7 @@
 #define otbCvRTreesWrapper_h
 
 #include "otbOpenCVUtils.h"
+#include "otbFlatRandomForest.h"
 #include <vector>
 
 namespace otb
@@ -66,6 +67,12 @@ public:
                           const cv::Mat& missing =
                           cv::Mat()) const;
 
+  /** Convert the trained forest into a FlatRandomForest in VOTES mode.
+      Class labels of the flat forest are the labels returned by
+      predict(). Only ordered splits are supported.
+  */
+  void get_flat_forest(FlatRandomForest& forest) const;
+
 #ifdef OTB_OPENCV_3
 
 #define OTB_CV_WRAP_PROPERTY(type,name) \
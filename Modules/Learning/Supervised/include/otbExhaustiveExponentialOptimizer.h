@@ -22,6 +22,7 @@
 #define otbExhaustiveExponentialOptimizer_h
 
 #include "itkSingleValuedNonLinearOptimizer.h"
+#include "itkMultiThreader.h"
 
 namespace otb
 {
@@ -40,6 +41,11 @@ namespace otb
  * This optimizer can be use to perform a preliminary coarse search on
  * the search space.
  *
+ * If NumberOfThreads is greater than 1, all the grid points are
+ * evaluated concurrently, then the extrema are updated and the iteration
+ * events are invoked in the sequential order. The cost function must
+ * then be thread-safe.
+ *
  * \ingroup Numerics Optimizers
  *
  * \ingroup OTBSupervised
@@ -81,6 +87,10 @@ public:
   itkGetConstReferenceMacro(CurrentIndex, ParametersType);
   itkGetConstReferenceMacro(MaximumNumberOfIterations, unsigned long);
 
+  /** Number of threads evaluating the grid points (default is 1) */
+  itkSetMacro(NumberOfThreads, unsigned int);
+  itkGetConstReferenceMacro(NumberOfThreads, unsigned int);
+
 protected:
   ExhaustiveExponentialOptimizer();
   ~ExhaustiveExponentialOptimizer() ITK_OVERRIDE {}
@@ -90,6 +100,15 @@ protected:
   void AdvanceOneStep(void);
   void IncrementIndex(ParametersType& param);
 
+  /** Position of the grid point of a given index */
+  void ComputePosition(const ParametersType& index, ParametersType& position) const;
+
+  /** Evaluate all the grid points with several threads */
+  void WalkInParallel(void);
+
+  /** Thread callback of WalkInParallel() */
+  static ITK_THREAD_RETURN_TYPE EvaluateThreaderCallback(void *arg);
+
 protected:
   MeasureType    m_CurrentValue;
   StepsType      m_NumberOfSteps;
@@ -104,6 +123,7 @@ protected:
   MeasureType    m_MinimumMetricValue;
   ParametersType m_MinimumMetricValuePosition;
   ParametersType m_MaximumMetricValuePosition;
+  unsigned int   m_NumberOfThreads;
 
 private:
   ExhaustiveExponentialOptimizer(const Self &); //purposely not implemented
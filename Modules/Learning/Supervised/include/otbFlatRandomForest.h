@@ -0,0 +1,405 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef otbFlatRandomForest_h
+#define otbFlatRandomForest_h
+
+#include "OTBSupervisedExport.h"
+#include "otbMemoryMappedFile.h"
+#include <vector>
+#include <string>
+#include <cstddef>
+
+namespace otb
+{
+
+/** \class FlatRandomForest
+ * \brief Cache friendly inference engine for random forests
+ *
+ * A forest trained by OpenCV or Shark is converted once into flat arrays
+ * (structure of arrays): split feature, split threshold and first child
+ * of each node. Nodes of a tree are laid out breadth first and the two
+ * children of a node are adjacent, so that a traversal step is
+ *
+ * \code
+ * node = child[node] + (sample[feature[node]] > threshold[node]);
+ * \endcode
+ *
+ * Samples are evaluated by blocks: all the samples of a block go down a
+ * tree together before the next tree is read, which keeps the nodes of
+ * the current tree in cache and lets the traversal of the samples
+ * overlap.
+ *
+ * Leaves either vote for a class (OpenCV forests) or hold class scores
+ * that are averaged with the tree weights (Shark forests). Scores are
+ * accumulated in tree order, so that votes, probabilities and labels are
+ * the same as the ones of the original model.
+ *
+ * The forest can be saved in a compact binary file (Save()): a fixed
+ * header followed by the raw node, leaf and tree arrays. Load() maps such
+ * a file in memory and uses the arrays in place, without parsing nor
+ * copying them: loading is almost immediate whatever the size of the
+ * forest, and processes loading the same model share its pages. The
+ * file uses the byte order of the machine which wrote it, and is
+ * rejected on a machine with a different byte order.
+ *
+ * \ingroup OTBSupervised
+ */
+class OTBSupervised_EXPORT FlatRandomForest
+{
+public:
+  /** Node of a tree given to AddTree(). Children are indices in the
+   *  node list of the tree. */
+  struct TreeNode
+  {
+    TreeNode()
+      : Feature(-1), Threshold(0.0), Left(0), Right(0), ClassIndex(0), Scores()
+    {}
+
+    /** Split feature, or -1 for a leaf */
+    int                 Feature;
+    /** A sample goes to the left child if its feature is <= Threshold */
+    double              Threshold;
+    unsigned int        Left;
+    unsigned int        Right;
+    /** Leaf class, in voting mode */
+    unsigned int        ClassIndex;
+    /** Leaf class scores, in scoring mode */
+    std::vector<double> Scores;
+  };
+  typedef std::vector<TreeNode> TreeType;
+
+  /** Leaf semantics */
+  typedef enum {VOTES, SCORES} LeafModeType;
+
+  /** Class selected when several classes have the maximum number of
+   *  votes: the first one in class order (OpenCV 3 forests), or the first
+   *  one to reach the maximum while visiting the trees in order (OpenCV 2
+   *  forests). Scores always use the first maximum. */
+  typedef enum {FIRST_MAXIMUM, FIRST_REACHED} TieRuleType;
+
+  FlatRandomForest();
+  FlatRandomForest(const FlatRandomForest & other);
+  FlatRandomForest & operator =(const FlatRandomForest & other);
+
+  /** Remove all the trees and set the number of classes and the leaf
+   *  mode. The tie rule is reset to FIRST_MAXIMUM. */
+  void Initialize(unsigned int nbClasses, LeafModeType mode);
+
+  /** Add a tree with a given weight. In VOTES mode, the weight is the
+   *  number of votes of the tree. */
+  void AddTree(const TreeType & tree, unsigned int root, double weight = 1.0);
+
+  /** Label of each class index (optional) */
+  void SetClassLabels(const std::vector<double> & labels)
+  {
+    m_ClassLabels = labels;
+  }
+  const std::vector<double> & GetClassLabels() const
+  {
+    return m_ClassLabels;
+  }
+
+  /** Label of a class index, or the index itself if no labels are set */
+  double GetClassLabel(unsigned int classIndex) const
+  {
+    return m_ClassLabels.empty() ? static_cast<double>(classIndex) : m_ClassLabels[classIndex];
+  }
+
+  void SetTieRule(TieRuleType rule)
+  {
+    m_TieRule = rule;
+  }
+  TieRuleType GetTieRule() const
+  {
+    return m_TieRule;
+  }
+
+  LeafModeType GetLeafMode() const
+  {
+    return m_LeafMode;
+  }
+
+  bool IsEmpty() const
+  {
+    return m_NumberOfTrees == 0;
+  }
+
+  /** Is the forest read from a memory mapped file */
+  bool IsMapped() const
+  {
+    return m_MappedFile.IsNotNull();
+  }
+
+  unsigned int GetNumberOfTrees() const
+  {
+    return static_cast<unsigned int>(m_NumberOfTrees);
+  }
+
+  unsigned int GetNumberOfClasses() const
+  {
+    return m_NumberOfClasses;
+  }
+
+  size_t GetNumberOfNodes() const
+  {
+    return m_NumberOfNodes;
+  }
+
+  double GetTotalWeight() const
+  {
+    return m_TotalWeight;
+  }
+
+  /** Compute the class scores of samples.
+   *  \param samples Array of nbSamples pointers to the sample features
+   *  \param nbSamples Number of samples
+   *  \param scores Output array of nbSamples * NumberOfClasses values.
+   *  In VOTES mode, scores are the weighted votes; in SCORES mode, they are
+   *  the weighted mean of the leaf scores.
+   *  \param leaders Optional output array of nbSamples values, VOTES mode
+   *  only: class which first reached the maximum number of votes while
+   *  visiting the trees in order (tie rule of OpenCV 2 forests).
+   */
+  template <class TValue>
+  void ComputeScores(const TValue * const * samples, unsigned int nbSamples, double * scores,
+                     unsigned int * leaders = NULL) const;
+
+  /** Compute the class index and the confidence of samples.
+   *  In VOTES mode, the confidence is the proportion of votes of the
+   *  selected class, or the difference between the two largest numbers
+   *  of votes divided by the number of trees if margin is true (same
+   *  arithmetic as CvRTreesWrapper). In SCORES mode, it is the score of
+   *  the selected class, or the difference between the two largest
+   *  scores.
+   */
+  template <class TValue>
+  void Classify(const TValue * const * samples, unsigned int nbSamples, unsigned int * classes,
+                double * confidences = NULL, bool margin = false) const;
+
+  /** Write the forest in the binary format. Throws an
+   *  itk::ExceptionObject on failure. */
+  void Save(const std::string & filename) const;
+
+  /** Map a forest written by Save(). Throws an itk::ExceptionObject if the
+   *  file is not a valid flat forest. */
+  void Load(const std::string & filename);
+
+  /** Check the signature of a file */
+  static bool CanReadFile(const std::string & filename);
+
+  /** Index of the first maximum score */
+  static unsigned int ArgMax(const double * scores, unsigned int nbClasses);
+
+  /** Difference between the two largest scores */
+  static double Margin(const double * scores, unsigned int nbClasses);
+
+  /** Size of the sample blocks */
+  static const unsigned int BlockSize = 64;
+
+private:
+  template <class TValue>
+  void ComputeBlockScores(const TValue * const * samples, unsigned int nbSamples, double * scores,
+                          unsigned int * leaders) const;
+
+  /** Point the array views to the owned arrays */
+  void UpdateArrayPointers();
+
+  unsigned int        m_NumberOfClasses;
+  LeafModeType        m_LeafMode;
+  TieRuleType         m_TieRule;
+
+  /** Owned arrays, empty for a mapped forest.
+   *  Node arrays: for a leaf, m_Features is -1 and m_Children is the leaf index. */
+  std::vector<int>          m_Features;
+  std::vector<double>       m_Thresholds;
+  std::vector<unsigned int> m_Children;
+
+  /** Leaf arrays */
+  std::vector<unsigned int> m_LeafClasses;
+  std::vector<double>       m_LeafScores;
+
+  /** Trees */
+  std::vector<unsigned int> m_Roots;
+  std::vector<double>       m_Weights;
+  double                    m_TotalWeight;
+
+  std::vector<double>       m_ClassLabels;
+
+  /** Views used for inference, either on the owned arrays or in the
+   *  mapped file */
+  const int *               m_FeaturesData;
+  const double *            m_ThresholdsData;
+  const unsigned int *      m_ChildrenData;
+  const unsigned int *      m_LeafClassesData;
+  const double *            m_LeafScoresData;
+  const unsigned int *      m_RootsData;
+  const double *            m_WeightsData;
+  size_t                    m_NumberOfNodes;
+  size_t                    m_NumberOfLeafClasses;
+  size_t                    m_NumberOfLeafScores;
+  size_t                    m_NumberOfTrees;
+
+  MemoryMappedFile::Pointer m_MappedFile;
+};
+
+template <class TValue>
+void
+FlatRandomForest
+::ComputeScores(const TValue * const * samples, unsigned int nbSamples, double * scores,
+                unsigned int * leaders) const
+{
+  for (unsigned int start = 0; start < nbSamples; start += BlockSize)
+    {
+    const unsigned int size = (nbSamples - start < BlockSize ? nbSamples - start : BlockSize);
+    this->ComputeBlockScores(samples + start, size, scores + start * m_NumberOfClasses,
+                             leaders ? leaders + start : NULL);
+    }
+}
+
+template <class TValue>
+void
+FlatRandomForest
+::Classify(const TValue * const * samples, unsigned int nbSamples, unsigned int * classes,
+           double * confidences, bool margin) const
+{
+  const unsigned int nbClasses = m_NumberOfClasses;
+  std::vector<double> scores(BlockSize * nbClasses);
+  unsigned int leaders[BlockSize];
+  const bool useLeaders = (m_LeafMode == VOTES && m_TieRule == FIRST_REACHED);
+
+  for (unsigned int start = 0; start < nbSamples; start += BlockSize)
+    {
+    const unsigned int size = (nbSamples - start < BlockSize ? nbSamples - start : BlockSize);
+    this->ComputeBlockScores(samples + start, size, &(scores[0]), useLeaders ? leaders : NULL);
+
+    for (unsigned int i = 0; i < size; ++i)
+      {
+      const double * sampleScores = &(scores[i * nbClasses]);
+      const unsigned int classIndex = useLeaders ? leaders[i] : ArgMax(sampleScores, nbClasses);
+      classes[start + i] = classIndex;
+      if (confidences)
+        {
+        if (m_LeafMode == VOTES)
+          {
+          const unsigned int nbVotes = static_cast<unsigned int>(
+            margin ? Margin(sampleScores, nbClasses) : sampleScores[ArgMax(sampleScores, nbClasses)]);
+          confidences[start + i] = static_cast<float>(nbVotes) / static_cast<float>(m_NumberOfTrees);
+          }
+        else
+          {
+          confidences[start + i] = margin ? Margin(sampleScores, nbClasses) : sampleScores[classIndex];
+          }
+        }
+      }
+    }
+}
+
+template <class TValue>
+void
+FlatRandomForest
+::ComputeBlockScores(const TValue * const * samples, unsigned int nbSamples, double * scores,
+                     unsigned int * leaders) const
+{
+  const unsigned int nbClasses = m_NumberOfClasses;
+  for (unsigned int i = 0; i < nbSamples * nbClasses; ++i)
+    {
+    scores[i] = 0.0;
+    }
+
+  const int * features = m_FeaturesData;
+  const double * thresholds = m_ThresholdsData;
+  const unsigned int * children = m_ChildrenData;
+
+  unsigned int nodes[BlockSize];
+  double leaderScores[BlockSize];
+  if (leaders)
+    {
+    for (unsigned int i = 0; i < nbSamples; ++i)
+      {
+      leaders[i] = 0;
+      leaderScores[i] = 0.0;
+      }
+    }
+  for (size_t t = 0; t < m_NumberOfTrees; ++t)
+    {
+    for (unsigned int i = 0; i < nbSamples; ++i)
+      {
+      nodes[i] = m_RootsData[t];
+      }
+
+    // All the samples of the block go down one level at each pass
+    bool active = true;
+    while (active)
+      {
+      active = false;
+      for (unsigned int i = 0; i < nbSamples; ++i)
+        {
+        const unsigned int node = nodes[i];
+        const int feature = features[node];
+        if (feature >= 0)
+          {
+          const double value = static_cast<double>(samples[i][feature]);
+          nodes[i] = children[node] + (value > thresholds[node] ? 1 : 0);
+          active = true;
+          }
+        }
+      }
+
+    const double weight = m_WeightsData[t];
+    if (m_LeafMode == VOTES)
+      {
+      for (unsigned int i = 0; i < nbSamples; ++i)
+        {
+        const unsigned int leafClass = m_LeafClassesData[children[nodes[i]]];
+        const double votes = (scores[i * nbClasses + leafClass] += weight);
+        if (leaders && votes > leaderScores[i])
+          {
+          leaderScores[i] = votes;
+          leaders[i] = leafClass;
+          }
+        }
+      }
+    else
+      {
+      for (unsigned int i = 0; i < nbSamples; ++i)
+        {
+        const double * leafScores = m_LeafScoresData + static_cast<size_t>(children[nodes[i]]) * nbClasses;
+        double * sampleScores = scores + i * nbClasses;
+        for (unsigned int k = 0; k < nbClasses; ++k)
+          {
+          sampleScores[k] += weight * leafScores[k];
+          }
+        }
+      }
+    }
+
+  if (m_LeafMode == SCORES && m_TotalWeight > 0.0)
+    {
+    for (unsigned int i = 0; i < nbSamples * nbClasses; ++i)
+      {
+      scores[i] /= m_TotalWeight;
+      }
+    }
+}
+
+} // end namespace otb
+
+#endif
@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef otbFlatRandomForestMachineLearningModel_h
+#define otbFlatRandomForestMachineLearningModel_h
+
+#include "otbMachineLearningModel.h"
+#include "otbFlatRandomForest.h"
+
+namespace otb
+{
+
+/** \class FlatRandomForestMachineLearningModel
+ *  \brief Random forest read from the binary flat forest format
+ *
+ *  This model loads forests saved by FlatRandomForest::Save(), for
+ *  instance with the ConvertClassifierModel application. The model file
+ *  is mapped in memory instead of being parsed, so that loading takes
+ *  almost no time and several processes classifying with the same model
+ *  share its memory. Files are recognized by their signature, whatever
+ *  their extension.
+ *
+ *  Predictions, labels and confidence values are the same as the ones of
+ *  the converted OpenCV or Shark forest. Training is delegated to a native
+ *  random forest (see SetTrainingModel()), which is flattened once trained.
+ *
+ *  \sa FlatRandomForest
+ *
+ *  \ingroup OTBSupervised
+ */
+template <class TInputValue, class TTargetValue>
+class ITK_EXPORT FlatRandomForestMachineLearningModel
+  : public MachineLearningModel <TInputValue, TTargetValue>
+{
+public:
+  /** Standard class typedefs. */
+  typedef FlatRandomForestMachineLearningModel            Self;
+  typedef MachineLearningModel<TInputValue, TTargetValue> Superclass;
+  typedef itk::SmartPointer<Self>                         Pointer;
+  typedef itk::SmartPointer<const Self>                   ConstPointer;
+
+  typedef typename Superclass::InputValueType             InputValueType;
+  typedef typename Superclass::InputSampleType            InputSampleType;
+  typedef typename Superclass::InputListSampleType        InputListSampleType;
+  typedef typename Superclass::TargetValueType            TargetValueType;
+  typedef typename Superclass::TargetSampleType           TargetSampleType;
+  typedef typename Superclass::TargetListSampleType       TargetListSampleType;
+  typedef typename Superclass::ConfidenceValueType        ConfidenceValueType;
+  typedef typename Superclass::ConfidenceSampleType       ConfidenceSampleType;
+  typedef typename Superclass::ConfidenceListSampleType   ConfidenceListSampleType;
+  typedef typename Superclass::InputSampleMatrixType      InputSampleMatrixType;
+
+  /** Run-time type information (and related methods). */
+  itkNewMacro(Self);
+  itkTypeMacro(FlatRandomForestMachineLearningModel, MachineLearningModel);
+
+  /** Train the native random forest set by SetTrainingModel() (a Shark or,
+   * failing that, an OpenCV random forest with default parameters if none is
+   * set) on the input and target list samples, and flatten it */
+  void Train() ITK_OVERRIDE;
+
+  /** Save the model to file */
+  void Save(const std::string & filename, const std::string & name="") ITK_OVERRIDE;
+
+  /** Load the model from file */
+  void Load(const std::string & filename, const std::string & name="") ITK_OVERRIDE;
+
+  /**\name Classification model file compatibility tests */
+  //@{
+  /** Is the input model file a flat forest file ? */
+  bool CanReadFile(const std::string &) ITK_OVERRIDE;
+
+  /** True for the .frf extension: files are recognized by their signature
+   * when read, but only this extension selects the model for writing */
+  bool CanWriteFile(const std::string &) ITK_OVERRIDE;
+  //@}
+
+  /** If true, margin confidence value will be computed */
+  itkGetMacro(ComputeMargin, bool);
+  itkSetMacro(ComputeMargin, bool);
+
+  /** Set the forest to use or to save */
+  void SetFlatForest(const FlatRandomForest & forest)
+  {
+    m_FlatForest = forest;
+    this->Modified();
+  }
+  const FlatRandomForest & GetFlatForest() const
+  {
+    return m_FlatForest;
+  }
+
+  /** Set the OpenCV or Shark random forest used by Train(), with its
+   * training parameters */
+  itkSetObjectMacro(TrainingModel, Superclass);
+  itkGetObjectMacro(TrainingModel, Superclass);
+
+protected:
+  /** Constructor */
+  FlatRandomForestMachineLearningModel();
+
+  /** Destructor */
+  ~FlatRandomForestMachineLearningModel() ITK_OVERRIDE;
+
+  /** Predict values using the model */
+  TargetSampleType DoPredict(const InputSampleType& input, ConfidenceValueType *quality=ITK_NULLPTR) const ITK_OVERRIDE;
+
+  /** Predict a sample matrix by blocks of samples */
+  void DoPredictMatrix(const InputSampleMatrixType & input, const unsigned long & startIndex, const unsigned long & size, TargetValueType * targets, ConfidenceValueType * quality = ITK_NULLPTR) const ITK_OVERRIDE;
+
+  /** PrintSelf method */
+  void PrintSelf(std::ostream& os, itk::Indent indent) const ITK_OVERRIDE;
+
+private:
+  FlatRandomForestMachineLearningModel(const Self &); //purposely not implemented
+  void operator =(const Self&); //purposely not implemented
+
+  FlatRandomForest              m_FlatForest;
+  bool                          m_ComputeMargin;
+  typename Superclass::Pointer  m_TrainingModel;
+};
+
+} // end namespace otb
+
+#ifndef OTB_MANUAL_INSTANTIATION
+#include "otbFlatRandomForestMachineLearningModel.txx"
+#endif
+
+#endif
@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef otbFlatRandomForestMachineLearningModel_txx
+#define otbFlatRandomForestMachineLearningModel_txx
+
+#include "otbFlatRandomForestMachineLearningModel.h"
+#include "otbConfigure.h"
+#include "itksys/SystemTools.hxx"
+#include <vector>
+
+#ifdef OTB_USE_OPENCV
+#include "otbRandomForestsMachineLearningModel.h"
+#endif
+#ifdef OTB_USE_SHARK
+#include "otbSharkRandomForestsMachineLearningModel.h"
+#endif
+
+namespace otb
+{
+
+template <class TInputValue, class TOutputValue>
+FlatRandomForestMachineLearningModel<TInputValue,TOutputValue>
+::FlatRandomForestMachineLearningModel() :
+  m_FlatForest(),
+  m_ComputeMargin(false),
+  m_TrainingModel(ITK_NULLPTR)
+{
+  this->m_ConfidenceIndex = true;
+  this->m_IsRegressionSupported = false;
+}
+
+template <class TInputValue, class TOutputValue>
+FlatRandomForestMachineLearningModel<TInputValue,TOutputValue>
+::~FlatRandomForestMachineLearningModel()
+{
+}
+
+template <class TInputValue, class TOutputValue>
+void
+FlatRandomForestMachineLearningModel<TInputValue,TOutputValue>
+::Train()
+{
+#ifdef OTB_USE_OPENCV
+  typedef RandomForestsMachineLearningModel<TInputValue,TOutputValue>      OpenCVForestType;
+#endif
+#ifdef OTB_USE_SHARK
+  typedef SharkRandomForestsMachineLearningModel<TInputValue,TOutputValue> SharkForestType;
+#endif
+
+  if (m_TrainingModel.IsNull())
+    {
+#if defined(OTB_USE_SHARK)
+    m_TrainingModel = SharkForestType::New();
+#elif defined(OTB_USE_OPENCV)
+    m_TrainingModel = OpenCVForestType::New();
+#else
+    itkExceptionMacro(<< "Flat random forests are trained through an OpenCV or Shark random forest, and OTB is built without both");
+#endif
+    }
+
+  m_TrainingModel->SetInputListSample(this->GetInputListSample());
+  m_TrainingModel->SetTargetListSample(this->GetTargetListSample());
+  m_TrainingModel->Train();
+
+  bool converted = false;
+#ifdef OTB_USE_OPENCV
+  if (OpenCVForestType * rf = dynamic_cast<OpenCVForestType *>(m_TrainingModel.GetPointer()))
+    {
+    m_FlatForest = rf->GetFlatForest();
+    converted = true;
+    }
+#endif
+#ifdef OTB_USE_SHARK
+  if (SharkForestType * rf = dynamic_cast<SharkForestType *>(m_TrainingModel.GetPointer()))
+    {
+    m_FlatForest = rf->GetFlatForest();
+    converted = true;
+    }
+#endif
+  if (!converted)
+    {
+    itkExceptionMacro(<< "Training model " << m_TrainingModel->GetNameOfClass() << " can't be flattened: only OpenCV and Shark random forests are supported");
+    }
+  if (m_FlatForest.IsEmpty())
+    {
+    itkExceptionMacro(<< "The trained forest can't be flattened: regression forests and categorical splits are not supported");
+    }
+  this->Modified();
+}
+
+template <class TInputValue, class TOutputValue>
+void
+FlatRandomForestMachineLearningModel<TInputValue,TOutputValue>
+::Save(const std::string & filename, const std::string & itkNotUsed(name))
+{
+  if (m_FlatForest.IsEmpty())
+    {
+    itkExceptionMacro(<< "No forest to save");
+    }
+  m_FlatForest.Save(filename);
+}
+
+template <class TInputValue, class TOutputValue>
+void
+FlatRandomForestMachineLearningModel<TInputValue,TOutputValue>
+::Load(const std::string & filename, const std::string & itkNotUsed(name))
+{
+  m_FlatForest.Load(filename);
+}
+
+template <class TInputValue, class TOutputValue>
+bool
+FlatRandomForestMachineLearningModel<TInputValue,TOutputValue>
+::CanReadFile(const std::string & file)
+{
+  return FlatRandomForest::CanReadFile(file);
+}
+
+template <class TInputValue, class TOutputValue>
+bool
+FlatRandomForestMachineLearningModel<TInputValue,TOutputValue>
+::CanWriteFile(const std::string & file)
+{
+  return itksys::SystemTools::LowerCase(itksys::SystemTools::GetFilenameLastExtension(file)) == ".frf";
+}
+
+template <class TInputValue, class TOutputValue>
+typename FlatRandomForestMachineLearningModel<TInputValue,TOutputValue>
+::TargetSampleType
+FlatRandomForestMachineLearningModel<TInputValue,TOutputValue>
+::DoPredict(const InputSampleType & value, ConfidenceValueType *quality) const
+{
+  if (m_FlatForest.IsEmpty())
+    {
+    itkExceptionMacro(<< "No forest loaded");
+    }
+  const InputValueType * sample = value.GetDataPointer();
+  unsigned int classIndex = 0;
+  double confidence = 0.0;
+  m_FlatForest.Classify(&sample, 1, &classIndex, &confidence, m_ComputeMargin);
+
+  TargetSampleType target;
+  target[0] = static_cast<TOutputValue>(static_cast<float>(m_FlatForest.GetClassLabel(classIndex)));
+  if (quality != ITK_NULLPTR)
+    {
+    (*quality) = static_cast<ConfidenceValueType>(confidence);
+    }
+  return target;
+}
+
+template <class TInputValue, class TOutputValue>
+void
+FlatRandomForestMachineLearningModel<TInputValue,TOutputValue>
+::DoPredictMatrix(const InputSampleMatrixType & input, const unsigned long & startIndex, const unsigned long & size, TargetValueType * targets, ConfidenceValueType * quality) const
+{
+  if (m_FlatForest.IsEmpty())
+    {
+    itkExceptionMacro(<< "No forest loaded");
+    }
+  const InputValueType * samples[FlatRandomForest::BlockSize];
+  unsigned long ids[FlatRandomForest::BlockSize];
+  unsigned int classes[FlatRandomForest::BlockSize];
+  double confidences[FlatRandomForest::BlockSize];
+
+  unsigned long id = startIndex;
+  const unsigned long endIndex = startIndex + size;
+  while (id < endIndex)
+    {
+    // gather a block of valid samples
+    unsigned int count = 0;
+    for (; id < endIndex && count < FlatRandomForest::BlockSize; ++id)
+      {
+      if (input.IsValid(id))
+        {
+        samples[count] = input.GetSample(id);
+        ids[count] = id;
+        ++count;
+        }
+      }
+    if (count == 0)
+      {
+      continue;
+      }
+
+    m_FlatForest.Classify(samples, count, classes, quality != ITK_NULLPTR ? confidences : ITK_NULLPTR, m_ComputeMargin);
+    for (unsigned int i = 0; i < count; ++i)
+      {
+      targets[ids[i]] = static_cast<TOutputValue>(static_cast<float>(m_FlatForest.GetClassLabel(classes[i])));
+      if (quality != ITK_NULLPTR)
+        {
+        quality[ids[i]] = static_cast<ConfidenceValueType>(confidences[i]);
+        }
+      }
+    }
+}
+
+template <class TInputValue, class TOutputValue>
+void
+FlatRandomForestMachineLearningModel<TInputValue,TOutputValue>
+::PrintSelf(std::ostream& os, itk::Indent indent) const
+{
+  Superclass::PrintSelf(os,indent);
+  os << indent << "Number of trees: " << m_FlatForest.GetNumberOfTrees() << std::endl;
+  os << indent << "Number of classes: " << m_FlatForest.GetNumberOfClasses() << std::endl;
+  os << indent << "Number of nodes: " << m_FlatForest.GetNumberOfNodes() << std::endl;
+  os << indent << "Memory mapped: " << (m_FlatForest.IsMapped() ? "true" : "false") << std::endl;
+  if (m_TrainingModel.IsNotNull())
+    {
+    os << indent << "Training model: " << m_TrainingModel->GetNameOfClass() << std::endl;
+    }
+}
+
+} //end namespace otb
+
+#endif
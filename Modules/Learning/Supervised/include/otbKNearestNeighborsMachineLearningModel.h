@@ -26,6 +26,7 @@
 #include "itkLightObject.h"
 #include "itkFixedArray.h"
 #include "otbMachineLearningModel.h"
+#include "otbKdTreeIndex.h"
 
 #ifdef OTB_OPENCV_3
 #include "otbOpenCVUtils.h"
@@ -53,6 +54,8 @@ public:
   typedef typename Superclass::TargetSampleType           TargetSampleType;
   typedef typename Superclass::TargetListSampleType       TargetListSampleType;
   typedef typename Superclass::ConfidenceValueType        ConfidenceValueType;
+  typedef typename Superclass::ConfidenceListSampleType   ConfidenceListSampleType;
+  typedef typename Superclass::InputSampleMatrixType      InputSampleMatrixType;
 
   /** Run-time type information (and related methods). */
   itkNewMacro(Self);
@@ -78,6 +81,29 @@ public:
   itkGetMacro(DecisionRule, int);
   itkSetMacro(DecisionRule, int);
 
+  /** Use an OTB k-d tree to search the neighbors instead of the OpenCV
+   *  brute force search (default is true). The tree is built by Train()
+   *  and Load(). Its neighbors are the same as the brute force ones, up to
+   *  the order of equidistant samples. */
+  itkGetMacro(UseKdTree, bool);
+  itkSetMacro(UseKdTree, bool);
+  itkBooleanMacro(UseKdTree);
+
+  /** Target recall of the k-d tree search (default is 1: exact search).
+   *  Below 1, the number of leaves scanned per query is bounded by the
+   *  smallest budget reaching this average recall on training samples,
+   *  which is tuned by Train(). The recall target is saved with the
+   *  model. */
+  itkGetMacro(RecallTarget, double);
+  itkSetMacro(RecallTarget, double);
+
+  /** Maximum number of k-d tree leaves scanned per query (0 for an exact
+   *  search) */
+  unsigned int GetMaximumLeafChecks() const
+  {
+    return m_Index.GetMaximumLeafChecks();
+  }
+
   /** Train the machine learning model */
   void Train() ITK_OVERRIDE;
 
@@ -106,7 +132,12 @@ protected:
   /** Predict values using the model */
   TargetSampleType DoPredict(const InputSampleType& input, ConfidenceValueType *quality=ITK_NULLPTR) const ITK_OVERRIDE;
 
-  
+  /** Predict a range of samples with one query buffer */
+  void DoPredictBatch(const InputListSampleType * input, const unsigned int & startIndex, const unsigned int & size, TargetListSampleType * targets, ConfidenceListSampleType * quality = ITK_NULLPTR) const ITK_OVERRIDE;
+
+  /** Predict a range of samples of a sample matrix with one query buffer */
+  void DoPredictMatrix(const InputSampleMatrixType & input, const unsigned long & startIndex, const unsigned long & size, TargetValueType * targets, ConfidenceValueType * quality = ITK_NULLPTR) const ITK_OVERRIDE;
+
   /** PrintSelf method */
   void PrintSelf(std::ostream& os, itk::Indent indent) const ITK_OVERRIDE;
 
@@ -114,6 +145,26 @@ private:
   KNearestNeighborsMachineLearningModel(const Self &); //purposely not implemented
   void operator =(const Self&); //purposely not implemented
 
+  /** Workspace of the k-d tree queries of a thread */
+  struct QueryBuffer
+  {
+    KdTreeIndex::SearchBuffer Search;
+    std::vector<unsigned int> Neighbors;
+    std::vector<float>        Values;
+  };
+
+  /** Build the k-d tree on nbSamples training samples stored row by row */
+  void BuildIndex(const float * samples, const float * labels, unsigned int nbSamples, unsigned int nbFeatures);
+
+  /** Predict a sample with the k-d tree */
+  TargetValueType PredictWithIndex(const InputValueType * sample, unsigned int nbFeatures, QueryBuffer & buffer,
+                                   ConfidenceValueType * quality) const;
+
+  bool UseIndex() const
+  {
+    return m_UseKdTree && !m_Index.IsEmpty();
+  }
+
 #ifdef OTB_OPENCV_3
   cv::Ptr<cv::ml::KNearest> m_KNearestModel;
 #else
@@ -122,6 +173,15 @@ private:
   int m_K;
 
   int m_DecisionRule;
+
+  bool m_UseKdTree;
+
+  double m_RecallTarget;
+
+  /** k-d tree on the training samples, and their labels */
+  KdTreeIndex m_Index;
+
+  std::vector<float> m_IndexLabels;
 };
 } // end namespace otb
 
@@ -27,7 +27,9 @@
 
 #include <fstream>
 #include <set>
+#include <algorithm>
 #include "itkMacro.h"
+#include "otbMacro.h"
 
 namespace otb
 {
@@ -41,7 +43,9 @@ KNearestNeighborsMachineLearningModel<TInputValue,TTargetValue>
  m_KNearestModel (new CvKNearest),
 #endif
  m_K(32),
- m_DecisionRule(KNN_VOTING)
+ m_DecisionRule(KNN_VOTING),
+ m_UseKdTree(true),
+ m_RecallTarget(1.0)
 {
   this->m_ConfidenceIndex = true;
   this->m_IsRegressionSupported = true;
@@ -100,6 +104,115 @@ KNearestNeighborsMachineLearningModel<TInputValue,TTargetValue>
   //train the KNN model
   m_KNearestModel->train(samples, labels, cv::Mat(), this->m_RegressionMode, m_K, false);
 #endif
+
+  m_Index.Clear();
+  m_IndexLabels.clear();
+  if (m_UseKdTree && samples.rows > 0)
+    {
+    this->BuildIndex(samples.ptr<float>(0), labels.ptr<float>(0), samples.rows, samples.cols);
+    }
+}
+
+template <class TInputValue, class TTargetValue>
+void
+KNearestNeighborsMachineLearningModel<TInputValue,TTargetValue>
+::BuildIndex(const float * samples, const float * labels, unsigned int nbSamples, unsigned int nbFeatures)
+{
+  m_Index.Build(samples, nbSamples, nbFeatures);
+  m_IndexLabels.assign(labels, labels + nbSamples);
+  if (m_RecallTarget < 1.0)
+    {
+    const double recall = m_Index.TuneMaximumLeafChecks(static_cast<unsigned int>(std::max(m_K, 1)), m_RecallTarget);
+    otbMsgDevMacro(<< "KNN k-d tree: " << m_Index.GetMaximumLeafChecks() << " leaf checks for an estimated recall of " << recall);
+    }
+}
+
+template <class TInputValue, class TTargetValue>
+typename KNearestNeighborsMachineLearningModel<TInputValue,TTargetValue>
+::TargetValueType
+KNearestNeighborsMachineLearningModel<TInputValue,TTargetValue>
+::PredictWithIndex(const InputValueType * sample, unsigned int nbFeatures, QueryBuffer & buffer,
+                   ConfidenceValueType * quality) const
+{
+  const unsigned int indexFeatures = m_Index.GetNumberOfFeatures();
+  if (nbFeatures != indexFeatures)
+    {
+    itkExceptionMacro(<< "Sample has " << nbFeatures << " features, the model expects " << indexFeatures);
+    }
+  buffer.Search.Query.resize(indexFeatures);
+  for (unsigned int i = 0; i < indexFeatures; ++i)
+    {
+    buffer.Search.Query[i] = static_cast<float>(sample[i]);
+    }
+  const unsigned int k = (m_K > 0 ? static_cast<unsigned int>(m_K) : 0U);
+  buffer.Neighbors.resize(std::max(k, 1U));
+  const unsigned int nbNeighbors = m_Index.Search(k, &(buffer.Neighbors[0]), ITK_NULLPTR, buffer.Search);
+  if (nbNeighbors == 0)
+    {
+    if (quality != ITK_NULLPTR)
+      {
+      (*quality) = 0;
+      }
+    return static_cast<TargetValueType>(0);
+    }
+
+  std::vector<float> & values = buffer.Values;
+  values.resize(nbNeighbors);
+  for (unsigned int k = 0; k < nbNeighbors; ++k)
+    {
+    values[k] = m_IndexLabels[buffer.Neighbors[k]];
+    }
+
+  float result = 0.0f;
+  if (this->m_DecisionRule == KNN_MEAN)
+    {
+    double sum = 0.0;
+    for (unsigned int k = 0; k < nbNeighbors; ++k)
+      {
+      sum += values[k];
+      }
+    result = static_cast<float>(sum / nbNeighbors);
+    }
+  else
+    {
+    std::sort(values.begin(), values.end());
+    if (this->m_DecisionRule == KNN_MEDIAN)
+      {
+      result = values[nbNeighbors >> 1];
+      }
+    else
+      {
+      // most frequent value, the smallest one in case of tie (as OpenCV)
+      unsigned int bestCount = 0;
+      unsigned int runStart = 0;
+      for (unsigned int k = 1; k <= nbNeighbors; ++k)
+        {
+        if (k == nbNeighbors || values[k] != values[k-1])
+          {
+          if (k - runStart > bestCount)
+            {
+            bestCount = k - runStart;
+            result = values[k-1];
+            }
+          runStart = k;
+          }
+        }
+      }
+    }
+
+  if (quality != ITK_NULLPTR)
+    {
+    unsigned int accuracy = 0;
+    for (unsigned int k = 0; k < nbNeighbors; ++k)
+      {
+      if (values[k] == result)
+        {
+        accuracy++;
+        }
+      }
+    (*quality) = static_cast<ConfidenceValueType>(accuracy);
+    }
+  return static_cast<TargetValueType>(result);
 }
 
 template <class TInputValue, class TTargetValue>
@@ -110,6 +223,13 @@ KNearestNeighborsMachineLearningModel<TInputValue,TTargetValue>
 {
   TargetSampleType target;
 
+  if (this->UseIndex())
+    {
+    QueryBuffer buffer;
+    target[0] = this->PredictWithIndex(input.GetDataPointer(), input.Size(), buffer, quality);
+    return target;
+    }
+
   //convert listsample to Mat
   cv::Mat sample;
   otb::SampleToMat<InputSampleType>(input, sample);
@@ -157,6 +277,64 @@ KNearestNeighborsMachineLearningModel<TInputValue,TTargetValue>
   return target;
 }
 
+template <class TInputValue, class TTargetValue>
+void
+KNearestNeighborsMachineLearningModel<TInputValue,TTargetValue>
+::DoPredictBatch(const InputListSampleType * input, const unsigned int & startIndex, const unsigned int & size, TargetListSampleType * targets, ConfidenceListSampleType * quality) const
+{
+  if (!this->UseIndex())
+    {
+    Superclass::DoPredictBatch(input, startIndex, size, targets, quality);
+    return;
+    }
+
+  if (startIndex + size > input->Size())
+    {
+    itkExceptionMacro(<<"requested range ["<<startIndex<<", "<<startIndex+size<<"[ partially outside input sample list range.[0,"<<input->Size()<<"[");
+    }
+
+  QueryBuffer buffer;
+  TargetSampleType target;
+  for (unsigned int id = startIndex; id < startIndex + size; ++id)
+    {
+    const InputSampleType & sample = input->GetMeasurementVector(id);
+    if (quality != ITK_NULLPTR)
+      {
+      ConfidenceValueType confidence = 0;
+      target[0] = this->PredictWithIndex(sample.GetDataPointer(), sample.Size(), buffer, &confidence);
+      quality->SetMeasurementVector(id, confidence);
+      }
+    else
+      {
+      target[0] = this->PredictWithIndex(sample.GetDataPointer(), sample.Size(), buffer, ITK_NULLPTR);
+      }
+    targets->SetMeasurementVector(id, target);
+    }
+}
+
+template <class TInputValue, class TTargetValue>
+void
+KNearestNeighborsMachineLearningModel<TInputValue,TTargetValue>
+::DoPredictMatrix(const InputSampleMatrixType & input, const unsigned long & startIndex, const unsigned long & size, TargetValueType * targets, ConfidenceValueType * quality) const
+{
+  if (!this->UseIndex())
+    {
+    Superclass::DoPredictMatrix(input, startIndex, size, targets, quality);
+    return;
+    }
+
+  QueryBuffer buffer;
+  for (unsigned long id = startIndex; id < startIndex + size; ++id)
+    {
+    if (!input.IsValid(id))
+      {
+      continue;
+      }
+    targets[id] = this->PredictWithIndex(input.GetSample(id), input.NumberOfFeatures, buffer,
+                                         quality != ITK_NULLPTR ? quality + id : ITK_NULLPTR);
+    }
+}
+
 template <class TInputValue, class TTargetValue>
 void
 KNearestNeighborsMachineLearningModel<TInputValue,TTargetValue>
@@ -167,6 +345,7 @@ KNearestNeighborsMachineLearningModel<TInputValue,TTargetValue>
   fs << (name.empty() ? m_KNearestModel->getDefaultName() : cv::String(name)) << "{";
   m_KNearestModel->write(fs);
   fs << "DecisionRule" << m_DecisionRule;
+  fs << "RecallTarget" << m_RecallTarget;
   fs << "}";
   fs.release();
 #else
@@ -183,6 +362,12 @@ KNearestNeighborsMachineLearningModel<TInputValue,TTargetValue>
     {
     ofs << "DecisionRule=" << m_DecisionRule << "\n";
     }
+  // Only written for approximate searches, to keep the default files
+  // readable by older versions
+  if (m_RecallTarget < 1.0)
+    {
+    ofs << "RecallTarget=" << m_RecallTarget << "\n";
+    }
 
   //Save the samples. First column is the Label and other columns are the sample data.
   typename InputListSampleType::ConstIterator sampleIt = this->GetInputListSample()->Begin();
@@ -232,8 +417,27 @@ KNearestNeighborsMachineLearningModel<TInputValue,TTargetValue>
   if (isKNNv3)
     {
     cv::FileStorage fs(filename, cv::FileStorage::READ);
-    m_KNearestModel->read(fs.getFirstTopLevelNode());
-    m_DecisionRule = (int)(fs.getFirstTopLevelNode()["DecisionRule"]);
+    cv::FileNode node = fs.getFirstTopLevelNode();
+    m_KNearestModel->read(node);
+    m_DecisionRule = (int)(node["DecisionRule"]);
+    m_K = m_KNearestModel->getDefaultK();
+    this->SetRegressionMode(!m_KNearestModel->getIsClassifier());
+    m_RecallTarget = node["RecallTarget"].empty() ? 1.0 : (double)(node["RecallTarget"]);
+
+    // Rebuild the k-d tree from the training samples stored by OpenCV
+    m_Index.Clear();
+    m_IndexLabels.clear();
+    cv::Mat samples;
+    cv::Mat labels;
+    node["samples"] >> samples;
+    node["responses"] >> labels;
+    if (m_UseKdTree && samples.rows > 0 && labels.total() == static_cast<size_t>(samples.rows))
+      {
+      samples.convertTo(samples, CV_32F);
+      labels.convertTo(labels, CV_32F);
+      labels = labels.reshape(1, 1).clone();
+      this->BuildIndex(samples.ptr<float>(0), labels.ptr<float>(0), samples.rows, samples.cols);
+      }
     return;
     }
   ifs.open(filename.c_str());
@@ -269,6 +473,15 @@ KNearestNeighborsMachineLearningModel<TInputValue,TTargetValue>
     nextpos = line.find_first_of(" \n\r", pos+1);
     this->SetDecisionRule(boost::lexical_cast<int>(line.substr(pos+1, nextpos-pos-1)));
     }
+  //optional RecallTarget parameter
+  this->SetRecallTarget(1.0);
+  if (ifs.peek() == 'R')
+    {
+    std::getline(ifs, line);
+    pos = line.find_first_of("=", 0);
+    nextpos = line.find_first_of(" \n\r", pos+1);
+    this->SetRecallTarget(boost::lexical_cast<double>(line.substr(pos+1, nextpos-pos-1)));
+    }
   //Clear previous listSample (if any)
   typename InputListSampleType::Pointer samples = InputListSampleType::New();
   typename TargetListSampleType::Pointer labels = TargetListSampleType::New();
@@ -348,6 +561,10 @@ KNearestNeighborsMachineLearningModel<TInputValue,TTargetValue>
 {
   // Call superclass implementation
   Superclass::PrintSelf(os,indent);
+  os << indent << "K: " << m_K << std::endl;
+  os << indent << "Use k-d tree: " << m_UseKdTree << std::endl;
+  os << indent << "Recall target: " << m_RecallTarget << std::endl;
+  os << indent << "Maximum leaf checks: " << m_Index.GetMaximumLeafChecks() << std::endl;
 }
 
 } //end namespace otb
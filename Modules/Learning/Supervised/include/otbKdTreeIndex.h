@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef otbKdTreeIndex_h
+#define otbKdTreeIndex_h
+
+#include "OTBSupervisedExport.h"
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+namespace otb
+{
+
+/** \class KdTreeIndex
+ * \brief k-d tree for exact and approximate k nearest neighbors queries
+ *
+ * Points are copied in the tree in leaf order, so that the points of a
+ * leaf are contiguous. Nodes are split at the median of the dimension
+ * with the largest spread, and each node keeps the bounding box of its
+ * points.
+ *
+ * Queries use a best bin first traversal: nodes are visited by
+ * increasing distance of their bounding box to the query. The search is
+ * exact by default: it stops when the closest unvisited box is further
+ * than the current k-th neighbor. Setting a maximum number of leaf
+ * checks gives an approximate search, with a cost bounded whatever the
+ * number of points. TuneMaximumLeafChecks() selects the smallest budget
+ * reaching a target recall.
+ *
+ * Neighbors at the same distance are ordered by point index, so that the
+ * exact result does not depend on the tree layout.
+ *
+ * The tree is read-only once built and can be queried from several
+ * threads, each one with its own SearchBuffer.
+ *
+ * \ingroup OTBSupervised
+ */
+class OTBSupervised_EXPORT KdTreeIndex
+{
+public:
+  /** (squared distance, point index) */
+  typedef std::pair<float, unsigned int> NeighborType;
+
+  /** Per-thread workspace of the queries, reused from one query to the
+   *  next to avoid allocations */
+  struct SearchBuffer
+  {
+    /** Query converted to float */
+    std::vector<float>                               Query;
+    /** Max-heap of the current neighbors */
+    std::vector<NeighborType>                        Heap;
+    /** Min-heap of the nodes to visit (box distance, node) */
+    std::vector<std::pair<float, unsigned int> >     Queue;
+  };
+
+  KdTreeIndex();
+
+  /** Build the tree on nbPoints points of nbFeatures features, stored
+   *  row by row. Leaves hold at most leafSize points. The maximum number
+   *  of leaf checks is reset (exact search). */
+  void Build(const float * points, unsigned int nbPoints, unsigned int nbFeatures,
+             unsigned int leafSize = 16);
+
+  /** Remove all the points */
+  void Clear();
+
+  bool IsEmpty() const
+  {
+    return m_NumberOfPoints == 0;
+  }
+
+  unsigned int GetNumberOfPoints() const
+  {
+    return m_NumberOfPoints;
+  }
+
+  unsigned int GetNumberOfFeatures() const
+  {
+    return m_NumberOfFeatures;
+  }
+
+  unsigned int GetNumberOfLeaves() const
+  {
+    return m_NumberOfLeaves;
+  }
+
+  /** Maximum number of leaves scanned per query, 0 for an exact search */
+  void SetMaximumLeafChecks(unsigned int checks)
+  {
+    m_MaximumLeafChecks = checks;
+  }
+  unsigned int GetMaximumLeafChecks() const
+  {
+    return m_MaximumLeafChecks;
+  }
+
+  /** Search the k nearest neighbors of the query stored in
+   *  buffer.Query (NumberOfFeatures values).
+   *  \param indices Output array of k point indices, in the order given to Build()
+   *  \param sqDistances Optional output array of k squared distances
+   *  \return Number of neighbors found: min(k, NumberOfPoints).
+   *  Neighbors are sorted by increasing distance.
+   */
+  unsigned int Search(unsigned int k, unsigned int * indices, float * sqDistances,
+                      SearchBuffer & buffer) const;
+
+  /** Same as Search() with a given maximum number of leaf checks */
+  unsigned int Search(unsigned int k, unsigned int * indices, float * sqDistances,
+                      SearchBuffer & buffer, unsigned int maxLeafChecks) const;
+
+  /** Average fraction of the k exact neighbors found with a maximum
+   *  number of leaf checks, over nbQueries indexed points. Each query
+   *  point is excluded from its own neighbors. */
+  double EstimateRecall(unsigned int k, unsigned int maxLeafChecks, unsigned int nbQueries = 200) const;
+
+  /** Set the smallest maximum number of leaf checks (among powers of
+   *  two) whose estimated recall reaches the target. A target of 1 or
+   *  more gives an exact search. Returns the estimated recall. */
+  double TuneMaximumLeafChecks(unsigned int k, double targetRecall, unsigned int nbQueries = 200);
+
+private:
+  /** Recursively split the points in [begin, end) */
+  unsigned int BuildNode(unsigned int begin, unsigned int end, std::vector<unsigned int> & order,
+                         const float * points);
+
+  /** Squared distance from a query to the bounding box of a node */
+  float BoxDistance(const float * query, unsigned int node) const;
+
+  struct NodeType
+  {
+    /** Split feature, -1 for a leaf */
+    int          Feature;
+    float        Threshold;
+    /** Children for an inner node, range of points [Begin, End) for a leaf */
+    unsigned int Left;
+    unsigned int Right;
+    unsigned int Begin;
+    unsigned int End;
+  };
+
+  unsigned int              m_NumberOfPoints;
+  unsigned int              m_NumberOfFeatures;
+  unsigned int              m_LeafSize;
+  unsigned int              m_NumberOfLeaves;
+  unsigned int              m_MaximumLeafChecks;
+
+  std::vector<NodeType>     m_Nodes;
+  /** Bounding boxes, 2 * NumberOfFeatures values per node (min then max) */
+  std::vector<float>        m_Boxes;
+  /** Points in leaf order, and their index in the input order */
+  std::vector<float>        m_Points;
+  std::vector<unsigned int> m_PointIds;
+};
+
+} // end namespace otb
+
+#endif
@@ -23,6 +23,7 @@
 
 #include "itkLightObject.h"
 #include "itkFixedArray.h"
+#include "itkArray.h"
 #include "otbMachineLearningModel.h"
 
 #include "svm.h"
@@ -47,6 +48,7 @@ public:
   typedef typename Superclass::TargetSampleType           TargetSampleType;
   typedef typename Superclass::TargetListSampleType       TargetListSampleType;
   typedef typename Superclass::ConfidenceValueType        ConfidenceValueType;
+  typedef typename Superclass::InputSampleMatrixType      InputSampleMatrixType;
 
   /** enum to choose the way confidence is computed
    *   CM_INDEX : compute the difference between highest and second highest probability
@@ -236,6 +238,26 @@ public:
   itkSetMacro(FineOptimizationNumberOfSteps, unsigned int);
   itkGetMacro(FineOptimizationNumberOfSteps, unsigned int);
 
+  /** Evaluate the grid points of the parameters optimization
+   *  concurrently (default is false). The folds are then drawn once, with
+   *  a fixed seed, and shared by all the grid points, and the
+   *  cross-validation does not compute probability estimates. */
+  itkSetMacro(ParallelOptimization, bool);
+  itkGetMacro(ParallelOptimization, bool);
+  itkBooleanMacro(ParallelOptimization);
+
+  /** Memory budget (in MB) of the parallel optimization, which bounds the
+   *  number of concurrent trainings. 0 means no bound (default). */
+  itkSetMacro(OptimizationMaximumMemory, unsigned int);
+  itkGetMacro(OptimizationMaximumMemory, unsigned int);
+
+  /** Stop the cross-validation of parameters which can not beat the best
+   *  accuracy already found, in the parallel optimization (default is
+   *  true) */
+  itkSetMacro(OptimizationEarlyStopping, bool);
+  itkGetMacro(OptimizationEarlyStopping, bool);
+  itkBooleanMacro(OptimizationEarlyStopping);
+
   void SetConfidenceMode(unsigned int mode)
     {
     if (m_ConfidenceMode != static_cast<ConfidenceMode>(mode) )
@@ -251,6 +273,14 @@ public:
 
   double CrossValidation(void);
 
+  /** Cross-validation accuracy for the C, gamma and coef0 values given in
+   *  parameters (see GetNumberOfKernelParameters()), on the folds of the
+   *  parallel optimization. The model is not modified, so that this
+   *  method can be called concurrently. The evaluation stops as soon as
+   *  the accuracy can not reach minimumAccuracy: an upper bound of the
+   *  accuracy, lower than minimumAccuracy, is then returned. */
+  double CrossValidation(const itk::Array<double> & parameters, double minimumAccuracy = -1.) const;
+
   /** Return number of support vectors */
   unsigned int GetNumberOfSupportVectors(void) const
   {
@@ -264,6 +294,44 @@ public:
     return 0;
     }
 
+  /** If true (default false), the decision functions of models with a linear
+   *  kernel are evaluated with precomputed primal weights: one weight
+   *  vector per decision function instead of one dot product per support
+   *  vector. Samples are predicted by blocks with matrix-vector
+   *  products. Predictions are the same as the ones of libsvm, up to
+   *  rounding errors which may break ties differently, hence the opt-in.
+   *  This flag also enables the random features
+   *  approximation (see SetNumberOfRandomFeatures()). */
+  itkSetMacro(FastPrediction, bool);
+  itkGetMacro(FastPrediction, bool);
+  itkBooleanMacro(FastPrediction);
+
+  /** Approximate RBF kernels with nb random Fourier features (default 0:
+   *  no approximation). The kernel expansion over the support vectors is
+   *  replaced by a linear function of nb features of the sample, so that
+   *  the prediction cost no longer depends on the number of support
+   *  vectors. The approximation error decreases as 1/sqrt(nb): use
+   *  ComputePrimalFormAgreement() on validation samples to check the
+   *  loss of accuracy. */
+  void SetNumberOfRandomFeatures(unsigned int nb);
+  itkGetMacro(NumberOfRandomFeatures, unsigned int);
+
+  /** Seed of the random features (default 0) */
+  void SetRandomFeaturesSeed(unsigned int seed);
+  itkGetMacro(RandomFeaturesSeed, unsigned int);
+
+  /** Is a primal form (linear weights or random features) available for
+   *  the current model */
+  bool HasPrimalForm(void) const
+  {
+    return m_NumberOfDecisionFunctions > 0;
+  }
+
+  /** Fraction of samples for which the primal form and the exact kernel
+   *  expansion give the same prediction. Regression predictions are
+   *  considered equal if their relative difference is below 1e-3. */
+  double ComputePrimalFormAgreement(const InputListSampleType * samples) const;
+
 protected:
   /** Constructor */
   LibSVMMachineLearningModel();
@@ -274,6 +342,11 @@ protected:
   /** Predict values using the model */
   TargetSampleType DoPredict(const InputSampleType& input, ConfidenceValueType *quality=ITK_NULLPTR) const ITK_OVERRIDE;
 
+  /** Predict values of a sample matrix, reusing the same node array for
+   *  all samples. In CM_PROBA and CM_HYPER modes, only the first value is
+   *  stored as the confidence of a sample. */
+  void DoPredictMatrix(const InputSampleMatrixType & input, const unsigned long & startIndex, const unsigned long & size, TargetValueType * targets, ConfidenceValueType * quality = ITK_NULLPTR) const ITK_OVERRIDE;
+
   /** PrintSelf method */
   void PrintSelf(std::ostream& os, itk::Indent indent) const ITK_OVERRIDE;
 
@@ -291,6 +364,40 @@ private:
 
   void OptimizeParameters(void);
 
+  /** Draw the cross-validation folds of the parallel optimization */
+  void PrepareCrossValidationFolds(void);
+
+  /** Number of concurrent trainings of the parallel optimization */
+  unsigned int GetOptimizationNumberOfThreads(void) const;
+
+  /** Predict a sample already converted to svm nodes
+   *  \param x Nodes of the sample, terminated by index -1
+   *  \param probEstimates Array of nr_class values used as workspace
+   *  \param quality Confidence output, or NULL (see ConfidenceMode)
+   */
+  TargetValueType PredictNodes(const struct svm_node * x, double * probEstimates, ConfidenceValueType *quality) const;
+
+  /** Compute the primal form of the decision functions of the model */
+  void UpdatePrimalForm(void);
+
+  /** Should a sample of nbFeatures features be predicted with the primal form */
+  bool UsePrimalForm(unsigned int nbFeatures) const;
+
+  /** Evaluate the decision functions of samples with the primal form.
+   *  \param decValues Output array of nbSamples * NumberOfDecisionFunctions values
+   */
+  void ComputeDecisionValues(const InputValueType * const * samples, unsigned int nbSamples,
+                             unsigned int nbFeatures, double * decValues) const;
+
+  /** Same as PredictNodes(), from the decision values of a sample */
+  TargetValueType PredictDecisionValues(const double * decValues, double * probEstimates, ConfidenceValueType *quality) const;
+
+  /** Label voted by the decision values (as svm_predict_values()) */
+  double VoteDecisionValues(const double * decValues) const;
+
+  /** Class probabilities from the decision values (as svm_predict_probability()) */
+  double ProbabilitiesFromDecisionValues(const double * decValues, double * probEstimates) const;
+
   /** Container to hold the SVM model itself */
   struct svm_model* m_Model;
 
@@ -324,6 +431,40 @@ private:
   /** Temporary array to store cross-validation results */
   std::vector<double> m_TmpTarget;
 
+  bool         m_ParallelOptimization;
+  unsigned int m_OptimizationMaximumMemory;
+  bool         m_OptimizationEarlyStopping;
+
+  /** Folds of the parallel optimization: samples of fold f are
+   *  m_FoldSamples[m_FoldBegin[f]] to m_FoldSamples[m_FoldBegin[f+1]-1].
+   *  The training nodes and targets of each fold are shared by all the
+   *  evaluations. */
+  std::vector<unsigned int>                     m_FoldSamples;
+  std::vector<unsigned int>                     m_FoldBegin;
+  std::vector<std::vector<struct svm_node *> >  m_FoldTrainingNodes;
+  std::vector<std::vector<double> >             m_FoldTrainingTargets;
+
+  /** Use the primal form when available */
+  bool m_FastPrediction;
+
+  /** Number of random Fourier features for RBF kernels (0: exact kernel) */
+  unsigned int m_NumberOfRandomFeatures;
+
+  unsigned int m_RandomFeaturesSeed;
+
+  /** Primal form: one weight vector of PrimalDimension values per
+   *  decision function (nr_class*(nr_class-1)/2 for classification, 1
+   *  otherwise). Inputs have PrimalInputSize features. For random
+   *  features, feature d of a sample x is
+   *  sqrt(2/D) * cos(Projection[d].x + Offsets[d]). */
+  unsigned int        m_NumberOfDecisionFunctions;
+  unsigned int        m_PrimalInputSize;
+  unsigned int        m_PrimalDimension;
+  bool                m_PrimalRandomFeatures;
+  std::vector<double> m_PrimalWeights;
+  std::vector<double> m_RandomFeaturesProjection;
+  std::vector<double> m_RandomFeaturesOffsets;
+
 };
 } // end namespace otb
 
@@ -22,11 +22,17 @@
 #define otbLibSVMMachineLearningModel_txx
 
 #include <fstream>
+#include <algorithm>
 #include "otbLibSVMMachineLearningModel.h"
 #include "otbSVMCrossValidationCostFunction.h"
 #include "otbExhaustiveExponentialOptimizer.h"
 #include "otbMacro.h"
 #include "otbUtils.h"
+#include "otbMath.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkMultiThreader.h"
+#include <cmath>
+#include <map>
 
 namespace otb
 {
@@ -54,6 +60,9 @@ LibSVMMachineLearningModel<TInputValue,TOutputValue>
   this->m_FinalCrossValidationAccuracy = 0.;
   this->m_CoarseOptimizationNumberOfSteps = 5;
   this->m_FineOptimizationNumberOfSteps = 5;
+  this->m_ParallelOptimization = false;
+  this->m_OptimizationMaximumMemory = 0;
+  this->m_OptimizationEarlyStopping = true;
   this->m_ConfidenceMode =
     LibSVMMachineLearningModel<TInputValue,TOutputValue>::CM_INDEX;
 
@@ -66,6 +75,14 @@ LibSVMMachineLearningModel<TInputValue,TOutputValue>
   this->m_Problem.l = 0;
   this->m_Problem.y = ITK_NULLPTR;
   this->m_Problem.x = ITK_NULLPTR;
+
+  this->m_FastPrediction = false;
+  this->m_NumberOfRandomFeatures = 0;
+  this->m_RandomFeaturesSeed = 0;
+  this->m_NumberOfDecisionFunctions = 0;
+  this->m_PrimalInputSize = 0;
+  this->m_PrimalDimension = 0;
+  this->m_PrimalRandomFeatures = false;
 #ifndef OTB_SHOW_ALL_MSG_DEBUG
   svm_set_print_string_function(&otb::Utils::PrintNothing);
 #endif
@@ -101,6 +118,7 @@ LibSVMMachineLearningModel<TInputValue,TOutputValue>
   m_Model = svm_train(&m_Problem, &m_Parameters);
 
   this->m_ConfidenceIndex = this->HasProbabilities();
+  this->UpdatePrimalForm();
 }
 
 template <class TInputValue, class TOutputValue>
@@ -110,13 +128,17 @@ LibSVMMachineLearningModel<TInputValue,TOutputValue>
 ::DoPredict(const InputSampleType & input, ConfidenceValueType *quality) const
 {
   TargetSampleType target;
-  target.Fill(0);
 
-  // Get type and number of classes
-  int svm_type = svm_get_svm_type(m_Model);
+  if (this->UsePrimalForm(input.Size()))
+    {
+    const InputValueType * sample = input.GetDataPointer();
+    std::vector<double> decValues(m_NumberOfDecisionFunctions);
+    std::vector<double> probEstimates(svm_get_nr_class(m_Model));
+    this->ComputeDecisionValues(&sample, 1, input.Size(), &(decValues[0]));
+    target[0] = this->PredictDecisionValues(&(decValues[0]), &(probEstimates[0]), quality);
+    return target;
+    }
 
-  // Allocate nodes (/TODO if performances problems are related to too
-  // many allocations, a cache approach can be set)
   struct svm_node * x = new struct svm_node[input.Size() + 1];
 
   // Fill the node
@@ -130,6 +152,119 @@ LibSVMMachineLearningModel<TInputValue,TOutputValue>
   x[input.Size()].index = -1;
   x[input.Size()].value = 0;
 
+  std::vector<double> probEstimates(svm_get_nr_class(m_Model));
+  target[0] = this->PredictNodes(x, &(probEstimates[0]), quality);
+
+  // Free allocated memory
+  delete[] x;
+
+  return target;
+}
+
+template <class TInputValue, class TOutputValue>
+void
+LibSVMMachineLearningModel<TInputValue,TOutputValue>
+::DoPredictMatrix(const InputSampleMatrixType & input, const unsigned long & startIndex, const unsigned long & size, TargetValueType * targets, ConfidenceValueType * quality) const
+{
+  if (quality != ITK_NULLPTR && !this->m_ConfidenceIndex)
+    {
+    itkExceptionMacro("Confidence index not available for this classifier !");
+    }
+
+  const unsigned int nbFeatures = input.NumberOfFeatures;
+  const unsigned int nr_class = svm_get_nr_class(m_Model);
+  std::vector<double> probEstimates(nr_class);
+  // CM_PROBA and CM_HYPER write up to nr_class*(nr_class-1)/2 values
+  std::vector<ConfidenceValueType> confidences(std::max(1U, nr_class * nr_class));
+
+  if (this->UsePrimalForm(nbFeatures))
+    {
+    // Evaluate the decision functions by blocks of valid samples
+    const unsigned int blockSize = 64;
+    std::vector<const InputValueType *> samples(blockSize);
+    std::vector<unsigned long> ids(blockSize);
+    std::vector<double> decValues(blockSize * m_NumberOfDecisionFunctions);
+
+    unsigned long id = startIndex;
+    while (id < startIndex + size)
+      {
+      unsigned int count = 0;
+      for (; id < startIndex + size && count < blockSize; ++id)
+        {
+        if (input.IsValid(id))
+          {
+          samples[count] = input.GetSample(id);
+          ids[count] = id;
+          ++count;
+          }
+        }
+      if (count == 0)
+        {
+        continue;
+        }
+      this->ComputeDecisionValues(&(samples[0]), count, nbFeatures, &(decValues[0]));
+      for (unsigned int i = 0; i < count; ++i)
+        {
+        const double * sampleDecValues = &(decValues[i * m_NumberOfDecisionFunctions]);
+        if (quality != ITK_NULLPTR)
+          {
+          confidences[0] = 0.0;
+          targets[ids[i]] = this->PredictDecisionValues(sampleDecValues, &(probEstimates[0]), &(confidences[0]));
+          quality[ids[i]] = confidences[0];
+          }
+        else
+          {
+          targets[ids[i]] = this->PredictDecisionValues(sampleDecValues, &(probEstimates[0]), ITK_NULLPTR);
+          }
+        }
+      }
+    return;
+    }
+
+  // Nodes and workspaces are allocated once for the whole range
+  std::vector<struct svm_node> x(nbFeatures + 1);
+  for (unsigned int i = 0 ; i < nbFeatures ; i++)
+    {
+    x[i].index = i + 1;
+    }
+  x[nbFeatures].index = -1;
+  x[nbFeatures].value = 0;
+
+  for (unsigned long id = startIndex ; id < startIndex + size ; ++id)
+    {
+    if (!input.IsValid(id))
+      {
+      continue;
+      }
+    const InputValueType * sample = input.GetSample(id);
+    for (unsigned int i = 0 ; i < nbFeatures ; i++)
+      {
+      x[i].value = sample[i];
+      }
+    if (quality != ITK_NULLPTR)
+      {
+      confidences[0] = 0.0;
+      targets[id] = this->PredictNodes(&(x[0]), &(probEstimates[0]), &(confidences[0]));
+      quality[id] = confidences[0];
+      }
+    else
+      {
+      targets[id] = this->PredictNodes(&(x[0]), &(probEstimates[0]), ITK_NULLPTR);
+      }
+    }
+}
+
+template <class TInputValue, class TOutputValue>
+typename LibSVMMachineLearningModel<TInputValue,TOutputValue>
+::TargetValueType
+LibSVMMachineLearningModel<TInputValue,TOutputValue>
+::PredictNodes(const struct svm_node * x, double * probEstimates, ConfidenceValueType *quality) const
+{
+  TargetValueType target = 0;
+
+  // Get type and number of classes
+  int svm_type = svm_get_svm_type(m_Model);
+
   if (quality != ITK_NULLPTR)
     {
     if (!this->m_ConfidenceIndex)
@@ -140,32 +275,28 @@ LibSVMMachineLearningModel<TInputValue,TOutputValue>
       {
       if (svm_type == C_SVC || svm_type == NU_SVC)
         {
-        // Eventually allocate space for probabilities
         unsigned int nr_class = svm_get_nr_class(m_Model);
-        double *prob_estimates = new double[nr_class];
         // predict
-        target[0] = static_cast<TargetValueType>(svm_predict_probability(m_Model, x, prob_estimates));
+        target = static_cast<TargetValueType>(svm_predict_probability(m_Model, x, probEstimates));
         double maxProb = 0.0;
         double secProb = 0.0;
         for (unsigned int i=0 ; i< nr_class ; ++i)
           {
-          if (maxProb < prob_estimates[i])
+          if (maxProb < probEstimates[i])
             {
             secProb = maxProb;
-            maxProb = prob_estimates[i];
+            maxProb = probEstimates[i];
             }
-          else if (secProb < prob_estimates[i])
+          else if (secProb < probEstimates[i])
             {
-            secProb = prob_estimates[i];
+            secProb = probEstimates[i];
             }
           }
         (*quality) = static_cast<ConfidenceValueType>(maxProb - secProb);
-
-        delete[] prob_estimates;
         }
       else
         {
-        target[0] = static_cast<TargetValueType>(svm_predict(m_Model, x));
+        target = static_cast<TargetValueType>(svm_predict(m_Model, x));
         // Prob. model for test data: target value = predicted value + z
         // z: Laplace distribution e^(-|z|/sigma)/(2sigma)
         // sigma is output as confidence index
@@ -174,11 +305,11 @@ LibSVMMachineLearningModel<TInputValue,TOutputValue>
       }
     else if (this->m_ConfidenceMode == CM_PROBA)
       {
-      target[0] = static_cast<TargetValueType>(svm_predict_probability(m_Model, x, quality));
+      target = static_cast<TargetValueType>(svm_predict_probability(m_Model, x, quality));
       }
     else if (this->m_ConfidenceMode == CM_HYPER)
       {
-      target[0] = static_cast<TargetValueType>(svm_predict_values(m_Model, x, quality));
+      target = static_cast<TargetValueType>(svm_predict_values(m_Model, x, quality));
       }
     }
   else
@@ -187,23 +318,517 @@ LibSVMMachineLearningModel<TInputValue,TOutputValue>
     // which gives different results than svm_predict()
     if (svm_check_probability_model(m_Model))
       {
-      unsigned int nr_class = svm_get_nr_class(m_Model);
-      double *prob_estimates = new double[nr_class];
-      target[0] = static_cast<TargetValueType>(svm_predict_probability(m_Model, x, prob_estimates));
-      delete[] prob_estimates;
+      target = static_cast<TargetValueType>(svm_predict_probability(m_Model, x, probEstimates));
       }
     else
       {
-      target[0] = static_cast<TargetValueType>(svm_predict(m_Model, x));
+      target = static_cast<TargetValueType>(svm_predict(m_Model, x));
       }
     }
 
-  // Free allocated memory
-  delete[] x;
+  return target;
+}
+
+template <class TInputValue, class TOutputValue>
+void
+LibSVMMachineLearningModel<TInputValue,TOutputValue>
+::SetNumberOfRandomFeatures(unsigned int nb)
+{
+  if (m_NumberOfRandomFeatures != nb)
+    {
+    m_NumberOfRandomFeatures = nb;
+    this->UpdatePrimalForm();
+    this->Modified();
+    }
+}
+
+template <class TInputValue, class TOutputValue>
+void
+LibSVMMachineLearningModel<TInputValue,TOutputValue>
+::SetRandomFeaturesSeed(unsigned int seed)
+{
+  if (m_RandomFeaturesSeed != seed)
+    {
+    m_RandomFeaturesSeed = seed;
+    this->UpdatePrimalForm();
+    this->Modified();
+    }
+}
+
+template <class TInputValue, class TOutputValue>
+void
+LibSVMMachineLearningModel<TInputValue,TOutputValue>
+::UpdatePrimalForm()
+{
+  m_NumberOfDecisionFunctions = 0;
+  m_PrimalInputSize = 0;
+  m_PrimalDimension = 0;
+  m_PrimalRandomFeatures = false;
+  m_PrimalWeights.clear();
+  m_RandomFeaturesProjection.clear();
+  m_RandomFeaturesOffsets.clear();
+
+  if (m_Model == ITK_NULLPTR || m_Model->l == 0)
+    {
+    return;
+    }
+  const int kernelType = m_Model->param.kernel_type;
+  if (kernelType != LINEAR && !(kernelType == RBF && m_NumberOfRandomFeatures > 0))
+    {
+    return;
+    }
+
+  // Number of input features: largest index of the support vectors
+  const int l = m_Model->l;
+  for (int k = 0; k < l; ++k)
+    {
+    for (const struct svm_node * node = m_Model->SV[k]; node->index != -1; ++node)
+      {
+      m_PrimalInputSize = std::max(m_PrimalInputSize, static_cast<unsigned int>(node->index));
+      }
+    }
+  if (m_PrimalInputSize == 0)
+    {
+    return;
+    }
+
+  // Coordinates of the support vectors in the primal space
+  std::vector<double> primalSV;
+  if (kernelType == LINEAR)
+    {
+    m_PrimalDimension = m_PrimalInputSize;
+    primalSV.assign(static_cast<size_t>(l) * m_PrimalDimension, 0.0);
+    for (int k = 0; k < l; ++k)
+      {
+      for (const struct svm_node * node = m_Model->SV[k]; node->index != -1; ++node)
+        {
+        primalSV[static_cast<size_t>(k) * m_PrimalDimension + node->index - 1] = node->value;
+        }
+      }
+    }
+  else
+    {
+    // exp(-gamma*|u-v|^2) is the expectation of 2*cos(w.u+b)*cos(w.v+b)
+    // for w ~ N(0, 2*gamma*I) and b ~ U[0, 2*pi]
+    m_PrimalRandomFeatures = true;
+    m_PrimalDimension = m_NumberOfRandomFeatures;
+    typedef itk::Statistics::MersenneTwisterRandomVariateGenerator GeneratorType;
+    GeneratorType::Pointer generator = GeneratorType::New();
+    generator->SetSeed(m_RandomFeaturesSeed);
+    m_RandomFeaturesProjection.resize(static_cast<size_t>(m_PrimalDimension) * m_PrimalInputSize);
+    m_RandomFeaturesOffsets.resize(m_PrimalDimension);
+    for (size_t i = 0; i < m_RandomFeaturesProjection.size(); ++i)
+      {
+      m_RandomFeaturesProjection[i] = generator->GetNormalVariate(0.0, 2.0 * m_Model->param.gamma);
+      }
+    for (unsigned int d = 0; d < m_PrimalDimension; ++d)
+      {
+      m_RandomFeaturesOffsets[d] = generator->GetUniformVariate(0.0, 2.0 * CONST_PI);
+      }
+
+    std::vector<double> dense(m_PrimalInputSize);
+    primalSV.resize(static_cast<size_t>(l) * m_PrimalDimension);
+    const double scale = std::sqrt(2.0 / m_PrimalDimension);
+    for (int k = 0; k < l; ++k)
+      {
+      std::fill(dense.begin(), dense.end(), 0.0);
+      for (const struct svm_node * node = m_Model->SV[k]; node->index != -1; ++node)
+        {
+        dense[node->index - 1] = node->value;
+        }
+      for (unsigned int d = 0; d < m_PrimalDimension; ++d)
+        {
+        const double * projection = &(m_RandomFeaturesProjection[static_cast<size_t>(d) * m_PrimalInputSize]);
+        double v = m_RandomFeaturesOffsets[d];
+        for (unsigned int f = 0; f < m_PrimalInputSize; ++f)
+          {
+          v += projection[f] * dense[f];
+          }
+        primalSV[static_cast<size_t>(k) * m_PrimalDimension + d] = scale * std::cos(v);
+        }
+      }
+    }
+
+  // Weights of the decision functions, same support vectors and
+  // coefficients as svm_predict_values()
+  const int svmType = m_Model->param.svm_type;
+  const unsigned int dim = m_PrimalDimension;
+  if (svmType == ONE_CLASS || svmType == EPSILON_SVR || svmType == NU_SVR)
+    {
+    m_PrimalWeights.assign(dim, 0.0);
+    for (int k = 0; k < l; ++k)
+      {
+      const double coef = m_Model->sv_coef[0][k];
+      for (unsigned int d = 0; d < dim; ++d)
+        {
+        m_PrimalWeights[d] += coef * primalSV[static_cast<size_t>(k) * dim + d];
+        }
+      }
+    m_NumberOfDecisionFunctions = 1;
+    return;
+    }
+
+  const int nr_class = m_Model->nr_class;
+  std::vector<int> start(nr_class, 0);
+  for (int i = 1; i < nr_class; ++i)
+    {
+    start[i] = start[i-1] + m_Model->nSV[i-1];
+    }
+  const unsigned int nbFunctions = static_cast<unsigned int>(nr_class * (nr_class - 1) / 2);
+  m_PrimalWeights.assign(static_cast<size_t>(nbFunctions) * dim, 0.0);
+  unsigned int p = 0;
+  for (int i = 0; i < nr_class; ++i)
+    {
+    for (int j = i + 1; j < nr_class; ++j, ++p)
+      {
+      double * weights = &(m_PrimalWeights[static_cast<size_t>(p) * dim]);
+      const double * coef1 = m_Model->sv_coef[j-1];
+      const double * coef2 = m_Model->sv_coef[i];
+      for (int k = start[i]; k < start[i] + m_Model->nSV[i]; ++k)
+        {
+        for (unsigned int d = 0; d < dim; ++d)
+          {
+          weights[d] += coef1[k] * primalSV[static_cast<size_t>(k) * dim + d];
+          }
+        }
+      for (int k = start[j]; k < start[j] + m_Model->nSV[j]; ++k)
+        {
+        for (unsigned int d = 0; d < dim; ++d)
+          {
+          weights[d] += coef2[k] * primalSV[static_cast<size_t>(k) * dim + d];
+          }
+        }
+      }
+    }
+  m_NumberOfDecisionFunctions = nbFunctions;
+}
+
+template <class TInputValue, class TOutputValue>
+bool
+LibSVMMachineLearningModel<TInputValue,TOutputValue>
+::UsePrimalForm(unsigned int nbFeatures) const
+{
+  // Missing features are zeros, as in libsvm. Extra features are
+  // ignored by linear kernels, but they change RBF kernel values.
+  return m_FastPrediction && this->HasPrimalForm()
+    && (!m_PrimalRandomFeatures || nbFeatures <= m_PrimalInputSize);
+}
+
+template <class TInputValue, class TOutputValue>
+void
+LibSVMMachineLearningModel<TInputValue,TOutputValue>
+::ComputeDecisionValues(const InputValueType * const * samples, unsigned int nbSamples,
+                        unsigned int nbFeatures, double * decValues) const
+{
+  const unsigned int nbFunctions = m_NumberOfDecisionFunctions;
+  const unsigned int dim = m_PrimalDimension;
+  const unsigned int nbInputs = std::min(nbFeatures, m_PrimalInputSize);
+
+  // Primal coordinates of the samples
+  std::vector<double> primal(static_cast<size_t>(nbSamples) * dim, 0.0);
+  if (m_PrimalRandomFeatures)
+    {
+    const double scale = std::sqrt(2.0 / dim);
+    for (unsigned int s = 0; s < nbSamples; ++s)
+      {
+      const InputValueType * x = samples[s];
+      double * z = &(primal[static_cast<size_t>(s) * dim]);
+      for (unsigned int d = 0; d < dim; ++d)
+        {
+        const double * projection = &(m_RandomFeaturesProjection[static_cast<size_t>(d) * m_PrimalInputSize]);
+        double v = m_RandomFeaturesOffsets[d];
+        for (unsigned int f = 0; f < nbInputs; ++f)
+          {
+          v += projection[f] * static_cast<double>(x[f]);
+          }
+        z[d] = scale * std::cos(v);
+        }
+      }
+    }
+  else
+    {
+    for (unsigned int s = 0; s < nbSamples; ++s)
+      {
+      std::copy(samples[s], samples[s] + nbInputs, primal.begin() + static_cast<size_t>(s) * dim);
+      }
+    }
+
+  // Matrix product: each weight vector is applied to the whole block
+  for (unsigned int p = 0; p < nbFunctions; ++p)
+    {
+    const double * weights = &(m_PrimalWeights[static_cast<size_t>(p) * dim]);
+    const double rho = m_Model->rho[p];
+    for (unsigned int s = 0; s < nbSamples; ++s)
+      {
+      const double * z = &(primal[static_cast<size_t>(s) * dim]);
+      double sum = 0.0;
+      for (unsigned int d = 0; d < dim; ++d)
+        {
+        sum += weights[d] * z[d];
+        }
+      decValues[static_cast<size_t>(s) * nbFunctions + p] = sum - rho;
+      }
+    }
+}
+
+template <class TInputValue, class TOutputValue>
+double
+LibSVMMachineLearningModel<TInputValue,TOutputValue>
+::VoteDecisionValues(const double * decValues) const
+{
+  const int svmType = m_Model->param.svm_type;
+  if (svmType == ONE_CLASS)
+    {
+    return (decValues[0] > 0) ? 1 : -1;
+    }
+  if (svmType == EPSILON_SVR || svmType == NU_SVR)
+    {
+    return decValues[0];
+    }
+
+  const int nr_class = m_Model->nr_class;
+  std::vector<int> vote(nr_class, 0);
+  int p = 0;
+  for (int i = 0; i < nr_class; ++i)
+    {
+    for (int j = i + 1; j < nr_class; ++j, ++p)
+      {
+      if (decValues[p] > 0)
+        ++vote[i];
+      else
+        ++vote[j];
+      }
+    }
+  int voteMaxIdx = 0;
+  for (int i = 1; i < nr_class; ++i)
+    {
+    if (vote[i] > vote[voteMaxIdx])
+      {
+      voteMaxIdx = i;
+      }
+    }
+  return m_Model->label[voteMaxIdx];
+}
+
+template <class TInputValue, class TOutputValue>
+double
+LibSVMMachineLearningModel<TInputValue,TOutputValue>
+::ProbabilitiesFromDecisionValues(const double * decValues, double * probEstimates) const
+{
+  const int svmType = m_Model->param.svm_type;
+  if (!((svmType == C_SVC || svmType == NU_SVC) && m_Model->probA != ITK_NULLPTR && m_Model->probB != ITK_NULLPTR))
+    {
+    return this->VoteDecisionValues(decValues);
+    }
+
+  // Pairwise probabilities (sigmoid_predict() of libsvm)
+  const int k = m_Model->nr_class;
+  const double minProb = 1e-7;
+  std::vector<double> r(k * k, 0.0);
+  int p = 0;
+  for (int i = 0; i < k; ++i)
+    {
+    for (int j = i + 1; j < k; ++j, ++p)
+      {
+      const double fApB = decValues[p] * m_Model->probA[p] + m_Model->probB[p];
+      const double sigmoid = (fApB >= 0) ? std::exp(-fApB) / (1.0 + std::exp(-fApB)) : 1.0 / (1 + std::exp(fApB));
+      r[i * k + j] = std::min(std::max(sigmoid, minProb), 1 - minProb);
+      r[j * k + i] = 1 - r[i * k + j];
+      }
+    }
+
+  if (k == 2)
+    {
+    probEstimates[0] = r[1];
+    probEstimates[1] = r[k];
+    }
+  else
+    {
+    // Pairwise coupling (multiclass_probability() of libsvm, method 2 of
+    // Wu, Lin and Weng)
+    const int maxIter = std::max(100, k);
+    const double eps = 0.005 / k;
+    std::vector<double> Q(k * k);
+    std::vector<double> Qp(k);
+    for (int t = 0; t < k; ++t)
+      {
+      probEstimates[t] = 1.0 / k;
+      Q[t * k + t] = 0;
+      for (int j = 0; j < t; ++j)
+        {
+        Q[t * k + t] += r[j * k + t] * r[j * k + t];
+        Q[t * k + j] = Q[j * k + t];
+        }
+      for (int j = t + 1; j < k; ++j)
+        {
+        Q[t * k + t] += r[j * k + t] * r[j * k + t];
+        Q[t * k + j] = -r[j * k + t] * r[t * k + j];
+        }
+      }
+    for (int iter = 0; iter < maxIter; ++iter)
+      {
+      // stopping condition, recalculate QP,pQP for numerical accuracy
+      double pQp = 0;
+      for (int t = 0; t < k; ++t)
+        {
+        Qp[t] = 0;
+        for (int j = 0; j < k; ++j)
+          {
+          Qp[t] += Q[t * k + j] * probEstimates[j];
+          }
+        pQp += probEstimates[t] * Qp[t];
+        }
+      double maxError = 0;
+      for (int t = 0; t < k; ++t)
+        {
+        const double error = std::fabs(Qp[t] - pQp);
+        if (error > maxError)
+          {
+          maxError = error;
+          }
+        }
+      if (maxError < eps)
+        {
+        break;
+        }
+      for (int t = 0; t < k; ++t)
+        {
+        const double diff = (-Qp[t] + pQp) / Q[t * k + t];
+        probEstimates[t] += diff;
+        pQp = (pQp + diff * (diff * Q[t * k + t] + 2 * Qp[t])) / (1 + diff) / (1 + diff);
+        for (int j = 0; j < k; ++j)
+          {
+          Qp[j] = (Qp[j] + diff * Q[t * k + j]) / (1 + diff);
+          probEstimates[j] /= (1 + diff);
+          }
+        }
+      }
+    }
+
+  int probMaxIdx = 0;
+  for (int i = 1; i < k; ++i)
+    {
+    if (probEstimates[i] > probEstimates[probMaxIdx])
+      {
+      probMaxIdx = i;
+      }
+    }
+  return m_Model->label[probMaxIdx];
+}
+
+template <class TInputValue, class TOutputValue>
+typename LibSVMMachineLearningModel<TInputValue,TOutputValue>
+::TargetValueType
+LibSVMMachineLearningModel<TInputValue,TOutputValue>
+::PredictDecisionValues(const double * decValues, double * probEstimates, ConfidenceValueType *quality) const
+{
+  TargetValueType target = 0;
+  const int svm_type = svm_get_svm_type(m_Model);
+
+  if (quality != ITK_NULLPTR)
+    {
+    if (!this->m_ConfidenceIndex)
+      {
+      itkExceptionMacro("Confidence index not available for this classifier !");
+      }
+    if (this->m_ConfidenceMode == CM_INDEX)
+      {
+      if (svm_type == C_SVC || svm_type == NU_SVC)
+        {
+        const unsigned int nr_class = svm_get_nr_class(m_Model);
+        target = static_cast<TargetValueType>(this->ProbabilitiesFromDecisionValues(decValues, probEstimates));
+        double maxProb = 0.0;
+        double secProb = 0.0;
+        for (unsigned int i = 0 ; i < nr_class ; ++i)
+          {
+          if (maxProb < probEstimates[i])
+            {
+            secProb = maxProb;
+            maxProb = probEstimates[i];
+            }
+          else if (secProb < probEstimates[i])
+            {
+            secProb = probEstimates[i];
+            }
+          }
+        (*quality) = static_cast<ConfidenceValueType>(maxProb - secProb);
+        }
+      else
+        {
+        target = static_cast<TargetValueType>(this->VoteDecisionValues(decValues));
+        (*quality) = svm_get_svr_probability(m_Model);
+        }
+      }
+    else if (this->m_ConfidenceMode == CM_PROBA)
+      {
+      target = static_cast<TargetValueType>(this->ProbabilitiesFromDecisionValues(decValues, quality));
+      }
+    else if (this->m_ConfidenceMode == CM_HYPER)
+      {
+      target = static_cast<TargetValueType>(this->VoteDecisionValues(decValues));
+      std::copy(decValues, decValues + m_NumberOfDecisionFunctions, quality);
+      }
+    }
+  else
+    {
+    // same default as PredictNodes()
+    if (svm_check_probability_model(m_Model))
+      {
+      target = static_cast<TargetValueType>(this->ProbabilitiesFromDecisionValues(decValues, probEstimates));
+      }
+    else
+      {
+      target = static_cast<TargetValueType>(this->VoteDecisionValues(decValues));
+      }
+    }
 
   return target;
 }
 
+template <class TInputValue, class TOutputValue>
+double
+LibSVMMachineLearningModel<TInputValue,TOutputValue>
+::ComputePrimalFormAgreement(const InputListSampleType * samples) const
+{
+  if (!this->HasPrimalForm() || samples == ITK_NULLPTR || samples->Size() == 0)
+    {
+    return 1.0;
+    }
+
+  const unsigned int nbFeatures = samples->GetMeasurementVectorSize();
+  const bool regression = (m_Model->param.svm_type == EPSILON_SVR || m_Model->param.svm_type == NU_SVR);
+  std::vector<struct svm_node> x(nbFeatures + 1);
+  for (unsigned int i = 0 ; i < nbFeatures ; i++)
+    {
+    x[i].index = i + 1;
+    }
+  x[nbFeatures].index = -1;
+  x[nbFeatures].value = 0;
+  std::vector<double> probEstimates(svm_get_nr_class(m_Model));
+  std::vector<double> decValues(m_NumberOfDecisionFunctions);
+
+  unsigned long nbAgreements = 0;
+  for (typename InputListSampleType::ConstIterator it = samples->Begin(); it != samples->End(); ++it)
+    {
+    const InputSampleType & sample = it.GetMeasurementVector();
+    for (unsigned int i = 0 ; i < nbFeatures ; i++)
+      {
+      x[i].value = sample[i];
+      }
+    const double exact = this->PredictNodes(&(x[0]), &(probEstimates[0]), ITK_NULLPTR);
+
+    const InputValueType * values = sample.GetDataPointer();
+    this->ComputeDecisionValues(&values, 1, nbFeatures, &(decValues[0]));
+    const double approx = this->PredictDecisionValues(&(decValues[0]), &(probEstimates[0]), ITK_NULLPTR);
+
+    if (regression ? (std::fabs(approx - exact) <= 1e-3 * std::max(1.0, std::fabs(exact))) : (approx == exact))
+      {
+      ++nbAgreements;
+      }
+    }
+  return static_cast<double>(nbAgreements) / samples->Size();
+}
+
 template <class TInputValue, class TOutputValue>
 void
 LibSVMMachineLearningModel<TInputValue,TOutputValue>
@@ -229,6 +854,7 @@ LibSVMMachineLearningModel<TInputValue,TOutputValue>
   m_Parameters = m_Model->param;
 
   this->m_ConfidenceIndex = this->HasProbabilities();
+  this->UpdatePrimalForm();
 }
 
 template <class TInputValue, class TOutputValue>
@@ -415,6 +1041,7 @@ LibSVMMachineLearningModel<TInputValue,TOutputValue>
     svm_free_and_destroy_model(&m_Model);
     }
   m_Model = ITK_NULLPTR;
+  this->UpdatePrimalForm();
 }
 
 template <class TInputValue, class TOutputValue>
@@ -478,6 +1105,146 @@ LibSVMMachineLearningModel<TInputValue,TOutputValue>
   return accuracy;
 }
 
+template <class TInputValue, class TOutputValue>
+void
+LibSVMMachineLearningModel<TInputValue,TOutputValue>
+::PrepareCrossValidationFolds()
+{
+  const unsigned int length = static_cast<unsigned int>(m_Problem.l);
+  const unsigned int nbFolds = std::max(1U, std::min(m_CVFolders, length));
+
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
+  RandomGeneratorType::Pointer random = RandomGeneratorType::New();
+  random->SetSeed(0);
+
+  // Shuffle the samples of each class (all the samples for regression and
+  // one class SVM), then deal them to the folds so that folds are
+  // stratified
+  const bool stratified = !this->m_RegressionMode
+    && (m_Parameters.svm_type == C_SVC || m_Parameters.svm_type == NU_SVC);
+  std::map<double, std::vector<unsigned int> > groups;
+  for (unsigned int i = 0; i < length; ++i)
+    {
+    groups[stratified ? m_Problem.y[i] : 0.].push_back(i);
+    }
+
+  std::vector<std::vector<unsigned int> > folds(nbFolds);
+  unsigned int dealt = 0;
+  for (typename std::map<double, std::vector<unsigned int> >::iterator gIt = groups.begin();
+       gIt != groups.end(); ++gIt)
+    {
+    std::vector<unsigned int> & group = gIt->second;
+    for (unsigned int i = 0; i + 1 < group.size(); ++i)
+      {
+      const unsigned int j = i + random->GetIntegerVariate(static_cast<unsigned int>(group.size()) - 1 - i);
+      std::swap(group[i], group[j]);
+      }
+    for (unsigned int i = 0; i < group.size(); ++i, ++dealt)
+      {
+      folds[dealt % nbFolds].push_back(group[i]);
+      }
+    }
+
+  std::vector<unsigned int> foldOfSample(length);
+  m_FoldSamples.clear();
+  m_FoldBegin.assign(1, 0);
+  for (unsigned int f = 0; f < nbFolds; ++f)
+    {
+    for (unsigned int i = 0; i < folds[f].size(); ++i)
+      {
+      foldOfSample[folds[f][i]] = f;
+      m_FoldSamples.push_back(folds[f][i]);
+      }
+    m_FoldBegin.push_back(static_cast<unsigned int>(m_FoldSamples.size()));
+    }
+
+  // Training sets, pointing to the nodes of the problem
+  m_FoldTrainingNodes.assign(nbFolds, std::vector<struct svm_node *>());
+  m_FoldTrainingTargets.assign(nbFolds, std::vector<double>());
+  for (unsigned int f = 0; f < nbFolds; ++f)
+    {
+    m_FoldTrainingNodes[f].reserve(length - folds[f].size());
+    m_FoldTrainingTargets[f].reserve(length - folds[f].size());
+    for (unsigned int i = 0; i < length; ++i)
+      {
+      if (foldOfSample[i] != f)
+        {
+        m_FoldTrainingNodes[f].push_back(m_Problem.x[i]);
+        m_FoldTrainingTargets[f].push_back(m_Problem.y[i]);
+        }
+      }
+    }
+}
+
+template <class TInputValue, class TOutputValue>
+double
+LibSVMMachineLearningModel<TInputValue,TOutputValue>
+::CrossValidation(const itk::Array<double> & parameters, double minimumAccuracy) const
+{
+  const unsigned int length = static_cast<unsigned int>(m_FoldSamples.size());
+  if (length == 0 || parameters.GetSize() == 0)
+    {
+    return 0.;
+    }
+
+  struct svm_parameter param = m_Parameters;
+  param.C = parameters[0];
+  if (parameters.GetSize() > 1) param.gamma = parameters[1];
+  if (parameters.GetSize() > 2) param.coef0 = parameters[2];
+  param.probability = 0;
+
+  double correct = 0.;
+  for (unsigned int f = 0; f + 1 < m_FoldBegin.size(); ++f)
+    {
+    const std::vector<struct svm_node *> & nodes = m_FoldTrainingNodes[f];
+    if (nodes.empty())
+      {
+      continue;
+      }
+    struct svm_problem problem;
+    problem.l = static_cast<int>(nodes.size());
+    problem.x = const_cast<struct svm_node **>(&nodes[0]);
+    problem.y = const_cast<double *>(&(m_FoldTrainingTargets[f][0]));
+
+    struct svm_model * model = svm_train(&problem, &param);
+    for (unsigned int i = m_FoldBegin[f]; i < m_FoldBegin[f + 1]; ++i)
+      {
+      const unsigned int sample = m_FoldSamples[i];
+      if (svm_predict(model, m_Problem.x[sample]) == m_Problem.y[sample])
+        {
+        ++correct;
+        }
+      }
+    svm_free_and_destroy_model(&model);
+
+    // Best accuracy these parameters can still reach
+    const double bound = (correct + static_cast<double>(length - m_FoldBegin[f + 1])) / length;
+    if (bound < minimumAccuracy)
+      {
+      return bound;
+      }
+    }
+
+  return correct / length;
+}
+
+template <class TInputValue, class TOutputValue>
+unsigned int
+LibSVMMachineLearningModel<TInputValue,TOutputValue>
+::GetOptimizationNumberOfThreads() const
+{
+  unsigned int nbThreads = itk::MultiThreader::GetGlobalDefaultNumberOfThreads();
+  if (m_OptimizationMaximumMemory > 0)
+    {
+    // Each training holds a kernel cache and the index of its problem
+    const double trainingMemory = m_Parameters.cache_size
+      + static_cast<double>(m_Problem.l) * (sizeof(struct svm_node *) + 2 * sizeof(double)) / (1024. * 1024.);
+    const unsigned int maxThreads = static_cast<unsigned int>(m_OptimizationMaximumMemory / trainingMemory);
+    nbThreads = std::min(nbThreads, maxThreads);
+    }
+  return std::max(1U, nbThreads);
+}
+
 template <class TInputValue, class TOutputValue>
 void
 LibSVMMachineLearningModel<TInputValue,TOutputValue>
@@ -487,6 +1254,14 @@ LibSVMMachineLearningModel<TInputValue,TOutputValue>
   typename CrossValidationFunctionType::Pointer crossValidationFunction = CrossValidationFunctionType::New();
   crossValidationFunction->SetModel(this);
 
+  unsigned int nbThreads = 1;
+  if (m_ParallelOptimization)
+    {
+    this->PrepareCrossValidationFolds();
+    crossValidationFunction->SetEarlyStopping(m_OptimizationEarlyStopping);
+    nbThreads = this->GetOptimizationNumberOfThreads();
+    }
+
   typename CrossValidationFunctionType::ParametersType initialParameters, coarseBestParameters, fineBestParameters;
 
   unsigned int nbParams = this->GetNumberOfKernelParameters();
@@ -509,6 +1284,7 @@ LibSVMMachineLearningModel<TInputValue,TOutputValue>
     coarseNbSteps.Fill(m_CoarseOptimizationNumberOfSteps);
 
     coarseOptimizer->SetNumberOfSteps(coarseNbSteps);
+    coarseOptimizer->SetNumberOfThreads(nbThreads);
     coarseOptimizer->SetCostFunction(crossValidationFunction);
     coarseOptimizer->SetInitialPosition(initialParameters);
     coarseOptimizer->StartOptimization();
@@ -528,6 +1304,7 @@ LibSVMMachineLearningModel<TInputValue,TOutputValue>
 
     fineOptimizer->SetNumberOfSteps(fineNbSteps);
     fineOptimizer->SetStepLength(stepLength);
+    fineOptimizer->SetNumberOfThreads(nbThreads);
     fineOptimizer->SetCostFunction(crossValidationFunction);
     fineOptimizer->SetInitialPosition(coarseBestParameters);
     fineOptimizer->StartOptimization();
@@ -545,6 +1322,11 @@ LibSVMMachineLearningModel<TInputValue,TOutputValue>
     if (nbParams > 1) this->SetKernelGamma(fineBestParameters[1]);
     if (nbParams > 2) this->SetKernelCoef0(fineBestParameters[2]);
     }
+
+  m_FoldSamples.clear();
+  m_FoldBegin.clear();
+  m_FoldTrainingNodes.clear();
+  m_FoldTrainingTargets.clear();
 }
 
 } //end namespace otb
@@ -23,6 +23,7 @@
 
 #include "otbMachineLearningModelFactory.h"
 #include "otbConfigure.h"
+#include "otbFlatRandomForestMachineLearningModelFactory.h"
 
 #ifdef OTB_USE_OPENCV
 #include "otb_opencv_api.h"
@@ -104,7 +105,11 @@ MachineLearningModelFactory<TInputValue,TOutputValue>
 ::RegisterBuiltInFactories()
 {
   itk::MutexLockHolder<itk::SimpleMutexLock> lockHolder(mutex);
-  
+
+  // Binary flat forests are recognized by their signature: registered
+  // first so that other models never try to parse them
+  RegisterFactory(FlatRandomForestMachineLearningModelFactory<TInputValue,TOutputValue>::New());
+
 #ifdef OTB_USE_LIBSVM
   RegisterFactory(LibSVMMachineLearningModelFactory<TInputValue,TOutputValue>::New());
 #endif
@@ -152,6 +157,14 @@ MachineLearningModelFactory<TInputValue,TOutputValue>
 
   for (itFac = factories.begin(); itFac != factories.end() ; ++itFac)
     {
+    FlatRandomForestMachineLearningModelFactory<TInputValue,TOutputValue> *flatRFFactory =
+      dynamic_cast<FlatRandomForestMachineLearningModelFactory<TInputValue,TOutputValue> *>(*itFac);
+    if (flatRFFactory)
+      {
+      itk::ObjectFactoryBase::UnRegisterFactory(flatRFFactory);
+      continue;
+      }
+
 #ifdef OTB_USE_LIBSVM
     LibSVMMachineLearningModelFactory<TInputValue,TOutputValue> *libsvmFactory =
       dynamic_cast<LibSVMMachineLearningModelFactory<TInputValue,TOutputValue> *>(*itFac);
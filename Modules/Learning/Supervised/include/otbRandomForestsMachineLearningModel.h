@@ -51,6 +51,7 @@ public:
   typedef typename Superclass::TargetSampleType           TargetSampleType;
   typedef typename Superclass::TargetListSampleType       TargetListSampleType;
   typedef typename Superclass::ConfidenceValueType        ConfidenceValueType;
+  typedef typename Superclass::InputSampleMatrixType      InputSampleMatrixType;
   
   // Other
   typedef itk::VariableSizeMatrix<float>                VariableImportanceMatrixType;
@@ -125,6 +126,21 @@ public:
   itkGetMacro(ComputeMargin, bool);
   itkSetMacro(ComputeMargin, bool);
 
+  /** If true (default), batch predictions of classification forests use
+   *  a FlatRandomForest built from the trained or loaded model. Results
+   *  are the same as the ones of the OpenCV forest. */
+  itkGetMacro(UseFlatForest, bool);
+  itkSetMacro(UseFlatForest, bool);
+  itkBooleanMacro(UseFlatForest);
+
+  /** Flat copy of the trained or loaded forest, empty for regression
+   *  forests and forests with categorical splits. It can be saved in the
+   *  binary flat forest format. */
+  const FlatRandomForest & GetFlatForest() const
+  {
+    return m_FlatForest;
+  }
+
   /** Returns a matrix containing variable importance */
   VariableImportanceMatrixType GetVariableImportance();
   
@@ -140,6 +156,9 @@ protected:
   /** Predict values using the model */
   TargetSampleType DoPredict(const InputSampleType& input, ConfidenceValueType *quality=ITK_NULLPTR) const ITK_OVERRIDE;
 
+  /** Predict a sample matrix, reusing the same OpenCV row for all samples */
+  void DoPredictMatrix(const InputSampleMatrixType & input, const unsigned long & startIndex, const unsigned long & size, TargetValueType * targets, ConfidenceValueType * quality = ITK_NULLPTR) const ITK_OVERRIDE;
+
   
   /** PrintSelf method */
   void PrintSelf(std::ostream& os, itk::Indent indent) const ITK_OVERRIDE;
@@ -154,6 +173,9 @@ private:
   RandomForestsMachineLearningModel(const Self &); //purposely not implemented
   void operator =(const Self&); //purposely not implemented
 
+  /** Rebuild the flat forest from the OpenCV model */
+  void UpdateFlatForest();
+
 #ifdef OTB_OPENCV_3
   cv::Ptr<CvRTreesWrapper> m_RFModel;
 #else
@@ -222,6 +244,10 @@ private:
    * 2 most voted classes) instead of confidence (probability of the most
    * voted class) in prediction*/
   bool m_ComputeMargin;
+  /** Use the flat forest for batch predictions */
+  bool m_UseFlatForest;
+  /** Flat copy of the forest, empty if the model can not be converted */
+  FlatRandomForest m_FlatForest;
 };
 } // end namespace otb
 
@@ -25,6 +25,7 @@
 #include "itkMacro.h"
 #include "otbRandomForestsMachineLearningModel.h"
 #include "otbOpenCVUtils.h"
+#include "otbMacro.h"
 
 namespace otb
 {
@@ -47,7 +48,8 @@ RandomForestsMachineLearningModel<TInputValue,TOutputValue>
   m_MaxNumberOfTrees(100),
   m_ForestAccuracy(0.01),
   m_TerminationCriteria(CV_TERMCRIT_ITER | CV_TERMCRIT_EPS), // identic for v3 ?
-  m_ComputeMargin(false)
+  m_ComputeMargin(false),
+  m_UseFlatForest(true)
 {
   this->m_ConfidenceIndex = true;
   this->m_IsRegressionSupported = true;
@@ -165,6 +167,29 @@ RandomForestsMachineLearningModel<TInputValue,TOutputValue>
   m_RFModel->train(samples, CV_ROW_SAMPLE, labels,
                    cv::Mat(), cv::Mat(), var_type, cv::Mat(), params);
 #endif
+  this->UpdateFlatForest();
+}
+
+template <class TInputValue, class TOutputValue>
+void
+RandomForestsMachineLearningModel<TInputValue,TOutputValue>
+::UpdateFlatForest()
+{
+  m_FlatForest.Initialize(0, FlatRandomForest::VOTES);
+  if (this->m_RegressionMode)
+    {
+    return;
+    }
+  try
+    {
+    m_RFModel->get_flat_forest(m_FlatForest);
+    }
+  catch (itk::ExceptionObject & err)
+    {
+    // Keep the native prediction
+    otbMsgDevMacro(<< "Can't build the flat forest: " << err.GetDescription());
+    m_FlatForest.Initialize(0, FlatRandomForest::VOTES);
+    }
 }
 
 template <class TInputValue, class TOutputValue>
@@ -193,6 +218,74 @@ RandomForestsMachineLearningModel<TInputValue,TOutputValue>
   return target[0];
 }
 
+template <class TInputValue, class TOutputValue>
+void
+RandomForestsMachineLearningModel<TInputValue,TOutputValue>
+::DoPredictMatrix(const InputSampleMatrixType & input, const unsigned long & startIndex, const unsigned long & size, TargetValueType * targets, ConfidenceValueType * quality) const
+{
+  if (m_UseFlatForest && !this->m_RegressionMode && !m_FlatForest.IsEmpty())
+    {
+    std::vector<const InputValueType *> samples;
+    std::vector<unsigned long> ids;
+    samples.reserve(size);
+    ids.reserve(size);
+    for (unsigned long id = startIndex; id < startIndex + size; ++id)
+      {
+      if (input.IsValid(id))
+        {
+        samples.push_back(input.GetSample(id));
+        ids.push_back(id);
+        }
+      }
+    if (ids.empty())
+      {
+      return;
+      }
+
+    std::vector<unsigned int> classes(ids.size());
+    std::vector<double> confidences(quality != ITK_NULLPTR ? ids.size() : 0);
+    m_FlatForest.Classify(&(samples[0]), static_cast<unsigned int>(ids.size()), &(classes[0]),
+                          quality != ITK_NULLPTR ? &(confidences[0]) : ITK_NULLPTR, m_ComputeMargin);
+
+    for (size_t i = 0; i < ids.size(); ++i)
+      {
+      targets[ids[i]] = static_cast<TOutputValue>(static_cast<float>(m_FlatForest.GetClassLabel(classes[i])));
+      if (quality != ITK_NULLPTR)
+        {
+        quality[ids[i]] = static_cast<ConfidenceValueType>(confidences[i]);
+        }
+      }
+    return;
+    }
+
+  const unsigned int nbFeatures = input.NumberOfFeatures;
+  cv::Mat sample(1, nbFeatures, CV_32FC1);
+  float * row = sample.ptr<float>(0);
+
+  for (unsigned long id = startIndex; id < startIndex + size; ++id)
+    {
+    if (!input.IsValid(id))
+      {
+      continue;
+      }
+    const InputValueType * values = input.GetSample(id);
+    for (unsigned int i = 0; i < nbFeatures; ++i)
+      {
+      row[i] = static_cast<float>(values[i]);
+      }
+
+    targets[id] = static_cast<TOutputValue>(m_RFModel->predict(sample));
+
+    if (quality != ITK_NULLPTR)
+      {
+      if(m_ComputeMargin)
+        quality[id] = m_RFModel->predict_margin(sample);
+      else
+        quality[id] = m_RFModel->predict_confidence(sample);
+      }
+    }
+}
+
 template <class TInputValue, class TOutputValue>
 void
 RandomForestsMachineLearningModel<TInputValue,TOutputValue>
@@ -226,6 +319,7 @@ RandomForestsMachineLearningModel<TInputValue,TOutputValue>
   else
     m_RFModel->load(filename.c_str(), name.c_str());
 #endif
+  this->UpdateFlatForest();
 }
 
 template <class TInputValue, class TOutputValue>
@@ -22,6 +22,7 @@
 #define otbSVMCrossValidationCostFunction_h
 
 #include "itkSingleValuedCostFunction.h"
+#include "itkSimpleFastMutexLock.h"
 
 namespace otb
 {
@@ -45,6 +46,13 @@ namespace otb
  * The GetDerivative() uses the GetValue() function to
  * compute the partial derivatives. as such, it can be quite intensive.
  *
+ * If the model has ParallelOptimization on, GetValue() does not modify
+ * the model and can be called concurrently. With EarlyStopping, the
+ * cross-validation of parameters which can not beat the best value
+ * already returned is stopped, and an upper bound of their value, lower
+ * than the best value, is returned: the position of the maximum is not
+ * affected.
+ *
  * \ingroup ClassificationFilters
  *
  * \ingroup OTBSupervised
@@ -81,6 +89,14 @@ public:
   itkSetMacro(DerivativeStep, ParametersValueType);
   itkGetMacro(DerivativeStep, ParametersValueType);
 
+  /** Stop the evaluation of hopeless parameters (default is false) */
+  itkSetMacro(EarlyStopping, bool);
+  itkGetMacro(EarlyStopping, bool);
+  itkBooleanMacro(EarlyStopping);
+
+  /** Best value returned by GetValue() */
+  MeasureType GetBestValue() const;
+
   /** \return The accuracy value corresponding the parameters */
   MeasureType GetValue(const ParametersType& parameters) const ITK_OVERRIDE;
 
@@ -110,6 +126,12 @@ private:
   /** Step used to compute the derivatives */
   ParametersValueType m_DerivativeStep;
 
+  bool m_EarlyStopping;
+
+  /** Best value returned, shared by concurrent evaluations */
+  mutable MeasureType              m_BestValue;
+  mutable itk::SimpleFastMutexLock m_Lock;
+
 }; // class SVMCrossValidationCostFunction
 
 } // namespace otb
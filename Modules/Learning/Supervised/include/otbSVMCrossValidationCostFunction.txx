@@ -28,7 +28,8 @@ namespace otb
 {
 template<class TModel>
 SVMCrossValidationCostFunction<TModel>
-::SVMCrossValidationCostFunction() : m_Model(), m_DerivativeStep(0.001)
+::SVMCrossValidationCostFunction() : m_Model(), m_DerivativeStep(0.001),
+  m_EarlyStopping(false), m_BestValue(0.)
 {}
 template<class TModel>
 SVMCrossValidationCostFunction<TModel>
@@ -52,10 +53,48 @@ SVMCrossValidationCostFunction<TModel>
     return 0;
     }
 
+  if (m_Model->GetParallelOptimization())
+    {
+    // Thread-safe evaluation, without modifying the model
+    MeasureType minimumValue = -1.;
+    if (m_EarlyStopping)
+      {
+      m_Lock.Lock();
+      minimumValue = m_BestValue;
+      m_Lock.Unlock();
+      }
+    const MeasureType value = m_Model->CrossValidation(parameters, minimumValue);
+
+    m_Lock.Lock();
+    if (value > m_BestValue)
+      {
+      m_BestValue = value;
+      }
+    m_Lock.Unlock();
+    return value;
+    }
+
   // Updates vm_parameters according to current parameters
   this->UpdateParameters(parameters);
 
-  return m_Model->CrossValidation();
+  const MeasureType value = m_Model->CrossValidation();
+  if (value > m_BestValue)
+    {
+    m_BestValue = value;
+    }
+  return value;
+}
+
+template<class TModel>
+typename SVMCrossValidationCostFunction<TModel>
+::MeasureType
+SVMCrossValidationCostFunction<TModel>
+::GetBestValue() const
+{
+  m_Lock.Lock();
+  const MeasureType value = m_BestValue;
+  m_Lock.Unlock();
+  return value;
 }
 
 template<class TModel>
@@ -23,6 +23,7 @@
 
 #include "itkLightObject.h"
 #include "otbMachineLearningModel.h"
+#include "otbFlatRandomForest.h"
 
 #if defined(__GNUC__) || defined(__clang__)
 #pragma GCC diagnostic push
@@ -77,6 +78,7 @@ public:
   typedef typename Superclass::ConfidenceValueType        ConfidenceValueType;
   typedef typename Superclass::ConfidenceSampleType       ConfidenceSampleType;
   typedef typename Superclass::ConfidenceListSampleType   ConfidenceListSampleType;
+  typedef typename Superclass::InputSampleMatrixType      InputSampleMatrixType;
   
   /** Run-time type information (and related methods). */
   itkNewMacro(Self);
@@ -134,6 +136,20 @@ public:
   /** If true, margin confidence value will be computed */
   itkSetMacro(ComputeMargin, bool);
 
+  /** If true (default), batch predictions use a FlatRandomForest built
+   *  from the trained or loaded model. Labels and confidence values are
+   *  the same as the ones of the Shark forest. */
+  itkGetMacro(UseFlatForest, bool);
+  itkSetMacro(UseFlatForest, bool);
+  itkBooleanMacro(UseFlatForest);
+
+  /** Flat copy of the trained or loaded forest. It can be saved in the
+   *  binary flat forest format. */
+  const FlatRandomForest & GetFlatForest() const
+  {
+    return m_FlatForest;
+  }
+
 protected:
   /** Constructor */
   SharkRandomForestsMachineLearningModel();
@@ -146,6 +162,9 @@ protected:
 
   
   virtual void DoPredictBatch(const InputListSampleType *, const unsigned int & startIndex, const unsigned int & size, TargetListSampleType *, ConfidenceListSampleType * = ITK_NULLPTR) const ITK_OVERRIDE;
+
+  /** Predict a sample matrix, filling the Shark batches directly from the buffer */
+  virtual void DoPredictMatrix(const InputSampleMatrixType & input, const unsigned long & startIndex, const unsigned long & size, TargetValueType * targets, ConfidenceValueType * quality = ITK_NULLPTR) const ITK_OVERRIDE;
   
   /** PrintSelf method */
   void PrintSelf(std::ostream& os, itk::Indent indent) const;
@@ -162,6 +181,13 @@ private:
   unsigned int m_NodeSize;
   float m_OobRatio;
   bool m_ComputeMargin;
+  bool m_UseFlatForest;
+
+  /** Flat copy of m_RFModel used for batch predictions */
+  FlatRandomForest m_FlatForest;
+
+  /** Rebuild the flat forest from the Shark model */
+  void UpdateFlatForest();
 
   /** Confidence list sample */
   ConfidenceValueType ComputeConfidence(shark::RealVector & probas, 
@@ -52,6 +52,7 @@ SharkRandomForestsMachineLearningModel<TInputValue,TOutputValue>
   this->m_ConfidenceIndex = true;
   this->m_IsRegressionSupported = false;
   this->m_IsDoPredictBatchMultiThreaded = true;
+  this->m_UseFlatForest = true;
 }
 
 
@@ -84,7 +85,48 @@ SharkRandomForestsMachineLearningModel<TInputValue,TOutputValue>
   m_RFTrainer.setNodeSize(m_NodeSize);
   m_RFTrainer.setOOBratio(m_OobRatio);
   m_RFTrainer.train(m_RFModel, TrainSamples);
+  this->UpdateFlatForest();
+}
+
+template <class TInputValue, class TOutputValue>
+void
+SharkRandomForestsMachineLearningModel<TInputValue,TOutputValue>
+::UpdateFlatForest()
+{
+  const std::size_t nbTrees = m_RFModel.numberOfModels();
+  if(nbTrees == 0)
+    {
+    m_FlatForest.Initialize(0, FlatRandomForest::SCORES);
+    return;
+    }
 
+  // Each CART node stores the class distribution of its samples. Node
+  // ids of the split matrix are indices, and leaves have no left child.
+  typedef shark::CARTClassifier<shark::RealVector>::SplitMatrixType SplitMatrixType;
+  const unsigned int nbClasses = m_RFModel.getModel(0).getSplitMatrix()[0].label.size();
+  m_FlatForest.Initialize(nbClasses, FlatRandomForest::SCORES);
+
+  FlatRandomForest::TreeType tree;
+  for(std::size_t t = 0; t < nbTrees; ++t)
+    {
+    const SplitMatrixType splits = m_RFModel.getModel(t).getSplitMatrix();
+    tree.assign(splits.size(), FlatRandomForest::TreeNode());
+    for(std::size_t i = 0; i < splits.size(); ++i)
+      {
+      if(splits[i].leftNodeId == 0)
+        {
+        tree[i].Scores.assign(splits[i].label.begin(), splits[i].label.end());
+        }
+      else
+        {
+        tree[i].Feature = static_cast<int>(splits[i].attributeIndex);
+        tree[i].Threshold = splits[i].attributeValue;
+        tree[i].Left = static_cast<unsigned int>(splits[i].leftNodeId);
+        tree[i].Right = static_cast<unsigned int>(splits[i].rightNodeId);
+        }
+      }
+    m_FlatForest.AddTree(tree, 0, m_RFModel.weight(t));
+    }
 }
 
 template <class TInputValue, class TOutputValue>
@@ -188,6 +230,110 @@ SharkRandomForestsMachineLearningModel<TInputValue,TOutputValue>
     }
 }
 
+template <class TInputValue, class TOutputValue>
+void
+SharkRandomForestsMachineLearningModel<TInputValue,TOutputValue>
+::DoPredictMatrix(const InputSampleMatrixType & input, const unsigned long & startIndex, const unsigned long & size, TargetValueType * targets, ConfidenceValueType * quality) const
+{
+  if(startIndex+size>input.GetNumberOfSamples())
+    {
+    itkExceptionMacro(<<"requested range ["<<startIndex<<", "<<startIndex+size<<"[ partially outside sample matrix range.[0,"<<input.GetNumberOfSamples()<<"[");
+    }
+
+  // Indices of the samples to predict
+  std::vector<unsigned long> ids;
+  ids.reserve(size);
+  for(unsigned long id = startIndex; id < startIndex+size; ++id)
+    {
+    if(input.IsValid(id))
+      {
+      ids.push_back(id);
+      }
+    }
+  if(ids.empty())
+    {
+    return;
+    }
+
+  if(m_UseFlatForest && !m_FlatForest.IsEmpty())
+    {
+    const long nbSamples = static_cast<long>(ids.size());
+    const long blockSize = FlatRandomForest::BlockSize;
+    std::vector<unsigned int> classes(ids.size());
+    std::vector<double> confidences(ids.size());
+    #ifdef _OPENMP
+    omp_set_num_threads(itk::MultiThreader::GetGlobalDefaultNumberOfThreads());
+    #endif
+    #pragma omp parallel for schedule(dynamic)
+    for(long start = 0; start < nbSamples; start += blockSize)
+      {
+      const unsigned int count = static_cast<unsigned int>(nbSamples - start < blockSize ? nbSamples - start : blockSize);
+      const InputValueType * samples[FlatRandomForest::BlockSize];
+      for(unsigned int i = 0; i < count; ++i)
+        {
+        samples[i] = input.GetSample(ids[start + i]);
+        }
+      m_FlatForest.Classify(samples, count, &(classes[start]), &(confidences[start]), m_ComputeMargin);
+      }
+
+    for(std::size_t i = 0; i < ids.size(); ++i)
+      {
+      targets[ids[i]] = static_cast<TOutputValue>(classes[i]);
+      if(quality != ITK_NULLPTR)
+        {
+        quality[ids[i]] = static_cast<ConfidenceValueType>(confidences[i]);
+        }
+      }
+    return;
+    }
+
+  // Fill the batch matrices of the dataset row by row, without
+  // intermediate vectors
+  const unsigned int nbFeatures = input.NumberOfFeatures;
+  shark::Data<shark::RealVector> inputSamples(ids.size(), shark::RealVector(nbFeatures));
+  std::size_t row = 0;
+  std::size_t batch = 0;
+  for(auto id : ids)
+    {
+    shark::RealMatrix & m = inputSamples.batch(batch);
+    const InputValueType * sample = input.GetSample(id);
+    for(unsigned int feat = 0; feat < nbFeatures; ++feat)
+      {
+      m(row,feat) = static_cast<double>(sample[feat]);
+      }
+    if(++row == m.size1())
+      {
+      row = 0;
+      ++batch;
+      }
+    }
+
+  #ifdef _OPENMP
+  omp_set_num_threads(itk::MultiThreader::GetGlobalDefaultNumberOfThreads());
+  #endif
+
+  if(quality != ITK_NULLPTR)
+    {
+    shark::Data<shark::RealVector> probas = m_RFModel(inputSamples);
+    std::size_t i = 0;
+    for(shark::RealVector && p : probas.elements())
+      {
+      quality[ids[i]] = ComputeConfidence(p, m_ComputeMargin);
+      ++i;
+      }
+    }
+
+  shark::ArgMaxConverter<shark::RFClassifier> amc;
+  amc.decisionFunction() = m_RFModel;
+  auto prediction = amc(inputSamples);
+  std::size_t i = 0;
+  for(const auto& p : prediction.elements())
+    {
+    targets[ids[i]] = static_cast<TOutputValue>(p);
+    ++i;
+    }
+}
+
 template <class TInputValue, class TOutputValue>
 void
 SharkRandomForestsMachineLearningModel<TInputValue,TOutputValue>
@@ -228,6 +374,7 @@ SharkRandomForestsMachineLearningModel<TInputValue,TOutputValue>
       }
     shark::TextInArchive ia( ifs );
     m_RFModel.load( ia, 0 );
+    this->UpdateFlatForest();
     }
 }
 
@@ -19,6 +19,7 @@
  */
 
 #include "otbCvRTreesWrapper.h"
+#include "itkMacro.h"
 #include <algorithm>
 #include <functional>
 
@@ -141,6 +142,99 @@ float CvRTreesWrapper::predict_confidence(const cv::Mat& sample,
   return confidence;
 }
 
+void CvRTreesWrapper::get_flat_forest(FlatRandomForest& forest) const
+{
+  FlatRandomForest::TreeType tree;
+  std::vector<double> labels;
+#ifdef OTB_OPENCV_3
+  const std::vector< cv::ml::DTrees::Node > &nodes = m_Impl->getNodes();
+  const std::vector< cv::ml::DTrees::Split > &splits = m_Impl->getSplits();
+  const std::vector<int> &roots = m_Impl->getRoots();
+
+  // All the trees share the same node array
+  tree.resize(nodes.size());
+  for (size_t i = 0; i < nodes.size(); ++i)
+    {
+    const cv::ml::DTrees::Node &node = nodes[i];
+    if (node.split < 0)
+      {
+      if (node.classIdx < 0)
+        {
+        itkGenericExceptionMacro(<< "Only classification forests can be converted");
+        }
+      tree[i].ClassIndex = node.classIdx;
+      if (labels.size() <= static_cast<size_t>(node.classIdx))
+        {
+        labels.resize(node.classIdx + 1, 0.0);
+        }
+      labels[node.classIdx] = node.value;
+      continue;
+      }
+    const cv::ml::DTrees::Split &split = splits[node.split];
+    if (split.subsetOfs >= 0)
+      {
+      itkGenericExceptionMacro(<< "Categorical splits are not supported");
+      }
+    tree[i].Feature = split.varIdx;
+    tree[i].Threshold = split.c;
+    tree[i].Left = split.inversed ? node.right : node.left;
+    tree[i].Right = split.inversed ? node.left : node.right;
+    }
+
+  forest.Initialize(static_cast<unsigned int>(labels.size()), FlatRandomForest::VOTES);
+  for (size_t t = 0; t < roots.size(); ++t)
+    {
+    forest.AddTree(tree, roots[t]);
+    }
+#else
+  forest.Initialize(nclasses, FlatRandomForest::VOTES);
+  labels.resize(nclasses, 0.0);
+  for (int k = 0; k < ntrees; ++k)
+    {
+    // Number the nodes depth first
+    tree.clear();
+    std::vector<CvDTreeNode*> stack;
+    std::vector<unsigned int> ids;
+    stack.push_back(trees[k]->get_root());
+    ids.push_back(0);
+    tree.push_back(FlatRandomForest::TreeNode());
+    while (!stack.empty())
+      {
+      CvDTreeNode* node = stack.back();
+      const unsigned int id = ids.back();
+      stack.pop_back();
+      ids.pop_back();
+      if (!node->left)
+        {
+        CV_Assert( 0 <= node->class_idx && node->class_idx < nclasses );
+        tree[id].ClassIndex = node->class_idx;
+        labels[node->class_idx] = node->value;
+        continue;
+        }
+      const CvDTreeSplit* split = node->split;
+      if (trees[k]->get_data()->get_var_type(split->var_idx) >= 0)
+        {
+        itkGenericExceptionMacro(<< "Categorical splits are not supported");
+        }
+      const unsigned int left = static_cast<unsigned int>(tree.size());
+      tree.resize(left + 2);
+      tree[id].Feature = split->var_idx;
+      tree[id].Threshold = split->ord.c;
+      tree[id].Left = split->inversed ? left + 1 : left;
+      tree[id].Right = split->inversed ? left : left + 1;
+      stack.push_back(node->left);
+      ids.push_back(left);
+      stack.push_back(node->right);
+      ids.push_back(left + 1);
+      }
+    forest.AddTree(tree, 0);
+    }
+  // OpenCV 2 keeps the first class to reach the maximum number of votes
+  forest.SetTieRule(FlatRandomForest::FIRST_REACHED);
+#endif
+  forest.SetClassLabels(labels);
+}
+
 #ifdef OTB_OPENCV_3
 #define OTB_CV_WRAP_IMPL(type,name) \
 type CvRTreesWrapper::get##name() const \
@@ -21,10 +21,28 @@
 #include "otbExhaustiveExponentialOptimizer.h"
 #include "itkCommand.h"
 #include "itkEventObject.h"
+#include "itkSimpleFastMutexLock.h"
+#include <algorithm>
+#include <vector>
 
 namespace otb
 {
 
+namespace
+{
+/** Work shared by the threads of WalkInParallel() */
+struct EvaluateThreadStruct
+{
+  ExhaustiveExponentialOptimizer *                          Optimizer;
+  const std::vector<ExhaustiveExponentialOptimizer::ParametersType> * Positions;
+  std::vector<ExhaustiveExponentialOptimizer::MeasureType> *          Values;
+  unsigned long                                             NextIteration;
+  itk::SimpleFastMutexLock                                  Lock;
+  bool                                                      Failed;
+  std::string                                               Error;
+};
+}
+
 /**
  * Constructor
  */
@@ -41,6 +59,7 @@ ExhaustiveExponentialOptimizer
   m_CurrentIndex.Fill(0);
   m_Stop = false;
   m_NumberOfSteps.Fill(0);
+  m_NumberOfThreads = 1;
 }
 
 /**
@@ -101,11 +120,128 @@ ExhaustiveExponentialOptimizer
     }
   this->SetCurrentPosition(position);
 
+  if (m_NumberOfThreads > 1)
+    {
+    itkDebugMacro("Calling WalkInParallel");
+    this->WalkInParallel();
+    return;
+    }
+
   itkDebugMacro("Calling ResumeWalking");
 
   this->ResumeWalking();
 }
 
+void
+ExhaustiveExponentialOptimizer
+::WalkInParallel(void)
+{
+  const unsigned int spaceDimension = this->GetInitialPosition().GetSize();
+
+  // Enumerate the grid points in the sequential order
+  std::vector<ParametersType> indices(m_MaximumNumberOfIterations);
+  std::vector<ParametersType> positions(m_MaximumNumberOfIterations);
+  ParametersType index(spaceDimension);
+  index.Fill(0);
+  for (unsigned long iteration = 0; iteration < m_MaximumNumberOfIterations; ++iteration)
+    {
+    indices[iteration] = index;
+    this->ComputePosition(index, positions[iteration]);
+    for (unsigned int i = 0; i < spaceDimension; ++i)
+      {
+      index[i]++;
+      if (index[i] > (2 * m_NumberOfSteps[i]))
+        {
+        index[i] = 0;
+        }
+      else
+        {
+        break;
+        }
+      }
+    }
+
+  // Evaluate them concurrently
+  std::vector<MeasureType> values(m_MaximumNumberOfIterations);
+  EvaluateThreadStruct str;
+  str.Optimizer = this;
+  str.Positions = &positions;
+  str.Values = &values;
+  str.NextIteration = 0;
+  str.Failed = false;
+
+  itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+  threader->SetNumberOfThreads(static_cast<itk::ThreadIdType>(
+    std::min(static_cast<unsigned long>(m_NumberOfThreads), m_MaximumNumberOfIterations)));
+  threader->SetSingleMethod(EvaluateThreaderCallback, &str);
+  threader->SingleMethodExecute();
+
+  if (str.Failed)
+    {
+    itkExceptionMacro(<< "Cost function evaluation failed: " << str.Error);
+    }
+
+  // Walk through the results as ResumeWalking() would do
+  m_Stop = false;
+  for (unsigned long iteration = 0; iteration < m_MaximumNumberOfIterations; ++iteration)
+    {
+    m_CurrentIndex = indices[iteration];
+    this->SetCurrentPosition(positions[iteration]);
+    m_CurrentValue = values[iteration];
+
+    if (m_CurrentValue > m_MaximumMetricValue)
+      {
+      m_MaximumMetricValue = m_CurrentValue;
+      m_MaximumMetricValuePosition = positions[iteration];
+      }
+    if (m_CurrentValue < m_MinimumMetricValue)
+      {
+      m_MinimumMetricValue = m_CurrentValue;
+      m_MinimumMetricValuePosition = positions[iteration];
+      }
+
+    this->InvokeEvent(itk::IterationEvent());
+    m_CurrentIteration++;
+    }
+  m_CurrentIndex.Fill(0);
+  m_Stop = true;
+}
+
+ITK_THREAD_RETURN_TYPE
+ExhaustiveExponentialOptimizer
+::EvaluateThreaderCallback(void *arg)
+{
+  EvaluateThreadStruct * str = static_cast<EvaluateThreadStruct *>(
+    static_cast<itk::MultiThreader::ThreadInfoStruct *>(arg)->UserData);
+
+  while (true)
+    {
+    str->Lock.Lock();
+    const unsigned long iteration = str->NextIteration++;
+    const bool stop = str->Failed;
+    str->Lock.Unlock();
+
+    if (stop || iteration >= str->Positions->size())
+      {
+      break;
+      }
+
+    try
+      {
+      (*str->Values)[iteration] = str->Optimizer->GetValue((*str->Positions)[iteration]);
+      }
+    catch (itk::ExceptionObject & err)
+      {
+      str->Lock.Lock();
+      str->Failed = true;
+      str->Error = err.GetDescription();
+      str->Lock.Unlock();
+      }
+    }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
 /**
  * Resume the optimization
  */
@@ -204,12 +340,21 @@ ExhaustiveExponentialOptimizer
     m_Stop = true;
     }
 
+  this->ComputePosition(m_CurrentIndex, newPosition);
+}
+
+void
+ExhaustiveExponentialOptimizer
+::ComputePosition(const ParametersType& index, ParametersType& position) const
+{
+  const unsigned int spaceDimension = index.GetSize();
+  position.SetSize(spaceDimension);
   for (unsigned int i = 0; i < spaceDimension; ++i)
     {
-    newPosition[i] = this->GetInitialPosition()[i]
-                     * this->GetScales()[i]
-                     * vcl_pow(m_GeometricProgression,
-                               static_cast<double>(m_CurrentIndex[i] - m_NumberOfSteps[i]) * m_StepLength);
+    position[i] = this->GetInitialPosition()[i]
+                  * this->GetScales()[i]
+                  * vcl_pow(m_GeometricProgression,
+                            static_cast<double>(index[i] - m_NumberOfSteps[i]) * m_StepLength);
     }
 }
 
@@ -231,6 +376,7 @@ ExhaustiveExponentialOptimizer
   os << indent << "MinimumMetricValue = " << m_MinimumMetricValue << std::endl;
   os << indent << "MinimumMetricValuePosition = " << m_MinimumMetricValuePosition << std::endl;
   os << indent << "MaximumMetricValuePosition = " << m_MaximumMetricValuePosition << std::endl;
+  os << indent << "NumberOfThreads = " << m_NumberOfThreads << std::endl;
 }
 
 } // end namespace itk
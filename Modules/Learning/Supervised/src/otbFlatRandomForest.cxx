@@ -0,0 +1,458 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "otbFlatRandomForest.h"
+#include "itkMacro.h"
+#include "itkIntTypes.h"
+#include <deque>
+#include <utility>
+#include <fstream>
+#include <cstring>
+
+namespace otb
+{
+
+namespace
+{
+/** Binary format: a FlatForestHeader followed by the arrays, in the order
+ *  thresholds, leaf scores, tree weights, class labels (doubles), then
+ *  features, children, leaf classes and roots (32 bits integers). Each
+ *  array is padded to a multiple of 8 bytes, so that all of them are
+ *  aligned in a mapped file. */
+const char          FlatForestMagic[8] = {'O', 'T', 'B', 'F', 'L', 'A', 'T', 'F'};
+const itk::uint32_t FlatForestByteOrder = 0x01020304;
+const itk::uint32_t FlatForestVersion = 1;
+
+struct FlatForestHeader
+{
+  char          Magic[8];
+  itk::uint32_t ByteOrder;
+  itk::uint32_t Version;
+  itk::uint32_t NumberOfClasses;
+  itk::uint32_t LeafMode;
+  itk::uint32_t TieRule;
+  itk::uint32_t NumberOfLabels;
+  itk::uint64_t NumberOfNodes;
+  itk::uint64_t NumberOfLeafClasses;
+  itk::uint64_t NumberOfLeafScores;
+  itk::uint64_t NumberOfTrees;
+  double        TotalWeight;
+};
+
+inline size_t PaddedSize(size_t bytes)
+{
+  return (bytes + 7) & ~static_cast<size_t>(7);
+}
+
+void WriteArray(std::ostream & os, const void * data, size_t bytes)
+{
+  static const char padding[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+  if (bytes > 0)
+    {
+    os.write(static_cast<const char *>(data), bytes);
+    }
+  os.write(padding, PaddedSize(bytes) - bytes);
+}
+}
+
+FlatRandomForest::FlatRandomForest()
+  : m_NumberOfClasses(0),
+    m_LeafMode(VOTES),
+    m_TieRule(FIRST_MAXIMUM),
+    m_TotalWeight(0.0)
+{
+  this->UpdateArrayPointers();
+}
+
+FlatRandomForest::FlatRandomForest(const FlatRandomForest & other)
+{
+  *this = other;
+}
+
+FlatRandomForest &
+FlatRandomForest::operator =(const FlatRandomForest & other)
+{
+  if (&other == this)
+    {
+    return *this;
+    }
+  m_NumberOfClasses = other.m_NumberOfClasses;
+  m_LeafMode = other.m_LeafMode;
+  m_TieRule = other.m_TieRule;
+  m_Features = other.m_Features;
+  m_Thresholds = other.m_Thresholds;
+  m_Children = other.m_Children;
+  m_LeafClasses = other.m_LeafClasses;
+  m_LeafScores = other.m_LeafScores;
+  m_Roots = other.m_Roots;
+  m_Weights = other.m_Weights;
+  m_TotalWeight = other.m_TotalWeight;
+  m_ClassLabels = other.m_ClassLabels;
+  m_MappedFile = other.m_MappedFile;
+  if (m_MappedFile.IsNull())
+    {
+    this->UpdateArrayPointers();
+    }
+  else
+    {
+    // the mapping is shared, the views stay valid
+    m_FeaturesData = other.m_FeaturesData;
+    m_ThresholdsData = other.m_ThresholdsData;
+    m_ChildrenData = other.m_ChildrenData;
+    m_LeafClassesData = other.m_LeafClassesData;
+    m_LeafScoresData = other.m_LeafScoresData;
+    m_RootsData = other.m_RootsData;
+    m_WeightsData = other.m_WeightsData;
+    m_NumberOfNodes = other.m_NumberOfNodes;
+    m_NumberOfLeafClasses = other.m_NumberOfLeafClasses;
+    m_NumberOfLeafScores = other.m_NumberOfLeafScores;
+    m_NumberOfTrees = other.m_NumberOfTrees;
+    }
+  return *this;
+}
+
+void
+FlatRandomForest::UpdateArrayPointers()
+{
+  m_FeaturesData = m_Features.empty() ? NULL : &(m_Features[0]);
+  m_ThresholdsData = m_Thresholds.empty() ? NULL : &(m_Thresholds[0]);
+  m_ChildrenData = m_Children.empty() ? NULL : &(m_Children[0]);
+  m_LeafClassesData = m_LeafClasses.empty() ? NULL : &(m_LeafClasses[0]);
+  m_LeafScoresData = m_LeafScores.empty() ? NULL : &(m_LeafScores[0]);
+  m_RootsData = m_Roots.empty() ? NULL : &(m_Roots[0]);
+  m_WeightsData = m_Weights.empty() ? NULL : &(m_Weights[0]);
+  m_NumberOfNodes = m_Features.size();
+  m_NumberOfLeafClasses = m_LeafClasses.size();
+  m_NumberOfLeafScores = m_LeafScores.size();
+  m_NumberOfTrees = m_Roots.size();
+}
+
+void
+FlatRandomForest::Initialize(unsigned int nbClasses, LeafModeType mode)
+{
+  m_NumberOfClasses = nbClasses;
+  m_LeafMode = mode;
+  m_TieRule = FIRST_MAXIMUM;
+  m_Features.clear();
+  m_Thresholds.clear();
+  m_Children.clear();
+  m_LeafClasses.clear();
+  m_LeafScores.clear();
+  m_Roots.clear();
+  m_Weights.clear();
+  m_TotalWeight = 0.0;
+  m_ClassLabels.clear();
+  m_MappedFile = ITK_NULLPTR;
+  this->UpdateArrayPointers();
+}
+
+void
+FlatRandomForest::AddTree(const TreeType & tree, unsigned int root, double weight)
+{
+  if (m_MappedFile.IsNotNull())
+    {
+    itkGenericExceptionMacro(<< "Can't add a tree to a mapped forest, call Initialize() first");
+    }
+  if (root >= tree.size())
+    {
+    itkGenericExceptionMacro(<< "Root " << root << " outside of a tree with " << tree.size() << " nodes");
+    }
+
+  // Breadth first layout: each pair of children is allocated when their
+  // parent is visited, so that siblings are adjacent
+  const unsigned int flatRoot = static_cast<unsigned int>(m_Features.size());
+  m_Features.push_back(-1);
+  m_Thresholds.push_back(0.0);
+  m_Children.push_back(0);
+
+  std::deque<std::pair<unsigned int, unsigned int> > queue;
+  queue.push_back(std::make_pair(root, flatRoot));
+  while (!queue.empty())
+    {
+    const unsigned int nodeId = queue.front().first;
+    const unsigned int flatId = queue.front().second;
+    queue.pop_front();
+    const TreeNode & node = tree[nodeId];
+
+    if (node.Feature < 0)
+      {
+      m_Features[flatId] = -1;
+      if (m_LeafMode == VOTES)
+        {
+        if (node.ClassIndex >= m_NumberOfClasses)
+          {
+          itkGenericExceptionMacro(<< "Leaf class " << node.ClassIndex << " outside of [0," << m_NumberOfClasses << "[");
+          }
+        m_Children[flatId] = static_cast<unsigned int>(m_LeafClasses.size());
+        m_LeafClasses.push_back(node.ClassIndex);
+        }
+      else
+        {
+        if (node.Scores.size() != m_NumberOfClasses)
+          {
+          itkGenericExceptionMacro(<< "Leaf has " << node.Scores.size() << " scores, expected " << m_NumberOfClasses);
+          }
+        m_Children[flatId] = static_cast<unsigned int>(m_LeafScores.size() / m_NumberOfClasses);
+        m_LeafScores.insert(m_LeafScores.end(), node.Scores.begin(), node.Scores.end());
+        }
+      continue;
+      }
+
+    if (node.Left >= tree.size() || node.Right >= tree.size())
+      {
+      itkGenericExceptionMacro(<< "Child of node " << nodeId << " outside of a tree with " << tree.size() << " nodes");
+      }
+
+    const unsigned int flatLeft = static_cast<unsigned int>(m_Features.size());
+    m_Features.resize(flatLeft + 2, -1);
+    m_Thresholds.resize(flatLeft + 2, 0.0);
+    m_Children.resize(flatLeft + 2, 0);
+
+    m_Features[flatId] = node.Feature;
+    m_Thresholds[flatId] = node.Threshold;
+    m_Children[flatId] = flatLeft;
+
+    queue.push_back(std::make_pair(node.Left, flatLeft));
+    queue.push_back(std::make_pair(node.Right, flatLeft + 1));
+    }
+
+  m_Roots.push_back(flatRoot);
+  m_Weights.push_back(weight);
+  m_TotalWeight += weight;
+  this->UpdateArrayPointers();
+}
+
+void
+FlatRandomForest::Save(const std::string & filename) const
+{
+  std::ofstream ofs(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!ofs)
+    {
+    itkGenericExceptionMacro(<< "Can't open file " << filename << " for writing");
+    }
+
+  FlatForestHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.Magic, FlatForestMagic, sizeof(header.Magic));
+  header.ByteOrder = FlatForestByteOrder;
+  header.Version = FlatForestVersion;
+  header.NumberOfClasses = m_NumberOfClasses;
+  header.LeafMode = static_cast<itk::uint32_t>(m_LeafMode);
+  header.TieRule = static_cast<itk::uint32_t>(m_TieRule);
+  header.NumberOfLabels = static_cast<itk::uint32_t>(m_ClassLabels.size());
+  header.NumberOfNodes = m_NumberOfNodes;
+  header.NumberOfLeafClasses = m_NumberOfLeafClasses;
+  header.NumberOfLeafScores = m_NumberOfLeafScores;
+  header.NumberOfTrees = m_NumberOfTrees;
+  header.TotalWeight = m_TotalWeight;
+  ofs.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+  WriteArray(ofs, m_ThresholdsData, m_NumberOfNodes * sizeof(double));
+  WriteArray(ofs, m_LeafScoresData, m_NumberOfLeafScores * sizeof(double));
+  WriteArray(ofs, m_WeightsData, m_NumberOfTrees * sizeof(double));
+  WriteArray(ofs, m_ClassLabels.empty() ? NULL : &(m_ClassLabels[0]), m_ClassLabels.size() * sizeof(double));
+  WriteArray(ofs, m_FeaturesData, m_NumberOfNodes * sizeof(int));
+  WriteArray(ofs, m_ChildrenData, m_NumberOfNodes * sizeof(unsigned int));
+  WriteArray(ofs, m_LeafClassesData, m_NumberOfLeafClasses * sizeof(unsigned int));
+  WriteArray(ofs, m_RootsData, m_NumberOfTrees * sizeof(unsigned int));
+
+  if (!ofs)
+    {
+    itkGenericExceptionMacro(<< "Error while writing file " << filename);
+    }
+}
+
+void
+FlatRandomForest::Load(const std::string & filename)
+{
+  if (sizeof(int) != 4 || sizeof(unsigned int) != 4)
+    {
+    itkGenericExceptionMacro(<< "Flat forest files need 32 bits integers");
+    }
+
+  MemoryMappedFile::Pointer file = MemoryMappedFile::New();
+  file->Open(filename);
+
+  FlatForestHeader header;
+  if (file->GetSize() < sizeof(header))
+    {
+    itkGenericExceptionMacro(<< filename << " is not a flat forest file");
+    }
+  std::memcpy(&header, file->GetData(), sizeof(header));
+  if (std::memcmp(header.Magic, FlatForestMagic, sizeof(header.Magic)) != 0)
+    {
+    itkGenericExceptionMacro(<< filename << " is not a flat forest file");
+    }
+  if (header.ByteOrder != FlatForestByteOrder)
+    {
+    itkGenericExceptionMacro(<< filename << " was written on a machine with a different byte order");
+    }
+  if (header.Version != FlatForestVersion)
+    {
+    itkGenericExceptionMacro(<< "Unsupported version " << header.Version << " of flat forest file " << filename);
+    }
+  if (header.LeafMode > SCORES || header.TieRule > FIRST_REACHED
+      || (header.NumberOfLabels != 0 && header.NumberOfLabels != header.NumberOfClasses))
+    {
+    itkGenericExceptionMacro(<< "Corrupted flat forest file " << filename);
+    }
+
+  // Offsets of the arrays (counts larger than the file are rejected
+  // first, so that the offsets can't overflow)
+  const itk::uint64_t fileSize = file->GetSize();
+  if (header.NumberOfNodes > fileSize || header.NumberOfLeafClasses > fileSize
+      || header.NumberOfLeafScores > fileSize || header.NumberOfTrees > fileSize)
+    {
+    itkGenericExceptionMacro(<< "Truncated or corrupted flat forest file " << filename);
+    }
+  const size_t nbNodes = static_cast<size_t>(header.NumberOfNodes);
+  const size_t nbLeafClasses = static_cast<size_t>(header.NumberOfLeafClasses);
+  const size_t nbLeafScores = static_cast<size_t>(header.NumberOfLeafScores);
+  const size_t nbTrees = static_cast<size_t>(header.NumberOfTrees);
+  size_t offset = sizeof(header);
+  const size_t thresholdsOffset = offset;
+  offset += PaddedSize(nbNodes * sizeof(double));
+  const size_t leafScoresOffset = offset;
+  offset += PaddedSize(nbLeafScores * sizeof(double));
+  const size_t weightsOffset = offset;
+  offset += PaddedSize(nbTrees * sizeof(double));
+  const size_t labelsOffset = offset;
+  offset += PaddedSize(header.NumberOfLabels * sizeof(double));
+  const size_t featuresOffset = offset;
+  offset += PaddedSize(nbNodes * sizeof(int));
+  const size_t childrenOffset = offset;
+  offset += PaddedSize(nbNodes * sizeof(unsigned int));
+  const size_t leafClassesOffset = offset;
+  offset += PaddedSize(nbLeafClasses * sizeof(unsigned int));
+  const size_t rootsOffset = offset;
+  offset += PaddedSize(nbTrees * sizeof(unsigned int));
+  if (offset != file->GetSize())
+    {
+    itkGenericExceptionMacro(<< "Truncated or corrupted flat forest file " << filename);
+    }
+
+  const char * data = file->GetData();
+  const int * features = reinterpret_cast<const int *>(data + featuresOffset);
+  const unsigned int * children = reinterpret_cast<const unsigned int *>(data + childrenOffset);
+  const unsigned int * leafClasses = reinterpret_cast<const unsigned int *>(data + leafClassesOffset);
+  const unsigned int * roots = reinterpret_cast<const unsigned int *>(data + rootsOffset);
+
+  // Check the structure, so that a corrupted file can't lead to reads
+  // outside of the arrays. Children always follow their parent in the
+  // breadth first layout, which guarantees that traversals end.
+  const size_t nbClasses = header.NumberOfClasses;
+  const size_t nbLeaves = (header.LeafMode == VOTES ? nbLeafClasses : (nbClasses > 0 ? nbLeafScores / nbClasses : 0));
+  if (header.LeafMode == SCORES && nbLeaves * nbClasses != nbLeafScores)
+    {
+    itkGenericExceptionMacro(<< "Corrupted flat forest file " << filename);
+    }
+  for (size_t node = 0; node < nbNodes; ++node)
+    {
+    const bool valid = (features[node] >= 0)
+      ? (children[node] > node && static_cast<size_t>(children[node]) + 1 < nbNodes)
+      : (children[node] < nbLeaves);
+    if (!valid)
+      {
+      itkGenericExceptionMacro(<< "Corrupted node " << node << " in flat forest file " << filename);
+      }
+    }
+  for (size_t leaf = 0; leaf < nbLeafClasses; ++leaf)
+    {
+    if (leafClasses[leaf] >= nbClasses)
+      {
+      itkGenericExceptionMacro(<< "Corrupted leaf " << leaf << " in flat forest file " << filename);
+      }
+    }
+  for (size_t t = 0; t < nbTrees; ++t)
+    {
+    if (roots[t] >= nbNodes)
+      {
+      itkGenericExceptionMacro(<< "Corrupted tree " << t << " in flat forest file " << filename);
+      }
+    }
+
+  this->Initialize(header.NumberOfClasses, static_cast<LeafModeType>(header.LeafMode));
+  m_TieRule = static_cast<TieRuleType>(header.TieRule);
+  m_TotalWeight = header.TotalWeight;
+  const double * labels = reinterpret_cast<const double *>(data + labelsOffset);
+  m_ClassLabels.assign(labels, labels + header.NumberOfLabels);
+
+  m_MappedFile = file;
+  m_FeaturesData = features;
+  m_ThresholdsData = reinterpret_cast<const double *>(data + thresholdsOffset);
+  m_ChildrenData = children;
+  m_LeafClassesData = leafClasses;
+  m_LeafScoresData = reinterpret_cast<const double *>(data + leafScoresOffset);
+  m_RootsData = roots;
+  m_WeightsData = reinterpret_cast<const double *>(data + weightsOffset);
+  m_NumberOfNodes = nbNodes;
+  m_NumberOfLeafClasses = nbLeafClasses;
+  m_NumberOfLeafScores = nbLeafScores;
+  m_NumberOfTrees = nbTrees;
+}
+
+bool
+FlatRandomForest::CanReadFile(const std::string & filename)
+{
+  std::ifstream ifs(filename.c_str(), std::ios::in | std::ios::binary);
+  if (!ifs)
+    {
+    return false;
+    }
+  char magic[sizeof(FlatForestMagic)];
+  ifs.read(magic, sizeof(magic));
+  return ifs && std::memcmp(magic, FlatForestMagic, sizeof(magic)) == 0;
+}
+
+unsigned int
+FlatRandomForest::ArgMax(const double * scores, unsigned int nbClasses)
+{
+  unsigned int best = 0;
+  for (unsigned int k = 1; k < nbClasses; ++k)
+    {
+    if (scores[k] > scores[best])
+      {
+      best = k;
+      }
+    }
+  return best;
+}
+
+double
+FlatRandomForest::Margin(const double * scores, unsigned int nbClasses)
+{
+  double first = 0.0;
+  double second = 0.0;
+  for (unsigned int k = 0; k < nbClasses; ++k)
+    {
+    if (scores[k] > first)
+      {
+      second = first;
+      first = scores[k];
+      }
+    else if (scores[k] > second)
+      {
+      second = scores[k];
+      }
+    }
+  return first - second;
+}
+
+} // end namespace otb
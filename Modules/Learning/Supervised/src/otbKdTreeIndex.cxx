@@ -0,0 +1,375 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "otbKdTreeIndex.h"
+#include "itkMacro.h"
+#include <algorithm>
+#include <functional>
+
+namespace otb
+{
+
+namespace
+{
+/** Order of point ids along a feature */
+class FeatureLess
+{
+public:
+  FeatureLess(const float * points, unsigned int nbFeatures, unsigned int feature)
+    : m_Points(points), m_NumberOfFeatures(nbFeatures), m_Feature(feature)
+  {}
+
+  bool operator()(unsigned int a, unsigned int b) const
+  {
+    return m_Points[static_cast<size_t>(a) * m_NumberOfFeatures + m_Feature]
+      < m_Points[static_cast<size_t>(b) * m_NumberOfFeatures + m_Feature];
+  }
+
+private:
+  const float * m_Points;
+  unsigned int  m_NumberOfFeatures;
+  unsigned int  m_Feature;
+};
+}
+
+KdTreeIndex::KdTreeIndex()
+  : m_NumberOfPoints(0),
+    m_NumberOfFeatures(0),
+    m_LeafSize(16),
+    m_NumberOfLeaves(0),
+    m_MaximumLeafChecks(0)
+{
+}
+
+void
+KdTreeIndex::Clear()
+{
+  m_NumberOfPoints = 0;
+  m_NumberOfLeaves = 0;
+  m_MaximumLeafChecks = 0;
+  m_Nodes.clear();
+  m_Boxes.clear();
+  m_Points.clear();
+  m_PointIds.clear();
+}
+
+void
+KdTreeIndex::Build(const float * points, unsigned int nbPoints, unsigned int nbFeatures,
+                   unsigned int leafSize)
+{
+  this->Clear();
+  if (nbFeatures == 0)
+    {
+    itkGenericExceptionMacro(<< "Can't build a k-d tree on samples without features");
+    }
+  m_NumberOfFeatures = nbFeatures;
+  m_LeafSize = std::max(1U, leafSize);
+  if (nbPoints == 0)
+    {
+    return;
+    }
+  m_NumberOfPoints = nbPoints;
+
+  std::vector<unsigned int> order(nbPoints);
+  for (unsigned int i = 0; i < nbPoints; ++i)
+    {
+    order[i] = i;
+    }
+  m_Nodes.reserve(2 * (nbPoints / m_LeafSize + 1));
+  m_Boxes.reserve(m_Nodes.capacity() * 2 * nbFeatures);
+  this->BuildNode(0, nbPoints, order, points);
+
+  // Copy the points in leaf order
+  m_Points.resize(static_cast<size_t>(nbPoints) * nbFeatures);
+  for (unsigned int i = 0; i < nbPoints; ++i)
+    {
+    std::copy(points + static_cast<size_t>(order[i]) * nbFeatures,
+              points + static_cast<size_t>(order[i] + 1) * nbFeatures,
+              m_Points.begin() + static_cast<size_t>(i) * nbFeatures);
+    }
+  m_PointIds.swap(order);
+}
+
+unsigned int
+KdTreeIndex::BuildNode(unsigned int begin, unsigned int end, std::vector<unsigned int> & order,
+                       const float * points)
+{
+  const unsigned int nbFeatures = m_NumberOfFeatures;
+  const unsigned int nodeId = static_cast<unsigned int>(m_Nodes.size());
+  NodeType node;
+  node.Feature = -1;
+  node.Threshold = 0.0f;
+  node.Left = 0;
+  node.Right = 0;
+  node.Begin = begin;
+  node.End = end;
+  m_Nodes.push_back(node);
+
+  // Bounding box
+  m_Boxes.resize(m_Boxes.size() + 2 * nbFeatures);
+  float * lower = &(m_Boxes[static_cast<size_t>(nodeId) * 2 * nbFeatures]);
+  float * upper = lower + nbFeatures;
+  const float * first = points + static_cast<size_t>(order[begin]) * nbFeatures;
+  std::copy(first, first + nbFeatures, lower);
+  std::copy(first, first + nbFeatures, upper);
+  for (unsigned int i = begin + 1; i < end; ++i)
+    {
+    const float * point = points + static_cast<size_t>(order[i]) * nbFeatures;
+    for (unsigned int f = 0; f < nbFeatures; ++f)
+      {
+      lower[f] = std::min(lower[f], point[f]);
+      upper[f] = std::max(upper[f], point[f]);
+      }
+    }
+
+  // Split the dimension with the largest spread
+  unsigned int feature = 0;
+  float spread = upper[0] - lower[0];
+  for (unsigned int f = 1; f < nbFeatures; ++f)
+    {
+    if (upper[f] - lower[f] > spread)
+      {
+      spread = upper[f] - lower[f];
+      feature = f;
+      }
+    }
+  if (end - begin <= m_LeafSize || !(spread > 0.0f))
+    {
+    ++m_NumberOfLeaves;
+    return nodeId;
+    }
+
+  const unsigned int middle = begin + (end - begin) / 2;
+  std::nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end,
+                   FeatureLess(points, nbFeatures, feature));
+  const float threshold = points[static_cast<size_t>(order[middle]) * nbFeatures + feature];
+
+  // lower and upper may be invalidated by the children boxes
+  const unsigned int left = this->BuildNode(begin, middle, order, points);
+  const unsigned int right = this->BuildNode(middle, end, order, points);
+  m_Nodes[nodeId].Feature = static_cast<int>(feature);
+  m_Nodes[nodeId].Threshold = threshold;
+  m_Nodes[nodeId].Left = left;
+  m_Nodes[nodeId].Right = right;
+  return nodeId;
+}
+
+float
+KdTreeIndex::BoxDistance(const float * query, unsigned int node) const
+{
+  const unsigned int nbFeatures = m_NumberOfFeatures;
+  const float * lower = &(m_Boxes[static_cast<size_t>(node) * 2 * nbFeatures]);
+  const float * upper = lower + nbFeatures;
+  float distance = 0.0f;
+  for (unsigned int f = 0; f < nbFeatures; ++f)
+    {
+    float d = 0.0f;
+    if (query[f] < lower[f])
+      {
+      d = lower[f] - query[f];
+      }
+    else if (query[f] > upper[f])
+      {
+      d = query[f] - upper[f];
+      }
+    distance += d * d;
+    }
+  return distance;
+}
+
+unsigned int
+KdTreeIndex::Search(unsigned int k, unsigned int * indices, float * sqDistances,
+                    SearchBuffer & buffer) const
+{
+  return this->Search(k, indices, sqDistances, buffer, m_MaximumLeafChecks);
+}
+
+unsigned int
+KdTreeIndex::Search(unsigned int k, unsigned int * indices, float * sqDistances,
+                    SearchBuffer & buffer, unsigned int maxLeafChecks) const
+{
+  const unsigned int nbNeighbors = std::min(k, m_NumberOfPoints);
+  if (nbNeighbors == 0)
+    {
+    return 0;
+    }
+  if (buffer.Query.size() < m_NumberOfFeatures)
+    {
+    itkGenericExceptionMacro(<< "Query has " << buffer.Query.size() << " features, expected "
+                             << m_NumberOfFeatures);
+    }
+
+  const unsigned int nbFeatures = m_NumberOfFeatures;
+  const float * query = &(buffer.Query[0]);
+  std::vector<NeighborType> & heap = buffer.Heap;
+  std::vector<std::pair<float, unsigned int> > & queue = buffer.Queue;
+  std::greater<std::pair<float, unsigned int> > queueOrder;
+  heap.clear();
+  queue.clear();
+
+  queue.push_back(std::make_pair(this->BoxDistance(query, 0), 0U));
+  unsigned int nbChecks = 0;
+  while (!queue.empty())
+    {
+    std::pop_heap(queue.begin(), queue.end(), queueOrder);
+    const std::pair<float, unsigned int> entry = queue.back();
+    queue.pop_back();
+
+    const bool full = (heap.size() == nbNeighbors);
+    // Neighbors at the same distance are ordered by index: only strictly
+    // further boxes can be pruned
+    if (full && (entry.first > heap.front().first || (maxLeafChecks > 0 && nbChecks >= maxLeafChecks)))
+      {
+      break;
+      }
+
+    // Go down to the nearest leaf, queuing the far children
+    unsigned int nodeId = entry.second;
+    while (m_Nodes[nodeId].Feature >= 0)
+      {
+      const NodeType & node = m_Nodes[nodeId];
+      const bool goLeft = (query[node.Feature] < node.Threshold);
+      const unsigned int nearId = goLeft ? node.Left : node.Right;
+      const unsigned int farId = goLeft ? node.Right : node.Left;
+      const float farDistance = this->BoxDistance(query, farId);
+      if (heap.size() < nbNeighbors || !(farDistance > heap.front().first))
+        {
+        queue.push_back(std::make_pair(farDistance, farId));
+        std::push_heap(queue.begin(), queue.end(), queueOrder);
+        }
+      nodeId = nearId;
+      }
+
+    // Scan the leaf
+    const NodeType & leaf = m_Nodes[nodeId];
+    for (unsigned int i = leaf.Begin; i < leaf.End; ++i)
+      {
+      const float * point = &(m_Points[static_cast<size_t>(i) * nbFeatures]);
+      float distance = 0.0f;
+      for (unsigned int f = 0; f < nbFeatures; ++f)
+        {
+        const float d = point[f] - query[f];
+        distance += d * d;
+        }
+      const NeighborType candidate(distance, m_PointIds[i]);
+      if (heap.size() < nbNeighbors)
+        {
+        heap.push_back(candidate);
+        std::push_heap(heap.begin(), heap.end());
+        }
+      else if (candidate < heap.front())
+        {
+        std::pop_heap(heap.begin(), heap.end());
+        heap.back() = candidate;
+        std::push_heap(heap.begin(), heap.end());
+        }
+      }
+    ++nbChecks;
+    }
+
+  std::sort_heap(heap.begin(), heap.end());
+  const unsigned int nbFound = static_cast<unsigned int>(heap.size());
+  for (unsigned int i = 0; i < nbFound; ++i)
+    {
+    indices[i] = heap[i].second;
+    if (sqDistances)
+      {
+      sqDistances[i] = heap[i].first;
+      }
+    }
+  return nbFound;
+}
+
+double
+KdTreeIndex::EstimateRecall(unsigned int k, unsigned int maxLeafChecks, unsigned int nbQueries) const
+{
+  // One more neighbor is searched as the query point is indexed
+  const unsigned int nbNeighbors = std::min(k, m_NumberOfPoints > 0 ? m_NumberOfPoints - 1 : 0);
+  if (nbNeighbors == 0 || nbQueries == 0 || maxLeafChecks == 0)
+    {
+    return 1.0;
+    }
+  nbQueries = std::min(nbQueries, m_NumberOfPoints);
+
+  SearchBuffer buffer;
+  buffer.Query.resize(m_NumberOfFeatures);
+  std::vector<unsigned int> exact(nbNeighbors + 1);
+  std::vector<unsigned int> approximate(nbNeighbors + 1);
+  std::vector<unsigned int> exactSet;
+  unsigned long nbFound = 0;
+
+  for (unsigned int q = 0; q < nbQueries; ++q)
+    {
+    // queries are spread over the leaves
+    const unsigned int pos = static_cast<unsigned int>(static_cast<double>(q) * m_NumberOfPoints / nbQueries);
+    const unsigned int queryId = m_PointIds[pos];
+    std::copy(m_Points.begin() + static_cast<size_t>(pos) * m_NumberOfFeatures,
+              m_Points.begin() + static_cast<size_t>(pos + 1) * m_NumberOfFeatures,
+              buffer.Query.begin());
+
+    const unsigned int nbExact = this->Search(nbNeighbors + 1, &(exact[0]), ITK_NULLPTR, buffer, 0);
+    const unsigned int nbApproximate = this->Search(nbNeighbors + 1, &(approximate[0]), ITK_NULLPTR, buffer, maxLeafChecks);
+
+    exactSet.clear();
+    for (unsigned int i = 0; i < nbExact && exactSet.size() < nbNeighbors; ++i)
+      {
+      if (exact[i] != queryId)
+        {
+        exactSet.push_back(exact[i]);
+        }
+      }
+    std::sort(exactSet.begin(), exactSet.end());
+    unsigned int nbKept = 0;
+    for (unsigned int i = 0; i < nbApproximate && nbKept < nbNeighbors; ++i)
+      {
+      if (approximate[i] != queryId)
+        {
+        ++nbKept;
+        if (std::binary_search(exactSet.begin(), exactSet.end(), approximate[i]))
+          {
+          ++nbFound;
+          }
+        }
+      }
+    }
+  return static_cast<double>(nbFound) / (static_cast<double>(nbQueries) * nbNeighbors);
+}
+
+double
+KdTreeIndex::TuneMaximumLeafChecks(unsigned int k, double targetRecall, unsigned int nbQueries)
+{
+  m_MaximumLeafChecks = 0;
+  if (targetRecall >= 1.0)
+    {
+    return 1.0;
+    }
+  for (unsigned int checks = 1; checks < m_NumberOfLeaves; checks *= 2)
+    {
+    const double recall = this->EstimateRecall(k, checks, nbQueries);
+    if (recall >= targetRecall)
+      {
+      m_MaximumLeafChecks = checks;
+      return recall;
+      }
+    }
+  return 1.0;
+}
+
+} // end namespace otb
@@ -0,0 +1,528 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "otbFlatRandomForest.h"
+#include "otbMachineLearningModel.h"
+#include "otbFlatRandomForestMachineLearningModel.h"
+#include "otbMachineLearningModelFactory.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkTimeProbe.h"
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <fstream>
+#include <iterator>
+
+int otbFlatRandomForest(int itkNotUsed(argc), char * itkNotUsed(argv) [])
+{
+  typedef otb::FlatRandomForest ForestType;
+
+  // tree 1: x0 <= 0.5 ? class 0 : (x1 <= 2 ? class 1 : class 2)
+  ForestType::TreeType tree1(5);
+  tree1[0].Feature = 0;
+  tree1[0].Threshold = 0.5;
+  tree1[0].Left = 1;
+  tree1[0].Right = 2;
+  tree1[1].ClassIndex = 0;
+  tree1[2].Feature = 1;
+  tree1[2].Threshold = 2.0;
+  tree1[2].Left = 3;
+  tree1[2].Right = 4;
+  tree1[3].ClassIndex = 1;
+  tree1[4].ClassIndex = 2;
+
+  // tree 2, rooted at the end of the node list: x1 <= 1 ? class 2 : class 1
+  ForestType::TreeType tree2(3);
+  tree2[0].ClassIndex = 2;
+  tree2[1].ClassIndex = 1;
+  tree2[2].Feature = 1;
+  tree2[2].Threshold = 1.0;
+  tree2[2].Left = 0;
+  tree2[2].Right = 1;
+
+  ForestType forest;
+  forest.Initialize(3, ForestType::VOTES);
+  forest.AddTree(tree1, 0);
+  forest.AddTree(tree2, 2);
+  forest.AddTree(tree2, 2);
+
+  if (forest.GetNumberOfTrees() != 3 || forest.GetNumberOfNodes() != 11)
+    {
+    std::cerr << "Wrong forest size: " << forest.GetNumberOfTrees() << " trees, "
+              << forest.GetNumberOfNodes() << " nodes" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const float samples[4][2] = {{0.0f, 0.0f}, {1.0f, 1.5f}, {1.0f, 3.0f}, {0.5f, 1.0f}};
+  const double expected[4][3] = {{1, 0, 2}, {0, 3, 0}, {0, 2, 1}, {1, 0, 2}};
+  const unsigned int expectedLeaders[4] = {2, 1, 1, 2};
+
+  std::vector<const float *> pointers;
+  for (unsigned int i = 0; i < 4; ++i)
+    {
+    pointers.push_back(samples[i]);
+    }
+  std::vector<double> scores(4 * 3);
+  std::vector<unsigned int> leaders(4);
+  forest.ComputeScores(&(pointers[0]), 4, &(scores[0]), &(leaders[0]));
+
+  for (unsigned int i = 0; i < 4; ++i)
+    {
+    for (unsigned int k = 0; k < 3; ++k)
+      {
+      if (scores[i * 3 + k] != expected[i][k])
+        {
+        std::cerr << "Wrong votes for sample " << i << ", class " << k << ": "
+                  << scores[i * 3 + k] << " instead of " << expected[i][k] << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    if (leaders[i] != expectedLeaders[i])
+      {
+      std::cerr << "Wrong leader for sample " << i << ": " << leaders[i] << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Ties: the first maximum is kept by ArgMax
+  const double tie[3] = {1.0, 2.0, 2.0};
+  if (ForestType::ArgMax(tie, 3) != 1 || ForestType::Margin(tie, 3) != 0.0
+      || ForestType::Margin(expected[2], 3) != 1.0)
+    {
+    std::cerr << "Wrong ArgMax or Margin" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Scores mode: weighted mean of the leaf scores
+  ForestType::TreeType stump(3);
+  stump[0].Feature = 0;
+  stump[0].Threshold = 0.5;
+  stump[0].Left = 1;
+  stump[0].Right = 2;
+  stump[1].Scores.assign(2, 0.25);
+  stump[1].Scores[1] = 0.75;
+  stump[2].Scores.assign(2, 1.0);
+  stump[2].Scores[1] = 0.0;
+  forest.Initialize(2, ForestType::SCORES);
+  forest.AddTree(stump, 0, 1.0);
+  forest.AddTree(stump, 0, 3.0);
+  forest.ComputeScores(&(pointers[0]), 2, &(scores[0]));
+  if (std::abs(scores[0] - 0.25) > 1e-12 || std::abs(scores[1] - 0.75) > 1e-12
+      || std::abs(scores[2] - 1.0) > 1e-12 || std::abs(scores[3]) > 1e-12)
+    {
+    std::cerr << "Wrong scores in SCORES mode" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
+
+int otbFlatRandomForestMachineLearningModel(int argc, char * argv [])
+{
+  typedef otb::FlatRandomForest ForestType;
+  typedef otb::FlatRandomForestMachineLearningModel<float, int> FlatModelType;
+  typedef otb::MachineLearningModelFactory<float, int>          FactoryType;
+
+  if (argc != 2)
+    {
+    std::cerr << "Usage: " << argv[0] << " model.frf" << std::endl;
+    return EXIT_FAILURE;
+    }
+  const std::string filename = argv[1];
+
+  // same forest as otbFlatRandomForest, with labels and the OpenCV 2 tie rule
+  ForestType::TreeType tree1(5);
+  tree1[0].Feature = 0;
+  tree1[0].Threshold = 0.5;
+  tree1[0].Left = 1;
+  tree1[0].Right = 2;
+  tree1[1].ClassIndex = 0;
+  tree1[2].Feature = 1;
+  tree1[2].Threshold = 2.0;
+  tree1[2].Left = 3;
+  tree1[2].Right = 4;
+  tree1[3].ClassIndex = 1;
+  tree1[4].ClassIndex = 2;
+  ForestType::TreeType tree2(3);
+  tree2[0].ClassIndex = 2;
+  tree2[1].ClassIndex = 1;
+  tree2[2].Feature = 1;
+  tree2[2].Threshold = 1.0;
+  tree2[2].Left = 0;
+  tree2[2].Right = 1;
+
+  ForestType forest;
+  forest.Initialize(3, ForestType::VOTES);
+  forest.AddTree(tree1, 0);
+  forest.AddTree(tree2, 2);
+  forest.AddTree(tree2, 2);
+  forest.SetTieRule(ForestType::FIRST_REACHED);
+  std::vector<double> labels;
+  labels.push_back(10.0);
+  labels.push_back(20.0);
+  labels.push_back(30.0);
+  forest.SetClassLabels(labels);
+
+  FlatModelType::Pointer writer = FlatModelType::New();
+  writer->SetFlatForest(forest);
+  writer->Save(filename);
+
+  if (!writer->CanWriteFile("model.frf") || writer->CanWriteFile("model.rf")
+      || dynamic_cast<FlatModelType *>(FactoryType::CreateMachineLearningModel("model.frf", FactoryType::WriteMode).GetPointer()) == ITK_NULLPTR)
+    {
+    std::cerr << "The flat forest model is not selected for writing .frf files" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The factory recognizes the file by its signature
+  FactoryType::MachineLearningModelTypePointer model =
+    FactoryType::CreateMachineLearningModel(filename, FactoryType::ReadMode);
+  if (model.IsNull() || dynamic_cast<FlatModelType *>(model.GetPointer()) == ITK_NULLPTR)
+    {
+    std::cerr << "The factory did not return a flat forest model" << std::endl;
+    return EXIT_FAILURE;
+    }
+  model->Load(filename);
+  const FlatModelType * flatModel = dynamic_cast<FlatModelType *>(model.GetPointer());
+  if (!flatModel->GetFlatForest().IsMapped() || flatModel->GetFlatForest().GetNumberOfNodes() != 11)
+    {
+    std::cerr << "The loaded forest is not mapped or has a wrong size" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const float samples[4][2] = {{0.0f, 0.0f}, {1.0f, 1.5f}, {1.0f, 3.0f}, {0.5f, 1.0f}};
+  const int expectedLabels[4] = {30, 20, 20, 30};
+  const double expectedConfidences[4] = {2.0 / 3.0, 1.0, 2.0 / 3.0, 2.0 / 3.0};
+
+  FlatModelType::InputSampleMatrixType matrix;
+  matrix.Data = &(samples[0][0]);
+  matrix.NumberOfSamplesPerLine = 4;
+  matrix.NumberOfLines = 1;
+  matrix.NumberOfFeatures = 2;
+  matrix.LineStride = 8;
+  matrix.Mask = ITK_NULLPTR;
+  std::vector<int> targets(4);
+  std::vector<double> confidences(4);
+  model->PredictMatrix(matrix, &(targets[0]), &(confidences[0]));
+
+  for (unsigned int i = 0; i < 4; ++i)
+    {
+    FlatModelType::InputSampleType sample(2);
+    sample[0] = samples[i][0];
+    sample[1] = samples[i][1];
+    double confidence = 0.0;
+    const int label = model->Predict(sample, &confidence)[0];
+    if (label != expectedLabels[i] || targets[i] != expectedLabels[i]
+        || std::abs(confidence - expectedConfidences[i]) > 1e-6
+        || std::abs(confidences[i] - expectedConfidences[i]) > 1e-6)
+      {
+      std::cerr << "Wrong prediction for sample " << i << ": " << label << " / " << targets[i]
+                << " (confidence " << confidence << " / " << confidences[i] << ")" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // A truncated file is rejected
+  const std::string truncated = filename + ".truncated";
+  {
+  std::ifstream ifs(filename.c_str(), std::ios::binary);
+  std::vector<char> content((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+  std::ofstream ofs(truncated.c_str(), std::ios::binary);
+  ofs.write(&(content[0]), content.size() - 8);
+  }
+  FlatModelType::Pointer reader = FlatModelType::New();
+  try
+    {
+    reader->Load(truncated);
+    std::cerr << "A truncated file was loaded" << std::endl;
+    return EXIT_FAILURE;
+    }
+  catch (itk::ExceptionObject &)
+    {
+    }
+
+  FactoryType::CleanFactories();
+  return EXIT_SUCCESS;
+}
+
+namespace
+{
+
+/** Generate samples of nbClasses noisy gaussian blobs */
+template <class TModel>
+void GenerateFlatForestSamples(unsigned int nbSamples, unsigned int nbFeatures, unsigned int nbClasses,
+                               typename TModel::InputListSampleType * samples,
+                               typename TModel::TargetListSampleType * labels)
+{
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator GeneratorType;
+  GeneratorType::Pointer generator = GeneratorType::New();
+  generator->Initialize(12345);
+
+  samples->SetMeasurementVectorSize(nbFeatures);
+  typename TModel::InputSampleType sample(nbFeatures);
+  typename TModel::TargetSampleType label;
+  for (unsigned int i = 0; i < nbSamples; ++i)
+    {
+    const unsigned int c = i % nbClasses;
+    for (unsigned int f = 0; f < nbFeatures; ++f)
+      {
+      sample[f] = static_cast<typename TModel::InputValueType>(
+        10.0 * ((c + f) % nbClasses) + generator->GetNormalVariate(0.0, 25.0));
+      }
+    label[0] = static_cast<typename TModel::TargetValueType>(c);
+    samples->PushBack(sample);
+    labels->PushBack(label);
+    }
+}
+
+/** Compare the native batch prediction with the flat forest prediction.
+ * When probes are given, both predictions are timed. */
+template <class TModel>
+int CompareFlatForestPredictions(TModel * model, typename TModel::InputListSampleType * samples,
+                                 itk::TimeProbe * nativeProbe = ITK_NULLPTR,
+                                 itk::TimeProbe * flatProbe = ITK_NULLPTR)
+{
+  typedef typename TModel::ConfidenceListSampleType ConfidenceListSampleType;
+  typedef typename TModel::TargetListSampleType     TargetListSampleType;
+  typedef typename TModel::InputSampleMatrixType    InputSampleMatrixType;
+  typedef typename TModel::InputValueType           InputValueType;
+
+  const unsigned int nbSamples = samples->Size();
+  const unsigned int nbFeatures = samples->GetMeasurementVectorSize();
+
+  typename ConfidenceListSampleType::Pointer nativeConfidences = ConfidenceListSampleType::New();
+  if (nativeProbe)
+    {
+    nativeProbe->Start();
+    }
+  typename TargetListSampleType::Pointer nativeLabels = model->PredictBatch(samples, nativeConfidences);
+  if (nativeProbe)
+    {
+    nativeProbe->Stop();
+    }
+
+  std::vector<InputValueType> buffer(nbSamples * nbFeatures);
+  for (unsigned int i = 0; i < nbSamples; ++i)
+    {
+    for (unsigned int f = 0; f < nbFeatures; ++f)
+      {
+      buffer[i * nbFeatures + f] = samples->GetMeasurementVector(i)[f];
+      }
+    }
+  InputSampleMatrixType matrix;
+  matrix.Data = &(buffer[0]);
+  matrix.NumberOfSamplesPerLine = nbSamples;
+  matrix.NumberOfLines = 1;
+  matrix.NumberOfFeatures = nbFeatures;
+  matrix.LineStride = nbSamples * nbFeatures;
+
+  std::vector<typename TModel::TargetValueType> flatLabels(nbSamples);
+  std::vector<typename TModel::ConfidenceValueType> flatConfidences(nbSamples);
+  if (flatProbe)
+    {
+    flatProbe->Start();
+    }
+  model->PredictMatrix(matrix, &(flatLabels[0]), &(flatConfidences[0]));
+  if (flatProbe)
+    {
+    flatProbe->Stop();
+    }
+
+  // Labels must match exactly. Confidences are sums of votes or scores that
+  // may be accumulated in a different order, hence the tolerance.
+  const double confidenceTolerance = 1e-6;
+  unsigned int nbErrors = 0;
+  for (unsigned int i = 0; i < nbSamples; ++i)
+    {
+    if (flatLabels[i] != nativeLabels->GetMeasurementVector(i)[0]
+        || std::abs(static_cast<double>(flatConfidences[i])
+                    - static_cast<double>(nativeConfidences->GetMeasurementVector(i)[0])) > confidenceTolerance)
+      {
+      if (nbErrors < 10)
+        {
+        std::cerr << "Sample " << i << ": native (" << nativeLabels->GetMeasurementVector(i)[0]
+                  << ", " << nativeConfidences->GetMeasurementVector(i)[0] << "), flat ("
+                  << flatLabels[i] << ", " << flatConfidences[i] << ")" << std::endl;
+        }
+      ++nbErrors;
+      }
+    }
+  if (nbErrors > 0)
+    {
+    std::cerr << nbErrors << " different predictions" << std::endl;
+    return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
+
+} // end anonymous namespace
+
+#ifdef OTB_USE_OPENCV
+#include "otbRandomForestsMachineLearningModel.h"
+
+namespace
+{
+
+int RunRandomForestsFlatForest(int argc, char * argv[], bool benchmark)
+{
+  typedef otb::RandomForestsMachineLearningModel<float, int> RandomForestType;
+  const unsigned int nbSamples = (argc > 1 ? atoi(argv[1]) : 20000);
+  const unsigned int nbTrees = (argc > 2 ? atoi(argv[2]) : 100);
+
+  RandomForestType::InputListSampleType::Pointer samples = RandomForestType::InputListSampleType::New();
+  RandomForestType::TargetListSampleType::Pointer labels = RandomForestType::TargetListSampleType::New();
+  GenerateFlatForestSamples<RandomForestType>(nbSamples, 8, 5, samples, labels);
+
+  RandomForestType::Pointer model = RandomForestType::New();
+  model->SetInputListSample(samples);
+  model->SetTargetListSample(labels);
+  model->SetMaxDepth(25);
+  model->SetMinSampleCount(5);
+  model->SetMaxNumberOfTrees(nbTrees);
+  model->SetForestAccuracy(0.0);
+  model->Train();
+
+  // Training a flat forest model delegates to the native forest
+  if (!benchmark)
+    {
+    typedef otb::FlatRandomForestMachineLearningModel<float, RandomForestType::TargetValueType> FlatModelType;
+    FlatModelType::Pointer flatModel = FlatModelType::New();
+    flatModel->SetInputListSample(samples);
+    flatModel->SetTargetListSample(labels);
+    flatModel->SetTrainingModel(model);
+    flatModel->Train();
+    if (flatModel->GetFlatForest().GetNumberOfTrees() != model->GetFlatForest().GetNumberOfTrees()
+        || flatModel->GetFlatForest().GetNumberOfNodes() != model->GetFlatForest().GetNumberOfNodes())
+      {
+      std::cerr << "The trained flat forest differs from the native forest" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  int result = EXIT_SUCCESS;
+  for (unsigned int margin = 0; margin < 2; ++margin)
+    {
+    model->SetComputeMargin(margin == 1);
+    itk::TimeProbe nativeProbe, flatProbe;
+    if (CompareFlatForestPredictions<RandomForestType>(model, samples,
+                                                      benchmark ? &nativeProbe : ITK_NULLPTR,
+                                                      benchmark ? &flatProbe : ITK_NULLPTR) != EXIT_SUCCESS)
+      {
+      result = EXIT_FAILURE;
+      }
+    if (benchmark)
+      {
+      std::cout << "Margin " << margin << ": native prediction " << nativeProbe.GetTotal()
+                << " s, flat forest prediction " << flatProbe.GetTotal() << " s" << std::endl;
+      }
+    }
+  return result;
+}
+
+} // end anonymous namespace
+
+int otbRandomForestsFlatForestPrediction(int argc, char * argv[])
+{
+  return RunRandomForestsFlatForest(argc, argv, false);
+}
+
+// Not part of ctest: run it manually through the test driver to time both
+// prediction paths, e.g. otbRandomForestsFlatForestBenchmark 200000 100
+int otbRandomForestsFlatForestBenchmark(int argc, char * argv[])
+{
+  return RunRandomForestsFlatForest(argc, argv, true);
+}
+#endif
+
+#ifdef OTB_USE_SHARK
+#include "otbSharkRandomForestsMachineLearningModel.h"
+
+namespace
+{
+
+int RunSharkRFFlatForest(int argc, char * argv[], bool benchmark)
+{
+  typedef otb::SharkRandomForestsMachineLearningModel<float, unsigned int> RandomForestType;
+  const unsigned int nbSamples = (argc > 1 ? atoi(argv[1]) : 20000);
+  const unsigned int nbTrees = (argc > 2 ? atoi(argv[2]) : 100);
+
+  RandomForestType::InputListSampleType::Pointer samples = RandomForestType::InputListSampleType::New();
+  RandomForestType::TargetListSampleType::Pointer labels = RandomForestType::TargetListSampleType::New();
+  GenerateFlatForestSamples<RandomForestType>(nbSamples, 8, 5, samples, labels);
+
+  RandomForestType::Pointer model = RandomForestType::New();
+  model->SetInputListSample(samples);
+  model->SetTargetListSample(labels);
+  model->SetNumberOfTrees(nbTrees);
+  model->SetNodeSize(5);
+  model->Train();
+
+  // Training a flat forest model delegates to the native forest
+  if (!benchmark)
+    {
+    typedef otb::FlatRandomForestMachineLearningModel<float, RandomForestType::TargetValueType> FlatModelType;
+    FlatModelType::Pointer flatModel = FlatModelType::New();
+    flatModel->SetInputListSample(samples);
+    flatModel->SetTargetListSample(labels);
+    flatModel->SetTrainingModel(model);
+    flatModel->Train();
+    if (flatModel->GetFlatForest().GetNumberOfTrees() != model->GetFlatForest().GetNumberOfTrees()
+        || flatModel->GetFlatForest().GetNumberOfNodes() != model->GetFlatForest().GetNumberOfNodes())
+      {
+      std::cerr << "The trained flat forest differs from the native forest" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  int result = EXIT_SUCCESS;
+  for (unsigned int margin = 0; margin < 2; ++margin)
+    {
+    model->SetComputeMargin(margin == 1);
+    itk::TimeProbe nativeProbe, flatProbe;
+    if (CompareFlatForestPredictions<RandomForestType>(model, samples,
+                                                      benchmark ? &nativeProbe : ITK_NULLPTR,
+                                                      benchmark ? &flatProbe : ITK_NULLPTR) != EXIT_SUCCESS)
+      {
+      result = EXIT_FAILURE;
+      }
+    if (benchmark)
+      {
+      std::cout << "Margin " << margin << ": native prediction " << nativeProbe.GetTotal()
+                << " s, flat forest prediction " << flatProbe.GetTotal() << " s" << std::endl;
+      }
+    }
+  return result;
+}
+
+} // end anonymous namespace
+
+int otbSharkRFFlatForestPrediction(int argc, char * argv[])
+{
+  return RunSharkRFFlatForest(argc, argv, false);
+}
+
+// Not part of ctest: run it manually through the test driver to time both
+// prediction paths, e.g. otbSharkRFFlatForestBenchmark 200000 100
+int otbSharkRFFlatForestBenchmark(int argc, char * argv[])
+{
+  return RunSharkRFFlatForest(argc, argv, true);
+}
+#endif
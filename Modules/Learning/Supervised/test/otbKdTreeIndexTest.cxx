@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "otbKdTreeIndex.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+
+int otbKdTreeIndex(int itkNotUsed(argc), char * itkNotUsed(argv) [])
+{
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator GeneratorType;
+  GeneratorType::Pointer generator = GeneratorType::New();
+  generator->SetSeed(42);
+
+  // Values on a coarse grid, so that there are many equidistant points
+  const unsigned int nbPoints = 5000;
+  const unsigned int nbFeatures = 4;
+  const unsigned int k = 8;
+  std::vector<float> points(nbPoints * nbFeatures);
+  for (unsigned int i = 0; i < points.size(); ++i)
+    {
+    points[i] = static_cast<float>(generator->GetIntegerVariate(20));
+    }
+
+  otb::KdTreeIndex tree;
+  tree.Build(&(points[0]), nbPoints, nbFeatures, 8);
+  std::cout << "Tree with " << tree.GetNumberOfLeaves() << " leaves" << std::endl;
+
+  // Exact search: same neighbors and order as a brute force search
+  otb::KdTreeIndex::SearchBuffer buffer;
+  buffer.Query.resize(nbFeatures);
+  std::vector<std::pair<float, unsigned int> > reference(nbPoints);
+  unsigned int indices[k];
+  float distances[k];
+  for (unsigned int q = 0; q < 100; ++q)
+    {
+    for (unsigned int f = 0; f < nbFeatures; ++f)
+      {
+      buffer.Query[f] = static_cast<float>(generator->GetUniformVariate(-2.0, 22.0));
+      }
+    for (unsigned int i = 0; i < nbPoints; ++i)
+      {
+      float distance = 0.0f;
+      for (unsigned int f = 0; f < nbFeatures; ++f)
+        {
+        const float d = points[i * nbFeatures + f] - buffer.Query[f];
+        distance += d * d;
+        }
+      reference[i] = std::make_pair(distance, i);
+      }
+    std::partial_sort(reference.begin(), reference.begin() + k, reference.end());
+
+    if (tree.Search(k, indices, distances, buffer) != k)
+      {
+      std::cerr << "Wrong number of neighbors" << std::endl;
+      return EXIT_FAILURE;
+      }
+    for (unsigned int i = 0; i < k; ++i)
+      {
+      if (indices[i] != reference[i].second || distances[i] != reference[i].first)
+        {
+        std::cerr << "Query " << q << ", neighbor " << i << ": got " << indices[i] << " (" << distances[i]
+                  << "), expected " << reference[i].second << " (" << reference[i].first << ")" << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  // More neighbors than points
+  otb::KdTreeIndex small;
+  small.Build(&(points[0]), 3, nbFeatures);
+  if (small.Search(k, indices, distances, buffer) != 3)
+    {
+    std::cerr << "Wrong number of neighbors in a small tree" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Approximate search
+  if (tree.EstimateRecall(k, 0) != 1.0)
+    {
+    std::cerr << "An exact search should have a recall of 1" << std::endl;
+    return EXIT_FAILURE;
+    }
+  const double recall = tree.TuneMaximumLeafChecks(k, 0.9);
+  std::cout << "Recall " << recall << " with " << tree.GetMaximumLeafChecks() << " leaf checks" << std::endl;
+  if (recall < 0.9 || tree.GetMaximumLeafChecks() >= tree.GetNumberOfLeaves())
+    {
+    std::cerr << "Approximate search tuning failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  tree.TuneMaximumLeafChecks(k, 1.0);
+  if (tree.GetMaximumLeafChecks() != 0)
+    {
+    std::cerr << "A recall target of 1 should give an exact search" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
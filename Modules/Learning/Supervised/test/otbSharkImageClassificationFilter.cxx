@@ -24,8 +24,10 @@
 #include "otbImageFileReader.h"
 #include "otbImageFileWriter.h"
 #include "otbSharkRandomForestsMachineLearningModelFactory.h"
+#include "itkImageRegionIterator.h"
 #include <random>
 #include <chrono>
+#include <cmath>
 
 const unsigned int Dimension = 2;
 typedef float PixelType;
@@ -163,3 +165,111 @@ int otbSharkImageClassificationFilter(int argc, char * argv[])
 
   return EXIT_SUCCESS;
 }
+
+int otbSharkImageClassificationFilterBatchMatrix(int argc, char * argv[])
+{
+  if(argc != 2)
+    {
+    std::cout << "Usage: output_model\n";
+    return EXIT_FAILURE;
+    }
+  std::string modelfname = argv[1];
+  const unsigned int num_features = 4;
+  buildModel(3, 1000, num_features, modelfname);
+
+  // Synthetic image and mask, entirely buffered
+  ImageType::RegionType region;
+  region.SetSize(0, 64);
+  region.SetSize(1, 48);
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions(region);
+  image->SetNumberOfComponentsPerPixel(num_features);
+  image->Allocate();
+  LabeledImageType::Pointer mask = LabeledImageType::New();
+  mask->SetRegions(region);
+  mask->Allocate();
+
+  std::default_random_engine generator;
+  std::uniform_int_distribution<int> feat_distribution(0,256);
+  itk::ImageRegionIterator<ImageType> imIt(image, region);
+  itk::ImageRegionIterator<LabeledImageType> maskIt(mask, region);
+  ImageType::PixelType pix(num_features);
+  for(imIt.GoToBegin(), maskIt.GoToBegin(); !imIt.IsAtEnd(); ++imIt, ++maskIt)
+    {
+    for(unsigned int i=0; i<num_features; ++i)
+      pix[i] = feat_distribution(generator);
+    imIt.Set(pix);
+    maskIt.Set((imIt.GetIndex()[0] + imIt.GetIndex()[1]) % 5 == 0 ? 0 : 1);
+    }
+
+  MachineLearningModelType::Pointer model = MachineLearningModelType::New();
+  model->Load(modelfname);
+
+  // Sub-region narrower than the buffered region, so that lines are
+  // not contiguous in the input buffer
+  ImageType::RegionType subRegion;
+  subRegion.SetIndex(0, 5);
+  subRegion.SetIndex(1, 7);
+  subRegion.SetSize(0, 37);
+  subRegion.SetSize(1, 30);
+
+  ClassificationFilterType::Pointer filter = ClassificationFilterType::New();
+  filter->SetModel(model);
+  filter->SetInput(image);
+  filter->SetInputMask(mask);
+  filter->SetDefaultLabel(42);
+  filter->SetUseConfidenceMap(true);
+  filter->SetBatchMode(true);
+  filter->GetOutput()->SetRequestedRegion(subRegion);
+  filter->GetOutputConfidence()->SetRequestedRegion(subRegion);
+  filter->Update();
+
+  // Reference: list sample prediction of the unmasked pixels
+  LocalInputListSampleType::Pointer samples = LocalInputListSampleType::New();
+  samples->SetMeasurementVectorSize(num_features);
+  itk::ImageRegionConstIterator<ImageType> subImIt(image, subRegion);
+  itk::ImageRegionConstIterator<LabeledImageType> subMaskIt(mask, subRegion);
+  for(; !subImIt.IsAtEnd(); ++subImIt, ++subMaskIt)
+    {
+    if(subMaskIt.Get() > 0)
+      {
+      samples->PushBack(subImIt.Get());
+      }
+    }
+  MachineLearningModelType::ConfidenceListSampleType::Pointer refConfidences =
+    MachineLearningModelType::ConfidenceListSampleType::New();
+  LocalTargetListSampleType::Pointer refLabels = model->PredictBatch(samples, refConfidences);
+
+  unsigned int nbErrors = 0;
+  unsigned int nbMasked = 0;
+  unsigned int refId = 0;
+  itk::ImageRegionConstIterator<LabeledImageType> outIt(filter->GetOutput(), subRegion);
+  itk::ImageRegionConstIterator<ClassificationFilterType::ConfidenceImageType> confIt(filter->GetOutputConfidence(), subRegion);
+  for(subMaskIt.GoToBegin(); !outIt.IsAtEnd(); ++outIt, ++confIt, ++subMaskIt)
+    {
+    if(subMaskIt.Get() == 0)
+      {
+      ++nbMasked;
+      if(outIt.Get() != 42 || confIt.Get() != 0.0)
+        {
+        ++nbErrors;
+        }
+      }
+    else
+      {
+      if(outIt.Get() != refLabels->GetMeasurementVector(refId)[0]
+         || std::abs(confIt.Get() - refConfidences->GetMeasurementVector(refId)[0]) > 1e-9)
+        {
+        ++nbErrors;
+        }
+      ++refId;
+      }
+    }
+
+  std::cout << nbMasked << " masked pixels, " << nbErrors << " differences with list sample prediction\n";
+  if(nbErrors > 0 || nbMasked == 0)
+    {
+    return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
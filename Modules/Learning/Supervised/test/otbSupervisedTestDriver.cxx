@@ -36,12 +36,17 @@ void RegisterTests()
   REGISTER_TEST(otbConfusionMatrixConcatenateTest);
   REGISTER_TEST(otbExhaustiveExponentialOptimizerNew);
   REGISTER_TEST(otbExhaustiveExponentialOptimizerTest);
+  REGISTER_TEST(otbFlatRandomForest);
+  REGISTER_TEST(otbFlatRandomForestMachineLearningModel);
+  REGISTER_TEST(otbKdTreeIndex);
   
   #ifdef OTB_USE_LIBSVM
   REGISTER_TEST(otbLibSVMMachineLearningModelCanRead);
   REGISTER_TEST(otbLibSVMMachineLearningModelNew);
   REGISTER_TEST(otbLibSVMMachineLearningModel);
   REGISTER_TEST(otbLibSVMRegressionTests);
+  REGISTER_TEST(otbLibSVMMachineLearningModelPrimalForm);
+  REGISTER_TEST(otbLibSVMMachineLearningModelParallelOptimization);
   REGISTER_TEST(otbLabelMapClassifierNew);
   REGISTER_TEST(otbLabelMapClassifier);
   REGISTER_TEST(otbSVMCrossValidationCostFunctionNew);
@@ -62,8 +67,11 @@ void RegisterTests()
   REGISTER_TEST(otbSVMMachineLearningModel);
   REGISTER_TEST(otbKNearestNeighborsMachineLearningModelNew);
   REGISTER_TEST(otbKNearestNeighborsMachineLearningModel);
+  REGISTER_TEST(otbKNearestNeighborsMachineLearningModelKdTree);
   REGISTER_TEST(otbRandomForestsMachineLearningModelNew);
   REGISTER_TEST(otbRandomForestsMachineLearningModel);
+  REGISTER_TEST(otbRandomForestsFlatForestPrediction);
+  REGISTER_TEST(otbRandomForestsFlatForestBenchmark);
   REGISTER_TEST(otbBoostMachineLearningModelNew);
   REGISTER_TEST(otbBoostMachineLearningModel);
   REGISTER_TEST(otbANNMachineLearningModelNew);
@@ -91,7 +99,10 @@ void RegisterTests()
   REGISTER_TEST(otbSharkRFMachineLearningModelNew);
   REGISTER_TEST(otbSharkRFMachineLearningModel);
   REGISTER_TEST(otbSharkRFMachineLearningModelCanRead);
+  REGISTER_TEST(otbSharkRFFlatForestPrediction);
+  REGISTER_TEST(otbSharkRFFlatForestBenchmark);
   REGISTER_TEST(otbSharkImageClassificationFilter);
+  REGISTER_TEST(otbSharkImageClassificationFilterBatchMatrix);
 #endif
 
   REGISTER_TEST(otbImageClassificationFilterNew);
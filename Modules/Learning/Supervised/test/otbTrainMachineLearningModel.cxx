@@ -22,6 +22,8 @@
 #include <fstream>
 #include <string>
 #include <algorithm>
+#include <vector>
+#include <cmath>
 
 #include <otbMachineLearningModel.h>
 #include "otbConfusionMatrixCalculator.h"
@@ -260,6 +262,179 @@ int otbLibSVMMachineLearningModel(int argc, char * argv[])
     return EXIT_FAILURE;
     }
 }
+
+int otbLibSVMMachineLearningModelPrimalForm(int argc, char * argv[])
+{
+  if (argc != 2)
+    {
+    std::cout<<"Wrong number of arguments "<<std::endl;
+    std::cout<<"Usage : sample file"<<std::endl;
+    return EXIT_FAILURE;
+    }
+
+  typedef otb::LibSVMMachineLearningModel<InputValueType, TargetValueType> SVMType;
+  InputListSampleType::Pointer allSamples = InputListSampleType::New();
+  TargetListSampleType::Pointer allLabels = TargetListSampleType::New();
+
+  if (!ReadDataFile(argv[1], allSamples, allLabels))
+    {
+    std::cout << "Failed to read samples file " << argv[1] << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Keep the training time low: 2000 samples for training, 1000 for validation
+  InputListSampleType::Pointer samples = InputListSampleType::New();
+  TargetListSampleType::Pointer labels = TargetListSampleType::New();
+  InputListSampleType::Pointer validation = InputListSampleType::New();
+  samples->SetMeasurementVectorSize(allSamples->GetMeasurementVectorSize());
+  validation->SetMeasurementVectorSize(allSamples->GetMeasurementVectorSize());
+  for (unsigned int i = 0; i < 3000 && i < allSamples->Size(); ++i)
+    {
+    if (i < 2000)
+      {
+      samples->PushBack(allSamples->GetMeasurementVector(i));
+      labels->PushBack(allLabels->GetMeasurementVector(i));
+      }
+    else
+      {
+      validation->PushBack(allSamples->GetMeasurementVector(i));
+      }
+    }
+
+  int status = EXIT_SUCCESS;
+
+  // Linear kernel: the primal form must give the libsvm predictions
+  for (unsigned int withProba = 0; withProba < 2; ++withProba)
+    {
+    SVMType::Pointer classifier = SVMType::New();
+    classifier->SetInputListSample(samples);
+    classifier->SetTargetListSample(labels);
+    classifier->SetDoProbabilityEstimates(withProba == 1);
+    classifier->Train();
+
+    if (!classifier->HasPrimalForm())
+      {
+      std::cout << "No primal form for a linear kernel" << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    classifier->FastPredictionOn();
+    TargetListSampleType::Pointer fast = classifier->PredictBatch(validation, NULL);
+    classifier->FastPredictionOff();
+    TargetListSampleType::Pointer exact = classifier->PredictBatch(validation, NULL);
+
+    unsigned int nbDiff = 0;
+    for (unsigned int i = 0; i < validation->Size(); ++i)
+      {
+      if (fast->GetMeasurementVector(i)[0] != exact->GetMeasurementVector(i)[0])
+        {
+        ++nbDiff;
+        }
+      }
+    const double agreement = classifier->ComputePrimalFormAgreement(validation);
+    std::cout << "Linear kernel (probabilities: " << withProba << "): "
+              << nbDiff << " different predictions, agreement " << agreement << std::endl;
+    // only ties broken differently by rounding errors are tolerated
+    if (nbDiff > validation->Size() / 1000 || agreement < 0.999)
+      {
+      status = EXIT_FAILURE;
+      }
+    }
+
+  // RBF kernel approximated with random Fourier features
+  SVMType::Pointer rbf = SVMType::New();
+  rbf->SetInputListSample(samples);
+  rbf->SetTargetListSample(labels);
+  rbf->SetKernelType(RBF);
+  rbf->Train();
+  if (rbf->HasPrimalForm())
+    {
+    std::cout << "Unexpected primal form for an exact RBF kernel" << std::endl;
+    status = EXIT_FAILURE;
+    }
+  rbf->SetNumberOfRandomFeatures(2000);
+  if (!rbf->HasPrimalForm())
+    {
+    std::cout << "No primal form with random features" << std::endl;
+    return EXIT_FAILURE;
+    }
+  const double rbfAgreement = rbf->ComputePrimalFormAgreement(validation);
+  std::cout << "RBF kernel with 2000 random features: agreement " << rbfAgreement << std::endl;
+  if (rbfAgreement < 0.7)
+    {
+    status = EXIT_FAILURE;
+    }
+
+  return status;
+}
+
+int otbLibSVMMachineLearningModelParallelOptimization(int argc, char * argv[])
+{
+  if (argc != 2)
+    {
+    std::cout<<"Wrong number of arguments "<<std::endl;
+    std::cout<<"Usage : sample file"<<std::endl;
+    return EXIT_FAILURE;
+    }
+
+  typedef otb::LibSVMMachineLearningModel<InputValueType, TargetValueType> SVMType;
+  InputListSampleType::Pointer allSamples = InputListSampleType::New();
+  TargetListSampleType::Pointer allLabels = TargetListSampleType::New();
+
+  if (!ReadDataFile(argv[1], allSamples, allLabels))
+    {
+    std::cout << "Failed to read samples file " << argv[1] << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Keep the optimization time low: 500 samples, small grids
+  InputListSampleType::Pointer samples = InputListSampleType::New();
+  TargetListSampleType::Pointer labels = TargetListSampleType::New();
+  samples->SetMeasurementVectorSize(allSamples->GetMeasurementVectorSize());
+  for (unsigned int i = 0; i < 500 && i < allSamples->Size(); ++i)
+    {
+    samples->PushBack(allSamples->GetMeasurementVector(i));
+    labels->PushBack(allLabels->GetMeasurementVector(i));
+    }
+
+  // The early stopping must not change the selected parameters
+  double c[2], gamma[2], accuracy[2];
+  for (unsigned int earlyStopping = 0; earlyStopping < 2; ++earlyStopping)
+    {
+    SVMType::Pointer classifier = SVMType::New();
+    classifier->SetInputListSample(samples);
+    classifier->SetTargetListSample(labels);
+    classifier->SetKernelType(RBF);
+    classifier->SetParameterOptimization(true);
+    classifier->SetCoarseOptimizationNumberOfSteps(2);
+    classifier->SetFineOptimizationNumberOfSteps(2);
+    classifier->ParallelOptimizationOn();
+    classifier->SetOptimizationEarlyStopping(earlyStopping == 1);
+    classifier->Train();
+
+    c[earlyStopping] = classifier->GetC();
+    gamma[earlyStopping] = classifier->GetKernelGamma();
+    accuracy[earlyStopping] = classifier->GetFinalCrossValidationAccuracy();
+    std::cout << "Early stopping " << earlyStopping << ": C " << c[earlyStopping]
+              << ", gamma " << gamma[earlyStopping]
+              << ", accuracy " << classifier->GetInitialCrossValidationAccuracy()
+              << " -> " << accuracy[earlyStopping] << std::endl;
+
+    if (accuracy[earlyStopping] < classifier->GetInitialCrossValidationAccuracy())
+      {
+      std::cout << "Optimization decreased the accuracy" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  if (c[0] != c[1] || gamma[0] != gamma[1] || accuracy[0] != accuracy[1])
+    {
+    std::cout << "Early stopping changed the optimization result" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
 #endif
 
 #ifdef OTB_USE_OPENCV
@@ -496,6 +671,123 @@ int otbKNearestNeighborsMachineLearningModel(int argc, char * argv[])
     }
 }
 
+int otbKNearestNeighborsMachineLearningModelKdTree(int argc, char * argv[])
+{
+  if (argc != 3 )
+    {
+    std::cout<<"Wrong number of arguments "<<std::endl;
+    std::cout<<"Usage : sample file, output file"<<std::endl;
+    return EXIT_FAILURE;
+    }
+
+  typedef otb::KNearestNeighborsMachineLearningModel<InputValueType,TargetValueType> KNearestNeighborsType;
+  InputListSampleType::Pointer allSamples = InputListSampleType::New();
+  TargetListSampleType::Pointer allLabels = TargetListSampleType::New();
+
+  if(!ReadDataFile(argv[1],allSamples,allLabels))
+    {
+    std::cout<<"Failed to read samples file "<<argv[1]<<std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // 4000 samples for training, 1000 for validation
+  InputListSampleType::Pointer samples = InputListSampleType::New();
+  TargetListSampleType::Pointer labels = TargetListSampleType::New();
+  InputListSampleType::Pointer validation = InputListSampleType::New();
+  samples->SetMeasurementVectorSize(allSamples->GetMeasurementVectorSize());
+  validation->SetMeasurementVectorSize(allSamples->GetMeasurementVectorSize());
+  for (unsigned int i = 0; i < 5000 && i < allSamples->Size(); ++i)
+    {
+    if (i < 4000)
+      {
+      samples->PushBack(allSamples->GetMeasurementVector(i));
+      labels->PushBack(allLabels->GetMeasurementVector(i));
+      }
+    else
+      {
+      validation->PushBack(allSamples->GetMeasurementVector(i));
+      }
+    }
+
+  KNearestNeighborsType::Pointer classifier = KNearestNeighborsType::New();
+  classifier->SetInputListSample(samples);
+  classifier->SetTargetListSample(labels);
+  const unsigned int k = 5;
+  classifier->SetK(k);
+  classifier->Train();
+
+  // Exact k-d tree search against OpenCV brute force search. The votes
+  // only depend on the set of k neighbors, so predictions may differ only
+  // when the k-th and (k+1)-th nearest samples are equidistant: OpenCV and
+  // the tree then keep different samples. Any other difference is an error.
+  TargetListSampleType::Pointer predictedTree = classifier->PredictBatch(validation, NULL);
+  classifier->UseKdTreeOff();
+  TargetListSampleType::Pointer predictedBruteForce = classifier->PredictBatch(validation, NULL);
+  const unsigned int nbFeatures = samples->GetMeasurementVectorSize();
+  unsigned int nbTies = 0;
+  std::vector<double> distances(samples->Size());
+  for (unsigned int i = 0; i < validation->Size(); ++i)
+    {
+    if (predictedTree->GetMeasurementVector(i)[0] == predictedBruteForce->GetMeasurementVector(i)[0])
+      {
+      continue;
+      }
+    for (unsigned int j = 0; j < samples->Size(); ++j)
+      {
+      distances[j] = 0.0;
+      for (unsigned int f = 0; f < nbFeatures; ++f)
+        {
+        const double d = static_cast<double>(samples->GetMeasurementVector(j)[f])
+          - static_cast<double>(validation->GetMeasurementVector(i)[f]);
+        distances[j] += d * d;
+        }
+      }
+    std::partial_sort(distances.begin(), distances.begin() + k + 1, distances.end());
+    if (std::abs(distances[k] - distances[k - 1]) > 1e-5 * std::max(1.0, distances[k - 1]))
+      {
+      std::cout << "Different prediction for validation sample " << i << " without a tie at the k-th neighbor: "
+                << predictedTree->GetMeasurementVector(i)[0] << " instead of "
+                << predictedBruteForce->GetMeasurementVector(i)[0] << std::endl;
+      return EXIT_FAILURE;
+      }
+    ++nbTies;
+    }
+  std::cout << "Exact k-d tree search: " << nbTies << " different predictions, all on ties" << std::endl;
+
+  // Approximate search, saved with the model
+  classifier->UseKdTreeOn();
+  classifier->SetRecallTarget(0.9);
+  classifier->Train();
+  classifier->Save(argv[2]);
+  std::cout << "Approximate k-d tree search: " << classifier->GetMaximumLeafChecks() << " leaf checks" << std::endl;
+  if (classifier->GetMaximumLeafChecks() == 0)
+    {
+    return EXIT_FAILURE;
+    }
+
+  KNearestNeighborsType::Pointer classifierLoad = KNearestNeighborsType::New();
+  classifierLoad->Load(argv[2]);
+  if (classifierLoad->GetRecallTarget() != 0.9
+      || classifierLoad->GetMaximumLeafChecks() != classifier->GetMaximumLeafChecks())
+    {
+    std::cout << "Approximate search parameters not restored: recall target " << classifierLoad->GetRecallTarget()
+              << ", " << classifierLoad->GetMaximumLeafChecks() << " leaf checks" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  TargetListSampleType::Pointer predicted = classifier->PredictBatch(validation, NULL);
+  TargetListSampleType::Pointer predictedLoad = classifierLoad->PredictBatch(validation, NULL);
+  for (unsigned int i = 0; i < validation->Size(); ++i)
+    {
+    if (predicted->GetMeasurementVector(i)[0] != predictedLoad->GetMeasurementVector(i)[0])
+      {
+      std::cout << "Different prediction after loading the model" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  return EXIT_SUCCESS;
+}
+
 int otbRandomForestsMachineLearningModelNew(int itkNotUsed(argc), char * itkNotUsed(argv) [])
 {
   typedef otb::RandomForestsMachineLearningModel<InputValueType,TargetValueType> RandomForestType;
@@ -46,6 +46,16 @@ otb_add_test(NAME leTvLibSVMMachineLearningModelReg COMMAND otbSupervisedTestDri
   otbLibSVMRegressionTests
   )
 
+otb_add_test(NAME leTvLibSVMMachineLearningModelPrimalForm COMMAND otbSupervisedTestDriver
+  otbLibSVMMachineLearningModelPrimalForm
+  ${INPUTDATA}/letter.scale
+  )
+
+otb_add_test(NAME leTvLibSVMMachineLearningModelParallelOptimization COMMAND otbSupervisedTestDriver
+  otbLibSVMMachineLearningModelParallelOptimization
+  ${INPUTDATA}/letter.scale
+  )
+
 #otb_add_test(NAME obTvLabelMapSVMClassifier COMMAND otbSupervisedTestDriver
   #otbLabelMapClassifier
   #${INPUTDATA}/maur.tif
@@ -103,6 +103,11 @@ otb_add_test(NAME leTvRandomForestsMachineLearningModel COMMAND otbSupervisedTes
   ${TEMP}/rf_model.txt
   )
 
+otb_add_test(NAME leTvRandomForestsFlatForestPrediction COMMAND otbSupervisedTestDriver
+  otbRandomForestsFlatForestPrediction
+  5000 50
+  )
+
 otb_add_test(NAME leTuANNMachineLearningModelNew COMMAND otbSupervisedTestDriver
   otbANNMachineLearningModelNew)
 
@@ -112,6 +117,12 @@ otb_add_test(NAME leTvKNearestNeighborsMachineLearningModel COMMAND otbSupervise
   ${TEMP}/knn_model.txt
   )
 
+otb_add_test(NAME leTvKNearestNeighborsMachineLearningModelKdTree COMMAND otbSupervisedTestDriver
+  otbKNearestNeighborsMachineLearningModelKdTree
+  ${INPUTDATA}/letter.scale
+  ${TEMP}/knn_kdtree_model.txt
+  )
+
 otb_add_test(NAME leTvDecisionTreeMachineLearningModel COMMAND otbSupervisedTestDriver
   otbDecisionTreeMachineLearningModel
   ${INPUTDATA}/letter.scale
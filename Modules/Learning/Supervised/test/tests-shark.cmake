@@ -38,6 +38,11 @@ otb_add_test(NAME leTvSharkRFMachineLearningModelCanReadFail COMMAND otbSupervis
   )
 set_property(TEST leTvSharkRFMachineLearningModelCanReadFail PROPERTY WILL_FAIL true)
 
+otb_add_test(NAME leTvSharkRFFlatForestPrediction COMMAND otbSupervisedTestDriver
+  otbSharkRFFlatForestPrediction
+  5000 50
+  )
+
 
 otb_add_test(NAME leTvImageClassificationFilterSharkFast COMMAND  otbSupervisedTestDriver
   --compare-n-images ${NOTOL} 2
@@ -80,3 +85,7 @@ otb_add_test(NAME leTvImageClassificationFilterSharkFastMask COMMAND  otbSupervi
   ${INPUTDATA}/Classification/QB_1_ortho_mask.tif
   )
 
+otb_add_test(NAME leTvImageClassificationFilterSharkBatchMatrix COMMAND  otbSupervisedTestDriver
+  otbSharkImageClassificationFilterBatchMatrix
+  ${TEMP}/leSharkImageClassificationFilterBatchMatrixModel.txt
+  )
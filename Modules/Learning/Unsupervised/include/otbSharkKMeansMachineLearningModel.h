@@ -80,6 +80,7 @@ public:
   typedef typename Superclass::ConfidenceValueType        ConfidenceValueType;
   typedef typename Superclass::ConfidenceSampleType       ConfidenceSampleType;
   typedef typename Superclass::ConfidenceListSampleType   ConfidenceListSampleType;
+  typedef typename Superclass::InputSampleMatrixType      InputSampleMatrixType;
 
 
   typedef shark::HardClusteringModel<shark::RealVector>   ClusteringModelType;
@@ -121,6 +122,10 @@ public:
   itkGetMacro( Normalized, bool );
   itkSetMacro( Normalized, bool );
 
+  /** Set the centroids of a model estimated outside of Shark. The
+   *  number of classes is set to the number of centroids. */
+  void SetCentroids(const std::vector<InputSampleType> &centroids);
+
 protected:
   /** Constructor */
   SharkKMeansMachineLearningModel();
@@ -136,6 +141,10 @@ protected:
   virtual void DoPredictBatch(const InputListSampleType *, const unsigned int &startIndex, const unsigned int &size,
                               TargetListSampleType *, ConfidenceListSampleType * = ITK_NULLPTR) const ITK_OVERRIDE;
 
+  /** Predict a range of samples of a strided matrix, masked samples are skipped */
+  virtual void DoPredictMatrix(const InputSampleMatrixType & input, const unsigned long & startIndex, const unsigned long & size,
+                               TargetValueType * targets, ConfidenceValueType * quality = ITK_NULLPTR) const ITK_OVERRIDE;
+
   template<typename DataType>
   DataType NormalizeData(const DataType &data) const;
 
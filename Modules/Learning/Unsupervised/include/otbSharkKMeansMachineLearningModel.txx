@@ -85,6 +85,25 @@ SharkKMeansMachineLearningModel<TInputValue, TOutputValue>
   m_ClusteringModel = boost::make_shared<ClusteringModelType>( &m_Centroids );
 }
 
+template<class TInputValue, class TOutputValue>
+void
+SharkKMeansMachineLearningModel<TInputValue, TOutputValue>
+::SetCentroids(const std::vector<InputSampleType> &centroids)
+{
+  std::vector<shark::RealVector> vector_centroids( centroids.size());
+  for( size_t k = 0; k < centroids.size(); ++k )
+    {
+    vector_centroids[k].resize( centroids[k].Size());
+    for( size_t i = 0; i < centroids[k].Size(); ++i )
+      {
+      vector_centroids[k][i] = centroids[k][i];
+      }
+    }
+  m_Centroids.setCentroids( shark::createDataFromRange( vector_centroids ));
+  m_ClusteringModel = boost::make_shared<ClusteringModelType>( &m_Centroids );
+  m_K = static_cast<unsigned int>(centroids.size());
+}
+
 template<class TInputValue, class TOutputValue>
 template<typename DataType>
 DataType
@@ -106,7 +125,7 @@ SharkKMeansMachineLearningModel<TInputValue, TOutputValue>
   shark::RealVector data( value.Size());
   for( size_t i = 0; i < value.Size(); i++ )
     {
-    data.push_back( value[i] );
+    data[i] = value[i];
     }
 
   // Change quality measurement only if SoftClustering or other clustering method is used.
@@ -181,6 +200,81 @@ SharkKMeansMachineLearningModel<TInputValue, TOutputValue>
     }
 }
 
+template<class TInputValue, class TOutputValue>
+void
+SharkKMeansMachineLearningModel<TInputValue, TOutputValue>
+::DoPredictMatrix(const InputSampleMatrixType & input,
+                  const unsigned long & startIndex,
+                  const unsigned long & size,
+                  TargetValueType * targets,
+                  ConfidenceValueType * quality) const
+{
+  if( startIndex + size > input.GetNumberOfSamples() )
+    {
+    itkExceptionMacro(
+            <<"requested range ["<<startIndex<<", "<<startIndex+size<<"[ partially outside sample matrix range.[0,"<<input.GetNumberOfSamples()<<"[" );
+    }
+
+  // Indices of the samples to predict
+  std::vector<unsigned long> ids;
+  ids.reserve( size );
+  for( unsigned long id = startIndex; id < startIndex + size; ++id )
+    {
+    if( input.IsValid( id ) )
+      {
+      ids.push_back( id );
+      }
+    }
+  if( ids.empty() )
+    {
+    return;
+    }
+
+  // Fill the batch matrices of the dataset row by row, without
+  // intermediate vectors
+  const unsigned int nbFeatures = input.NumberOfFeatures;
+  shark::Data<shark::RealVector> inputSamples( ids.size(), shark::RealVector( nbFeatures ) );
+  std::size_t row = 0;
+  std::size_t batch = 0;
+  for( auto id : ids )
+    {
+    shark::RealMatrix & m = inputSamples.batch( batch );
+    const InputValueType * sample = input.GetSample( id );
+    for( unsigned int feat = 0; feat < nbFeatures; ++feat )
+      {
+      m( row, feat ) = static_cast<double>(sample[feat]);
+      }
+    if( ++row == m.size1() )
+      {
+      row = 0;
+      ++batch;
+      }
+    }
+
+  shark::Data<ClusteringOutputType> clusters;
+  try
+    {
+    clusters = ( *m_ClusteringModel )( inputSamples );
+    }
+  catch( ... )
+    {
+    itkExceptionMacro( "Failed to run clustering classification. "
+                               "The number of features of input samples and the model could differ.");
+    }
+
+  std::size_t i = 0;
+  for( const auto &p : clusters.elements() )
+    {
+    targets[ids[i]] = static_cast<TOutputValue>(p);
+    // Change quality measurement only if SoftClustering or other clustering method is used.
+    if( quality != ITK_NULLPTR )
+      {
+      quality[ids[i]] = static_cast<ConfidenceValueType>(1.);
+      }
+    ++i;
+    }
+}
+
 
 template<class TInputValue, class TOutputValue>
 void
@@ -0,0 +1,352 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef otbStreamingMiniBatchKMeansImageFilter_h
+#define otbStreamingMiniBatchKMeansImageFilter_h
+
+#include "otbPersistentImageFilter.h"
+#include "otbPersistentFilterStreamingDecorator.h"
+#include "otbImage.h"
+#include "itkVariableLengthVector.h"
+#include "itkIntTypes.h"
+#include <vector>
+#include <utility>
+
+namespace otb
+{
+
+/** \class PersistentMiniBatchKMeansImageFilter
+ * \brief Mini-batch K-means clustering of the pixels of a large image, using streaming
+ *
+ * Each streaming pass over the image is either a seeding pass or an
+ * epoch of mini-batch K-means (Sculley, "Web-scale k-means clustering",
+ * 2010):
+ *
+ * - If no centroid is set, the pass draws a uniform random sample of at
+ *   most SeedingSampleSize pixels, and Synthetize() seeds the centroids
+ *   with k-means++ on this sample.
+ * - Otherwise, a fraction SamplingRate of the pixels is drawn. The
+ *   pixels drawn in a streamed region form a mini-batch: they are
+ *   assigned to their nearest centroid by several threads, then each
+ *   centroid moves towards the mean of its samples with a learning rate
+ *   of (number of samples of the batch) / (number of samples seen so
+ *   far).
+ *
+ * Memory is bounded by the seeding sample and the per-thread sums,
+ * whatever the image size. Pixels are drawn with a hash of their index
+ * and of the seed: the samples do not depend on the threading nor on the
+ * streaming layout. The centroids depend on the streaming layout through
+ * the order of the mini-batches.
+ *
+ * Pixels for which the first component of the optional mask is zero are
+ * ignored.
+ *
+ * \sa StreamingMiniBatchKMeansImageFilter
+ * \sa PersistentImageFilter
+ * \ingroup Streamed
+ * \ingroup Multithreaded
+ *
+ * \ingroup OTBUnsupervised
+ */
+template<class TInputImage, class TMaskImage = otb::Image<unsigned char, TInputImage::ImageDimension> >
+class ITK_EXPORT PersistentMiniBatchKMeansImageFilter :
+  public PersistentImageFilter<TInputImage, TInputImage>
+{
+public:
+  /** Standard Self typedef */
+  typedef PersistentMiniBatchKMeansImageFilter            Self;
+  typedef PersistentImageFilter<TInputImage, TInputImage> Superclass;
+  typedef itk::SmartPointer<Self>                         Pointer;
+  typedef itk::SmartPointer<const Self>                   ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Runtime information support. */
+  itkTypeMacro(PersistentMiniBatchKMeansImageFilter, PersistentImageFilter);
+
+  /** Image related typedefs. */
+  typedef TInputImage                             ImageType;
+  typedef typename TInputImage::Pointer           InputImagePointer;
+  typedef typename TInputImage::RegionType        RegionType;
+  typedef typename TInputImage::IndexType         IndexType;
+  typedef typename TInputImage::PixelType         PixelType;
+  typedef typename TInputImage::InternalPixelType InternalPixelType;
+
+  typedef TMaskImage                              MaskImageType;
+  typedef typename TMaskImage::PixelType          MaskPixelType;
+
+  itkStaticConstMacro(InputImageDimension, unsigned int, TInputImage::ImageDimension);
+
+  /** Centroid type */
+  typedef itk::VariableLengthVector<double>       CentroidType;
+
+  /** Smart Pointer type to a DataObject. */
+  typedef typename itk::DataObject::Pointer       DataObjectPointer;
+  typedef itk::ProcessObject::DataObjectPointerArraySizeType DataObjectPointerArraySizeType;
+
+  /** Number of clusters (default is 5) */
+  itkSetMacro(NumberOfClusters, unsigned int);
+  itkGetMacro(NumberOfClusters, unsigned int);
+
+  /** Fraction of the pixels drawn at each epoch (default is 0.1) */
+  itkSetMacro(SamplingRate, double);
+  itkGetMacro(SamplingRate, double);
+
+  /** Maximum number of pixels used for the k-means++ seeding (default is
+   *  10000) */
+  itkSetMacro(SeedingSampleSize, unsigned int);
+  itkGetMacro(SeedingSampleSize, unsigned int);
+
+  /** Seed of the pixel sampling and of the k-means++ seeding (default is 0) */
+  itkSetMacro(Seed, unsigned int);
+  itkGetMacro(Seed, unsigned int);
+
+  /** Set the optional mask image */
+  void SetMaskImage(const MaskImageType * mask);
+
+  /** Get the optional mask image */
+  const MaskImageType * GetMaskImage() const;
+
+  /** Set the initial centroids: the seeding pass is skipped */
+  void SetCentroids(const std::vector<CentroidType> & centroids);
+
+  /** Remove the centroids: the next pass will seed new ones */
+  void ClearCentroids();
+
+  bool HasCentroids() const
+  {
+    return !m_Centroids.empty();
+  }
+
+  /** Current centroids */
+  std::vector<CentroidType> GetCentroids() const;
+
+  /** Number of epochs since the centroids were seeded or set */
+  itkGetConstMacro(NumberOfEpochs, unsigned int);
+
+  /** Largest displacement of a centroid (L2 norm) during the last epoch */
+  itkGetConstMacro(CentroidShift, double);
+
+  /** Mean squared distance of the samples of the last epoch to their
+   *  nearest centroid, before the update of the centroids */
+  itkGetConstMacro(Inertia, double);
+
+  /** Make a DataObject of the correct type to be used as the specified
+   * output.
+   */
+  DataObjectPointer MakeOutput(DataObjectPointerArraySizeType idx) ITK_OVERRIDE;
+  using Superclass::MakeOutput;
+
+  /** Pass the input through unmodified. Do this by Grafting in the
+   *  AllocateOutputs method.
+   */
+  void AllocateOutputs() ITK_OVERRIDE;
+  void GenerateOutputInformation() ITK_OVERRIDE;
+  void Synthetize(void) ITK_OVERRIDE;
+  void Reset(void) ITK_OVERRIDE;
+
+protected:
+  PersistentMiniBatchKMeansImageFilter();
+  ~PersistentMiniBatchKMeansImageFilter() ITK_OVERRIDE {}
+  void PrintSelf(std::ostream& os, itk::Indent indent) const ITK_OVERRIDE;
+
+  /** Multi-thread version GenerateData. */
+  void ThreadedGenerateData(const RegionType& outputRegionForThread, itk::ThreadIdType threadId) ITK_OVERRIDE;
+
+  /** Update the centroids with the mini-batch of the streamed region */
+  void AfterThreadedGenerateData() ITK_OVERRIDE;
+
+private:
+  PersistentMiniBatchKMeansImageFilter(const Self &); //purposely not implemented
+  void operator =(const Self&); //purposely not implemented
+
+  /** Bijective 64 bits hash (splitmix64 finalizer) */
+  static itk::uint64_t Hash(itk::uint64_t x)
+  {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+  }
+
+  /** Index of the nearest centroid and squared distance */
+  unsigned int FindNearestCentroid(const double * sample, double & sqDistance) const;
+
+  /** k-means++ seeding on the seeding sample */
+  void SeedCentroids(const std::vector<double> & samples, unsigned int nbSamples);
+
+  /** Per-thread seeding sample: max-heap of (key, slot) on the smallest
+   *  keys, and the values of each slot */
+  typedef std::pair<itk::uint64_t, unsigned int> SeedKeyType;
+  struct ThreadSeedingSample
+  {
+    std::vector<SeedKeyType> Heap;
+    std::vector<double>      Values;
+  };
+
+  /** Per-thread accumulators of a mini-batch */
+  struct ThreadBatch
+  {
+    std::vector<double>        Sums;
+    std::vector<unsigned long> Counts;
+    double                     SumOfSquaredDistances;
+    unsigned long              NumberOfSamples;
+  };
+
+  unsigned int              m_NumberOfClusters;
+  double                    m_SamplingRate;
+  unsigned int              m_SeedingSampleSize;
+  unsigned int              m_Seed;
+
+  /** Centroids (NumberOfClusters * NumberOfComponents values), number of
+   *  samples assigned to each centroid since the seeding */
+  unsigned int               m_NumberOfComponents;
+  std::vector<double>        m_Centroids;
+  std::vector<double>        m_EpochStartCentroids;
+  std::vector<unsigned long> m_CentroidCounts;
+
+  /** State of the current pass */
+  bool                             m_IsSeedingPass;
+  itk::uint64_t                    m_Salt;
+  std::vector<ThreadSeedingSample> m_ThreadSeedingSamples;
+  std::vector<ThreadBatch>         m_ThreadBatches;
+  double                           m_EpochSumOfSquaredDistances;
+  unsigned long                    m_EpochNumberOfSamples;
+
+  unsigned int              m_NumberOfEpochs;
+  double                    m_CentroidShift;
+  double                    m_Inertia;
+
+}; // end of class PersistentMiniBatchKMeansImageFilter
+
+/**===========================================================================*/
+
+/** \class StreamingMiniBatchKMeansImageFilter
+ * \brief Streaming mini-batch K-means clustering of the pixels of an image
+ *
+ * Update() runs a seeding pass if no centroid is set, then epochs of
+ * PersistentMiniBatchKMeansImageFilter until MaximumNumberOfEpochs is
+ * reached or until no centroid moves by more than ConvergenceThreshold
+ * during an epoch. Each pass streams the whole image.
+ *
+ * \sa PersistentMiniBatchKMeansImageFilter
+ * \sa PersistentFilterStreamingDecorator
+ * \ingroup Streamed
+ * \ingroup Multithreaded
+ *
+ * \ingroup OTBUnsupervised
+ */
+template<class TInputImage, class TMaskImage = otb::Image<unsigned char, TInputImage::ImageDimension> >
+class ITK_EXPORT StreamingMiniBatchKMeansImageFilter :
+  public PersistentFilterStreamingDecorator<PersistentMiniBatchKMeansImageFilter<TInputImage, TMaskImage> >
+{
+public:
+  /** Standard Self typedef */
+  typedef StreamingMiniBatchKMeansImageFilter Self;
+  typedef PersistentFilterStreamingDecorator
+  <PersistentMiniBatchKMeansImageFilter<TInputImage, TMaskImage> > Superclass;
+  typedef itk::SmartPointer<Self>       Pointer;
+  typedef itk::SmartPointer<const Self> ConstPointer;
+
+  /** Type macro */
+  itkNewMacro(Self);
+
+  /** Creation through object factory macro */
+  itkTypeMacro(StreamingMiniBatchKMeansImageFilter, PersistentFilterStreamingDecorator);
+
+  typedef TInputImage                                 InputImageType;
+  typedef TMaskImage                                  MaskImageType;
+  typedef typename Superclass::FilterType             InternalFilterType;
+  typedef typename InternalFilterType::CentroidType   CentroidType;
+
+  using Superclass::SetInput;
+  void SetInput(InputImageType * input)
+  {
+    this->GetFilter()->SetInput(input);
+  }
+  const InputImageType * GetInput()
+  {
+    return this->GetFilter()->GetInput();
+  }
+
+  /** Set the optional mask image */
+  void SetMaskImage(const MaskImageType * mask)
+  {
+    this->GetFilter()->SetMaskImage(mask);
+  }
+
+  /** Maximum number of epochs (default is 10) */
+  itkSetMacro(MaximumNumberOfEpochs, unsigned int);
+  itkGetMacro(MaximumNumberOfEpochs, unsigned int);
+
+  /** Stop when no centroid moves by more than this distance during an
+   *  epoch (default is 0.0001) */
+  itkSetMacro(ConvergenceThreshold, double);
+  itkGetMacro(ConvergenceThreshold, double);
+
+  /** Estimated centroids */
+  std::vector<CentroidType> GetCentroids() const
+  {
+    return this->GetFilter()->GetCentroids();
+  }
+
+protected:
+  /** Constructor */
+  StreamingMiniBatchKMeansImageFilter()
+    : m_MaximumNumberOfEpochs(10),
+      m_ConvergenceThreshold(0.0001)
+  {}
+  /** Destructor */
+  ~StreamingMiniBatchKMeansImageFilter() ITK_OVERRIDE {}
+
+  /** Seeding pass and epochs */
+  void GenerateData(void) ITK_OVERRIDE
+  {
+    InternalFilterType * filter = this->GetFilter();
+    if (!filter->HasCentroids())
+      {
+      Superclass::GenerateData();
+      }
+    for (unsigned int epoch = 0; epoch < m_MaximumNumberOfEpochs; ++epoch)
+      {
+      Superclass::GenerateData();
+      if (filter->GetCentroidShift() <= m_ConvergenceThreshold)
+        {
+        break;
+        }
+      }
+  }
+
+private:
+  StreamingMiniBatchKMeansImageFilter(const Self &); //purposely not implemented
+  void operator =(const Self&); //purposely not implemented
+
+  unsigned int m_MaximumNumberOfEpochs;
+  double       m_ConvergenceThreshold;
+};
+
+} // end namespace otb
+
+#ifndef OTB_MANUAL_INSTANTIATION
+#include "otbStreamingMiniBatchKMeansImageFilter.txx"
+#endif
+
+#endif
@@ -0,0 +1,582 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef otbStreamingMiniBatchKMeansImageFilter_txx
+#define otbStreamingMiniBatchKMeansImageFilter_txx
+#include "otbStreamingMiniBatchKMeansImageFilter.h"
+
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkDefaultConvertPixelTraits.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkProgressReporter.h"
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+namespace otb
+{
+
+template<class TInputImage, class TMaskImage>
+PersistentMiniBatchKMeansImageFilter<TInputImage, TMaskImage>
+::PersistentMiniBatchKMeansImageFilter() :
+  m_NumberOfClusters(5),
+  m_SamplingRate(0.1),
+  m_SeedingSampleSize(10000),
+  m_Seed(0),
+  m_NumberOfComponents(0),
+  m_Centroids(),
+  m_EpochStartCentroids(),
+  m_CentroidCounts(),
+  m_IsSeedingPass(true),
+  m_Salt(0),
+  m_ThreadSeedingSamples(),
+  m_ThreadBatches(),
+  m_EpochSumOfSquaredDistances(0.0),
+  m_EpochNumberOfSamples(0),
+  m_NumberOfEpochs(0),
+  m_CentroidShift(0.0),
+  m_Inertia(0.0)
+{
+  // first output is a copy of the image, DataObject created by
+  // superclass
+  this->SetNumberOfRequiredInputs(1);
+}
+
+template<class TInputImage, class TMaskImage>
+itk::DataObject::Pointer
+PersistentMiniBatchKMeansImageFilter<TInputImage, TMaskImage>
+::MakeOutput(DataObjectPointerArraySizeType itkNotUsed(output))
+{
+  return static_cast<itk::DataObject*>(TInputImage::New().GetPointer());
+}
+
+template<class TInputImage, class TMaskImage>
+void
+PersistentMiniBatchKMeansImageFilter<TInputImage, TMaskImage>
+::SetMaskImage(const MaskImageType * mask)
+{
+  this->itk::ProcessObject::SetNthInput(1, const_cast<MaskImageType *>(mask));
+}
+
+template<class TInputImage, class TMaskImage>
+const typename PersistentMiniBatchKMeansImageFilter<TInputImage, TMaskImage>::MaskImageType *
+PersistentMiniBatchKMeansImageFilter<TInputImage, TMaskImage>
+::GetMaskImage() const
+{
+  if (this->GetNumberOfInputs() < 2)
+    {
+    return ITK_NULLPTR;
+    }
+  return static_cast<const MaskImageType *>(this->itk::ProcessObject::GetInput(1));
+}
+
+template<class TInputImage, class TMaskImage>
+void
+PersistentMiniBatchKMeansImageFilter<TInputImage, TMaskImage>
+::SetCentroids(const std::vector<CentroidType> & centroids)
+{
+  if (centroids.empty())
+    {
+    this->ClearCentroids();
+    return;
+    }
+  m_NumberOfClusters = static_cast<unsigned int>(centroids.size());
+  m_NumberOfComponents = centroids[0].Size();
+  m_Centroids.resize(m_NumberOfClusters * m_NumberOfComponents);
+  for (unsigned int k = 0; k < m_NumberOfClusters; ++k)
+    {
+    if (centroids[k].Size() != m_NumberOfComponents)
+      {
+      itkExceptionMacro(<< "All centroids must have the same number of components");
+      }
+    for (unsigned int j = 0; j < m_NumberOfComponents; ++j)
+      {
+      m_Centroids[k * m_NumberOfComponents + j] = centroids[k][j];
+      }
+    }
+  m_CentroidCounts.assign(m_NumberOfClusters, 0UL);
+  m_NumberOfEpochs = 0;
+  m_CentroidShift = 0.0;
+  m_Inertia = 0.0;
+  this->Modified();
+}
+
+template<class TInputImage, class TMaskImage>
+void
+PersistentMiniBatchKMeansImageFilter<TInputImage, TMaskImage>
+::ClearCentroids()
+{
+  m_Centroids.clear();
+  m_CentroidCounts.clear();
+  m_NumberOfEpochs = 0;
+  m_CentroidShift = 0.0;
+  m_Inertia = 0.0;
+  this->Modified();
+}
+
+template<class TInputImage, class TMaskImage>
+std::vector<typename PersistentMiniBatchKMeansImageFilter<TInputImage, TMaskImage>::CentroidType>
+PersistentMiniBatchKMeansImageFilter<TInputImage, TMaskImage>
+::GetCentroids() const
+{
+  const unsigned int nbCentroids = (m_NumberOfComponents > 0 ?
+    static_cast<unsigned int>(m_Centroids.size() / m_NumberOfComponents) : 0);
+  std::vector<CentroidType> centroids(nbCentroids);
+  for (unsigned int k = 0; k < nbCentroids; ++k)
+    {
+    centroids[k].SetSize(m_NumberOfComponents);
+    for (unsigned int j = 0; j < m_NumberOfComponents; ++j)
+      {
+      centroids[k][j] = m_Centroids[k * m_NumberOfComponents + j];
+      }
+    }
+  return centroids;
+}
+
+template<class TInputImage, class TMaskImage>
+void
+PersistentMiniBatchKMeansImageFilter<TInputImage, TMaskImage>
+::GenerateOutputInformation()
+{
+  Superclass::GenerateOutputInformation();
+  if (this->GetInput())
+    {
+    this->GetOutput()->CopyInformation(this->GetInput());
+    this->GetOutput()->SetLargestPossibleRegion(this->GetInput()->GetLargestPossibleRegion());
+
+    if (this->GetOutput()->GetRequestedRegion().GetNumberOfPixels() == 0)
+      {
+      this->GetOutput()->SetRequestedRegion(this->GetOutput()->GetLargestPossibleRegion());
+      }
+    }
+}
+
+template<class TInputImage, class TMaskImage>
+void
+PersistentMiniBatchKMeansImageFilter<TInputImage, TMaskImage>
+::AllocateOutputs()
+{
+  // This is commented to prevent the streaming of the whole image for the first stream strip
+  // It shall not cause any problem because the output image of this filter is not intended to be used.
+  //InputImagePointer image = const_cast< TInputImage * >( this->GetInput() );
+  //this->GraftOutput( image );
+  // Nothing that needs to be allocated for the remaining outputs
+}
+
+template<class TInputImage, class TMaskImage>
+void
+PersistentMiniBatchKMeansImageFilter<TInputImage, TMaskImage>
+::Reset()
+{
+  TInputImage * inputPtr = const_cast<TInputImage *>(this->GetInput());
+  inputPtr->UpdateOutputInformation();
+
+  const unsigned int numberOfThreads = this->GetNumberOfThreads();
+  const unsigned int numberOfComponent = inputPtr->GetNumberOfComponentsPerPixel();
+
+  if (m_NumberOfClusters == 0)
+    {
+    itkExceptionMacro(<< "Number of clusters must be strictly positive");
+    }
+  if (!(m_SamplingRate > 0.0))
+    {
+    itkExceptionMacro(<< "Sampling rate must be strictly positive");
+    }
+
+  m_IsSeedingPass = !this->HasCentroids();
+  if (!m_IsSeedingPass && numberOfComponent != m_NumberOfComponents)
+    {
+    itkExceptionMacro(<< "Centroids have " << m_NumberOfComponents
+                      << " components, input image has " << numberOfComponent);
+    }
+  m_NumberOfComponents = numberOfComponent;
+
+  // each pass draws different pixels
+  m_Salt = Hash(Hash(static_cast<itk::uint64_t>(m_Seed)) + (m_IsSeedingPass ? 0 : m_NumberOfEpochs + 1));
+
+  m_ThreadSeedingSamples.clear();
+  m_ThreadBatches.clear();
+  if (m_IsSeedingPass)
+    {
+    m_ThreadSeedingSamples.resize(numberOfThreads);
+    }
+  else
+    {
+    ThreadBatch batch;
+    batch.Sums.assign(m_NumberOfClusters * m_NumberOfComponents, 0.0);
+    batch.Counts.assign(m_NumberOfClusters, 0UL);
+    batch.SumOfSquaredDistances = 0.0;
+    batch.NumberOfSamples = 0UL;
+    m_ThreadBatches.assign(numberOfThreads, batch);
+    m_EpochStartCentroids = m_Centroids;
+    }
+  m_EpochSumOfSquaredDistances = 0.0;
+  m_EpochNumberOfSamples = 0UL;
+
+  // the same requested region is streamed at each pass
+  this->Modified();
+}
+
+template<class TInputImage, class TMaskImage>
+unsigned int
+PersistentMiniBatchKMeansImageFilter<TInputImage, TMaskImage>
+::FindNearestCentroid(const double * sample, double & sqDistance) const
+{
+  const unsigned int nbComp = m_NumberOfComponents;
+  const double * centroid = &(m_Centroids[0]);
+  unsigned int best = 0;
+  sqDistance = std::numeric_limits<double>::max();
+  for (unsigned int k = 0; k < m_NumberOfClusters; ++k, centroid += nbComp)
+    {
+    double d = 0.0;
+    for (unsigned int j = 0; j < nbComp; ++j)
+      {
+      const double diff = sample[j] - centroid[j];
+      d += diff * diff;
+      }
+    if (d < sqDistance)
+      {
+      sqDistance = d;
+      best = k;
+      }
+    }
+  return best;
+}
+
+template<class TInputImage, class TMaskImage>
+void
+PersistentMiniBatchKMeansImageFilter<TInputImage, TMaskImage>
+::ThreadedGenerateData(const RegionType& outputRegionForThread, itk::ThreadIdType threadId)
+{
+  typedef itk::DefaultConvertPixelTraits<MaskPixelType> MaskTraitsType;
+
+  const TInputImage * inputPtr = this->GetInput();
+  const MaskImageType * maskPtr = this->GetMaskImage();
+  const unsigned int nbComp = m_NumberOfComponents;
+
+  // support progress methods/callbacks
+  itk::ProgressReporter progress(this, threadId, outputRegionForThread.GetNumberOfPixels());
+
+  // linear index of a pixel in the largest possible region, used to draw
+  // the samples independently of the streaming and threading layout
+  const RegionType largest = inputPtr->GetLargestPossibleRegion();
+  itk::uint64_t strides[InputImageDimension];
+  itk::uint64_t stride = 1;
+  for (unsigned int i = 0; i < InputImageDimension; ++i)
+    {
+    strides[i] = stride;
+    stride *= static_cast<itk::uint64_t>(largest.GetSize()[i]);
+    }
+
+  // a pixel is drawn if its key is below this threshold
+  itk::uint64_t threshold = std::numeric_limits<itk::uint64_t>::max();
+  if (!m_IsSeedingPass && m_SamplingRate < 1.0)
+    {
+    threshold = static_cast<itk::uint64_t>(m_SamplingRate * 18446744073709551616.0);
+    }
+
+  itk::ImageRegionConstIteratorWithIndex<TInputImage> it(inputPtr, outputRegionForThread);
+  itk::ImageRegionConstIterator<MaskImageType> itMask;
+  if (maskPtr)
+    {
+    itMask = itk::ImageRegionConstIterator<MaskImageType>(maskPtr, outputRegionForThread);
+    itMask.GoToBegin();
+    }
+
+  std::vector<double> sample(nbComp);
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it, progress.CompletedPixel())
+    {
+    bool valid = true;
+    if (maskPtr)
+      {
+      valid = (MaskTraitsType::GetNthComponent(0, itMask.Get()) != itk::NumericTraits<typename MaskTraitsType::ComponentType>::Zero);
+      ++itMask;
+      }
+    if (!valid)
+      {
+      continue;
+      }
+
+    const IndexType index = it.GetIndex();
+    itk::uint64_t linearIndex = 0;
+    for (unsigned int i = 0; i < InputImageDimension; ++i)
+      {
+      linearIndex += static_cast<itk::uint64_t>(index[i] - largest.GetIndex()[i]) * strides[i];
+      }
+    const itk::uint64_t key = Hash(linearIndex ^ m_Salt);
+    if (key >= threshold)
+      {
+      continue;
+      }
+
+    const PixelType& pixel = it.Get();
+    for (unsigned int j = 0; j < nbComp; ++j)
+      {
+      sample[j] = static_cast<double>(pixel[j]);
+      }
+
+    if (m_IsSeedingPass)
+      {
+      // keep the samples with the smallest keys: a uniform sample
+      ThreadSeedingSample & seeding = m_ThreadSeedingSamples[threadId];
+      unsigned int slot;
+      if (seeding.Heap.size() < m_SeedingSampleSize)
+        {
+        slot = static_cast<unsigned int>(seeding.Heap.size());
+        seeding.Values.resize((slot + 1) * nbComp);
+        seeding.Heap.push_back(SeedKeyType(key, slot));
+        }
+      else if (key < seeding.Heap.front().first)
+        {
+        std::pop_heap(seeding.Heap.begin(), seeding.Heap.end());
+        slot = seeding.Heap.back().second;
+        seeding.Heap.back().first = key;
+        }
+      else
+        {
+        continue;
+        }
+      std::push_heap(seeding.Heap.begin(), seeding.Heap.end());
+      std::copy(sample.begin(), sample.end(), seeding.Values.begin() + slot * nbComp);
+      }
+    else
+      {
+      ThreadBatch & batch = m_ThreadBatches[threadId];
+      double sqDistance;
+      const unsigned int label = this->FindNearestCentroid(&(sample[0]), sqDistance);
+      double * sums = &(batch.Sums[label * nbComp]);
+      for (unsigned int j = 0; j < nbComp; ++j)
+        {
+        sums[j] += sample[j];
+        }
+      ++batch.Counts[label];
+      batch.SumOfSquaredDistances += sqDistance;
+      ++batch.NumberOfSamples;
+      }
+    }
+}
+
+template<class TInputImage, class TMaskImage>
+void
+PersistentMiniBatchKMeansImageFilter<TInputImage, TMaskImage>
+::AfterThreadedGenerateData()
+{
+  if (m_IsSeedingPass)
+    {
+    return;
+    }
+
+  const unsigned int nbComp = m_NumberOfComponents;
+
+  // merge the thread batches in order
+  ThreadBatch & merged = m_ThreadBatches[0];
+  for (unsigned int t = 1; t < m_ThreadBatches.size(); ++t)
+    {
+    ThreadBatch & batch = m_ThreadBatches[t];
+    for (unsigned int i = 0; i < merged.Sums.size(); ++i)
+      {
+      merged.Sums[i] += batch.Sums[i];
+      }
+    for (unsigned int k = 0; k < m_NumberOfClusters; ++k)
+      {
+      merged.Counts[k] += batch.Counts[k];
+      }
+    merged.SumOfSquaredDistances += batch.SumOfSquaredDistances;
+    merged.NumberOfSamples += batch.NumberOfSamples;
+    }
+
+  // move each centroid towards the mean of its samples of the mini-batch,
+  // with a per-centroid learning rate decreasing as 1/count
+  for (unsigned int k = 0; k < m_NumberOfClusters; ++k)
+    {
+    const unsigned long nk = merged.Counts[k];
+    if (nk == 0)
+      {
+      continue;
+      }
+    m_CentroidCounts[k] += nk;
+    const double eta = static_cast<double>(nk) / static_cast<double>(m_CentroidCounts[k]);
+    double * centroid = &(m_Centroids[k * nbComp]);
+    const double * sums = &(merged.Sums[k * nbComp]);
+    for (unsigned int j = 0; j < nbComp; ++j)
+      {
+      centroid[j] = (1.0 - eta) * centroid[j] + eta * sums[j] / static_cast<double>(nk);
+      }
+    }
+
+  m_EpochSumOfSquaredDistances += merged.SumOfSquaredDistances;
+  m_EpochNumberOfSamples += merged.NumberOfSamples;
+
+  // clear the batches for the next streamed region
+  for (unsigned int t = 0; t < m_ThreadBatches.size(); ++t)
+    {
+    ThreadBatch & batch = m_ThreadBatches[t];
+    std::fill(batch.Sums.begin(), batch.Sums.end(), 0.0);
+    std::fill(batch.Counts.begin(), batch.Counts.end(), 0UL);
+    batch.SumOfSquaredDistances = 0.0;
+    batch.NumberOfSamples = 0UL;
+    }
+}
+
+template<class TInputImage, class TMaskImage>
+void
+PersistentMiniBatchKMeansImageFilter<TInputImage, TMaskImage>
+::Synthetize()
+{
+  const unsigned int nbComp = m_NumberOfComponents;
+
+  if (m_IsSeedingPass)
+    {
+    // merge the thread samples, keeping the smallest keys
+    std::vector<std::pair<itk::uint64_t, std::pair<unsigned int, unsigned int> > > keys;
+    for (unsigned int t = 0; t < m_ThreadSeedingSamples.size(); ++t)
+      {
+      const std::vector<SeedKeyType> & heap = m_ThreadSeedingSamples[t].Heap;
+      for (unsigned int i = 0; i < heap.size(); ++i)
+        {
+        keys.push_back(std::make_pair(heap[i].first, std::make_pair(t, heap[i].second)));
+        }
+      }
+    std::sort(keys.begin(), keys.end());
+    const unsigned int nbSamples = static_cast<unsigned int>(std::min<size_t>(keys.size(), m_SeedingSampleSize));
+
+    std::vector<double> samples(nbSamples * nbComp);
+    for (unsigned int i = 0; i < nbSamples; ++i)
+      {
+      const std::vector<double> & values = m_ThreadSeedingSamples[keys[i].second.first].Values;
+      std::copy(values.begin() + keys[i].second.second * nbComp,
+                values.begin() + (keys[i].second.second + 1) * nbComp,
+                samples.begin() + i * nbComp);
+      }
+    m_ThreadSeedingSamples.clear();
+
+    this->SeedCentroids(samples, nbSamples);
+    return;
+    }
+
+  m_ThreadBatches.clear();
+
+  m_CentroidShift = 0.0;
+  for (unsigned int k = 0; k < m_NumberOfClusters; ++k)
+    {
+    double d = 0.0;
+    for (unsigned int j = 0; j < nbComp; ++j)
+      {
+      const double diff = m_Centroids[k * nbComp + j] - m_EpochStartCentroids[k * nbComp + j];
+      d += diff * diff;
+      }
+    m_CentroidShift = std::max(m_CentroidShift, std::sqrt(d));
+    }
+  m_Inertia = (m_EpochNumberOfSamples > 0 ?
+    m_EpochSumOfSquaredDistances / static_cast<double>(m_EpochNumberOfSamples) : 0.0);
+  ++m_NumberOfEpochs;
+}
+
+template<class TInputImage, class TMaskImage>
+void
+PersistentMiniBatchKMeansImageFilter<TInputImage, TMaskImage>
+::SeedCentroids(const std::vector<double> & samples, unsigned int nbSamples)
+{
+  const unsigned int nbComp = m_NumberOfComponents;
+  if (nbSamples < m_NumberOfClusters)
+    {
+    itkExceptionMacro(<< "Not enough valid pixels (" << nbSamples
+                      << ") to seed " << m_NumberOfClusters << " clusters");
+    }
+
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
+  RandomGeneratorType::Pointer random = RandomGeneratorType::New();
+  random->SetSeed(m_Seed);
+
+  m_Centroids.assign(m_NumberOfClusters * nbComp, 0.0);
+  m_CentroidCounts.assign(m_NumberOfClusters, 0UL);
+  m_NumberOfEpochs = 0;
+  m_CentroidShift = 0.0;
+  m_Inertia = 0.0;
+
+  // k-means++: the first centroid is drawn uniformly, the next ones with
+  // a probability proportional to the squared distance to the nearest
+  // centroid already chosen
+  unsigned int chosen = random->GetIntegerVariate(nbSamples - 1);
+  std::vector<double> sqDistances(nbSamples, std::numeric_limits<double>::max());
+  for (unsigned int k = 0; k < m_NumberOfClusters; ++k)
+    {
+    std::copy(samples.begin() + chosen * nbComp, samples.begin() + (chosen + 1) * nbComp,
+              m_Centroids.begin() + k * nbComp);
+    if (k + 1 == m_NumberOfClusters)
+      {
+      break;
+      }
+
+    const double * centroid = &(m_Centroids[k * nbComp]);
+    double total = 0.0;
+    for (unsigned int i = 0; i < nbSamples; ++i)
+      {
+      const double * sample = &(samples[i * nbComp]);
+      double d = 0.0;
+      for (unsigned int j = 0; j < nbComp; ++j)
+        {
+        const double diff = sample[j] - centroid[j];
+        d += diff * diff;
+        }
+      sqDistances[i] = std::min(sqDistances[i], d);
+      total += sqDistances[i];
+      }
+
+    if (!(total > 0.0))
+      {
+      // all samples are already centroids: take them in order
+      chosen = (chosen + 1) % nbSamples;
+      continue;
+      }
+    const double target = random->GetUniformVariate(0.0, total);
+    double cumulated = 0.0;
+    chosen = nbSamples - 1;
+    for (unsigned int i = 0; i < nbSamples; ++i)
+      {
+      cumulated += sqDistances[i];
+      if (cumulated >= target && sqDistances[i] > 0.0)
+        {
+        chosen = i;
+        break;
+        }
+      }
+    }
+}
+
+template<class TInputImage, class TMaskImage>
+void
+PersistentMiniBatchKMeansImageFilter<TInputImage, TMaskImage>
+::PrintSelf(std::ostream& os, itk::Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "Number of clusters: " << m_NumberOfClusters << std::endl;
+  os << indent << "Sampling rate: " << m_SamplingRate << std::endl;
+  os << indent << "Seeding sample size: " << m_SeedingSampleSize << std::endl;
+  os << indent << "Seed: " << m_Seed << std::endl;
+  os << indent << "Number of epochs: " << m_NumberOfEpochs << std::endl;
+  os << indent << "Centroid shift: " << m_CentroidShift << std::endl;
+  os << indent << "Inertia: " << m_Inertia << std::endl;
+}
+
+} // end namespace otb
+#endif
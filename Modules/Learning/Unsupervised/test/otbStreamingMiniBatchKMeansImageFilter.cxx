@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "otbStreamingMiniBatchKMeansImageFilter.h"
+#include "otbVectorImage.h"
+#include "otbImage.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include <cmath>
+
+typedef otb::VectorImage<float>                                  VectorImageType;
+typedef otb::Image<unsigned char>                                MaskImageType;
+typedef otb::StreamingMiniBatchKMeansImageFilter<VectorImageType> KMeansFilterType;
+typedef KMeansFilterType::CentroidType                           CentroidType;
+
+int otbStreamingMiniBatchKMeansImageFilterNew(int itkNotUsed(argc), char * itkNotUsed(argv) [])
+{
+  KMeansFilterType::Pointer filter = KMeansFilterType::New();
+
+  std::cout << filter << std::endl;
+
+  return EXIT_SUCCESS;
+}
+
+namespace
+{
+// Check that each expected center has an estimated centroid within tolerance
+bool CheckCentroids(const std::vector<CentroidType> & centroids, const double expected[][2],
+                    unsigned int nbCenters, double tolerance)
+{
+  if (centroids.size() != nbCenters)
+    {
+    std::cerr << "Wrong number of centroids : " << centroids.size() << std::endl;
+    return false;
+    }
+  for (unsigned int c = 0; c < nbCenters; ++c)
+    {
+    double best = 1e30;
+    for (unsigned int k = 0; k < centroids.size(); ++k)
+      {
+      const double d0 = centroids[k][0] - expected[c][0];
+      const double d1 = centroids[k][1] - expected[c][1];
+      best = std::min(best, std::sqrt(d0 * d0 + d1 * d1));
+      }
+    if (best > tolerance)
+      {
+      std::cerr << "No centroid found near (" << expected[c][0] << ", " << expected[c][1]
+                << ") : nearest is at " << best << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+}
+
+int otbStreamingMiniBatchKMeansImageFilterTest(int itkNotUsed(argc), char * itkNotUsed(argv) [])
+{
+  // Three clusters of pixels, on vertical bands of the image, with a
+  // deterministic noise of amplitude 1. The right band is masked out.
+  const double centers[4][2] = {{10., 50.}, {50., 10.}, {90., 90.}, {-200., -200.}};
+  const unsigned int nbComp = 2;
+  VectorImageType::SizeType size;
+  size[0] = 120;
+  size[1] = 90;
+  VectorImageType::IndexType idx;
+  idx.Fill(0);
+  VectorImageType::RegionType region;
+  region.SetSize(size);
+  region.SetIndex(idx);
+
+  VectorImageType::Pointer image = VectorImageType::New();
+  image->SetRegions(region);
+  image->SetNumberOfComponentsPerPixel(nbComp);
+  image->Allocate();
+
+  MaskImageType::Pointer mask = MaskImageType::New();
+  mask->SetRegions(region);
+  mask->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<VectorImageType> it(image, region);
+  itk::ImageRegionIteratorWithIndex<MaskImageType> itMask(mask, region);
+  VectorImageType::PixelType pixel(nbComp);
+  for (it.GoToBegin(), itMask.GoToBegin(); !it.IsAtEnd(); ++it, ++itMask)
+    {
+    const unsigned int x = it.GetIndex()[0];
+    const unsigned int y = it.GetIndex()[1];
+    const unsigned int c = x / 30;
+    pixel[0] = centers[c][0] + static_cast<double>((x * 7 + y * 13) % 21) / 10. - 1.;
+    pixel[1] = centers[c][1] + static_cast<double>((x * 11 + y * 5) % 21) / 10. - 1.;
+    it.Set(pixel);
+    itMask.Set(c < 3 ? 1 : 0);
+    }
+
+  KMeansFilterType::Pointer filter = KMeansFilterType::New();
+  filter->SetInput(image);
+  filter->SetMaskImage(mask);
+  filter->GetFilter()->SetNumberOfClusters(3);
+  filter->GetFilter()->SetSamplingRate(0.2);
+  filter->GetFilter()->SetSeedingSampleSize(500);
+  filter->GetFilter()->SetSeed(12);
+  filter->SetMaximumNumberOfEpochs(5);
+  filter->SetConvergenceThreshold(0.);
+  filter->GetStreamer()->SetNumberOfDivisionsStrippedStreaming(7);
+  filter->Update();
+
+  std::vector<CentroidType> centroids = filter->GetCentroids();
+  for (unsigned int k = 0; k < centroids.size(); ++k)
+    {
+    std::cout << "Centroid " << k << " : " << centroids[k] << std::endl;
+    }
+  std::cout << "Epochs " << filter->GetFilter()->GetNumberOfEpochs()
+            << " shift " << filter->GetFilter()->GetCentroidShift()
+            << " inertia " << filter->GetFilter()->GetInertia() << std::endl;
+
+  if (filter->GetFilter()->GetNumberOfEpochs() != 5)
+    {
+    std::cerr << "Wrong number of epochs" << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (!CheckCentroids(centroids, centers, 3, 0.2))
+    {
+    return EXIT_FAILURE;
+    }
+  // the noise variance is 2 * 0.4
+  if (std::abs(filter->GetFilter()->GetInertia() - 0.8) > 0.2)
+    {
+    std::cerr << "Wrong inertia" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Restart from given centroids, without seeding, until convergence
+  std::vector<CentroidType> initial(3, CentroidType(nbComp));
+  initial[0][0] = 0.;   initial[0][1] = 60.;
+  initial[1][0] = 60.;  initial[1][1] = 0.;
+  initial[2][0] = 100.; initial[2][1] = 100.;
+  filter->GetFilter()->SetCentroids(initial);
+  filter->SetMaximumNumberOfEpochs(50);
+  filter->SetConvergenceThreshold(0.01);
+  filter->Update();
+
+  centroids = filter->GetCentroids();
+  std::cout << "Converged after " << filter->GetFilter()->GetNumberOfEpochs() << " epochs" << std::endl;
+  if (filter->GetFilter()->GetNumberOfEpochs() >= 50)
+    {
+    std::cerr << "No convergence" << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (!CheckCentroids(centroids, centers, 3, 0.2))
+    {
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -25,6 +25,8 @@ void RegisterTests()
   REGISTER_TEST(otbContingencyTableCalculatorSetListSamples);
   REGISTER_TEST(otbContingencyTableCalculatorCompute);
   REGISTER_TEST(otbContingencyTableCalculatorComputeWithBaseline);
+  REGISTER_TEST(otbStreamingMiniBatchKMeansImageFilterNew);
+  REGISTER_TEST(otbStreamingMiniBatchKMeansImageFilterTest);
 
 #ifdef OTB_USE_SHARK
   REGISTER_TEST(otbSharkKMeansMachineLearningModelCanRead);
@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef otbConnectedComponentLabelImageFilter_h
+#define otbConnectedComponentLabelImageFilter_h
+
+#include "otbStreamingConnectedComponentImageFilter.h"
+#include "itkImageToImageFilter.h"
+
+namespace otb
+{
+
+/** \class ConnectedComponentLabelImageFilter
+ * \brief Second pass of an exact connected component segmentation of a large image
+ *
+ * This filter produces the label image of the connected components found by
+ * a PersistentConnectedComponentImageFilter, once the whole image has been
+ * streamed through it (see SetLabelling()). Each block of the labelling grid
+ * intersecting the requested region is labelled again, in parallel, and its
+ * local labels are replaced by the global ones. The output is thus the same
+ * whatever the streaming layout, and objects crossing tiles keep a single
+ * label.
+ *
+ * The input image, the connection expression and the mask must be the ones
+ * used for the first pass.
+ *
+ * \sa PersistentConnectedComponentImageFilter
+ * \ingroup Streamed
+ * \ingroup Multithreaded
+ *
+ * \ingroup OTBCCOBIA
+ */
+template<class TInputImage, class TLabelImage, class TMaskImage = otb::Image<unsigned int, TInputImage::ImageDimension> >
+class ITK_EXPORT ConnectedComponentLabelImageFilter :
+  public itk::ImageToImageFilter<TInputImage, TLabelImage>
+{
+public:
+  /** Standard Self typedef */
+  typedef ConnectedComponentLabelImageFilter                Self;
+  typedef itk::ImageToImageFilter<TInputImage, TLabelImage> Superclass;
+  typedef itk::SmartPointer<Self>                           Pointer;
+  typedef itk::SmartPointer<const Self>                     ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Runtime information support. */
+  itkTypeMacro(ConnectedComponentLabelImageFilter, ImageToImageFilter);
+
+  /** Image related typedefs. */
+  typedef TInputImage                             InputImageType;
+  typedef TLabelImage                             LabelImageType;
+  typedef typename TLabelImage::PixelType         LabelPixelType;
+  typedef TMaskImage                              MaskImageType;
+  typedef typename TInputImage::RegionType        RegionType;
+  typedef typename TInputImage::SizeType          SizeType;
+  typedef typename TInputImage::IndexType         IndexType;
+
+  /** First pass typedefs */
+  typedef PersistentConnectedComponentImageFilter<TInputImage, TMaskImage> LabellingFilterType;
+  typedef typename LabellingFilterType::FunctorType                        FunctorType;
+  typedef typename LabellingFilterType::LabelType                          LabelType;
+  typedef typename LabellingFilterType::LabelVectorType                    LabelVectorType;
+
+  /** Set/Get the first pass, after Synthetize() */
+  void SetLabelling(const LabellingFilterType * labelling)
+  {
+    m_Labelling = labelling;
+    this->Modified();
+  }
+  const LabellingFilterType * GetLabelling() const
+  {
+    return m_Labelling;
+  }
+
+  /** Set the optional mask image */
+  void SetMaskImage(const MaskImageType * mask);
+
+  /** Get the optional mask image */
+  const MaskImageType * GetMaskImage() const;
+
+protected:
+  ConnectedComponentLabelImageFilter();
+  ~ConnectedComponentLabelImageFilter() ITK_OVERRIDE {}
+  void PrintSelf(std::ostream& os, itk::Indent indent) const ITK_OVERRIDE;
+
+  void GenerateInputRequestedRegion() ITK_OVERRIDE;
+  void EnlargeOutputRequestedRegion(itk::DataObject *) ITK_OVERRIDE {}
+
+  /** Label the blocks intersecting the requested region, in parallel */
+  void GenerateData() ITK_OVERRIDE;
+
+private:
+  ConnectedComponentLabelImageFilter(const Self &); //purposely not implemented
+  void operator =(const Self&); //purposely not implemented
+
+  /** Structure passed to the threads */
+  struct ThreadStruct
+  {
+    Self *                      Filter;
+    std::vector<unsigned int>   Blocks;
+    std::vector<std::string>    Errors;
+  };
+
+  static ITK_THREAD_RETURN_TYPE ThreaderCallback(void *arg);
+
+  /** Label a block and write its part of the requested region */
+  void ProcessBlock(unsigned int blockId, FunctorType & functor);
+
+  typename LabellingFilterType::ConstPointer m_Labelling;
+
+}; // end of class ConnectedComponentLabelImageFilter
+
+} // end namespace otb
+
+#ifndef OTB_MANUAL_INSTANTIATION
+#include "otbConnectedComponentLabelImageFilter.txx"
+#endif
+
+#endif
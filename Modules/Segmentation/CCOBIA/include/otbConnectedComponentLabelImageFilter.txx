@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef otbConnectedComponentLabelImageFilter_txx
+#define otbConnectedComponentLabelImageFilter_txx
+
+#include "otbConnectedComponentLabelImageFilter.h"
+
+namespace otb
+{
+
+template<class TInputImage, class TLabelImage, class TMaskImage>
+ConnectedComponentLabelImageFilter<TInputImage, TLabelImage, TMaskImage>
+::ConnectedComponentLabelImageFilter()
+{
+  this->SetNumberOfRequiredInputs(1);
+}
+
+template<class TInputImage, class TLabelImage, class TMaskImage>
+void
+ConnectedComponentLabelImageFilter<TInputImage, TLabelImage, TMaskImage>
+::SetMaskImage(const MaskImageType * mask)
+{
+  this->itk::ProcessObject::SetNthInput(1, const_cast<MaskImageType *>(mask));
+}
+
+template<class TInputImage, class TLabelImage, class TMaskImage>
+const typename ConnectedComponentLabelImageFilter<TInputImage, TLabelImage, TMaskImage>::MaskImageType *
+ConnectedComponentLabelImageFilter<TInputImage, TLabelImage, TMaskImage>
+::GetMaskImage() const
+{
+  if (this->GetNumberOfInputs() < 2)
+    {
+    return ITK_NULLPTR;
+    }
+  return static_cast<const MaskImageType *>(this->itk::ProcessObject::GetInput(1));
+}
+
+template<class TInputImage, class TLabelImage, class TMaskImage>
+void
+ConnectedComponentLabelImageFilter<TInputImage, TLabelImage, TMaskImage>
+::GenerateInputRequestedRegion()
+{
+  Superclass::GenerateInputRequestedRegion();
+
+  if (m_Labelling.IsNull())
+    {
+    itkExceptionMacro(<< "The first pass of the labelling is not set");
+    }
+
+  // request the whole blocks intersecting the requested region, with their
+  // borrowed row and column
+  std::vector<unsigned int> blocks;
+  m_Labelling->GetBlocks(this->GetOutput()->GetRequestedRegion(), false, blocks);
+  if (blocks.empty())
+    {
+    return;
+    }
+  RegionType requested = m_Labelling->GetPaddedBlockRegion(blocks.front());
+  const RegionType lastBlock = m_Labelling->GetPaddedBlockRegion(blocks.back());
+  SizeType size;
+  for (unsigned int i = 0; i < 2; ++i)
+    {
+    size[i] = static_cast<unsigned long>(lastBlock.GetIndex()[i] - requested.GetIndex()[i]) + lastBlock.GetSize()[i];
+    }
+  requested.SetSize(size);
+
+  InputImageType * input = const_cast<InputImageType *>(this->GetInput());
+  if (input)
+    {
+    input->SetRequestedRegion(requested);
+    }
+  MaskImageType * mask = const_cast<MaskImageType *>(this->GetMaskImage());
+  if (mask)
+    {
+    mask->SetRequestedRegion(requested);
+    }
+}
+
+template<class TInputImage, class TLabelImage, class TMaskImage>
+void
+ConnectedComponentLabelImageFilter<TInputImage, TLabelImage, TMaskImage>
+::ProcessBlock(unsigned int blockId, FunctorType & functor)
+{
+  const RegionType padded = m_Labelling->GetPaddedBlockRegion(blockId);
+  RegionType core = m_Labelling->GetBlockRegion(blockId);
+  const IndexType blockIndex = core.GetIndex();
+  if (!core.Crop(this->GetOutput()->GetRequestedRegion()))
+    {
+    return;
+    }
+
+  LabelVectorType labels;
+  LabellingFilterType::LabelRegion(this->GetInput(), this->GetMaskImage(), padded, functor, labels);
+
+  LabelImageType * output = this->GetOutput();
+  const unsigned long width = padded.GetSize()[0];
+  IndexType index;
+  for (unsigned long y = 0; y < core.GetSize()[1]; ++y)
+    {
+    index[1] = core.GetIndex()[1] + static_cast<long>(y);
+    const unsigned long row = static_cast<unsigned long>(index[1] - blockIndex[1]);
+    for (unsigned long x = 0; x < core.GetSize()[0]; ++x)
+      {
+      index[0] = core.GetIndex()[0] + static_cast<long>(x);
+      const unsigned long col = static_cast<unsigned long>(index[0] - blockIndex[0]);
+      output->SetPixel(index, static_cast<LabelPixelType>(m_Labelling->GetGlobalLabel(blockId, labels[row * width + col])));
+      }
+    }
+}
+
+template<class TInputImage, class TLabelImage, class TMaskImage>
+ITK_THREAD_RETURN_TYPE
+ConnectedComponentLabelImageFilter<TInputImage, TLabelImage, TMaskImage>
+::ThreaderCallback(void *arg)
+{
+  itk::MultiThreader::ThreadInfoStruct * info = (itk::MultiThreader::ThreadInfoStruct *) arg;
+  ThreadStruct * str = (ThreadStruct *) info->UserData;
+
+  try
+    {
+    // the parser of the functor can't be shared between threads
+    FunctorType functor;
+    functor.SetExpression(str->Filter->GetLabelling()->GetConnectedComponentExpression());
+    for (unsigned int b = info->ThreadID; b < str->Blocks.size(); b += info->NumberOfThreads)
+      {
+      str->Filter->ProcessBlock(str->Blocks[b], functor);
+      }
+    }
+  catch (itk::ExceptionObject & err)
+    {
+    str->Errors[info->ThreadID] = err.GetDescription();
+    }
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template<class TInputImage, class TLabelImage, class TMaskImage>
+void
+ConnectedComponentLabelImageFilter<TInputImage, TLabelImage, TMaskImage>
+::GenerateData()
+{
+  this->AllocateOutputs();
+  this->GetOutput()->FillBuffer(itk::NumericTraits<LabelPixelType>::Zero);
+
+  ThreadStruct str;
+  str.Filter = this;
+  m_Labelling->GetBlocks(this->GetOutput()->GetRequestedRegion(), false, str.Blocks);
+  if (str.Blocks.empty())
+    {
+    return;
+    }
+
+  const unsigned int nbThreads = std::min<unsigned int>(this->GetNumberOfThreads(), str.Blocks.size());
+  str.Errors.assign(nbThreads, std::string());
+
+  itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+  threader->SetNumberOfThreads(nbThreads);
+  threader->SetSingleMethod(ThreaderCallback, &str);
+  threader->SingleMethodExecute();
+
+  for (unsigned int i = 0; i < str.Errors.size(); ++i)
+    {
+    if (!str.Errors[i].empty())
+      {
+      itkExceptionMacro(<< "Connected component labelling failed: " << str.Errors[i]);
+      }
+    }
+}
+
+template<class TInputImage, class TLabelImage, class TMaskImage>
+void
+ConnectedComponentLabelImageFilter<TInputImage, TLabelImage, TMaskImage>
+::PrintSelf(std::ostream& os, itk::Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+  if (m_Labelling.IsNotNull())
+    {
+    os << indent << "Number of objects: " << m_Labelling->GetNumberOfObjects() << std::endl;
+    }
+}
+
+} // end namespace otb
+#endif
@@ -0,0 +1,327 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef otbStreamingConnectedComponentImageFilter_h
+#define otbStreamingConnectedComponentImageFilter_h
+
+#include "otbPersistentImageFilter.h"
+#include "otbPersistentFilterStreamingDecorator.h"
+#include "otbConnectedComponentMuParserFunctor.h"
+#include "otbImage.h"
+#include "itkMultiThreader.h"
+#include <vector>
+
+namespace otb
+{
+
+/** \class PersistentConnectedComponentImageFilter
+ * \brief First pass of an exact connected component segmentation of a large image, using streaming
+ *
+ * The image is divided in a regular grid of blocks (see SetBlockSize()), which
+ * does not depend on the streaming layout. Each block is labelled on its own
+ * with the criterion of a ConnectedComponentMuParserFunctor (4-connectivity),
+ * borrowing one row and one column from its lower and right neighbours. A block
+ * is labelled by the stream which contains its first pixel, and the blocks of a
+ * stream are labelled in parallel. Only the population and the bounding box of
+ * the block components, and the labels of the block borders, are kept.
+ *
+ * In Synthetize(), the components sharing a pixel of a borrowed row or column
+ * are merged with a union-find, which gives the connected components of the
+ * whole image. Objects smaller than MinimumObjectSize are discarded, and the
+ * other ones are numbered from 1 in the order of their first block. Their
+ * population and bounding box are then available, as well as the table giving
+ * the global label of each block component.
+ *
+ * Pixels for which the optional mask is 0 are not labelled (label 0).
+ *
+ * The label image is produced by ConnectedComponentLabelImageFilter, which
+ * labels the blocks again and applies the global label table.
+ *
+ * This filter only handles 2D images.
+ *
+ * \sa ConnectedComponentLabelImageFilter
+ * \sa PersistentImageFilter
+ * \ingroup Streamed
+ * \ingroup Multithreaded
+ *
+ * \ingroup OTBCCOBIA
+ */
+template<class TInputImage, class TMaskImage = otb::Image<unsigned int, TInputImage::ImageDimension> >
+class ITK_EXPORT PersistentConnectedComponentImageFilter :
+  public PersistentImageFilter<TInputImage, TInputImage>
+{
+public:
+  /** Standard Self typedef */
+  typedef PersistentConnectedComponentImageFilter         Self;
+  typedef PersistentImageFilter<TInputImage, TInputImage> Superclass;
+  typedef itk::SmartPointer<Self>                         Pointer;
+  typedef itk::SmartPointer<const Self>                   ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Runtime information support. */
+  itkTypeMacro(PersistentConnectedComponentImageFilter, PersistentImageFilter);
+
+  /** Image related typedefs. */
+  typedef TInputImage                             ImageType;
+  typedef typename TInputImage::RegionType        RegionType;
+  typedef typename TInputImage::SizeType          SizeType;
+  typedef typename TInputImage::IndexType         IndexType;
+  typedef typename TInputImage::PixelType         PixelType;
+
+  typedef TMaskImage                              MaskImageType;
+  typedef typename TMaskImage::PixelType          MaskPixelType;
+
+  itkStaticConstMacro(InputImageDimension, unsigned int, TInputImage::ImageDimension);
+
+  /** Connection criterion */
+  typedef Functor::ConnectedComponentMuParserFunctor<PixelType> FunctorType;
+
+  /** Label typedefs */
+  typedef unsigned int                            LabelType;
+  typedef std::vector<LabelType>                  LabelVectorType;
+  typedef unsigned long                           ObjectSizeType;
+
+  /** Smart Pointer type to a DataObject. */
+  typedef typename itk::DataObject::Pointer       DataObjectPointer;
+  typedef itk::ProcessObject::DataObjectPointerArraySizeType DataObjectPointerArraySizeType;
+
+  /** Set/Get the mathematical expression which connects two pixels */
+  itkSetStringMacro(ConnectedComponentExpression);
+  itkGetStringMacro(ConnectedComponentExpression);
+
+  /** Set/Get the minimum object size (default is 1) */
+  itkSetMacro(MinimumObjectSize, ObjectSizeType);
+  itkGetMacro(MinimumObjectSize, ObjectSizeType);
+
+  /** Set/Get the size of the labelling blocks (default is 256x256) */
+  itkSetMacro(BlockSize, SizeType);
+  itkGetConstReferenceMacro(BlockSize, SizeType);
+
+  /** Set the optional mask image */
+  void SetMaskImage(const MaskImageType * mask);
+
+  /** Get the optional mask image */
+  const MaskImageType * GetMaskImage() const;
+
+  /** Number of objects found. Valid after Synthetize(). */
+  LabelType GetNumberOfObjects() const
+  {
+    return static_cast<LabelType>(m_ObjectSizes.size() - 1);
+  }
+
+  /** Population of an object (labels start at 1). Valid after Synthetize(). */
+  ObjectSizeType GetObjectSize(LabelType label) const;
+
+  /** Bounding box of an object (labels start at 1). Valid after Synthetize(). */
+  RegionType GetObjectRegion(LabelType label) const;
+
+  /** Number of blocks along a dimension */
+  unsigned int GetNumberOfBlocks(unsigned int dim) const
+  {
+    return m_GridSize[dim];
+  }
+
+  /** Region of a block, and the same region with the row and column borrowed
+   *  from its neighbours */
+  RegionType GetBlockRegion(unsigned int blockId) const;
+  RegionType GetPaddedBlockRegion(unsigned int blockId) const;
+
+  /** Blocks intersecting a region. If startingIn is true, only the blocks
+   *  whose first pixel is in the region are returned. */
+  void GetBlocks(const RegionType & region, bool startingIn, std::vector<unsigned int> & blocks) const;
+
+  /** Global label of a component of a block (0 for the background).
+   *  Valid after Synthetize(). */
+  LabelType GetGlobalLabel(unsigned int blockId, LabelType localLabel) const
+  {
+    return localLabel == 0 ? 0 : m_LabelTable[m_BlockOffsets[blockId] + localLabel];
+  }
+
+  /** Label the connected components of a region. Labels start at 1, in the
+   *  order of their first pixel. Returns the number of components. */
+  static LabelType LabelRegion(const ImageType * image, const MaskImageType * mask,
+                               const RegionType & region, FunctorType & functor,
+                               LabelVectorType & labels);
+
+  /** Make a DataObject of the correct type to be used as the specified
+   * output.
+   */
+  DataObjectPointer MakeOutput(DataObjectPointerArraySizeType idx) ITK_OVERRIDE;
+  using Superclass::MakeOutput;
+
+  void AllocateOutputs() ITK_OVERRIDE;
+  void GenerateOutputInformation() ITK_OVERRIDE;
+  void GenerateInputRequestedRegion() ITK_OVERRIDE;
+  void Synthetize(void) ITK_OVERRIDE;
+  void Reset(void) ITK_OVERRIDE;
+
+protected:
+  PersistentConnectedComponentImageFilter();
+  ~PersistentConnectedComponentImageFilter() ITK_OVERRIDE {}
+  void PrintSelf(std::ostream& os, itk::Indent indent) const ITK_OVERRIDE;
+
+  /** Label the blocks starting in the requested region, in parallel */
+  void GenerateData() ITK_OVERRIDE;
+
+private:
+  PersistentConnectedComponentImageFilter(const Self &); //purposely not implemented
+  void operator =(const Self&); //purposely not implemented
+
+  /** What is kept from the labelling of a block */
+  struct BlockStruct
+  {
+    BlockStruct() : Processed(false), NumberOfLabels(0) {}
+    bool                        Processed;
+    LabelType                   NumberOfLabels;
+    /** Population of each component in the block (without the borrowed pixels) */
+    std::vector<ObjectSizeType> Sizes;
+    /** Bounding box of each component: min x, min y, max x, max y */
+    std::vector<long>           Bounds;
+    /** Labels of the borrowed row (with the corner pixel) and column */
+    LabelVectorType             BottomBorder;
+    LabelVectorType             RightBorder;
+    /** Labels of the first row and column of the block */
+    LabelVectorType             TopBorder;
+    LabelVectorType             LeftBorder;
+  };
+
+  /** Structure passed to the threads */
+  struct ThreadStruct
+  {
+    Self *                      Filter;
+    std::vector<unsigned int>   Blocks;
+    std::vector<std::string>    Errors;
+  };
+
+  static ITK_THREAD_RETURN_TYPE ThreaderCallback(void *arg);
+
+  /** Label a block and keep its statistics and borders */
+  void ProcessBlock(unsigned int blockId, FunctorType & functor);
+
+  std::string                 m_ConnectedComponentExpression;
+  ObjectSizeType              m_MinimumObjectSize;
+  SizeType                    m_BlockSize;
+  unsigned int                m_GridSize[2];
+  RegionType                  m_LargestRegion;
+  std::vector<BlockStruct>    m_Blocks;
+  std::vector<LabelType>      m_BlockOffsets;
+  LabelVectorType             m_LabelTable;
+  std::vector<ObjectSizeType> m_ObjectSizes;
+  std::vector<RegionType>     m_ObjectRegions;
+
+}; // end of class PersistentConnectedComponentImageFilter
+
+/**===========================================================================*/
+
+/** \class StreamingConnectedComponentImageFilter
+ * \brief This class streams the whole input image through the PersistentConnectedComponentImageFilter.
+ *
+ * It calls the Reset() method of the PersistentConnectedComponentImageFilter
+ * before streaming the image and the Synthetize() method after having
+ * streamed the image. The internal filter can then be given to a
+ * ConnectedComponentLabelImageFilter to produce the label image.
+ *
+ * \sa PersistentConnectedComponentImageFilter
+ * \sa ConnectedComponentLabelImageFilter
+ * \sa PersistentFilterStreamingDecorator
+ * \ingroup Streamed
+ * \ingroup Multithreaded
+ *
+ * \ingroup OTBCCOBIA
+ */
+template<class TInputImage, class TMaskImage = otb::Image<unsigned int, TInputImage::ImageDimension> >
+class ITK_EXPORT StreamingConnectedComponentImageFilter :
+  public PersistentFilterStreamingDecorator<PersistentConnectedComponentImageFilter<TInputImage, TMaskImage> >
+{
+public:
+  /** Standard Self typedef */
+  typedef StreamingConnectedComponentImageFilter Self;
+  typedef PersistentFilterStreamingDecorator
+  <PersistentConnectedComponentImageFilter<TInputImage, TMaskImage> > Superclass;
+  typedef itk::SmartPointer<Self>       Pointer;
+  typedef itk::SmartPointer<const Self> ConstPointer;
+
+  /** Type macro */
+  itkNewMacro(Self);
+
+  /** Creation through object factory macro */
+  itkTypeMacro(StreamingConnectedComponentImageFilter, PersistentFilterStreamingDecorator);
+
+  typedef TInputImage                                 InputImageType;
+  typedef TMaskImage                                  MaskImageType;
+  typedef typename Superclass::FilterType             InternalFilterType;
+  typedef typename InternalFilterType::LabelType      LabelType;
+  typedef typename InternalFilterType::ObjectSizeType ObjectSizeType;
+  typedef typename InternalFilterType::RegionType     RegionType;
+
+  using Superclass::SetInput;
+  void SetInput(InputImageType * input)
+  {
+    this->GetFilter()->SetInput(input);
+  }
+  const InputImageType * GetInput()
+  {
+    return this->GetFilter()->GetInput();
+  }
+
+  /** Set the optional mask image */
+  void SetMaskImage(const MaskImageType * mask)
+  {
+    this->GetFilter()->SetMaskImage(mask);
+  }
+
+  /** Number of objects found */
+  LabelType GetNumberOfObjects() const
+  {
+    return this->GetFilter()->GetNumberOfObjects();
+  }
+
+  /** Population of an object */
+  ObjectSizeType GetObjectSize(LabelType label) const
+  {
+    return this->GetFilter()->GetObjectSize(label);
+  }
+
+  /** Bounding box of an object */
+  RegionType GetObjectRegion(LabelType label) const
+  {
+    return this->GetFilter()->GetObjectRegion(label);
+  }
+
+protected:
+  /** Constructor */
+  StreamingConnectedComponentImageFilter() {};
+  /** Destructor */
+  ~StreamingConnectedComponentImageFilter() ITK_OVERRIDE {}
+
+private:
+  StreamingConnectedComponentImageFilter(const Self &); //purposely not implemented
+  void operator =(const Self&); //purposely not implemented
+};
+
+} // end namespace otb
+
+#ifndef OTB_MANUAL_INSTANTIATION
+#include "otbStreamingConnectedComponentImageFilter.txx"
+#endif
+
+#endif
@@ -0,0 +1,663 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef otbStreamingConnectedComponentImageFilter_txx
+#define otbStreamingConnectedComponentImageFilter_txx
+
+#include "otbStreamingConnectedComponentImageFilter.h"
+#include "itkNumericTraits.h"
+#include <algorithm>
+
+namespace otb
+{
+
+template<class TInputImage, class TMaskImage>
+PersistentConnectedComponentImageFilter<TInputImage, TMaskImage>
+::PersistentConnectedComponentImageFilter() :
+  m_ConnectedComponentExpression(),
+  m_MinimumObjectSize(1),
+  m_LargestRegion(),
+  m_Blocks(),
+  m_BlockOffsets(),
+  m_LabelTable(1, 0),
+  m_ObjectSizes(1, 0),
+  m_ObjectRegions(1)
+{
+  m_BlockSize.Fill(256);
+  m_GridSize[0] = 0;
+  m_GridSize[1] = 0;
+  this->SetNumberOfRequiredInputs(1);
+}
+
+template<class TInputImage, class TMaskImage>
+itk::DataObject::Pointer
+PersistentConnectedComponentImageFilter<TInputImage, TMaskImage>
+::MakeOutput(DataObjectPointerArraySizeType itkNotUsed(output))
+{
+  return static_cast<itk::DataObject*>(TInputImage::New().GetPointer());
+}
+
+template<class TInputImage, class TMaskImage>
+void
+PersistentConnectedComponentImageFilter<TInputImage, TMaskImage>
+::SetMaskImage(const MaskImageType * mask)
+{
+  this->itk::ProcessObject::SetNthInput(1, const_cast<MaskImageType *>(mask));
+}
+
+template<class TInputImage, class TMaskImage>
+const typename PersistentConnectedComponentImageFilter<TInputImage, TMaskImage>::MaskImageType *
+PersistentConnectedComponentImageFilter<TInputImage, TMaskImage>
+::GetMaskImage() const
+{
+  if (this->GetNumberOfInputs() < 2)
+    {
+    return ITK_NULLPTR;
+    }
+  return static_cast<const MaskImageType *>(this->itk::ProcessObject::GetInput(1));
+}
+
+template<class TInputImage, class TMaskImage>
+typename PersistentConnectedComponentImageFilter<TInputImage, TMaskImage>::ObjectSizeType
+PersistentConnectedComponentImageFilter<TInputImage, TMaskImage>
+::GetObjectSize(LabelType label) const
+{
+  if (label == 0 || label >= m_ObjectSizes.size())
+    {
+    itkExceptionMacro(<< "No object with label " << label
+                      << " (" << this->GetNumberOfObjects() << " objects found)");
+    }
+  return m_ObjectSizes[label];
+}
+
+template<class TInputImage, class TMaskImage>
+typename PersistentConnectedComponentImageFilter<TInputImage, TMaskImage>::RegionType
+PersistentConnectedComponentImageFilter<TInputImage, TMaskImage>
+::GetObjectRegion(LabelType label) const
+{
+  if (label == 0 || label >= m_ObjectRegions.size())
+    {
+    itkExceptionMacro(<< "No object with label " << label
+                      << " (" << this->GetNumberOfObjects() << " objects found)");
+    }
+  return m_ObjectRegions[label];
+}
+
+template<class TInputImage, class TMaskImage>
+typename PersistentConnectedComponentImageFilter<TInputImage, TMaskImage>::RegionType
+PersistentConnectedComponentImageFilter<TInputImage, TMaskImage>
+::GetBlockRegion(unsigned int blockId) const
+{
+  const unsigned int block[2] = {blockId % m_GridSize[0], blockId / m_GridSize[0]};
+  IndexType index;
+  SizeType size;
+  for (unsigned int i = 0; i < 2; ++i)
+    {
+    const long offset = static_cast<long>(block[i] * m_BlockSize[i]);
+    index[i] = m_LargestRegion.GetIndex()[i] + offset;
+    size[i] = std::min(m_BlockSize[i], m_LargestRegion.GetSize()[i] - static_cast<unsigned long>(offset));
+    }
+  RegionType region(index, size);
+  return region;
+}
+
+template<class TInputImage, class TMaskImage>
+typename PersistentConnectedComponentImageFilter<TInputImage, TMaskImage>::RegionType
+PersistentConnectedComponentImageFilter<TInputImage, TMaskImage>
+::GetPaddedBlockRegion(unsigned int blockId) const
+{
+  const unsigned int block[2] = {blockId % m_GridSize[0], blockId / m_GridSize[0]};
+  RegionType region = this->GetBlockRegion(blockId);
+  SizeType size = region.GetSize();
+  for (unsigned int i = 0; i < 2; ++i)
+    {
+    if (block[i] + 1 < m_GridSize[i])
+      {
+      size[i] += 1;
+      }
+    }
+  region.SetSize(size);
+  return region;
+}
+
+template<class TInputImage, class TMaskImage>
+void
+PersistentConnectedComponentImageFilter<TInputImage, TMaskImage>
+::GetBlocks(const RegionType & region, bool startingIn, std::vector<unsigned int> & blocks) const
+{
+  blocks.clear();
+  long first[2];
+  long last[2];
+  for (unsigned int i = 0; i < 2; ++i)
+    {
+    const long start = region.GetIndex()[i] - m_LargestRegion.GetIndex()[i];
+    const long end = start + static_cast<long>(region.GetSize()[i]) - 1;
+    const long blockSize = static_cast<long>(m_BlockSize[i]);
+    if (region.GetSize()[i] == 0 || end < 0)
+      {
+      return;
+      }
+    first[i] = startingIn ? (std::max(start, 0L) + blockSize - 1) / blockSize : std::max(start, 0L) / blockSize;
+    last[i] = std::min(end / blockSize, static_cast<long>(m_GridSize[i]) - 1);
+    }
+  for (long y = first[1]; y <= last[1]; ++y)
+    {
+    for (long x = first[0]; x <= last[0]; ++x)
+      {
+      blocks.push_back(static_cast<unsigned int>(y * m_GridSize[0] + x));
+      }
+    }
+}
+
+template<class TInputImage, class TMaskImage>
+typename PersistentConnectedComponentImageFilter<TInputImage, TMaskImage>::LabelType
+PersistentConnectedComponentImageFilter<TInputImage, TMaskImage>
+::LabelRegion(const ImageType * image, const MaskImageType * mask, const RegionType & region,
+              FunctorType & functor, LabelVectorType & labels)
+{
+  const unsigned long width = region.GetSize()[0];
+  const unsigned long height = region.GetSize()[1];
+  labels.assign(width * height, 0);
+
+  // provisional labels, with the union-find parents. A root is always the
+  // smallest label of its set.
+  LabelVectorType parents(1, 0);
+
+  unsigned long pos = 0;
+  IndexType index;
+  for (unsigned long y = 0; y < height; ++y)
+    {
+    index[1] = region.GetIndex()[1] + static_cast<long>(y);
+    for (unsigned long x = 0; x < width; ++x, ++pos)
+      {
+      index[0] = region.GetIndex()[0] + static_cast<long>(x);
+      if (mask && mask->GetPixel(index) == itk::NumericTraits<MaskPixelType>::Zero)
+        {
+        continue;
+        }
+      const PixelType & pixel = image->GetPixel(index);
+
+      LabelType current = 0;
+      if (x > 0 && labels[pos - 1] != 0)
+        {
+        IndexType left = index;
+        left[0] -= 1;
+        if (functor(pixel, image->GetPixel(left)))
+          {
+          current = labels[pos - 1];
+          }
+        }
+      if (y > 0 && labels[pos - width] != 0)
+        {
+        IndexType up = index;
+        up[1] -= 1;
+        if (functor(pixel, image->GetPixel(up)))
+          {
+          if (current == 0)
+            {
+            current = labels[pos - width];
+            }
+          else
+            {
+            // merge the two sets
+            LabelType root1 = current;
+            while (parents[root1] != root1)
+              {
+              root1 = parents[root1];
+              }
+            LabelType root2 = labels[pos - width];
+            while (parents[root2] != root2)
+              {
+              root2 = parents[root2];
+              }
+            if (root1 < root2)
+              {
+              parents[root2] = root1;
+              }
+            else
+              {
+              parents[root1] = root2;
+              }
+            }
+          }
+        }
+      if (current == 0)
+        {
+        current = static_cast<LabelType>(parents.size());
+        parents.push_back(current);
+        }
+      labels[pos] = current;
+      }
+    }
+
+  // number the sets in the order of their first pixel. Since a root is
+  // smaller than the members of its set, roots are met first.
+  LabelVectorType finalLabels(parents.size(), 0);
+  LabelType nbLabels = 0;
+  for (LabelType label = 1; label < parents.size(); ++label)
+    {
+    if (parents[label] == label)
+      {
+      finalLabels[label] = ++nbLabels;
+      }
+    else
+      {
+      finalLabels[label] = finalLabels[parents[label]];
+      }
+    }
+  for (typename LabelVectorType::iterator it = labels.begin(); it != labels.end(); ++it)
+    {
+    *it = finalLabels[*it];
+    }
+  return nbLabels;
+}
+
+template<class TInputImage, class TMaskImage>
+void
+PersistentConnectedComponentImageFilter<TInputImage, TMaskImage>
+::GenerateOutputInformation()
+{
+  Superclass::GenerateOutputInformation();
+  if (this->GetInput())
+    {
+    this->GetOutput()->CopyInformation(this->GetInput());
+    this->GetOutput()->SetLargestPossibleRegion(this->GetInput()->GetLargestPossibleRegion());
+
+    if (this->GetOutput()->GetRequestedRegion().GetNumberOfPixels() == 0)
+      {
+      this->GetOutput()->SetRequestedRegion(this->GetOutput()->GetLargestPossibleRegion());
+      }
+    }
+}
+
+template<class TInputImage, class TMaskImage>
+void
+PersistentConnectedComponentImageFilter<TInputImage, TMaskImage>
+::GenerateInputRequestedRegion()
+{
+  Superclass::GenerateInputRequestedRegion();
+
+  // request the blocks starting in the requested region, with their
+  // borrowed row and column
+  std::vector<unsigned int> blocks;
+  this->GetBlocks(this->GetOutput()->GetRequestedRegion(), true, blocks);
+  if (blocks.empty())
+    {
+    return;
+    }
+  RegionType requested = this->GetPaddedBlockRegion(blocks.front());
+  const RegionType lastBlock = this->GetPaddedBlockRegion(blocks.back());
+  SizeType size;
+  for (unsigned int i = 0; i < 2; ++i)
+    {
+    size[i] = static_cast<unsigned long>(lastBlock.GetIndex()[i] - requested.GetIndex()[i]) + lastBlock.GetSize()[i];
+    }
+  requested.SetSize(size);
+
+  ImageType * input = const_cast<ImageType *>(this->GetInput());
+  if (input)
+    {
+    input->SetRequestedRegion(requested);
+    }
+  MaskImageType * mask = const_cast<MaskImageType *>(this->GetMaskImage());
+  if (mask)
+    {
+    mask->SetRequestedRegion(requested);
+    }
+}
+
+template<class TInputImage, class TMaskImage>
+void
+PersistentConnectedComponentImageFilter<TInputImage, TMaskImage>
+::AllocateOutputs()
+{
+  // Nothing that needs to be allocated for the outputs : the output is not meant to be used
+}
+
+template<class TInputImage, class TMaskImage>
+void
+PersistentConnectedComponentImageFilter<TInputImage, TMaskImage>
+::Reset()
+{
+  ImageType * inputPtr = const_cast<ImageType *>(this->GetInput());
+  inputPtr->UpdateOutputInformation();
+
+  for (unsigned int i = 0; i < 2; ++i)
+    {
+    if (m_BlockSize[i] == 0)
+      {
+      itkExceptionMacro(<< "Block size must be strictly positive");
+      }
+    }
+
+  m_LargestRegion = inputPtr->GetLargestPossibleRegion();
+  for (unsigned int i = 0; i < 2; ++i)
+    {
+    m_GridSize[i] = static_cast<unsigned int>((m_LargestRegion.GetSize()[i] + m_BlockSize[i] - 1) / m_BlockSize[i]);
+    }
+  m_Blocks.assign(m_GridSize[0] * m_GridSize[1], BlockStruct());
+  m_BlockOffsets.clear();
+  m_LabelTable.assign(1, 0);
+  m_ObjectSizes.assign(1, 0);
+  m_ObjectRegions.assign(1, RegionType());
+}
+
+template<class TInputImage, class TMaskImage>
+void
+PersistentConnectedComponentImageFilter<TInputImage, TMaskImage>
+::ProcessBlock(unsigned int blockId, FunctorType & functor)
+{
+  BlockStruct & block = m_Blocks[blockId];
+  const RegionType core = this->GetBlockRegion(blockId);
+  const RegionType padded = this->GetPaddedBlockRegion(blockId);
+
+  LabelVectorType labels;
+  block.NumberOfLabels = LabelRegion(this->GetInput(), this->GetMaskImage(), padded, functor, labels);
+
+  const unsigned long width = padded.GetSize()[0];
+  const unsigned long coreWidth = core.GetSize()[0];
+  const unsigned long coreHeight = core.GetSize()[1];
+
+  block.Sizes.assign(block.NumberOfLabels, 0);
+  block.Bounds.assign(4 * block.NumberOfLabels, 0);
+  for (unsigned long y = 0; y < coreHeight; ++y)
+    {
+    for (unsigned long x = 0; x < coreWidth; ++x)
+      {
+      const LabelType label = labels[y * width + x];
+      if (label == 0)
+        {
+        continue;
+        }
+      const long posX = core.GetIndex()[0] + static_cast<long>(x);
+      const long posY = core.GetIndex()[1] + static_cast<long>(y);
+      long * bounds = &(block.Bounds[4 * (label - 1)]);
+      if (block.Sizes[label - 1] == 0)
+        {
+        bounds[0] = posX;
+        bounds[1] = posY;
+        bounds[2] = posX;
+        bounds[3] = posY;
+        }
+      else
+        {
+        bounds[0] = std::min(bounds[0], posX);
+        bounds[1] = std::min(bounds[1], posY);
+        bounds[2] = std::max(bounds[2], posX);
+        bounds[3] = std::max(bounds[3], posY);
+        }
+      block.Sizes[label - 1] += 1;
+      }
+    }
+
+  block.TopBorder.assign(labels.begin(), labels.begin() + coreWidth);
+  block.LeftBorder.resize(coreHeight);
+  for (unsigned long y = 0; y < coreHeight; ++y)
+    {
+    block.LeftBorder[y] = labels[y * width];
+    }
+  block.BottomBorder.clear();
+  if (padded.GetSize()[1] > coreHeight)
+    {
+    block.BottomBorder.assign(labels.begin() + coreHeight * width, labels.end());
+    }
+  block.RightBorder.clear();
+  if (width > coreWidth)
+    {
+    block.RightBorder.resize(coreHeight);
+    for (unsigned long y = 0; y < coreHeight; ++y)
+      {
+      block.RightBorder[y] = labels[y * width + coreWidth];
+      }
+    }
+  block.Processed = true;
+}
+
+template<class TInputImage, class TMaskImage>
+ITK_THREAD_RETURN_TYPE
+PersistentConnectedComponentImageFilter<TInputImage, TMaskImage>
+::ThreaderCallback(void *arg)
+{
+  itk::MultiThreader::ThreadInfoStruct * info = (itk::MultiThreader::ThreadInfoStruct *) arg;
+  ThreadStruct * str = (ThreadStruct *) info->UserData;
+
+  try
+    {
+    // the parser of the functor can't be shared between threads
+    FunctorType functor;
+    functor.SetExpression(str->Filter->GetConnectedComponentExpression());
+    for (unsigned int b = info->ThreadID; b < str->Blocks.size(); b += info->NumberOfThreads)
+      {
+      str->Filter->ProcessBlock(str->Blocks[b], functor);
+      }
+    }
+  catch (itk::ExceptionObject & err)
+    {
+    str->Errors[info->ThreadID] = err.GetDescription();
+    }
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template<class TInputImage, class TMaskImage>
+void
+PersistentConnectedComponentImageFilter<TInputImage, TMaskImage>
+::GenerateData()
+{
+  ThreadStruct str;
+  str.Filter = this;
+  this->GetBlocks(this->GetOutput()->GetRequestedRegion(), true, str.Blocks);
+  if (str.Blocks.empty())
+    {
+    return;
+    }
+
+  const unsigned int nbThreads = std::min<unsigned int>(this->GetNumberOfThreads(), str.Blocks.size());
+  str.Errors.assign(nbThreads, std::string());
+
+  itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+  threader->SetNumberOfThreads(nbThreads);
+  threader->SetSingleMethod(ThreaderCallback, &str);
+  threader->SingleMethodExecute();
+
+  for (unsigned int i = 0; i < str.Errors.size(); ++i)
+    {
+    if (!str.Errors[i].empty())
+      {
+      itkExceptionMacro(<< "Connected component labelling failed: " << str.Errors[i]);
+      }
+    }
+}
+
+template<class TInputImage, class TMaskImage>
+void
+PersistentConnectedComponentImageFilter<TInputImage, TMaskImage>
+::Synthetize()
+{
+  const unsigned int nbBlocks = m_Blocks.size();
+
+  // offsets of the block labels in the provisional global labels
+  m_BlockOffsets.assign(nbBlocks, 0);
+  LabelType nbLabels = 0;
+  for (unsigned int b = 0; b < nbBlocks; ++b)
+    {
+    if (!m_Blocks[b].Processed)
+      {
+      itkExceptionMacro(<< "Block " << b << " has not been labelled: the whole image must be streamed");
+      }
+    m_BlockOffsets[b] = nbLabels;
+    nbLabels += m_Blocks[b].NumberOfLabels;
+    }
+
+  // union-find on the provisional labels, a root being the smallest label of its set
+  LabelVectorType parents(nbLabels + 1);
+  for (LabelType label = 0; label <= nbLabels; ++label)
+    {
+    parents[label] = label;
+    }
+
+  for (unsigned int b = 0; b < nbBlocks; ++b)
+    {
+    const BlockStruct & block = m_Blocks[b];
+    const unsigned int x = b % m_GridSize[0];
+    const unsigned int y = b / m_GridSize[0];
+
+    // pairs of labels of a same pixel in two blocks
+    std::vector<std::pair<LabelType, LabelType> > pairs;
+    if (y + 1 < m_GridSize[1])
+      {
+      const unsigned int lower = b + m_GridSize[0];
+      for (unsigned int i = 0; i < m_Blocks[lower].TopBorder.size(); ++i)
+        {
+        pairs.push_back(std::make_pair(block.BottomBorder[i] == 0 ? 0 : m_BlockOffsets[b] + block.BottomBorder[i],
+                                       m_Blocks[lower].TopBorder[i] == 0 ? 0 : m_BlockOffsets[lower] + m_Blocks[lower].TopBorder[i]));
+        }
+      if (x + 1 < m_GridSize[0])
+        {
+        // corner pixel, first pixel of the lower right block
+        const unsigned int corner = lower + 1;
+        pairs.push_back(std::make_pair(block.BottomBorder.back() == 0 ? 0 : m_BlockOffsets[b] + block.BottomBorder.back(),
+                                       m_Blocks[corner].TopBorder[0] == 0 ? 0 : m_BlockOffsets[corner] + m_Blocks[corner].TopBorder[0]));
+        }
+      }
+    if (x + 1 < m_GridSize[0])
+      {
+      const unsigned int right = b + 1;
+      for (unsigned int i = 0; i < m_Blocks[right].LeftBorder.size(); ++i)
+        {
+        pairs.push_back(std::make_pair(block.RightBorder[i] == 0 ? 0 : m_BlockOffsets[b] + block.RightBorder[i],
+                                       m_Blocks[right].LeftBorder[i] == 0 ? 0 : m_BlockOffsets[right] + m_Blocks[right].LeftBorder[i]));
+        }
+      }
+
+    for (unsigned int i = 0; i < pairs.size(); ++i)
+      {
+      if (pairs[i].first == 0 || pairs[i].second == 0)
+        {
+        continue;
+        }
+      LabelType root1 = pairs[i].first;
+      while (parents[root1] != root1)
+        {
+        root1 = parents[root1];
+        }
+      LabelType root2 = pairs[i].second;
+      while (parents[root2] != root2)
+        {
+        root2 = parents[root2];
+        }
+      if (root1 < root2)
+        {
+        parents[root2] = root1;
+        }
+      else if (root2 < root1)
+        {
+        parents[root1] = root2;
+        }
+      }
+    }
+
+  // populations and bounding boxes of the sets, gathered on their roots
+  std::vector<ObjectSizeType> sizes(nbLabels + 1, 0);
+  std::vector<long> bounds(4 * (nbLabels + 1), 0);
+  for (unsigned int b = 0; b < nbBlocks; ++b)
+    {
+    const BlockStruct & block = m_Blocks[b];
+    for (LabelType local = 1; local <= block.NumberOfLabels; ++local)
+      {
+      const ObjectSizeType size = block.Sizes[local - 1];
+      if (size == 0)
+        {
+        continue;
+        }
+      LabelType root = m_BlockOffsets[b] + local;
+      while (parents[root] != root)
+        {
+        root = parents[root];
+        }
+      const long * localBounds = &(block.Bounds[4 * (local - 1)]);
+      long * rootBounds = &(bounds[4 * root]);
+      if (sizes[root] == 0)
+        {
+        std::copy(localBounds, localBounds + 4, rootBounds);
+        }
+      else
+        {
+        rootBounds[0] = std::min(rootBounds[0], localBounds[0]);
+        rootBounds[1] = std::min(rootBounds[1], localBounds[1]);
+        rootBounds[2] = std::max(rootBounds[2], localBounds[2]);
+        rootBounds[3] = std::max(rootBounds[3], localBounds[3]);
+        }
+      sizes[root] += size;
+      }
+    }
+
+  // number the objects large enough, in the order of their first block
+  m_LabelTable.assign(nbLabels + 1, 0);
+  m_ObjectSizes.assign(1, 0);
+  m_ObjectRegions.assign(1, RegionType());
+  for (LabelType label = 1; label <= nbLabels; ++label)
+    {
+    if (parents[label] != label)
+      {
+      // the root is smaller, thus already numbered
+      m_LabelTable[label] = m_LabelTable[parents[label]];
+      continue;
+      }
+    if (sizes[label] == 0 || sizes[label] < m_MinimumObjectSize)
+      {
+      continue;
+      }
+    m_LabelTable[label] = static_cast<LabelType>(m_ObjectSizes.size());
+    m_ObjectSizes.push_back(sizes[label]);
+
+    IndexType index;
+    SizeType size;
+    for (unsigned int i = 0; i < 2; ++i)
+      {
+      index[i] = bounds[4 * label + i];
+      size[i] = static_cast<unsigned long>(bounds[4 * label + 2 + i] - bounds[4 * label + i] + 1);
+      }
+    RegionType region(index, size);
+    m_ObjectRegions.push_back(region);
+    }
+
+  // only the block offsets are needed to label the blocks again
+  for (unsigned int b = 0; b < nbBlocks; ++b)
+    {
+    m_Blocks[b] = BlockStruct();
+    m_Blocks[b].Processed = true;
+    }
+}
+
+template<class TInputImage, class TMaskImage>
+void
+PersistentConnectedComponentImageFilter<TInputImage, TMaskImage>
+::PrintSelf(std::ostream& os, itk::Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "Connected component expression: " << m_ConnectedComponentExpression << std::endl;
+  os << indent << "Minimum object size: " << m_MinimumObjectSize << std::endl;
+  os << indent << "Block size: " << m_BlockSize << std::endl;
+  os << indent << "Number of objects: " << this->GetNumberOfObjects() << std::endl;
+}
+
+} // end namespace otb
+#endif
@@ -54,6 +54,12 @@ namespace otb {
 *  - MinimumObjectSize : minimum object size kept after segmentation
 *  - OBIAExpression : mathematical expression for OBIA filtering
 *
+*  The segmentation of each tile can be replaced by an input label image (see
+*  SetInputLabelImage()), for instance the exact labelling of the whole image
+*  given by ConnectedComponentLabelImageFilter. The mask, connected component
+*  and minimum size parameters are then ignored, and the pieces of an object
+*  crossing several tiles share the same label.
+*
 * \ingroup Streamed
  *
  * \ingroup OTBCCOBIA
@@ -177,6 +183,12 @@ public:
   /* Get compute FeretdDiameter flag for object attributes computing  */
   itkGetMacro(ComputeFeretDiameter, bool);
 
+  /* Set an optional label image, used instead of the segmentation of each tile */
+  void SetInputLabelImage(const LabelImageType * labels);
+
+  /* Get the optional label image */
+  const LabelImageType * GetInputLabelImage() const;
+
 
 protected:
   PersistentConnectedComponentSegmentationOBIAToVectorDataFilter();
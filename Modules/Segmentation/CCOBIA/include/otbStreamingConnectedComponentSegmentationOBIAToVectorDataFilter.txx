@@ -41,6 +41,26 @@ PersistentConnectedComponentSegmentationOBIAToVectorDataFilter<TVImage, TLabelIm
 {
 }
 
+template<class TVImage, class TLabelImage, class TMaskImage, class TOutputVectorData>
+void
+PersistentConnectedComponentSegmentationOBIAToVectorDataFilter<TVImage, TLabelImage, TMaskImage, TOutputVectorData>
+::SetInputLabelImage(const LabelImageType * labels)
+{
+  this->itk::ProcessObject::SetNthInput(1, const_cast<LabelImageType *>(labels));
+}
+
+template<class TVImage, class TLabelImage, class TMaskImage, class TOutputVectorData>
+const typename PersistentConnectedComponentSegmentationOBIAToVectorDataFilter<TVImage, TLabelImage, TMaskImage, TOutputVectorData>::LabelImageType *
+PersistentConnectedComponentSegmentationOBIAToVectorDataFilter<TVImage, TLabelImage, TMaskImage, TOutputVectorData>
+::GetInputLabelImage() const
+{
+  if (this->GetNumberOfInputs() < 2)
+    {
+    return ITK_NULLPTR;
+    }
+  return static_cast<const LabelImageType *>(this->itk::ProcessObject::GetInput(1));
+}
+
 template<class TVImage, class TLabelImage, class TMaskImage, class TOutputVectorData>
 void
 PersistentConnectedComponentSegmentationOBIAToVectorDataFilter<TVImage, TLabelImage, TMaskImage, TOutputVectorData>
@@ -61,37 +81,52 @@ PersistentConnectedComponentSegmentationOBIAToVectorDataFilter<TVImage, TLabelIm
   extract->SetExtractionRegion( this->GetOutput()->GetRequestedRegion() );
   // WARNING: itk::ExtractImageFilter does not copy the MetadataDictionary
 
-  typename MaskImageType::Pointer mask;
-  if (!m_MaskExpression.empty())
+  typename LabelImageType::Pointer labelImage;
+  if (this->GetInputLabelImage())
     {
-    // Compute the mask
-    typename MaskMuParserFilterType::Pointer maskFilter;
-    maskFilter = MaskMuParserFilterType::New();
-    maskFilter->SetInput(extract->GetOutput());
-    maskFilter->SetExpression(m_MaskExpression);
-    maskFilter->Update();
-    mask = maskFilter->GetOutput();
+    // The tile is already labelled
+    typedef itk::ExtractImageFilter<LabelImageType, LabelImageType> ExtractLabelImageFilterType;
+    typename ExtractLabelImageFilterType::Pointer extractLabels = ExtractLabelImageFilterType::New();
+    extractLabels->SetInput( this->GetInputLabelImage() );
+    extractLabels->SetExtractionRegion( this->GetOutput()->GetRequestedRegion() );
+    extractLabels->Update();
+    labelImage = extractLabels->GetOutput();
+    }
+  else
+    {
+    typename MaskImageType::Pointer mask;
+    if (!m_MaskExpression.empty())
+      {
+      // Compute the mask
+      typename MaskMuParserFilterType::Pointer maskFilter;
+      maskFilter = MaskMuParserFilterType::New();
+      maskFilter->SetInput(extract->GetOutput());
+      maskFilter->SetExpression(m_MaskExpression);
+      maskFilter->Update();
+      mask = maskFilter->GetOutput();
+      }
+
+    // Perform connected components segmentation
+    typename ConnectedComponentFilterType::Pointer connected = ConnectedComponentFilterType::New();
+    connected->SetInput(extract->GetOutput());
+
+    if (mask.IsNotNull())
+      connected->SetMaskImage(mask);
+    connected->GetFunctor().SetExpression(m_ConnectedComponentExpression);
+    connected->Update();
+
+    // Relabel connected component output
+    typename RelabelComponentFilterType::Pointer relabel = RelabelComponentFilterType::New();
+    relabel->SetInput(connected->GetOutput());
+    relabel->SetMinimumObjectSize(m_MinimumObjectSize);
+    relabel->Update();
+    labelImage = relabel->GetOutput();
     }
-
-  // Perform connected components segmentation
-  typename ConnectedComponentFilterType::Pointer connected = ConnectedComponentFilterType::New();
-  connected->SetInput(extract->GetOutput());
-
-  if (mask.IsNotNull())
-    connected->SetMaskImage(mask);
-  connected->GetFunctor().SetExpression(m_ConnectedComponentExpression);
-  connected->Update();
-
-  // Relabel connected component output
-  typename RelabelComponentFilterType::Pointer relabel = RelabelComponentFilterType::New();
-  relabel->SetInput(connected->GetOutput());
-  relabel->SetMinimumObjectSize(m_MinimumObjectSize);
-  relabel->Update();
 
   //Attributes computation
   // LabelImage to Label Map transformation
   typename LabelImageToLabelMapFilterType::Pointer labelImageToLabelMap = LabelImageToLabelMapFilterType::New();
-  labelImageToLabelMap->SetInput(relabel->GetOutput());
+  labelImageToLabelMap->SetInput(labelImage);
   labelImageToLabelMap->SetBackgroundValue(0);
   labelImageToLabelMap->Update();
 
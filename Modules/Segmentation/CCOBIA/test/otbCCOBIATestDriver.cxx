@@ -28,4 +28,5 @@ void RegisterTests()
   REGISTER_TEST(otbMeanShiftStreamingConnectedComponentSegmentationOBIAToVectorDataFilter);
   REGISTER_TEST(otbLabelObjectOpeningMuParserFilterNew);
   REGISTER_TEST(otbLabelObjectOpeningMuParserFilterTest);
+  REGISTER_TEST(otbStreamingConnectedComponentImageFilter);
 }
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "otbVectorImage.h"
+#include "otbImage.h"
+#include "otbImageFileReader.h"
+#include "otbStreamingConnectedComponentImageFilter.h"
+#include "otbConnectedComponentLabelImageFilter.h"
+#include "itkConnectedComponentFunctorImageFilter.h"
+#include "itkRelabelComponentImageFilter.h"
+#include "itkStreamingImageFilter.h"
+#include "itkImageRegionConstIterator.h"
+#include <map>
+
+int otbStreamingConnectedComponentImageFilter(int itkNotUsed(argc), char * argv[])
+{
+  const char * inputFilename = argv[1];
+  const char * expression = argv[2];
+  const unsigned int blockSize = atoi(argv[3]);
+  const unsigned int nbStreams = atoi(argv[4]);
+  const unsigned int minSize = atoi(argv[5]);
+
+  typedef float InputPixelType;
+  const unsigned int Dimension = 2;
+
+  typedef otb::VectorImage<InputPixelType, Dimension>       InputVectorImageType;
+  typedef otb::Image<unsigned int, Dimension>               LabelImageType;
+  typedef otb::ImageFileReader<InputVectorImageType>        ReaderType;
+
+  typedef otb::StreamingConnectedComponentImageFilter<InputVectorImageType, LabelImageType> LabellingFilterType;
+  typedef otb::ConnectedComponentLabelImageFilter<InputVectorImageType, LabelImageType, LabelImageType> LabelFilterType;
+  typedef itk::StreamingImageFilter<LabelImageType, LabelImageType> StreamingFilterType;
+
+  typedef otb::Functor::ConnectedComponentMuParserFunctor<InputVectorImageType::PixelType> FunctorType;
+  typedef itk::ConnectedComponentFunctorImageFilter<InputVectorImageType, LabelImageType, FunctorType, LabelImageType> ReferenceFilterType;
+  typedef itk::RelabelComponentImageFilter<LabelImageType, LabelImageType> RelabelFilterType;
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName(inputFilename);
+  reader->UpdateOutputInformation();
+
+  // Exact streamed labelling
+  LabellingFilterType::Pointer labelling = LabellingFilterType::New();
+  labelling->SetInput(reader->GetOutput());
+  labelling->GetFilter()->SetConnectedComponentExpression(expression);
+  labelling->GetFilter()->SetMinimumObjectSize(minSize);
+  LabellingFilterType::InternalFilterType::SizeType size;
+  size.Fill(blockSize);
+  labelling->GetFilter()->SetBlockSize(size);
+  labelling->GetStreamer()->SetNumberOfDivisionsStrippedStreaming(nbStreams);
+  labelling->Update();
+
+  LabelFilterType::Pointer labelFilter = LabelFilterType::New();
+  labelFilter->SetInput(reader->GetOutput());
+  labelFilter->SetLabelling(labelling->GetFilter());
+
+  StreamingFilterType::Pointer streaming = StreamingFilterType::New();
+  streaming->SetInput(labelFilter->GetOutput());
+  streaming->SetNumberOfStreamDivisions(nbStreams);
+  streaming->Update();
+
+  // Labelling of the whole image at once
+  ReferenceFilterType::Pointer reference = ReferenceFilterType::New();
+  reference->SetInput(reader->GetOutput());
+  reference->GetFunctor().SetExpression(expression);
+  RelabelFilterType::Pointer relabel = RelabelFilterType::New();
+  relabel->SetInput(reference->GetOutput());
+  relabel->SetMinimumObjectSize(minSize);
+  relabel->Update();
+
+  if (labelling->GetNumberOfObjects() != relabel->GetNumberOfObjects())
+    {
+    std::cerr << "Wrong number of objects: " << labelling->GetNumberOfObjects()
+              << " instead of " << relabel->GetNumberOfObjects() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Both labellings must define the same partition of the image
+  std::map<unsigned int, unsigned int> toReference;
+  std::map<unsigned int, unsigned int> fromReference;
+  std::map<unsigned int, unsigned long> sizes;
+  itk::ImageRegionConstIterator<LabelImageType> it(streaming->GetOutput(), streaming->GetOutput()->GetLargestPossibleRegion());
+  itk::ImageRegionConstIterator<LabelImageType> itRef(relabel->GetOutput(), relabel->GetOutput()->GetLargestPossibleRegion());
+  for (it.GoToBegin(), itRef.GoToBegin(); !it.IsAtEnd(); ++it, ++itRef)
+    {
+    const unsigned int label = it.Get();
+    const unsigned int refLabel = itRef.Get();
+    if ((label == 0) != (refLabel == 0)
+        || toReference.insert(std::make_pair(label, refLabel)).first->second != refLabel
+        || fromReference.insert(std::make_pair(refLabel, label)).first->second != label)
+      {
+      std::cerr << "Labels differ at " << it.GetIndex() << ": " << label << " and " << refLabel << std::endl;
+      return EXIT_FAILURE;
+      }
+    if (label != 0)
+      {
+      sizes[label] += 1;
+      LabellingFilterType::RegionType region = labelling->GetObjectRegion(label);
+      if (!region.IsInside(it.GetIndex()))
+        {
+        std::cerr << "Pixel " << it.GetIndex() << " is outside of the region of object " << label << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  for (std::map<unsigned int, unsigned long>::const_iterator sit = sizes.begin(); sit != sizes.end(); ++sit)
+    {
+    if (labelling->GetObjectSize(sit->first) != sit->second)
+      {
+      std::cerr << "Wrong size of object " << sit->first << ": " << labelling->GetObjectSize(sit->first)
+                << " instead of " << sit->second << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
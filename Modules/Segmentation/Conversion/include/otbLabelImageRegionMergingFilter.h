@@ -24,8 +24,8 @@
 #include "otbImage.h"
 #include "otbVectorImage.h"
 #include "itkImageToImageFilter.h"
+#include "otbLabelRegionAdjacencyGraph.h"
 
-#include <set>
 
 namespace otb
 {
@@ -87,9 +87,8 @@ public:
   itkStaticConstMacro(ImageDimension, unsigned int, InputLabelImageType::ImageDimension);
 
   /** Typedefs for region adjacency map */
-  typedef InputLabelType      LabelType;
-  typedef std::set<LabelType> AdjacentLabelsContainerType;
-  typedef std::vector<AdjacentLabelsContainerType> RegionAdjacencyMapType;
+  typedef InputLabelType                       LabelType;
+  typedef LabelRegionAdjacencyGraph<LabelType> RegionAdjacencyMapType;
 
 
   /** Setters / Getters */
@@ -24,9 +24,9 @@
 #include "otbImage.h"
 #include "otbVectorImage.h"
 #include "itkImageToImageFilter.h"
+#include "otbLabelRegionAdjacencyGraph.h"
 #include "itkNumericTraits.h"
 
-#include <set>
 
 namespace otb
 {
@@ -88,9 +88,8 @@ public:
   itkStaticConstMacro(ImageDimension, unsigned int, InputLabelImageType::ImageDimension);
 
   /** Typedefs for region adjacency map */
-  typedef InputLabelType      LabelType;
-  typedef std::set<LabelType> AdjacentLabelsContainerType;
-  typedef std::vector<AdjacentLabelsContainerType> RegionAdjacencyMapType;
+  typedef InputLabelType                       LabelType;
+  typedef LabelRegionAdjacencyGraph<LabelType> RegionAdjacencyMapType;
 
   itkSetMacro(MinRegionSize, RealType);
   itkGetConstMacro(MinRegionSize, RealType);
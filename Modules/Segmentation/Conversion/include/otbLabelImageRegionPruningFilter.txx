@@ -198,7 +198,15 @@ LabelImageRegionPruningFilter<TInputLabelImage, TInputSpectralImage, TOutputLabe
     }
 
   RegionAdjacencyMapType regionAdjacencyMap = LabelImageToRegionAdjacencyMap(outputLabelImage);
-  unsigned int regionCount = regionAdjacencyMap.size() - 1;
+  unsigned int regionCount = regionAdjacencyMap.GetMaximumLabel();
+
+  // Composition of the relabelling of each iteration, applied to the output
+  // label image once the pruning is finished
+  std::vector<LabelType> outputLabels(regionCount+1);
+  for(unsigned int i = 0; i < regionCount+1; ++i)
+    {
+    outputLabels[i] = i;
+    }
 
   // Initialize arrays for mode information
   m_CanonicalLabels.clear();
@@ -265,14 +273,14 @@ LabelImageRegionPruningFilter<TInputLabelImage, TInputSpectralImage, TOutputLabe
       const SpectralPixelType & curSpectral = m_Modes[curLabel];
 
       // Iterate over all adjacent regions and check for merge
-      typename AdjacentLabelsContainerType::const_iterator adjIt = regionAdjacencyMap[curLabel].begin();
+      const size_t nbAdjacentLabels = regionAdjacencyMap.GetNumberOfNeighbors(curLabel);
 
       LabelType neighborCandidate=0;
       RealType bestNorm2=itk::NumericTraits< float >::max();
 
-      while (adjIt != regionAdjacencyMap[curLabel].end())
+      for (size_t adjIdx = 0; adjIdx < nbAdjacentLabels; ++adjIdx)
         {
-        LabelType adjLabel = *adjIt;
+        LabelType adjLabel = regionAdjacencyMap.GetNeighbor(curLabel, adjIdx);
         assert(adjLabel <= regionCount);
         const SpectralPixelType & adjSpectral = m_Modes[adjLabel];
         // Check condition to merge regions
@@ -292,7 +300,6 @@ LabelImageRegionPruningFilter<TInputLabelImage, TInputSpectralImage, TOutputLabe
            bestNorm2=norm2;
            neighborCandidate=adjLabel;
           };
-         ++adjIt;
         } // end of loop over adjacent labels
 
         if(neighborCandidate!=0)
@@ -398,17 +405,16 @@ LabelImageRegionPruningFilter<TInputLabelImage, TInputSpectralImage, TOutputLabe
 
     regionCount = label;
 
-    /* reassign labels in label image */
-    outputIt.GoToBegin();
-    while(!outputIt.IsAtEnd())
+    /* relabel the regions */
+    std::vector<LabelType> labelMap(oldRegionCount+1);
+    for(unsigned int i = 0; i < oldRegionCount+1; ++i)
       {
-
-      LabelType l = outputIt.Get();
-      LabelType canLabel;
-      itkAssertOrThrowMacro(m_CanonicalLabels[l] <= oldRegionCount,"Found a label greater than region count")
-      canLabel = newLabels[m_CanonicalLabels[l]];
-      outputIt.Set( canLabel );
-      ++outputIt;
+      itkAssertOrThrowMacro(m_CanonicalLabels[i] <= oldRegionCount,"Found a label greater than region count")
+      labelMap[i] = newLabels[m_CanonicalLabels[i]];
+      }
+    for(unsigned int i = 0; i < outputLabels.size(); ++i)
+      {
+      outputLabels[i] = labelMap[outputLabels[i]];
       }
 
 
@@ -419,7 +425,7 @@ LabelImageRegionPruningFilter<TInputLabelImage, TInputSpectralImage, TOutputLabe
     if(!finishedPruning)
       {
       /* Update adjacency table */
-      regionAdjacencyMap = LabelImageToRegionAdjacencyMap(outputLabelImage);
+      regionAdjacencyMap.Contract(labelMap, regionCount);
       }
 
     pruneIterations++;
@@ -429,6 +435,14 @@ LabelImageRegionPruningFilter<TInputLabelImage, TInputSpectralImage, TOutputLabe
   // std::cout << "merge iterations: " << mergeIterations << std::endl;
   // std::cout << "number of label objects: " << regionCount << std::endl;
 
+  /* reassign labels in label image */
+  outputIt.GoToBegin();
+  while(!outputIt.IsAtEnd())
+    {
+    outputIt.Set( outputLabels[outputIt.Get()] );
+    ++outputIt;
+    }
+
   // Generate clustered output
   itk::ImageRegionIterator<OutputClusteredImageType> outputClusteredIt(outputClusteredImage, outputClusteredImage->GetRequestedRegion() );
   outputClusteredIt.GoToBegin();
@@ -458,9 +472,6 @@ typename LabelImageRegionPruningFilter<TInputLabelImage, TInputSpectralImage, TO
 LabelImageRegionPruningFilter<TInputLabelImage, TInputSpectralImage, TOutputLabelImage, TOutputClusteredImage>
 ::LabelImageToRegionAdjacencyMap(typename OutputLabelImageType::Pointer  labelImage)
 {
-  // declare the output map
-  RegionAdjacencyMapType ram;
-
   // Find the maximum label value
   itk::ImageRegionConstIterator<OutputLabelImageType> it(labelImage, labelImage->GetRequestedRegion());
   it.GoToBegin();
@@ -472,40 +483,19 @@ LabelImageRegionPruningFilter<TInputLabelImage, TInputSpectralImage, TOutputLabe
     ++it;
     }
 
-  // Set the size of the adjacency map
-  ram.resize(maxLabel+1);
-
   // set the image region without bottom and right borders so that bottom and
   // right neighbors always exist
   RegionType regionWithoutBottomRightBorders  = labelImage->GetRequestedRegion();
   SizeType size = regionWithoutBottomRightBorders.GetSize();
   for(unsigned int d = 0; d < ImageDimension; ++d) size[d] -= 1;
   regionWithoutBottomRightBorders.SetSize(size);
-  itk::ImageRegionConstIteratorWithIndex<OutputLabelImageType> inputIt(labelImage, regionWithoutBottomRightBorders);
-
-  inputIt.GoToBegin();
-  while(!inputIt.IsAtEnd())
-    {
-    const InputIndexType & index = inputIt.GetIndex();
-    LabelType label = inputIt.Get();
-
-    // check neighbors
-    for(unsigned int d = 0; d < ImageDimension; ++d)
-      {
-      InputIndexType neighborIndex = index;
-      neighborIndex[d]++;
 
-      LabelType neighborLabel = labelImage->GetPixel(neighborIndex);
+  typename RegionAdjacencyMapType::EdgeListType edges;
+  RegionAdjacencyMapType::CollectEdges(labelImage.GetPointer(), regionWithoutBottomRightBorders, edges, this->GetNumberOfThreads());
 
-      // add adjacency if different labels
-      if(neighborLabel != label)
-        {
-        ram[label].insert(neighborLabel);
-        ram[neighborLabel].insert(label);
-        }
-      }
-    ++inputIt;
-    }
+  // declare the output map
+  RegionAdjacencyMapType ram;
+  ram.Build(maxLabel, edges);
 
   return ram;
 }
@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef otbLabelRegionAdjacencyGraph_h
+#define otbLabelRegionAdjacencyGraph_h
+
+#include "itkMultiThreader.h"
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+namespace otb
+{
+
+/** \class LabelRegionAdjacencyGraph
+ * \brief Compact region adjacency graph of a label image, with union-find
+ * support for region merging
+ *
+ * Nodes are the labels in [0, MaximumLabel]. The adjacency is stored in
+ * compressed rows: the neighbors of all labels are packed in a single array,
+ * sorted by label, and an offset array gives the start of each row. There
+ * is no allocation per label.
+ *
+ * Edges are collected from a label image with CollectEdges(), possibly
+ * tile by tile and with several threads, then the graph is built once with
+ * Build(). Contract() relabels the nodes, which is equivalent to building
+ * the graph again from the relabelled image.
+ *
+ * The graph also holds a union-find structure over the nodes to merge
+ * regions without modifying the adjacency arrays. The root of a region is
+ * always its smallest label. GetRegionNeighbors() returns the roots adjacent
+ * to a region, in increasing order.
+ *
+ * \ingroup OTBConversion
+ */
+template <class TLabel>
+class LabelRegionAdjacencyGraph
+{
+public:
+  typedef LabelRegionAdjacencyGraph       Self;
+  typedef TLabel                          LabelType;
+  typedef std::pair<LabelType, LabelType> EdgeType;
+  typedef std::vector<EdgeType>           EdgeListType;
+  typedef std::vector<LabelType>          LabelListType;
+
+  LabelRegionAdjacencyGraph();
+
+  /** Append to edges the pairs of different labels found between each pixel
+   *  of region and its next neighbor along each dimension. Neighbors are
+   *  read if they are in the buffered region of the image, which can thus be
+   *  one pixel larger than region to catch the adjacencies with the next
+   *  tiles. The region is split along its last dimension if several threads
+   *  are used. */
+  template <class TLabelImage>
+  static void CollectEdges(const TLabelImage * image,
+                           const typename TLabelImage::RegionType & region,
+                           EdgeListType & edges,
+                           unsigned int nbThreads = 1);
+
+  /** Sort and remove duplicated edges. This can be used to reduce the
+   *  memory used by the edges of each tile before building the graph. */
+  static void SortEdges(EdgeListType & edges);
+
+  /** Build the graph of labels in [0, maxLabel] from a list of edges. The
+   *  list is sorted in place. All the regions are reset. */
+  void Build(LabelType maxLabel, EdgeListType & edges);
+
+  /** Relabel the nodes: label l becomes labelMap[l]. Adjacencies between
+   *  labels mapped to the same value are dropped. All the regions are reset. */
+  void Contract(const LabelListType & labelMap, LabelType newMaxLabel);
+
+  /** Largest label of the graph */
+  LabelType GetMaximumLabel() const
+  {
+    return static_cast<LabelType>(m_Offsets.size() - 2);
+  }
+
+  /** Number of labels adjacent to a label */
+  size_t GetNumberOfNeighbors(LabelType label) const
+  {
+    return m_Offsets[label + 1] - m_Offsets[label];
+  }
+
+  /** i-th neighbor of a label, neighbors are sorted */
+  LabelType GetNeighbor(LabelType label, size_t i) const
+  {
+    return m_Neighbors[m_Offsets[label] + i];
+  }
+
+  /** Number of adjacencies in the graph */
+  size_t GetNumberOfEdges() const
+  {
+    return m_Neighbors.size() / 2;
+  }
+
+  /** Make each label a region of its own */
+  void ResetRegions();
+
+  /** Root label of the region containing label */
+  LabelType GetRoot(LabelType label)
+  {
+    while (m_Parents[label] != label)
+      {
+      m_Parents[label] = m_Parents[m_Parents[label]];
+      label = m_Parents[label];
+      }
+    return label;
+  }
+
+  /** Merge the regions of two labels. The new root is the smallest of the
+   *  two roots and is returned. */
+  LabelType MergeRegions(LabelType label1, LabelType label2);
+
+  /** Roots of the regions adjacent to the region of root, sorted */
+  void GetRegionNeighbors(LabelType root, LabelListType & neighbors);
+
+private:
+  /** Data shared by the threads collecting edges */
+  template <class TLabelImage>
+  struct CollectEdgesStruct
+  {
+    const TLabelImage *                               Image;
+    std::vector<typename TLabelImage::RegionType>     Regions;
+    std::vector<EdgeListType>                         Edges;
+  };
+
+  template <class TLabelImage>
+  static void CollectRegionEdges(const TLabelImage * image,
+                                 const typename TLabelImage::RegionType & region,
+                                 EdgeListType & edges);
+
+  template <class TLabelImage>
+  static ITK_THREAD_RETURN_TYPE CollectEdgesThreaderCallback(void * arg);
+
+  /** Start of the neighbors of each label, with a last sentinel */
+  std::vector<size_t> m_Offsets;
+  /** Packed neighbors */
+  LabelListType       m_Neighbors;
+  /** Union-find parents */
+  LabelListType       m_Parents;
+  /** Circular lists of the labels of each region */
+  LabelListType       m_NextMembers;
+};
+
+} // end namespace otb
+
+#ifndef OTB_MANUAL_INSTANTIATION
+#include "otbLabelRegionAdjacencyGraph.txx"
+#endif
+
+#endif
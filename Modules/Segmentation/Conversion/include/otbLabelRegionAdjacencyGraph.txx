@@ -0,0 +1,296 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef otbLabelRegionAdjacencyGraph_txx
+#define otbLabelRegionAdjacencyGraph_txx
+
+#include "otbLabelRegionAdjacencyGraph.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkMacro.h"
+#include <algorithm>
+
+namespace otb
+{
+
+template <class TLabel>
+LabelRegionAdjacencyGraph<TLabel>
+::LabelRegionAdjacencyGraph()
+  : m_Offsets(2, 0),
+    m_Neighbors(),
+    m_Parents(1, LabelType()),
+    m_NextMembers(1, LabelType())
+{
+}
+
+template <class TLabel>
+template <class TLabelImage>
+void
+LabelRegionAdjacencyGraph<TLabel>
+::CollectRegionEdges(const TLabelImage * image,
+                     const typename TLabelImage::RegionType & region,
+                     EdgeListType & edges)
+{
+  typedef typename TLabelImage::IndexType IndexType;
+  const unsigned int dimension = TLabelImage::ImageDimension;
+  const typename TLabelImage::RegionType & bufferedRegion = image->GetBufferedRegion();
+
+  // keep the last edge found along each dimension, to skip the repetitions
+  // along the region boundaries
+  std::vector<EdgeType> lastEdges(dimension, EdgeType(LabelType(), LabelType()));
+  std::vector<bool>     hasLastEdge(dimension, false);
+
+  itk::ImageRegionConstIteratorWithIndex<TLabelImage> it(image, region);
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+    {
+    const IndexType & index = it.GetIndex();
+    const LabelType label = static_cast<LabelType>(it.Get());
+
+    for (unsigned int d = 0; d < dimension; ++d)
+      {
+      IndexType neighborIndex = index;
+      neighborIndex[d]++;
+      if (!bufferedRegion.IsInside(neighborIndex))
+        {
+        continue;
+        }
+      const LabelType neighborLabel = static_cast<LabelType>(image->GetPixel(neighborIndex));
+      if (neighborLabel != label)
+        {
+        const EdgeType edge = (label < neighborLabel) ? EdgeType(label, neighborLabel)
+                                                      : EdgeType(neighborLabel, label);
+        if (!hasLastEdge[d] || lastEdges[d] != edge)
+          {
+          edges.push_back(edge);
+          lastEdges[d] = edge;
+          hasLastEdge[d] = true;
+          }
+        }
+      }
+    }
+}
+
+template <class TLabel>
+template <class TLabelImage>
+ITK_THREAD_RETURN_TYPE
+LabelRegionAdjacencyGraph<TLabel>
+::CollectEdgesThreaderCallback(void * arg)
+{
+  itk::MultiThreader::ThreadInfoStruct * info = static_cast<itk::MultiThreader::ThreadInfoStruct *>(arg);
+  CollectEdgesStruct<TLabelImage> * str = static_cast<CollectEdgesStruct<TLabelImage> *>(info->UserData);
+  const unsigned int threadId = info->ThreadID;
+  const unsigned int nbThreads = info->NumberOfThreads;
+
+  for (unsigned int i = threadId; i < str->Regions.size(); i += nbThreads)
+    {
+    CollectRegionEdges(str->Image, str->Regions[i], str->Edges[i]);
+    SortEdges(str->Edges[i]);
+    }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template <class TLabel>
+template <class TLabelImage>
+void
+LabelRegionAdjacencyGraph<TLabel>
+::CollectEdges(const TLabelImage * image,
+               const typename TLabelImage::RegionType & region,
+               EdgeListType & edges,
+               unsigned int nbThreads)
+{
+  typedef typename TLabelImage::RegionType RegionType;
+  const unsigned int lastDim = TLabelImage::ImageDimension - 1;
+  const unsigned long nbLines = region.GetSize()[lastDim];
+
+  if (nbThreads <= 1 || nbLines < 2)
+    {
+    CollectRegionEdges(image, region, edges);
+    return;
+    }
+
+  // split the region along its last dimension, edges with the next slab are
+  // collected by the first slab since neighbors are read in the whole buffer
+  CollectEdgesStruct<TLabelImage> str;
+  str.Image = image;
+  const unsigned long nbSlabs = std::min<unsigned long>(nbThreads, nbLines);
+  for (unsigned long i = 0; i < nbSlabs; ++i)
+    {
+    const unsigned long first = (i * nbLines) / nbSlabs;
+    const unsigned long last = ((i + 1) * nbLines) / nbSlabs;
+    typename RegionType::IndexType index = region.GetIndex();
+    typename RegionType::SizeType size = region.GetSize();
+    index[lastDim] += first;
+    size[lastDim] = last - first;
+    str.Regions.push_back(RegionType(index, size));
+    }
+  str.Edges.resize(str.Regions.size());
+
+  itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+  threader->SetNumberOfThreads(static_cast<itk::ThreadIdType>(nbSlabs));
+  threader->SetSingleMethod(CollectEdgesThreaderCallback<TLabelImage>, &str);
+  threader->SingleMethodExecute();
+
+  for (unsigned int i = 0; i < str.Edges.size(); ++i)
+    {
+    edges.insert(edges.end(), str.Edges[i].begin(), str.Edges[i].end());
+    EdgeListType().swap(str.Edges[i]);
+    }
+}
+
+template <class TLabel>
+void
+LabelRegionAdjacencyGraph<TLabel>
+::SortEdges(EdgeListType & edges)
+{
+  std::sort(edges.begin(), edges.end());
+  edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+}
+
+template <class TLabel>
+void
+LabelRegionAdjacencyGraph<TLabel>
+::Build(LabelType maxLabel, EdgeListType & edges)
+{
+  SortEdges(edges);
+
+  const size_t nbNodes = static_cast<size_t>(maxLabel) + 1;
+  m_Offsets.assign(nbNodes + 1, 0);
+  for (typename EdgeListType::const_iterator it = edges.begin(); it != edges.end(); ++it)
+    {
+    if (maxLabel < it->second)
+      {
+      itkGenericExceptionMacro(<< "Label " << it->second << " is greater than the maximum label " << maxLabel);
+      }
+    ++m_Offsets[static_cast<size_t>(it->first) + 1];
+    ++m_Offsets[static_cast<size_t>(it->second) + 1];
+    }
+  for (size_t l = 0; l < nbNodes; ++l)
+    {
+    m_Offsets[l + 1] += m_Offsets[l];
+    }
+
+  // Edges are sorted, so that each row is filled in increasing order: the
+  // smaller neighbors of a label come from the edges where it is the second
+  // label, which are all listed before the edges where it is the first one
+  m_Neighbors.resize(m_Offsets[nbNodes]);
+  std::vector<size_t> cursors(m_Offsets.begin(), m_Offsets.end() - 1);
+  for (typename EdgeListType::const_iterator it = edges.begin(); it != edges.end(); ++it)
+    {
+    m_Neighbors[cursors[it->first]++] = it->second;
+    m_Neighbors[cursors[it->second]++] = it->first;
+    }
+
+  this->ResetRegions();
+}
+
+template <class TLabel>
+void
+LabelRegionAdjacencyGraph<TLabel>
+::Contract(const LabelListType & labelMap, LabelType newMaxLabel)
+{
+  EdgeListType edges;
+  const size_t nbNodes = m_Offsets.size() - 1;
+  for (size_t l = 0; l < nbNodes; ++l)
+    {
+    const LabelType newLabel = labelMap[l];
+    for (size_t i = m_Offsets[l]; i < m_Offsets[l + 1]; ++i)
+      {
+      if (static_cast<size_t>(m_Neighbors[i]) <= l)
+        {
+        continue;
+        }
+      const LabelType newNeighbor = labelMap[m_Neighbors[i]];
+      if (newNeighbor < newLabel)
+        {
+        edges.push_back(EdgeType(newNeighbor, newLabel));
+        }
+      else if (newLabel < newNeighbor)
+        {
+        edges.push_back(EdgeType(newLabel, newNeighbor));
+        }
+      }
+    }
+  this->Build(newMaxLabel, edges);
+}
+
+template <class TLabel>
+void
+LabelRegionAdjacencyGraph<TLabel>
+::ResetRegions()
+{
+  const size_t nbNodes = m_Offsets.size() - 1;
+  m_Parents.resize(nbNodes);
+  m_NextMembers.resize(nbNodes);
+  for (size_t l = 0; l < nbNodes; ++l)
+    {
+    m_Parents[l] = static_cast<LabelType>(l);
+    m_NextMembers[l] = static_cast<LabelType>(l);
+    }
+}
+
+template <class TLabel>
+typename LabelRegionAdjacencyGraph<TLabel>::LabelType
+LabelRegionAdjacencyGraph<TLabel>
+::MergeRegions(LabelType label1, LabelType label2)
+{
+  LabelType root1 = this->GetRoot(label1);
+  LabelType root2 = this->GetRoot(label2);
+  if (root1 == root2)
+    {
+    return root1;
+    }
+  if (root2 < root1)
+    {
+    std::swap(root1, root2);
+    }
+  m_Parents[root2] = root1;
+  // splice the two circular lists of members
+  std::swap(m_NextMembers[root1], m_NextMembers[root2]);
+  return root1;
+}
+
+template <class TLabel>
+void
+LabelRegionAdjacencyGraph<TLabel>
+::GetRegionNeighbors(LabelType root, LabelListType & neighbors)
+{
+  neighbors.clear();
+  LabelType member = root;
+  do
+    {
+    for (size_t i = m_Offsets[member]; i < m_Offsets[member + 1]; ++i)
+      {
+      const LabelType neighborRoot = this->GetRoot(m_Neighbors[i]);
+      if (neighborRoot != root)
+        {
+        neighbors.push_back(neighborRoot);
+        }
+      }
+    member = m_NextMembers[member];
+    }
+  while (member != root);
+
+  std::sort(neighbors.begin(), neighbors.end());
+  neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+}
+
+} // end namespace otb
+
+#endif
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "otbImage.h"
+#include "otbLabelRegionAdjacencyGraph.h"
+
+namespace
+{
+typedef otb::LabelRegionAdjacencyGraph<unsigned int> GraphType;
+
+bool CheckNeighbors(GraphType & graph, unsigned int label, const unsigned int * expected, size_t nbExpected)
+{
+  GraphType::LabelListType neighbors;
+  graph.GetRegionNeighbors(label, neighbors);
+  if (neighbors.size() != nbExpected)
+    {
+    std::cerr << "Region " << label << " has " << neighbors.size() << " neighbors, " << nbExpected << " expected" << std::endl;
+    return false;
+    }
+  for (size_t i = 0; i < nbExpected; ++i)
+    {
+    if (neighbors[i] != expected[i])
+      {
+      std::cerr << "Neighbor " << i << " of region " << label << " is " << neighbors[i] << ", " << expected[i] << " expected" << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+}
+
+int otbLabelRegionAdjacencyGraph(int itkNotUsed(argc), char * itkNotUsed(argv) [])
+{
+  typedef otb::Image<unsigned int, 2> LabelImageType;
+
+  const unsigned int width = 6;
+  const unsigned int height = 4;
+  const unsigned int labels[height][width] = {{1, 1, 2, 2, 3, 3},
+                                              {1, 1, 2, 2, 3, 3},
+                                              {4, 4, 4, 5, 5, 3},
+                                              {4, 4, 4, 5, 5, 6}};
+
+  LabelImageType::RegionType region;
+  LabelImageType::SizeType size;
+  size[0] = width;
+  size[1] = height;
+  region.SetSize(size);
+
+  LabelImageType::Pointer image = LabelImageType::New();
+  image->SetRegions(region);
+  image->Allocate();
+  LabelImageType::IndexType index;
+  for (index[1] = 0; index[1] < static_cast<long>(height); ++index[1])
+    {
+    for (index[0] = 0; index[0] < static_cast<long>(width); ++index[0])
+      {
+      image->SetPixel(index, labels[index[1]][index[0]]);
+      }
+    }
+
+  // Edges collected by several threads must give the same graph
+  GraphType::EdgeListType edges, threadedEdges;
+  GraphType::CollectEdges(image.GetPointer(), region, edges, 1);
+  GraphType::CollectEdges(image.GetPointer(), region, threadedEdges, 3);
+  GraphType::SortEdges(edges);
+  GraphType::SortEdges(threadedEdges);
+  if (edges != threadedEdges)
+    {
+    std::cerr << "Edges collected with 3 threads differ from edges collected with 1 thread" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  GraphType graph;
+  graph.Build(6, edges);
+  if (graph.GetMaximumLabel() != 6 || graph.GetNumberOfEdges() != 9)
+    {
+    std::cerr << "Wrong graph: " << graph.GetNumberOfEdges() << " edges, 9 expected" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const unsigned int neighbors2[] = {1, 3, 4, 5};
+  if (!CheckNeighbors(graph, 2, neighbors2, 4))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // Merging regions: the root is the smallest label
+  if (graph.MergeRegions(5, 2) != 2 || graph.GetRoot(5) != 2)
+    {
+    std::cerr << "Region 5 should be merged into region 2" << std::endl;
+    return EXIT_FAILURE;
+    }
+  const unsigned int neighbors25[] = {1, 3, 4, 6};
+  if (!CheckNeighbors(graph, 2, neighbors25, 4))
+    {
+    return EXIT_FAILURE;
+    }
+
+  graph.MergeRegions(6, 3);
+  const unsigned int neighbors2536[] = {1, 3, 4};
+  if (!CheckNeighbors(graph, 2, neighbors2536, 3))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // Contracting the graph is equivalent to building the graph of the
+  // relabelled image
+  GraphType::LabelListType labelMap(7);
+  for (unsigned int l = 0; l < labelMap.size(); ++l)
+    {
+    labelMap[l] = graph.GetRoot(l);
+    }
+  graph.Contract(labelMap, 4);
+  if (graph.GetNumberOfEdges() != 4 || graph.GetNumberOfNeighbors(2) != 3 || graph.GetNeighbor(2, 2) != 4)
+    {
+    std::cerr << "Wrong contracted graph: " << graph.GetNumberOfEdges() << " edges, 4 expected" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -26,6 +26,7 @@
 #include "itkInPlaceLabelMapFilter.h"
 #include "itkVariableSizeMatrix.h"
 #include "itkVariableLengthVector.h"
+#include "otbHooverOverlapMatrix.h"
 
 namespace otb
 {
@@ -49,6 +50,10 @@ namespace otb
  *    - RM : for missed regions (only for GT)
  *    - RN : for noise regions (only for MS)
  *
+ * The Hoover confusion matrix can be given either as a dense matrix (see SetHooverMatrix()), or as a sparse
+ * matrix (see SetHooverOverlapMatrix()), which is preferred for segmentations with many regions. In both cases,
+ * only the non-empty cells of each row and of each column are visited.
+ *
  * These Hoover scores that are stored in the label maps are computed between 0 (if the region doesn't belong to this kind of instance) and 1.
  *
  * If the user wants to which region labels have been paired, he can set the flag UseExtendedAttributes. The extended attributes contain the
@@ -65,6 +70,7 @@ namespace otb
  * (see Hoover et al., "An experimental comparison of range image segmentation algorithms", IEEE PAMI vol. 18, no. 7, July 1996)
  *
  * \sa HooverMatrixFilter
+ * \sa StreamingHooverMatrixFilter
  *
  * \ingroup OTBMetrics
  */
@@ -106,6 +112,7 @@ public:
   typedef itk::VariableLengthVector<CoefficientType>    CardinalVector;
   typedef std::set<CoefficientType>                     RegionSetType;
   typedef std::vector<LabelObjectType*>                 ObjectVectorType;
+  typedef HooverOverlapMatrix<LabelType>                OverlapMatrixType;
 
   void SetGroundTruthLabelMap(const LabelMapType *gt);
   void SetMachineSegmentationLabelMap(const LabelMapType *ms);
@@ -116,9 +123,27 @@ public:
   LabelMapType* GetOutputGroundTruthLabelMap();
   LabelMapType* GetOutputMachineSegmentationLabelMap();
 
-  itkSetMacro(HooverMatrix, MatrixType);
+  /** Set the dense Hoover confusion matrix */
+  void SetHooverMatrix(const MatrixType & matrix)
+  {
+    m_HooverMatrix = matrix;
+    m_UseOverlapMatrix = false;
+    this->Modified();
+  }
   itkGetMacro(HooverMatrix, MatrixType);
 
+  /** Set the sparse Hoover confusion matrix, used instead of the dense one */
+  void SetHooverOverlapMatrix(const OverlapMatrixType & matrix)
+  {
+    m_OverlapMatrix = matrix;
+    m_UseOverlapMatrix = true;
+    this->Modified();
+  }
+  const OverlapMatrixType & GetHooverOverlapMatrix() const
+  {
+    return m_OverlapMatrix;
+  }
+
   itkSetMacro(Threshold, double);
   itkGetMacro(Threshold, double);
 
@@ -249,6 +274,12 @@ private:
   /** Hoover confusion matrix computed between GT and MS*/
   MatrixType        m_HooverMatrix;
 
+  /** Sparse Hoover confusion matrix, built from the dense one if needed */
+  OverlapMatrixType m_OverlapMatrix;
+
+  /** Flag set if the sparse matrix was given */
+  bool              m_UseOverlapMatrix;
+
   /** List of region sizes in GT */
   CardinalVector    m_CardRegGT;
 
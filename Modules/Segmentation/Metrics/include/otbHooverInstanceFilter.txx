@@ -23,6 +23,7 @@
 
 #include "otbHooverInstanceFilter.h"
 #include "otbMacro.h"
+#include <algorithm>
 
 namespace otb
 {
@@ -30,7 +31,7 @@ namespace otb
 /** Constructor */
 template <class TLabelMap>
 HooverInstanceFilter<TLabelMap>
-::HooverInstanceFilter() : m_NumberOfRegionsGT(0), m_NumberOfRegionsMS(0), m_Threshold(0.8), m_UseExtendedAttributes(false)
+::HooverInstanceFilter() : m_NumberOfRegionsGT(0), m_NumberOfRegionsMS(0), m_UseOverlapMatrix(false), m_Threshold(0.8), m_UseExtendedAttributes(false)
 {
   this->SetNumberOfRequiredInputs(2);
   this->SetNumberOfRequiredOutputs(2);
@@ -174,13 +175,29 @@ void HooverInstanceFilter<TLabelMap>
     itkExceptionMacro("Empty label map");
     }
 
+  // Only the non-empty cells of the matrix are visited
+  if (!m_UseOverlapMatrix)
+    {
+    m_OverlapMatrix.SetDenseMatrix(m_HooverMatrix);
+    }
+
   //Check the matrix size
-  if (m_NumberOfRegionsGT != m_HooverMatrix.Rows() || m_NumberOfRegionsMS != m_HooverMatrix.Cols())
+  if (m_NumberOfRegionsGT != m_OverlapMatrix.GetNumberOfRows() || m_NumberOfRegionsMS != m_OverlapMatrix.GetNumberOfColumns())
     {
-    itkExceptionMacro("The given Hoover confusion matrix ("<<m_HooverMatrix.Rows()<<" x "<<m_HooverMatrix.Cols() <<
+    itkExceptionMacro("The given Hoover confusion matrix ("<<m_OverlapMatrix.GetNumberOfRows()<<" x "<<m_OverlapMatrix.GetNumberOfColumns() <<
                       ") doesn't match with the input label maps ("<<m_NumberOfRegionsGT<<" x "<<m_NumberOfRegionsMS<<")");
     }
 
+  m_LabelsGT = this->GetGroundTruthLabelMap()->GetLabels();
+
+  // Check the labels of a sparse matrix, if any
+  if (!m_OverlapMatrix.GetGroundTruthLabels().empty()
+      && (m_OverlapMatrix.GetGroundTruthLabels() != m_LabelsGT
+          || m_OverlapMatrix.GetMachineSegmentationLabels() != this->GetMachineSegmentationLabelMap()->GetLabels()))
+    {
+    itkExceptionMacro("The labels of the given Hoover confusion matrix don't match with the input label maps");
+    }
+
   //Init cardinalities lists
   m_CardRegGT.SetSize(m_NumberOfRegionsGT);
   m_CardRegGT.Fill(0);
@@ -230,25 +247,15 @@ void HooverInstanceFilter<TLabelMap>
     i++;
     ++iter;
     }
-
-  m_LabelsGT = this->GetGroundTruthLabelMap()->GetLabels();
 }
 
 template <class TLabelMap>
 void HooverInstanceFilter<TLabelMap>
 ::ThreadedProcessLabelObject( LabelObjectType * labelObject )
 {
-  // Find the index corresponding to the current label object in GT
-  unsigned long currentRegionGT = 0;
-  LabelType currentLabelGT = labelObject->GetLabel();
-  for (unsigned long k=0; k<m_NumberOfRegionsGT; k++)
-    {
-    if (currentLabelGT == m_LabelsGT[k])
-      {
-      currentRegionGT = k;
-      break;
-      }
-    }
+  // Find the index corresponding to the current label object in GT (labels are sorted)
+  const unsigned long currentRegionGT = static_cast<unsigned long>(
+    std::lower_bound(m_LabelsGT.begin(), m_LabelsGT.end(), labelObject->GetLabel()) - m_LabelsGT.begin());
 
   m_CardRegGT[currentRegionGT] = labelObject->Size();
   if (m_CardRegGT[currentRegionGT] == 0)
@@ -290,13 +297,23 @@ void HooverInstanceFilter<TLabelMap>
   LabelMapType* outGT = this->GetOutput(0);
   LabelMapType* outMS = this->GetOutput(1);
 
-  // Iterators on label object container (to gain efficiency when accessing them)
-  IteratorType  iterGT = IteratorType( outGT );
-  IteratorType  iterMS = IteratorType( outMS );
+  // Label objects by index (to gain efficiency when accessing them)
+  ObjectVectorType objectsGT;
+  ObjectVectorType objectsMS;
+  objectsGT.reserve(m_NumberOfRegionsGT);
+  objectsMS.reserve(m_NumberOfRegionsMS);
+  for (IteratorType iterGT = IteratorType( outGT ); !iterGT.IsAtEnd(); ++iterGT)
+    {
+    objectsGT.push_back(iterGT.GetLabelObject());
+    }
+  for (IteratorType iterMS = IteratorType( outMS ); !iterMS.IsAtEnd(); ++iterMS)
+    {
+    objectsMS.push_back(iterMS.GetLabelObject());
+    }
 
-  // Set of classified regions
-  RegionSetType GTindices;
-  RegionSetType MSindices;
+  // Flags of classified regions
+  std::vector<bool> GTindices(m_NumberOfRegionsGT, false);
+  std::vector<bool> MSindices(m_NumberOfRegionsMS, false);
 
   // flags to detect empty rows or columns
   bool IsRowEmpty;
@@ -312,29 +329,22 @@ void HooverInstanceFilter<TLabelMap>
   double areaMS = 0.0;
 
   // first pass : loop on GT regions first
-  for(unsigned int row=0; row<m_NumberOfRegionsGT; row++, iterGT++)
+  for(unsigned long row=0; row<m_NumberOfRegionsGT; row++)
     {
     double sumOS = 0.0; // sum of coefT for potential over-segmented regions
     double sumScoreRF = 0.0; // temporary sum  of (Tij x (Tij - 1)) terms for the RF score
-    RegionSetType     regionsOfMS; // stores region indexes
+    std::vector<unsigned long> regionsOfMS; // stores region indexes
     ObjectVectorType  objectsOfMS; // stores region pointers
 
     double tGT = static_cast<double>(m_CardRegGT[row]) * m_Threshold; // card Ri x t
     IsRowEmpty = true;
-    iterMS.GoToBegin();
-    for(unsigned int col=0; col<m_NumberOfRegionsMS; col++, iterMS++)
+    // only the non-empty cells of the row : the other regions ^Rj have an empty intersection with Ri
+    for(size_t cell=m_OverlapMatrix.GetRowBegin(row); cell<m_OverlapMatrix.GetRowEnd(row); ++cell)
       {
+      const unsigned long col = m_OverlapMatrix.GetRowCellColumn(cell);
       // Tij
-      double coefT = static_cast<double>(m_HooverMatrix(row, col));
-      if(coefT < 0.5)
-        {
-        // the regions Ri and ^Rj have an empty intersection : we can jump to the next matrix cell
-        continue;
-        }
-      else
-        {
-        IsRowEmpty = false;
-        }
+      double coefT = static_cast<double>(m_OverlapMatrix.GetRowCellValue(cell));
+      IsRowEmpty = false;
 
       double tMS = static_cast<double>(m_CardRegMS[col]) * m_Threshold; // card Rj x t
 
@@ -347,8 +357,8 @@ void HooverInstanceFilter<TLabelMap>
           {
           otbDebugMacro(<< "1 coef[" << row << "," << col << "]=" << coefT << " #tGT=" << tGT << " #tMS=" << tMS << " -> CD");
 
-          LabelObjectType *regionGT = iterGT.GetLabelObject();
-          LabelObjectType *regionMS = iterMS.GetLabelObject();
+          LabelObjectType *regionGT = objectsGT[row];
+          LabelObjectType *regionMS = objectsMS[col];
           double scoreRC = m_Threshold * (std::min(coefT / tGT, coefT / tMS));
           bufferRC += scoreRC * static_cast<double>(m_CardRegGT[row]);
 
@@ -361,15 +371,15 @@ void HooverInstanceFilter<TLabelMap>
             regionMS->SetAttribute(GetNameFromAttribute(ATTRIBUTE_CD), static_cast<AttributesValueType>(regionGT->GetLabel()));
             }
 
-          GTindices.insert(row);
-          MSindices.insert(col);
+          GTindices[row] = true;
+          MSindices[col] = true;
           }
         else
           {
           otbDebugMacro(<< "2 coef[" << row << "," << col << "]=" << coefT << " #tGT=" << tGT << " #tMS=" << tMS << " -> OSmaybe");
           }
-        objectsOfMS.push_back(iterMS.GetLabelObject()); // candidate region for over-segmentation
-        regionsOfMS.insert(col);
+        objectsOfMS.push_back(objectsMS[col]); // candidate region for over-segmentation
+        regionsOfMS.push_back(col);
         sumOS += coefT;
         sumScoreRF += coefT*(coefT-1.0);
         }
@@ -387,7 +397,7 @@ void HooverInstanceFilter<TLabelMap>
       else if(regionsOfMS.size()>1)
         {
         otbDebugMacro(<< row << " OS by ");
-        LabelObjectType *regionGT = iterGT.GetLabelObject();
+        LabelObjectType *regionGT = objectsGT[row];
 
         double cardRegGT = static_cast<double>(m_CardRegGT[row]);
         double scoreRF = 1.0 - sumScoreRF / (cardRegGT * (cardRegGT - 1.0));
@@ -413,10 +423,10 @@ void HooverInstanceFilter<TLabelMap>
           indexOS++;
           }
 
-        GTindices.insert(row);
-        for(RegionSetType::iterator it=regionsOfMS.begin(); it!=regionsOfMS.end(); ++it)
+        GTindices[row] = true;
+        for(std::vector<unsigned long>::const_iterator it=regionsOfMS.begin(); it!=regionsOfMS.end(); ++it)
           {
-          MSindices.insert(*it);
+          MSindices[*it] = true;
           otbDebugMacro(<< *it << " ");
           }
         }
@@ -428,7 +438,7 @@ void HooverInstanceFilter<TLabelMap>
     // check for empty rows : they should be ignored and have no Hoover attribute
     if (IsRowEmpty)
       {
-      GTindices.insert(row);
+      GTindices[row] = true;
       }
     else
       {
@@ -437,39 +447,31 @@ void HooverInstanceFilter<TLabelMap>
     } // end of line loop
 
   // second pass : loop on MS regions first
-  iterMS.GoToBegin();
-  for(unsigned int col=0; col<m_NumberOfRegionsMS; col++, iterMS++)
+  for(unsigned long col=0; col<m_NumberOfRegionsMS; col++)
     {
     double sumUS = 0.0; // sum of coefT for potential under-segmented regions
     double sumScoreUS = 0.0; // temporary sum of the (Tij x (Tij - 1)) for RA score
     double sumCardUS = 0.0; // temporary sum of under segmented region sizes
 
-    RegionSetType regionsOfGT;     // stores region indexes
+    std::vector<unsigned long> regionsOfGT; // stores region indexes
     ObjectVectorType  objectsOfGT; // stores region pointers
 
     double tMS = static_cast<double>(m_CardRegMS[col]) * m_Threshold;
     IsColEmpty = true;
-    iterGT.GoToBegin();
-    for(unsigned int row=0; row<m_NumberOfRegionsGT; row++, iterGT++)
+    // only the non-empty cells of the column, in increasing row order
+    for(size_t cell=m_OverlapMatrix.GetColumnBegin(col); cell<m_OverlapMatrix.GetColumnEnd(col); ++cell)
       {
-      double coefT = static_cast<double>(m_HooverMatrix(row, col));
-      if(coefT < 0.5)
-        {
-        // the regions Ri and ^Rj have an empty intersection : we can jump to the next matrix cell
-        continue;
-        }
-      else
-        {
-        IsColEmpty = false;
-        }
+      const unsigned long row = m_OverlapMatrix.GetColumnCellRow(cell);
+      double coefT = static_cast<double>(m_OverlapMatrix.GetColumnCellValue(cell));
+      IsColEmpty = false;
 
       double tGT = static_cast<double>(m_CardRegGT[row]) * m_Threshold;
       // Looking for Under-Segmented regions
       if(coefT>=tGT)
         {
         otbDebugMacro(<< "3 coef[" << row << "," << col << "]=" << coefT << " #tGT=" << tGT << " #tMS=" << tMS << " -> USmaybe");
-        regionsOfGT.insert(row);
-        objectsOfGT.push_back(iterGT.GetLabelObject());
+        regionsOfGT.push_back(row);
+        objectsOfGT.push_back(objectsGT[row]);
         sumUS += coefT;
         sumScoreUS += coefT * (coefT - 1.0);
         sumCardUS += static_cast<double>(m_CardRegGT[row]);
@@ -485,7 +487,7 @@ void HooverInstanceFilter<TLabelMap>
         }
       else if(regionsOfGT.size()>1) // Under Segmentation
         {
-        LabelObjectType *regionMS = iterMS.GetLabelObject();
+        LabelObjectType *regionMS = objectsMS[col];
         double scoreRA = 1.0 - sumScoreUS / (sumCardUS * (sumCardUS - 1.0));
         bufferRA += scoreRA * sumCardUS;
 
@@ -509,10 +511,10 @@ void HooverInstanceFilter<TLabelMap>
           indexUS++;
           }
 
-        MSindices.insert(col);
-        for(RegionSetType::iterator it=regionsOfGT.begin(); it!=regionsOfGT.end(); ++it)
+        MSindices[col] = true;
+        for(std::vector<unsigned long>::const_iterator it=regionsOfGT.begin(); it!=regionsOfGT.end(); ++it)
           {
-          GTindices.insert(*it);
+          GTindices[*it] = true;
           otbDebugMacro(<< *it << " ");
           }
         otbDebugMacro(<< "US " << col);
@@ -525,7 +527,7 @@ void HooverInstanceFilter<TLabelMap>
     // check for empty columns (MS region that doesn't intersect any GT region)
     if (IsColEmpty)
       {
-      MSindices.insert(col);
+      MSindices[col] = true;
       }
     else
       {
@@ -534,13 +536,12 @@ void HooverInstanceFilter<TLabelMap>
     } // end of column loop
 
   // check for Missed regions (unregistered regions in GT)
-  iterGT.GoToBegin();
-  for(unsigned int i=0; i<m_NumberOfRegionsGT; ++i , ++iterGT)
+  for(unsigned long i=0; i<m_NumberOfRegionsGT; ++i)
     {
-    if(GTindices.count(i)==0)
+    if(!GTindices[i])
       {
       otbDebugMacro(<< "M " << i);
-      LabelObjectType *regionGT = iterGT.GetLabelObject();
+      LabelObjectType *regionGT = objectsGT[i];
 
       bufferRM += static_cast<double>(m_CardRegGT[i]);
 
@@ -556,12 +557,11 @@ void HooverInstanceFilter<TLabelMap>
     }
 
   // check for Noise regions (unregistered regions in MS)
-  iterMS.GoToBegin();
-  for(unsigned int i=0; i<m_NumberOfRegionsMS; ++i , ++iterMS)
+  for(unsigned long i=0; i<m_NumberOfRegionsMS; ++i)
     {
-    if(MSindices.count(i)==0)
+    if(!MSindices[i])
       {
-      LabelObjectType *regionMS = iterMS.GetLabelObject();
+      LabelObjectType *regionMS = objectsMS[i];
 
       bufferRN += static_cast<double>(m_CardRegMS[i]);
 
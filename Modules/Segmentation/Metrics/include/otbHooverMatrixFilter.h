@@ -36,6 +36,12 @@ namespace otb
  * a machine segmentation. The line number gives the index of the ground truth region. The
  * column number gives the index of the machine segmentation region.
  *
+ * The dense matrix grows with the product of the numbers of regions. For
+ * large segmentations, use StreamingHooverMatrixFilter, which computes a
+ * sparse matrix from the label images.
+ *
+ * \sa StreamingHooverMatrixFilter
+ *
  * \ingroup OTBMetrics
  */
 
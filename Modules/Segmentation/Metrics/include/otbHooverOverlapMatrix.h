@@ -0,0 +1,270 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef otbHooverOverlapMatrix_h
+#define otbHooverOverlapMatrix_h
+
+#include "itkIntTypes.h"
+#include "itkVariableSizeMatrix.h"
+#include <vector>
+#include <cstddef>
+
+namespace otb
+{
+
+/** \class HooverOverlapAccumulator
+ * \brief Hash table of the overlaps between ground truth and machine segmentation labels
+ *
+ * Each slot stores a couple of labels and its number of pixels, in flat
+ * arrays (open addressing, linear probing, power of two capacity). There is
+ * no allocation per couple. Accumulators can be merged, so that each thread
+ * fills its own table.
+ *
+ * \sa HooverOverlapMatrix
+ *
+ * \ingroup OTBMetrics
+ */
+template <class TLabel>
+class HooverOverlapAccumulator
+{
+public:
+  typedef HooverOverlapAccumulator Self;
+  typedef TLabel                   LabelType;
+  typedef unsigned long            CoefficientType;
+
+  HooverOverlapAccumulator();
+
+  /** Remove all couples, and reserve room for the expected number of couples */
+  void Initialize(size_t expectedCouples = 1024);
+
+  /** Add a number of pixels to a couple of labels */
+  inline void Accumulate(LabelType labelGT, LabelType labelMS, CoefficientType count)
+  {
+    m_Counts[this->GetOrCreateSlot(labelGT, labelMS)] += count;
+  }
+
+  /** Merge all the couples of another accumulator */
+  void Merge(const Self & other);
+
+  /** Number of couples stored */
+  size_t GetNumberOfCouples() const
+  {
+    return m_NumberOfCouples;
+  }
+
+  /** Slot access */
+  size_t GetNumberOfSlots() const
+  {
+    return m_Counts.size();
+  }
+
+  bool IsSlotUsed(size_t slot) const
+  {
+    return m_Counts[slot] != 0;
+  }
+
+  LabelType GetSlotGroundTruthLabel(size_t slot) const
+  {
+    return m_KeysGT[slot];
+  }
+
+  LabelType GetSlotMachineSegmentationLabel(size_t slot) const
+  {
+    return m_KeysMS[slot];
+  }
+
+  CoefficientType GetSlotCount(size_t slot) const
+  {
+    return m_Counts[slot];
+  }
+
+private:
+  /** Hash of a couple of labels (Fibonacci hashing) */
+  inline size_t GetFirstSlot(LabelType labelGT, LabelType labelMS) const
+  {
+    const itk::uint64_t key = static_cast<itk::uint64_t>(static_cast<itk::int64_t>(labelGT)) * 0x9E3779B97F4A7C15ULL
+      ^ static_cast<itk::uint64_t>(static_cast<itk::int64_t>(labelMS));
+    return static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> (64 - m_HashBits)) & (m_Counts.size() - 1);
+  }
+
+  /** Find the slot of a couple, create it if needed */
+  size_t GetOrCreateSlot(LabelType labelGT, LabelType labelMS);
+
+  /** Resize the table and re-insert its content */
+  void Rehash(size_t newCapacity);
+
+  std::vector<LabelType>       m_KeysGT;
+  std::vector<LabelType>       m_KeysMS;
+  std::vector<CoefficientType> m_Counts;
+  unsigned int                 m_HashBits;
+  size_t                       m_NumberOfCouples;
+};
+
+/** \class HooverOverlapMatrix
+ * \brief Sparse Hoover confusion matrix
+ *
+ * This class stores the non-empty cells of the Hoover confusion matrix: the
+ * number of pixels in the intersection of a ground truth (GT) region, given
+ * by the row, and of a machine segmentation (MS) region, given by the column.
+ * Rows and columns are the indices of the regions in increasing label order,
+ * as in the label maps.
+ *
+ * Cells are stored twice, sorted by row then column and sorted by column
+ * then row, so that both the rows and the columns can be walked over their
+ * non-empty cells only. The memory used is proportional to the number of
+ * overlapping couples of regions, instead of the product of the numbers of
+ * regions for the dense matrix.
+ *
+ * \sa HooverOverlapAccumulator
+ * \sa HooverInstanceFilter
+ *
+ * \ingroup OTBMetrics
+ */
+template <class TLabel>
+class HooverOverlapMatrix
+{
+public:
+  typedef HooverOverlapMatrix                       Self;
+  typedef TLabel                                    LabelType;
+  typedef std::vector<LabelType>                    LabelVectorType;
+  typedef unsigned long                             CoefficientType;
+  typedef itk::VariableSizeMatrix<CoefficientType>  MatrixType;
+  typedef HooverOverlapAccumulator<TLabel>          AccumulatorType;
+
+  HooverOverlapMatrix();
+
+  /** Remove all cells and labels */
+  void Clear();
+
+  /** Build the matrix from the couples of an accumulator. Couples involving
+   *  the background label only define the labels of the regions. */
+  void SetAccumulator(const AccumulatorType & accumulator, LabelType background);
+
+  /** Build the matrix from a dense Hoover confusion matrix. No label is set. */
+  void SetDenseMatrix(const MatrixType & matrix);
+
+  /** Labels of the GT regions (rows) and MS regions (columns), in
+   *  increasing order. Empty if the matrix was built from a dense matrix. */
+  const LabelVectorType & GetGroundTruthLabels() const
+  {
+    return m_LabelsGT;
+  }
+
+  const LabelVectorType & GetMachineSegmentationLabels() const
+  {
+    return m_LabelsMS;
+  }
+
+  unsigned long GetNumberOfRows() const
+  {
+    return m_NumberOfRows;
+  }
+
+  unsigned long GetNumberOfColumns() const
+  {
+    return m_NumberOfColumns;
+  }
+
+  /** Number of non-empty cells */
+  size_t GetNumberOfCells() const
+  {
+    return m_RowValues.size();
+  }
+
+  /** Value of a cell (0 if empty) */
+  CoefficientType GetValue(unsigned long row, unsigned long col) const;
+
+  /** Non-empty cells of a row, in [GetRowBegin(row), GetRowEnd(row)) */
+  size_t GetRowBegin(unsigned long row) const
+  {
+    return m_RowStarts[row];
+  }
+
+  size_t GetRowEnd(unsigned long row) const
+  {
+    return m_RowStarts[row + 1];
+  }
+
+  unsigned long GetRowCellColumn(size_t cell) const
+  {
+    return m_RowColumns[cell];
+  }
+
+  CoefficientType GetRowCellValue(size_t cell) const
+  {
+    return m_RowValues[cell];
+  }
+
+  /** Non-empty cells of a column, in [GetColumnBegin(col), GetColumnEnd(col)) */
+  size_t GetColumnBegin(unsigned long col) const
+  {
+    return m_ColumnStarts[col];
+  }
+
+  size_t GetColumnEnd(unsigned long col) const
+  {
+    return m_ColumnStarts[col + 1];
+  }
+
+  unsigned long GetColumnCellRow(size_t cell) const
+  {
+    return m_ColumnRows[cell];
+  }
+
+  CoefficientType GetColumnCellValue(size_t cell) const
+  {
+    return m_ColumnValues[cell];
+  }
+
+private:
+  /** Cell given by its row and column */
+  struct CellStruct
+  {
+    unsigned long   Row;
+    unsigned long   Column;
+    CoefficientType Value;
+    bool operator<(const CellStruct & other) const
+    {
+      return Row != other.Row ? Row < other.Row : Column < other.Column;
+    }
+  };
+
+  /** Build the row and column storages from a list of cells */
+  void BuildFromCells(unsigned long nbRows, unsigned long nbColumns, std::vector<CellStruct> & cells);
+
+  unsigned long                m_NumberOfRows;
+  unsigned long                m_NumberOfColumns;
+  LabelVectorType              m_LabelsGT;
+  LabelVectorType              m_LabelsMS;
+  std::vector<size_t>          m_RowStarts;
+  std::vector<unsigned long>   m_RowColumns;
+  std::vector<CoefficientType> m_RowValues;
+  std::vector<size_t>          m_ColumnStarts;
+  std::vector<unsigned long>   m_ColumnRows;
+  std::vector<CoefficientType> m_ColumnValues;
+};
+
+} // end namespace otb
+
+#ifndef OTB_MANUAL_INSTANTIATION
+#include "otbHooverOverlapMatrix.txx"
+#endif
+
+#endif
@@ -0,0 +1,294 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef otbHooverOverlapMatrix_txx
+#define otbHooverOverlapMatrix_txx
+
+#include "otbHooverOverlapMatrix.h"
+#include <algorithm>
+
+namespace otb
+{
+
+template <class TLabel>
+HooverOverlapAccumulator<TLabel>
+::HooverOverlapAccumulator()
+  : m_KeysGT(),
+    m_KeysMS(),
+    m_Counts(),
+    m_HashBits(0),
+    m_NumberOfCouples(0)
+{
+  this->Initialize();
+}
+
+template <class TLabel>
+void
+HooverOverlapAccumulator<TLabel>
+::Initialize(size_t expectedCouples)
+{
+  // keep the load factor under 0.5 for the expected number of couples
+  size_t capacity = 16;
+  while (capacity < 2 * expectedCouples)
+    {
+    capacity *= 2;
+    }
+  m_HashBits = 0;
+  while ((static_cast<size_t>(1) << m_HashBits) < capacity)
+    {
+    ++m_HashBits;
+    }
+  m_KeysGT.assign(capacity, LabelType());
+  m_KeysMS.assign(capacity, LabelType());
+  m_Counts.assign(capacity, 0);
+  m_NumberOfCouples = 0;
+}
+
+template <class TLabel>
+size_t
+HooverOverlapAccumulator<TLabel>
+::GetOrCreateSlot(LabelType labelGT, LabelType labelMS)
+{
+  const size_t mask = m_Counts.size() - 1;
+  size_t slot = this->GetFirstSlot(labelGT, labelMS);
+  while (true)
+    {
+    if (m_Counts[slot] == 0)
+      {
+      // grow the table if the load factor would exceed 0.7
+      if (10 * (m_NumberOfCouples + 1) > 7 * m_Counts.size())
+        {
+        this->Rehash(2 * m_Counts.size());
+        return this->GetOrCreateSlot(labelGT, labelMS);
+        }
+      m_KeysGT[slot] = labelGT;
+      m_KeysMS[slot] = labelMS;
+      ++m_NumberOfCouples;
+      return slot;
+      }
+    if (m_KeysGT[slot] == labelGT && m_KeysMS[slot] == labelMS)
+      {
+      return slot;
+      }
+    slot = (slot + 1) & mask;
+    }
+}
+
+template <class TLabel>
+void
+HooverOverlapAccumulator<TLabel>
+::Rehash(size_t newCapacity)
+{
+  std::vector<LabelType>       keysGT;
+  std::vector<LabelType>       keysMS;
+  std::vector<CoefficientType> counts;
+  keysGT.swap(m_KeysGT);
+  keysMS.swap(m_KeysMS);
+  counts.swap(m_Counts);
+
+  this->Initialize(newCapacity / 2);
+  for (size_t i = 0; i < counts.size(); ++i)
+    {
+    if (counts[i] != 0)
+      {
+      m_Counts[this->GetOrCreateSlot(keysGT[i], keysMS[i])] = counts[i];
+      }
+    }
+}
+
+template <class TLabel>
+void
+HooverOverlapAccumulator<TLabel>
+::Merge(const Self & other)
+{
+  for (size_t slot = 0; slot < other.GetNumberOfSlots(); ++slot)
+    {
+    if (other.IsSlotUsed(slot))
+      {
+      this->Accumulate(other.m_KeysGT[slot], other.m_KeysMS[slot], other.m_Counts[slot]);
+      }
+    }
+}
+
+template <class TLabel>
+HooverOverlapMatrix<TLabel>
+::HooverOverlapMatrix()
+  : m_NumberOfRows(0),
+    m_NumberOfColumns(0)
+{
+  this->Clear();
+}
+
+template <class TLabel>
+void
+HooverOverlapMatrix<TLabel>
+::Clear()
+{
+  m_NumberOfRows = 0;
+  m_NumberOfColumns = 0;
+  m_LabelsGT.clear();
+  m_LabelsMS.clear();
+  m_RowStarts.assign(1, 0);
+  m_RowColumns.clear();
+  m_RowValues.clear();
+  m_ColumnStarts.assign(1, 0);
+  m_ColumnRows.clear();
+  m_ColumnValues.clear();
+}
+
+template <class TLabel>
+void
+HooverOverlapMatrix<TLabel>
+::SetAccumulator(const AccumulatorType & accumulator, LabelType background)
+{
+  // labels of the regions
+  LabelVectorType labelsGT;
+  LabelVectorType labelsMS;
+  for (size_t slot = 0; slot < accumulator.GetNumberOfSlots(); ++slot)
+    {
+    if (accumulator.IsSlotUsed(slot))
+      {
+      if (accumulator.GetSlotGroundTruthLabel(slot) != background)
+        {
+        labelsGT.push_back(accumulator.GetSlotGroundTruthLabel(slot));
+        }
+      if (accumulator.GetSlotMachineSegmentationLabel(slot) != background)
+        {
+        labelsMS.push_back(accumulator.GetSlotMachineSegmentationLabel(slot));
+        }
+      }
+    }
+  std::sort(labelsGT.begin(), labelsGT.end());
+  labelsGT.erase(std::unique(labelsGT.begin(), labelsGT.end()), labelsGT.end());
+  std::sort(labelsMS.begin(), labelsMS.end());
+  labelsMS.erase(std::unique(labelsMS.begin(), labelsMS.end()), labelsMS.end());
+
+  // cells of the couples of regions
+  std::vector<CellStruct> cells;
+  cells.reserve(accumulator.GetNumberOfCouples());
+  for (size_t slot = 0; slot < accumulator.GetNumberOfSlots(); ++slot)
+    {
+    if (accumulator.IsSlotUsed(slot)
+        && accumulator.GetSlotGroundTruthLabel(slot) != background
+        && accumulator.GetSlotMachineSegmentationLabel(slot) != background)
+      {
+      CellStruct cell;
+      cell.Row = static_cast<unsigned long>(std::lower_bound(labelsGT.begin(), labelsGT.end(),
+                                                             accumulator.GetSlotGroundTruthLabel(slot)) - labelsGT.begin());
+      cell.Column = static_cast<unsigned long>(std::lower_bound(labelsMS.begin(), labelsMS.end(),
+                                                                accumulator.GetSlotMachineSegmentationLabel(slot)) - labelsMS.begin());
+      cell.Value = accumulator.GetSlotCount(slot);
+      cells.push_back(cell);
+      }
+    }
+
+  this->BuildFromCells(labelsGT.size(), labelsMS.size(), cells);
+  m_LabelsGT.swap(labelsGT);
+  m_LabelsMS.swap(labelsMS);
+}
+
+template <class TLabel>
+void
+HooverOverlapMatrix<TLabel>
+::SetDenseMatrix(const MatrixType & matrix)
+{
+  std::vector<CellStruct> cells;
+  for (unsigned long row = 0; row < matrix.Rows(); ++row)
+    {
+    for (unsigned long col = 0; col < matrix.Cols(); ++col)
+      {
+      if (matrix(row, col) != 0)
+        {
+        CellStruct cell;
+        cell.Row = row;
+        cell.Column = col;
+        cell.Value = matrix(row, col);
+        cells.push_back(cell);
+        }
+      }
+    }
+  this->BuildFromCells(matrix.Rows(), matrix.Cols(), cells);
+  m_LabelsGT.clear();
+  m_LabelsMS.clear();
+}
+
+template <class TLabel>
+void
+HooverOverlapMatrix<TLabel>
+::BuildFromCells(unsigned long nbRows, unsigned long nbColumns, std::vector<CellStruct> & cells)
+{
+  m_NumberOfRows = nbRows;
+  m_NumberOfColumns = nbColumns;
+  std::sort(cells.begin(), cells.end());
+
+  // cells sorted by row
+  m_RowStarts.assign(nbRows + 1, 0);
+  m_RowColumns.resize(cells.size());
+  m_RowValues.resize(cells.size());
+  for (size_t i = 0; i < cells.size(); ++i)
+    {
+    ++m_RowStarts[cells[i].Row + 1];
+    m_RowColumns[i] = cells[i].Column;
+    m_RowValues[i] = cells[i].Value;
+    }
+  for (unsigned long row = 0; row < nbRows; ++row)
+    {
+    m_RowStarts[row + 1] += m_RowStarts[row];
+    }
+
+  // cells sorted by column, then by row (counting sort of the row order)
+  m_ColumnStarts.assign(nbColumns + 1, 0);
+  for (size_t i = 0; i < cells.size(); ++i)
+    {
+    ++m_ColumnStarts[cells[i].Column + 1];
+    }
+  for (unsigned long col = 0; col < nbColumns; ++col)
+    {
+    m_ColumnStarts[col + 1] += m_ColumnStarts[col];
+    }
+  std::vector<size_t> positions(m_ColumnStarts.begin(), m_ColumnStarts.end() - 1);
+  m_ColumnRows.resize(cells.size());
+  m_ColumnValues.resize(cells.size());
+  for (size_t i = 0; i < cells.size(); ++i)
+    {
+    const size_t pos = positions[cells[i].Column]++;
+    m_ColumnRows[pos] = cells[i].Row;
+    m_ColumnValues[pos] = cells[i].Value;
+    }
+}
+
+template <class TLabel>
+typename HooverOverlapMatrix<TLabel>::CoefficientType
+HooverOverlapMatrix<TLabel>
+::GetValue(unsigned long row, unsigned long col) const
+{
+  const std::vector<unsigned long>::const_iterator begin = m_RowColumns.begin() + m_RowStarts[row];
+  const std::vector<unsigned long>::const_iterator end = m_RowColumns.begin() + m_RowStarts[row + 1];
+  const std::vector<unsigned long>::const_iterator it = std::lower_bound(begin, end, col);
+  if (it == end || *it != col)
+    {
+    return 0;
+    }
+  return m_RowValues[it - m_RowColumns.begin()];
+}
+
+} // end namespace otb
+
+#endif
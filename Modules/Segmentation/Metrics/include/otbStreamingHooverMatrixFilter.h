@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef otbStreamingHooverMatrixFilter_h
+#define otbStreamingHooverMatrixFilter_h
+
+#include "otbPersistentImageFilter.h"
+#include "otbPersistentFilterStreamingDecorator.h"
+#include "otbHooverOverlapMatrix.h"
+
+namespace otb
+{
+
+/** \class PersistentHooverMatrixFilter
+ * \brief Compute the sparse Hoover confusion matrix of two label images using streaming
+ *
+ * The overlaps between the regions of a ground truth (GT) and of a machine
+ * segmentation (MS) label image are accumulated in a hash table of couples
+ * of labels (see HooverOverlapAccumulator), one per thread. Runs of pixels
+ * sharing the same couple are accumulated at once. The thread tables are
+ * merged in Synthetize(), and the result is given as a HooverOverlapMatrix,
+ * whose size only depends on the number of overlapping couples of regions.
+ *
+ * Pixels labelled with the background value in one image do not contribute
+ * to the matrix, but their label in the other image is still a region of
+ * the matrix. Rows and columns follow the increasing label order, as in the
+ * label maps given to the HooverInstanceFilter.
+ *
+ *  This filter persists its temporary data. It means that if you Update it n times on n different
+ * requested regions, the output matrix will be the matrix of the whole set of n regions.
+ *
+ * To reset the temporary data, one should call the Reset() function.
+ *
+ * To get the matrix once the regions have been processed via the pipeline, use the Synthetize() method.
+ *
+ * \sa HooverOverlapMatrix
+ * \sa HooverInstanceFilter
+ * \sa PersistentImageFilter
+ * \ingroup Streamed
+ * \ingroup Multithreaded
+ *
+ * \ingroup OTBMetrics
+ */
+template<class TLabelImage>
+class ITK_EXPORT PersistentHooverMatrixFilter :
+  public PersistentImageFilter<TLabelImage, TLabelImage>
+{
+public:
+  /** Standard Self typedef */
+  typedef PersistentHooverMatrixFilter                    Self;
+  typedef PersistentImageFilter<TLabelImage, TLabelImage> Superclass;
+  typedef itk::SmartPointer<Self>                         Pointer;
+  typedef itk::SmartPointer<const Self>                   ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Runtime information support. */
+  itkTypeMacro(PersistentHooverMatrixFilter, PersistentImageFilter);
+
+  /** Image related typedefs. */
+  typedef TLabelImage                             ImageType;
+  typedef typename TLabelImage::RegionType        RegionType;
+  typedef typename TLabelImage::PixelType         LabelType;
+
+  /** Matrix typedefs */
+  typedef HooverOverlapAccumulator<LabelType>     AccumulatorType;
+  typedef HooverOverlapMatrix<LabelType>          OverlapMatrixType;
+
+  /** Smart Pointer type to a DataObject. */
+  typedef typename itk::DataObject::Pointer       DataObjectPointer;
+  typedef itk::ProcessObject::DataObjectPointerArraySizeType DataObjectPointerArraySizeType;
+
+  /** Set/Get the ground truth label image */
+  void SetGroundTruthImage(const ImageType * gt);
+  const ImageType * GetGroundTruthImage() const;
+
+  /** Set/Get the machine segmentation label image */
+  void SetMachineSegmentationImage(const ImageType * ms);
+  const ImageType * GetMachineSegmentationImage() const;
+
+  /** Set/Get the background label (default is 0) */
+  itkSetMacro(BackgroundValue, LabelType);
+  itkGetConstMacro(BackgroundValue, LabelType);
+
+  /** Sparse Hoover confusion matrix. Valid after Synthetize(). */
+  const OverlapMatrixType & GetOverlapMatrix() const
+  {
+    return m_OverlapMatrix;
+  }
+
+  /** Make a DataObject of the correct type to be used as the specified
+   * output.
+   */
+  DataObjectPointer MakeOutput(DataObjectPointerArraySizeType idx) ITK_OVERRIDE;
+  using Superclass::MakeOutput;
+
+  void AllocateOutputs() ITK_OVERRIDE;
+  void GenerateOutputInformation() ITK_OVERRIDE;
+  void Synthetize(void) ITK_OVERRIDE;
+  void Reset(void) ITK_OVERRIDE;
+
+protected:
+  PersistentHooverMatrixFilter();
+  ~PersistentHooverMatrixFilter() ITK_OVERRIDE {}
+  void PrintSelf(std::ostream& os, itk::Indent indent) const ITK_OVERRIDE;
+
+  /** Multi-thread version GenerateData. */
+  void ThreadedGenerateData(const RegionType& outputRegionForThread, itk::ThreadIdType threadId) ITK_OVERRIDE;
+
+private:
+  PersistentHooverMatrixFilter(const Self &); //purposely not implemented
+  void operator =(const Self&); //purposely not implemented
+
+  std::vector<AccumulatorType> m_ThreadAccumulators;
+  OverlapMatrixType            m_OverlapMatrix;
+  LabelType                    m_BackgroundValue;
+
+}; // end of class PersistentHooverMatrixFilter
+
+/**===========================================================================*/
+
+/** \class StreamingHooverMatrixFilter
+ * \brief This class streams the whole input images through the PersistentHooverMatrixFilter.
+ *
+ * This way, it allows computing the sparse Hoover confusion matrix of large
+ * label images. It calls the Reset() method of the PersistentHooverMatrixFilter
+ * before streaming the images and the Synthetize() method after having
+ * streamed the images. The matrix can then be given to a HooverInstanceFilter.
+ *
+ * \sa PersistentHooverMatrixFilter
+ * \sa PersistentFilterStreamingDecorator
+ * \ingroup Streamed
+ * \ingroup Multithreaded
+ *
+ * \ingroup OTBMetrics
+ */
+template<class TLabelImage>
+class ITK_EXPORT StreamingHooverMatrixFilter :
+  public PersistentFilterStreamingDecorator<PersistentHooverMatrixFilter<TLabelImage> >
+{
+public:
+  /** Standard Self typedef */
+  typedef StreamingHooverMatrixFilter Self;
+  typedef PersistentFilterStreamingDecorator
+  <PersistentHooverMatrixFilter<TLabelImage> > Superclass;
+  typedef itk::SmartPointer<Self>       Pointer;
+  typedef itk::SmartPointer<const Self> ConstPointer;
+
+  /** Type macro */
+  itkNewMacro(Self);
+
+  /** Creation through object factory macro */
+  itkTypeMacro(StreamingHooverMatrixFilter, PersistentFilterStreamingDecorator);
+
+  typedef TLabelImage                                  ImageType;
+  typedef typename Superclass::FilterType              InternalFilterType;
+  typedef typename InternalFilterType::LabelType       LabelType;
+  typedef typename InternalFilterType::OverlapMatrixType OverlapMatrixType;
+
+  /** Set the ground truth label image */
+  void SetGroundTruthImage(const ImageType * gt)
+  {
+    this->GetFilter()->SetGroundTruthImage(gt);
+  }
+
+  /** Set the machine segmentation label image */
+  void SetMachineSegmentationImage(const ImageType * ms)
+  {
+    this->GetFilter()->SetMachineSegmentationImage(ms);
+  }
+
+  /** Set the background label */
+  void SetBackgroundValue(LabelType background)
+  {
+    this->GetFilter()->SetBackgroundValue(background);
+  }
+
+  /** Sparse Hoover confusion matrix */
+  const OverlapMatrixType & GetOverlapMatrix() const
+  {
+    return this->GetFilter()->GetOverlapMatrix();
+  }
+
+protected:
+  /** Constructor */
+  StreamingHooverMatrixFilter() {};
+  /** Destructor */
+  ~StreamingHooverMatrixFilter() ITK_OVERRIDE {}
+
+private:
+  StreamingHooverMatrixFilter(const Self &); //purposely not implemented
+  void operator =(const Self&); //purposely not implemented
+};
+
+} // end namespace otb
+
+#ifndef OTB_MANUAL_INSTANTIATION
+#include "otbStreamingHooverMatrixFilter.txx"
+#endif
+
+#endif
@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef otbStreamingHooverMatrixFilter_txx
+#define otbStreamingHooverMatrixFilter_txx
+
+#include "otbStreamingHooverMatrixFilter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkProgressReporter.h"
+
+namespace otb
+{
+
+template<class TLabelImage>
+PersistentHooverMatrixFilter<TLabelImage>
+::PersistentHooverMatrixFilter() :
+  m_ThreadAccumulators(),
+  m_OverlapMatrix(),
+  m_BackgroundValue(itk::NumericTraits<LabelType>::Zero)
+{
+  this->SetNumberOfRequiredInputs(2);
+}
+
+template<class TLabelImage>
+itk::DataObject::Pointer
+PersistentHooverMatrixFilter<TLabelImage>
+::MakeOutput(DataObjectPointerArraySizeType itkNotUsed(output))
+{
+  return static_cast<itk::DataObject*>(TLabelImage::New().GetPointer());
+}
+
+template<class TLabelImage>
+void
+PersistentHooverMatrixFilter<TLabelImage>
+::SetGroundTruthImage(const ImageType * gt)
+{
+  this->itk::ProcessObject::SetNthInput(0, const_cast<ImageType *>(gt));
+}
+
+template<class TLabelImage>
+const typename PersistentHooverMatrixFilter<TLabelImage>::ImageType *
+PersistentHooverMatrixFilter<TLabelImage>
+::GetGroundTruthImage() const
+{
+  return static_cast<const ImageType *>(this->itk::ProcessObject::GetInput(0));
+}
+
+template<class TLabelImage>
+void
+PersistentHooverMatrixFilter<TLabelImage>
+::SetMachineSegmentationImage(const ImageType * ms)
+{
+  this->itk::ProcessObject::SetNthInput(1, const_cast<ImageType *>(ms));
+}
+
+template<class TLabelImage>
+const typename PersistentHooverMatrixFilter<TLabelImage>::ImageType *
+PersistentHooverMatrixFilter<TLabelImage>
+::GetMachineSegmentationImage() const
+{
+  if (this->GetNumberOfInputs() < 2)
+    {
+    return ITK_NULLPTR;
+    }
+  return static_cast<const ImageType *>(this->itk::ProcessObject::GetInput(1));
+}
+
+template<class TLabelImage>
+void
+PersistentHooverMatrixFilter<TLabelImage>
+::GenerateOutputInformation()
+{
+  Superclass::GenerateOutputInformation();
+  if (this->GetGroundTruthImage())
+    {
+    this->GetOutput()->CopyInformation(this->GetGroundTruthImage());
+    this->GetOutput()->SetLargestPossibleRegion(this->GetGroundTruthImage()->GetLargestPossibleRegion());
+
+    if (this->GetOutput()->GetRequestedRegion().GetNumberOfPixels() == 0)
+      {
+      this->GetOutput()->SetRequestedRegion(this->GetOutput()->GetLargestPossibleRegion());
+      }
+    }
+}
+
+template<class TLabelImage>
+void
+PersistentHooverMatrixFilter<TLabelImage>
+::AllocateOutputs()
+{
+  // Nothing that needs to be allocated for the outputs : the output is not meant to be used
+}
+
+template<class TLabelImage>
+void
+PersistentHooverMatrixFilter<TLabelImage>
+::Reset()
+{
+  ImageType * gtPtr = const_cast<ImageType *>(this->GetGroundTruthImage());
+  ImageType * msPtr = const_cast<ImageType *>(this->GetMachineSegmentationImage());
+  gtPtr->UpdateOutputInformation();
+  msPtr->UpdateOutputInformation();
+
+  if (gtPtr->GetLargestPossibleRegion() != msPtr->GetLargestPossibleRegion())
+    {
+    itkExceptionMacro(<< "Ground truth and machine segmentation images must have the same size");
+    }
+
+  m_ThreadAccumulators.assign(this->GetNumberOfThreads(), AccumulatorType());
+  m_OverlapMatrix.Clear();
+}
+
+template<class TLabelImage>
+void
+PersistentHooverMatrixFilter<TLabelImage>
+::Synthetize()
+{
+  size_t nbCouples = 0;
+  for (unsigned int i = 0; i < m_ThreadAccumulators.size(); ++i)
+    {
+    nbCouples = std::max(nbCouples, m_ThreadAccumulators[i].GetNumberOfCouples());
+    }
+
+  AccumulatorType accumulator;
+  accumulator.Initialize(nbCouples);
+  for (unsigned int i = 0; i < m_ThreadAccumulators.size(); ++i)
+    {
+    accumulator.Merge(m_ThreadAccumulators[i]);
+    }
+  m_ThreadAccumulators.clear();
+
+  m_OverlapMatrix.SetAccumulator(accumulator, m_BackgroundValue);
+}
+
+template<class TLabelImage>
+void
+PersistentHooverMatrixFilter<TLabelImage>
+::ThreadedGenerateData(const RegionType& outputRegionForThread, itk::ThreadIdType threadId)
+{
+  // support progress methods/callbacks
+  itk::ProgressReporter progress(this, threadId, outputRegionForThread.GetNumberOfPixels());
+
+  AccumulatorType & accumulator = m_ThreadAccumulators[threadId];
+
+  itk::ImageRegionConstIterator<ImageType> itGT(this->GetGroundTruthImage(), outputRegionForThread);
+  itk::ImageRegionConstIterator<ImageType> itMS(this->GetMachineSegmentationImage(), outputRegionForThread);
+
+  // runs of pixels with the same couple of labels are accumulated at once
+  LabelType currentGT = m_BackgroundValue;
+  LabelType currentMS = m_BackgroundValue;
+  typename AccumulatorType::CoefficientType count = 0;
+  for (itGT.GoToBegin(), itMS.GoToBegin(); !itGT.IsAtEnd(); ++itGT, ++itMS)
+    {
+    const LabelType labelGT = itGT.Get();
+    const LabelType labelMS = itMS.Get();
+    if (labelGT != currentGT || labelMS != currentMS)
+      {
+      if (count > 0 && (currentGT != m_BackgroundValue || currentMS != m_BackgroundValue))
+        {
+        accumulator.Accumulate(currentGT, currentMS, count);
+        }
+      currentGT = labelGT;
+      currentMS = labelMS;
+      count = 0;
+      }
+    ++count;
+    progress.CompletedPixel();
+    }
+  if (count > 0 && (currentGT != m_BackgroundValue || currentMS != m_BackgroundValue))
+    {
+    accumulator.Accumulate(currentGT, currentMS, count);
+    }
+}
+
+template<class TLabelImage>
+void
+PersistentHooverMatrixFilter<TLabelImage>
+::PrintSelf(std::ostream& os, itk::Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "Background value: " << static_cast<typename itk::NumericTraits<LabelType>::PrintType>(m_BackgroundValue) << std::endl;
+  os << indent << "Matrix size: " << m_OverlapMatrix.GetNumberOfRows() << " x " << m_OverlapMatrix.GetNumberOfColumns() << std::endl;
+  os << indent << "Number of non-empty cells: " << m_OverlapMatrix.GetNumberOfCells() << std::endl;
+}
+
+} // end namespace otb
+#endif
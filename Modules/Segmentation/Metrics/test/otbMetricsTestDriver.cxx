@@ -26,4 +26,5 @@ void RegisterTests()
   REGISTER_TEST(otbHooverInstanceFilterNew);
   REGISTER_TEST(otbHooverInstanceFilterToAttributeImage);
   REGISTER_TEST(otbHooverMatrixFilter);
+  REGISTER_TEST(otbStreamingHooverMatrixFilter);
 }
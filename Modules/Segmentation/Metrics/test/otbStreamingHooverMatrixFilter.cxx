@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "otbHooverMatrixFilter.h"
+#include "otbStreamingHooverMatrixFilter.h"
+#include "otbHooverInstanceFilter.h"
+
+#include "otbImage.h"
+#include "otbImageFileReader.h"
+#include "itkLabelImageToLabelMapFilter.h"
+
+int otbStreamingHooverMatrixFilter(int argc, char* argv[])
+{
+  typedef otb::AttributesMapLabelObject<unsigned int, 2, float> LabelObjectType;
+  typedef itk::LabelMap<LabelObjectType>            LabelMapType;
+  typedef otb::HooverMatrixFilter<LabelMapType>     HooverMatrixFilterType;
+  typedef otb::Image<unsigned int, 2>               ImageType;
+  typedef otb::StreamingHooverMatrixFilter<ImageType> StreamingHooverMatrixFilterType;
+  typedef itk::LabelImageToLabelMapFilter
+    <ImageType, LabelMapType>                       ImageToLabelMapFilterType;
+  typedef otb::ImageFileReader<ImageType>           ImageReaderType;
+  typedef HooverMatrixFilterType::MatrixType        MatrixType;
+  typedef StreamingHooverMatrixFilterType::OverlapMatrixType OverlapMatrixType;
+  typedef otb::HooverInstanceFilter<LabelMapType>   InstanceFilterType;
+
+  if(argc != 4)
+    {
+    std::cerr << "Usage: " << argv[0];
+    std::cerr << " segmentationGT segmentationMS nbStreams" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  ImageReaderType::Pointer gt_reader = ImageReaderType::New();
+  gt_reader->SetFileName(argv[1]);
+
+  ImageReaderType::Pointer ms_reader = ImageReaderType::New();
+  ms_reader->SetFileName(argv[2]);
+
+  // Dense matrix from the label maps
+  ImageToLabelMapFilterType::Pointer gt_filter = ImageToLabelMapFilterType::New();
+  gt_filter->SetInput(gt_reader->GetOutput());
+  gt_filter->SetBackgroundValue(0);
+
+  ImageToLabelMapFilterType::Pointer ms_filter = ImageToLabelMapFilterType::New();
+  ms_filter->SetInput(ms_reader->GetOutput());
+  ms_filter->SetBackgroundValue(0);
+
+  HooverMatrixFilterType::Pointer hooverFilter = HooverMatrixFilterType::New();
+  hooverFilter->SetGroundTruthLabelMap(gt_filter->GetOutput());
+  hooverFilter->SetMachineSegmentationLabelMap(ms_filter->GetOutput());
+  hooverFilter->Update();
+
+  MatrixType &mat = hooverFilter->GetHooverConfusionMatrix();
+
+  // Sparse matrix from the streamed label images
+  StreamingHooverMatrixFilterType::Pointer streamingFilter = StreamingHooverMatrixFilterType::New();
+  streamingFilter->SetGroundTruthImage(gt_reader->GetOutput());
+  streamingFilter->SetMachineSegmentationImage(ms_reader->GetOutput());
+  streamingFilter->SetBackgroundValue(0);
+  streamingFilter->GetStreamer()->SetNumberOfDivisionsStrippedStreaming(atoi(argv[3]));
+  streamingFilter->Update();
+
+  const OverlapMatrixType & sparse = streamingFilter->GetOverlapMatrix();
+
+  if (sparse.GetNumberOfRows() != mat.Rows() || sparse.GetNumberOfColumns() != mat.Cols())
+    {
+    std::cerr << "Wrong matrix size: " << sparse.GetNumberOfRows() << " x " << sparse.GetNumberOfColumns()
+              << " instead of " << mat.Rows() << " x " << mat.Cols() << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (sparse.GetGroundTruthLabels() != gt_filter->GetOutput()->GetLabels()
+      || sparse.GetMachineSegmentationLabels() != ms_filter->GetOutput()->GetLabels())
+    {
+    std::cerr << "Labels of the sparse matrix differ from the labels of the label maps" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  size_t nbCells = 0;
+  for (unsigned int i = 0; i < mat.Rows(); ++i)
+    {
+    for (unsigned int j = 0; j < mat.Cols(); ++j)
+      {
+      if (mat(i, j) != 0)
+        {
+        ++nbCells;
+        }
+      if (sparse.GetValue(i, j) != mat(i, j))
+        {
+        std::cerr << "Cell [" << i << ", " << j << "] differs: " << sparse.GetValue(i, j)
+                  << " instead of " << mat(i, j) << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+  if (nbCells != sparse.GetNumberOfCells())
+    {
+    std::cerr << "Wrong number of cells: " << sparse.GetNumberOfCells() << " instead of " << nbCells << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Hoover instances from both matrices
+  InstanceFilterType::Pointer denseInstances = InstanceFilterType::New();
+  denseInstances->SetGroundTruthLabelMap(gt_filter->GetOutput());
+  denseInstances->SetMachineSegmentationLabelMap(ms_filter->GetOutput());
+  denseInstances->SetThreshold(0.75);
+  denseInstances->SetHooverMatrix(mat);
+  denseInstances->InPlaceOff();
+  denseInstances->Update();
+
+  InstanceFilterType::Pointer sparseInstances = InstanceFilterType::New();
+  sparseInstances->SetGroundTruthLabelMap(gt_filter->GetOutput());
+  sparseInstances->SetMachineSegmentationLabelMap(ms_filter->GetOutput());
+  sparseInstances->SetThreshold(0.75);
+  sparseInstances->SetHooverOverlapMatrix(sparse);
+  sparseInstances->InPlaceOff();
+  sparseInstances->Update();
+
+  if (denseInstances->GetMeanRC() != sparseInstances->GetMeanRC()
+      || denseInstances->GetMeanRF() != sparseInstances->GetMeanRF()
+      || denseInstances->GetMeanRA() != sparseInstances->GetMeanRA()
+      || denseInstances->GetMeanRM() != sparseInstances->GetMeanRM()
+      || denseInstances->GetMeanRN() != sparseInstances->GetMeanRN())
+    {
+    std::cerr << "Hoover scores differ between the dense and the sparse matrices" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -31,6 +31,7 @@
 #include "itkProgressReporter.h"
 
 #include <algorithm>
+#include <vector>
 
 namespace otb
 {
@@ -42,6 +43,13 @@ namespace otb
  *  - P1 and P2 are on different side of the streaming line
  *  - P1 and P2 intersect each other.
  *  - P2 has the largest intersection with P1 among all other polygons Pi intersecting P1.
+ *  The features of the layer are indexed once by streaming line (from their envelopes
+ *  in the input image index space), so that each streaming line only loads its own
+ *  candidates. Each candidate is intersected once with the streaming line, and polygons
+ *  are paired by the overlap of these intervals along the line, which is the length of
+ *  their common boundary on the streaming line. Polygons only touching at a corner on the
+ *  streaming line are paired with a zero overlap, and merged if they are not merged with
+ *  another polygon first.
  *  The \c SetStreamSize() method allows retrieving the number of streams in row and column,
  *  and their pixel coordinates.
  *  The input image is used to transform pixel coordinates of the streaming lines into
@@ -130,6 +138,23 @@ protected:
   {
      bool operator() (FusionStruct f1, FusionStruct f2) { return (f1.overlap > f2.overlap); }
   } SortFeature;
+  /** Feature of the seam index, with its envelope in the input image index space */
+  struct IndexedFeatureStruct
+  {
+     GIntBig fid;
+     double minIndex[2];
+     double maxIndex[2];
+     bool deleted;
+  };
+  /** Interval of a streaming line covered by a candidate polygon */
+  struct SeamIntervalStruct
+  {
+     double start;
+     double end;
+     unsigned int indFeature;
+     bool upper;
+     bool operator<(const SeamIntervalStruct & other) const { return start < other.start; }
+  };
 
   /**
    Main computation method. if line is true process row part, else process column part.
@@ -142,6 +167,20 @@ protected:
    */
   double GetLengthOGRGeometryCollection(OGRGeometryCollection * intersection);
 
+  /** Index all the features of the layer by streaming line */
+  void BuildSeamIndex();
+  /** Add a feature to the seam index */
+  void IndexFeature(GIntBig fid, OGRGeometry const& geometry);
+  /** Range [first, last] of streaming lines (numbered from 1) touched by [minIndex, maxIndex].
+   * If across is true, the streaming lines are orthogonal to the dimension of the range,
+   * else the range is compared to their extent. Returns false if the range is empty. */
+  bool GetSeamRange(double minIndex, double maxIndex, unsigned int streamSize, unsigned int nbStreams,
+                    bool across, unsigned int & first, unsigned int & last) const;
+  /** Append the intervals of a geometry along the streaming line (X coordinates for
+   * horizontal lines, Y coordinates for vertical ones) */
+  void AddSeamIntervals(OGRGeometry const* geometry, bool line, unsigned int indFeature, bool upper,
+                        std::vector<SeamIntervalStruct> & intervals) const;
+
 private:
   OGRLayerStreamStitchingFilter(const Self &);  //purposely not implemented
   void operator =(const Self&);      //purposely not implemented
@@ -150,6 +189,14 @@ private:
   unsigned int m_Radius;
   OGRLayerType m_OGRLayer;
 
+  unsigned int m_NbRowStream;
+  unsigned int m_NbColStream;
+  std::vector<IndexedFeatureStruct> m_IndexedFeatures;
+  /** Indexed features per vertical and horizontal streaming line,
+   * at position (x-1)*m_NbRowStream + (y-1) */
+  std::vector< std::vector<unsigned int> > m_ColumnSeams;
+  std::vector< std::vector<unsigned int> > m_RowSeams;
+
 
 };
 
@@ -27,14 +27,16 @@
 #include <iomanip>
 #include "ogrsf_frmts.h"
 #include "itkTimeProbe.h"
-#include <set>
+#include <map>
+#include <cmath>
 
 namespace otb
 {
 
 template<class TImage>
 OGRLayerStreamStitchingFilter<TImage>
-::OGRLayerStreamStitchingFilter() : m_Radius(2), m_OGRLayer(ITK_NULLPTR, false)
+::OGRLayerStreamStitchingFilter() : m_Radius(2), m_OGRLayer(ITK_NULLPTR, false),
+  m_NbRowStream(0), m_NbColStream(0)
 {
    m_StreamSize.Fill(0);
 }
@@ -102,33 +104,175 @@ OGRLayerStreamStitchingFilter<TInputImage>
     }
   return dfLength;
 }
+template<class TInputImage>
+bool
+OGRLayerStreamStitchingFilter<TInputImage>
+::GetSeamRange(double minIndex, double maxIndex, unsigned int streamSize, unsigned int nbStreams,
+               bool across, unsigned int & first, unsigned int & last) const
+{
+  const double radius = static_cast<double>(m_Radius);
+  const double size = static_cast<double>(streamSize);
+  // streaming line k is at k*streamSize-0.5 across, and covers
+  // [(k-1)*streamSize-0.5, k*streamSize-0.5] along
+  double low = std::ceil((minIndex + 0.5 - radius) / size);
+  double high = std::floor((maxIndex + 0.5 + radius) / size);
+  if (!across)
+    {
+    high += 1.;
+    }
+  low = std::max(low, 1.);
+  high = std::min(high, static_cast<double>(nbStreams));
+  if (low > high)
+    {
+    return false;
+    }
+  first = static_cast<unsigned int>(low);
+  last = static_cast<unsigned int>(high);
+  return true;
+}
+
 template<class TInputImage>
 void
 OGRLayerStreamStitchingFilter<TInputImage>
-::ProcessStreamingLine( bool line, itk::ProgressReporter & progress)
+::IndexFeature(GIntBig fid, OGRGeometry const& geometry)
 {
-   typename InputImageType::ConstPointer inputImage = this->GetInput();
+  typename InputImageType::ConstPointer inputImage = this->GetInput();
+
+  OGREnvelope envelope;
+  geometry.getEnvelope(&envelope);
+  OriginType minPoint;
+  minPoint[0] = envelope.MinX;
+  minPoint[1] = envelope.MinY;
+  OriginType maxPoint;
+  maxPoint[0] = envelope.MaxX;
+  maxPoint[1] = envelope.MaxY;
+  itk::ContinuousIndex<double,2> minIndex;
+  itk::ContinuousIndex<double,2> maxIndex;
+  inputImage->TransformPhysicalPointToContinuousIndex(minPoint, minIndex);
+  inputImage->TransformPhysicalPointToContinuousIndex(maxPoint, maxIndex);
+
+  IndexedFeatureStruct indexed;
+  indexed.fid = fid;
+  indexed.deleted = false;
+  for (unsigned int i = 0; i < 2; ++i)
+    {
+    indexed.minIndex[i] = std::min(minIndex[i], maxIndex[i]);
+    indexed.maxIndex[i] = std::max(minIndex[i], maxIndex[i]);
+    }
+  const unsigned int ind = static_cast<unsigned int>(m_IndexedFeatures.size());
+  m_IndexedFeatures.push_back(indexed);
 
-   //compute the number of stream division in row and column
-   SizeType imageSize = this->GetInput()->GetLargestPossibleRegion().GetSize();
-   unsigned int nbRowStream = static_cast<unsigned int>(imageSize[1] / m_StreamSize[1] + 1);
-   unsigned int nbColStream = static_cast<unsigned int>(imageSize[0] / m_StreamSize[0] + 1);
+  unsigned int firstX, lastX, firstY, lastY;
+  // vertical streaming lines
+  if (GetSeamRange(indexed.minIndex[0], indexed.maxIndex[0], m_StreamSize[0], m_NbColStream, true, firstX, lastX)
+      && GetSeamRange(indexed.minIndex[1], indexed.maxIndex[1], m_StreamSize[1], m_NbRowStream, false, firstY, lastY))
+    {
+    for (unsigned int x = firstX; x <= lastX; x++)
+      {
+      for (unsigned int y = firstY; y <= lastY; y++)
+        {
+        m_ColumnSeams[(x-1)*m_NbRowStream + (y-1)].push_back(ind);
+        }
+      }
+    }
+  // horizontal streaming lines
+  if (GetSeamRange(indexed.minIndex[0], indexed.maxIndex[0], m_StreamSize[0], m_NbColStream, false, firstX, lastX)
+      && GetSeamRange(indexed.minIndex[1], indexed.maxIndex[1], m_StreamSize[1], m_NbRowStream, true, firstY, lastY))
+    {
+    for (unsigned int x = firstX; x <= lastX; x++)
+      {
+      for (unsigned int y = firstY; y <= lastY; y++)
+        {
+        m_RowSeams[(x-1)*m_NbRowStream + (y-1)].push_back(ind);
+        }
+      }
+    }
+}
 
-   /*unsigned long startReporter;
-   unsigned long stopReporter;
-   if (!line)
-   {
-     startReporter = 0;
-     stopReporter = 50;
-   }
-   else
-   {
-     startReporter = 50;
-     stopReporter = 100;
-   }
-   itk::ProgressReporter progress(this,0,2*nbRowStream*nbColStream,100,startReporter); */
+template<class TInputImage>
+void
+OGRLayerStreamStitchingFilter<TInputImage>
+::BuildSeamIndex()
+{
+  m_IndexedFeatures.clear();
+  m_ColumnSeams.assign(m_NbColStream * m_NbRowStream, std::vector<unsigned int>());
+  m_RowSeams.assign(m_NbColStream * m_NbRowStream, std::vector<unsigned int>());
+
+  m_OGRLayer.SetSpatialFilter(ITK_NULLPTR);
+  OGRLayerType::const_iterator featIt = m_OGRLayer.begin();
+  for(; featIt!=m_OGRLayer.end(); ++featIt)
+    {
+    OGRGeometry const* geometry = (*featIt).GetGeometry();
+    if (geometry)
+      {
+      this->IndexFeature((*featIt).GetFID(), *geometry);
+      }
+    }
+}
 
-   for(unsigned int x=1; x<=nbColStream; x++)
+template<class TInputImage>
+void
+OGRLayerStreamStitchingFilter<TInputImage>
+::AddSeamIntervals(OGRGeometry const* geometry, bool line, unsigned int indFeature, bool upper,
+                   std::vector<SeamIntervalStruct> & intervals) const
+{
+  switch( wkbFlatten(geometry->getGeometryType()) )
+    {
+    case wkbLinearRing:
+    case wkbLineString:
+    {
+    OGRLineString const* lineString = dynamic_cast<OGRLineString const*>(geometry);
+    for (int i = 1; i < lineString->getNumPoints(); i++)
+      {
+      SeamIntervalStruct interval;
+      interval.start = line ? lineString->getX(i-1) : lineString->getY(i-1);
+      interval.end = line ? lineString->getX(i) : lineString->getY(i);
+      if (interval.start > interval.end)
+        {
+        std::swap(interval.start, interval.end);
+        }
+      interval.indFeature = indFeature;
+      interval.upper = upper;
+      intervals.push_back(interval);
+      }
+    break;
+    }
+    case wkbPoint:
+    {
+    // a single contact point with the streaming line (polygon corner)
+    OGRPoint const* point = dynamic_cast<OGRPoint const*>(geometry);
+    SeamIntervalStruct interval;
+    interval.start = line ? point->getX() : point->getY();
+    interval.end = interval.start;
+    interval.indFeature = indFeature;
+    interval.upper = upper;
+    intervals.push_back(interval);
+    break;
+    }
+    case wkbMultiPoint:
+    case wkbMultiLineString:
+    case wkbGeometryCollection:
+    {
+    OGRGeometryCollection * collection = dynamic_cast<OGRGeometryCollection *>(const_cast<OGRGeometry *>(geometry));
+    for (int iGeom = 0; iGeom < collection->getNumGeometries(); iGeom++)
+      {
+      AddSeamIntervals(collection->getGeometryRef(iGeom), line, indFeature, upper, intervals);
+      }
+    break;
+    }
+    default:
+      break;
+    }
+}
+
+template<class TInputImage>
+void
+OGRLayerStreamStitchingFilter<TInputImage>
+::ProcessStreamingLine( bool line, itk::ProgressReporter & progress)
+{
+   typename InputImageType::ConstPointer inputImage = this->GetInput();
+
+   for(unsigned int x=1; x<=m_NbColStream; x++)
    {
    OGRErr errStart = m_OGRLayer.ogr().StartTransaction();
 
@@ -137,13 +281,14 @@ OGRLayerStreamStitchingFilter<TInputImage>
      itkExceptionMacro(<< "Unable to start transaction for OGR layer " << m_OGRLayer.ogr().GetName() << ".");
      }
 
-      for(unsigned int y=1; y<=nbRowStream; y++)
+      for(unsigned int y=1; y<=m_NbRowStream; y++)
       {
 
         //Compute Stream line
         OGRLineString streamLine;
         itk::ContinuousIndex<double,2> startIndex;
         itk::ContinuousIndex<double,2> endIndex;
+        double seamIndex;
         if(!line)
         {
           // Treat vertical stream line
@@ -151,6 +296,7 @@ OGRLayerStreamStitchingFilter<TInputImage>
           startIndex[1] = static_cast<double>(m_StreamSize[1] * (y-1)) - 0.5;
           endIndex = startIndex;
           endIndex[1] += static_cast<double>(m_StreamSize[1]);
+          seamIndex = startIndex[0];
         }
         else
         {  // Treat horizontal stream line
@@ -158,6 +304,7 @@ OGRLayerStreamStitchingFilter<TInputImage>
           startIndex[1] = static_cast<double>(m_StreamSize[1] * y) - 0.5;
           endIndex = startIndex;
           endIndex[0] += static_cast<double>(m_StreamSize[0]);
+          seamIndex = startIndex[1];
         }
         OriginType  startPoint;
         inputImage->TransformContinuousIndexToPhysicalPoint(startIndex, startPoint);
@@ -166,151 +313,133 @@ OGRLayerStreamStitchingFilter<TInputImage>
         streamLine.addPoint(startPoint[0], startPoint[1]);
         streamLine.addPoint(endPoint[0], endPoint[1]);
 
+        //Compute the upper/left stream area along the line
+        IndexType  UpperLeftCorner;
+        IndexType  LowerRightCorner;
+        if(!line)
+        {
+          UpperLeftCorner[0] = x*m_StreamSize[0] - 1 - m_Radius;
+          UpperLeftCorner[1] = m_StreamSize[1]*(y-1);
+          LowerRightCorner[0] = m_StreamSize[0]*x - 1;
+          LowerRightCorner[1] = m_StreamSize[1]*y - 1;
+        }
+        else
+        {
+          UpperLeftCorner[0] = (x-1)*m_StreamSize[0];
+          UpperLeftCorner[1] = m_StreamSize[1]*y - 1 - m_Radius;
+          LowerRightCorner[0] = m_StreamSize[0]*x - 1;
+          LowerRightCorner[1] = m_StreamSize[1]*y - 1; //-1 to stop just before stream line
+        }
+        OriginType  ulCorner;
+        inputImage->TransformIndexToPhysicalPoint(UpperLeftCorner, ulCorner);
+        OriginType  lrCorner;
+        inputImage->TransformIndexToPhysicalPoint(LowerRightCorner, lrCorner);
+        OGRLinearRing upperRing;
+        upperRing.addPoint(ulCorner[0], ulCorner[1]);
+        upperRing.addPoint(lrCorner[0], ulCorner[1]);
+        upperRing.addPoint(lrCorner[0], lrCorner[1]);
+        upperRing.addPoint(ulCorner[0], lrCorner[1]);
+        upperRing.closeRings();
+        OGRPolygon upperArea;
+        upperArea.addRing(&upperRing);
+
+        //Load the indexed features of the streaming line and their intervals along it.
+        //A feature lying on both sides of the line belongs to the upper/left stream
+        //if it intersects the upper/left stream area.
+        const std::vector<unsigned int> & candidates = line ? m_RowSeams[(x-1)*m_NbRowStream + (y-1)]
+                                                          : m_ColumnSeams[(x-1)*m_NbRowStream + (y-1)];
+        const unsigned int dim = line ? 1 : 0;
 
-        //First we get all the feature that intersect the streaming line of the Upper/left stream
          std::vector<FeatureStruct> upperStreamFeatureList;
-         upperStreamFeatureList.clear();
-         IndexType  UpperLeftCorner;
-         IndexType  LowerRightCorner;
-
-         if(!line)
-         {
-            // Treat Row stream
-            //Compute the spatial filter of the upper stream
-            UpperLeftCorner[0] = x*m_StreamSize[0] - 1 - m_Radius;
-            UpperLeftCorner[1] = m_StreamSize[1]*(y-1);
-
-            LowerRightCorner[0] = m_StreamSize[0]*x - 1;
-            LowerRightCorner[1] = m_StreamSize[1]*y - 1;
-         }
-         else
-         {  // Treat Column stream
-            //Compute the spatial filter of the left stream
-            UpperLeftCorner[0] = (x-1)*m_StreamSize[0];
-            UpperLeftCorner[1] = m_StreamSize[1]*y - 1 - m_Radius;
-
-            LowerRightCorner[0] = m_StreamSize[0]*x - 1;
-            LowerRightCorner[1] = m_StreamSize[1]*y - 1; //-1 to stop just before stream line
-         }
-
-         OriginType  ulCorner;
-         inputImage->TransformIndexToPhysicalPoint(UpperLeftCorner, ulCorner);
-         OriginType  lrCorner;
-         inputImage->TransformIndexToPhysicalPoint(LowerRightCorner, lrCorner);
-
-         m_OGRLayer.SetSpatialFilterRect(ulCorner[0],lrCorner[1],lrCorner[0],ulCorner[1]);
+         std::vector<FeatureStruct> lowerStreamFeatureList;
+         std::vector<unsigned int> upperIndexedList;
+         std::vector<unsigned int> lowerIndexedList;
+         std::vector<SeamIntervalStruct> intervals;
 
-        std::set<unsigned int> upperFIDs;
-         OGRLayerType::const_iterator featIt = m_OGRLayer.begin();
-         for(; featIt!=m_OGRLayer.end(); ++featIt)
+         for(unsigned int c=0; c<candidates.size(); c++)
          {
+            const IndexedFeatureStruct & indexed = m_IndexedFeatures[candidates[c]];
+            if (indexed.deleted)
+            {
+              continue;
+            }
             FeatureStruct s(m_OGRLayer.GetLayerDefn());
-            s.feat = *featIt;
+            s.feat = m_OGRLayer.GetFeature(indexed.fid);
             s.fusioned = false;
-            upperStreamFeatureList.push_back(s);
-           upperFIDs.insert((*featIt).GetFID());
-         }
-
-         //Do the same thing for the lower/right stream
-         std::vector<FeatureStruct> lowerStreamFeatureList;
-         lowerStreamFeatureList.clear();
-
-         if(!line)
-         {
-            //Compute the spatial filter of the lower stream
-            UpperLeftCorner[0] = x*m_StreamSize[0];
-            UpperLeftCorner[1] = m_StreamSize[1]*(y-1);
+            OGRGeometry const* geometry = s.feat.GetGeometry();
+            if (!geometry)
+            {
+              continue;
+            }
 
-            LowerRightCorner[0] = m_StreamSize[0]*x + m_Radius;
-            LowerRightCorner[1] = m_StreamSize[1]*y - 1;
-         }
-         else
-         {
-            //Compute the spatial filter of the right stream
-            UpperLeftCorner[0] = (x-1)*m_StreamSize[0];
-            UpperLeftCorner[1] = m_StreamSize[1]*y;
+            bool upper = indexed.minIndex[dim] < seamIndex - 0.25;
+            if (upper && indexed.maxIndex[dim] > seamIndex + 0.25)
+            {
+              upper = ogr::Intersects(*geometry, upperArea);
+            }
+            ogr::UniqueGeometryPtr footprint = ogr::Intersection(*geometry, streamLine);
+            if (!footprint)
+            {
+              continue;
+            }
 
-            LowerRightCorner[0] = m_StreamSize[0]*x - 1;
-            LowerRightCorner[1] = m_StreamSize[1]*y + m_Radius;
+            std::vector<FeatureStruct> & featureList = upper ? upperStreamFeatureList : lowerStreamFeatureList;
+            const size_t nbIntervals = intervals.size();
+            AddSeamIntervals(footprint.get(), line, static_cast<unsigned int>(featureList.size()), upper, intervals);
+            if (intervals.size() > nbIntervals)
+            {
+              featureList.push_back(s);
+              (upper ? upperIndexedList : lowerIndexedList).push_back(candidates[c]);
+            }
          }
 
-         inputImage->TransformIndexToPhysicalPoint(UpperLeftCorner, ulCorner);
-         inputImage->TransformIndexToPhysicalPoint(LowerRightCorner, lrCorner);
-
-         m_OGRLayer.SetSpatialFilterRect(ulCorner[0],lrCorner[1],lrCorner[0],ulCorner[1]);
-
-         for(featIt = m_OGRLayer.begin(); featIt!=m_OGRLayer.end(); ++featIt)
+         //Sweep the intervals along the line to get the length shared by each upper/lower pair.
+         //Intervals are closed, so that polygons only touching at a corner on the line are
+         //paired with a zero overlap, as when comparing the polygons themselves.
+         std::sort(intervals.begin(), intervals.end());
+         std::map<std::pair<unsigned int, unsigned int>, double> overlaps;
+         std::vector<unsigned int> active;
+         for(unsigned int i=0; i<intervals.size(); i++)
          {
-            if(upperFIDs.find((*featIt).GetFID()) == upperFIDs.end())
-           {
-             FeatureStruct s(m_OGRLayer.GetLayerDefn());
-             s.feat = *featIt;
-             s.fusioned = false;
-             lowerStreamFeatureList.push_back(s);
-           }
+            const SeamIntervalStruct & current = intervals[i];
+            unsigned int nbActive = 0;
+            for(unsigned int a=0; a<active.size(); a++)
+            {
+               const SeamIntervalStruct & previous = intervals[active[a]];
+               if (previous.end < current.start)
+               {
+                 continue;
+               }
+               active[nbActive++] = active[a];
+               if (previous.upper != current.upper)
+               {
+                 const double overlap = std::min(previous.end, current.end) - current.start;
+                 if (current.upper)
+                 {
+                   overlaps[std::make_pair(current.indFeature, previous.indFeature)] += overlap;
+                 }
+                 else
+                 {
+                   overlaps[std::make_pair(previous.indFeature, current.indFeature)] += overlap;
+                 }
+               }
+            }
+            active.resize(nbActive);
+            active.push_back(i);
          }
 
-         unsigned int nbUpperPolygons = upperStreamFeatureList.size();
-         unsigned int nbLowerPolygons = lowerStreamFeatureList.size();
          std::vector<FusionStruct> fusionList;
-         fusionList.clear();
-         for(unsigned int u=0; u<nbUpperPolygons; u++)
+         for(std::map<std::pair<unsigned int, unsigned int>, double>::const_iterator it = overlaps.begin();
+             it != overlaps.end(); ++it)
          {
-            for(unsigned int l=0; l<nbLowerPolygons; l++)
-            {
-               FeatureStruct upper = upperStreamFeatureList[u];
-               FeatureStruct lower = lowerStreamFeatureList[l];
-              if (!(upper.feat == lower.feat))
-              {
-                if (ogr::Intersects(*upper.feat.GetGeometry(), *lower.feat.GetGeometry()))
-                {
-                    ogr::UniqueGeometryPtr intersection2 = ogr::Intersection(*upper.feat.GetGeometry(),*lower.feat.GetGeometry());
-                    ogr::UniqueGeometryPtr intersection = ogr::Intersection(*intersection2, streamLine);
-                    //ogr::UniqueGeometryPtr intersection = ogr::Intersection(*upper.feat.GetGeometry(),*lower.feat.GetGeometry());
-                    if (intersection)
-                    {
-                     FusionStruct fusion;
-                     fusion.indStream1 = u;
-                     fusion.indStream2 = l;
-                     fusion.overlap = 0.;
-
-                     if(intersection->getGeometryType() == wkbPolygon)
-                     {
-                         fusion.overlap = dynamic_cast<OGRPolygon *>(intersection.get())->get_Area();
-                     }
-                     else if(intersection->getGeometryType() == wkbMultiPolygon)
-                     {
-                         fusion.overlap = dynamic_cast<OGRMultiPolygon *>(intersection.get())->get_Area();
-                     }
-                     else if(intersection->getGeometryType() == wkbGeometryCollection)
-                     {
-                         fusion.overlap = dynamic_cast<OGRGeometryCollection *>(intersection.get())->get_Area();
-                     }
-                     else if(intersection->getGeometryType() == wkbLineString)
-                     {
-                         fusion.overlap = dynamic_cast<OGRLineString *>(intersection.get())->get_Length();
-                     }
-                     else if (intersection->getGeometryType() == wkbMultiLineString)
-                     {
-                         #if(GDAL_VERSION_NUM < 1800)
-                     fusion.overlap = GetLengthOGRGeometryCollection(dynamic_cast<OGRGeometryCollection *> (intersection.get()));
-                         #else
-                     fusion.overlap = dynamic_cast<OGRMultiLineString *>(intersection.get())->get_Length();
-                         #endif
-                    }
-
-                     /** -Wunused-variable
-                     long upperFID = upper.feat.GetFID();
-                     long lowerFID = lower.feat.GetFID();
-                     **/
-                     fusionList.push_back(fusion);
-                    }
-                }
-              }
-            }
+            FusionStruct fusion;
+            fusion.indStream1 = it->first.first;
+            fusion.indStream2 = it->first.second;
+            fusion.overlap = it->second;
+            fusionList.push_back(fusion);
          }
          unsigned int fusionListSize = fusionList.size();
-         std::sort(fusionList.begin(),fusionList.end(),SortFeature);
+         std::stable_sort(fusionList.begin(),fusionList.end(),SortFeature);
          for(unsigned int i=0; i<fusionListSize; i++)
          {
             FeatureStruct upper = upperStreamFeatureList.at(fusionList.at(i).indStream1);
@@ -348,6 +477,15 @@ OGRLayerStreamStitchingFilter<TInputImage>
                  m_OGRLayer.CreateFeature(fusionFeature);
                  m_OGRLayer.DeleteFeature(lower.feat.GetFID());
                  m_OGRLayer.DeleteFeature(upper.feat.GetFID());
+
+                 //Update the seam index so that the fused polygon can be merged again on
+                 //the next streaming lines
+                 m_IndexedFeatures[upperIndexedList[fusionList[i].indStream1]].deleted = true;
+                 m_IndexedFeatures[lowerIndexedList[fusionList[i].indStream2]].deleted = true;
+                 if (fusionFeature.GetFID() != OGRNullFID && fusionPolygon)
+                   {
+                   this->IndexFeature(fusionFeature.GetFID(), *fusionPolygon);
+                   }
                  }
                catch(itk::ExceptionObject& err)
                  {
@@ -398,15 +536,23 @@ OGRLayerStreamStitchingFilter<TImage>
 
   //compute the number of stream division in row and column
    SizeType imageSize = this->GetInput()->GetLargestPossibleRegion().GetSize();
-   unsigned int nbRowStream = static_cast<unsigned int>(imageSize[1] / m_StreamSize[1] + 1);
-   unsigned int nbColStream = static_cast<unsigned int>(imageSize[0] / m_StreamSize[0] + 1);
+   m_NbRowStream = static_cast<unsigned int>(imageSize[1] / m_StreamSize[1] + 1);
+   m_NbColStream = static_cast<unsigned int>(imageSize[0] / m_StreamSize[0] + 1);
+
+   //Index the features of the layer by streaming line, in a single scan
+   this->BuildSeamIndex();
 
-   itk::ProgressReporter progress(this,0,2*nbRowStream*nbColStream,100,0);
+   itk::ProgressReporter progress(this,0,2*m_NbRowStream*m_NbColStream,100,0);
    //Process column
    this->ProcessStreamingLine(false, progress);
    //Process row
    this->ProcessStreamingLine(true, progress);
 
+   //Release the seam index
+   m_IndexedFeatures.clear();
+   m_ColumnSeams.clear();
+   m_RowSeams.clear();
+
    this->InvokeEvent(itk::EndEvent());
 }
 
@@ -23,6 +23,8 @@
 #include "otbImage.h"
 #include "otbImageFileReader.h"
 #include "itksys/SystemTools.hxx"
+#include "ogr_geometry.h"
+#include <cmath>
 
 int otbOGRLayerStreamStitchingFilter(int argc, char * argv[])
 {
@@ -92,3 +94,97 @@ int otbOGRLayerStreamStitchingFilter(int argc, char * argv[])
 
   return EXIT_SUCCESS;
 }
+
+namespace
+{
+/** Add a rectangle feature, given in pixel boundary coordinates, to the layer */
+void AddRectangle(otb::ogr::Layer & layer, int label, double x0, double y0, double x1, double y1)
+{
+  OGRLinearRing ring;
+  ring.addPoint(x0, y0);
+  ring.addPoint(x1, y0);
+  ring.addPoint(x1, y1);
+  ring.addPoint(x0, y1);
+  ring.closeRings();
+  OGRPolygon polygon;
+  polygon.addRing(&ring);
+
+  otb::ogr::Feature feature(layer.GetLayerDefn());
+  feature[0].SetValue(label);
+  feature.SetGeometry(&polygon);
+  layer.CreateFeature(feature);
+}
+}
+
+int otbOGRLayerStreamStitchingFilterCorner(int itkNotUsed(argc), char * itkNotUsed(argv) [])
+{
+  const unsigned int Dimension = 2;
+  typedef float PixelType;
+  typedef otb::Image<PixelType, Dimension> ImageType;
+  typedef otb::OGRLayerStreamStitchingFilter<ImageType>   FilterType;
+
+  // 20x20 image with unit spacing, streamed by 10x10 tiles: the vertical
+  // streaming line is x = 9.5 and the horizontal one is y = 9.5
+  ImageType::Pointer image = ImageType::New();
+  ImageType::RegionType region;
+  region.GetModifiableSize().Fill(20);
+  image->SetRegions(region);
+  image->Allocate();
+  image->FillBuffer(0);
+
+  otb::ogr::DataSource::Pointer ogrDS = otb::ogr::DataSource::New();
+  otb::ogr::Layer layer = ogrDS->CreateLayer("corner", ITK_NULLPTR, wkbPolygon);
+  OGRFieldDefn labelField("label", OFTInteger);
+  layer.CreateField(labelField);
+
+  // 1 and 2 only touch at the corner (9.5, 4.5), on the vertical streaming line
+  AddRectangle(layer, 1, 5.5, -0.5, 9.5, 4.5);
+  AddRectangle(layer, 2, 9.5, 4.5, 13.5, 8.5);
+  // 3 and 4 are on both sides of the vertical streaming line, but do not touch
+  AddRectangle(layer, 3, 5.5, 10.5, 9.5, 12.5);
+  AddRectangle(layer, 4, 9.5, 13.5, 13.5, 15.5);
+
+  ImageType::SizeType streamSize;
+  streamSize.Fill(10);
+
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetInput(image);
+  filter->SetOGRLayer(layer);
+  filter->SetStreamSize(streamSize);
+  filter->GenerateData();
+
+  const int nbFeatures = layer.GetFeatureCount(true);
+  if (nbFeatures != 3)
+    {
+    std::cerr << "Expected 3 features after stitching, got " << nbFeatures << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  bool found = false;
+  for (otb::ogr::Layer::const_iterator featIt = layer.begin(); featIt != layer.end(); ++featIt)
+    {
+    const int label = (*featIt)[0].GetValue<int>();
+    if (label == 2)
+      {
+      std::cerr << "Polygon 2, touching polygon 1 at a corner, has not been merged" << std::endl;
+      return EXIT_FAILURE;
+      }
+    if (label == 1)
+      {
+      found = true;
+      OGRMultiPolygon const* merged = dynamic_cast<OGRMultiPolygon const*>((*featIt).GetGeometry());
+      if (!merged || merged->getNumGeometries() != 2 || std::abs(merged->get_Area() - 36.) > 1e-9)
+        {
+        std::cerr << "Polygon 1 is not the union of polygons 1 and 2" << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+  if (!found)
+    {
+    std::cerr << "Merged polygon with label 1 not found" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,406 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef otbStreamingWatershedImageFilter_h
+#define otbStreamingWatershedImageFilter_h
+
+#include "otbPersistentImageFilter.h"
+#include "otbPersistentFilterStreamingDecorator.h"
+#include "itkMultiThreader.h"
+#include <vector>
+
+namespace otb
+{
+
+/** \class PersistentWatershedImageFilter
+ * \brief First pass of a watershed segmentation of a large image, using streaming
+ *
+ * The image is divided in a regular grid of blocks (see SetBlockSize()), which
+ * does not depend on the streaming layout. The catchment basins of each block
+ * are computed on their own by priority-queue flooding (4-connectivity) from
+ * the regional minima of the block. A block is flooded by the stream which
+ * contains its first pixel, and the blocks of a stream are flooded in
+ * parallel. Only the minimum of each basin, the pass values between adjacent
+ * basins, and the labels and values of the block borders are kept.
+ *
+ * In Synthetize(), the basins adjacent across block borders are linked with a
+ * pass value equal to the highest of the two border pixels, and all the basins
+ * are merged with a union-find in increasing order of pass values (Kruskal).
+ * Each merge is recorded with its saliency: the depth, below the pass, of the
+ * shallower of the two merged basins. Minima created by the block borders have
+ * a null saliency and always disappear. The segmentation at a given flood
+ * level (see ComputeLabelTable()) is then obtained from this hierarchy,
+ * without flooding the image again.
+ *
+ * Threshold and flood levels are given as fractions of the depth of the image
+ * (maximum minus minimum value), as for itk::WatershedImageFilter. The
+ * threshold is applied in Synthetize(): values below it are considered equal.
+ * The merge tree is built from the basin dynamics (pass minus the higher of
+ * the two minima) instead of the segment tree of itk::WatershedImageFilter, so
+ * the segmentations at a given level are close to, but not identical with,
+ * the ones of itk::WatershedImageFilter.
+ *
+ * Basins are the same whatever the streaming layout, but the watershed lines
+ * near block borders may differ slightly from the ones of a flooding of the
+ * whole image.
+ *
+ * The label image is produced by WatershedLabelImageFilter, which floods the
+ * blocks again and applies the global label table.
+ *
+ * This filter only handles 2D scalar images.
+ *
+ * \sa WatershedLabelImageFilter
+ * \sa PersistentImageFilter
+ * \ingroup Streamed
+ * \ingroup Multithreaded
+ *
+ * \ingroup OTBWatersheds
+ */
+template<class TInputImage>
+class ITK_EXPORT PersistentWatershedImageFilter :
+  public PersistentImageFilter<TInputImage, TInputImage>
+{
+public:
+  /** Standard Self typedef */
+  typedef PersistentWatershedImageFilter                  Self;
+  typedef PersistentImageFilter<TInputImage, TInputImage> Superclass;
+  typedef itk::SmartPointer<Self>                         Pointer;
+  typedef itk::SmartPointer<const Self>                   ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Runtime information support. */
+  itkTypeMacro(PersistentWatershedImageFilter, PersistentImageFilter);
+
+  /** Image related typedefs. */
+  typedef TInputImage                             ImageType;
+  typedef typename TInputImage::RegionType        RegionType;
+  typedef typename TInputImage::SizeType          SizeType;
+  typedef typename TInputImage::IndexType         IndexType;
+  typedef typename TInputImage::PixelType         PixelType;
+
+  itkStaticConstMacro(InputImageDimension, unsigned int, TInputImage::ImageDimension);
+
+  /** Label typedefs */
+  typedef unsigned int                            LabelType;
+  typedef std::vector<LabelType>                  LabelVectorType;
+  typedef std::vector<double>                     ValueVectorType;
+
+  /** Smart Pointer type to a DataObject. */
+  typedef typename itk::DataObject::Pointer       DataObjectPointer;
+  typedef itk::ProcessObject::DataObjectPointerArraySizeType DataObjectPointerArraySizeType;
+
+  /** Set/Get the threshold, as a fraction of the image depth (default is 0) */
+  itkSetMacro(Threshold, double);
+  itkGetMacro(Threshold, double);
+
+  /** Set/Get the size of the flooding blocks (default is 256x256) */
+  itkSetMacro(BlockSize, SizeType);
+  itkGetConstReferenceMacro(BlockSize, SizeType);
+
+  /** Number of basins before merging. Valid after Synthetize(). */
+  LabelType GetNumberOfBasins() const
+  {
+    return m_NumberOfBasins;
+  }
+
+  /** Minimum and maximum values of the image. Valid after Synthetize(). */
+  itkGetConstMacro(MinimumValue, double);
+  itkGetConstMacro(MaximumValue, double);
+
+  /** Compute the global label of each basin at a flood level (fraction of
+   *  the image depth). Labels start at 1, in the order of the first block of
+   *  the objects. Returns the number of objects. Valid after Synthetize(). */
+  LabelType ComputeLabelTable(double level, LabelVectorType & table) const;
+
+  /** Global label of a basin of a block, given a label table */
+  LabelType GetGlobalLabel(const LabelVectorType & table, unsigned int blockId, LabelType localLabel) const
+  {
+    return localLabel == 0 ? 0 : table[m_BlockOffsets[blockId] + localLabel];
+  }
+
+  /** Region of a block */
+  RegionType GetBlockRegion(unsigned int blockId) const;
+
+  /** Blocks intersecting a region. If startingIn is true, only the blocks
+   *  whose first pixel is in the region are returned. */
+  void GetBlocks(const RegionType & region, bool startingIn, std::vector<unsigned int> & blocks) const;
+
+  /** Flood a region from its regional minima. Basins are numbered from 1 in
+   *  the order of the first pixel of their minimum. The values of the region
+   *  and the minimum of each basin are returned. Returns the number of
+   *  basins. */
+  static LabelType FloodRegion(const ImageType * image, const RegionType & region,
+                               LabelVectorType & labels, ValueVectorType & values,
+                               ValueVectorType & minima);
+
+  /** Make a DataObject of the correct type to be used as the specified
+   * output.
+   */
+  DataObjectPointer MakeOutput(DataObjectPointerArraySizeType idx) ITK_OVERRIDE;
+  using Superclass::MakeOutput;
+
+  void AllocateOutputs() ITK_OVERRIDE;
+  void GenerateOutputInformation() ITK_OVERRIDE;
+  void GenerateInputRequestedRegion() ITK_OVERRIDE;
+  void Synthetize(void) ITK_OVERRIDE;
+  void Reset(void) ITK_OVERRIDE;
+
+protected:
+  PersistentWatershedImageFilter();
+  ~PersistentWatershedImageFilter() ITK_OVERRIDE {}
+  void PrintSelf(std::ostream& os, itk::Indent indent) const ITK_OVERRIDE;
+
+  /** Flood the blocks starting in the requested region, in parallel */
+  void GenerateData() ITK_OVERRIDE;
+
+private:
+  PersistentWatershedImageFilter(const Self &); //purposely not implemented
+  void operator =(const Self&); //purposely not implemented
+
+  /** Link between two adjacent basins */
+  struct EdgeStruct
+  {
+    EdgeStruct() : First(0), Second(0), Pass(0.) {}
+    EdgeStruct(LabelType first, LabelType second, double pass) : First(first), Second(second), Pass(pass) {}
+    LabelType First;
+    LabelType Second;
+    double    Pass;
+    bool operator<(const EdgeStruct & other) const
+    {
+      if (Pass != other.Pass)
+        {
+        return Pass < other.Pass;
+        }
+      if (First != other.First)
+        {
+        return First < other.First;
+        }
+      return Second < other.Second;
+    }
+  };
+
+  /** Order of the links by labels, then by pass value */
+  static bool CompareEdgeLabels(const EdgeStruct & edge1, const EdgeStruct & edge2)
+  {
+    if (edge1.First != edge2.First)
+      {
+      return edge1.First < edge2.First;
+      }
+    if (edge1.Second != edge2.Second)
+      {
+      return edge1.Second < edge2.Second;
+      }
+    return edge1.Pass < edge2.Pass;
+  }
+
+  /** Pixel waiting in the flooding queue. The lowest value, then the first
+   *  queued pixel, has the highest priority. */
+  struct FloodPixelStruct
+  {
+    double        Value;
+    unsigned long Order;
+    unsigned long Position;
+    LabelType     Label;
+    bool operator<(const FloodPixelStruct & other) const
+    {
+      if (Value != other.Value)
+        {
+        return Value > other.Value;
+        }
+      return Order > other.Order;
+    }
+  };
+
+  /** Positions of the 4-connected neighbours of a pixel in a region of the
+   *  given size. Returns the number of neighbours. */
+  static unsigned int GetNeighbours(unsigned long pos, unsigned long width, unsigned long height,
+                                    unsigned long * neighbours)
+  {
+    unsigned int nb = 0;
+    const unsigned long x = pos % width;
+    if (x > 0)
+      {
+      neighbours[nb++] = pos - 1;
+      }
+    if (x + 1 < width)
+      {
+      neighbours[nb++] = pos + 1;
+      }
+    if (pos >= width)
+      {
+      neighbours[nb++] = pos - width;
+      }
+    if (pos + width < width * height)
+      {
+      neighbours[nb++] = pos + width;
+      }
+    return nb;
+  }
+
+  /** Merge of the hierarchy */
+  struct MergeStruct
+  {
+    LabelType First;
+    LabelType Second;
+    double    Saliency;
+  };
+
+  /** What is kept from the flooding of a block */
+  struct BlockStruct
+  {
+    BlockStruct() : Processed(false), NumberOfBasins(0), MinimumValue(0.), MaximumValue(0.) {}
+    bool                        Processed;
+    LabelType                   NumberOfBasins;
+    double                      MinimumValue;
+    double                      MaximumValue;
+    /** Minimum of each basin */
+    ValueVectorType             Minima;
+    /** Links between the basins of the block (local labels) */
+    std::vector<EdgeStruct>     Edges;
+    /** Labels and values of the first and last rows and columns */
+    LabelVectorType             TopLabels;
+    LabelVectorType             BottomLabels;
+    LabelVectorType             LeftLabels;
+    LabelVectorType             RightLabels;
+    ValueVectorType             TopValues;
+    ValueVectorType             BottomValues;
+    ValueVectorType             LeftValues;
+    ValueVectorType             RightValues;
+  };
+
+  /** Structure passed to the threads */
+  struct ThreadStruct
+  {
+    Self *                      Filter;
+    std::vector<unsigned int>   Blocks;
+    std::vector<std::string>    Errors;
+  };
+
+  static ITK_THREAD_RETURN_TYPE ThreaderCallback(void *arg);
+
+  /** Flood a block and keep its basins and borders */
+  void ProcessBlock(unsigned int blockId);
+
+  /** Find the root of a label, with path halving */
+  static LabelType FindRoot(LabelVectorType & parents, LabelType label)
+  {
+    while (parents[label] != label)
+      {
+      parents[label] = parents[parents[label]];
+      label = parents[label];
+      }
+    return label;
+  }
+
+  double                      m_Threshold;
+  SizeType                    m_BlockSize;
+  unsigned int                m_GridSize[2];
+  RegionType                  m_LargestRegion;
+  std::vector<BlockStruct>    m_Blocks;
+  std::vector<LabelType>      m_BlockOffsets;
+  LabelType                   m_NumberOfBasins;
+  double                      m_MinimumValue;
+  double                      m_MaximumValue;
+  std::vector<MergeStruct>    m_Merges;
+
+}; // end of class PersistentWatershedImageFilter
+
+/**===========================================================================*/
+
+/** \class StreamingWatershedImageFilter
+ * \brief This class streams the whole input image through the PersistentWatershedImageFilter.
+ *
+ * It calls the Reset() method of the PersistentWatershedImageFilter before
+ * streaming the image and the Synthetize() method after having streamed the
+ * image. The internal filter can then be given to a WatershedLabelImageFilter
+ * to produce the label image, at any flood level.
+ *
+ * \sa PersistentWatershedImageFilter
+ * \sa WatershedLabelImageFilter
+ * \sa PersistentFilterStreamingDecorator
+ * \ingroup Streamed
+ * \ingroup Multithreaded
+ *
+ * \ingroup OTBWatersheds
+ */
+template<class TInputImage>
+class ITK_EXPORT StreamingWatershedImageFilter :
+  public PersistentFilterStreamingDecorator<PersistentWatershedImageFilter<TInputImage> >
+{
+public:
+  /** Standard Self typedef */
+  typedef StreamingWatershedImageFilter Self;
+  typedef PersistentFilterStreamingDecorator
+  <PersistentWatershedImageFilter<TInputImage> > Superclass;
+  typedef itk::SmartPointer<Self>       Pointer;
+  typedef itk::SmartPointer<const Self> ConstPointer;
+
+  /** Type macro */
+  itkNewMacro(Self);
+
+  /** Creation through object factory macro */
+  itkTypeMacro(StreamingWatershedImageFilter, PersistentFilterStreamingDecorator);
+
+  typedef TInputImage                                 InputImageType;
+  typedef typename Superclass::FilterType             InternalFilterType;
+  typedef typename InternalFilterType::LabelType      LabelType;
+
+  using Superclass::SetInput;
+  void SetInput(InputImageType * input)
+  {
+    this->GetFilter()->SetInput(input);
+  }
+  const InputImageType * GetInput()
+  {
+    return this->GetFilter()->GetInput();
+  }
+
+  /** Set the threshold, as a fraction of the image depth */
+  void SetThreshold(double threshold)
+  {
+    this->GetFilter()->SetThreshold(threshold);
+  }
+
+  /** Number of basins before merging */
+  LabelType GetNumberOfBasins() const
+  {
+    return this->GetFilter()->GetNumberOfBasins();
+  }
+
+protected:
+  /** Constructor */
+  StreamingWatershedImageFilter() {};
+  /** Destructor */
+  ~StreamingWatershedImageFilter() ITK_OVERRIDE {}
+
+private:
+  StreamingWatershedImageFilter(const Self &); //purposely not implemented
+  void operator =(const Self&); //purposely not implemented
+};
+
+} // end namespace otb
+
+#ifndef OTB_MANUAL_INSTANTIATION
+#include "otbStreamingWatershedImageFilter.txx"
+#endif
+
+#endif
@@ -0,0 +1,603 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef otbStreamingWatershedImageFilter_txx
+#define otbStreamingWatershedImageFilter_txx
+
+#include "otbStreamingWatershedImageFilter.h"
+#include "itkImageRegionConstIterator.h"
+#include <algorithm>
+#include <queue>
+
+namespace otb
+{
+
+template<class TInputImage>
+PersistentWatershedImageFilter<TInputImage>
+::PersistentWatershedImageFilter() :
+  m_Threshold(0.),
+  m_LargestRegion(),
+  m_Blocks(),
+  m_BlockOffsets(),
+  m_NumberOfBasins(0),
+  m_MinimumValue(0.),
+  m_MaximumValue(0.),
+  m_Merges()
+{
+  m_BlockSize.Fill(256);
+  m_GridSize[0] = 0;
+  m_GridSize[1] = 0;
+  this->SetNumberOfRequiredInputs(1);
+}
+
+template<class TInputImage>
+itk::DataObject::Pointer
+PersistentWatershedImageFilter<TInputImage>
+::MakeOutput(DataObjectPointerArraySizeType itkNotUsed(output))
+{
+  return static_cast<itk::DataObject*>(TInputImage::New().GetPointer());
+}
+
+template<class TInputImage>
+typename PersistentWatershedImageFilter<TInputImage>::RegionType
+PersistentWatershedImageFilter<TInputImage>
+::GetBlockRegion(unsigned int blockId) const
+{
+  const unsigned int block[2] = {blockId % m_GridSize[0], blockId / m_GridSize[0]};
+  IndexType index;
+  SizeType size;
+  for (unsigned int i = 0; i < 2; ++i)
+    {
+    const long offset = static_cast<long>(block[i] * m_BlockSize[i]);
+    index[i] = m_LargestRegion.GetIndex()[i] + offset;
+    size[i] = std::min(m_BlockSize[i], m_LargestRegion.GetSize()[i] - static_cast<unsigned long>(offset));
+    }
+  RegionType region(index, size);
+  return region;
+}
+
+template<class TInputImage>
+void
+PersistentWatershedImageFilter<TInputImage>
+::GetBlocks(const RegionType & region, bool startingIn, std::vector<unsigned int> & blocks) const
+{
+  blocks.clear();
+  long first[2];
+  long last[2];
+  for (unsigned int i = 0; i < 2; ++i)
+    {
+    const long start = region.GetIndex()[i] - m_LargestRegion.GetIndex()[i];
+    const long end = start + static_cast<long>(region.GetSize()[i]) - 1;
+    const long blockSize = static_cast<long>(m_BlockSize[i]);
+    if (region.GetSize()[i] == 0 || end < 0)
+      {
+      return;
+      }
+    first[i] = startingIn ? (std::max(start, 0L) + blockSize - 1) / blockSize : std::max(start, 0L) / blockSize;
+    last[i] = std::min(end / blockSize, static_cast<long>(m_GridSize[i]) - 1);
+    }
+  for (long y = first[1]; y <= last[1]; ++y)
+    {
+    for (long x = first[0]; x <= last[0]; ++x)
+      {
+      blocks.push_back(static_cast<unsigned int>(y * m_GridSize[0] + x));
+      }
+    }
+}
+
+template<class TInputImage>
+typename PersistentWatershedImageFilter<TInputImage>::LabelType
+PersistentWatershedImageFilter<TInputImage>
+::FloodRegion(const ImageType * image, const RegionType & region,
+              LabelVectorType & labels, ValueVectorType & values, ValueVectorType & minima)
+{
+  const unsigned long width = region.GetSize()[0];
+  const unsigned long height = region.GetSize()[1];
+  const unsigned long nbPixels = width * height;
+
+  values.resize(nbPixels);
+  itk::ImageRegionConstIterator<ImageType> it(image, region);
+  unsigned long pos = 0;
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it, ++pos)
+    {
+    values[pos] = static_cast<double>(it.Get());
+    }
+
+  labels.assign(nbPixels, 0);
+  minima.clear();
+
+  // regional minima: plateaus of equal values without any lower neighbour.
+  // status is 1 for the pixels already explored, and 2 once queued.
+  std::vector<unsigned char> status(nbPixels, 0);
+  std::vector<unsigned long> plateau;
+  unsigned long neighbours[4];
+  for (unsigned long start = 0; start < nbPixels; ++start)
+    {
+    if (status[start] != 0)
+      {
+      continue;
+      }
+    plateau.assign(1, start);
+    status[start] = 1;
+    bool isMinimum = true;
+    for (unsigned long i = 0; i < plateau.size(); ++i)
+      {
+      const unsigned long current = plateau[i];
+      const unsigned int nb = GetNeighbours(current, width, height, neighbours);
+      for (unsigned int k = 0; k < nb; ++k)
+        {
+        const unsigned long neighbour = neighbours[k];
+        if (values[neighbour] < values[current])
+          {
+          isMinimum = false;
+          }
+        else if (values[neighbour] == values[current] && status[neighbour] == 0)
+          {
+          status[neighbour] = 1;
+          plateau.push_back(neighbour);
+          }
+        }
+      }
+    if (isMinimum)
+      {
+      minima.push_back(values[start]);
+      const LabelType label = static_cast<LabelType>(minima.size());
+      for (unsigned long i = 0; i < plateau.size(); ++i)
+        {
+        labels[plateau[i]] = label;
+        }
+      }
+    }
+
+  // flooding from the minima, the lowest pixels first
+  std::priority_queue<FloodPixelStruct> queue;
+  unsigned long order = 0;
+  FloodPixelStruct floodPixel;
+  for (pos = 0; pos < nbPixels; ++pos)
+    {
+    if (labels[pos] == 0)
+      {
+      continue;
+      }
+    const unsigned int nb = GetNeighbours(pos, width, height, neighbours);
+    for (unsigned int k = 0; k < nb; ++k)
+      {
+      const unsigned long neighbour = neighbours[k];
+      if (labels[neighbour] == 0 && status[neighbour] != 2)
+        {
+        status[neighbour] = 2;
+        floodPixel.Value = values[neighbour];
+        floodPixel.Order = order++;
+        floodPixel.Position = neighbour;
+        floodPixel.Label = labels[pos];
+        queue.push(floodPixel);
+        }
+      }
+    }
+
+  while (!queue.empty())
+    {
+    const FloodPixelStruct current = queue.top();
+    queue.pop();
+    labels[current.Position] = current.Label;
+    const unsigned int nb = GetNeighbours(current.Position, width, height, neighbours);
+    for (unsigned int k = 0; k < nb; ++k)
+      {
+      const unsigned long neighbour = neighbours[k];
+      if (labels[neighbour] == 0 && status[neighbour] != 2)
+        {
+        status[neighbour] = 2;
+        floodPixel.Value = values[neighbour];
+        floodPixel.Order = order++;
+        floodPixel.Position = neighbour;
+        floodPixel.Label = current.Label;
+        queue.push(floodPixel);
+        }
+      }
+    }
+
+  return static_cast<LabelType>(minima.size());
+}
+
+template<class TInputImage>
+void
+PersistentWatershedImageFilter<TInputImage>
+::GenerateOutputInformation()
+{
+  Superclass::GenerateOutputInformation();
+  if (this->GetInput())
+    {
+    this->GetOutput()->CopyInformation(this->GetInput());
+    this->GetOutput()->SetLargestPossibleRegion(this->GetInput()->GetLargestPossibleRegion());
+
+    if (this->GetOutput()->GetRequestedRegion().GetNumberOfPixels() == 0)
+      {
+      this->GetOutput()->SetRequestedRegion(this->GetOutput()->GetLargestPossibleRegion());
+      }
+    }
+}
+
+template<class TInputImage>
+void
+PersistentWatershedImageFilter<TInputImage>
+::GenerateInputRequestedRegion()
+{
+  Superclass::GenerateInputRequestedRegion();
+
+  // request the blocks starting in the requested region
+  std::vector<unsigned int> blocks;
+  this->GetBlocks(this->GetOutput()->GetRequestedRegion(), true, blocks);
+  if (blocks.empty())
+    {
+    return;
+    }
+  RegionType requested = this->GetBlockRegion(blocks.front());
+  const RegionType lastBlock = this->GetBlockRegion(blocks.back());
+  SizeType size;
+  for (unsigned int i = 0; i < 2; ++i)
+    {
+    size[i] = static_cast<unsigned long>(lastBlock.GetIndex()[i] - requested.GetIndex()[i]) + lastBlock.GetSize()[i];
+    }
+  requested.SetSize(size);
+
+  ImageType * input = const_cast<ImageType *>(this->GetInput());
+  if (input)
+    {
+    input->SetRequestedRegion(requested);
+    }
+}
+
+template<class TInputImage>
+void
+PersistentWatershedImageFilter<TInputImage>
+::AllocateOutputs()
+{
+  // Nothing that needs to be allocated for the outputs : the output is not meant to be used
+}
+
+template<class TInputImage>
+void
+PersistentWatershedImageFilter<TInputImage>
+::Reset()
+{
+  ImageType * inputPtr = const_cast<ImageType *>(this->GetInput());
+  inputPtr->UpdateOutputInformation();
+
+  for (unsigned int i = 0; i < 2; ++i)
+    {
+    if (m_BlockSize[i] == 0)
+      {
+      itkExceptionMacro(<< "Block size must be strictly positive");
+      }
+    }
+
+  m_LargestRegion = inputPtr->GetLargestPossibleRegion();
+  for (unsigned int i = 0; i < 2; ++i)
+    {
+    m_GridSize[i] = static_cast<unsigned int>((m_LargestRegion.GetSize()[i] + m_BlockSize[i] - 1) / m_BlockSize[i]);
+    }
+  m_Blocks.assign(m_GridSize[0] * m_GridSize[1], BlockStruct());
+  m_BlockOffsets.clear();
+  m_NumberOfBasins = 0;
+  m_MinimumValue = 0.;
+  m_MaximumValue = 0.;
+  m_Merges.clear();
+}
+
+template<class TInputImage>
+void
+PersistentWatershedImageFilter<TInputImage>
+::ProcessBlock(unsigned int blockId)
+{
+  BlockStruct & block = m_Blocks[blockId];
+  const RegionType region = this->GetBlockRegion(blockId);
+
+  LabelVectorType labels;
+  ValueVectorType values;
+  block.NumberOfBasins = FloodRegion(this->GetInput(), region, labels, values, block.Minima);
+
+  const unsigned long width = region.GetSize()[0];
+  const unsigned long height = region.GetSize()[1];
+
+  block.MinimumValue = *std::min_element(values.begin(), values.end());
+  block.MaximumValue = *std::max_element(values.begin(), values.end());
+
+  // links between adjacent basins, with the lowest pass value
+  block.Edges.clear();
+  for (unsigned long y = 0; y < height; ++y)
+    {
+    for (unsigned long x = 0; x < width; ++x)
+      {
+      const unsigned long pos = y * width + x;
+      if (x + 1 < width && labels[pos] != labels[pos + 1])
+        {
+        block.Edges.push_back(EdgeStruct(std::min(labels[pos], labels[pos + 1]), std::max(labels[pos], labels[pos + 1]),
+                                         std::max(values[pos], values[pos + 1])));
+        }
+      if (y + 1 < height && labels[pos] != labels[pos + width])
+        {
+        block.Edges.push_back(EdgeStruct(std::min(labels[pos], labels[pos + width]), std::max(labels[pos], labels[pos + width]),
+                                         std::max(values[pos], values[pos + width])));
+        }
+      }
+    }
+  std::sort(block.Edges.begin(), block.Edges.end(), CompareEdgeLabels);
+  unsigned long nbEdges = 0;
+  for (unsigned long i = 0; i < block.Edges.size(); ++i)
+    {
+    if (nbEdges == 0 || block.Edges[i].First != block.Edges[nbEdges - 1].First
+        || block.Edges[i].Second != block.Edges[nbEdges - 1].Second)
+      {
+      block.Edges[nbEdges++] = block.Edges[i];
+      }
+    }
+  block.Edges.resize(nbEdges);
+
+  // borders
+  block.TopLabels.assign(labels.begin(), labels.begin() + width);
+  block.TopValues.assign(values.begin(), values.begin() + width);
+  block.BottomLabels.assign(labels.end() - width, labels.end());
+  block.BottomValues.assign(values.end() - width, values.end());
+  block.LeftLabels.resize(height);
+  block.LeftValues.resize(height);
+  block.RightLabels.resize(height);
+  block.RightValues.resize(height);
+  for (unsigned long y = 0; y < height; ++y)
+    {
+    block.LeftLabels[y] = labels[y * width];
+    block.LeftValues[y] = values[y * width];
+    block.RightLabels[y] = labels[y * width + width - 1];
+    block.RightValues[y] = values[y * width + width - 1];
+    }
+  block.Processed = true;
+}
+
+template<class TInputImage>
+ITK_THREAD_RETURN_TYPE
+PersistentWatershedImageFilter<TInputImage>
+::ThreaderCallback(void *arg)
+{
+  itk::MultiThreader::ThreadInfoStruct * info = (itk::MultiThreader::ThreadInfoStruct *) arg;
+  ThreadStruct * str = (ThreadStruct *) info->UserData;
+
+  try
+    {
+    for (unsigned int b = info->ThreadID; b < str->Blocks.size(); b += info->NumberOfThreads)
+      {
+      str->Filter->ProcessBlock(str->Blocks[b]);
+      }
+    }
+  catch (itk::ExceptionObject & err)
+    {
+    str->Errors[info->ThreadID] = err.GetDescription();
+    }
+  catch (std::bad_alloc & err)
+    {
+    str->Errors[info->ThreadID] = err.what();
+    }
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template<class TInputImage>
+void
+PersistentWatershedImageFilter<TInputImage>
+::GenerateData()
+{
+  ThreadStruct str;
+  str.Filter = this;
+  this->GetBlocks(this->GetOutput()->GetRequestedRegion(), true, str.Blocks);
+  if (str.Blocks.empty())
+    {
+    return;
+    }
+
+  const unsigned int nbThreads = std::min<unsigned int>(this->GetNumberOfThreads(), str.Blocks.size());
+  str.Errors.assign(nbThreads, std::string());
+
+  itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+  threader->SetNumberOfThreads(nbThreads);
+  threader->SetSingleMethod(ThreaderCallback, &str);
+  threader->SingleMethodExecute();
+
+  for (unsigned int i = 0; i < str.Errors.size(); ++i)
+    {
+    if (!str.Errors[i].empty())
+      {
+      itkExceptionMacro(<< "Watershed flooding failed: " << str.Errors[i]);
+      }
+    }
+}
+
+template<class TInputImage>
+void
+PersistentWatershedImageFilter<TInputImage>
+::Synthetize()
+{
+  const unsigned int nbBlocks = m_Blocks.size();
+
+  // offsets of the block basins in the global basin labels
+  m_BlockOffsets.assign(nbBlocks, 0);
+  m_NumberOfBasins = 0;
+  for (unsigned int b = 0; b < nbBlocks; ++b)
+    {
+    if (!m_Blocks[b].Processed)
+      {
+      itkExceptionMacro(<< "Block " << b << " has not been flooded: the whole image must be streamed");
+      }
+    m_BlockOffsets[b] = m_NumberOfBasins;
+    m_NumberOfBasins += m_Blocks[b].NumberOfBasins;
+    }
+  if (nbBlocks == 0)
+    {
+    return;
+    }
+
+  // minima of the basins, and links inside the blocks and across their borders
+  ValueVectorType minima(m_NumberOfBasins + 1, 0.);
+  std::vector<EdgeStruct> edges;
+  m_MinimumValue = m_Blocks[0].MinimumValue;
+  m_MaximumValue = m_Blocks[0].MaximumValue;
+  for (unsigned int b = 0; b < nbBlocks; ++b)
+    {
+    const BlockStruct & block = m_Blocks[b];
+    const LabelType offset = m_BlockOffsets[b];
+    m_MinimumValue = std::min(m_MinimumValue, block.MinimumValue);
+    m_MaximumValue = std::max(m_MaximumValue, block.MaximumValue);
+    std::copy(block.Minima.begin(), block.Minima.end(), minima.begin() + offset + 1);
+    for (unsigned int i = 0; i < block.Edges.size(); ++i)
+      {
+      edges.push_back(EdgeStruct(offset + block.Edges[i].First, offset + block.Edges[i].Second, block.Edges[i].Pass));
+      }
+
+    const unsigned int x = b % m_GridSize[0];
+    const unsigned int y = b / m_GridSize[0];
+    if (y + 1 < m_GridSize[1])
+      {
+      const BlockStruct & lower = m_Blocks[b + m_GridSize[0]];
+      const LabelType lowerOffset = m_BlockOffsets[b + m_GridSize[0]];
+      for (unsigned int i = 0; i < block.BottomLabels.size(); ++i)
+        {
+        edges.push_back(EdgeStruct(offset + block.BottomLabels[i], lowerOffset + lower.TopLabels[i],
+                                   std::max(block.BottomValues[i], lower.TopValues[i])));
+        }
+      }
+    if (x + 1 < m_GridSize[0])
+      {
+      const BlockStruct & right = m_Blocks[b + 1];
+      const LabelType rightOffset = m_BlockOffsets[b + 1];
+      for (unsigned int i = 0; i < block.RightLabels.size(); ++i)
+        {
+        edges.push_back(EdgeStruct(offset + block.RightLabels[i], rightOffset + right.LeftLabels[i],
+                                   std::max(block.RightValues[i], right.LeftValues[i])));
+        }
+      }
+    }
+
+  // the blocks are not needed anymore
+  for (unsigned int b = 0; b < nbBlocks; ++b)
+    {
+    m_Blocks[b] = BlockStruct();
+    m_Blocks[b].Processed = true;
+    }
+
+  // values below the threshold are considered equal
+  const double threshold = m_MinimumValue + m_Threshold * (m_MaximumValue - m_MinimumValue);
+  for (LabelType label = 1; label <= m_NumberOfBasins; ++label)
+    {
+    minima[label] = std::max(minima[label], threshold);
+    }
+  for (unsigned long i = 0; i < edges.size(); ++i)
+    {
+    edges[i].Pass = std::max(edges[i].Pass, threshold);
+    }
+
+  // merge the basins in increasing order of pass values. The saliency of a
+  // merge is the depth of the shallower basin below the pass.
+  std::sort(edges.begin(), edges.end());
+  LabelVectorType parents(m_NumberOfBasins + 1);
+  for (LabelType label = 0; label <= m_NumberOfBasins; ++label)
+    {
+    parents[label] = label;
+    }
+  m_Merges.clear();
+  for (unsigned long i = 0; i < edges.size(); ++i)
+    {
+    const LabelType root1 = FindRoot(parents, edges[i].First);
+    const LabelType root2 = FindRoot(parents, edges[i].Second);
+    if (root1 == root2)
+      {
+      continue;
+      }
+    MergeStruct merge;
+    merge.First = edges[i].First;
+    merge.Second = edges[i].Second;
+    merge.Saliency = edges[i].Pass - std::max(minima[root1], minima[root2]);
+    m_Merges.push_back(merge);
+
+    // the root keeps the minimum of the merged basin
+    if (minima[root1] <= minima[root2])
+      {
+      parents[root2] = root1;
+      }
+    else
+      {
+      parents[root1] = root2;
+      }
+    }
+}
+
+template<class TInputImage>
+typename PersistentWatershedImageFilter<TInputImage>::LabelType
+PersistentWatershedImageFilter<TInputImage>
+::ComputeLabelTable(double level, LabelVectorType & table) const
+{
+  const double saliency = level * (m_MaximumValue - m_MinimumValue);
+
+  // union-find on the merges below the level, a root being the smallest
+  // label of its set
+  LabelVectorType parents(m_NumberOfBasins + 1);
+  for (LabelType label = 0; label <= m_NumberOfBasins; ++label)
+    {
+    parents[label] = label;
+    }
+  for (unsigned long i = 0; i < m_Merges.size(); ++i)
+    {
+    if (m_Merges[i].Saliency > saliency)
+      {
+      continue;
+      }
+    const LabelType root1 = FindRoot(parents, m_Merges[i].First);
+    const LabelType root2 = FindRoot(parents, m_Merges[i].Second);
+    if (root1 < root2)
+      {
+      parents[root2] = root1;
+      }
+    else if (root2 < root1)
+      {
+      parents[root1] = root2;
+      }
+    }
+
+  // number the objects in the order of their first basin
+  table.assign(m_NumberOfBasins + 1, 0);
+  LabelType nbObjects = 0;
+  for (LabelType label = 1; label <= m_NumberOfBasins; ++label)
+    {
+    const LabelType root = FindRoot(parents, label);
+    table[label] = (root == label) ? ++nbObjects : table[root];
+    }
+  return nbObjects;
+}
+
+template<class TInputImage>
+void
+PersistentWatershedImageFilter<TInputImage>
+::PrintSelf(std::ostream& os, itk::Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "Threshold: " << m_Threshold << std::endl;
+  os << indent << "Block size: " << m_BlockSize << std::endl;
+  os << indent << "Number of basins: " << m_NumberOfBasins << std::endl;
+  os << indent << "Number of merges: " << m_Merges.size() << std::endl;
+}
+
+} // end namespace otb
+#endif
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef otbWatershedLabelImageFilter_h
+#define otbWatershedLabelImageFilter_h
+
+#include "otbStreamingWatershedImageFilter.h"
+#include "itkImageToImageFilter.h"
+
+namespace otb
+{
+
+/** \class WatershedLabelImageFilter
+ * \brief Second pass of a watershed segmentation of a large image
+ *
+ * This filter produces the label image of the watershed segmentation computed
+ * by a PersistentWatershedImageFilter, once the whole image has been streamed
+ * through it (see SetFlooding()). Each block of the flooding grid
+ * intersecting the requested region is flooded again, in parallel, and its
+ * basins are replaced by the labels of the objects at the flood level (see
+ * SetLevel()). Changing the level does not require a new first pass.
+ *
+ * The input image must be the one used for the first pass.
+ *
+ * \sa PersistentWatershedImageFilter
+ * \ingroup Streamed
+ * \ingroup Multithreaded
+ *
+ * \ingroup OTBWatersheds
+ */
+template<class TInputImage, class TLabelImage>
+class ITK_EXPORT WatershedLabelImageFilter :
+  public itk::ImageToImageFilter<TInputImage, TLabelImage>
+{
+public:
+  /** Standard Self typedef */
+  typedef WatershedLabelImageFilter                         Self;
+  typedef itk::ImageToImageFilter<TInputImage, TLabelImage> Superclass;
+  typedef itk::SmartPointer<Self>                           Pointer;
+  typedef itk::SmartPointer<const Self>                     ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Runtime information support. */
+  itkTypeMacro(WatershedLabelImageFilter, ImageToImageFilter);
+
+  /** Image related typedefs. */
+  typedef TInputImage                             InputImageType;
+  typedef TLabelImage                             LabelImageType;
+  typedef typename TLabelImage::PixelType         LabelPixelType;
+  typedef typename TInputImage::RegionType        RegionType;
+  typedef typename TInputImage::SizeType          SizeType;
+  typedef typename TInputImage::IndexType         IndexType;
+
+  /** First pass typedefs */
+  typedef PersistentWatershedImageFilter<TInputImage>   FloodingFilterType;
+  typedef typename FloodingFilterType::LabelType        LabelType;
+  typedef typename FloodingFilterType::LabelVectorType  LabelVectorType;
+  typedef typename FloodingFilterType::ValueVectorType  ValueVectorType;
+
+  /** Set/Get the first pass, after Synthetize() */
+  void SetFlooding(const FloodingFilterType * flooding)
+  {
+    m_Flooding = flooding;
+    m_LabelTable.clear();
+    this->Modified();
+  }
+  const FloodingFilterType * GetFlooding() const
+  {
+    return m_Flooding;
+  }
+
+  /** Set/Get the flood level, as a fraction of the image depth (default is 0) */
+  void SetLevel(double level)
+  {
+    if (level != m_Level)
+      {
+      m_Level = level;
+      m_LabelTable.clear();
+      this->Modified();
+      }
+  }
+  itkGetConstMacro(Level, double);
+
+  /** Number of objects at the flood level */
+  LabelType GetNumberOfObjects();
+
+protected:
+  WatershedLabelImageFilter();
+  ~WatershedLabelImageFilter() ITK_OVERRIDE {}
+  void PrintSelf(std::ostream& os, itk::Indent indent) const ITK_OVERRIDE;
+
+  void GenerateInputRequestedRegion() ITK_OVERRIDE;
+  void EnlargeOutputRequestedRegion(itk::DataObject *) ITK_OVERRIDE {}
+
+  /** Flood the blocks intersecting the requested region, in parallel */
+  void GenerateData() ITK_OVERRIDE;
+
+private:
+  WatershedLabelImageFilter(const Self &); //purposely not implemented
+  void operator =(const Self&); //purposely not implemented
+
+  /** Structure passed to the threads */
+  struct ThreadStruct
+  {
+    Self *                      Filter;
+    std::vector<unsigned int>   Blocks;
+    std::vector<std::string>    Errors;
+  };
+
+  static ITK_THREAD_RETURN_TYPE ThreaderCallback(void *arg);
+
+  /** Compute the label table at the flood level, if needed */
+  void UpdateLabelTable();
+
+  /** Flood a block and write its part of the requested region */
+  void ProcessBlock(unsigned int blockId);
+
+  typename FloodingFilterType::ConstPointer m_Flooding;
+  double                                    m_Level;
+  LabelVectorType                           m_LabelTable;
+  LabelType                                 m_NumberOfObjects;
+
+}; // end of class WatershedLabelImageFilter
+
+} // end namespace otb
+
+#ifndef OTB_MANUAL_INSTANTIATION
+#include "otbWatershedLabelImageFilter.txx"
+#endif
+
+#endif
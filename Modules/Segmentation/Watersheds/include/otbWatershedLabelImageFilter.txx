@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef otbWatershedLabelImageFilter_txx
+#define otbWatershedLabelImageFilter_txx
+
+#include "otbWatershedLabelImageFilter.h"
+
+namespace otb
+{
+
+template<class TInputImage, class TLabelImage>
+WatershedLabelImageFilter<TInputImage, TLabelImage>
+::WatershedLabelImageFilter() :
+  m_Level(0.),
+  m_LabelTable(),
+  m_NumberOfObjects(0)
+{
+  this->SetNumberOfRequiredInputs(1);
+}
+
+template<class TInputImage, class TLabelImage>
+void
+WatershedLabelImageFilter<TInputImage, TLabelImage>
+::UpdateLabelTable()
+{
+  if (m_Flooding.IsNull())
+    {
+    itkExceptionMacro(<< "The first pass of the watershed is not set");
+    }
+  if (m_LabelTable.empty())
+    {
+    m_NumberOfObjects = m_Flooding->ComputeLabelTable(m_Level, m_LabelTable);
+    }
+}
+
+template<class TInputImage, class TLabelImage>
+typename WatershedLabelImageFilter<TInputImage, TLabelImage>::LabelType
+WatershedLabelImageFilter<TInputImage, TLabelImage>
+::GetNumberOfObjects()
+{
+  this->UpdateLabelTable();
+  return m_NumberOfObjects;
+}
+
+template<class TInputImage, class TLabelImage>
+void
+WatershedLabelImageFilter<TInputImage, TLabelImage>
+::GenerateInputRequestedRegion()
+{
+  Superclass::GenerateInputRequestedRegion();
+
+  if (m_Flooding.IsNull())
+    {
+    itkExceptionMacro(<< "The first pass of the watershed is not set");
+    }
+
+  // request the whole blocks intersecting the requested region
+  std::vector<unsigned int> blocks;
+  m_Flooding->GetBlocks(this->GetOutput()->GetRequestedRegion(), false, blocks);
+  if (blocks.empty())
+    {
+    return;
+    }
+  RegionType requested = m_Flooding->GetBlockRegion(blocks.front());
+  const RegionType lastBlock = m_Flooding->GetBlockRegion(blocks.back());
+  SizeType size;
+  for (unsigned int i = 0; i < 2; ++i)
+    {
+    size[i] = static_cast<unsigned long>(lastBlock.GetIndex()[i] - requested.GetIndex()[i]) + lastBlock.GetSize()[i];
+    }
+  requested.SetSize(size);
+
+  InputImageType * input = const_cast<InputImageType *>(this->GetInput());
+  if (input)
+    {
+    input->SetRequestedRegion(requested);
+    }
+}
+
+template<class TInputImage, class TLabelImage>
+void
+WatershedLabelImageFilter<TInputImage, TLabelImage>
+::ProcessBlock(unsigned int blockId)
+{
+  const RegionType region = m_Flooding->GetBlockRegion(blockId);
+  RegionType core = region;
+  if (!core.Crop(this->GetOutput()->GetRequestedRegion()))
+    {
+    return;
+    }
+
+  LabelVectorType labels;
+  ValueVectorType values;
+  ValueVectorType minima;
+  FloodingFilterType::FloodRegion(this->GetInput(), region, labels, values, minima);
+
+  LabelImageType * output = this->GetOutput();
+  const unsigned long width = region.GetSize()[0];
+  IndexType index;
+  for (unsigned long y = 0; y < core.GetSize()[1]; ++y)
+    {
+    index[1] = core.GetIndex()[1] + static_cast<long>(y);
+    const unsigned long row = static_cast<unsigned long>(index[1] - region.GetIndex()[1]);
+    for (unsigned long x = 0; x < core.GetSize()[0]; ++x)
+      {
+      index[0] = core.GetIndex()[0] + static_cast<long>(x);
+      const unsigned long col = static_cast<unsigned long>(index[0] - region.GetIndex()[0]);
+      output->SetPixel(index, static_cast<LabelPixelType>(
+                         m_Flooding->GetGlobalLabel(m_LabelTable, blockId, labels[row * width + col])));
+      }
+    }
+}
+
+template<class TInputImage, class TLabelImage>
+ITK_THREAD_RETURN_TYPE
+WatershedLabelImageFilter<TInputImage, TLabelImage>
+::ThreaderCallback(void *arg)
+{
+  itk::MultiThreader::ThreadInfoStruct * info = (itk::MultiThreader::ThreadInfoStruct *) arg;
+  ThreadStruct * str = (ThreadStruct *) info->UserData;
+
+  try
+    {
+    for (unsigned int b = info->ThreadID; b < str->Blocks.size(); b += info->NumberOfThreads)
+      {
+      str->Filter->ProcessBlock(str->Blocks[b]);
+      }
+    }
+  catch (itk::ExceptionObject & err)
+    {
+    str->Errors[info->ThreadID] = err.GetDescription();
+    }
+  catch (std::bad_alloc & err)
+    {
+    str->Errors[info->ThreadID] = err.what();
+    }
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template<class TInputImage, class TLabelImage>
+void
+WatershedLabelImageFilter<TInputImage, TLabelImage>
+::GenerateData()
+{
+  this->AllocateOutputs();
+  this->GetOutput()->FillBuffer(itk::NumericTraits<LabelPixelType>::Zero);
+
+  // the table is shared by all the streams
+  this->UpdateLabelTable();
+
+  ThreadStruct str;
+  str.Filter = this;
+  m_Flooding->GetBlocks(this->GetOutput()->GetRequestedRegion(), false, str.Blocks);
+  if (str.Blocks.empty())
+    {
+    return;
+    }
+
+  const unsigned int nbThreads = std::min<unsigned int>(this->GetNumberOfThreads(), str.Blocks.size());
+  str.Errors.assign(nbThreads, std::string());
+
+  itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+  threader->SetNumberOfThreads(nbThreads);
+  threader->SetSingleMethod(ThreaderCallback, &str);
+  threader->SingleMethodExecute();
+
+  for (unsigned int i = 0; i < str.Errors.size(); ++i)
+    {
+    if (!str.Errors[i].empty())
+      {
+      itkExceptionMacro(<< "Watershed labelling failed: " << str.Errors[i]);
+      }
+    }
+}
+
+template<class TInputImage, class TLabelImage>
+void
+WatershedLabelImageFilter<TInputImage, TLabelImage>
+::PrintSelf(std::ostream& os, itk::Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+  os << indent << "Level: " << m_Level << std::endl;
+  if (!m_LabelTable.empty())
+    {
+    os << indent << "Number of objects: " << m_NumberOfObjects << std::endl;
+    }
+}
+
+} // end namespace otb
+#endif
@@ -24,6 +24,7 @@ otb_module(OTBWatersheds
   DEPENDS
     OTBCommon
     OTBITK
+    OTBStreaming
 
   TEST_DEPENDS
     OTBTestKernel
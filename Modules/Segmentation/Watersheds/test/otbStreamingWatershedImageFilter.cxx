@@ -0,0 +1,251 @@
+/*
+ * Copyright (C) 2005-2017 Centre National d'Etudes Spatiales (CNES)
+ *
+ * This file is part of Orfeo Toolbox
+ *
+ *     https://www.orfeo-toolbox.org/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "otbImage.h"
+#include "otbImageFileReader.h"
+#include "otbStreamingWatershedImageFilter.h"
+#include "otbWatershedLabelImageFilter.h"
+#include "itkStreamingImageFilter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkWatershedImageFilter.h"
+#include <map>
+#include <cmath>
+
+int otbStreamingWatershedImageFilter(int itkNotUsed(argc), char * argv[])
+{
+  const char * inputFilename = argv[1];
+  const unsigned int blockSize = atoi(argv[2]);
+  const unsigned int nbStreams = atoi(argv[3]);
+  const double threshold = atof(argv[4]);
+  const double level = atof(argv[5]);
+
+  const unsigned int Dimension = 2;
+  typedef otb::Image<float, Dimension>                   InputImageType;
+  typedef otb::Image<unsigned int, Dimension>            LabelImageType;
+  typedef otb::ImageFileReader<InputImageType>           ReaderType;
+
+  typedef otb::StreamingWatershedImageFilter<InputImageType>                  FloodingFilterType;
+  typedef otb::WatershedLabelImageFilter<InputImageType, LabelImageType>      LabelFilterType;
+  typedef itk::StreamingImageFilter<LabelImageType, LabelImageType>           StreamingFilterType;
+  typedef itk::ImageRegionConstIterator<LabelImageType>                       IteratorType;
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName(inputFilename);
+  reader->UpdateOutputInformation();
+
+  FloodingFilterType::InternalFilterType::SizeType size;
+  size.Fill(blockSize);
+
+  // First pass, with one stream and with several streams
+  FloodingFilterType::Pointer flooding = FloodingFilterType::New();
+  flooding->SetInput(reader->GetOutput());
+  flooding->SetThreshold(threshold);
+  flooding->GetFilter()->SetBlockSize(size);
+  flooding->GetStreamer()->SetNumberOfDivisionsStrippedStreaming(1);
+  flooding->Update();
+
+  FloodingFilterType::Pointer streamedFlooding = FloodingFilterType::New();
+  streamedFlooding->SetInput(reader->GetOutput());
+  streamedFlooding->SetThreshold(threshold);
+  streamedFlooding->GetFilter()->SetBlockSize(size);
+  streamedFlooding->GetStreamer()->SetNumberOfDivisionsStrippedStreaming(nbStreams);
+  streamedFlooding->Update();
+
+  if (flooding->GetNumberOfBasins() != streamedFlooding->GetNumberOfBasins())
+    {
+    std::cerr << "Number of basins depends on the streaming: " << flooding->GetNumberOfBasins()
+              << " and " << streamedFlooding->GetNumberOfBasins() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Second pass, at the lowest level and at the given level
+  LabelFilterType::Pointer fineLabels = LabelFilterType::New();
+  fineLabels->SetInput(reader->GetOutput());
+  fineLabels->SetFlooding(flooding->GetFilter());
+  fineLabels->SetLevel(0.);
+  StreamingFilterType::Pointer fineStreaming = StreamingFilterType::New();
+  fineStreaming->SetInput(fineLabels->GetOutput());
+  fineStreaming->SetNumberOfStreamDivisions(1);
+  fineStreaming->Update();
+
+  LabelFilterType::Pointer labels = LabelFilterType::New();
+  labels->SetInput(reader->GetOutput());
+  labels->SetFlooding(flooding->GetFilter());
+  labels->SetLevel(level);
+  StreamingFilterType::Pointer streaming = StreamingFilterType::New();
+  streaming->SetInput(labels->GetOutput());
+  streaming->SetNumberOfStreamDivisions(1);
+  streaming->Update();
+
+  LabelFilterType::Pointer streamedLabels = LabelFilterType::New();
+  streamedLabels->SetInput(reader->GetOutput());
+  streamedLabels->SetFlooding(streamedFlooding->GetFilter());
+  streamedLabels->SetLevel(level);
+  StreamingFilterType::Pointer streamedStreaming = StreamingFilterType::New();
+  streamedStreaming->SetInput(streamedLabels->GetOutput());
+  streamedStreaming->SetNumberOfStreamDivisions(nbStreams);
+  streamedStreaming->Update();
+
+  if (labels->GetNumberOfObjects() > fineLabels->GetNumberOfObjects())
+    {
+    std::cerr << "More objects at level " << level << " (" << labels->GetNumberOfObjects()
+              << ") than at level 0 (" << fineLabels->GetNumberOfObjects() << ")" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The label images must not depend on the streaming, every pixel must be
+  // labelled, and the objects at level 0 must be nested in the ones at the
+  // given level
+  std::map<unsigned int, unsigned int> parents;
+  const LabelImageType::RegionType region = streaming->GetOutput()->GetLargestPossibleRegion();
+  IteratorType it(streaming->GetOutput(), region);
+  IteratorType itStreamed(streamedStreaming->GetOutput(), region);
+  IteratorType itFine(fineStreaming->GetOutput(), region);
+  for (it.GoToBegin(), itStreamed.GoToBegin(), itFine.GoToBegin(); !it.IsAtEnd(); ++it, ++itStreamed, ++itFine)
+    {
+    if (it.Get() != itStreamed.Get())
+      {
+      std::cerr << "Labels differ at " << it.GetIndex() << ": " << it.Get() << " and " << itStreamed.Get() << std::endl;
+      return EXIT_FAILURE;
+      }
+    if (it.Get() == 0 || itFine.Get() == 0)
+      {
+      std::cerr << "Pixel " << it.GetIndex() << " is not labelled" << std::endl;
+      return EXIT_FAILURE;
+      }
+    if (parents.insert(std::make_pair(itFine.Get(), it.Get())).first->second != it.Get())
+      {
+      std::cerr << "Object " << itFine.Get() << " at level 0 is split at level " << level << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
+
+int otbStreamingWatershedImageFilterCompareITK(int itkNotUsed(argc), char * argv[])
+{
+  const char * inputFilename = argv[1];
+  const double threshold = atof(argv[2]);
+  const double level = atof(argv[3]);
+  const double minAgreement = atof(argv[4]);
+  const double countTolerance = atof(argv[5]);
+
+  const unsigned int Dimension = 2;
+  typedef otb::Image<float, Dimension>                   InputImageType;
+  typedef otb::Image<unsigned int, Dimension>            LabelImageType;
+  typedef otb::ImageFileReader<InputImageType>           ReaderType;
+
+  typedef otb::StreamingWatershedImageFilter<InputImageType>                  FloodingFilterType;
+  typedef otb::WatershedLabelImageFilter<InputImageType, LabelImageType>      LabelFilterType;
+  typedef itk::WatershedImageFilter<InputImageType>                           ITKWatershedFilterType;
+  typedef ITKWatershedFilterType::OutputImageType                             ITKLabelImageType;
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName(inputFilename);
+  reader->Update();
+  const InputImageType::RegionType region = reader->GetOutput()->GetLargestPossibleRegion();
+
+  // A single block covering the whole image: there is no block border
+  FloodingFilterType::InternalFilterType::SizeType size = region.GetSize();
+  FloodingFilterType::Pointer flooding = FloodingFilterType::New();
+  flooding->SetInput(reader->GetOutput());
+  flooding->SetThreshold(threshold);
+  flooding->GetFilter()->SetBlockSize(size);
+  flooding->Update();
+
+  LabelFilterType::Pointer labels = LabelFilterType::New();
+  labels->SetInput(reader->GetOutput());
+  labels->SetFlooding(flooding->GetFilter());
+  labels->SetLevel(level);
+  labels->Update();
+
+  ITKWatershedFilterType::Pointer itkWatershed = ITKWatershedFilterType::New();
+  itkWatershed->SetInput(reader->GetOutput());
+  itkWatershed->SetThreshold(threshold);
+  itkWatershed->SetLevel(level);
+  itkWatershed->Update();
+
+  // Contingency table of the two segmentations
+  typedef std::map<unsigned long, unsigned long> CountMapType;
+  std::map<unsigned long, CountMapType> itkPerLabel;
+  std::map<unsigned long, CountMapType> labelPerItk;
+  itk::ImageRegionConstIterator<LabelImageType> it(labels->GetOutput(), region);
+  itk::ImageRegionConstIterator<ITKLabelImageType> itITK(itkWatershed->GetOutput(), region);
+  for (it.GoToBegin(), itITK.GoToBegin(); !it.IsAtEnd(); ++it, ++itITK)
+    {
+    ++itkPerLabel[it.Get()][itITK.Get()];
+    ++labelPerItk[itITK.Get()][it.Get()];
+    }
+
+  // Fraction of the pixels lying in the main overlapping segment of the other
+  // segmentation: the segments may only differ near the watershed lines
+  const double nbPixels = static_cast<double>(region.GetNumberOfPixels());
+  unsigned long majority = 0;
+  for (std::map<unsigned long, CountMapType>::const_iterator labelIt = itkPerLabel.begin();
+       labelIt != itkPerLabel.end(); ++labelIt)
+    {
+    unsigned long best = 0;
+    for (CountMapType::const_iterator countIt = labelIt->second.begin(); countIt != labelIt->second.end(); ++countIt)
+      {
+      best = std::max(best, countIt->second);
+      }
+    majority += best;
+    }
+  const double agreement = majority / nbPixels;
+  majority = 0;
+  for (std::map<unsigned long, CountMapType>::const_iterator labelIt = labelPerItk.begin();
+       labelIt != labelPerItk.end(); ++labelIt)
+    {
+    unsigned long best = 0;
+    for (CountMapType::const_iterator countIt = labelIt->second.begin(); countIt != labelIt->second.end(); ++countIt)
+      {
+      best = std::max(best, countIt->second);
+      }
+    majority += best;
+    }
+  const double itkAgreement = majority / nbPixels;
+
+  const double nbObjects = static_cast<double>(itkPerLabel.size());
+  const double nbITKObjects = static_cast<double>(labelPerItk.size());
+  std::cout << nbObjects << " objects (" << nbITKObjects << " with itk::WatershedImageFilter), agreement "
+            << agreement << " and " << itkAgreement << std::endl;
+
+  if (labels->GetNumberOfObjects() != itkPerLabel.size())
+    {
+    std::cerr << "The label image has " << itkPerLabel.size() << " objects instead of "
+              << labels->GetNumberOfObjects() << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (std::abs(nbObjects - nbITKObjects) > countTolerance * nbITKObjects)
+    {
+    std::cerr << "Number of objects differs from itk::WatershedImageFilter by more than "
+              << countTolerance * 100 << "%" << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (agreement < minAgreement || itkAgreement < minAgreement)
+    {
+    std::cerr << "Segmentation differs from itk::WatershedImageFilter: agreement below "
+              << minAgreement << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -23,4 +23,6 @@
 void RegisterTests()
 {
   REGISTER_TEST(otbWatershedSegmentationFilter);
+  REGISTER_TEST(otbStreamingWatershedImageFilter);
+  REGISTER_TEST(otbStreamingWatershedImageFilterCompareITK);
 }